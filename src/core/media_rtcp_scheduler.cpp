@@ -14,6 +14,8 @@ RTCPSchedulerParams::RTCPSchedulerParams() : mininterval(RTCP_DEFAULTMININTERVAL
 	senderfraction = RTCP_DEFAULTSENDERFRACTION;
 	usehalfatstartup = RTCP_DEFAULTHALFATSTARTUP;
 	immediatebye = RTCP_DEFAULTIMMEDIATEBYE;
+	useavpf = RTCP_DEFAULTUSEAVPF;
+	trrinterval = RTPTime(0,0);
 }
 
 RTCPSchedulerParams::~RTCPSchedulerParams()
@@ -47,7 +49,17 @@ int RTCPSchedulerParams::SetMinimumTransmissionInterval(const RTPTime &t)
 	return 0;
 }
 
-RTCPScheduler::RTCPScheduler(RTPSources &s) : sources(s),nextrtcptime(0,0),prevrtcptime(0,0)
+int RTCPSchedulerParams::SetRegularReportMinimumInterval(const RTPTime &t)
+{
+	if (t.GetDouble() < 0.0)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	trrinterval = t;
+	return 0;
+}
+
+RTCPScheduler::RTCPScheduler(RTPSources &s) : sources(s),nextrtcptime(0,0),prevrtcptime(0,0),
+                                               earlyrtcptime(0,0),lastregulartime(0,0),currentrrinterval(0,0)
 {
 	Reset();
 }
@@ -64,6 +76,12 @@ void RTCPScheduler::Reset()
 	avgrtcppacksize = 1000; // 默认RTCP包大小
 	byescheduled = false;
 	sendbyenow = false;
+	allowearly = true;
+	earlyscheduled = false;
+	earlypacket = false;
+	feedbackpending = false;
+	lastregulartime = RTPTime(0,0);
+	currentrrinterval = RTPTime(0,0);
 }
 
 void RTCPScheduler::AnalyseIncoming(RTCPCompoundPacket &rtcpcomppack)
@@ -113,6 +131,7 @@ void RTCPScheduler::AnalyseOutgoing(RTCPCompoundPacket &rtcpcomppack)
 	}
 
 	hassentrtcp = true;
+	feedbackpending = false;
 }
 
 RTPTime RTCPScheduler::GetTransmissionDelay()
@@ -126,16 +145,54 @@ RTPTime RTCPScheduler::GetTransmissionDelay()
 	}
 	
 	RTPTime curtime = RTPTime::CurrentTime();
+	RTPTime sendtime = nextrtcptime;
+
+	if (earlyscheduled && earlyrtcptime < sendtime)
+		sendtime = earlyrtcptime;
 
-	if (curtime > nextrtcptime) // packet should be sent
+	if (curtime > sendtime) // packet should be sent
 		return RTPTime(0,0);
 
-	RTPTime diff = nextrtcptime;
+	RTPTime diff = sendtime;
 	diff -= curtime;
 	
 	return diff;
 }
 
+bool RTCPScheduler::ScheduleEarlyFeedback()
+{
+	if (!schedparams.GetUseAVPF())
+		return false;
+
+	feedbackpending = true;
+
+	if (earlyscheduled)
+		return true;
+	if (!allowearly) // 自上一个常规包以来已经发送过提前的包
+		return false;
+	if (firstcall) // 还没有开始调度，第一个包会立即计算
+		return false;
+
+	RTPTime curtime = RTPTime::CurrentTime();
+
+	// 在两个成员的单播会话中不需要抖动（参见 rfc 4585 3.5.2）
+	double trr = nextrtcptime.GetDouble()-prevrtcptime.GetDouble();
+	double tdithermax = 0;
+
+	if (sources.GetActiveMemberCount() > 2)
+		tdithermax = RTCP_AVPF_DITHERFACTOR*trr;
+
+	RTPTime te = curtime;
+	te += RTPTime(RTPGenerateRandomDouble()*tdithermax);
+
+	if (te >= nextrtcptime) // 常规包会更早发送，反馈将随其一起发送
+		return true;
+
+	earlyscheduled = true;
+	earlyrtcptime = te;
+	return true;
+}
+
 bool RTCPScheduler::IsTime()
 {
 	if (firstcall)
@@ -149,6 +206,25 @@ bool RTCPScheduler::IsTime()
 
 	RTPTime currenttime = RTPTime::CurrentTime();
 
+	earlypacket = false;
+
+	if (earlyscheduled && !byescheduled && earlyrtcptime <= currenttime && currenttime < nextrtcptime)
+	{
+		// 发送提前的反馈包：它占用下一个常规包的带宽份额，因此下一个
+		// 常规包推迟一个间隔 T_rr（参见 rfc 4585 3.5.2）
+		
+		RTPTime trr = nextrtcptime;
+		trr -= prevrtcptime;
+
+		prevrtcptime += trr;
+		nextrtcptime += trr;
+		
+		earlyscheduled = false;
+		allowearly = false;
+		earlypacket = true;
+		return true;
+	}
+
 //	double diff = nextrtcptime.GetDouble() - currenttime.GetDouble();
 //
 //	std::cout << "Delay till next RTCP interval: " << diff << std::endl;
@@ -177,10 +253,32 @@ bool RTCPScheduler::IsTime()
 	
 	if (checktime <= currenttime) // Okay
 	{
+		bool wasbye = byescheduled;
+
 		byescheduled = false;
 		prevrtcptime = currenttime;
 		pmembers = sources.GetActiveMemberCount();
 		CalculateNextRTCPTime();
+
+		if (schedparams.GetUseAVPF() && !wasbye)
+		{
+			earlyscheduled = false;
+			allowearly = true;
+
+			// 在 T_rr_interval 内不携带反馈的常规包被抑制（参见 rfc 4585 3.5.3）
+			if (!feedbackpending && !lastregulartime.IsZero())
+			{
+				RTPTime elapsed = currenttime;
+				elapsed -= lastregulartime;
+				if (elapsed < currentrrinterval)
+					return false;
+			}
+
+			double mul = RTPGenerateRandomDouble()+0.5;
+
+			lastregulartime = currenttime;
+			currentrrinterval = RTPTime(schedparams.GetRegularReportMinimumInterval().GetDouble()*mul);
+		}
 		return true;
 	}
 
@@ -205,6 +303,11 @@ void RTCPScheduler::CalculateNextRTCPTime()
 }
 
 RTPTime RTCPScheduler::CalculateDeterministicInterval(bool sender /* = false */)
+{
+	return CalculateDeterministicInterval(sender,false);
+}
+
+RTPTime RTCPScheduler::CalculateDeterministicInterval(bool sender,bool avpftiming)
 {
 	int numsenders = sources.GetSenderCount();
 	int numtotal = sources.GetActiveMemberCount();
@@ -245,6 +348,11 @@ RTPTime RTCPScheduler::CalculateDeterministicInterval(bool sender /* = false */)
 	if (!hassentrtcp && schedparams.GetUseHalfAtStartup())
 		tmin /= 2.0;
 
+	// AVPF：第一个包使用 1 秒，之后最小间隔为 0（参见 rfc 4585 3.4）
+	// 注意超时计算仍使用常规的最小间隔
+	if (avpftiming)
+		tmin = (hassentrtcp)?0.0:RTCP_AVPF_INITIALMININTERVAL;
+
 	double ntimesC = n*C;
 	double Td = (tmin>ntimesC)?tmin:ntimesC;
 
@@ -255,7 +363,7 @@ RTPTime RTCPScheduler::CalculateDeterministicInterval(bool sender /* = false */)
 
 RTPTime RTCPScheduler::CalculateTransmissionInterval(bool sender)
 {
-	RTPTime Td = CalculateDeterministicInterval(sender);
+	RTPTime Td = CalculateDeterministicInterval(sender,schedparams.GetUseAVPF());
 	double td,mul,T;
 
 //	std::cout << "CalculateTransmissionInterval" << std::endl;
@@ -54,12 +54,32 @@ public:
    */
   bool GetRequestImmediateBYE() const { return immediatebye; }
 
+  /** 如果 \c v 为 \c true，调度器将按照 RFC 4585（AVPF）的时序规则工作。
+   *  如果 \c v 为 \c true，调度器将按照 RFC 4585（AVPF）的时序规则工作：
+   *  第一个 RTCP 包之后最小间隔为 0，并允许提前发送包含反馈信息的 RTCP 包。
+   */
+  void SetUseAVPF(bool v) { useavpf = v; }
+
+  /** 返回调度器是否使用 AVPF 时序规则（默认为 \c false）。 */
+  bool GetUseAVPF() const { return useavpf; }
+
+  /** 设置 AVPF 模式下常规 RTCP 包之间的最小间隔（T_rr_interval）为 \c t。
+   *  设置 AVPF 模式下常规 RTCP 包之间的最小间隔（T_rr_interval）为 \c t。
+   *  在此间隔内到期且不携带反馈信息的常规 RTCP 包将被抑制。
+   */
+  int SetRegularReportMinimumInterval(const RTPTime &t);
+
+  /** 返回 AVPF 模式下常规 RTCP 包之间的最小间隔（默认为 0，即不抑制）。 */
+  RTPTime GetRegularReportMinimumInterval() const { return trrinterval; }
+
 private:
   double bandwidth;
   double senderfraction;
   RTPTime mininterval;
   bool usehalfatstartup;
   bool immediatebye;
+  bool useavpf;
+  RTPTime trrinterval;
 };
 
 /** 此类确定何时应该发送 RTCP 复合包。 */
@@ -107,6 +127,14 @@ public:
    */
   RTPTime GetTransmissionDelay();
 
+  /** 请求尽早发送包含反馈信息的 RTCP 复合包（RFC 4585 第 3.5.2 节）。
+   *  请求尽早发送包含反馈信息的 RTCP 复合包（RFC 4585 第 3.5.2 节）。如果反馈
+   *  将通过提前的 RTCP 包或即将到来的常规 RTCP 包发送，函数返回 \c true；
+   *  如果自上一个常规 RTCP 包以来已经发送过提前的包（allow_early 为 false），
+   *  或者未启用 AVPF 模式，反馈必须等待下一个常规 RTCP 包，函数返回 \c false。
+   */
+  bool ScheduleEarlyFeedback();
+
   /** 如果到了发送 RTCP 复合包的时间，此函数返回 \c true，否则返回 \c false。
    *  如果到了发送 RTCP 复合包的时间，此函数返回 \c true，否则返回 \c false。
    *  如果函数返回 \c
@@ -120,11 +148,15 @@ public:
    */
   RTPTime CalculateDeterministicInterval(bool sender = false);
 
+  /** 如果最近一次 IsTime 返回 \c true 是由于提前的反馈包，则返回 \c true。 */
+  bool IsEarlyPacket() const { return earlypacket; }
+
 private:
   void CalculateNextRTCPTime();
   void PerformReverseReconsideration();
   RTPTime CalculateBYETransmissionInterval();
   RTPTime CalculateTransmissionInterval(bool sender);
+  RTPTime CalculateDeterministicInterval(bool sender, bool avpftiming);
 
   RTPSources &sources;
   RTCPSchedulerParams schedparams;
@@ -141,6 +173,15 @@ private:
   int byemembers, pbyemembers;
   size_t avgbyepacketsize;
   bool sendbyenow;
+
+  // 用于 AVPF 提前反馈调度（RFC 4585）
+  bool allowearly;
+  bool earlyscheduled;
+  bool earlypacket;
+  bool feedbackpending;
+  RTPTime earlyrtcptime;
+  RTPTime lastregulartime;
+  RTPTime currentrrinterval;
 };
 
 #endif // RTCPSCHEDULER_H
@@ -0,0 +1,389 @@
+#include "media_rtp_congestion_controller.h"
+#include "media_rtp_transport_cc.h"
+#include <math.h>
+
+// 发送时间相差不超过5毫秒的数据包属于同一分组
+#define RTP_CC_GROUPINTERVAL							5000
+#define RTP_CC_SMOOTHINGCOEFFICIENT						0.9
+#define RTP_CC_THRESHOLDGAIN							4.0
+#define RTP_CC_MAXDELTAS							60
+#define RTP_CC_INITIALTHRESHOLD							12.5
+#define RTP_CC_OVERUSETIMETHRESHOLD						10.0
+#define RTP_CC_ACKWINDOW							500000
+#define RTP_CC_DEFAULTRTT							100000
+
+static inline int64_t RTPCCMicroSeconds(const RTPTime &t)
+{
+	return t.GetSeconds()*1000000+(int64_t)t.GetMicroSeconds();
+}
+
+void RTPCongestionController::OnPacketSent(uint16_t,size_t,const RTPTime &)
+{
+}
+
+void RTPCongestionController::OnTransportFeedback(const RTPTransportCCFeedback &,const RTPTime &)
+{
+}
+
+void RTPCongestionController::OnREMB(uint64_t,const RTPTime &)
+{
+}
+
+void RTPCongestionController::OnReceiverReport(double,const RTPTime &,const RTPTime &)
+{
+}
+
+RTPDelayBasedController::RTPDelayBasedController(double initialbitrate,double minbitrate,double maxbitrate)
+{
+	if (maxbitrate < minbitrate)
+		maxbitrate = minbitrate;
+	if (initialbitrate < minbitrate)
+		initialbitrate = minbitrate;
+	if (initialbitrate > maxbitrate)
+		initialbitrate = maxbitrate;
+
+	RTPDelayBasedController::minbitrate = minbitrate;
+	RTPDelayBasedController::maxbitrate = maxbitrate;
+	targetbitrate = initialbitrate;
+	delaybitrate = initialbitrate;
+	lossbitrate = initialbitrate;
+	rembbitrate = 0;
+
+	for (int i = 0 ; i < RTP_CC_SENDHISTORYSIZE ; i++)
+		history[i].used = false;
+
+	havegroup = false;
+	haveprevgroup = false;
+	groupfirstsend = grouplastsend = grouplastarrival = 0;
+	prevgroupsend = prevgrouparrival = 0;
+
+	numdeltas = 0;
+	firstarrival = 0;
+	accumulateddelay = 0;
+	smootheddelay = 0;
+	trendcount = 0;
+	trendpos = 0;
+
+	usage = Normal;
+	threshold = RTP_CC_INITIALTHRESHOLD;
+	prevtrend = 0;
+	overusetime = -1;
+	overusecount = 0;
+	lastthresholdupdate = -1;
+
+	ackwindowstart = -1;
+	ackbytes = 0;
+	ackedbitrate = 0;
+
+	roundtriptime = RTP_CC_DEFAULTRTT;
+	lastrateupdate = -1;
+	lastdecrease = -1;
+	lastlossupdate = -1;
+	lastlossdecrease = -1;
+}
+
+void RTPDelayBasedController::OnPacketSent(uint16_t transportseqnr,size_t packetlength,const RTPTime &sendtime)
+{
+	SentPacket &p = history[transportseqnr%RTP_CC_SENDHISTORYSIZE];
+
+	p.sendtime = RTPCCMicroSeconds(sendtime);
+	p.length = (uint32_t)packetlength;
+	p.seqnr = transportseqnr;
+	p.used = true;
+}
+
+void RTPDelayBasedController::OnTransportFeedback(const RTPTransportCCFeedback &feedback,const RTPTime &receivetime)
+{
+	int64_t now = RTPCCMicroSeconds(receivetime);
+	int numreceived = 0;
+	int numlost = 0;
+
+	for (int i = 0 ; i < feedback.GetPacketStatusCount() ; i++)
+	{
+		uint16_t seqnr = (uint16_t)(feedback.GetBaseSequenceNumber()+i);
+		SentPacket &p = history[seqnr%RTP_CC_SENDHISTORYSIZE];
+
+		if (!p.used || p.seqnr != seqnr) // 不是我们发送的，或者已经太旧
+			continue;
+
+		p.used = false;
+		if (!feedback.IsReceived(i))
+		{
+			numlost++;
+			continue;
+		}
+
+		int64_t arrivaltime = feedback.GetArrivalTime(i);
+
+		numreceived++;
+		UpdateAcknowledgedBitrate(arrivaltime,p.length);
+		AddToPacketGroup(p.sendtime,arrivaltime);
+	}
+
+	if (numreceived+numlost > 0)
+		UpdateLossBasedBitrate((double)numlost/(double)(numreceived+numlost),now);
+	UpdateDelayBasedBitrate(now);
+	UpdateTargetBitrate();
+}
+
+void RTPDelayBasedController::OnREMB(uint64_t bitrate,const RTPTime &)
+{
+	rembbitrate = (double)bitrate;
+	UpdateTargetBitrate();
+}
+
+void RTPDelayBasedController::OnReceiverReport(double fractionlost,const RTPTime &rtt,const RTPTime &receivetime)
+{
+	if (!rtt.IsZero())
+		roundtriptime = RTPCCMicroSeconds(rtt);
+	UpdateLossBasedBitrate(fractionlost,RTPCCMicroSeconds(receivetime));
+	UpdateTargetBitrate();
+}
+
+void RTPDelayBasedController::AddToPacketGroup(int64_t sendtime,int64_t arrivaltime)
+{
+	if (havegroup)
+	{
+		if (sendtime < groupfirstsend) // 重排序的数据包，忽略
+			return;
+		if (sendtime-groupfirstsend <= RTP_CC_GROUPINTERVAL)
+		{
+			if (sendtime > grouplastsend)
+				grouplastsend = sendtime;
+			if (arrivaltime > grouplastarrival)
+				grouplastarrival = arrivaltime;
+			return;
+		}
+
+		// 当前分组已完整，与前一个分组比较
+		if (haveprevgroup)
+		{
+			double senddelta = (double)(grouplastsend-prevgroupsend)/1000.0;
+			double arrivaldelta = (double)(grouplastarrival-prevgrouparrival)/1000.0;
+
+			UpdateTrendline(arrivaldelta-senddelta,senddelta,grouplastarrival);
+		}
+		prevgroupsend = grouplastsend;
+		prevgrouparrival = grouplastarrival;
+		haveprevgroup = true;
+	}
+
+	havegroup = true;
+	groupfirstsend = sendtime;
+	grouplastsend = sendtime;
+	grouplastarrival = arrivaltime;
+}
+
+void RTPDelayBasedController::UpdateTrendline(double delaydelta,double senddelta,int64_t arrivaltime)
+{
+	if (numdeltas == 0)
+		firstarrival = arrivaltime;
+	if (numdeltas < 1000)
+		numdeltas++;
+
+	accumulateddelay += delaydelta;
+	smootheddelay = RTP_CC_SMOOTHINGCOEFFICIENT*smootheddelay+(1.0-RTP_CC_SMOOTHINGCOEFFICIENT)*accumulateddelay;
+
+	trendx[trendpos] = (double)(arrivaltime-firstarrival)/1000.0;
+	trendy[trendpos] = smootheddelay;
+	trendpos = (trendpos+1)%RTP_CC_TRENDLINEWINDOW;
+	if (trendcount < RTP_CC_TRENDLINEWINDOW)
+		trendcount++;
+
+	double trend = prevtrend;
+
+	if (trendcount == RTP_CC_TRENDLINEWINDOW)
+	{
+		// 最小二乘法拟合延迟随到达时间变化的斜率
+		double meanx = 0, meany = 0;
+
+		for (int i = 0 ; i < trendcount ; i++)
+		{
+			meanx += trendx[i];
+			meany += trendy[i];
+		}
+		meanx /= trendcount;
+		meany /= trendcount;
+
+		double num = 0, denom = 0;
+
+		for (int i = 0 ; i < trendcount ; i++)
+		{
+			num += (trendx[i]-meanx)*(trendy[i]-meany);
+			denom += (trendx[i]-meanx)*(trendx[i]-meanx);
+		}
+		if (denom != 0)
+			trend = num/denom;
+	}
+
+	int n = (numdeltas < RTP_CC_MAXDELTAS)?numdeltas:RTP_CC_MAXDELTAS;
+
+	DetectOveruse(trend,(double)n*trend*RTP_CC_THRESHOLDGAIN,senddelta,arrivaltime);
+}
+
+void RTPDelayBasedController::DetectOveruse(double trend,double modifiedtrend,double senddelta,int64_t arrivaltime)
+{
+	if (numdeltas < 2)
+	{
+		usage = Normal;
+		prevtrend = trend;
+		return;
+	}
+
+	if (modifiedtrend > threshold)
+	{
+		if (overusetime < 0)
+			overusetime = senddelta/2.0;
+		else
+			overusetime += senddelta;
+		overusecount++;
+
+		if (overusetime > RTP_CC_OVERUSETIMETHRESHOLD && overusecount > 1 && trend >= prevtrend)
+		{
+			overusetime = 0;
+			overusecount = 0;
+			usage = Overusing;
+		}
+	}
+	else if (modifiedtrend < -threshold)
+	{
+		overusetime = -1;
+		overusecount = 0;
+		usage = Underusing;
+	}
+	else
+	{
+		overusetime = -1;
+		overusecount = 0;
+		usage = Normal;
+	}
+	prevtrend = trend;
+
+	// 自适应阈值，避免与基于丢包的TCP流竞争时饿死
+	double absmodified = fabs(modifiedtrend);
+
+	if (lastthresholdupdate < 0)
+		lastthresholdupdate = arrivaltime;
+	if (absmodified > threshold+15.0)
+	{
+		lastthresholdupdate = arrivaltime;
+		return;
+	}
+
+	double k = (absmodified < threshold)?0.039:0.0087;
+	double dt = (double)(arrivaltime-lastthresholdupdate)/1000.0;
+
+	if (dt > 100.0)
+		dt = 100.0;
+	else if (dt < 0)
+		dt = 0;
+	threshold += k*(absmodified-threshold)*dt;
+	if (threshold < 6.0)
+		threshold = 6.0;
+	else if (threshold > 600.0)
+		threshold = 600.0;
+	lastthresholdupdate = arrivaltime;
+}
+
+void RTPDelayBasedController::UpdateAcknowledgedBitrate(int64_t arrivaltime,uint32_t length)
+{
+	if (ackwindowstart < 0 || arrivaltime < ackwindowstart)
+	{
+		ackwindowstart = arrivaltime;
+		ackbytes = 0;
+	}
+	else if (arrivaltime-ackwindowstart >= RTP_CC_ACKWINDOW)
+	{
+		double bitrate = (double)ackbytes*8.0*1000000.0/(double)(arrivaltime-ackwindowstart);
+
+		if (ackedbitrate == 0)
+			ackedbitrate = bitrate;
+		else
+			ackedbitrate = 0.5*ackedbitrate+0.5*bitrate;
+		ackwindowstart = arrivaltime;
+		ackbytes = 0;
+	}
+	ackbytes += length;
+}
+
+void RTPDelayBasedController::UpdateDelayBasedBitrate(int64_t now)
+{
+	double dt = (lastrateupdate < 0)?0:(double)(now-lastrateupdate)/1000000.0;
+
+	lastrateupdate = now;
+	if (dt > 1.0)
+		dt = 1.0;
+	else if (dt < 0)
+		dt = 0;
+
+	switch (usage)
+	{
+	case Overusing:
+		// 两次降低之间至少间隔一个往返时间
+		if (lastdecrease < 0 || now-lastdecrease >= roundtriptime+RTP_CC_DEFAULTRTT)
+		{
+			double base = (ackedbitrate > 0)?ackedbitrate:delaybitrate;
+
+			if (0.85*base < delaybitrate)
+				delaybitrate = 0.85*base;
+			lastdecrease = now;
+		}
+		break;
+	case Underusing: // 队列正在排空，保持码率
+		break;
+	case Normal:
+		delaybitrate *= pow(1.08,dt);
+
+		// 不要超出实际能够送达的码率太多
+		if (ackedbitrate > 0 && delaybitrate > 1.5*ackedbitrate+10000.0)
+			delaybitrate = 1.5*ackedbitrate+10000.0;
+		break;
+	}
+
+	if (delaybitrate < minbitrate)
+		delaybitrate = minbitrate;
+	else if (delaybitrate > maxbitrate)
+		delaybitrate = maxbitrate;
+}
+
+void RTPDelayBasedController::UpdateLossBasedBitrate(double fractionlost,int64_t now)
+{
+	double dt = (lastlossupdate < 0)?0:(double)(now-lastlossupdate)/1000000.0;
+
+	lastlossupdate = now;
+	if (dt > 1.0)
+		dt = 1.0;
+	else if (dt < 0)
+		dt = 0;
+
+	if (fractionlost > 0.1)
+	{
+		if (lastlossdecrease < 0 || now-lastlossdecrease >= roundtriptime+RTP_CC_DEFAULTRTT)
+		{
+			lossbitrate = targetbitrate*(1.0-0.5*fractionlost);
+			lastlossdecrease = now;
+		}
+	}
+	else if (fractionlost < 0.02)
+		lossbitrate *= pow(1.08,dt);
+
+	if (lossbitrate < minbitrate)
+		lossbitrate = minbitrate;
+	else if (lossbitrate > maxbitrate)
+		lossbitrate = maxbitrate;
+}
+
+void RTPDelayBasedController::UpdateTargetBitrate()
+{
+	double bitrate = delaybitrate;
+
+	if (lossbitrate < bitrate)
+		bitrate = lossbitrate;
+	if (rembbitrate > 0 && rembbitrate < bitrate)
+		bitrate = rembbitrate;
+	if (bitrate < minbitrate)
+		bitrate = minbitrate;
+	else if (bitrate > maxbitrate)
+		bitrate = maxbitrate;
+	targetbitrate = bitrate;
+}
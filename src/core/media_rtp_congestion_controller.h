@@ -0,0 +1,131 @@
+/**
+ * \file media_rtp_congestion_controller.h
+ */
+
+#ifndef RTPCONGESTIONCONTROLLER_H
+
+#define RTPCONGESTIONCONTROLLER_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_utils.h"
+#include <stdint.h>
+#include <stddef.h>
+
+class RTPTransportCCFeedback;
+
+/** 发送端拥塞控制器的接口。
+ *  会话在发送带有传输层序列号的数据包、收到transport-cc反馈、REMB以及关于本地SSRC的
+ *  接收报告时调用相应的函数，应用程序通过 RTPSession::GetTargetBitrate 读取控制器给出的
+ *  目标码率。所有时间都由调用者给出，因此控制器可以在模拟中以确定的方式运行。
+ *  默认实现不做任何处理，派生类只需重写需要的函数。
+ */
+class RTPCongestionController
+{
+public:
+	virtual ~RTPCongestionController()									{ }
+
+	/** 在 \c sendtime 发送了传输层序列号为 \c transportseqnr、长度为 \c packetlength 的数据包。 */
+	virtual void OnPacketSent(uint16_t transportseqnr,size_t packetlength,const RTPTime &sendtime);
+
+	/** 在 \c receivetime 收到了transport-cc反馈 \c feedback。 */
+	virtual void OnTransportFeedback(const RTPTransportCCFeedback &feedback,const RTPTime &receivetime);
+
+	/** 在 \c receivetime 收到了估计最大码率为 \c bitrate（比特每秒）的REMB。 */
+	virtual void OnREMB(uint64_t bitrate,const RTPTime &receivetime);
+
+	/** 在 \c receivetime 收到了关于本地SSRC的接收报告，丢失比例为 \c fractionlost（0到1），
+	 *  往返时间为 \c roundtriptime（无法计算时为零）。
+	 */
+	virtual void OnReceiverReport(double fractionlost,const RTPTime &roundtriptime,const RTPTime &receivetime);
+
+	/** 返回目标码率（比特每秒）。 */
+	virtual double GetTargetBitrate() const = 0;
+};
+
+/** 基于延迟梯度的拥塞控制器，算法与GCC（draft-ietf-rmcat-gcc-02）类似。
+ *  按发送时间将数据包分组，由相邻分组的到达时间差与发送时间差之差的累积值经线性回归
+ *  得到延迟趋势；趋势超过自适应阈值时判定为过载并将码率降到已确认码率的85%，否则按
+ *  每秒8%的速度增加码率（AIMD）。另外根据反馈和接收报告中的丢包率计算基于丢包的码率，
+ *  目标码率取基于延迟的码率、基于丢包的码率和REMB中的最小值。
+ */
+class RTPDelayBasedController : public RTPCongestionController
+{
+public:
+	/** 网络状态。 */
+	enum BandwidthUsage
+	{
+		Normal,		/**< 队列延迟稳定。 */
+		Overusing,	/**< 队列延迟在增加。 */
+		Underusing	/**< 队列延迟在减少。 */
+	};
+
+	/** 构造一个初始码率为 \c initialbitrate 的控制器，目标码率限制在 \c minbitrate 和 \c maxbitrate 之间。 */
+	RTPDelayBasedController(double initialbitrate = RTP_DEFAULTINITIALBITRATE,
+	                        double minbitrate = RTP_DEFAULTMINIMUMBITRATE,
+	                        double maxbitrate = RTP_DEFAULTMAXIMUMBITRATE);
+
+	void OnPacketSent(uint16_t transportseqnr,size_t packetlength,const RTPTime &sendtime);
+	void OnTransportFeedback(const RTPTransportCCFeedback &feedback,const RTPTime &receivetime);
+	void OnREMB(uint64_t bitrate,const RTPTime &receivetime);
+	void OnReceiverReport(double fractionlost,const RTPTime &roundtriptime,const RTPTime &receivetime);
+	double GetTargetBitrate() const										{ return targetbitrate; }
+
+	/** 返回基于延迟的码率（比特每秒）。 */
+	double GetDelayBasedBitrate() const									{ return delaybitrate; }
+
+	/** 返回基于丢包的码率（比特每秒）。 */
+	double GetLossBasedBitrate() const									{ return lossbitrate; }
+
+	/** 返回根据反馈估计的接收端实际收到的码率（比特每秒），尚无估计时为零。 */
+	double GetAcknowledgedBitrate() const									{ return ackedbitrate; }
+
+	/** 返回过载检测器的当前状态。 */
+	BandwidthUsage GetBandwidthUsage() const								{ return usage; }
+private:
+	class SentPacket
+	{
+	public:
+		int64_t sendtime;
+		uint32_t length;
+		uint16_t seqnr;
+		bool used;
+	};
+
+	void AddToPacketGroup(int64_t sendtime,int64_t arrivaltime);
+	void UpdateTrendline(double delaydelta,double senddelta,int64_t arrivaltime);
+	void DetectOveruse(double trend,double modifiedtrend,double senddelta,int64_t arrivaltime);
+	void UpdateAcknowledgedBitrate(int64_t arrivaltime,uint32_t length);
+	void UpdateDelayBasedBitrate(int64_t now);
+	void UpdateLossBasedBitrate(double fractionlost,int64_t now);
+	void UpdateTargetBitrate();
+
+	double minbitrate, maxbitrate;
+	double targetbitrate, delaybitrate, lossbitrate, rembbitrate;
+
+	SentPacket history[RTP_CC_SENDHISTORYSIZE];
+
+	bool havegroup, haveprevgroup;
+	int64_t groupfirstsend, grouplastsend, grouplastarrival;
+	int64_t prevgroupsend, prevgrouparrival;
+
+	int numdeltas;
+	int64_t firstarrival;
+	double accumulateddelay, smootheddelay;
+	double trendx[RTP_CC_TRENDLINEWINDOW], trendy[RTP_CC_TRENDLINEWINDOW];
+	int trendcount, trendpos;
+
+	BandwidthUsage usage;
+	double threshold, prevtrend, overusetime;
+	int overusecount;
+	int64_t lastthresholdupdate;
+
+	int64_t ackwindowstart;
+	uint64_t ackbytes;
+	double ackedbitrate;
+
+	int64_t roundtriptime;
+	int64_t lastrateupdate, lastdecrease, lastlossupdate, lastlossdecrease;
+};
+
+#endif // RTPCONGESTIONCONTROLLER_H
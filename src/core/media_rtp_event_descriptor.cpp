@@ -0,0 +1,90 @@
+#include "media_rtp_event_descriptor.h"
+#include "media_rtp_utils.h"
+#include "media_rtp_errors.h"
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef RTP_HAVE_EVENTFD
+	#include <sys/eventfd.h>
+#endif // RTP_HAVE_EVENTFD
+
+RTPEventDescriptor::RTPEventDescriptor()
+{
+	m_descriptors[0] = RTPSOCKERR;
+	m_descriptors[1] = RTPSOCKERR;
+	m_init = false;
+}
+
+RTPEventDescriptor::~RTPEventDescriptor()
+{
+	Destroy();
+}
+
+int RTPEventDescriptor::Init()
+{
+	if (m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+#ifdef RTP_HAVE_EVENTFD
+	// 同一个 eventfd 既用于读也用于写
+	m_descriptors[0] = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+	if (m_descriptors[0] < 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	m_descriptors[1] = m_descriptors[0];
+#else
+	if (pipe(m_descriptors) < 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+
+	// 信号很多时写入端不能阻塞
+	for (int i = 0 ; i < 2 ; i++)
+		fcntl(m_descriptors[i],F_SETFL,fcntl(m_descriptors[i],F_GETFL)|O_NONBLOCK);
+#endif // RTP_HAVE_EVENTFD
+
+	m_init = true;
+	return 0;
+}
+
+void RTPEventDescriptor::Destroy()
+{
+	if (!m_init)
+		return;
+
+	if (m_descriptors[1] != m_descriptors[0])
+		close(m_descriptors[1]);
+	close(m_descriptors[0]);
+	m_descriptors[0] = RTPSOCKERR;
+	m_descriptors[1] = RTPSOCKERR;
+
+	m_init = false;
+}
+
+int RTPEventDescriptor::Signal()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	uint64_t value = 1;
+
+	// 管道已满或计数器已达上限时描述符本来就是可读的，忽略错误
+	if (write(m_descriptors[1],&value,sizeof(value)))
+	{
+		// 为了消除与 __wur 相关的编译器警告
+	}
+	return 0;
+}
+
+int RTPEventDescriptor::Clear()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	// eventfd 一次读取就会把计数器清零；管道则读到没有数据为止
+	uint64_t buf[16];
+
+	while (read(m_descriptors[0],buf,sizeof(buf)) > 0)
+	{
+#ifdef RTP_HAVE_EVENTFD
+		break;
+#endif // RTP_HAVE_EVENTFD
+	}
+	return 0;
+}
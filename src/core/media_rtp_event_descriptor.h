@@ -0,0 +1,46 @@
+/**
+ * \file media_rtp_event_descriptor.h
+ */
+
+#ifndef RTPEVENTDESCRIPTOR_H
+
+#define RTPEVENTDESCRIPTOR_H
+
+#include "rtpconfig.h"
+
+/**
+ * 可以放入应用程序自己的'select'、'poll'或'epoll'中等待的事件描述符。
+ *
+ * 系统支持时使用eventfd，否则使用非阻塞的管道。Signal 使描述符变为可读，
+ * 无论调用了多少次，一次 Clear 都会使它重新变为不可读。
+ */
+class RTPEventDescriptor {
+  MEDIA_RTP_NO_COPY(RTPEventDescriptor)
+public:
+  RTPEventDescriptor();
+  ~RTPEventDescriptor();
+
+  /** 初始化此实例。 */
+  int Init();
+
+  /** 反初始化此实例。 */
+  void Destroy();
+
+  /** 返回指示此实例是否已初始化的标志。 */
+  bool IsInitialized() const { return m_init; }
+
+  /** 返回可以等待其变为可读的描述符。 */
+  int GetDescriptor() const { return m_descriptors[0]; }
+
+  /** 使描述符变为可读。 */
+  int Signal();
+
+  /** 清除信号。 */
+  int Clear();
+
+private:
+  int m_descriptors[2];
+  bool m_init;
+};
+
+#endif // RTPEVENTDESCRIPTOR_H
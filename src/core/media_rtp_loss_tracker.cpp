@@ -0,0 +1,173 @@
+#include "media_rtp_loss_tracker.h"
+#include <string.h>
+
+RTPLossTracker::RTPLossTracker()
+{
+	Reset();
+}
+
+void RTPLossTracker::Reset()
+{
+	init = false;
+	highestseqnr = 0;
+	memset(received,0xff,sizeof(received));
+	memset(retries,0,sizeof(retries));
+	nummissing = 0;
+	numlost = 0;
+	numrecovered = 0;
+	numunrecovered = 0;
+	numnackrequests = 0;
+}
+
+void RTPLossTracker::SetReceived(uint32_t extseqnr,bool r)
+{
+	uint32_t i = extseqnr%RTP_LOSSTRACKER_WINDOWSIZE;
+	uint64_t bit = ((uint64_t)1)<<(i%64);
+
+	if (r)
+		received[i/64] |= bit;
+	else
+		received[i/64] &= ~bit;
+}
+
+void RTPLossTracker::ProcessPacket(uint32_t extseqnr)
+{
+	if (!init)
+	{
+		// 第一个数据包之前的位置不算作丢失
+		init = true;
+		highestseqnr = extseqnr;
+		return;
+	}
+
+	if (extseqnr > highestseqnr)
+	{
+		uint32_t diff = extseqnr-highestseqnr;
+
+		if (diff > RTP_LOSSTRACKER_WINDOWSIZE)
+		{
+			// 跳过的数据包不会进入窗口，无法再请求重传
+			uint32_t skipped = diff-RTP_LOSSTRACKER_WINDOWSIZE;
+
+			numlost += skipped;
+			numunrecovered += skipped+nummissing;
+			nummissing = 0;
+			memset(received,0xff,sizeof(received));
+			highestseqnr = extseqnr-RTP_LOSSTRACKER_WINDOWSIZE;
+			diff = RTP_LOSSTRACKER_WINDOWSIZE;
+		}
+
+		uint32_t s = highestseqnr;
+		for (uint32_t k = 0 ; k < diff ; k++)
+		{
+			s++;
+
+			// 新位置与移出窗口的位置 s-RTP_LOSSTRACKER_WINDOWSIZE 共用同一个槽位
+			if (!IsReceived(s))
+			{
+				numunrecovered++;
+				nummissing--;
+			}
+
+			if (s == extseqnr)
+				SetReceived(s,true);
+			else
+			{
+				uint32_t i = s%RTP_LOSSTRACKER_WINDOWSIZE;
+
+				SetReceived(s,false);
+				retries[i] = 0;
+				lastnacktime[i] = RTPTime(0,0);
+				numlost++;
+				nummissing++;
+			}
+		}
+		highestseqnr = extseqnr;
+	}
+	else if (highestseqnr-extseqnr < RTP_LOSSTRACKER_WINDOWSIZE)
+	{
+		// 迟到或重传的数据包填补了空洞；重复的数据包被忽略
+		if (!IsReceived(extseqnr))
+		{
+			SetReceived(extseqnr,true);
+			nummissing--;
+			numrecovered++;
+		}
+	}
+}
+
+int RTPLossTracker::GetNACKList(const RTPTime &currenttime,const RTPTime &rtt,int maxretries,uint16_t *seqnrs,int maxcount)
+{
+	if (!init || nummissing == 0)
+		return 0;
+
+	int num = 0;
+	uint32_t s = highestseqnr-(RTP_LOSSTRACKER_WINDOWSIZE-1);
+
+	// 从最早的位置开始扫描，整字全部收到时一次跳过64个位置
+	for (uint32_t k = 0 ; k < RTP_LOSSTRACKER_WINDOWSIZE && num < maxcount ; k++,s++)
+	{
+		uint32_t i = s%RTP_LOSSTRACKER_WINDOWSIZE;
+
+		if (i%64 == 0 && received[i/64] == ~((uint64_t)0))
+		{
+			k += 63;
+			s += 63;
+			continue;
+		}
+		if (IsReceived(s) || (int)retries[i] >= maxretries || retries[i] == 0xff)
+			continue;
+		if (retries[i] > 0)
+		{
+			RTPTime nexttime = lastnacktime[i];
+			nexttime += rtt;
+			if (currenttime < nexttime)
+				continue;
+		}
+
+		retries[i]++;
+		lastnacktime[i] = currenttime;
+		seqnrs[num++] = (uint16_t)(s&0xffff);
+		numnackrequests++;
+	}
+	return num;
+}
+
+
+bool RTPLossTracker::GetNextNACKTime(const RTPTime &rtt,int maxretries,RTPTime *nexttime) const
+{
+	if (!init || nummissing == 0)
+		return false;
+
+	bool found = false;
+	uint32_t s = highestseqnr-(RTP_LOSSTRACKER_WINDOWSIZE-1);
+
+	for (uint32_t k = 0 ; k < RTP_LOSSTRACKER_WINDOWSIZE ; k++,s++)
+	{
+		uint32_t i = s%RTP_LOSSTRACKER_WINDOWSIZE;
+
+		if (i%64 == 0 && received[i/64] == ~((uint64_t)0))
+		{
+			k += 63;
+			s += 63;
+			continue;
+		}
+		if (IsReceived(s) || (int)retries[i] >= maxretries || retries[i] == 0xff)
+			continue;
+		if (retries[i] == 0)
+		{
+			*nexttime = RTPTime(0,0);
+			return true;
+		}
+
+		RTPTime t = lastnacktime[i];
+
+		t += rtt;
+		if (!found || t < *nexttime)
+		{
+			*nexttime = t;
+			found = true;
+		}
+	}
+	return found;
+}
@@ -0,0 +1,74 @@
+/**
+ * \file media_rtp_loss_tracker.h
+ */
+
+#ifndef RTPLOSSTRACKER_H
+
+#define RTPLOSSTRACKER_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_utils.h"
+#include <stdint.h>
+
+/** 跟踪单个源的丢包情况并生成NACK请求。
+ *  最近 RTP_LOSSTRACKER_WINDOWSIZE 个扩展序列号的接收状态保存在一个位图窗口中，
+ *  每个数据包的处理开销为常数。对窗口中的每个空洞记录已请求的次数和上次请求的时间，
+ *  以便限制重试次数并按往返时间间隔重复请求。
+ */
+class RTPLossTracker
+{
+public:
+	/** 构造一个空的跟踪器。 */
+	RTPLossTracker();
+
+	/** 清除所有状态和计数器。 */
+	void Reset();
+
+	/** 记录收到扩展序列号为 \c extseqnr 的数据包。 */
+	void ProcessPacket(uint32_t extseqnr);
+
+	/** 收集在 \c currenttime 时应请求重传的序列号，最多将 \c maxcount 个存入 \c seqnrs。
+	 *  每个丢失的数据包最多请求 \c maxretries 次，两次请求之间至少间隔 \c rtt。
+	 *  返回存入的序列号数量。
+	 */
+	int GetNACKList(const RTPTime &currenttime,const RTPTime &rtt,int maxretries,uint16_t *seqnrs,int maxcount);
+
+	/** 以与 GetNACKList 相同的规则求出最早可以再次请求的时间并存入 \c nexttime；
+	 *  还没有请求过的数据包可以立即请求，时间为 RTPTime(0,0)。没有可请求的数据包时返回 \c false。
+	 */
+	bool GetNextNACKTime(const RTPTime &rtt,int maxretries,RTPTime *nexttime) const;
+
+	/** 如果窗口中还有未收到的数据包则返回 \c true。 */
+	bool HasMissingPackets() const								{ return nummissing > 0; }
+
+	/** 返回检测到的丢失数据包总数。 */
+	uint32_t GetNumLost() const								{ return numlost; }
+
+	/** 返回检测为丢失但随后收到（例如通过重传）的数据包数量。 */
+	uint32_t GetNumRecovered() const							{ return numrecovered; }
+
+	/** 返回在移出窗口前仍未收到的丢失数据包数量。 */
+	uint32_t GetNumUnrecovered() const							{ return numunrecovered; }
+
+	/** 返回已发出的NACK请求数（按序列号计）。 */
+	uint32_t GetNumNACKRequests() const							{ return numnackrequests; }
+private:
+	bool IsReceived(uint32_t extseqnr) const						{ uint32_t i = extseqnr%RTP_LOSSTRACKER_WINDOWSIZE; return (received[i/64]&(((uint64_t)1)<<(i%64))) != 0; }
+	void SetReceived(uint32_t extseqnr,bool r);
+
+	bool init;
+	uint32_t highestseqnr;
+	uint64_t received[RTP_LOSSTRACKER_WINDOWSIZE/64];
+	uint8_t retries[RTP_LOSSTRACKER_WINDOWSIZE];
+	RTPTime lastnacktime[RTP_LOSSTRACKER_WINDOWSIZE];
+
+	uint32_t nummissing;
+	uint32_t numlost;
+	uint32_t numrecovered;
+	uint32_t numunrecovered;
+	uint32_t numnackrequests;
+};
+
+#endif // RTPLOSSTRACKER_H
+
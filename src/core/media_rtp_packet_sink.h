@@ -0,0 +1,32 @@
+/**
+ * \file media_rtp_packet_sink.h
+ */
+
+#ifndef RTPPACKETSINK_H
+
+#define RTPPACKETSINK_H
+
+#include "rtpconfig.h"
+
+class RTPPacket;
+class RTPSourceData;
+
+/** 以流的方式接收RTP数据包的接口，通过 RTPSession::SetPacketSink 注册。
+ *  注册后，会话在处理收到的数据包时，一旦数据包通过源的验证就直接调用 OnRTPPacket，
+ *  数据包不再放入源的数据包列表，应用程序也不需要用 BeginDataAccess 和 GotoFirstSourceWithData
+ *  等函数遍历源表。OnRTPPacket 在持有会话源表锁时被调用，只应做少量工作，
+ *  不能调用会话中需要源表锁的函数。
+ */
+class RTPPacketSink
+{
+public:
+	virtual ~RTPPacketSink()								{ }
+
+	/** 收到了来自 \c srcdat 的数据包 \c pack；\c isonprobation 为 \c true 表示该源仍处于察看期。
+	 *  \c srcdat 和 \c pack 只在调用期间有效。返回 \c true 表示接收器取得数据包的所有权，
+	 *  以后需要用 RTPSession::DeletePacket 释放它；返回 \c false 时会话在调用返回后删除数据包。
+	 */
+	virtual bool OnRTPPacket(RTPSourceData *srcdat,RTPPacket *pack,bool isonprobation) = 0;
+};
+
+#endif // RTPPACKETSINK_H
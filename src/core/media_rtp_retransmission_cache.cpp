@@ -0,0 +1,284 @@
+#include "media_rtp_retransmission_cache.h"
+#include "media_rtp_structs.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_errors.h"
+#include "media_rtp_packet_factory.h"
+#include <string.h>
+#include <arpa/inet.h>
+
+#define RTPRETRANSMISSIONCACHE_OSNSIZE						2
+
+RTPRetransmissionCache::RTPRetransmissionCache()
+{
+	slots = 0;
+	storage = 0;
+	numslots = 0;
+	slotsize = 0;
+	maxbytes = 0;
+	storedcount = 0;
+	storedbytes = 0;
+	oldestseqnr = 0;
+	newestseqnr = 0;
+}
+
+int RTPRetransmissionCache::Init(size_t nslots,size_t maxpacksize,size_t maxb,const RTPTime &age)
+{
+	if (slots != 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (nslots == 0 || nslots > 65536 || maxpacksize < sizeof(RTPHeader))
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	slots = new Slot[nslots];
+	if (slots == 0)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	storage = new uint8_t[nslots*maxpacksize];
+	if (storage == 0)
+	{
+		delete [] slots;
+		slots = 0;
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	for (size_t i = 0 ; i < nslots ; i++)
+	{
+		slots[i].releaser = 0;
+		slots[i].used = false;
+	}
+	numslots = nslots;
+	slotsize = maxpacksize;
+	maxbytes = maxb;
+	maxage = age;
+	Clear();
+	return 0;
+}
+
+void RTPRetransmissionCache::Destroy()
+{
+	if (slots == 0)
+		return;
+
+	Clear(); // 释放对负载的引用
+	delete [] slots;
+	delete [] storage;
+	slots = 0;
+	storage = 0;
+	numslots = 0;
+	storedcount = 0;
+	storedbytes = 0;
+}
+
+void RTPRetransmissionCache::Clear()
+{
+	for (size_t i = 0 ; i < numslots ; i++)
+	{
+		if (slots[i].used)
+			RemoveSlot(slots[i]);
+	}
+	storedcount = 0;
+	storedbytes = 0;
+	oldestseqnr = 0;
+	newestseqnr = 0;
+}
+
+int RTPRetransmissionCache::StorePacket(const uint8_t *header,size_t headerlen,const uint8_t *payload,size_t payloadlen,
+                                        RTPDataReleaser *releaser,uint8_t *data,const RTPTime &sendtime)
+{
+	size_t packetlen = headerlen+payloadlen;
+
+	if (slots == 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (headerlen < sizeof(RTPHeader) || packetlen > slotsize || packetlen > maxbytes)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	const RTPHeader *hdr = (const RTPHeader *)header;
+	uint16_t seqnr = ntohs(hdr->sequencenumber);
+
+	if (storedcount == 0)
+	{
+		oldestseqnr = seqnr;
+		newestseqnr = seqnr;
+	}
+	else
+	{
+		// 序列号回绕时使用有符号差值判断新旧
+		if ((int16_t)(seqnr-newestseqnr) > 0)
+			newestseqnr = seqnr;
+		else if ((int16_t)(seqnr-oldestseqnr) < 0)
+			oldestseqnr = seqnr;
+	}
+
+	Slot &s = slots[seqnr%numslots];
+	if (s.used)
+		RemoveSlot(s);
+
+	// 淘汰超出字节上限或已过期的最早数据包
+
+	Slot *oldest;
+	while ((oldest = FindOldest()) != 0)
+	{
+		RTPTime limit = sendtime;
+		limit -= maxage;
+
+		if (storedbytes+packetlen <= maxbytes && oldest->sendtime >= limit)
+			break;
+		RemoveSlot(*oldest);
+	}
+
+	uint8_t *dst = storage+(size_t)(&s-slots)*slotsize;
+
+	memcpy(dst,header,headerlen);
+	s.storedlength = headerlen;
+	s.payload = 0;
+	s.releaser = 0;
+	s.data = 0;
+	if (payloadlen > 0)
+	{
+		if (releaser != 0 && releaser->AddDataReference(data))
+		{
+			s.payload = payload;
+			s.releaser = releaser;
+			s.data = data;
+		}
+		else
+		{
+			memcpy(dst+headerlen,payload,payloadlen);
+			s.storedlength = packetlen;
+		}
+	}
+	s.seqnr = seqnr;
+	s.length = packetlen;
+	s.sendtime = sendtime;
+	s.used = true;
+	if (storedcount == 0)
+	{
+		oldestseqnr = seqnr;
+		newestseqnr = seqnr;
+	}
+	storedcount++;
+	storedbytes += packetlen;
+	return 0;
+}
+
+const uint8_t *RTPRetransmissionCache::GetPacket(uint16_t seqnr,const RTPTime &currenttime,size_t *len,
+                                                 const uint8_t **payload,size_t *payloadlen) const
+{
+	if (slots == 0)
+		return 0;
+
+	const Slot &s = slots[seqnr%numslots];
+	if (!s.used || s.seqnr != seqnr)
+		return 0;
+
+	RTPTime limit = currenttime;
+	limit -= maxage;
+	if (s.sendtime < limit)
+		return 0;
+
+	*len = s.storedlength;
+	*payload = s.payload;
+	*payloadlen = s.length-s.storedlength;
+	return storage+(size_t)(&s-slots)*slotsize;
+}
+
+int RTPRetransmissionCache::BuildRTXPacket(uint16_t seqnr,const RTPTime &currenttime,uint8_t rtxpt,uint32_t rtxssrc,uint16_t rtxseqnr,
+                                           uint8_t *buffer,size_t buffersize,size_t *rtxlen) const
+{
+	size_t storedlen, reflen;
+	const uint8_t *ref;
+	const uint8_t *packet = GetPacket(seqnr,currenttime,&storedlen,&ref,&reflen);
+
+	if (packet == 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+
+	// 头部总是完整地存放在槽位中
+	const RTPHeader *hdr = (const RTPHeader *)packet;
+	size_t hdrlen = sizeof(RTPHeader)+sizeof(uint32_t)*(size_t)hdr->csrccount;
+
+	if (hdr->extension)
+	{
+		if (storedlen < hdrlen+sizeof(RTPExtensionHeader))
+			return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+
+		const RTPExtensionHeader *exthdr = (const RTPExtensionHeader *)(packet+hdrlen);
+		hdrlen += sizeof(RTPExtensionHeader)+sizeof(uint32_t)*(size_t)ntohs(exthdr->length);
+	}
+	if (storedlen < hdrlen)
+		return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+
+	size_t storedpayloadlen = storedlen-hdrlen;
+	size_t payloadlen = storedpayloadlen+reflen;
+	if (hdr->padding)
+	{
+		size_t numpadbytes = (reflen > 0) ? (size_t)ref[reflen-1] : (size_t)packet[storedlen-1];
+		if (numpadbytes == 0 || numpadbytes > payloadlen)
+			return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+		payloadlen -= numpadbytes;
+	}
+
+	size_t len = hdrlen+RTPRETRANSMISSIONCACHE_OSNSIZE+payloadlen;
+	if (len > buffersize)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	memcpy(buffer,packet,hdrlen);
+
+	RTPHeader *rtxhdr = (RTPHeader *)buffer;
+	rtxhdr->padding = 0;
+	rtxhdr->payloadtype = rtxpt&127;
+	rtxhdr->sequencenumber = htons(rtxseqnr);
+	rtxhdr->ssrc = htonl(rtxssrc);
+
+	buffer[hdrlen] = (uint8_t)(seqnr>>8);
+	buffer[hdrlen+1] = (uint8_t)(seqnr&0xff);
+
+	// 负载可能一部分在槽位中，其余部分在引用的缓冲区中
+	uint8_t *dst = buffer+hdrlen+RTPRETRANSMISSIONCACHE_OSNSIZE;
+	size_t part = (payloadlen < storedpayloadlen) ? payloadlen : storedpayloadlen;
+
+	memcpy(dst,packet+hdrlen,part);
+	if (payloadlen > part)
+		memcpy(dst+part,ref,payloadlen-part);
+
+	*rtxlen = len;
+	return 0;
+}
+
+RTPRetransmissionCache::Slot *RTPRetransmissionCache::FindOldest()
+{
+	// 从记录的最早序列号开始向前查找第一个仍在缓存中的数据包，最多查找一轮槽位
+
+	size_t i = 0;
+	while (storedcount > 0 && i < numslots)
+	{
+		Slot &s = slots[oldestseqnr%numslots];
+		if (s.used && s.seqnr == oldestseqnr)
+			return &s;
+		if (oldestseqnr == newestseqnr)
+			break;
+		oldestseqnr++;
+		i++;
+	}
+
+	// 序列号跳变时退回到按发送时间查找
+
+	Slot *oldest = 0;
+	for (i = 0 ; storedcount > 0 && i < numslots ; i++)
+	{
+		if (slots[i].used && (oldest == 0 || slots[i].sendtime < oldest->sendtime))
+			oldest = &slots[i];
+	}
+	if (oldest != 0)
+		oldestseqnr = oldest->seqnr;
+	return oldest;
+}
+
+void RTPRetransmissionCache::RemoveSlot(Slot &s)
+{
+	if (s.releaser != 0)
+		s.releaser->ReleaseData(s.data);
+	s.releaser = 0;
+	s.payload = 0;
+	s.used = false;
+	storedcount--;
+	storedbytes -= s.length;
+}
+
@@ -0,0 +1,103 @@
+/**
+ * \file media_rtp_retransmission_cache.h
+ */
+
+#ifndef RTPRETRANSMISSIONCACHE_H
+
+#define RTPRETRANSMISSIONCACHE_H
+
+#include "rtpconfig.h"
+#include "media_rtp_utils.h"
+#include <stddef.h>
+#include <stdint.h>
+
+class RTPDataReleaser;
+
+/** 已发送RTP数据包的重传缓存。
+ *  缓存由固定数量的槽位组成，按序列号取模索引，所有槽位共用一块在 Init 中一次性分配的内存，
+ *  因此存储数据包时不会产生额外的内存分配。转发的数据包只把改写过的头部复制到槽位中，
+ *  负载留在收到的数据包的引用计数缓冲区里，缓存为它持有一个引用直到数据包被淘汰。
+ *  缓存的总字节数（包括引用的负载）和数据包的存放时间都有上限，超出上限时最早的数据包会被淘汰。
+ */
+class RTPRetransmissionCache
+{
+public:
+	/** 构造一个未初始化的实例。 */
+	RTPRetransmissionCache();
+	~RTPRetransmissionCache()							{ Destroy(); }
+
+	/** 初始化缓存：\c numslots 个槽位，每个槽位最多容纳 \c maxpacksize 字节的数据包；
+	 *  缓存数据的总大小不超过 \c maxbytes 字节，存放时间超过 \c maxage 的数据包不再用于重传。
+	 */
+	int Init(size_t numslots,size_t maxpacksize,size_t maxbytes,const RTPTime &maxage);
+
+	/** 释放缓存使用的内存。 */
+	void Destroy();
+
+	/** 如果缓存已初始化则返回 \c true。 */
+	bool IsInitialized() const								{ return slots != 0; }
+
+	/** 清空缓存中的所有数据包并释放对负载的引用，但保留已分配的内存。 */
+	void Clear();
+
+	/** 存储一个刚在时刻 \c sendtime 发送的RTP数据包，序列号从RTP头中读取。 */
+	int StorePacket(const uint8_t *packet,size_t packetlen,const RTPTime &sendtime)		{ return StorePacket(packet,packetlen,0,0,0,0,sendtime); }
+
+	/** 存储一个由头部 \c header 和负载 \c payload 组成、刚在时刻 \c sendtime 发送的RTP数据包，
+	 *  只有头部被复制。负载位于数据 \c data 中，如果 \c releaser 支持共享数据，缓存为 \c data 增加
+	 *  一个引用而不复制负载，否则负载也被复制到槽位中。
+	 */
+	int StorePacket(const uint8_t *header,size_t headerlen,const uint8_t *payload,size_t payloadlen,
+	                RTPDataReleaser *releaser,uint8_t *data,const RTPTime &sendtime);
+
+	/** 查找序列号为 \c seqnr 的数据包；如果数据包不在缓存中或在 \c currenttime 时已过期则返回0。
+	 *  否则返回数据包存放在槽位中的开头部分并将其长度存入 \c len，引用的负载存入 \c payload 和
+	 *  \c payloadlen；整个数据包都在槽位中时 \c payloadlen 为零。
+	 */
+	const uint8_t *GetPacket(uint16_t seqnr,const RTPTime &currenttime,size_t *len,
+	                         const uint8_t **payload,size_t *payloadlen) const;
+
+	/** 按照RFC 4588将序列号为 \c seqnr 的缓存数据包封装为RTX数据包并写入 \c buffer。
+	 *  RTX数据包使用负载类型 \c rtxpt、SSRC \c rtxssrc 和序列号 \c rtxseqnr，
+	 *  负载前添加两字节的原始序列号（OSN），原数据包的填充会被去除。
+	 */
+	int BuildRTXPacket(uint16_t seqnr,const RTPTime &currenttime,uint8_t rtxpt,uint32_t rtxssrc,uint16_t rtxseqnr,
+	                   uint8_t *buffer,size_t buffersize,size_t *rtxlen) const;
+
+	/** 返回当前缓存的数据包数量。 */
+	size_t GetPacketCount() const								{ return storedcount; }
+
+	/** 返回当前缓存的数据总字节数。 */
+	size_t GetByteCount() const								{ return storedbytes; }
+private:
+	class Slot
+	{
+	public:
+		uint16_t seqnr;
+		size_t length; // 整个数据包的长度
+		size_t storedlength; // 存放在槽位中的部分的长度
+		const uint8_t *payload; // 引用的负载，没有时为null
+		RTPDataReleaser *releaser;
+		uint8_t *data;
+		RTPTime sendtime;
+		bool used;
+	};
+
+	Slot *FindOldest();
+	void RemoveSlot(Slot &s);
+
+	Slot *slots;
+	uint8_t *storage;
+	size_t numslots;
+	size_t slotsize;
+	size_t maxbytes;
+	RTPTime maxage;
+
+	size_t storedcount;
+	size_t storedbytes;
+	uint16_t oldestseqnr;
+	uint16_t newestseqnr;
+};
+
+#endif // RTPRETRANSMISSIONCACHE_H
+
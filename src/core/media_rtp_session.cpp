@@ -4,7 +4,12 @@
 #include "media_rtp_udpv4_transmitter.h"
 #include "media_rtp_udpv6_transmitter.h"
 #include "media_rtp_tcp_transmitter.h"
+#include "media_rtp_loopback_transmitter.h"
+#include "media_rtp_shm_transmitter.h"
+#include "media_rtp_unix_transmitter.h"
+#include "media_rtp_bundle_transmitter.h"
 #include "media_rtp_session_params.h"
+#include "media_rtp_source_data.h"
 #include "media_rtp_defines.h"
 #include "media_rtp_packet_factory.h"
 #include "media_rtp_utils.h"
@@ -32,6 +37,11 @@ RTPSession::RTPSession()
 	m_changeIncomingData = false;
 	m_changeOutgoingData = false;
 
+	rtxbuffer = 0;
+	transportccrecorder = 0;
+	congestioncontroller = 0;
+	deletecongestioncontroller = false;
+	packetsink = 0;
 	created = false;
 }
 
@@ -78,6 +88,18 @@ int RTPSession::Create(const RTPSessionParams &sessparams,const RTPTransmissionP
 	case RTPTransmitter::TCPProto:
 		rtptrans = new RTPTCPTransmitter();
 		break;
+	case RTPTransmitter::LoopbackProto:
+		rtptrans = new RTPLoopbackTransmitter();
+		break;
+	case RTPTransmitter::SharedMemoryProto:
+		rtptrans = new RTPSharedMemoryTransmitter();
+		break;
+	case RTPTransmitter::UnixProto:
+		rtptrans = new RTPUnixTransmitter();
+		break;
+	case RTPTransmitter::BundleProto:
+		rtptrans = new RTPBundleTransmitter();
+		break;
 	default:
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
 	}
@@ -132,6 +154,14 @@ int RTPSession::InternalCreate(const RTPSessionParams &sessparams)
 {
 	int status;
 
+	// 一字节头部扩展的ID只能为1到14
+	if (sessparams.GetUseTransportCC() && (sessparams.GetTransportCCExtensionID() < 1 || sessparams.GetTransportCCExtensionID() > 14))
+	{
+		if (deletetransmitter)
+			delete rtptrans;
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
 	// 初始化数据包构建器
 	
 	if ((status = packetbuilder.Init(maxpacksize)) < 0)
@@ -243,8 +273,18 @@ int RTPSession::InternalCreate(const RTPSessionParams &sessparams)
 		rtcpbuilder.Destroy();
 		return status;
 	}
+	if ((status = schedparams.SetRegularReportMinimumInterval(sessparams.GetRegularRTCPMinimumInterval())) < 0)
+	{
+		if (deletetransmitter)
+			delete rtptrans;
+		packetbuilder.Destroy();
+		sources.Clear();
+		rtcpbuilder.Destroy();
+		return status;
+	}
 	schedparams.SetUseHalfAtStartup(sessparams.GetUseHalfRTCPIntervalAtStartup());
 	schedparams.SetRequestImmediateBYE(sessparams.GetRequestImmediateBYE());
+	schedparams.SetUseAVPF(sessparams.GetUseAVPF());
 	
 	rtcpsched.SetParameters(schedparams);
 
@@ -257,6 +297,108 @@ int RTPSession::InternalCreate(const RTPSessionParams &sessparams)
 	collisionmultiplier = sessparams.GetCollisionTimeoutMultiplier();
 	notemultiplier = sessparams.GetNoteTimeoutMultiplier();
 
+	// 初始化重传缓存
+
+	rtxbuffersize = 0;
+	if (sessparams.GetRetransmissionCacheSize() > 0)
+	{
+		if ((status = rtxcache.Init(sessparams.GetRetransmissionCacheSize(),maxpacksize,
+		                            sessparams.GetRetransmissionCacheMaxBytes(),
+		                            sessparams.GetRetransmissionCacheMaxAge())) < 0)
+		{
+			if (deletetransmitter)
+				delete rtptrans;
+			packetbuilder.Destroy();
+			sources.Clear();
+			rtcpbuilder.Destroy();
+			return status;
+		}
+
+		// RTX数据包比原数据包多出两字节的原始序列号
+		rtxbuffersize = maxpacksize+2;
+		rtxbuffer = new uint8_t[rtxbuffersize];
+	}
+	// 初始化前向纠错
+
+	if (sessparams.GetUseFEC())
+	{
+		do
+		{
+			fecssrc = RTPGenerateRandom32();
+		} while (sources.GotEntry(fecssrc));
+
+		// 和RTX SSRC一样把FEC SSRC加入源表，以便检测冲突并在RTCP中通告
+		if ((status = fecencoder.Init(maxpacksize,sessparams.GetFECColumns(),sessparams.GetFECRows(),
+		                              sessparams.GetFECPayloadType(),fecssrc)) < 0 ||
+		    (status = fecdecoder.Init(maxpacksize,sessparams.GetFECPayloadType())) < 0 ||
+		    (status = sources.CreateOwnFECSSRC(fecssrc)) < 0)
+		{
+			if (deletetransmitter)
+				delete rtptrans;
+			packetbuilder.Destroy();
+			sources.Clear();
+			rtcpbuilder.Destroy();
+			rtxcache.Destroy();
+			delete [] rtxbuffer;
+			rtxbuffer = 0;
+			fecencoder.Destroy();
+			fecdecoder.Destroy();
+			return status;
+		}
+	}
+
+	usertx = sessparams.GetUseRTX();
+	retransmitonnack = sessparams.GetRetransmitOnNACK();
+	rtxpayloadtype = sessparams.GetRTXPayloadType();
+	do
+	{
+		rtxssrc = RTPGenerateRandom32();
+	} while (sources.GotEntry(rtxssrc));
+	rtxseqnr = RTPGenerateRandom16();
+
+	// 把RTX SSRC加入源表，以便检测冲突并在RTCP中通告
+	if (usertx && rtxcache.IsInitialized())
+	{
+		if ((status = sources.CreateOwnRTXSSRC(rtxssrc)) < 0)
+		{
+			if (deletetransmitter)
+				delete rtptrans;
+			packetbuilder.Destroy();
+			sources.Clear();
+			rtcpbuilder.Destroy();
+			rtxcache.Destroy();
+			delete [] rtxbuffer;
+			rtxbuffer = 0;
+			fecencoder.Destroy();
+			fecdecoder.Destroy();
+			return status;
+		}
+	}
+	generatenacks = sessparams.GetGenerateNACKs();
+	nackmaxretries = sessparams.GetMaximumNACKRetries();
+	usetransportcc = sessparams.GetUseTransportCC();
+	transportccextid = sessparams.GetTransportCCExtensionID();
+	transportccinterval = sessparams.GetTransportCCFeedbackInterval();
+	lasttransportccfeedback = RTPTime(0,0);
+	transportseqnr = RTPGenerateRandom16();
+	transportccmediassrc = 0;
+	transportccrecorder = 0;
+	if (usetransportcc) // 记录器较大，只在需要时分配
+		transportccrecorder = new RTPTransportCCRecorder();
+
+	packetsink = 0;
+
+	// 初始化拥塞控制
+
+	congestioncontroller = 0;
+	deletecongestioncontroller = false;
+	if (sessparams.GetUseCongestionControl())
+	{
+		congestioncontroller = new RTPDelayBasedController(sessparams.GetInitialBitrate(),sessparams.GetMinimumBitrate(),
+		                                                   sessparams.GetMaximumBitrate());
+		deletecongestioncontroller = true;
+	}
+
 	// 如果需要，执行线程相关操作
 	
 	pollthread = 0;
@@ -270,6 +412,13 @@ int RTPSession::InternalCreate(const RTPSessionParams &sessparams)
 			packetbuilder.Destroy();
 			sources.Clear();
 			rtcpbuilder.Destroy();
+			rtxcache.Destroy();
+			delete [] rtxbuffer;
+			rtxbuffer = 0;
+			fecencoder.Destroy();
+			fecdecoder.Destroy();
+			delete transportccrecorder;
+			transportccrecorder = 0;
 			return MEDIA_RTP_ERR_RESOURCE_ERROR;
 		}
 		if ((status = pollthread->Start(rtptrans)) < 0)
@@ -280,6 +429,13 @@ int RTPSession::InternalCreate(const RTPSessionParams &sessparams)
 			packetbuilder.Destroy();
 			sources.Clear();
 			rtcpbuilder.Destroy();
+			rtxcache.Destroy();
+			delete [] rtxbuffer;
+			rtxbuffer = 0;
+			fecencoder.Destroy();
+			fecdecoder.Destroy();
+			delete transportccrecorder;
+			transportccrecorder = 0;
 			return status;
 		}
 	}
@@ -303,6 +459,24 @@ void RTPSession::Destroy()
 	rtcpsched.Reset();
 	collisionlist.Clear();
 	sources.Clear();
+	rtxcache.Destroy();
+	delete [] rtxbuffer;
+	rtxbuffer = 0;
+	fecencoder.Destroy();
+	fecdecoder.Destroy();
+	dataready.Destroy();
+	delete transportccrecorder;
+	transportccrecorder = 0;
+	if (deletecongestioncontroller)
+		delete congestioncontroller;
+	congestioncontroller = 0;
+	deletecongestioncontroller = false;
+
+	std::list<RTPRawPacket *>::const_iterator rawit;
+
+	for (rawit = fecrecovered.begin() ; rawit != fecrecovered.end() ; rawit++)
+		delete *rawit;
+	fecrecovered.clear();
 
 	std::list<RTCPCompoundPacket *>::const_iterator it;
 
@@ -383,6 +557,24 @@ void RTPSession::BYEDestroy(const RTPTime &maxwaittime,const void *reason,size_t
 	rtcpsched.Reset();
 	collisionlist.Clear();
 	sources.Clear();
+	rtxcache.Destroy();
+	delete [] rtxbuffer;
+	rtxbuffer = 0;
+	fecencoder.Destroy();
+	fecdecoder.Destroy();
+	dataready.Destroy();
+	delete transportccrecorder;
+	transportccrecorder = 0;
+	if (deletecongestioncontroller)
+		delete congestioncontroller;
+	congestioncontroller = 0;
+	deletecongestioncontroller = false;
+
+	std::list<RTPRawPacket *>::const_iterator rawit;
+
+	for (rawit = fecrecovered.begin() ; rawit != fecrecovered.end() ; rawit++)
+		delete *rawit;
+	fecrecovered.clear();
 
 	// 清除剩余的 bye 包
 	std::list<RTCPCompoundPacket *>::const_iterator it;
@@ -467,6 +659,8 @@ int RTPSession::SendPacket(const void *data,size_t len)
 	
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usetransportcc) // 需要加入传输层序列号头部扩展
+		return SendPacketEx(data,len,RTP_ONEBYTEHEADEREXTENSION_ID,0,0);
 
 	BUILDER_LOCK
 	if ((status = packetbuilder.BuildPacket(data,len)) < 0)
@@ -474,7 +668,7 @@ int RTPSession::SendPacket(const void *data,size_t len)
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket()) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
@@ -497,6 +691,8 @@ int RTPSession::SendPacket(const void *data,size_t len,
 
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usetransportcc) // 需要加入传输层序列号头部扩展
+		return SendPacketEx(data,len,pt,mark,timestampinc,RTP_ONEBYTEHEADEREXTENSION_ID,0,0);
 	
 	BUILDER_LOCK
 	if ((status = packetbuilder.BuildPacket(data,len,pt,mark,timestampinc)) < 0)
@@ -504,7 +700,7 @@ int RTPSession::SendPacket(const void *data,size_t len,
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket()) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
@@ -529,16 +725,23 @@ int RTPSession::SendPacketEx(const void *data,size_t len,
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
 	BUILDER_LOCK
+	bool transportcc = PrepareTransportCCExtension(&hdrextID,&hdrextdata,&numhdrextwords);
 	if ((status = packetbuilder.BuildPacketEx(data,len,hdrextID,hdrextdata,numhdrextwords)) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket()) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
 	}
+	if (transportcc)
+	{
+		if (congestioncontroller != 0)
+			congestioncontroller->OnPacketSent(transportseqnr,packetbuilder.GetPacketLength(),RTPTime::CurrentTime());
+		transportseqnr++;
+	}
 	BUILDER_UNLOCK
 
 	SOURCES_LOCK
@@ -560,16 +763,86 @@ int RTPSession::SendPacketEx(const void *data,size_t len,
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	
 	BUILDER_LOCK
+	bool transportcc = PrepareTransportCCExtension(&hdrextID,&hdrextdata,&numhdrextwords);
 	if ((status = packetbuilder.BuildPacketEx(data,len,pt,mark,timestampinc,hdrextID,hdrextdata,numhdrextwords)) < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
 	}
-	if ((status = SendRTPData(packetbuilder.GetPacket(),packetbuilder.GetPacketLength())) < 0)
+	if ((status = SendBuiltRTPPacket()) < 0)
+	{
+		BUILDER_UNLOCK
+		return status;
+	}
+	if (transportcc)
+	{
+		if (congestioncontroller != 0)
+			congestioncontroller->OnPacketSent(transportseqnr,packetbuilder.GetPacketLength(),RTPTime::CurrentTime());
+		transportseqnr++;
+	}
+	BUILDER_UNLOCK
+
+	SOURCES_LOCK
+	sources.SentRTPPacket();
+	SOURCES_UNLOCK
+	PACKSENT_LOCK
+	sentpackets = true;
+	PACKSENT_UNLOCK
+	return 0;
+}
+
+int RTPSession::ForwardPacket(const RTPPacket &pack)
+{
+	int status;
+
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	BUILDER_LOCK
+	if ((status = packetbuilder.BuildForwardedHeader(pack,rtcpbuilder.GetTimestampUnit())) < 0)
+	{
+		BUILDER_UNLOCK
+		return status;
+	}
+
+	uint8_t *header = packetbuilder.GetPacket();
+	size_t headerlen = packetbuilder.GetPacketLength();
+	const uint8_t *payload = pack.GetPayloadData();
+	size_t payloadlen = pack.GetPacketLength()-headerlen; // 包括填充
+
+	// 头部已经复制，可以直接改写其中的传输层序列号；不为没有该元素的数据包添加头部扩展
+	bool transportcc = false;
+	const uint8_t *element;
+	size_t elementlen;
+
+	if (usetransportcc && pack.GetOneByteExtensionElement(transportccextid,&element,&elementlen) && elementlen == 2)
+	{
+		uint8_t *p = header+(element-pack.GetPacketData());
+
+		p[0] = (uint8_t)(transportseqnr>>8);
+		p[1] = (uint8_t)transportseqnr;
+		transportcc = true;
+	}
+
+	// 改写发出数据的回调只接受连续的数据包
+	if (m_changeOutgoingData)
+	{
+		if ((status = packetbuilder.AppendForwardedPayload(payload,payloadlen)) >= 0)
+			status = SendBuiltRTPPacket();
+	}
+	else if ((status = rtptrans->SendRTPDataV(header,headerlen,payload,payloadlen)) >= 0)
+		status = ProtectSentRTPPacket(header,headerlen,payload,payloadlen,pack.GetDataReleaser(),pack.GetPacketData());
+	if (status < 0)
 	{
 		BUILDER_UNLOCK
 		return status;
 	}
+	if (transportcc)
+	{
+		if (congestioncontroller != 0)
+			congestioncontroller->OnPacketSent(transportseqnr,headerlen+payloadlen,RTPTime::CurrentTime());
+		transportseqnr++;
+	}
 	BUILDER_UNLOCK
 
 	SOURCES_LOCK
@@ -581,6 +854,20 @@ int RTPSession::SendPacketEx(const void *data,size_t len,
 	return 0;
 }
 
+int RTPSession::ForwardPacket(const RTPPacket &pack,RTPSession *const *egress,size_t numsessions)
+{
+	int result = 0;
+
+	for (size_t i = 0 ; i < numsessions ; i++)
+	{
+		int status = egress[i]->ForwardPacket(pack);
+
+		if (status < 0)
+			result = status;
+	}
+	return result;
+}
+
 #ifdef RTP_SUPPORT_SENDAPP
 
 int RTPSession::SendRTCPAPPPacket(uint8_t subtype, const uint8_t name[4], const void *appdata, size_t appdatalen)
@@ -758,172 +1045,823 @@ int RTPSession::SendUnknownPacket(bool sr, uint8_t payload_type, uint8_t subtype
 
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 
-int RTPSession::SendRawData(const void *data, size_t len, bool usertpchannel)
+int RTPSession::SendNACK(uint32_t ssrc, const uint16_t *seqnrs, int numseqnrs)
 {
-	if (!created)
-		return MEDIA_RTP_ERR_INVALID_STATE;
-
 	int status;
 
-	if (usertpchannel)
-		status = rtptrans->SendRTPData(data, len);
-	else
-		status = rtptrans->SendRTCPData(data, len);
-	return status;
-}
-
-int RTPSession::SetDefaultPayloadType(uint8_t pt)
-{
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
-	
-	int status;
-	
+
 	BUILDER_LOCK
-	status = packetbuilder.SetDefaultPayloadType(pt);
+	status = rtcpbuilder.AddNACKRequest(ssrc,seqnrs,numseqnrs);
 	BUILDER_UNLOCK
-	return status;
+	if (status < 0)
+		return status;
+	return ScheduleFeedback();
 }
 
-int RTPSession::SetDefaultMark(bool m)
+int RTPSession::SendPLI(uint32_t ssrc)
 {
+	int status;
+
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
-	int status;
-
 	BUILDER_LOCK
-	status = packetbuilder.SetDefaultMark(m);
+	status = rtcpbuilder.AddPLIRequest(ssrc);
 	BUILDER_UNLOCK
-	return status;
+	if (status < 0)
+		return status;
+	return ScheduleFeedback();
 }
 
-int RTPSession::SetDefaultTimestampIncrement(uint32_t timestampinc)
+int RTPSession::SendFIR(uint32_t ssrc)
 {
+	int status;
+
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
-	int status;
-
 	BUILDER_LOCK
-	status = packetbuilder.SetDefaultTimestampIncrement(timestampinc);
+	status = rtcpbuilder.AddFIRRequest(ssrc);
 	BUILDER_UNLOCK
-	return status;
+	if (status < 0)
+		return status;
+	return ScheduleFeedback();
 }
 
-int RTPSession::IncrementTimestamp(uint32_t inc)
+int RTPSession::SendREMB(uint64_t bitrate, const uint32_t *ssrcs, int numssrcs)
 {
+	int status;
+
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
-	int status;
-
 	BUILDER_LOCK
-	status = packetbuilder.IncrementTimestamp(inc);
+	status = rtcpbuilder.SetREMBRequest(bitrate,ssrcs,numssrcs);
 	BUILDER_UNLOCK
-	return status;
+	if (status < 0)
+		return status;
+	return ScheduleFeedback();
 }
 
-int RTPSession::IncrementTimestampDefault()
+int RTPSession::ScheduleFeedback()
 {
-	if (!created)
-		return MEDIA_RTP_ERR_INVALID_STATE;
+	SOURCES_LOCK
+	SCHED_LOCK
+	rtcpsched.ScheduleEarlyFeedback();
+	SCHED_UNLOCK
+	SOURCES_UNLOCK
 
-	int status;
-	
-	BUILDER_LOCK
-	status = packetbuilder.IncrementTimestampDefault();
-	BUILDER_UNLOCK
-	return status;
+	// 轮询线程可能正在等待常规 RTCP 间隔，唤醒它以便重新计算等待时间
+	if (usingpollthread)
+		rtptrans->AbortWait();
+	return 0;
 }
 
-int RTPSession::SetPreTransmissionDelay(const RTPTime &delay)
+int RTPSession::RetransmitPacket(uint16_t seqnr)
 {
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
+	return RetransmitPacket(seqnr,usertx);
+}
 
+int RTPSession::RetransmitPacket(uint16_t seqnr, bool rtx)
+{
 	int status;
 
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	RTPTime curtime = RTPTime::CurrentTime();
+
 	BUILDER_LOCK
-	status = rtcpbuilder.SetPreTransmissionDelay(delay);
+	status = InternalRetransmit(seqnr,rtx,curtime);
 	BUILDER_UNLOCK
 	return status;
 }
 
-RTPTransmissionInfo *RTPSession::GetTransmissionInfo()
+uint32_t RTPSession::GetRTXSSRC()
 {
 	if (!created)
 		return 0;
-	return rtptrans->GetTransmissionInfo();
-}
 
-void RTPSession::DeleteTransmissionInfo(RTPTransmissionInfo *inf)
-{
-	if (!created)
-		return;
-	rtptrans->DeleteTransmissionInfo(inf);
+	uint32_t ssrc;
+
+	BUILDER_LOCK
+	ssrc = rtxssrc;
+	BUILDER_UNLOCK
+	return ssrc;
 }
 
-int RTPSession::Poll()
+uint32_t RTPSession::GetFECSSRC()
 {
-	int status;
-	
-	if (!created)
-		return MEDIA_RTP_ERR_INVALID_STATE;
-	if (usingpollthread)
-		return MEDIA_RTP_ERR_INVALID_STATE;
-	if ((status = rtptrans->Poll()) < 0)
-		return status;
-	return ProcessPolledData();
+	if (!created || !fecencoder.IsInitialized())
+		return 0;
+
+	uint32_t ssrc;
+
+	BUILDER_LOCK
+	ssrc = fecssrc;
+	BUILDER_UNLOCK
+	return ssrc;
 }
 
-int RTPSession::WaitForIncomingData(const RTPTime &delay,bool *dataavailable)
+int RTPSession::SetCongestionController(RTPCongestionController *controller)
 {
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
-	if (usingpollthread)
-		return MEDIA_RTP_ERR_INVALID_STATE;
-	return rtptrans->WaitForIncomingData(delay,dataavailable);
+
+	BUILDER_LOCK
+	if (deletecongestioncontroller)
+		delete congestioncontroller;
+	congestioncontroller = controller;
+	deletecongestioncontroller = false;
+	BUILDER_UNLOCK
+	return 0;
 }
 
-int RTPSession::AbortWait()
+int RTPSession::SetPacketSink(RTPPacketSink *sink)
 {
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
-	if (usingpollthread)
-		return MEDIA_RTP_ERR_INVALID_STATE;
-	return rtptrans->AbortWait();
+
+	SOURCES_LOCK
+	packetsink = sink;
+	SOURCES_UNLOCK
+	return 0;
 }
 
-RTPTime RTPSession::GetRTCPDelay()
+double RTPSession::GetTargetBitrate()
 {
 	if (!created)
-		return RTPTime(0,0);
-	if (usingpollthread)
-		return RTPTime(0,0);
+		return 0;
 
-	SOURCES_LOCK
-	SCHED_LOCK
-	RTPTime t = rtcpsched.GetTransmissionDelay();
-	SCHED_UNLOCK
-	SOURCES_UNLOCK
-	return t;
+	double bitrate = 0;
+
+	BUILDER_LOCK
+	if (congestioncontroller != 0)
+		bitrate = congestioncontroller->GetTargetBitrate();
+	BUILDER_UNLOCK
+	return bitrate;
 }
 
-int RTPSession::BeginDataAccess()
+// 调用时必须已持有构建器锁
+int RTPSession::InternalRetransmit(uint16_t seqnr, bool rtx, const RTPTime &curtime)
 {
-	if (!created)
+	if (!rtxcache.IsInitialized())
 		return MEDIA_RTP_ERR_INVALID_STATE;
-	SOURCES_LOCK
+
+	if (!rtx)
+	{
+		const uint8_t *packet, *payload;
+		size_t packetlen, payloadlen;
+
+		if ((packet = rtxcache.GetPacket(seqnr,curtime,&packetlen,&payload,&payloadlen)) == 0)
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		if (payloadlen == 0)
+			return SendRTPData(packet,packetlen);
+		if (!m_changeOutgoingData)
+			return rtptrans->SendRTPDataV(packet,packetlen,payload,payloadlen);
+
+		// 改写发出数据的回调需要连续的数据包，RTX缓冲区足够容纳缓存的任何数据包
+		memcpy(rtxbuffer,packet,packetlen);
+		memcpy(rtxbuffer+packetlen,payload,payloadlen);
+		return SendRTPData(rtxbuffer,packetlen+payloadlen);
+	}
+
+	int status;
+	size_t rtxlen;
+
+	if ((status = rtxcache.BuildRTXPacket(seqnr,curtime,rtxpayloadtype,rtxssrc,rtxseqnr,rtxbuffer,rtxbuffersize,&rtxlen)) < 0)
+		return status;
+	if ((status = SendRTPData(rtxbuffer,rtxlen)) < 0)
+		return status;
+	rtxseqnr++;
 	return 0;
 }
 
-bool RTPSession::GotoFirstSource()
+// 由 RTPSources 在持有源表锁和调度器锁时调用
+void RTPSession::ProcessNACKPacket(RTCPRTPFBPacket *nackpacket)
 {
-	if (!created)
-		return false;
-	return sources.GotoFirstSource();
-}
+	if (!retransmitonnack || !rtxcache.IsInitialized())
+		return;
+
+	RTPTime curtime = RTPTime::CurrentTime();
+
+	BUILDER_LOCK
+	if (nackpacket->GetMediaSSRC() == packetbuilder.GetSSRC())
+	{
+		int num = nackpacket->GetNACKCount();
+
+		for (int i = 0 ; i < num ; i++)
+		{
+			uint16_t pid = nackpacket->GetNACKPID(i);
+			uint16_t blp = nackpacket->GetNACKBLP(i);
+
+			// 缓存中找不到的序列号直接忽略
+			InternalRetransmit(pid,usertx,curtime);
+			for (int j = 0 ; j < 16 ; j++)
+			{
+				if (blp&(1<<j))
+					InternalRetransmit((uint16_t)(pid+j+1),usertx,curtime);
+			}
+		}
+	}
+	BUILDER_UNLOCK
+}
+
+// 由 ProcessPolledData 在持有源表锁时调用
+void RTPSession::GenerateNACKRequests(const RTPTime &curtime)
+{
+	uint16_t seqnrs[RTCP_FB_MAXNACKITEMS];
+	bool added = false;
+
+	if (!sources.GotoFirstSource())
+		return;
+
+	do
+	{
+		RTPSourceData *srcdat = sources.GetCurrentSourceInfo();
+
+		if (srcdat->IsOwnSSRC() || !srcdat->IsValidated() || !srcdat->GetLossTracker().HasMissingPackets())
+			continue;
+
+		// 没有可用的往返时间估计时使用默认值来间隔重复的请求
+		RTPTime rtt = srcdat->INF_GetRoundtripTime();
+		if (rtt.IsZero())
+			rtt = RTPTime(RTP_DEFAULTNACKRTT);
+
+		int num = srcdat->GetLossTracker().GetNACKList(curtime,rtt,nackmaxretries,seqnrs,RTCP_FB_MAXNACKITEMS);
+		if (num > 0)
+		{
+			BUILDER_LOCK
+			if (rtcpbuilder.AddNACKRequest(srcdat->GetSSRC(),seqnrs,num) >= 0)
+				added = true;
+			BUILDER_UNLOCK
+		}
+	} while (sources.GotoNextSource());
+
+	if (added)
+	{
+		SCHED_LOCK
+		rtcpsched.ScheduleEarlyFeedback();
+		SCHED_UNLOCK
+	}
+}
+
+// 返回所有源中最早可以发送NACK请求的时间，调用者持有源表锁
+bool RTPSession::GetNextNACKTime(RTPTime *nexttime)
+{
+	bool found = false;
+
+	if (!sources.GotoFirstSource())
+		return false;
+
+	do
+	{
+		RTPSourceData *srcdat = sources.GetCurrentSourceInfo();
+
+		if (srcdat->IsOwnSSRC() || !srcdat->IsValidated() || !srcdat->GetLossTracker().HasMissingPackets())
+			continue;
+
+		RTPTime rtt = srcdat->INF_GetRoundtripTime();
+		if (rtt.IsZero())
+			rtt = RTPTime(RTP_DEFAULTNACKRTT);
+
+		RTPTime t;
+		if (srcdat->GetLossTracker().GetNextNACKTime(rtt,nackmaxretries,&t) && (!found || t < *nexttime))
+		{
+			*nexttime = t;
+			found = true;
+		}
+	} while (sources.GotoNextSource());
+	return found;
+}
+
+// 调用时必须已持有构建器锁
+bool RTPSession::PrepareTransportCCExtension(uint16_t *hdrextID,const void **hdrextdata,size_t *numhdrextwords)
+{
+	if (!usetransportcc)
+		return false;
+
+	// 只能在一字节格式的头部扩展中加入新元素，其他格式的扩展保持不变
+	if (*numhdrextwords != 0 && *hdrextID != RTP_ONEBYTEHEADEREXTENSION_ID)
+		return false;
+	if (*numhdrextwords >= 0xFFFF)
+		return false;
+
+	size_t len = (*numhdrextwords)*sizeof(uint32_t);
+
+	transportccext.resize(len+sizeof(uint32_t));
+	if (len > 0)
+		memcpy(&transportccext[0],*hdrextdata,len);
+	transportccext[len] = (uint8_t)((transportccextid<<4)|1); // 两字节的元素
+	transportccext[len+1] = (uint8_t)(transportseqnr>>8);
+	transportccext[len+2] = (uint8_t)transportseqnr;
+	transportccext[len+3] = 0;
+
+	*hdrextID = RTP_ONEBYTEHEADEREXTENSION_ID;
+	*hdrextdata = &transportccext[0];
+	*numhdrextwords += 1;
+	return true;
+}
+
+// 在处理收到的数据时调用，此时已持有源表锁
+void RTPSession::ProcessTransportCCPacket(RTPPacket *pack,const RTPTime &receivetime,const RTPEndpoint *senderaddress)
+{
+	if (!usetransportcc || senderaddress == 0) // 忽略自己的数据包
+		return;
+
+	const uint8_t *data;
+	size_t len;
+
+	if (!pack->GetOneByteExtensionElement(transportccextid,&data,&len) || len < 2)
+		return;
+
+	transportccmediassrc = pack->GetSSRC();
+	transportccrecorder->ProcessPacket((uint16_t)((data[0]<<8)|data[1]),receivetime);
+}
+
+// 在源验证了数据包之后调用，此时已持有源表锁
+void RTPSession::ProcessValidatedRTPPacket(RTPSourceData *srcdat,RTPPacket *rtppack,bool isonprobation,bool *ispackethandled)
+{
+	OnValidatedRTPPacket(srcdat,rtppack,isonprobation,ispackethandled);
+	if (*ispackethandled || packetsink == 0)
+		return;
+
+	// 接收器不保留数据包时在这里删除，源不会再使用它
+	*ispackethandled = true;
+	if (!packetsink->OnRTPPacket(srcdat,rtppack,isonprobation))
+		DeletePacket(rtppack);
+}
+
+// 有源从没有数据包变为有数据包时调用，此时已持有源表锁
+void RTPSession::ProcessSourceHasData()
+{
+	if (dataready.IsInitialized())
+		dataready.Signal();
+}
+
+// 在处理收到的RTCP数据时调用，此时已持有源表锁和调度器锁
+void RTPSession::ProcessFeedbackPacket(RTCPPacket *fbpacket,const RTPTime &receivetime)
+{
+	if (fbpacket->GetPacketType() != RTCPPacket::RTPFB)
+		return;
+
+	RTCPRTPFBPacket *p = (RTCPRTPFBPacket *)fbpacket;
+
+	if (!p->IsTransportCC())
+		return;
+
+	BUILDER_LOCK
+	if (congestioncontroller != 0 && transportccfeedback.Parse(p->GetFCIData(),p->GetFCILength()) >= 0)
+		congestioncontroller->OnTransportFeedback(transportccfeedback,receivetime);
+	BUILDER_UNLOCK
+}
+
+void RTPSession::ProcessREMBPacket(RTCPPSFBPacket *rembpacket,const RTPTime &receivetime)
+{
+	BUILDER_LOCK
+	if (congestioncontroller != 0)
+	{
+		uint32_t ownssrc = packetbuilder.GetSSRC();
+		bool forus = (rembpacket->GetREMBSSRCCount() == 0);
+
+		for (int i = 0 ; !forus && i < rembpacket->GetREMBSSRCCount() ; i++)
+		{
+			if (rembpacket->GetREMBSSRC(i) == ownssrc)
+				forus = true;
+		}
+		if (forus)
+			congestioncontroller->OnREMB(rembpacket->GetREMBBitrate(),receivetime);
+	}
+	BUILDER_UNLOCK
+}
+
+void RTPSession::ProcessReceiverReport(RTPSourceData *srcdat)
+{
+	BUILDER_LOCK
+	if (congestioncontroller != 0)
+		congestioncontroller->OnReceiverReport(srcdat->RR_GetFractionLost(),srcdat->INF_GetRoundtripTime(),srcdat->RR_GetReceiveTime());
+	BUILDER_UNLOCK
+}
+
+void RTPSession::ApplyTargetBitrate()
+{
+	double bitrate = 0;
+
+	BUILDER_LOCK
+	if (congestioncontroller != 0)
+		bitrate = congestioncontroller->GetTargetBitrate();
+	BUILDER_UNLOCK
+
+	if (bitrate <= 0)
+		return;
+
+	// 会话带宽以字节每秒为单位；变化不大时不更新调度器参数
+	double bw = bitrate/8.0;
+
+	SCHED_LOCK
+	if (bw < 0.9*sessionbandwidth || bw > 1.1*sessionbandwidth)
+	{
+		RTCPSchedulerParams p = rtcpsched.GetParameters();
+
+		if (p.SetRTCPBandwidth(bw*controlfragment) >= 0)
+		{
+			rtcpsched.SetParameters(p);
+			sessionbandwidth = bw;
+		}
+	}
+	SCHED_UNLOCK
+}
+
+// 用传输器收集的发送时间戳修正发送者报告使用的数据包时间
+void RTPSession::ProcessTransmitTimestamps()
+{
+	uint32_t ssrc, rtptimestamp;
+	RTPTime sendtime(0);
+
+	BUILDER_LOCK
+	while (rtptrans->GetNextTransmitTimestamp(&ssrc,&rtptimestamp,&sendtime))
+	{
+		if (ssrc == packetbuilder.GetSSRC())
+			packetbuilder.SetPacketTransmitTime(rtptimestamp,sendtime);
+	}
+	BUILDER_UNLOCK
+}
+
+void RTPSession::GenerateTransportCCFeedback(const RTPTime &curtime)
+{
+	if (!transportccrecorder->HasPendingFeedback())
+		return;
+
+	RTPTime diff = curtime;
+
+	diff -= lasttransportccfeedback;
+	if (diff < transportccinterval)
+		return;
+
+	uint8_t fci[RTP_TRANSPORTCC_MAXFCISIZE];
+	bool added = false;
+
+	BUILDER_LOCK
+	// 上一批反馈尚未发送时不生成新的反馈，未报告的数据包保留在记录器中
+	if (!rtcpbuilder.HasPendingFeedback())
+	{
+		for (int i = 0 ; i < RTP_TRANSPORTCC_MAXFEEDBACKPACKETS && transportccrecorder->HasPendingFeedback() ; i++)
+		{
+			size_t fcilen;
+
+			if (transportccrecorder->BuildFeedback(fci,sizeof(fci),&fcilen) < 0)
+				break;
+			if (rtcpbuilder.AddFeedbackRequest(RTP_RTCPTYPE_RTPFB,RTCP_RTPFB_FMT_TRANSPORTCC,transportccmediassrc,fci,fcilen) < 0)
+				break;
+			added = true;
+		}
+	}
+	BUILDER_UNLOCK
+
+	if (added)
+	{
+		lasttransportccfeedback = curtime;
+
+		SCHED_LOCK
+		rtcpsched.ScheduleEarlyFeedback();
+		SCHED_UNLOCK
+	}
+}
+
+// 调用时必须已持有构建器锁
+int RTPSession::SendBuiltRTPPacket()
+{
+	uint8_t *packet = packetbuilder.GetPacket();
+	size_t packetlen = packetbuilder.GetPacketLength();
+	int status;
+
+	if ((status = SendRTPData(packet,packetlen)) < 0)
+		return status;
+	return ProtectSentRTPPacket(packet,packetlen,0,0,0,0);
+}
+
+// 把刚发送的数据包存入重传缓存并加入FEC分组，负载可以和头部分开存放；调用时必须已持有构建器锁
+int RTPSession::ProtectSentRTPPacket(const uint8_t *header,size_t headerlen,const uint8_t *payload,size_t payloadlen,
+                                     RTPDataReleaser *releaser,uint8_t *data)
+{
+	int status;
+
+	if (rtxcache.IsInitialized())
+		rtxcache.StorePacket(header,headerlen,payload,payloadlen,releaser,data,packetbuilder.GetPacketTime());
+
+	if (fecencoder.IsInitialized())
+	{
+		int num = fecencoder.AddMediaPacket(header,headerlen,payload,payloadlen);
+
+		for (int i = 0 ; i < num ; i++)
+		{
+			size_t feclen;
+			const uint8_t *fecpacket = fecencoder.GetFECPacket(i,&feclen);
+
+			if ((status = SendRTPData(fecpacket,feclen)) < 0)
+				return status;
+		}
+	}
+	return 0;
+}
+
+// 将收到的RTP数据包交给FEC解码器，恢复出的数据包加入 fecrecovered 列表；
+// 如果 rawpack 是FEC包则返回 true
+bool RTPSession::ProcessFECData(RTPRawPacket *rawpack)
+{
+	bool isfec = fecdecoder.IsFECPacket(rawpack->GetData(),rawpack->GetDataLength());
+
+	if (isfec)
+		fecdecoder.AddFECPacket(rawpack->GetData(),rawpack->GetDataLength());
+	else
+		fecdecoder.AddMediaPacket(rawpack->GetData(),rawpack->GetDataLength());
+
+	const uint8_t *packet;
+	size_t packetlen;
+
+	while (fecdecoder.GetNextRecoveredPacket(&packet,&packetlen))
+	{
+		uint8_t *data = new uint8_t[packetlen];
+		RTPEndpoint *addr = 0;
+		RTPTime recvtime = rawpack->GetReceiveTime();
+
+		memcpy(data,packet,packetlen);
+		if (rawpack->GetSenderAddress())
+			addr = new RTPEndpoint(*rawpack->GetSenderAddress());
+		fecrecovered.push_back(new RTPRawPacket(data,packetlen,addr,recvtime,true));
+	}
+	return isfec;
+}
+
+int RTPSession::SendRawData(const void *data, size_t len, bool usertpchannel)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	if (usertpchannel)
+		status = rtptrans->SendRTPData(data, len);
+	else
+		status = rtptrans->SendRTCPData(data, len);
+	return status;
+}
+
+int RTPSession::SetDefaultPayloadType(uint8_t pt)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	
+	int status;
+	
+	BUILDER_LOCK
+	status = packetbuilder.SetDefaultPayloadType(pt);
+	BUILDER_UNLOCK
+	return status;
+}
+
+int RTPSession::SetDefaultMark(bool m)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	BUILDER_LOCK
+	status = packetbuilder.SetDefaultMark(m);
+	BUILDER_UNLOCK
+	return status;
+}
+
+int RTPSession::SetDefaultTimestampIncrement(uint32_t timestampinc)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	BUILDER_LOCK
+	status = packetbuilder.SetDefaultTimestampIncrement(timestampinc);
+	BUILDER_UNLOCK
+	return status;
+}
+
+int RTPSession::IncrementTimestamp(uint32_t inc)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	BUILDER_LOCK
+	status = packetbuilder.IncrementTimestamp(inc);
+	BUILDER_UNLOCK
+	return status;
+}
+
+int RTPSession::IncrementTimestampDefault()
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+	
+	BUILDER_LOCK
+	status = packetbuilder.IncrementTimestampDefault();
+	BUILDER_UNLOCK
+	return status;
+}
+
+int RTPSession::SetPreTransmissionDelay(const RTPTime &delay)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	BUILDER_LOCK
+	status = rtcpbuilder.SetPreTransmissionDelay(delay);
+	BUILDER_UNLOCK
+	return status;
+}
+
+RTPTransmissionInfo *RTPSession::GetTransmissionInfo()
+{
+	if (!created)
+		return 0;
+	return rtptrans->GetTransmissionInfo();
+}
+
+void RTPSession::DeleteTransmissionInfo(RTPTransmissionInfo *inf)
+{
+	if (!created)
+		return;
+	rtptrans->DeleteTransmissionInfo(inf);
+}
+
+int RTPSession::Poll()
+{
+	int status;
+	
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usingpollthread)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if ((status = rtptrans->Poll()) < 0)
+		return status;
+	return ProcessPolledData();
+}
+
+int RTPSession::WaitForIncomingData(const RTPTime &delay,bool *dataavailable)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usingpollthread)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	return rtptrans->WaitForIncomingData(delay,dataavailable);
+}
+
+int RTPSession::AbortWait()
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usingpollthread)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	return rtptrans->AbortWait();
+}
+
+RTPTime RTPSession::GetRTCPDelay()
+{
+	if (!created)
+		return RTPTime(0,0);
+	if (usingpollthread)
+		return RTPTime(0,0);
+
+	SOURCES_LOCK
+	SCHED_LOCK
+	RTPTime t = rtcpsched.GetTransmissionDelay();
+	SCHED_UNLOCK
+	SOURCES_UNLOCK
+	return t;
+}
+
+int RTPSession::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usingpollthread)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	return rtptrans->GetReceiveDescriptors(descriptors);
+}
+
+int RTPSession::GetEventDescriptors(std::vector<int> &descriptors,RTPTime *deadline)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usingpollthread)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status,abortdesc;
+
+	if ((status = rtptrans->GetReceiveDescriptors(descriptors)) < 0)
+		return status;
+	if (rtptrans->GetAbortDescriptor(&abortdesc) >= 0) // 不是每个传输器都支持
+		descriptors.push_back(abortdesc);
+
+	*deadline = GetNextEventTime();
+	return 0;
+}
+
+// 返回下一次需要处理定时事件的绝对时间：发送RTCP、传输层拥塞控制反馈或NACK请求
+RTPTime RTPSession::GetNextEventTime()
+{
+	RTPTime curtime = RTPTime::CurrentTime();
+	RTPTime next = curtime;
+
+	SOURCES_LOCK
+	SCHED_LOCK
+	next += rtcpsched.GetTransmissionDelay();
+	SCHED_UNLOCK
+
+	// 传输层拥塞控制反馈按自己的间隔生成，可能早于下一个RTCP数据包
+	if (usetransportcc && transportccrecorder->HasPendingFeedback())
+	{
+		RTPTime feedbacktime = lasttransportccfeedback;
+
+		feedbacktime += transportccinterval;
+		if (feedbacktime < curtime)
+			feedbacktime = curtime;
+		if (feedbacktime < next)
+			next = feedbacktime;
+	}
+
+	// 丢包产生的NACK请求（以及按往返时间间隔的重复请求）不必等到下一个RTCP数据包
+	RTPTime nacktime;
+	if (generatenacks && GetNextNACKTime(&nacktime))
+	{
+		if (nacktime < curtime)
+			nacktime = curtime;
+		if (nacktime < next)
+			next = nacktime;
+	}
+	SOURCES_UNLOCK
+
+	return next;
+}
+
+int RTPSession::OnReadable(int descriptor)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usingpollthread)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	if ((status = rtptrans->PollDescriptor(descriptor)) < 0)
+		return status;
+
+	SOURCES_LOCK
+	status = ProcessReceivedData();
+	SOURCES_UNLOCK
+	return status;
+}
+
+int RTPSession::OnTimer(const RTPTime &now)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (usingpollthread)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	SOURCES_LOCK
+	status = ProcessTimedEvents(now);
+	SOURCES_UNLOCK
+	return status;
+}
+
+int RTPSession::BeginDataAccess()
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	SOURCES_LOCK
+	if (dataready.IsInitialized())
+		dataready.Clear();
+	return 0;
+}
+
+bool RTPSession::GotoFirstSource()
+{
+	if (!created)
+		return false;
+	return sources.GotoFirstSource();
+}
 
 bool RTPSession::GotoNextSource()
 {
@@ -995,10 +1933,94 @@ int RTPSession::EndDataAccess()
 {
 	if (!created)
 		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (dataready.IsInitialized() && sources.GotoFirstSourceWithData())
+		dataready.Signal(); // 应用程序没有取走所有数据包
 	SOURCES_UNLOCK
 	return 0;
 }
 
+int RTPSession::GetDataReadyDescriptor(int *descriptor)
+{
+	if (!created)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status = 0;
+
+	SOURCES_LOCK
+	if (!dataready.IsInitialized())
+	{
+		// 在创建描述符之前已经收到的数据包也要通知
+		if ((status = dataready.Init()) >= 0 && sources.GotoFirstSourceWithData())
+			dataready.Signal();
+	}
+	*descriptor = dataready.GetDescriptor();
+	SOURCES_UNLOCK
+	return status;
+}
+
+RTPPacket *RTPSession::WaitForNextPacket(const RTPTime &timeout)
+{
+	if (!created)
+		return 0;
+
+	RTPTime deadline = RTPTime::CurrentTime();
+
+	deadline += timeout;
+	while (true)
+	{
+		RTPPacket *pack = 0;
+		int descriptor;
+
+		// 先清除信号再检查数据，之后到达的数据包会重新发出信号
+		SOURCES_LOCK
+		if (!dataready.IsInitialized() && dataready.Init() < 0)
+		{
+			SOURCES_UNLOCK
+			return 0;
+		}
+		dataready.Clear();
+		if (sources.GotoFirstSourceWithData())
+		{
+			pack = sources.GetNextPacket();
+			if (sources.GotoFirstSourceWithData())
+				dataready.Signal();
+		}
+		descriptor = dataready.GetDescriptor();
+		SOURCES_UNLOCK
+
+		if (pack != 0)
+			return pack;
+
+		RTPTime remaining = deadline;
+
+		remaining -= RTPTime::CurrentTime();
+		if (remaining <= RTPTime(0))
+			return 0;
+
+		if (usingpollthread)
+		{
+			int8_t isset = 0;
+
+			if (RTPSelect(&descriptor,&isset,1,remaining) < 0)
+				return 0;
+		}
+		else
+		{
+			// 没有轮询线程时由这里接收数据，并在需要时发送RTCP、NACK和传输层拥塞控制反馈
+			RTPTime delay = GetNextEventTime();
+
+			delay -= RTPTime::CurrentTime();
+			if (delay < RTPTime(0))
+				delay = RTPTime(0);
+
+			if (remaining < delay)
+				delay = remaining;
+			if (rtptrans->WaitForIncomingData(delay) < 0 || Poll() < 0)
+				return 0;
+		}
+	}
+}
+
 int RTPSession::SetReceiveMode(RTPTransmitter::ReceiveMode m)
 {
 	if (!created)
@@ -1116,13 +2138,36 @@ int RTPSession::SetTimestampUnit(double u)
 
 int RTPSession::ProcessPolledData()
 {
-	RTPRawPacket *rawpack;
 	int status;
 	
 	SOURCES_LOCK
-	while ((rawpack = rtptrans->GetNextPacket()) != 0)
+	if ((status = ProcessReceivedData()) >= 0)
+		status = ProcessTimedEvents(RTPTime::CurrentTime());
+	SOURCES_UNLOCK
+	return status;
+}
+
+// 处理传输器中已接收的所有数据包，调用者持有源表锁
+int RTPSession::ProcessReceivedData()
+{
+	RTPRawPacket *rawpack;
+	int status;
+
+	for (;;)
 	{
-		if (m_changeIncomingData)
+		// 先处理通过FEC恢复的数据包，它们已经过解码器和数据更改处理
+		bool recovered = false;
+
+		if (!fecrecovered.empty())
+		{
+			rawpack = fecrecovered.front();
+			fecrecovered.pop_front();
+			recovered = true;
+		}
+		else if ((rawpack = rtptrans->GetNextPacket()) == 0)
+			break;
+
+		if (m_changeIncomingData && !recovered)
 		{
 			// 提供一种更改传入数据的方法，例如用于解密
 			if (!OnChangeIncomingData(rawpack))
@@ -1132,6 +2177,13 @@ int RTPSession::ProcessPolledData()
 			}
 		}
 
+		// FEC包只交给解码器，不作为源的数据处理
+		if (fecdecoder.IsInitialized() && rawpack->IsRTP() && !recovered && ProcessFECData(rawpack))
+		{
+			delete rawpack;
+			continue;
+		}
+
 		sources.ClearOwnCollisionFlag();
 
 		// 由于我们的 sources 实例也使用调度程序（分析传入的数据包）
@@ -1140,7 +2192,6 @@ int RTPSession::ProcessPolledData()
 		if ((status = sources.ProcessRawPacket(rawpack,rtptrans,acceptownpackets)) < 0)
 		{
 			SCHED_UNLOCK
-			SOURCES_UNLOCK
 			delete rawpack;
 			return status;
 		}
@@ -1152,7 +2203,6 @@ int RTPSession::ProcessPolledData()
 			
 			if ((status = collisionlist.UpdateAddress(rawpack->GetSenderAddress(),rawpack->GetReceiveTime(),&created)) < 0)
 			{
-				SOURCES_UNLOCK
 				delete rawpack;
 				return status;
 			}
@@ -1173,7 +2223,6 @@ int RTPSession::ProcessPolledData()
 					if ((status = rtcpbuilder.BuildBYEPacket(&rtcpcomppack,0,0,useSR_BYEifpossible)) < 0)
 					{
 						BUILDER_UNLOCK
-						SOURCES_UNLOCK
 						delete rawpack;
 						return status;
 					}
@@ -1192,6 +2241,7 @@ int RTPSession::ProcessPolledData()
 				
 				BUILDER_LOCK
 				uint32_t newssrc = packetbuilder.CreateNewSSRC(sources);
+				rtxcache.Clear(); // 新的SSRC使用新的序列号空间
 				BUILDER_UNLOCK
 					
 				PACKSENT_LOCK
@@ -1202,26 +2252,91 @@ int RTPSession::ProcessPolledData()
 
 				if ((status = sources.DeleteOwnSSRC()) < 0)
 				{
-					SOURCES_UNLOCK
 					delete rawpack;
 					return status;
 				}
 				if ((status = sources.CreateOwnSSRC(newssrc)) < 0)
 				{
-					SOURCES_UNLOCK
 					delete rawpack;
 					return status;
 				}
 			}
 		}
+		else if (sources.DetectedOwnRTXCollision())
+		{
+			bool created;
+			
+			if ((status = collisionlist.UpdateAddress(rawpack->GetSenderAddress(),rawpack->GetReceiveTime(),&created)) < 0)
+			{
+				delete rawpack;
+				return status;
+			}
+
+			if (created) // RTX流没有自己的报告，不需要发送BYE，直接换用新的RTX SSRC
+			{
+				uint32_t newssrc;
+
+				do
+				{
+					newssrc = RTPGenerateRandom32();
+				} while (sources.GotEntry(newssrc));
+
+				if ((status = sources.DeleteOwnRTXSSRC()) < 0 || (status = sources.CreateOwnRTXSSRC(newssrc)) < 0)
+				{
+					delete rawpack;
+					return status;
+				}
+
+				BUILDER_LOCK
+				rtxssrc = newssrc;
+				BUILDER_UNLOCK
+			}
+		}
+		else if (sources.DetectedOwnFECCollision())
+		{
+			bool created;
+			
+			if ((status = collisionlist.UpdateAddress(rawpack->GetSenderAddress(),rawpack->GetReceiveTime(),&created)) < 0)
+			{
+				delete rawpack;
+				return status;
+			}
+
+			if (created) // 和RTX流一样，FEC流没有自己的报告，直接换用新的FEC SSRC
+			{
+				uint32_t newssrc;
+
+				do
+				{
+					newssrc = RTPGenerateRandom32();
+				} while (sources.GotEntry(newssrc));
+
+				if ((status = sources.DeleteOwnFECSSRC()) < 0 || (status = sources.CreateOwnFECSSRC(newssrc)) < 0)
+				{
+					delete rawpack;
+					return status;
+				}
+
+				BUILDER_LOCK
+				fecssrc = newssrc;
+				fecencoder.SetSSRC(newssrc);
+				BUILDER_UNLOCK
+			}
+		}
 		delete rawpack;
 	}
+	return 0;
+}
+
+// 处理超时并在需要时发送RTCP数据包，调用者持有源表锁
+int RTPSession::ProcessTimedEvents(const RTPTime &curtime)
+{
+	int status;
 
 	SCHED_LOCK
 	RTPTime d = rtcpsched.CalculateDeterministicInterval(false);
 	SCHED_UNLOCK
 	
-	RTPTime t = RTPTime::CurrentTime();
 	double Td = d.GetDouble();
 	RTPTime sendertimeout = RTPTime(Td*sendermultiplier);
 	RTPTime generaltimeout = RTPTime(Td*membermultiplier);
@@ -1229,8 +2344,15 @@ int RTPSession::ProcessPolledData()
 	RTPTime colltimeout = RTPTime(Td*collisionmultiplier);
 	RTPTime notetimeout = RTPTime(Td*notemultiplier);
 	
-	sources.MultipleTimeouts(t,sendertimeout,byetimeout,generaltimeout,notetimeout);
-	collisionlist.Timeout(t,colltimeout);
+	sources.MultipleTimeouts(curtime,sendertimeout,byetimeout,generaltimeout,notetimeout);
+	collisionlist.Timeout(curtime,colltimeout);
+
+	if (generatenacks)
+		GenerateNACKRequests(curtime);
+	if (usetransportcc)
+		GenerateTransportCCFeedback(curtime);
+	ApplyTargetBitrate();
+	ProcessTransmitTimestamps();
 	
 	// 我们将检查是否该处理RTCP相关事宜了
 
@@ -1250,13 +2372,11 @@ int RTPSession::ProcessPolledData()
 			if ((status = rtcpbuilder.BuildNextPacket(&pack)) < 0)
 			{
 				BUILDER_UNLOCK
-				SOURCES_UNLOCK
 				return status;
 			}
 			BUILDER_UNLOCK
 			if ((status = SendRTCPData(pack->GetCompoundPacketData(),pack->GetCompoundPacketLength())) < 0)
 			{
-				SOURCES_UNLOCK
 				delete pack;
 				return status;
 			}
@@ -1274,7 +2394,6 @@ int RTPSession::ProcessPolledData()
 			
 			if ((status = SendRTCPData(pack->GetCompoundPacketData(),pack->GetCompoundPacketLength())) < 0)
 			{
-				SOURCES_UNLOCK
 				delete pack;
 				return status;
 			}
@@ -1299,7 +2418,6 @@ int RTPSession::ProcessPolledData()
 
 		delete pack;
 	}
-	SOURCES_UNLOCK
 	return 0;
 }
 
@@ -9,12 +9,19 @@
 #include "media_rtcp_packet_factory.h"
 #include "media_rtcp_scheduler.h"
 #include "media_rtp_collisionlist.h"
+#include "media_rtp_retransmission_cache.h"
+#include "media_rtp_fec.h"
+#include "media_rtp_transport_cc.h"
+#include "media_rtp_congestion_controller.h"
+#include "media_rtp_packet_sink.h"
+#include "media_rtp_event_descriptor.h"
 #include "rtpconfig.h"
 #include "media_rtp_packet_factory.h"
 #include "media_rtp_sources.h"
 #include "media_rtp_utils.h"
 #include "media_rtp_transmitter.h"
 #include <list>
+#include <vector>
 
 #include <mutex>
 
@@ -134,6 +141,20 @@ public:
   int SendPacketEx(const void *data, size_t len, uint8_t pt, bool mark,
                    uint32_t timestampinc, uint16_t hdrextID,
                    const void *hdrextdata, size_t numhdrextwords);
+
+  /** 从本会话转发收到的RTP数据包\c pack，例如选择性转发单元的出口会话。
+   *  只复制并改写头部：SSRC改为本会话的SSRC，序列号和时间戳按RTPPacketBuilder::BuildForwardedHeader
+   *  映射，负载直接从\c pack 的缓冲区通过RTPTransmitter::SendRTPDataV发送，不会被复制。
+   *  使用传输层拥塞控制时，\c pack 中已有的传输层序列号元素改写为本会话的编号。
+   *  重传缓存只保存改写后的头部，并为\c pack 的引用计数缓冲区持有一个引用（数据不支持共享时才复制负载），
+   *  FEC直接从两部分计算。只有启用了改写发出数据的回调时需要连续的数据包，这时负载会被复制。
+   */
+  int ForwardPacket(const RTPPacket &pack);
+
+  /** 把\c pack 依次从\c egress 中的\c numsessions 个会话转发出去，每个会话独立映射头部字段。
+   *  所有会话都会被尝试，全部成功时返回0，否则返回最后一个错误。
+   */
+  static int ForwardPacket(const RTPPacket &pack, RTPSession *const *egress, size_t numsessions);
 #ifdef RTP_SUPPORT_SENDAPP
   /** 如果在编译时启用了RTCP APP数据包的发送，此函数将创建一个包含RTCP
    * APP数据包的复合数据包并立即发送。 如果在编译时启用了RTCP
@@ -153,6 +174,52 @@ public:
                         const void *data, size_t len);
 #endif // RTP_SUPPORT_RTCPUNKNOWN
 
+  /** 请求向媒体源\c ssrc发送通用NACK，报告\c seqnrs中的\c numseqnrs个丢失序列号。
+   *  请求向媒体源\c ssrc发送通用NACK。NACK将包含在下一个RTCP复合数据包中；
+   *  如果启用了AVPF模式（RTPSessionParams::SetUseAVPF）且允许，将尽早发送该数据包。
+   */
+  int SendNACK(uint32_t ssrc, const uint16_t *seqnrs, int numseqnrs);
+
+  /** 请求向媒体源\c ssrc发送图像丢失指示（PLI），发送时机与SendNACK相同。 */
+  int SendPLI(uint32_t ssrc);
+
+  /** 请求向媒体源\c ssrc发送完整帧内请求（FIR），发送时机与SendNACK相同。 */
+  int SendFIR(uint32_t ssrc);
+
+  /** 请求发送REMB消息，报告对\c ssrcs中\c numssrcs个源估计的最大比特率\c bitrate。 */
+  int SendREMB(uint64_t bitrate, const uint32_t *ssrcs, int numssrcs);
+
+  /** 从重传缓存中重传序列号为\c seqnr的数据包，是否使用RTX封装由
+   *  RTPSessionParams::SetUseRTX决定。需要通过RTPSessionParams::SetRetransmissionCacheSize启用重传缓存。
+   */
+  int RetransmitPacket(uint16_t seqnr);
+
+  /** 从重传缓存中重传序列号为\c seqnr的数据包；如果\c usertx为\c true，数据包将按照RFC 4588
+   *  封装后使用RTX的SSRC和负载类型发送，否则按原样重新发送。
+   */
+  int RetransmitPacket(uint16_t seqnr, bool usertx);
+
+  /** 返回RTX数据包使用的SSRC。检测到其他参与者使用相同的SSRC时，会话会换用新的RTX SSRC。 */
+  uint32_t GetRTXSSRC();
+
+  /** 返回FEC数据包使用的SSRC，没有启用FEC时返回0。检测到其他参与者使用相同的SSRC时，会话会换用新的FEC SSRC。 */
+  uint32_t GetFECSSRC();
+
+  /** 使用\c controller估计目标码率，替换会话创建的默认控制器；会话不会删除\c controller。
+   *  传入0则停用拥塞控制。控制器的函数在持有会话内部锁时被调用。
+   */
+  int SetCongestionController(RTPCongestionController *controller);
+
+  /** 返回拥塞控制器给出的目标码率（比特每秒），没有使用拥塞控制时返回0。
+   *  使用拥塞控制时，RTCP带宽会随目标码率调整，覆盖SetSessionBandwidth设置的值。
+   */
+  double GetTargetBitrate();
+
+  /** 把通过验证的RTP数据包直接交给\c sink，而不是放入源的数据包列表；会话不会删除\c sink。
+   *  传入0恢复默认行为。重写了OnValidatedRTPPacket并设置了\c ispackethandled的数据包不会交给\c sink。
+   */
+  int SetPacketSink(RTPPacketSink *sink);
+
   /** 使用此函数可以直接通过RTP或RTCP通道（如果它们不同）发送原始数据；
    *  数据**不会**通过RTPSession::OnChangeRTPOrRTCPData函数传递。 */
   int SendRawData(const void *data, size_t len, bool usertpchannel);
@@ -214,6 +281,30 @@ public:
    */
   RTPTime GetRTCPDelay();
 
+  /** 把有数据到达时会变为可读的描述符追加到\c descriptors（仅当您不使用轮询线程时有效）。
+   *  在自己的事件循环中等待这些描述符或者GetRTCPDelay给出的时间到达，然后调用Poll，
+   *  可以代替WaitForIncomingData，不需要为每个会话阻塞一个线程。
+   */
+  int GetReceiveDescriptors(std::vector<int> &descriptors);
+
+  /** 把外部事件循环需要等待的描述符（RTP、RTCP以及传输器的中止描述符）追加到
+   *  \c descriptors，并把下一次需要调用OnTimer的绝对时间（RTPTime::CurrentTime的时间基准）
+   *  存入\c deadline（仅当您不使用轮询线程时有效）。其他线程可以通过在传输参数中共享的
+   *  RTPAbortDescriptors唤醒事件循环。处理完每个事件后应重新获取，
+   *  因为收到的数据可能提前RTCP的发送时间或产生需要NACK的空洞，描述符也可能随目的地址改变。
+   */
+  int GetEventDescriptors(std::vector<int> &descriptors, RTPTime *deadline);
+
+  /** 在GetEventDescriptors给出的描述符\c descriptor可读时调用：只读取该描述符上的数据
+   *  并处理收到的数据包，不检查超时和RTCP发送（仅当您不使用轮询线程时有效）。
+   */
+  int OnReadable(int descriptor);
+
+  /** 在到达GetEventDescriptors给出的时间时调用：处理源的超时、反馈请求，并在需要时
+   *  发送RTCP数据包，\c now 是当前时间（仅当您不使用轮询线程时有效）。
+   */
+  int OnTimer(const RTPTime &now);
+
   /** 以下成员函数（直到EndDataAccess}）需要在调用BeginDataAccess和EndDataAccess之间访问。
    *  BeginDataAccess函数确保轮询线程不会在您使用源表的同时访问它。
    *  当调用EndDataAccess时，源表上的锁再次被释放。
@@ -281,6 +372,18 @@ public:
   /** 参见BeginDataAccess。 */
   int EndDataAccess();
 
+  /** 将一个在有源收到新数据包时变为可读的描述符（eventfd）存入\c descriptor，
+   *  应用程序可以把它加入自己的epoll集合。BeginDataAccess清除信号；
+   *  EndDataAccess时如果仍有未取走的数据包，会再次发出信号。
+   */
+  int GetDataReadyDescriptor(int *descriptor);
+
+  /** 从任意源取出下一个数据包，如果还没有数据包，最多等待\c timeout，超时返回NULL。
+   *  不能在BeginDataAccess和EndDataAccess之间调用；没有使用轮询线程时，
+   *  等待期间由此函数接收数据并发送RTCP数据包。返回的数据包应使用DeletePacket释放。
+   */
+  RTPPacket *WaitForNextPacket(const RTPTime &timeout);
+
   /** 将接收模式设置为\c m。
    *  将接收模式设置为\c m。请注意，当接收模式更改时，
    *  要忽略或接受的地址列表将被清除。
@@ -364,6 +467,30 @@ protected:
   virtual void OnAPPPacket(RTCPAPPPacket *apppacket, const RTPTime &receivetime,
                            const RTPEndpoint *senderaddress);
 
+  /** 当在时间\c receivetime从地址\c senderaddress接收到通用NACK数据包\c
+   * nackpacket时调用。
+   */
+  virtual void OnNACKPacket(RTCPRTPFBPacket *nackpacket,
+                            const RTPTime &receivetime,
+                            const RTPEndpoint *senderaddress);
+
+  /** 当接收到图像丢失指示（PLI）数据包\c plipacket时调用。 */
+  virtual void OnPLIPacket(RTCPPSFBPacket *plipacket, const RTPTime &receivetime,
+                           const RTPEndpoint *senderaddress);
+
+  /** 当接收到完整帧内请求（FIR）数据包\c firpacket时调用。 */
+  virtual void OnFIRPacket(RTCPPSFBPacket *firpacket, const RTPTime &receivetime,
+                           const RTPEndpoint *senderaddress);
+
+  /** 当接收到REMB数据包\c rembpacket时调用。 */
+  virtual void OnREMBPacket(RTCPPSFBPacket *rembpacket,
+                            const RTPTime &receivetime,
+                            const RTPEndpoint *senderaddress);
+
+  /** 当接收到其他类型的RTPFB或PSFB反馈数据包\c fbpacket时调用。 */
+  virtual void OnFeedbackPacket(RTCPPacket *fbpacket, const RTPTime &receivetime,
+                                const RTPEndpoint *senderaddress);
+
   /** 当检测到未知的RTCP数据包类型时调用。 */
   virtual void OnUnknownPacketType(RTCPPacket *rtcppack,
                                    const RTPTime &receivetime,
@@ -457,10 +584,36 @@ private:
   int InternalCreate(const RTPSessionParams &sessparams);
   int CreateCNAME(uint8_t *buffer, size_t *bufferlength, bool resolve);
   int ProcessPolledData();
+  int ProcessReceivedData();
+  int ProcessTimedEvents(const RTPTime &curtime);
   int ProcessRTCPCompoundPacket(RTCPCompoundPacket &rtcpcomppack,
                                 RTPRawPacket *pack);
   int SendRTPData(const void *data, size_t len);
   int SendRTCPData(const void *data, size_t len);
+  int SendBuiltRTPPacket();
+  int ProtectSentRTPPacket(const uint8_t *header, size_t headerlen,
+                           const uint8_t *payload, size_t payloadlen,
+                           RTPDataReleaser *releaser, uint8_t *data);
+  bool ProcessFECData(RTPRawPacket *rawpack);
+  int ScheduleFeedback();
+  int InternalRetransmit(uint16_t seqnr, bool usertx, const RTPTime &curtime);
+  void ProcessNACKPacket(RTCPRTPFBPacket *nackpacket);
+  void GenerateNACKRequests(const RTPTime &curtime);
+  bool GetNextNACKTime(RTPTime *nexttime);
+  RTPTime GetNextEventTime();
+  bool PrepareTransportCCExtension(uint16_t *hdrextID, const void **hdrextdata,
+                                   size_t *numhdrextwords);
+  void ProcessTransportCCPacket(RTPPacket *pack, const RTPTime &receivetime,
+                                const RTPEndpoint *senderaddress);
+  void GenerateTransportCCFeedback(const RTPTime &curtime);
+  void ProcessFeedbackPacket(RTCPPacket *fbpacket, const RTPTime &receivetime);
+  void ProcessREMBPacket(RTCPPSFBPacket *rembpacket, const RTPTime &receivetime);
+  void ProcessReceiverReport(RTPSourceData *srcdat);
+  void ApplyTargetBitrate();
+  void ProcessTransmitTimestamps();
+  void ProcessValidatedRTPPacket(RTPSourceData *srcdat, RTPPacket *rtppack,
+                                 bool isonprobation, bool *ispackethandled);
+  void ProcessSourceHasData();
 
   RTPTransmitter *rtptrans;
   bool created;
@@ -486,6 +639,37 @@ private:
   RTCPPacketBuilder rtcpbuilder;
   RTPCollisionList collisionlist;
 
+  RTPRetransmissionCache rtxcache;
+  uint8_t *rtxbuffer;
+  size_t rtxbuffersize;
+  bool usertx;
+  bool retransmitonnack;
+  uint8_t rtxpayloadtype;
+  uint32_t rtxssrc;
+  uint16_t rtxseqnr;
+  bool generatenacks;
+  int nackmaxretries;
+
+  RTPFECEncoder fecencoder;
+  RTPFECDecoder fecdecoder;
+  uint32_t fecssrc;
+  std::list<RTPRawPacket *> fecrecovered;
+
+  bool usetransportcc;
+  uint8_t transportccextid;
+  RTPTime transportccinterval;
+  RTPTime lasttransportccfeedback;
+  uint16_t transportseqnr;
+  uint32_t transportccmediassrc;
+  std::vector<uint8_t> transportccext;
+  RTPTransportCCRecorder *transportccrecorder;
+
+  RTPCongestionController *congestioncontroller;
+  bool deletecongestioncontroller;
+  RTPPacketSink *packetsink;
+  RTPEventDescriptor dataready;
+  RTPTransportCCFeedback transportccfeedback;
+
   std::list<RTCPCompoundPacket *> byepackets;
 
   RTPPollThread *pollthread;
@@ -511,6 +695,16 @@ inline void RTPSession::OnTimeout(RTPSourceData *) {}
 inline void RTPSession::OnBYETimeout(RTPSourceData *) {}
 inline void RTPSession::OnAPPPacket(RTCPAPPPacket *, const RTPTime &,
                                     const RTPEndpoint *) {}
+inline void RTPSession::OnNACKPacket(RTCPRTPFBPacket *, const RTPTime &,
+                                     const RTPEndpoint *) {}
+inline void RTPSession::OnPLIPacket(RTCPPSFBPacket *, const RTPTime &,
+                                    const RTPEndpoint *) {}
+inline void RTPSession::OnFIRPacket(RTCPPSFBPacket *, const RTPTime &,
+                                    const RTPEndpoint *) {}
+inline void RTPSession::OnREMBPacket(RTCPPSFBPacket *, const RTPTime &,
+                                     const RTPEndpoint *) {}
+inline void RTPSession::OnFeedbackPacket(RTCPPacket *, const RTPTime &,
+                                         const RTPEndpoint *) {}
 inline void RTPSession::OnUnknownPacketType(RTCPPacket *, const RTPTime &,
                                             const RTPEndpoint *) {}
 inline void RTPSession::OnUnknownPacketFormat(RTCPPacket *, const RTPTime &,
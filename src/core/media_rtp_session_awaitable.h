@@ -0,0 +1,141 @@
+/**
+ * \file media_rtp_session_awaitable.h
+ */
+
+#ifndef RTPSESSIONAWAITABLE_H
+
+#define RTPSESSIONAWAITABLE_H
+
+#include "rtpconfig.h"
+#include "media_rtp_session.h"
+#include "media_rtp_source_data.h"
+#include "media_rtp_utils.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <functional>
+#include <vector>
+
+/** 协程等待数据包时使用的事件循环接口，由应用程序在自己的运行时（例如asio）上实现。 */
+class RTPCoroutineReactor
+{
+public:
+	virtual ~RTPCoroutineReactor()								{ }
+
+	/** 当 \c descriptors 中任何一个描述符可读，或者到达绝对时间 \c deadline（RTPTime::CurrentTime 的时间基准）
+	 *  时，在事件循环的线程中调用一次 \c callback。
+	 */
+	virtual void WaitReadable(const std::vector<int> &descriptors,const RTPTime &deadline,std::function<void()> callback) = 0;
+};
+
+/** RTPAsyncReceiver::NextPacket 和 RTPAsyncReceiver::NextPacketFrom 返回的可等待对象。
+ *  已有数据包时不挂起；否则通过反应器等待 RTPSession::GetEventDescriptors 给出的描述符和截止时间，
+ *  事件到达后调用 RTPSession::OnReadable 和 RTPSession::OnTimer，直到取得一个数据包才恢复协程。
+ *  \c co_await 的结果是应该用 RTPSession::DeletePacket 释放的数据包，会话出错时为null。
+ */
+class RTPPacketAwaitable
+{
+public:
+	RTPPacketAwaitable(RTPSession &s,RTPCoroutineReactor &r,bool usessrc,uint32_t ssrc)
+		: session(s), reactor(r), filterssrc(usessrc), wantedssrc(ssrc), pack(0)					{ }
+
+	bool await_ready()									{ pack = TakePacket(); return pack != 0; }
+	bool await_suspend(std::coroutine_handle<> h)						{ handle = h; return Arm(); }
+	RTPPacket *await_resume()								{ return pack; }
+private:
+	// 数据包仍留在源的队列中，同步接口和协程接口可以混合使用
+	RTPPacket *TakePacket()
+	{
+		RTPPacket *p = 0;
+
+		if (session.BeginDataAccess() < 0)
+			return 0;
+		if (filterssrc)
+		{
+			RTPSourceData *srcdat = session.GetSourceInfo(wantedssrc);
+
+			if (srcdat != 0 && srcdat->HasData())
+				p = srcdat->GetNextPacket();
+		}
+		else if (session.GotoFirstSourceWithData())
+			p = session.GetNextPacket();
+		session.EndDataAccess();
+		return p;
+	}
+
+	// 返回false表示不需要等待（会话出错），调用者负责恢复协程；
+	// 这样 await_suspend 中不会在协程挂起完成之前调用 handle.resume()
+	bool Arm()
+	{
+		descriptors.clear();
+		if (session.GetEventDescriptors(descriptors,&deadline) < 0)
+			return false;
+		reactor.WaitReadable(descriptors,deadline,[this]() { OnEvent(); });
+		return true;
+	}
+
+	// 与外部事件循环相同：分发可读的描述符，到达截止时间时调用 RTPSession::OnTimer，
+	// 这样NACK和传输层拥塞控制反馈也按GetEventDescriptors给出的时间发送
+	bool Dispatch()
+	{
+		std::vector<int8_t> readable(descriptors.size(),0);
+
+		if (RTPSelect(descriptors.data(),readable.data(),descriptors.size(),RTPTime(0)) < 0)
+			return false;
+		for (size_t i = 0 ; i < descriptors.size() ; i++)
+		{
+			if (readable[i] && session.OnReadable(descriptors[i]) < 0)
+				return false;
+		}
+
+		RTPTime now = RTPTime::CurrentTime();
+
+		if (!(now < deadline) && session.OnTimer(now) < 0)
+			return false;
+		return true;
+	}
+
+	void OnEvent()
+	{
+		if (!Dispatch())
+		{
+			handle.resume();
+			return;
+		}
+		if ((pack = TakePacket()) != 0 || !Arm())
+			handle.resume();
+	}
+
+	RTPSession &session;
+	RTPCoroutineReactor &reactor;
+	bool filterssrc;
+	uint32_t wantedssrc;
+	RTPPacket *pack;
+	std::coroutine_handle<> handle;
+	std::vector<int> descriptors;
+	RTPTime deadline;
+};
+
+/** 用C++20协程接收一个会话的数据包：<tt>RTPPacket *pack = co_await receiver.NextPacket();</tt>
+ *  会话不能使用轮询线程，等待时不占用任何线程。协程在等待期间不能被销毁。
+ */
+class RTPAsyncReceiver
+{
+public:
+	/** 使用 \c reactor 等待 \c session 的数据。 */
+	RTPAsyncReceiver(RTPSession &session,RTPCoroutineReactor &reactor) : m_session(session), m_reactor(reactor)	{ }
+
+	/** 等待任意源的下一个数据包。 */
+	RTPPacketAwaitable NextPacket()								{ return RTPPacketAwaitable(m_session,m_reactor,false,0); }
+
+	/** 等待SSRC为 \c ssrc 的源的下一个数据包。 */
+	RTPPacketAwaitable NextPacketFrom(uint32_t ssrc)					{ return RTPPacketAwaitable(m_session,m_reactor,true,ssrc); }
+private:
+	RTPSession &m_session;
+	RTPCoroutineReactor &m_reactor;
+};
+
+#endif // __cpp_impl_coroutine
+
+#endif // RTPSESSIONAWAITABLE_H
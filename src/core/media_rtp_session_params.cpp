@@ -5,7 +5,7 @@
 
 
 
-RTPSessionParams::RTPSessionParams() : mininterval(0,0)
+RTPSessionParams::RTPSessionParams() : mininterval(0,0),trrinterval(0,0),rtxcachemaxage(0,0),transportccinterval(0,0)
 {
 	usepollthread = true;
 	m_needThreadSafety = true;
@@ -25,6 +25,27 @@ RTPSessionParams::RTPSessionParams() : mininterval(0,0)
 	usehalfatstartup = RTCP_DEFAULTHALFATSTARTUP;
 	immediatebye = RTCP_DEFAULTIMMEDIATEBYE;
 	SR_BYE = RTCP_DEFAULTSRBYE;
+	useavpf = RTCP_DEFAULTUSEAVPF;
+
+	rtxcachesize = RTP_DEFAULTRTXCACHESIZE;
+	rtxcachemaxbytes = RTP_DEFAULTRTXCACHEMAXBYTES;
+	rtxcachemaxage = RTPTime(RTP_DEFAULTRTXCACHEMAXAGE);
+	usertx = false;
+	rtxpayloadtype = 0;
+	retransmitonnack = RTP_DEFAULTRETRANSMITONNACK;
+	generatenacks = RTP_DEFAULTGENERATENACKS;
+	nackmaxretries = RTP_DEFAULTNACKMAXRETRIES;
+	usefec = RTP_DEFAULTUSEFEC;
+	feccolumns = RTP_DEFAULTFECCOLUMNS;
+	fecrows = RTP_DEFAULTFECROWS;
+	fecpayloadtype = 0;
+	usetransportcc = RTP_DEFAULTUSETRANSPORTCC;
+	transportccextid = RTP_DEFAULTTRANSPORTCCEXTENSIONID;
+	transportccinterval = RTPTime(RTP_DEFAULTTRANSPORTCCINTERVAL);
+	usecongestioncontrol = RTP_DEFAULTUSECONGESTIONCONTROL;
+	initialbitrate = RTP_DEFAULTINITIALBITRATE;
+	minimumbitrate = RTP_DEFAULTMINIMUMBITRATE;
+	maximumbitrate = RTP_DEFAULTMAXIMUMBITRATE;
 
 	sendermultiplier = RTP_SENDERTIMEOUTMULTIPLIER;
 	generaltimeoutmultiplier = RTP_MEMBERTIMEOUTMULTIPLIER;
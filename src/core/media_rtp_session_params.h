@@ -127,6 +127,147 @@ public:
   /** 返回会话是否应该立即发送BYE数据包（如果允许）（默认为 \c true）。 */
   bool GetRequestImmediateBYE() const { return immediatebye; }
 
+  /** 如果 \c v 为 \c true，会话将使用RFC 4585（AVPF）的RTCP时序规则，
+   *  允许反馈信息（NACK、PLI、FIR等）通过提前的RTCP数据包发送。
+   */
+  void SetUseAVPF(bool v) { useavpf = v; }
+
+  /** 返回会话是否使用AVPF的RTCP时序规则（默认为 \c false）。 */
+  bool GetUseAVPF() const { return useavpf; }
+
+  /** 设置AVPF模式下常规RTCP数据包之间的最小间隔（T_rr_interval）。 */
+  void SetRegularRTCPMinimumInterval(const RTPTime &t) { trrinterval = t; }
+
+  /** 返回AVPF模式下常规RTCP数据包之间的最小间隔（默认为0）。 */
+  RTPTime GetRegularRTCPMinimumInterval() const { return trrinterval; }
+
+  /** 设置重传缓存能容纳的已发送RTP数据包数量，设为0时禁用重传缓存（默认）。 */
+  void SetRetransmissionCacheSize(size_t n) { rtxcachesize = n; }
+
+  /** 返回重传缓存能容纳的已发送RTP数据包数量（默认为0，即禁用）。 */
+  size_t GetRetransmissionCacheSize() const { return rtxcachesize; }
+
+  /** 设置重传缓存中数据的最大总字节数。 */
+  void SetRetransmissionCacheMaxBytes(size_t n) { rtxcachemaxbytes = n; }
+
+  /** 返回重传缓存中数据的最大总字节数（默认为1MB）。 */
+  size_t GetRetransmissionCacheMaxBytes() const { return rtxcachemaxbytes; }
+
+  /** 设置已发送数据包在重传缓存中保留的最长时间。 */
+  void SetRetransmissionCacheMaxAge(const RTPTime &t) { rtxcachemaxage = t; }
+
+  /** 返回已发送数据包在重传缓存中保留的最长时间（默认为1秒）。 */
+  RTPTime GetRetransmissionCacheMaxAge() const { return rtxcachemaxage; }
+
+  /** 如果 \c v 为 \c true，重传的数据包将按照RFC 4588封装为RTX数据包，
+   *  使用单独的SSRC和通过 RTPSessionParams::SetRTXPayloadType 设置的负载类型发送。
+   *  启用重传缓存时，RTX SSRC会加入源表并和本地SSRC使用相同的CNAME在SDES中通告。
+   */
+  void SetUseRTX(bool v) { usertx = v; }
+
+  /** 返回重传是否使用RTX封装（默认为 \c false）。 */
+  bool GetUseRTX() const { return usertx; }
+
+  /** 设置RTX数据包使用的负载类型。 */
+  void SetRTXPayloadType(uint8_t pt) { rtxpayloadtype = pt; }
+
+  /** 返回RTX数据包使用的负载类型。 */
+  uint8_t GetRTXPayloadType() const { return rtxpayloadtype; }
+
+  /** 如果 \c v 为 \c true，收到针对本地SSRC的通用NACK时会自动从重传缓存中重传丢失的数据包。 */
+  void SetRetransmitOnNACK(bool v) { retransmitonnack = v; }
+
+  /** 返回收到NACK时是否自动重传（默认为 \c true）。 */
+  bool GetRetransmitOnNACK() const { return retransmitonnack; }
+
+  /** 如果 \c v 为 \c true，会话将跟踪每个源的丢包情况，并自动为丢失的数据包发送通用NACK。 */
+  void SetGenerateNACKs(bool v) { generatenacks = v; }
+
+  /** 返回会话是否自动为丢失的数据包发送NACK（默认为 \c false）。 */
+  bool GetGenerateNACKs() const { return generatenacks; }
+
+  /** 设置每个丢失的数据包最多请求重传的次数。 */
+  void SetMaximumNACKRetries(int n) { nackmaxretries = n; }
+
+  /** 返回每个丢失的数据包最多请求重传的次数（默认为3）。 */
+  int GetMaximumNACKRetries() const { return nackmaxretries; }
+
+  /** 如果 \c v 为 \c true，会话将为发送的媒体包生成基于异或的FEC包，并利用收到的FEC包恢复丢失的数据包。
+   *  FEC包使用单独的SSRC，它会加入源表并和本地SSRC使用相同的CNAME在SDES中通告。
+   *  FEC包的格式是本库私有的（参见 RTPFECEncoder），不是ULPFEC（RFC 5109）或FlexFEC（RFC 8627），
+   *  只能用于双方都使用本库的会话。
+   */
+  void SetUseFEC(bool v) { usefec = v; }
+
+  /** 返回会话是否使用FEC（默认为 \c false）。 */
+  bool GetUseFEC() const { return usefec; }
+
+  /** 设置FEC分组的列数，即每个行FEC包保护的连续媒体包数量；小于2时不生成行FEC包。 */
+  void SetFECColumns(int n) { feccolumns = n; }
+
+  /** 返回FEC分组的列数（默认为5）。 */
+  int GetFECColumns() const { return feccolumns; }
+
+  /** 设置FEC分组的行数，即每个列FEC包保护的媒体包数量；小于2时不生成列FEC包（默认）。
+   *  列数与行数的乘积不应超过 RTP_FECDECODER_MEDIASLOTS，否则接收方无法保存整个分组。
+   */
+  void SetFECRows(int n) { fecrows = n; }
+
+  /** 返回FEC分组的行数（默认为0）。 */
+  int GetFECRows() const { return fecrows; }
+
+  /** 设置FEC包使用的负载类型。 */
+  void SetFECPayloadType(uint8_t pt) { fecpayloadtype = pt; }
+
+  /** 返回FEC包使用的负载类型。 */
+  uint8_t GetFECPayloadType() const { return fecpayloadtype; }
+
+  /** 如果 \c v 为 \c true，发送的RTP数据包将携带传输层序列号头部扩展，会话会记录收到的
+   *  数据包的到达时间并定期发送传输层拥塞控制反馈（transport-cc）。
+   */
+  void SetUseTransportCC(bool v) { usetransportcc = v; }
+
+  /** 返回会话是否使用传输层拥塞控制反馈（默认为 \c false）。 */
+  bool GetUseTransportCC() const { return usetransportcc; }
+
+  /** 设置传输层序列号在一字节头部扩展中使用的ID（1到14）。 */
+  void SetTransportCCExtensionID(uint8_t id) { transportccextid = id; }
+
+  /** 返回传输层序列号头部扩展的ID（默认为5）。 */
+  uint8_t GetTransportCCExtensionID() const { return transportccextid; }
+
+  /** 设置发送传输层拥塞控制反馈的时间间隔。 */
+  void SetTransportCCFeedbackInterval(const RTPTime &t) { transportccinterval = t; }
+
+  /** 返回发送传输层拥塞控制反馈的时间间隔（默认为100毫秒）。 */
+  RTPTime GetTransportCCFeedbackInterval() const { return transportccinterval; }
+
+  /** 如果 \c v 为 \c true，会话将创建一个 RTPDelayBasedController，根据transport-cc反馈、REMB和
+   *  接收报告估计目标码率，并据此调整RTCP带宽。基于延迟的估计需要同时启用 SetUseTransportCC。
+   */
+  void SetUseCongestionControl(bool v) { usecongestioncontrol = v; }
+
+  /** 返回会话是否使用拥塞控制（默认为 \c false）。 */
+  bool GetUseCongestionControl() const { return usecongestioncontrol; }
+
+  /** 设置拥塞控制的初始目标码率（比特每秒）。 */
+  void SetInitialBitrate(double bps) { initialbitrate = bps; }
+
+  /** 返回拥塞控制的初始目标码率（默认为300 kbps）。 */
+  double GetInitialBitrate() const { return initialbitrate; }
+
+  /** 设置拥塞控制的最小目标码率（比特每秒）。 */
+  void SetMinimumBitrate(double bps) { minimumbitrate = bps; }
+
+  /** 返回拥塞控制的最小目标码率（默认为30 kbps）。 */
+  double GetMinimumBitrate() const { return minimumbitrate; }
+
+  /** 设置拥塞控制的最大目标码率（比特每秒）。 */
+  void SetMaximumBitrate(double bps) { maximumbitrate = bps; }
+
+  /** 返回拥塞控制的最大目标码率（默认为2.5 Mbps）。 */
+  double GetMaximumBitrate() const { return maximumbitrate; }
+
   /** 发送BYE数据包时，这指示它是否将成为以发送者报告（如果允许）或接收者报告
    *  开头的RTCP复合数据包的一部分。
    */
@@ -207,6 +348,28 @@ private:
   bool usehalfatstartup;
   bool immediatebye;
   bool SR_BYE;
+  bool useavpf;
+  RTPTime trrinterval;
+
+  size_t rtxcachesize;
+  size_t rtxcachemaxbytes;
+  RTPTime rtxcachemaxage;
+  bool usertx;
+  uint8_t rtxpayloadtype;
+  bool retransmitonnack;
+  bool generatenacks;
+  int nackmaxretries;
+  bool usefec;
+  int feccolumns;
+  int fecrows;
+  uint8_t fecpayloadtype;
+  bool usetransportcc;
+  uint8_t transportccextid;
+  RTPTime transportccinterval;
+  bool usecongestioncontrol;
+  double initialbitrate;
+  double minimumbitrate;
+  double maximumbitrate;
 
   double sendermultiplier;
   double generaltimeoutmultiplier;
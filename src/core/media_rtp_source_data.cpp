@@ -369,7 +369,10 @@ int RTPSourceData::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetim
 #endif // RTP_SUPPORT_PROBATION;
 	
 	if (validated && !ownssrc) // 对于自己的 ssrc，这些变量取决于传出数据包，而不是传入数据包
+	{
 		issender = true;
+		losstracker.ProcessPacket(rtppack->GetExtendedSequenceNumber());
+	}
 	
 	bool isonprobation = !validated;
 	bool ispackethandled = false;
@@ -13,6 +13,7 @@
 #include <cstdint>
 #include "media_rtp_sources.h"
 #include "media_rtp_endpoint.h"
+#include "media_rtp_loss_tracker.h"
 #include <list>
 #include <string>
 
@@ -345,6 +346,9 @@ public:
 	/** 返回接收到最后一个SDES NOTE项的时间。 */
 	RTPTime INF_GetLastSDESNoteTime() const					{ return stats.GetLastNoteTime(); }
 
+	/** 返回此源的丢包跟踪器，其中包含丢失、已恢复和未恢复数据包的计数。 */
+	const RTPLossTracker &INF_GetLossTracker() const				{ return losstracker; }
+
 	// 内部处理方法（从RTPInternalSourceData合并）
 	int ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetime,bool *stored, RTPSources *sources);
 	void ProcessSenderInfo(const RTPNTPTime &ntptime,uint32_t rtptime,uint32_t packetcount,
@@ -353,6 +357,7 @@ public:
 	                        uint32_t jitter,uint32_t lsr,uint32_t dlsr,
 				const RTPTime &receivetime)						{ RRprevinf = RRinf; RRinf.Set(fractionlost,lostpackets,exthighseqnr,jitter,lsr,dlsr,receivetime); stats.SetLastMessageTime(receivetime); }
 	void UpdateMessageTime(const RTPTime &receivetime)						{ stats.SetLastMessageTime(receivetime); }
+	RTPLossTracker &GetLossTracker()										{ return losstracker; }
 	int ProcessSDESItem(uint8_t sdesid,const uint8_t *data,size_t itemlen,const RTPTime &receivetime,bool *cnamecollis);
 	int ProcessBYEPacket(const uint8_t *reason,size_t reasonlen,const RTPTime &receivetime);
 		
@@ -384,6 +389,7 @@ protected:
 	RTCPSenderReportInfo SRinf,SRprevinf;
 	RTCPReceiverReportInfo RRinf,RRprevinf;
 	RTPSourceStats stats;
+	RTPLossTracker losstracker;
 	std::string sdes_cname;
 	
 	bool isrtpaddrset,isrtcpaddrset;
@@ -17,9 +17,13 @@ RTPSources::RTPSources(ProbationType probtype)
 	sendercount = 0;
 	activecount = 0;
 	owndata = 0;
+	ownrtxdata = 0;
+	ownfecdata = 0;
 	current_it = sourcelist.end();
 	rtpsession = 0;
 	owncollision = false;
+	ownrtxcollision = false;
+	ownfeccollision = false;
 #ifdef RTP_SUPPORT_PROBATION
 	probationtype = probtype;
 #endif // RTP_SUPPORT_PROBATION
@@ -34,8 +38,12 @@ RTPSources::RTPSources(RTPSession &sess, ProbationType probtype) : rtpsession(&s
 	sendercount = 0;
 	activecount = 0;
 	owndata = 0;
+	ownrtxdata = 0;
+	ownfecdata = 0;
 	current_it = sourcelist.end();
 	owncollision = false;
+	ownrtxcollision = false;
+	ownfeccollision = false;
 #ifdef RTP_SUPPORT_PROBATION
 	probationtype = probtype;
 #endif // RTP_SUPPORT_PROBATION
@@ -60,6 +68,8 @@ void RTPSources::ClearSourceList()
 	}
 	sourcelist.clear();
 	owndata = 0;
+	ownrtxdata = 0;
+	ownfecdata = 0;
 	totalcount = 0;
 	sendercount = 0;
 	activecount = 0;
@@ -69,49 +79,91 @@ int RTPSources::CreateOwnSSRC(uint32_t ssrc)
 {
 	if (owndata != 0)
 		return MEDIA_RTP_ERR_INVALID_STATE;
+	return CreateOwnEntry(ssrc,&owndata);
+}
+
+int RTPSources::DeleteOwnSSRC()
+{
+	if (owndata == 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	DeleteOwnEntry(owndata);
+	owndata = 0;
+	return 0;
+}
+
+int RTPSources::CreateOwnRTXSSRC(uint32_t ssrc)
+{
+	if (ownrtxdata != 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	return CreateOwnEntry(ssrc,&ownrtxdata);
+}
+
+int RTPSources::DeleteOwnRTXSSRC()
+{
+	if (ownrtxdata == 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	DeleteOwnEntry(ownrtxdata);
+	ownrtxdata = 0;
+	return 0;
+}
+
+int RTPSources::CreateOwnFECSSRC(uint32_t ssrc)
+{
+	if (ownfecdata != 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	return CreateOwnEntry(ssrc,&ownfecdata);
+}
+
+int RTPSources::DeleteOwnFECSSRC()
+{
+	if (ownfecdata == 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	DeleteOwnEntry(ownfecdata);
+	ownfecdata = 0;
+	return 0;
+}
+
+int RTPSources::CreateOwnEntry(uint32_t ssrc,RTPSourceData **srcdat)
+{
 	if (GotEntry(ssrc))
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
 	int status;
 	bool created;
 	
-	status = ObtainSourceDataInstance(ssrc,&owndata,&created);
+	status = ObtainSourceDataInstance(ssrc,srcdat,&created);
 	if (status < 0)
 	{
-		owndata = 0; // 仅为确保
+		*srcdat = 0; // 仅为确保
 		return status;
 	}
-	owndata->SetOwnSSRC();	
-	owndata->SetRTPDataAddress(0);
-	owndata->SetRTCPDataAddress(0);
+	(*srcdat)->SetOwnSSRC();	
+	(*srcdat)->SetRTPDataAddress(0);
+	(*srcdat)->SetRTCPDataAddress(0);
 
 	// 我们创建了一个经过验证的 ssrc，因此我们应该增加 activecount
 	activecount++;
 
-	OnNewSource(owndata);
+	OnNewSource(*srcdat);
 	return 0;
 }
 
-int RTPSources::DeleteOwnSSRC()
+void RTPSources::DeleteOwnEntry(RTPSourceData *srcdat)
 {
-	if (owndata == 0)
-		return MEDIA_RTP_ERR_INVALID_STATE;
-
-	uint32_t ssrc = owndata->GetSSRC();
-
-	sourcelist.erase(ssrc);
+	sourcelist.erase(srcdat->GetSSRC());
 
 	totalcount--;
-	if (owndata->IsSender())
+	if (srcdat->IsSender())
 		sendercount--;
-	if (owndata->IsActive())
+	if (srcdat->IsActive())
 		activecount--;
 
-	OnRemoveSource(owndata);
+	OnRemoveSource(srcdat);
 	
-	delete owndata;
-	owndata = 0;
-	return 0;
+	delete srcdat;
 }
 
 void RTPSources::SentRTPPacket()
@@ -284,6 +336,7 @@ int RTPSources::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetime,c
 	
 	bool prevsender = srcdat->IsSender();
 	bool prevactive = srcdat->IsActive();
+	bool prevhasdata = srcdat->HasData();
 	
 	uint32_t CSRCs[RTP_MAXCSRCS];
 	int numCSRCs = rtppack->GetCSRCCount();
@@ -301,6 +354,9 @@ int RTPSources::ProcessRTPPacket(RTPPacket *rtppack,const RTPTime &receivetime,c
 	// 注意：我们不能再使用 'rtppack'，因为它可能已在
 	//       OnValidatedRTPPacket 中被删除
 
+	if (!prevhasdata && srcdat->HasData() && rtpsession)
+		rtpsession->ProcessSourceHasData();
+
 	if (!prevsender && srcdat->IsSender())
 		sendercount++;
 	if (!prevactive && srcdat->IsActive())
@@ -481,6 +537,30 @@ int RTPSources::ProcessRTCPCompoundPacket(RTCPCompoundPacket *rtcpcomppack,const
 					OnAPPPacket(p,receivetime,senderaddress);
 				}
 				break; 
+			case RTCPPacket::RTPFB:
+				{
+					RTCPRTPFBPacket *p = (RTCPRTPFBPacket *)rtcppack;
+
+					if (p->IsGenericNACK())
+						OnNACKPacket(p,receivetime,senderaddress);
+					else
+						OnFeedbackPacket(rtcppack,receivetime,senderaddress);
+				}
+				break;
+			case RTCPPacket::PSFB:
+				{
+					RTCPPSFBPacket *p = (RTCPPSFBPacket *)rtcppack;
+
+					if (p->IsPLI())
+						OnPLIPacket(p,receivetime,senderaddress);
+					else if (p->IsFIR())
+						OnFIRPacket(p,receivetime,senderaddress);
+					else if (p->IsREMB())
+						OnREMBPacket(p,receivetime,senderaddress);
+					else
+						OnFeedbackPacket(rtcppack,receivetime,senderaddress);
+				}
+				break;
 			case RTCPPacket::Unknown:
 			default:
 				{
@@ -684,7 +764,7 @@ int RTPSources::ProcessBYE(uint32_t ssrc,size_t reasonlength,const void *reasond
 		return 0;
 
 	// we'll ignore BYE packets for our own ssrc
-	if (srcdat == owndata)
+	if (srcdat->IsOwnSSRC())
 		return 0;
 	
 	prevactive = srcdat->IsActive();
@@ -797,7 +877,7 @@ void RTPSources::Timeout(const RTPTime &curtime,const RTPTime &timeoutdelay)
 		RTPTime lastmsgtime = srcdat->INF_GetLastMessageTime();
 
 		// 我们不想让自己超时
-		if ((srcdat != owndata) && (lastmsgtime < checktime)) // timeout
+		if ((!srcdat->IsOwnSSRC()) && (lastmsgtime < checktime)) // timeout
 		{
 			totalcount--;
 			if (srcdat->IsSender())
@@ -879,7 +959,7 @@ void RTPSources::BYETimeout(const RTPTime &curtime,const RTPTime &timeoutdelay)
 		{
 			RTPTime byetime = srcdat->GetBYETime();
 
-			if ((srcdat != owndata) && (checktime > byetime))
+			if ((!srcdat->IsOwnSSRC()) && (checktime > byetime))
 			{
 				totalcount--;
 				if (srcdat->IsSender())
@@ -982,7 +1062,7 @@ void RTPSources::MultipleTimeouts(const RTPTime &curtime,const RTPTime &senderti
 		{
 			RTPTime byetime = srcdat->GetBYETime();
 
-			if ((srcdat != owndata) && (byechecktime > byetime))
+			if ((!srcdat->IsOwnSSRC()) && (byechecktime > byetime))
 			{
 				it = sourcelist.erase(it);
 				continue;
@@ -995,7 +1075,7 @@ void RTPSources::MultipleTimeouts(const RTPTime &curtime,const RTPTime &senderti
 		{
 			RTPTime lastmsgtime = srcdat->INF_GetLastMessageTime();
 
-			if ((srcdat != owndata) && (lastmsgtime < generaltchecktime))
+			if ((!srcdat->IsOwnSSRC()) && (lastmsgtime < generaltchecktime))
 			{
 				it = sourcelist.erase(it);
 				continue;
@@ -1141,7 +1221,10 @@ bool RTPSources::CheckCollision(RTPSourceData *srcdat,const RTPEndpoint *sendera
 void RTPSources::OnRTPPacket(RTPPacket *pack, const RTPTime &receivetime, const RTPEndpoint *senderaddress)                               
 { 
 	if (rtpsession)
+	{
+		rtpsession->ProcessTransportCCPacket(pack, receivetime, senderaddress);
 		rtpsession->OnRTPPacket(pack, receivetime, senderaddress);
+	}
 }
 
 void RTPSources::OnRTCPCompoundPacket(RTCPCompoundPacket *pack, const RTPTime &receivetime, const RTPEndpoint *senderaddress)             
@@ -1158,7 +1241,11 @@ void RTPSources::OnSSRCCollision(RTPSourceData *srcdat, const RTPEndpoint *sende
 { 
 	if (rtpsession)
 	{
-		if (srcdat && srcdat->IsOwnSSRC())
+		if (srcdat && srcdat == ownrtxdata)
+			ownrtxcollision = true;
+		else if (srcdat && srcdat == ownfecdata)
+			ownfeccollision = true;
+		else if (srcdat && srcdat->IsOwnSSRC())
 			owncollision = true;
 		rtpsession->OnSSRCCollision(srcdat, senderaddress, isrtp);
 	}
@@ -1215,7 +1302,10 @@ void RTPSources::OnRTCPSenderReport(RTPSourceData *srcdat)
 void RTPSources::OnRTCPReceiverReport(RTPSourceData *srcdat)                                                       
 { 
 	if (rtpsession)
+	{
+		rtpsession->ProcessReceiverReport(srcdat);
 		rtpsession->OnRTCPReceiverReport(srcdat);
+	}
 }
 
 void RTPSources::OnRTCPSDESItem(RTPSourceData *srcdat, RTCPSDESPacket::ItemType t, const void *itemdata, size_t itemlength)             
@@ -1231,6 +1321,45 @@ void RTPSources::OnAPPPacket(RTCPAPPPacket *apppacket, const RTPTime &receivetim
 		rtpsession->OnAPPPacket(apppacket, receivetime, senderaddress);
 }
 
+void RTPSources::OnNACKPacket(RTCPRTPFBPacket *nackpacket, const RTPTime &receivetime, const RTPEndpoint *senderaddress)
+{ 
+	if (rtpsession)
+	{
+		rtpsession->ProcessNACKPacket(nackpacket);
+		rtpsession->OnNACKPacket(nackpacket, receivetime, senderaddress);
+	}
+}
+
+void RTPSources::OnPLIPacket(RTCPPSFBPacket *plipacket, const RTPTime &receivetime, const RTPEndpoint *senderaddress)
+{ 
+	if (rtpsession)
+		rtpsession->OnPLIPacket(plipacket, receivetime, senderaddress);
+}
+
+void RTPSources::OnFIRPacket(RTCPPSFBPacket *firpacket, const RTPTime &receivetime, const RTPEndpoint *senderaddress)
+{ 
+	if (rtpsession)
+		rtpsession->OnFIRPacket(firpacket, receivetime, senderaddress);
+}
+
+void RTPSources::OnREMBPacket(RTCPPSFBPacket *rembpacket, const RTPTime &receivetime, const RTPEndpoint *senderaddress)
+{ 
+	if (rtpsession)
+	{
+		rtpsession->ProcessREMBPacket(rembpacket, receivetime);
+		rtpsession->OnREMBPacket(rembpacket, receivetime, senderaddress);
+	}
+}
+
+void RTPSources::OnFeedbackPacket(RTCPPacket *fbpacket, const RTPTime &receivetime, const RTPEndpoint *senderaddress)
+{ 
+	if (rtpsession)
+	{
+		rtpsession->ProcessFeedbackPacket(fbpacket, receivetime);
+		rtpsession->OnFeedbackPacket(fbpacket, receivetime, senderaddress);
+	}
+}
+
 void RTPSources::OnUnknownPacketType(RTCPPacket *rtcppack, const RTPTime &receivetime, const RTPEndpoint *senderaddress)                      
 { 
 	if (rtpsession)
@@ -1252,6 +1381,6 @@ void RTPSources::OnNoteTimeout(RTPSourceData *srcdat)
 void RTPSources::OnValidatedRTPPacket(RTPSourceData *srcdat, RTPPacket *rtppack, bool isonprobation, bool *ispackethandled)                            
 { 
 	if (rtpsession)
-		rtpsession->OnValidatedRTPPacket(srcdat, rtppack, isonprobation, ispackethandled);
+		rtpsession->ProcessValidatedRTPPacket(srcdat, rtppack, isonprobation, ispackethandled);
 }
 
@@ -50,10 +50,14 @@ public:
 	/** 清除源表格。 */
 	void Clear();
 	
-	/** 清除自己的冲突标志（会话特定）。 */
-	void ClearOwnCollisionFlag()							{ owncollision = false; }
+	/** 清除自己的冲突标志，包括RTX和FEC SSRC的冲突标志（会话特定）。 */
+	void ClearOwnCollisionFlag()							{ owncollision = false; ownrtxcollision = false; ownfeccollision = false; }
 	/** 返回是否检测到自己的冲突（会话特定）。 */
 	bool DetectedOwnCollision() const							{ return owncollision; }
+	/** 返回是否检测到RTX SSRC的冲突（会话特定）。 */
+	bool DetectedOwnRTXCollision() const						{ return ownrtxcollision; }
+	/** 返回是否检测到FEC SSRC的冲突（会话特定）。 */
+	bool DetectedOwnFECCollision() const						{ return ownfeccollision; }
 #ifdef RTP_SUPPORT_PROBATION
 	/** 更改当前的试用期类型。 */
 	void SetProbationType(ProbationType probtype)							{ probationtype = probtype; }
@@ -65,6 +69,24 @@ public:
 	/** 删除我们自己的SSRC标识符的条目。 */
 	int DeleteOwnSSRC();
 
+	/** 为我们发送RTX数据包（RFC 4588）使用的SSRC标识符创建一个条目。
+	 *  为我们发送RTX数据包（RFC 4588）使用的SSRC标识符创建一个条目。该条目和 CreateOwnSSRC 创建的条目一样
+	 *  标记为自己的SSRC，因此不会超时，也不会为它生成报告块；其他参与者使用这个SSRC时会检测到冲突，
+	 *  参见 DetectedOwnRTXCollision。
+	 */
+	int CreateOwnRTXSSRC(uint32_t ssrc);
+
+	/** 删除RTX SSRC标识符的条目。 */
+	int DeleteOwnRTXSSRC();
+
+	/** 为我们发送FEC数据包使用的SSRC标识符创建一个条目。和RTX SSRC的条目一样标记为自己的SSRC，
+	 *  其他参与者使用这个SSRC时会检测到冲突，参见 DetectedOwnFECCollision。
+	 */
+	int CreateOwnFECSSRC(uint32_t ssrc);
+
+	/** 删除FEC SSRC标识符的条目。 */
+	int DeleteOwnFECSSRC();
+
 	/** 如果我们自己的会话发送了RTP数据包，应该调用此函数。 
 	 *  如果我们自己的会话发送了RTP数据包，应该调用此函数。
 	 *  对于我们自己的SSRC条目，发送者标志基于传出数据包而不是传入数据包进行更新。
@@ -185,6 +207,12 @@ public:
 	/** 如果存在，返回由CreateOwnSSRC创建的条目的RTPSourceData实例。 */
 	RTPSourceData *GetOwnSourceInfo()								{ return owndata; }
 
+	/** 如果存在，返回由CreateOwnRTXSSRC创建的条目的RTPSourceData实例。 */
+	RTPSourceData *GetOwnRTXSourceInfo()							{ return ownrtxdata; }
+
+	/** 如果存在，返回由CreateOwnFECSSRC创建的条目的RTPSourceData实例。 */
+	RTPSourceData *GetOwnFECSourceInfo()							{ return ownfecdata; }
+
 	/** 假设当前时间是 \c curtime，对在前一个时间间隔 \c timeoutdelay 期间我们没有听到消息的成员进行超时处理。
 	 */
 	void Timeout(const RTPTime &curtime,const RTPTime &timeoutdelay);
@@ -267,6 +295,26 @@ protected:
 	virtual void OnAPPPacket(RTCPAPPPacket *apppacket,const RTPTime &receivetime,
 	                         const RTPEndpoint *senderaddress);
 
+	/** 当在时间 \c receivetime 从地址 \c senderaddress 接收到通用NACK数据包 \c nackpacket 时调用。 */
+	virtual void OnNACKPacket(RTCPRTPFBPacket *nackpacket,const RTPTime &receivetime,
+	                          const RTPEndpoint *senderaddress);
+
+	/** 当接收到图像丢失指示（PLI）数据包 \c plipacket 时调用。 */
+	virtual void OnPLIPacket(RTCPPSFBPacket *plipacket,const RTPTime &receivetime,
+	                         const RTPEndpoint *senderaddress);
+
+	/** 当接收到完整帧内请求（FIR）数据包 \c firpacket 时调用。 */
+	virtual void OnFIRPacket(RTCPPSFBPacket *firpacket,const RTPTime &receivetime,
+	                         const RTPEndpoint *senderaddress);
+
+	/** 当接收到REMB数据包 \c rembpacket 时调用。 */
+	virtual void OnREMBPacket(RTCPPSFBPacket *rembpacket,const RTPTime &receivetime,
+	                          const RTPEndpoint *senderaddress);
+
+	/** 当接收到其他类型的RTPFB或PSFB反馈数据包 \c fbpacket 时调用。 */
+	virtual void OnFeedbackPacket(RTCPPacket *fbpacket,const RTPTime &receivetime,
+	                              const RTPEndpoint *senderaddress);
+
 	/** 当检测到未知的RTCP数据包类型时调用。 */
 	virtual void OnUnknownPacketType(RTCPPacket *rtcppack,const RTPTime &receivetime,
 	                                 const RTPEndpoint *senderaddress);
@@ -284,6 +332,8 @@ protected:
 	virtual void OnValidatedRTPPacket(RTPSourceData *srcdat, RTPPacket *rtppack, bool isonprobation, bool *ispackethandled);
 private:
 	void ClearSourceList();
+	int CreateOwnEntry(uint32_t ssrc,RTPSourceData **srcdat);
+	void DeleteOwnEntry(RTPSourceData *srcdat);
 	int ObtainSourceDataInstance(uint32_t ssrc,RTPSourceData **srcdat,bool *created);
 	int GetRTCPSourceData(uint32_t ssrc,const RTPEndpoint *senderaddress,RTPSourceData **srcdat,bool *newsource);
 	bool CheckCollision(RTPSourceData *srcdat,const RTPEndpoint *senderaddress,bool isrtp);
@@ -300,10 +350,14 @@ private:
 #endif // RTP_SUPPORT_PROBATION
 
 	RTPSourceData *owndata;
+	RTPSourceData *ownrtxdata;
+	RTPSourceData *ownfecdata;
 	
 	// 会话特定成员
 	RTPSession *rtpsession;
 	bool owncollision;
+	bool ownrtxcollision;
+	bool ownfeccollision;
 	
 	friend class RTPSourceData;
 };
@@ -0,0 +1,344 @@
+#include "media_rtp_transport_cc.h"
+#include "media_rtp_errors.h"
+#include <string.h>
+
+// 到达时间和反馈中时间差的单位为250微秒，参考时间的单位为64毫秒（256个单位）
+#define RTP_TRANSPORTCC_TICKUS							250
+#define RTP_TRANSPORTCC_TICKSPERREFERENCE					256
+
+RTPTransportCCRecorder::RTPTransportCCRecorder()
+{
+	Reset();
+}
+
+void RTPTransportCCRecorder::Reset()
+{
+	init = false;
+	basetime = 0;
+	highestseqnr = 0;
+	nextseqnr = 0;
+	feedbackcount = 0;
+	memset(received,0,sizeof(received));
+	numpackets = 0;
+	numfeedbacks = 0;
+}
+
+void RTPTransportCCRecorder::SetReceived(uint32_t extseqnr,bool r)
+{
+	uint32_t i = extseqnr%RTP_TRANSPORTCC_WINDOWSIZE;
+	uint64_t bit = ((uint64_t)1)<<(i%64);
+
+	if (r)
+		received[i/64] |= bit;
+	else
+		received[i/64] &= ~bit;
+}
+
+void RTPTransportCCRecorder::ProcessPacket(uint16_t transportseqnr,const RTPTime &arrivaltime)
+{
+	int64_t t = arrivaltime.GetSeconds()*1000000+(int64_t)arrivaltime.GetMicroSeconds();
+	uint32_t extseqnr;
+
+	if (!init)
+	{
+		// 从65536开始扩展，使得乱序到达的更早的数据包不会下溢
+		init = true;
+		basetime = t;
+		extseqnr = 65536+(uint32_t)transportseqnr;
+		highestseqnr = extseqnr;
+		nextseqnr = extseqnr;
+	}
+	else
+	{
+		int16_t diff = (int16_t)(transportseqnr-(uint16_t)highestseqnr);
+
+		extseqnr = (uint32_t)((int64_t)highestseqnr+diff);
+		if (extseqnr > highestseqnr)
+		{
+			uint32_t d = extseqnr-highestseqnr;
+
+			if (d >= RTP_TRANSPORTCC_WINDOWSIZE)
+				memset(received,0,sizeof(received));
+			else
+			{
+				for (uint32_t s = highestseqnr+1 ; s <= extseqnr ; s++)
+					SetReceived(s,false);
+			}
+			highestseqnr = extseqnr;
+
+			// 来不及报告就移出窗口的数据包被丢弃
+			if (highestseqnr+1-nextseqnr > RTP_TRANSPORTCC_WINDOWSIZE)
+				nextseqnr = highestseqnr+1-RTP_TRANSPORTCC_WINDOWSIZE;
+		}
+		else if (extseqnr < nextseqnr) // 已经报告过
+			return;
+
+		if (IsReceived(extseqnr)) // 重复的数据包
+			return;
+	}
+
+	int64_t ticks = (t-basetime)/RTP_TRANSPORTCC_TICKUS;
+
+	if (ticks < 0)
+		ticks = 0;
+	else if (ticks > 0xFFFFFFFF)
+		ticks = 0xFFFFFFFF;
+
+	SetReceived(extseqnr,true);
+	arrivalticks[extseqnr%RTP_TRANSPORTCC_WINDOWSIZE] = (uint32_t)ticks;
+	numpackets++;
+}
+
+int RTPTransportCCRecorder::BuildFeedback(uint8_t *fci,size_t maxlen,size_t *fcilen)
+{
+	if (!HasPendingFeedback())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (maxlen < 16)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	uint32_t start = nextseqnr;
+	uint32_t maxcount = highestseqnr+1-start;
+	bool haveref = false;
+	int64_t reference = 0;
+	int64_t prev = 0;
+	size_t deltabytes = 0;
+	uint32_t count;
+
+	if (maxcount > 0xFFFF)
+		maxcount = 0xFFFF;
+
+	// 第一遍：确定放得下的数据包数量以及每个数据包的状态符号。
+	// 每个状态块至少包含7个状态（最后一个除外），因此状态块最多占 2*ceil(count/7) 字节
+	for (count = 0 ; count < maxcount ; count++)
+	{
+		uint32_t s = start+count;
+		uint8_t symbol = 0;
+		size_t need = 0;
+		int64_t ticks = 0;
+
+		if (IsReceived(s))
+		{
+			ticks = arrivalticks[s%RTP_TRANSPORTCC_WINDOWSIZE];
+			if (!haveref)
+			{
+				haveref = true;
+				reference = ticks/RTP_TRANSPORTCC_TICKSPERREFERENCE;
+				prev = reference*RTP_TRANSPORTCC_TICKSPERREFERENCE;
+			}
+
+			int64_t delta = ticks-prev;
+
+			if (delta >= 0 && delta <= 255)
+			{
+				symbol = 1;
+				need = 1;
+			}
+			else if (delta >= -32768 && delta <= 32767)
+			{
+				symbol = 2;
+				need = 2;
+			}
+			else // 时间差无法编码，从这里开始下一个反馈
+				break;
+		}
+
+		size_t len = 8+2*((count+7)/7)+deltabytes+need;
+
+		if (((len+3)&~((size_t)3)) > maxlen)
+			break;
+
+		symbols[count] = symbol;
+		deltabytes += need;
+		if (symbol != 0)
+			prev = ticks;
+	}
+
+	fci[0] = (uint8_t)(start>>8);
+	fci[1] = (uint8_t)start;
+	fci[2] = (uint8_t)(count>>8);
+	fci[3] = (uint8_t)count;
+	fci[4] = (uint8_t)(reference>>16);
+	fci[5] = (uint8_t)(reference>>8);
+	fci[6] = (uint8_t)reference;
+	fci[7] = feedbackcount++;
+
+	// 第二遍：状态块。优先使用游程块，其次是1位状态向量（14个状态），最后是2位状态向量（7个状态）
+	size_t pos = 8;
+	uint32_t i = 0;
+
+	while (i < count)
+	{
+		uint8_t symbol = symbols[i];
+		uint32_t run = 1;
+		uint16_t chunk;
+
+		while (i+run < count && symbols[i+run] == symbol && run < 0x1FFF)
+			run++;
+
+		if (run >= 14)
+		{
+			chunk = (uint16_t)((symbol<<13)|run);
+			i += run;
+		}
+		else
+		{
+			uint32_t n = count-i;
+			bool large = false;
+
+			if (n > 14)
+				n = 14;
+			for (uint32_t k = 0 ; k < n ; k++)
+			{
+				if (symbols[i+k] == 2)
+					large = true;
+			}
+
+			if (!large)
+			{
+				chunk = 0x8000;
+				for (uint32_t k = 0 ; k < n ; k++)
+					chunk |= (uint16_t)(symbols[i+k]<<(13-k));
+			}
+			else
+			{
+				if (n > 7)
+					n = 7;
+				chunk = 0xC000;
+				for (uint32_t k = 0 ; k < n ; k++)
+					chunk |= (uint16_t)(symbols[i+k]<<(2*(6-k)));
+			}
+			i += n;
+		}
+		fci[pos++] = (uint8_t)(chunk>>8);
+		fci[pos++] = (uint8_t)chunk;
+	}
+
+	// 接收时间差
+	prev = reference*RTP_TRANSPORTCC_TICKSPERREFERENCE;
+	for (i = 0 ; i < count ; i++)
+	{
+		if (symbols[i] == 0)
+			continue;
+
+		int64_t ticks = arrivalticks[(start+i)%RTP_TRANSPORTCC_WINDOWSIZE];
+		int64_t delta = ticks-prev;
+
+		if (symbols[i] == 1)
+			fci[pos++] = (uint8_t)delta;
+		else
+		{
+			fci[pos++] = (uint8_t)(((uint16_t)(int16_t)delta)>>8);
+			fci[pos++] = (uint8_t)delta;
+		}
+		prev = ticks;
+	}
+
+	while ((pos&0x03) != 0)
+		fci[pos++] = 0;
+
+	nextseqnr = start+count;
+	numfeedbacks++;
+	*fcilen = pos;
+	return 0;
+}
+
+RTPTransportCCFeedback::RTPTransportCCFeedback()
+{
+	baseseqnr = 0;
+	feedbackcount = 0;
+	referencetime = 0;
+}
+
+int RTPTransportCCFeedback::Parse(const uint8_t *fci,size_t fcilen)
+{
+	int status;
+
+	symbols.clear();
+	arrivaltimes.clear();
+	if ((status = ParseFCI(fci,fcilen)) < 0)
+	{
+		symbols.clear();
+		arrivaltimes.clear();
+	}
+	return status;
+}
+
+int RTPTransportCCFeedback::ParseFCI(const uint8_t *fci,size_t fcilen)
+{
+	if (fcilen < 8)
+		return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+
+	baseseqnr = (uint16_t)((fci[0]<<8)|fci[1]);
+
+	size_t count = (size_t)((fci[2]<<8)|fci[3]);
+	int32_t reference = (int32_t)(((uint32_t)fci[4]<<16)|((uint32_t)fci[5]<<8)|fci[6]);
+
+	if (reference & 0x800000) // 24位有符号数
+		reference -= 0x1000000;
+	referencetime = (int64_t)reference*RTP_TRANSPORTCC_TICKSPERREFERENCE*RTP_TRANSPORTCC_TICKUS;
+	feedbackcount = fci[7];
+
+	symbols.reserve(count);
+	arrivaltimes.reserve(count);
+
+	size_t pos = 8;
+
+	while (symbols.size() < count)
+	{
+		if (pos+2 > fcilen)
+			return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+
+		uint16_t chunk = (uint16_t)((fci[pos]<<8)|fci[pos+1]);
+
+		pos += 2;
+		if ((chunk & 0x8000) == 0) // 游程块
+		{
+			uint8_t symbol = (uint8_t)((chunk>>13)&0x03);
+			size_t run = chunk&0x1FFF;
+
+			for (size_t k = 0 ; k < run && symbols.size() < count ; k++)
+				symbols.push_back(symbol);
+		}
+		else if ((chunk & 0x4000) == 0) // 1位状态向量
+		{
+			for (int k = 13 ; k >= 0 && symbols.size() < count ; k--)
+				symbols.push_back((uint8_t)((chunk>>k)&0x01));
+		}
+		else // 2位状态向量
+		{
+			for (int k = 6 ; k >= 0 && symbols.size() < count ; k--)
+				symbols.push_back((uint8_t)((chunk>>(2*k))&0x03));
+		}
+	}
+
+	int64_t t = referencetime;
+
+	for (size_t i = 0 ; i < count ; i++)
+	{
+		int64_t delta;
+
+		switch (symbols[i])
+		{
+		case 0:
+			arrivaltimes.push_back(0);
+			continue;
+		case 1:
+			if (pos+1 > fcilen)
+				return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+			delta = fci[pos];
+			pos++;
+			break;
+		case 2:
+			if (pos+2 > fcilen)
+				return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+			delta = (int16_t)((fci[pos]<<8)|fci[pos+1]);
+			pos += 2;
+			break;
+		default:
+			return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+		}
+		t += delta*RTP_TRANSPORTCC_TICKUS;
+		arrivaltimes.push_back(t);
+	}
+	return 0;
+}
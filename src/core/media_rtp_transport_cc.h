@@ -0,0 +1,102 @@
+/**
+ * \file media_rtp_transport_cc.h
+ */
+
+#ifndef RTPTRANSPORTCC_H
+
+#define RTPTRANSPORTCC_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_utils.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/** 记录带有传输层序列号的数据包的到达时间，并生成传输层拥塞控制反馈（transport-cc）。
+ *  最近 RTP_TRANSPORTCC_WINDOWSIZE 个传输层序列号的接收状态保存在位图中，到达时间以
+ *  相对于第一个数据包的250微秒为单位保存（与反馈中的时间差单位相同），每个数据包的处理
+ *  开销为常数且不需要分配内存。反馈的格式参见 draft-holmer-rmcat-transport-wide-cc-extensions-01。
+ */
+class RTPTransportCCRecorder
+{
+public:
+	/** 构造一个空的记录器。 */
+	RTPTransportCCRecorder();
+
+	/** 清除所有已记录的数据包。 */
+	void Reset();
+
+	/** 记录传输层序列号为 \c transportseqnr 的数据包在 \c arrivaltime 到达。
+	 *  已经报告过或者已移出窗口的数据包会被忽略。
+	 */
+	void ProcessPacket(uint16_t transportseqnr,const RTPTime &arrivaltime);
+
+	/** 如果有尚未报告的数据包则返回 \c true。 */
+	bool HasPendingFeedback() const								{ return init && nextseqnr <= highestseqnr; }
+
+	/** 将尚未报告的数据包编码为一个transport-cc反馈控制信息，写入最多 \c maxlen 字节的 \c fci，
+	 *  实际长度（四的倍数）存入 \c fcilen。放不下的数据包留给下一个反馈。
+	 */
+	int BuildFeedback(uint8_t *fci,size_t maxlen,size_t *fcilen);
+
+	/** 返回记录的数据包数量。 */
+	uint32_t GetNumPackets() const								{ return numpackets; }
+
+	/** 返回生成的反馈数量。 */
+	uint32_t GetNumFeedbacks() const							{ return numfeedbacks; }
+private:
+	bool IsReceived(uint32_t extseqnr) const						{ uint32_t i = extseqnr%RTP_TRANSPORTCC_WINDOWSIZE; return (received[i/64]&(((uint64_t)1)<<(i%64))) != 0; }
+	void SetReceived(uint32_t extseqnr,bool r);
+
+	bool init;
+	int64_t basetime;
+	uint32_t highestseqnr;
+	uint32_t nextseqnr;
+	uint8_t feedbackcount;
+	uint64_t received[RTP_TRANSPORTCC_WINDOWSIZE/64];
+	uint32_t arrivalticks[RTP_TRANSPORTCC_WINDOWSIZE];
+	uint8_t symbols[RTP_TRANSPORTCC_WINDOWSIZE];
+
+	uint32_t numpackets;
+	uint32_t numfeedbacks;
+};
+
+/** 解析transport-cc反馈控制信息（RTCPRTPFBPacket::GetFCIData）。 */
+class RTPTransportCCFeedback
+{
+public:
+	/** 构造一个空的反馈。 */
+	RTPTransportCCFeedback();
+
+	/** 解析长度为 \c fcilen 的反馈控制信息 \c fci。 */
+	int Parse(const uint8_t *fci,size_t fcilen);
+
+	/** 返回第一个被报告的数据包的传输层序列号。 */
+	uint16_t GetBaseSequenceNumber() const							{ return baseseqnr; }
+
+	/** 返回被报告的数据包数量。 */
+	int GetPacketStatusCount() const							{ return (int)symbols.size(); }
+
+	/** 返回反馈包计数，可用于检测丢失的反馈。 */
+	uint8_t GetFeedbackPacketCount() const							{ return feedbackcount; }
+
+	/** 返回参考时间（以微秒为单位，接收方的任意时间基准）。 */
+	int64_t GetReferenceTime() const							{ return referencetime; }
+
+	/** 如果第 \c index 个数据包已被接收则返回 \c true（\c index 从0到 GetPacketStatusCount()-1）。 */
+	bool IsReceived(int index) const							{ return symbols[index] != 0; }
+
+	/** 返回第 \c index 个数据包的到达时间（以微秒为单位，与参考时间使用同一时间基准）。 */
+	int64_t GetArrivalTime(int index) const							{ return arrivaltimes[index]; }
+private:
+	int ParseFCI(const uint8_t *fci,size_t fcilen);
+
+	uint16_t baseseqnr;
+	uint8_t feedbackcount;
+	int64_t referencetime;
+	std::vector<uint8_t> symbols;
+	std::vector<int64_t> arrivaltimes;
+};
+
+#endif // RTPTRANSPORTCC_H
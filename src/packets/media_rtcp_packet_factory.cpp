@@ -9,6 +9,7 @@
 #include "media_rtcp_scheduler.h"
 #include "media_rtp_source_data.h"
 #include <cstring>
+#include <algorithm>
 
 #ifdef RTP_SUPPORT_NETINET_IN
 #include <netinet/in.h>
@@ -259,6 +260,121 @@ RTCPSDESPacket::RTCPSDESPacket(uint8_t *data,size_t datalength)
 	knownformat = true;
 }
 
+// =============================================================================
+// RTCPRTPFBPacket实现
+// =============================================================================
+
+RTCPRTPFBPacket::RTCPRTPFBPacket(uint8_t *data,size_t datalength)
+	: RTCPPacket(RTPFB,data,datalength)
+{
+	knownformat = false;
+	fcilen = 0;
+	
+	RTCPCommonHeader *hdr;
+	size_t len = datalength;
+	
+	hdr = (RTCPCommonHeader *)data;
+	if (hdr->padding)
+	{
+		uint8_t padcount = data[datalength-1];
+		if ((padcount & 0x03) != 0) // 不是 4 的倍数！（参见 rfc 3550 p 37）
+			return;
+		if (((size_t)padcount) >= len)
+			return;
+		len -= (size_t)padcount;
+	}
+	
+	if (len < (sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2))
+		return;
+	len -= (sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2);
+
+	if (hdr->count == RTCP_RTPFB_FMT_NACK)
+	{
+		// 通用 NACK 至少需要一个 PID/BLP 项（参见 rfc 4585 6.2.1）
+		if (len == 0 || (len%sizeof(uint32_t)) != 0)
+			return;
+	}
+
+	fcilen = len;
+	knownformat = true;
+}
+
+int RTCPRTPFBPacket::GetNACKSequenceNumbers(uint16_t *seqnrs,int maxcount) const
+{
+	int num = GetNACKCount();
+	int count = 0;
+
+	for (int i = 0 ; i < num && count < maxcount ; i++)
+	{
+		uint16_t pid = GetNACKPID(i);
+		uint16_t blp = GetNACKBLP(i);
+
+		seqnrs[count++] = pid;
+		for (int bit = 0 ; bit < 16 && count < maxcount ; bit++)
+		{
+			if (blp & (1 << bit))
+				seqnrs[count++] = (uint16_t)(pid+bit+1);
+		}
+	}
+	return count;
+}
+
+// =============================================================================
+// RTCPPSFBPacket实现
+// =============================================================================
+
+RTCPPSFBPacket::RTCPPSFBPacket(uint8_t *data,size_t datalength)
+	: RTCPPacket(PSFB,data,datalength)
+{
+	knownformat = false;
+	fcilen = 0;
+	isremb = false;
+	
+	RTCPCommonHeader *hdr;
+	size_t len = datalength;
+	
+	hdr = (RTCPCommonHeader *)data;
+	if (hdr->padding)
+	{
+		uint8_t padcount = data[datalength-1];
+		if ((padcount & 0x03) != 0) // 不是 4 的倍数！（参见 rfc 3550 p 37）
+			return;
+		if (((size_t)padcount) >= len)
+			return;
+		len -= (size_t)padcount;
+	}
+	
+	if (len < (sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2))
+		return;
+	len -= (sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2);
+
+	uint8_t *fci = data+sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2;
+
+	switch (hdr->count)
+	{
+	case RTCP_PSFB_FMT_FIR:
+		// 每个 FIR 条目为 8 字节（参见 rfc 5104 4.3.1）
+		if (len == 0 || (len%(sizeof(uint32_t)*2)) != 0)
+			return;
+		break;
+	case RTCP_PSFB_FMT_AFB:
+		// REMB：'R' 'E' 'M' 'B' | Num SSRC | BR Exp | BR Mantissa | SSRC 列表
+		if (len >= sizeof(uint32_t)*2 && fci[0] == 'R' && fci[1] == 'E' && fci[2] == 'M' && fci[3] == 'B')
+		{
+			size_t numssrcs = (size_t)fci[4];
+			if (len < sizeof(uint32_t)*(2+numssrcs))
+				return;
+			isremb = true;
+		}
+		break;
+	default:
+		break;
+	}
+
+	fcilen = len;
+	knownformat = true;
+}
+
 // =============================================================================
 // RTCPCompoundPacket实现
 // =============================================================================
@@ -267,6 +383,7 @@ RTCPCompoundPacket::RTCPCompoundPacket(RTPRawPacket &rawpack)
 {
 	compoundpacket = 0;
 	compoundpacketlength = 0;
+	releaser = 0;
 	error = 0;
 	
 	if (rawpack.IsRTP())
@@ -285,6 +402,7 @@ RTCPCompoundPacket::RTCPCompoundPacket(RTPRawPacket &rawpack)
 	compoundpacket = rawpack.GetData();
 	compoundpacketlength = rawpack.GetDataLength();
 	deletepacket = true;
+	releaser = rawpack.GetDataReleaser();
 
 	rawpack.ZeroData();
 	
@@ -295,6 +413,7 @@ RTCPCompoundPacket::RTCPCompoundPacket(uint8_t *packet, size_t packetlen, bool d
 {
 	compoundpacket = 0;
 	compoundpacketlength = 0;
+	releaser = 0;
 	
 	error = ParseData(packet,packetlen);
 	if (error < 0)
@@ -313,6 +432,7 @@ RTCPCompoundPacket::RTCPCompoundPacket()
 	compoundpacketlength = 0;
 	error = 0;
 	deletepacket = true;
+	releaser = 0;
 }
 
 int RTCPCompoundPacket::ParseData(uint8_t *data, size_t datalen)
@@ -386,6 +506,12 @@ int RTCPCompoundPacket::ParseData(uint8_t *data, size_t datalen)
 		case RTP_RTCPTYPE_APP:
 			p = new RTCPAPPPacket(data,length);
 			break;
+		case RTP_RTCPTYPE_RTPFB:
+			p = new RTCPRTPFBPacket(data,length);
+			break;
+		case RTP_RTCPTYPE_PSFB:
+			p = new RTCPPSFBPacket(data,length);
+			break;
 		default:
 			p = new RTCPUnknownPacket(data,length);
 		}
@@ -414,7 +540,12 @@ RTCPCompoundPacket::~RTCPCompoundPacket()
 {
 	ClearPacketList();
 	if (compoundpacket && deletepacket)
-		delete [] compoundpacket;
+	{
+		if (releaser)
+			releaser->ReleaseData(compoundpacket);
+		else
+			delete [] compoundpacket;
+	}
 }
 
 void RTCPCompoundPacket::ClearPacketList()
@@ -435,6 +566,7 @@ RTCPCompoundPacketBuilder::RTCPCompoundPacketBuilder() : RTCPCompoundPacket(), r
 {
 	byesize = 0;
 	appsize = 0;
+	fbsize = 0;
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	unknownsize = 0;
 #endif // RTP_SUPPORT_RTCPUNKNOWN
@@ -467,6 +599,11 @@ void RTCPCompoundPacketBuilder::ClearBuildBuffers()
 		if ((*it).packetdata)
 			delete [] (*it).packetdata;
 	}
+	for (it = fbpackets.begin() ; it != fbpackets.end() ; it++)
+	{
+		if ((*it).packetdata)
+			delete [] (*it).packetdata;
+	}
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	for (it = unknownpackets.begin() ; it != unknownpackets.end() ; it++)
 	{
@@ -477,11 +614,13 @@ void RTCPCompoundPacketBuilder::ClearBuildBuffers()
 
 	byepackets.clear();
 	apppackets.clear();
+	fbpackets.clear();
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	unknownpackets.clear();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 	byesize = 0;
 	appsize = 0;
+	fbsize = 0;
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	unknownsize = 0;
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
@@ -502,6 +641,7 @@ int RTCPCompoundPacketBuilder::InitBuild(size_t maxpacketsize)
 	external = false;
 	byesize = 0;
 	appsize = 0;
+	fbsize = 0;
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	unknownsize = 0;
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
@@ -525,6 +665,7 @@ int RTCPCompoundPacketBuilder::InitBuild(void *externalbuffer,size_t buffersize)
 	external = true;
 	byesize = 0;
 	appsize = 0;
+	fbsize = 0;
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 	unknownsize = 0;
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
@@ -543,9 +684,9 @@ int RTCPCompoundPacketBuilder::StartSenderReport(uint32_t senderssrc,const RTPNT
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalsize = byesize+appsize+sdes.NeededBytes();
+	size_t totalsize = byesize+appsize+fbsize+sdes.NeededBytes();
 #else
-	size_t totalsize = byesize+appsize+unknownsize+sdes.NeededBytes();
+	size_t totalsize = byesize+appsize+fbsize+unknownsize+sdes.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 	size_t sizeleft = maximumpacketsize-totalsize;
 	size_t neededsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t)+sizeof(RTCPSenderReport);
@@ -577,9 +718,9 @@ int RTCPCompoundPacketBuilder::StartReceiverReport(uint32_t senderssrc)
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalsize = byesize+appsize+sdes.NeededBytes();
+	size_t totalsize = byesize+appsize+fbsize+sdes.NeededBytes();
 #else
-	size_t totalsize = byesize+appsize+unknownsize+sdes.NeededBytes();
+	size_t totalsize = byesize+appsize+fbsize+unknownsize+sdes.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 	size_t sizeleft = maximumpacketsize-totalsize;
 	size_t neededsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t);
@@ -607,9 +748,9 @@ int RTCPCompoundPacketBuilder::AddReportBlock(uint32_t ssrc,uint8_t fractionlost
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalothersize = byesize+appsize+sdes.NeededBytes();
+	size_t totalothersize = byesize+appsize+fbsize+sdes.NeededBytes();
 #else
-	size_t totalothersize = byesize+appsize+unknownsize+sdes.NeededBytes();
+	size_t totalothersize = byesize+appsize+fbsize+unknownsize+sdes.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 	size_t reportsizewithextrablock = report.NeededBytesWithExtraReportBlock();
 	
@@ -644,9 +785,9 @@ int RTCPCompoundPacketBuilder::AddSDESSource(uint32_t ssrc)
 		return MEDIA_RTP_ERR_INVALID_STATE;
 
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = byesize+appsize+report.NeededBytes();
+	size_t totalotherbytes = byesize+appsize+fbsize+report.NeededBytes();
 #else
-	size_t totalotherbytes = byesize+appsize+unknownsize+report.NeededBytes();
+	size_t totalotherbytes = byesize+appsize+fbsize+unknownsize+report.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 	size_t sdessizewithextrasource = sdes.NeededBytesWithExtraSource();
 
@@ -679,9 +820,9 @@ int RTCPCompoundPacketBuilder::AddSDESNormalItem(RTCPSDESPacket::ItemType t,cons
 	}
 
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = byesize+appsize+report.NeededBytes();
+	size_t totalotherbytes = byesize+appsize+fbsize+report.NeededBytes();
 #else
-	size_t totalotherbytes = byesize+appsize+unknownsize+report.NeededBytes();
+	size_t totalotherbytes = byesize+appsize+fbsize+unknownsize+report.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 	size_t sdessizewithextraitem = sdes.NeededBytesWithExtraItem(itemlength);
 
@@ -732,9 +873,9 @@ int RTCPCompoundPacketBuilder::AddBYEPacket(uint32_t *ssrcs,uint8_t numssrcs,con
 	}
 
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = appsize+byesize+sdes.NeededBytes()+report.NeededBytes();
+	size_t totalotherbytes = appsize+fbsize+byesize+sdes.NeededBytes()+report.NeededBytes();
 #else
-	size_t totalotherbytes = appsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
+	size_t totalotherbytes = appsize+fbsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 
 	if ((totalotherbytes + packsize) > maximumpacketsize)
@@ -795,9 +936,9 @@ int RTCPCompoundPacketBuilder::AddAPPPacket(uint8_t subtype,uint32_t ssrc,const
 	
 	size_t packsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2+appdatalen;
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	size_t totalotherbytes = appsize+byesize+sdes.NeededBytes()+report.NeededBytes();
+	size_t totalotherbytes = appsize+fbsize+byesize+sdes.NeededBytes()+report.NeededBytes();
 #else
-	size_t totalotherbytes = appsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
+	size_t totalotherbytes = appsize+fbsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 
 	if ((totalotherbytes + packsize) > maximumpacketsize)
@@ -835,6 +976,200 @@ int RTCPCompoundPacketBuilder::AddAPPPacket(uint8_t subtype,uint32_t ssrc,const
 	return 0;
 }
 
+int RTCPCompoundPacketBuilder::AllocateFeedbackPacket(uint8_t packettype,uint8_t fmt,uint32_t senderssrc,uint32_t mediassrc,
+                                                      size_t fcilen,uint8_t **fci)
+{
+	if (!arebuilding)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (packettype != RTP_RTCPTYPE_RTPFB && packettype != RTP_RTCPTYPE_PSFB)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	if (fmt > 31)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	if ((fcilen%4) != 0)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	size_t fciwords = fcilen/4;
+
+	if ((fciwords+2) > 65535)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+
+	size_t packsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2+fcilen;
+#ifndef RTP_SUPPORT_RTCPUNKNOWN
+	size_t totalotherbytes = appsize+fbsize+byesize+sdes.NeededBytes()+report.NeededBytes();
+#else
+	size_t totalotherbytes = appsize+fbsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
+#endif // RTP_SUPPORT_RTCPUNKNOWN 
+
+	if ((totalotherbytes + packsize) > maximumpacketsize)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+
+	uint8_t *buf;
+	
+	buf = new uint8_t[packsize];
+	if (buf == 0)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+
+	RTCPCommonHeader *hdr = (RTCPCommonHeader *)buf;
+
+	hdr->version = 2;
+	hdr->padding = 0;
+	hdr->count = fmt;
+	
+	hdr->length = htons((uint16_t)(fciwords+2));
+	hdr->packettype = packettype;
+	
+	uint32_t *sources = (uint32_t *)(buf+sizeof(RTCPCommonHeader));
+	sources[0] = htonl(senderssrc);
+	sources[1] = htonl(mediassrc);
+
+	fbpackets.push_back(Buffer(buf,packsize));
+	fbsize += packsize;
+
+	*fci = buf+sizeof(RTCPCommonHeader)+sizeof(uint32_t)*2;
+	return 0;
+}
+
+int RTCPCompoundPacketBuilder::AddFeedbackPacket(uint8_t packettype,uint8_t fmt,uint32_t senderssrc,uint32_t mediassrc,
+                                                 const void *fci,size_t fcilen)
+{
+	uint8_t *fcibuf;
+	int status;
+
+	if ((status = AllocateFeedbackPacket(packettype,fmt,senderssrc,mediassrc,fcilen,&fcibuf)) < 0)
+		return status;
+
+	if (fcilen > 0)
+		memcpy(fcibuf,fci,fcilen);
+	return 0;
+}
+
+int RTCPCompoundPacketBuilder::AddGenericNACK(uint32_t senderssrc,uint32_t mediassrc,const uint16_t *seqnrs,int numseqnrs)
+{
+	if (numseqnrs <= 0)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	// 首先计算需要多少个 PID/BLP 项
+	
+	int numitems = 1;
+	uint16_t pid = seqnrs[0];
+
+	for (int i = 1 ; i < numseqnrs ; i++)
+	{
+		uint16_t diff = (uint16_t)(seqnrs[i]-pid);
+		if (diff == 0 || diff > 16)
+		{
+			pid = seqnrs[i];
+			numitems++;
+		}
+	}
+
+	if (numitems > RTCP_FB_MAXNACKITEMS)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	uint8_t *fci;
+	int status;
+
+	if ((status = AllocateFeedbackPacket(RTP_RTCPTYPE_RTPFB,RTCP_RTPFB_FMT_NACK,senderssrc,mediassrc,
+	                                     ((size_t)numitems)*sizeof(uint32_t),&fci)) < 0)
+		return status;
+
+	uint16_t blp = 0;
+	size_t offset = 0;
+	
+	pid = seqnrs[0];
+	for (int i = 1 ; i <= numseqnrs ; i++)
+	{
+		uint16_t diff = (i < numseqnrs)?(uint16_t)(seqnrs[i]-pid):0;
+
+		if (i < numseqnrs && diff != 0 && diff <= 16)
+		{
+			blp |= (uint16_t)(1 << (diff-1));
+			continue;
+		}
+
+		fci[offset+0] = (uint8_t)(pid>>8);
+		fci[offset+1] = (uint8_t)(pid&0xFF);
+		fci[offset+2] = (uint8_t)(blp>>8);
+		fci[offset+3] = (uint8_t)(blp&0xFF);
+		offset += sizeof(uint32_t);
+
+		if (i < numseqnrs)
+		{
+			pid = seqnrs[i];
+			blp = 0;
+		}
+	}
+	return 0;
+}
+
+int RTCPCompoundPacketBuilder::AddPLI(uint32_t senderssrc,uint32_t mediassrc)
+{
+	uint8_t *fci;
+
+	return AllocateFeedbackPacket(RTP_RTCPTYPE_PSFB,RTCP_PSFB_FMT_PLI,senderssrc,mediassrc,0,&fci);
+}
+
+int RTCPCompoundPacketBuilder::AddFIR(uint32_t senderssrc,const uint32_t *ssrcs,const uint8_t *seqnrs,int numentries)
+{
+	if (numentries <= 0)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	uint8_t *fci;
+	int status;
+
+	// 对于 FIR，媒体源 SSRC 字段必须设置为 0（参见 rfc 5104 4.3.1.2）
+	if ((status = AllocateFeedbackPacket(RTP_RTCPTYPE_PSFB,RTCP_PSFB_FMT_FIR,senderssrc,0,
+	                                     ((size_t)numentries)*sizeof(uint32_t)*2,&fci)) < 0)
+		return status;
+
+	for (int i = 0 ; i < numentries ; i++)
+	{
+		uint32_t *ssrc = (uint32_t *)fci;
+		*ssrc = htonl(ssrcs[i]);
+		fci[4] = seqnrs[i];
+		fci[5] = 0;
+		fci[6] = 0;
+		fci[7] = 0;
+		fci += sizeof(uint32_t)*2;
+	}
+	return 0;
+}
+
+int RTCPCompoundPacketBuilder::AddREMB(uint32_t senderssrc,uint64_t bitrate,const uint32_t *ssrcs,uint8_t numssrcs)
+{
+	// 比特率编码为 6 位指数和 18 位尾数
+	uint8_t exponent = 0;
+	
+	while (bitrate > 0x3FFFFull && exponent < 63)
+	{
+		bitrate >>= 1;
+		exponent++;
+	}
+	if (bitrate > 0x3FFFFull)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	uint8_t *fci;
+	int status;
+
+	if ((status = AllocateFeedbackPacket(RTP_RTCPTYPE_PSFB,RTCP_PSFB_FMT_AFB,senderssrc,0,
+	                                     sizeof(uint32_t)*(2+(size_t)numssrcs),&fci)) < 0)
+		return status;
+
+	fci[0] = 'R';
+	fci[1] = 'E';
+	fci[2] = 'M';
+	fci[3] = 'B';
+	fci[4] = numssrcs;
+	fci[5] = (uint8_t)((exponent<<2)|((bitrate>>16)&0x03));
+	fci[6] = (uint8_t)((bitrate>>8)&0xFF);
+	fci[7] = (uint8_t)(bitrate&0xFF);
+
+	uint32_t *ssrclist = (uint32_t *)(fci+sizeof(uint32_t)*2);
+	for (uint8_t i = 0 ; i < numssrcs ; i++)
+		ssrclist[i] = htonl(ssrcs[i]);
+	return 0;
+}
+
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
 
 int RTCPCompoundPacketBuilder::AddUnknownPacket(uint8_t payload_type, uint8_t subtype, uint32_t ssrc, const void *data, size_t len)
@@ -848,7 +1183,7 @@ int RTCPCompoundPacketBuilder::AddUnknownPacket(uint8_t payload_type, uint8_t su
 		return MEDIA_RTP_ERR_RESOURCE_ERROR;
 	
 	size_t packsize = sizeof(RTCPCommonHeader)+sizeof(uint32_t)+len;
-	size_t totalotherbytes = appsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
+	size_t totalotherbytes = appsize+fbsize+unknownsize+byesize+sdes.NeededBytes()+report.NeededBytes();
 
 	if ((totalotherbytes + packsize) > maximumpacketsize)
 		return MEDIA_RTP_ERR_RESOURCE_ERROR;
@@ -890,9 +1225,9 @@ int RTCPCompoundPacketBuilder::EndBuild()
 	size_t len;
 	
 #ifndef RTP_SUPPORT_RTCPUNKNOWN
-	len = appsize+byesize+report.NeededBytes()+sdes.NeededBytes();
+	len = appsize+fbsize+byesize+report.NeededBytes()+sdes.NeededBytes();
 #else
-	len = appsize+unknownsize+byesize+report.NeededBytes()+sdes.NeededBytes();
+	len = appsize+fbsize+unknownsize+byesize+report.NeededBytes()+sdes.NeededBytes();
 #endif // RTP_SUPPORT_RTCPUNKNOWN 
 	
 	if (!external)
@@ -1044,6 +1379,33 @@ int RTCPCompoundPacketBuilder::EndBuild()
 		} while (!done);
 	}
 	
+	// 添加反馈数据包
+	
+	{
+		std::list<Buffer>::const_iterator it;
+
+		for (it = fbpackets.begin() ; it != fbpackets.end() ; it++)
+		{
+			memcpy(curbuf,(*it).packetdata,(*it).packetlength);
+			
+			RTCPCommonHeader *hdr = (RTCPCommonHeader *)curbuf;
+			if (hdr->packettype == RTP_RTCPTYPE_RTPFB)
+				p = new RTCPRTPFBPacket(curbuf,(*it).packetlength);
+			else
+				p = new RTCPPSFBPacket(curbuf,(*it).packetlength);
+			if (p == 0)
+			{
+				if (!external)
+					delete [] buf;
+				ClearPacketList();
+				return MEDIA_RTP_ERR_RESOURCE_ERROR;
+			}
+			rtcppacklist.push_back(p);
+	
+			curbuf += (*it).packetlength;
+		}
+	}
+
 	// 添加应用程序数据
 	
 	{
@@ -1162,6 +1524,8 @@ int RTCPPacketBuilder::Init(size_t maxpacksize,double tsunit,const void *cname,s
 
 	sdesbuildcount = 0;
 	transmissiondelay = RTPTime(0,0);
+	pendingfeedback.clear();
+	firseqnr = 0;
 
 	firstpacket = true;
 	processingsdes = false;
@@ -1174,6 +1538,7 @@ void RTCPPacketBuilder::Destroy()
 	if (!init)
 		return;
 	own_cname.clear();
+	pendingfeedback.clear();
 	init = false;
 }
 
@@ -1262,6 +1627,30 @@ int RTCPPacketBuilder::BuildNextPacket(RTCPCompoundPacket **pack)
 		return status;
 	}
 
+	// RTX 和 FEC 流使用相同的 CNAME，接收方据此把它们和原始流关联起来（参见 rfc 4588 第 9 节）
+	RTPSourceData *extradat[2] = { sources.GetOwnRTXSourceInfo(), sources.GetOwnFECSourceInfo() };
+
+	for (int i = 0 ; i < 2 ; i++)
+	{
+		if (extradat[i] == 0)
+			continue;
+		if ((status = rtcpcomppack->AddSDESSource(extradat[i]->GetSSRC())) < 0 ||
+		    (status = rtcpcomppack->AddSDESNormalItem(RTCPSDESPacket::CNAME,owncname,owncnamelen)) < 0)
+		{
+			delete rtcpcomppack;
+			if (status == MEDIA_RTP_ERR_RESOURCE_ERROR)
+				return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+			return status;
+		}
+	}
+
+	// 反馈信息是时间敏感的，因此在报告块之前添加
+	if ((status = FillInFeedback(rtcpcomppack)) < 0)
+	{
+		delete rtcpcomppack;
+		return status;
+	}
+
 	if (!processingsdes)
 	{
 		int added,skipped;
@@ -1370,6 +1759,197 @@ int RTCPPacketBuilder::BuildNextPacket(RTCPCompoundPacket **pack)
 	return 0;
 }
 
+int RTCPPacketBuilder::AddNACKRequest(uint32_t mediassrc,const uint16_t *seqnrs,int numseqnrs)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (numseqnrs <= 0)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	std::list<PendingFeedback>::iterator it;
+
+	for (it = pendingfeedback.begin() ; it != pendingfeedback.end() ; it++)
+	{
+		if ((*it).type == PendingFeedback::NACK && (*it).ssrc == mediassrc)
+			break;
+	}
+	if (it == pendingfeedback.end())
+		it = pendingfeedback.insert(pendingfeedback.end(),PendingFeedback(PendingFeedback::NACK,mediassrc));
+
+	std::vector<uint16_t> &list = (*it).seqnrs;
+
+	list.insert(list.end(),seqnrs,seqnrs+numseqnrs);
+
+	// 通用NACK的编码要求升序输入：以最早的序列号为基准，按模 2^16 的距离排序并去重
+	uint16_t base = list[0];
+
+	for (size_t i = 1 ; i < list.size() ; i++)
+	{
+		if ((int16_t)(list[i]-base) < 0)
+			base = list[i];
+	}
+	for (size_t i = 0 ; i < list.size() ; i++)
+		list[i] = (uint16_t)(list[i]-base);
+	std::sort(list.begin(),list.end());
+	list.erase(std::unique(list.begin(),list.end()),list.end());
+	for (size_t i = 0 ; i < list.size() ; i++)
+		list[i] = (uint16_t)(list[i]+base);
+	return 0;
+}
+
+int RTCPPacketBuilder::AddPLIRequest(uint32_t mediassrc)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	std::list<PendingFeedback>::const_iterator it;
+
+	for (it = pendingfeedback.begin() ; it != pendingfeedback.end() ; it++)
+	{
+		if ((*it).type == PendingFeedback::PLI && (*it).ssrc == mediassrc)
+			return 0; // 已经在等待发送
+	}
+	pendingfeedback.push_back(PendingFeedback(PendingFeedback::PLI,mediassrc));
+	return 0;
+}
+
+int RTCPPacketBuilder::AddFIRRequest(uint32_t mediassrc)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	std::list<PendingFeedback>::const_iterator it;
+
+	for (it = pendingfeedback.begin() ; it != pendingfeedback.end() ; it++)
+	{
+		if ((*it).type == PendingFeedback::FIR && (*it).ssrc == mediassrc)
+			return 0; // 已经在等待发送，使用相同的序列号
+	}
+
+	PendingFeedback fb(PendingFeedback::FIR,mediassrc);
+
+	// 每个新请求使用新的命令序列号（参见 rfc 5104 4.3.1.1）
+	fb.firseqnr = firseqnr++;
+	pendingfeedback.push_back(fb);
+	return 0;
+}
+
+int RTCPPacketBuilder::SetREMBRequest(uint64_t bitrate,const uint32_t *ssrcs,int numssrcs)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (numssrcs < 0 || numssrcs > 255)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	std::list<PendingFeedback>::iterator it;
+
+	for (it = pendingfeedback.begin() ; it != pendingfeedback.end() ; it++)
+	{
+		if ((*it).type == PendingFeedback::REMB)
+			break;
+	}
+	if (it == pendingfeedback.end())
+		it = pendingfeedback.insert(pendingfeedback.end(),PendingFeedback(PendingFeedback::REMB,0));
+
+	(*it).bitrate = bitrate;
+	(*it).rembssrcs.assign(ssrcs,ssrcs+numssrcs);
+	return 0;
+}
+
+int RTCPPacketBuilder::AddFeedbackRequest(uint8_t packettype,uint8_t fmt,uint32_t mediassrc,const void *fci,size_t fcilen)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if ((packettype != RTP_RTCPTYPE_RTPFB && packettype != RTP_RTCPTYPE_PSFB) || fmt > 31 || (fcilen & 0x03) != 0)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	PendingFeedback fb(PendingFeedback::Generic,mediassrc);
+
+	fb.packettype = packettype;
+	fb.fmt = fmt;
+	fb.fci.assign((const uint8_t *)fci,(const uint8_t *)fci+fcilen);
+	pendingfeedback.push_back(fb);
+	return 0;
+}
+
+// 返回从 seqnrs 开头起最多能用 maxitems 个 PID/BLP 项编码的序列号数量
+static int GetNACKPrefixLength(const uint16_t *seqnrs,int numseqnrs,int maxitems)
+{
+	int numitems = 1;
+	uint16_t pid = seqnrs[0];
+
+	for (int i = 1 ; i < numseqnrs ; i++)
+	{
+		uint16_t diff = (uint16_t)(seqnrs[i]-pid);
+		if (diff == 0 || diff > 16)
+		{
+			if (numitems == maxitems)
+				return i;
+			pid = seqnrs[i];
+			numitems++;
+		}
+	}
+	return numseqnrs;
+}
+
+int RTCPPacketBuilder::FillInFeedback(RTCPCompoundPacketBuilder *rtcpcomppack)
+{
+	uint32_t ssrc = rtppacketbuilder.GetSSRC();
+	std::list<PendingFeedback>::iterator it = pendingfeedback.begin();
+
+	while (it != pendingfeedback.end())
+	{
+		PendingFeedback &fb = *it;
+		int status = 0;
+
+		switch (fb.type)
+		{
+		case PendingFeedback::NACK:
+			{
+				int numseqnrs = (int)fb.seqnrs.size();
+				int maxitems = RTCP_FB_MAXNACKITEMS;
+				int num;
+
+				// 太长的列表分成多个反馈数据包；数据包剩余空间不够时减少项数再试
+				do
+				{
+					num = GetNACKPrefixLength(&(fb.seqnrs[0]),numseqnrs,maxitems);
+					status = rtcpcomppack->AddGenericNACK(ssrc,fb.ssrc,&(fb.seqnrs[0]),num);
+					maxitems /= 2;
+				} while (status == MEDIA_RTP_ERR_RESOURCE_ERROR && maxitems > 0);
+
+				if (status >= 0 && num < numseqnrs)
+				{
+					// 剩余的序列号放在下一个反馈数据包中
+					fb.seqnrs.erase(fb.seqnrs.begin(),fb.seqnrs.begin()+num);
+					continue;
+				}
+			}
+			break;
+		case PendingFeedback::PLI:
+			status = rtcpcomppack->AddPLI(ssrc,fb.ssrc);
+			break;
+		case PendingFeedback::FIR:
+			status = rtcpcomppack->AddFIR(ssrc,&fb.ssrc,&fb.firseqnr,1);
+			break;
+		case PendingFeedback::REMB:
+			status = rtcpcomppack->AddREMB(ssrc,fb.bitrate,(fb.rembssrcs.empty())?0:&(fb.rembssrcs[0]),
+			                               (uint8_t)fb.rembssrcs.size());
+			break;
+		case PendingFeedback::Generic:
+			status = rtcpcomppack->AddFeedbackPacket(fb.packettype,fb.fmt,ssrc,fb.ssrc,(fb.fci.empty())?0:&(fb.fci[0]),fb.fci.size());
+			break;
+		}
+
+		if (status == MEDIA_RTP_ERR_RESOURCE_ERROR) // 数据包已满，剩余的反馈留到下一个数据包
+			return 0;
+
+		// 已添加，或者请求无法编码，都从列表中移除
+		it = pendingfeedback.erase(it);
+	}
+	return 0;
+}
+
 void RTCPPacketBuilder::ClearAllSourceFlags()
 {
 	if (sources.GotoFirstSource())
@@ -8,6 +8,8 @@
  * - RTCPBYEPacket (再见数据包)
  * - RTCPRRPacket (接收者报告)
  * - RTCPSDESPacket (源描述数据包)
+ * - RTCPRTPFBPacket (传输层反馈数据包)
+ * - RTCPPSFBPacket (负载特定反馈数据包)
  * - RTCPUnknownPacket (未知类型数据包)
  * - RTCPCompoundPacket (复合数据包)
  * - RTCPCompoundPacketBuilder (复合数据包构建器)
@@ -25,6 +27,7 @@
 #include <cstdint>
 #include <list>
 #include <string>
+#include <vector>
 
 #ifdef RTP_SUPPORT_NETINET_IN
 #include <netinet/in.h>
@@ -33,6 +36,7 @@
 // 前向声明
 class RTCPCompoundPacket;
 class RTPRawPacket;
+class RTPDataReleaser;
 class RTPSources;
 class RTPPacketBuilder;
 class RTCPScheduler;
@@ -53,6 +57,8 @@ public:
     SDES,   /**< RTCP源描述数据包。 */
     BYE,    /**< RTCP再见数据包。 */
     APP,    /**< 包含应用程序特定数据的RTCP数据包。 */
+    RTPFB,  /**< RTCP传输层反馈数据包（例如通用NACK）。 */
+    PSFB,   /**< RTCP负载特定反馈数据包（例如PLI、FIR、REMB）。 */
     Unknown /**< RTCP数据包类型未被识别。 */
   };
 
@@ -764,6 +770,264 @@ inline uint8_t *RTCPSDESPacket::GetItemData() {
   return (currentchunk + itemoffset + sizeof(RTCPSDESHeader));
 }
 
+// =============================================================================
+// RTCPRTPFBPacket - 传输层反馈数据包（RFC 4585）
+// =============================================================================
+
+/** 描述一个RTCP传输层反馈（RTPFB）数据包。
+ *  描述一个RTCP传输层反馈（RTPFB）数据包。FMT字段（公共头中的count位置）标识
+ *  反馈消息的类型；目前为通用NACK（RFC 4585）提供了类型化访问函数，其他类型
+ *  可通过 GetFCIData 和 GetFCILength 访问原始的反馈控制信息。
+ */
+class RTCPRTPFBPacket : public RTCPPacket {
+public:
+  /** 基于长度为 \c datalen 的数据 \c data 创建一个实例。
+   *  基于长度为 \c datalen 的数据 \c data 创建一个实例。由于 \c data 指针
+   *  在类内部被引用（不复制数据），必须确保它指向的内存在该类实例存在期间保持有效。
+   */
+  RTCPRTPFBPacket(uint8_t *data, size_t datalen);
+  ~RTCPRTPFBPacket() {}
+
+  /** 返回反馈消息类型（FMT）。 */
+  uint8_t GetFeedbackType() const;
+
+  /** 返回发送此反馈的源的SSRC。 */
+  uint32_t GetSenderSSRC() const;
+
+  /** 返回此反馈所针对的媒体源的SSRC。 */
+  uint32_t GetMediaSSRC() const;
+
+  /** 返回指向反馈控制信息（FCI）的指针，若不存在则返回0。 */
+  uint8_t *GetFCIData();
+
+  /** 返回反馈控制信息（FCI）的长度。 */
+  size_t GetFCILength() const { return (knownformat) ? fcilen : 0; }
+
+  /** 如果这是一个通用NACK数据包则返回 \c true。 */
+  bool IsGenericNACK() const;
+
+  /** 如果这是一个传输层拥塞控制反馈（transport-cc）数据包则返回 \c true，
+   *  其反馈控制信息可使用 RTPTransportCCFeedback 解析。
+   */
+  bool IsTransportCC() const { return (GetFeedbackType() == RTCP_RTPFB_FMT_TRANSPORTCC); }
+
+  /** 返回通用NACK中PID/BLP项的数量。 */
+  int GetNACKCount() const;
+
+  /** 返回由 \c index 描述的NACK项的PID（注意：不检查 \c index 是否有效）。 */
+  uint16_t GetNACKPID(int index) const;
+
+  /** 返回由 \c index 描述的NACK项的BLP位掩码（注意：不检查 \c index 是否有效）。 */
+  uint16_t GetNACKBLP(int index) const;
+
+  /** 将通用NACK展开为丢失的序列号列表。
+   *  将通用NACK展开为丢失的序列号列表，最多写入 \c maxcount 个序列号到
+   *  \c seqnrs 中，并返回写入的数量。不会分配内存。
+   */
+  int GetNACKSequenceNumbers(uint16_t *seqnrs, int maxcount) const;
+
+private:
+  size_t fcilen;
+};
+
+inline uint8_t RTCPRTPFBPacket::GetFeedbackType() const {
+  if (!knownformat)
+    return 0;
+  RTCPCommonHeader *hdr = (RTCPCommonHeader *)data;
+  return hdr->count;
+}
+
+inline uint32_t RTCPRTPFBPacket::GetSenderSSRC() const {
+  if (!knownformat)
+    return 0;
+  uint32_t *ssrc = (uint32_t *)(data + sizeof(RTCPCommonHeader));
+  return ntohl(*ssrc);
+}
+
+inline uint32_t RTCPRTPFBPacket::GetMediaSSRC() const {
+  if (!knownformat)
+    return 0;
+  uint32_t *ssrc =
+      (uint32_t *)(data + sizeof(RTCPCommonHeader) + sizeof(uint32_t));
+  return ntohl(*ssrc);
+}
+
+inline uint8_t *RTCPRTPFBPacket::GetFCIData() {
+  if (!knownformat)
+    return 0;
+  if (fcilen == 0)
+    return 0;
+  return (data + sizeof(RTCPCommonHeader) + sizeof(uint32_t) * 2);
+}
+
+inline bool RTCPRTPFBPacket::IsGenericNACK() const {
+  return (GetFeedbackType() == RTCP_RTPFB_FMT_NACK);
+}
+
+inline int RTCPRTPFBPacket::GetNACKCount() const {
+  if (!IsGenericNACK())
+    return 0;
+  return (int)(fcilen / sizeof(uint32_t));
+}
+
+inline uint16_t RTCPRTPFBPacket::GetNACKPID(int index) const {
+  if (!IsGenericNACK())
+    return 0;
+  uint8_t *item = data + sizeof(RTCPCommonHeader) + sizeof(uint32_t) * 2 +
+                  ((size_t)index) * sizeof(uint32_t);
+  return (uint16_t)((((uint16_t)item[0]) << 8) | ((uint16_t)item[1]));
+}
+
+inline uint16_t RTCPRTPFBPacket::GetNACKBLP(int index) const {
+  if (!IsGenericNACK())
+    return 0;
+  uint8_t *item = data + sizeof(RTCPCommonHeader) + sizeof(uint32_t) * 2 +
+                  ((size_t)index) * sizeof(uint32_t);
+  return (uint16_t)((((uint16_t)item[2]) << 8) | ((uint16_t)item[3]));
+}
+
+// =============================================================================
+// RTCPPSFBPacket - 负载特定反馈数据包（RFC 4585/5104）
+// =============================================================================
+
+/** 描述一个RTCP负载特定反馈（PSFB）数据包。
+ *  描述一个RTCP负载特定反馈（PSFB）数据包。为PLI（RFC 4585）、FIR（RFC 5104）
+ *  以及REMB（应用层反馈）提供了类型化访问函数，其他类型可通过 GetFCIData
+ *  和 GetFCILength 访问原始的反馈控制信息。
+ */
+class RTCPPSFBPacket : public RTCPPacket {
+public:
+  /** 基于长度为 \c datalen 的数据 \c data 创建一个实例。
+   *  基于长度为 \c datalen 的数据 \c data 创建一个实例。由于 \c data 指针
+   *  在类内部被引用（不复制数据），必须确保它指向的内存在该类实例存在期间保持有效。
+   */
+  RTCPPSFBPacket(uint8_t *data, size_t datalen);
+  ~RTCPPSFBPacket() {}
+
+  /** 返回反馈消息类型（FMT）。 */
+  uint8_t GetFeedbackType() const;
+
+  /** 返回发送此反馈的源的SSRC。 */
+  uint32_t GetSenderSSRC() const;
+
+  /** 返回此反馈所针对的媒体源的SSRC（对于FIR和REMB为0）。 */
+  uint32_t GetMediaSSRC() const;
+
+  /** 返回指向反馈控制信息（FCI）的指针，若不存在则返回0。 */
+  uint8_t *GetFCIData();
+
+  /** 返回反馈控制信息（FCI）的长度。 */
+  size_t GetFCILength() const { return (knownformat) ? fcilen : 0; }
+
+  /** 如果这是一个图像丢失指示（PLI）则返回 \c true。 */
+  bool IsPLI() const { return (GetFeedbackType() == RTCP_PSFB_FMT_PLI); }
+
+  /** 如果这是一个完整帧内请求（FIR）则返回 \c true。 */
+  bool IsFIR() const { return (GetFeedbackType() == RTCP_PSFB_FMT_FIR); }
+
+  /** 如果这是一个接收端估计最大比特率（REMB）消息则返回 \c true。 */
+  bool IsREMB() const { return (knownformat && isremb); }
+
+  /** 返回FIR数据包中条目的数量。 */
+  int GetFIRCount() const;
+
+  /** 返回由 \c index 描述的FIR条目所请求的SSRC（注意：不检查 \c index 是否有效）。 */
+  uint32_t GetFIRSSRC(int index) const;
+
+  /** 返回由 \c index 描述的FIR条目的命令序列号（注意：不检查 \c index 是否有效）。 */
+  uint8_t GetFIRSequenceNumber(int index) const;
+
+  /** 返回REMB消息中估计的最大比特率，以比特每秒为单位。 */
+  uint64_t GetREMBBitrate() const;
+
+  /** 返回REMB消息中包含的SSRC数量。 */
+  int GetREMBSSRCCount() const;
+
+  /** 返回REMB消息中由 \c index 描述的SSRC（注意：不检查 \c index 是否有效）。 */
+  uint32_t GetREMBSSRC(int index) const;
+
+private:
+  uint8_t *GetFCI() const {
+    return (data + sizeof(RTCPCommonHeader) + sizeof(uint32_t) * 2);
+  }
+
+  size_t fcilen;
+  bool isremb;
+};
+
+inline uint8_t RTCPPSFBPacket::GetFeedbackType() const {
+  if (!knownformat)
+    return 0;
+  RTCPCommonHeader *hdr = (RTCPCommonHeader *)data;
+  return hdr->count;
+}
+
+inline uint32_t RTCPPSFBPacket::GetSenderSSRC() const {
+  if (!knownformat)
+    return 0;
+  uint32_t *ssrc = (uint32_t *)(data + sizeof(RTCPCommonHeader));
+  return ntohl(*ssrc);
+}
+
+inline uint32_t RTCPPSFBPacket::GetMediaSSRC() const {
+  if (!knownformat)
+    return 0;
+  uint32_t *ssrc =
+      (uint32_t *)(data + sizeof(RTCPCommonHeader) + sizeof(uint32_t));
+  return ntohl(*ssrc);
+}
+
+inline uint8_t *RTCPPSFBPacket::GetFCIData() {
+  if (!knownformat)
+    return 0;
+  if (fcilen == 0)
+    return 0;
+  return GetFCI();
+}
+
+inline int RTCPPSFBPacket::GetFIRCount() const {
+  if (!IsFIR())
+    return 0;
+  return (int)(fcilen / (sizeof(uint32_t) * 2));
+}
+
+inline uint32_t RTCPPSFBPacket::GetFIRSSRC(int index) const {
+  if (!IsFIR())
+    return 0;
+  uint32_t *ssrc = (uint32_t *)(GetFCI() + ((size_t)index) * sizeof(uint32_t) * 2);
+  return ntohl(*ssrc);
+}
+
+inline uint8_t RTCPPSFBPacket::GetFIRSequenceNumber(int index) const {
+  if (!IsFIR())
+    return 0;
+  return GetFCI()[((size_t)index) * sizeof(uint32_t) * 2 + sizeof(uint32_t)];
+}
+
+inline uint64_t RTCPPSFBPacket::GetREMBBitrate() const {
+  if (!IsREMB())
+    return 0;
+  uint8_t *fci = GetFCI();
+  uint8_t exponent = fci[5] >> 2;
+  uint64_t mantissa = (((uint64_t)(fci[5] & 0x03)) << 16) |
+                      (((uint64_t)fci[6]) << 8) | ((uint64_t)fci[7]);
+  return (mantissa << exponent);
+}
+
+inline int RTCPPSFBPacket::GetREMBSSRCCount() const {
+  if (!IsREMB())
+    return 0;
+  return (int)GetFCI()[4];
+}
+
+inline uint32_t RTCPPSFBPacket::GetREMBSSRC(int index) const {
+  if (!IsREMB())
+    return 0;
+  uint32_t *ssrc = (uint32_t *)(GetFCI() + sizeof(uint32_t) * 2 +
+                                ((size_t)index) * sizeof(uint32_t));
+  return ntohl(*ssrc);
+}
+
 // =============================================================================
 // RTCPUnknownPacket - 未知类型数据包
 // =============================================================================
@@ -848,6 +1112,7 @@ protected:
   uint8_t *compoundpacket;
   size_t compoundpacketlength;
   bool deletepacket;
+  RTPDataReleaser *releaser;
 
   std::list<RTCPPacket *> rtcppacklist;
   std::list<RTCPPacket *>::const_iterator rtcppackit;
@@ -929,6 +1194,39 @@ public:
   int AddAPPPacket(uint8_t subtype, uint32_t ssrc, const uint8_t name[4],
                    const void *appdata, size_t appdatalen);
 
+  /** 向复合数据包添加一个RTCP反馈数据包（RFC 4585）。
+   *  向复合数据包添加一个类型为 \c packettype（RTP_RTCPTYPE_RTPFB 或
+   *  RTP_RTCPTYPE_PSFB）、反馈消息类型为 \c fmt 的反馈数据包。反馈控制信息
+   *  由长度为 \c fcilen 的 \c fci 指定，\c fcilen 必须是四的倍数。
+   */
+  int AddFeedbackPacket(uint8_t packettype, uint8_t fmt, uint32_t senderssrc,
+                        uint32_t mediassrc, const void *fci, size_t fcilen);
+
+  /** 向复合数据包添加通用NACK。
+   *  向复合数据包添加通用NACK，报告媒体源 \c mediassrc 丢失了 \c seqnrs
+   *  中的 \c numseqnrs 个序列号。序列号应按（模 2^16 的）升序给出，
+   *  构建器会将其压缩为PID/BLP项。
+   */
+  int AddGenericNACK(uint32_t senderssrc, uint32_t mediassrc,
+                     const uint16_t *seqnrs, int numseqnrs);
+
+  /** 向复合数据包添加针对媒体源 \c mediassrc 的图像丢失指示（PLI）。 */
+  int AddPLI(uint32_t senderssrc, uint32_t mediassrc);
+
+  /** 向复合数据包添加完整帧内请求（FIR）。
+   *  向复合数据包添加完整帧内请求（FIR），为 \c ssrcs 中的 \c numentries
+   *  个媒体源各请求一个关键帧，命令序列号由 \c seqnrs 给出。
+   */
+  int AddFIR(uint32_t senderssrc, const uint32_t *ssrcs, const uint8_t *seqnrs,
+             int numentries);
+
+  /** 向复合数据包添加REMB消息。
+   *  向复合数据包添加REMB消息，报告对 \c ssrcs 中 \c numssrcs 个媒体源
+   *  估计的最大比特率 \c bitrate（比特每秒）。
+   */
+  int AddREMB(uint32_t senderssrc, uint64_t bitrate, const uint32_t *ssrcs,
+              uint8_t numssrcs);
+
   /** 完成复合数据包的构建。
    *  完成复合数据包的构建。如果成功，可以使用RTCPCompoundPacket成员函数
    *  访问RTCP数据包数据。
@@ -1172,12 +1470,18 @@ private:
   std::list<Buffer> apppackets;
   size_t appsize;
 
+  std::list<Buffer> fbpackets;
+  size_t fbsize;
+
 #ifdef RTP_SUPPORT_RTCPUNKNOWN
   std::list<Buffer> unknownpackets;
   size_t unknownsize;
 #endif // RTP_SUPPORT_RTCPUNKNOWN
 
   void ClearBuildBuffers();
+  int AllocateFeedbackPacket(uint8_t packettype, uint8_t fmt,
+                             uint32_t senderssrc, uint32_t mediassrc,
+                             size_t fcilen, uint8_t **fci);
 };
 
 // =============================================================================
@@ -1224,6 +1528,9 @@ public:
     return 0;
   }
 
+  /** 返回使用的时间戳单位。 */
+  double GetTimestampUnit() const { return timestampunit; }
+
   /** 设置RTCP复合数据包的最大允许大小为\c maxpacksize。 */
   int SetMaximumPacketSize(size_t maxpacksize) {
     if (!init)
@@ -1265,8 +1572,57 @@ public:
     return (uint8_t*)own_cname.c_str();
   }
 
+  /** 请求在下一个RTCP复合数据包中为媒体源\c mediassrc发送通用NACK。
+   *  请求在下一个RTCP复合数据包中为媒体源\c mediassrc发送通用NACK，
+   *  报告\c seqnrs中的\c numseqnrs个丢失序列号。对同一源的多次请求会被合并，
+   *  序列号可以按任意顺序给出，合并后按（模 2^16 的）升序排列并去重；一个反馈数据包
+   *  放不下的列表会分成多个数据包发送。
+   */
+  int AddNACKRequest(uint32_t mediassrc, const uint16_t *seqnrs, int numseqnrs);
+
+  /** 请求在下一个RTCP复合数据包中为媒体源\c mediassrc发送PLI。 */
+  int AddPLIRequest(uint32_t mediassrc);
+
+  /** 请求在下一个RTCP复合数据包中为媒体源\c mediassrc发送FIR。 */
+  int AddFIRRequest(uint32_t mediassrc);
+
+  /** 设置下一个RTCP复合数据包中要发送的REMB信息，替换之前未发送的REMB。 */
+  int SetREMBRequest(uint64_t bitrate, const uint32_t *ssrcs, int numssrcs);
+
+  /** 请求在下一个RTCP复合数据包中发送一个类型为\c packettype、反馈消息类型为
+   *  \c fmt的反馈数据包，反馈控制信息由长度为\c fcilen（四的倍数）的\c fci给出。
+   *  多次请求按顺序发送，不会合并。
+   */
+  int AddFeedbackRequest(uint8_t packettype, uint8_t fmt, uint32_t mediassrc,
+                         const void *fci, size_t fcilen);
+
+  /** 如果还有尚未发送的反馈信息则返回\c true。 */
+  bool HasPendingFeedback() const { return !pendingfeedback.empty(); }
+
+  /** 丢弃所有尚未发送的反馈信息。 */
+  void ClearPendingFeedback() { pendingfeedback.clear(); }
+
 private:
+  /** 等待加入下一个RTCP复合数据包的反馈信息。 */
+  class PendingFeedback {
+  public:
+    enum FeedbackType { NACK, PLI, FIR, REMB, Generic };
+
+    PendingFeedback(FeedbackType t, uint32_t s)
+        : type(t), ssrc(s), firseqnr(0), bitrate(0), packettype(0), fmt(0) {}
+
+    FeedbackType type;
+    uint32_t ssrc;
+    uint8_t firseqnr;
+    uint64_t bitrate;
+    std::vector<uint16_t> seqnrs;
+    std::vector<uint32_t> rembssrcs;
+    uint8_t packettype, fmt;
+    std::vector<uint8_t> fci;
+  };
+
   void ClearAllSourceFlags();
+  int FillInFeedback(RTCPCompoundPacketBuilder *pack);
   int FillInReportBlocks(RTCPCompoundPacketBuilder *pack,
                          const RTPTime &curtime, int maxcount, bool *full,
                          int *added, int *skipped, bool *atendoflist);
@@ -1287,4 +1643,7 @@ private:
   bool processingsdes;
 
   int sdesbuildcount;
+
+  std::list<PendingFeedback> pendingfeedback;
+  uint8_t firseqnr;
 };
\ No newline at end of file
@@ -0,0 +1,470 @@
+#include "media_rtp_fec.h"
+#include "media_rtp_structs.h"
+#include "media_rtp_errors.h"
+#include "media_rtp_xor.h"
+#include "media_rtp_utils.h"
+#include <string.h>
+#include <arpa/inet.h>
+
+#define RTPFEC_PACKETOVERHEAD					(sizeof(RTPHeader)+RTP_FEC_HEADERSIZE)
+
+RTPFECEncoder::RTPFECEncoder()
+{
+	maxpacksize = 0;
+	numcolumns = 0;
+	numrows = 0;
+	fecpt = 0;
+	fecssrc = 0;
+	fecseqnr = 0;
+	rowacc.buffer = 0;
+	rowacc.payloadlen = 0;
+	colaccs = 0;
+	position = 0;
+	nextseqnr = 0;
+	mediassrc = 0;
+	numready = 0;
+}
+
+int RTPFECEncoder::Init(size_t maxpack,int ncols,int nrows,uint8_t pt,uint32_t ssrc)
+{
+	if (IsInitialized())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (maxpack < sizeof(RTPHeader) || ncols < 1 || ncols > 255 || nrows < 0 || nrows > 255)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	if (ncols < 2 && nrows < 2)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	size_t bufsize = maxpack+RTP_FEC_HEADERSIZE;
+	int numaccs = (nrows >= 2)?ncols:0;
+
+	rowacc.buffer = new uint8_t[bufsize];
+	if (rowacc.buffer == 0)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	rowacc.payloadlen = 0;
+	memset(rowacc.buffer,0,bufsize);
+
+	if (numaccs > 0)
+	{
+		colaccs = new Accumulator[numaccs];
+		if (colaccs == 0)
+		{
+			delete [] rowacc.buffer;
+			rowacc.buffer = 0;
+			return MEDIA_RTP_ERR_RESOURCE_ERROR;
+		}
+		for (int i = 0 ; i < numaccs ; i++)
+		{
+			colaccs[i].buffer = new uint8_t[bufsize];
+			colaccs[i].payloadlen = 0;
+			memset(colaccs[i].buffer,0,bufsize);
+		}
+	}
+
+	maxpacksize = maxpack;
+	numcolumns = ncols;
+	numrows = nrows;
+	fecpt = pt;
+	fecssrc = ssrc;
+	fecseqnr = RTPGenerateRandom16();
+	position = 0;
+	numready = 0;
+	return 0;
+}
+
+void RTPFECEncoder::Destroy()
+{
+	if (!IsInitialized())
+		return;
+
+	if (colaccs)
+	{
+		for (int i = 0 ; i < numcolumns ; i++)
+			delete [] colaccs[i].buffer;
+		delete [] colaccs;
+		colaccs = 0;
+	}
+	delete [] rowacc.buffer;
+	rowacc.buffer = 0;
+	numready = 0;
+}
+
+int RTPFECEncoder::AddMediaPacket(const uint8_t *packet,size_t headerlen,const uint8_t *payload,size_t payloadlen)
+{
+	if (!IsInitialized())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	numready = 0;
+	if (headerlen < sizeof(RTPHeader) || headerlen+payloadlen > maxpacksize)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	const RTPHeader *hdr = (const RTPHeader *)packet;
+	uint16_t seqnr = ntohs(hdr->sequencenumber);
+	uint32_t ssrc = ntohl(hdr->ssrc);
+
+	// 分组只能包含连续的数据包
+	if (position != 0 && (seqnr != nextseqnr || ssrc != mediassrc))
+		position = 0;
+	nextseqnr = seqnr+1;
+	mediassrc = ssrc;
+
+	int col = position%numcolumns;
+	int row = position/numcolumns;
+
+	if (numcolumns >= 2)
+	{
+		AddToAccumulator(rowacc,packet,headerlen,payload,payloadlen,col == 0);
+		if (col == numcolumns-1)
+		{
+			FinishAccumulator(rowacc,packet,numcolumns,1);
+			ready[numready++] = &rowacc;
+		}
+	}
+	if (numrows >= 2)
+	{
+		AddToAccumulator(colaccs[col],packet,headerlen,payload,payloadlen,row == 0);
+		if (row == numrows-1)
+		{
+			FinishAccumulator(colaccs[col],packet,numrows,(uint8_t)numcolumns);
+			ready[numready++] = &colaccs[col];
+		}
+	}
+
+	position++;
+	if (position >= ((numrows >= 2)?numcolumns*numrows:numcolumns))
+		position = 0;
+	return numready;
+}
+
+const uint8_t *RTPFECEncoder::GetFECPacket(int index,size_t *packetlen) const
+{
+	if (index < 0 || index >= numready)
+		return 0;
+
+	*packetlen = RTPFEC_PACKETOVERHEAD+ready[index]->payloadlen;
+	return ready[index]->buffer;
+}
+
+void RTPFECEncoder::AddToAccumulator(Accumulator &acc,const uint8_t *packet,size_t headerlen,const uint8_t *extra,size_t extralen,bool first)
+{
+	uint8_t *fechdr = acc.buffer+sizeof(RTPHeader);
+	uint8_t *payload = fechdr+RTP_FEC_HEADERSIZE;
+	size_t bodylen = headerlen+extralen-sizeof(RTPHeader);
+
+	if (first)
+	{
+		// 只需清除上一组实际使用过的部分
+		memset(fechdr,0,RTP_FEC_HEADERSIZE);
+		memset(payload,0,acc.payloadlen);
+		acc.payloadlen = 0;
+		fechdr[12] = packet[2];
+		fechdr[13] = packet[3];
+	}
+
+	fechdr[0] ^= packet[0];
+	fechdr[1] ^= packet[1];
+	fechdr[2] ^= (uint8_t)(bodylen>>8);
+	fechdr[3] ^= (uint8_t)(bodylen&0xff);
+	for (int i = 0 ; i < 4 ; i++)
+		fechdr[4+i] ^= packet[4+i];
+
+	// 固定头部之后的部分（包括单独存放的负载）作为一个整体参与异或
+	RTPXORBlock(payload,packet+sizeof(RTPHeader),headerlen-sizeof(RTPHeader));
+	if (extralen > 0)
+		RTPXORBlock(payload+headerlen-sizeof(RTPHeader),extra,extralen);
+	if (bodylen > acc.payloadlen)
+		acc.payloadlen = bodylen;
+}
+
+void RTPFECEncoder::FinishAccumulator(Accumulator &acc,const uint8_t *lastpacket,int count,uint8_t stride)
+{
+	RTPHeader *hdr = (RTPHeader *)acc.buffer;
+	uint8_t *fechdr = acc.buffer+sizeof(RTPHeader);
+
+	acc.buffer[0] = (uint8_t)(RTP_VERSION<<6);
+	acc.buffer[1] = fecpt&127;
+	hdr->sequencenumber = htons(fecseqnr);
+	memcpy(acc.buffer+4,lastpacket+4,4); // 使用最后一个被保护数据包的时间戳
+	hdr->ssrc = htonl(fecssrc);
+	fecseqnr++;
+
+	memcpy(fechdr+8,lastpacket+8,4);
+	fechdr[14] = (uint8_t)count;
+	fechdr[15] = stride;
+}
+
+RTPFECDecoder::RTPFECDecoder()
+{
+	maxpacksize = 0;
+	fecpt = 0;
+	mediaslots = 0;
+	mediastorage = 0;
+	fecslots = 0;
+	fecstorage = 0;
+	workbuffer = 0;
+	nextfecslot = 0;
+	numfecpackets = 0;
+	recoveredstart = 0;
+	numrecoveredqueued = 0;
+	hasnewest = false;
+	newestssrc = 0;
+	newestseqnr = 0;
+	numrecovered = 0;
+}
+
+int RTPFECDecoder::Init(size_t maxpack,uint8_t pt)
+{
+	if (IsInitialized())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (maxpack < sizeof(RTPHeader))
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	mediaslots = new MediaSlot[RTP_FECDECODER_MEDIASLOTS];
+	mediastorage = new uint8_t[RTP_FECDECODER_MEDIASLOTS*maxpack];
+	fecslots = new FECSlot[RTP_FECDECODER_FECSLOTS];
+	fecstorage = new uint8_t[RTP_FECDECODER_FECSLOTS*(maxpack+RTP_FEC_HEADERSIZE)];
+	workbuffer = new uint8_t[maxpack];
+
+	for (int i = 0 ; i < RTP_FECDECODER_MEDIASLOTS ; i++)
+		mediaslots[i].used = false;
+	for (int i = 0 ; i < RTP_FECDECODER_FECSLOTS ; i++)
+		fecslots[i].used = false;
+
+	maxpacksize = maxpack;
+	fecpt = pt;
+	nextfecslot = 0;
+	numfecpackets = 0;
+	recoveredstart = 0;
+	numrecoveredqueued = 0;
+	hasnewest = false;
+	numrecovered = 0;
+	return 0;
+}
+
+void RTPFECDecoder::Destroy()
+{
+	if (!IsInitialized())
+		return;
+
+	delete [] mediaslots;
+	delete [] mediastorage;
+	delete [] fecslots;
+	delete [] fecstorage;
+	delete [] workbuffer;
+	mediaslots = 0;
+	mediastorage = 0;
+	fecslots = 0;
+	fecstorage = 0;
+	workbuffer = 0;
+}
+
+bool RTPFECDecoder::IsFECPacket(const uint8_t *packet,size_t packetlen) const
+{
+	if (packetlen < RTPFEC_PACKETOVERHEAD)
+		return false;
+	return (packet[1]&127) == fecpt;
+}
+
+int RTPFECDecoder::AddMediaPacket(const uint8_t *packet,size_t packetlen)
+{
+	if (!IsInitialized())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (packetlen < sizeof(RTPHeader) || packetlen > maxpacksize)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	const RTPHeader *hdr = (const RTPHeader *)packet;
+	uint16_t seqnr = ntohs(hdr->sequencenumber);
+	uint32_t ssrc = ntohl(hdr->ssrc);
+
+	if (!hasnewest || ssrc != newestssrc || (int16_t)(seqnr-newestseqnr) > 0)
+	{
+		hasnewest = true;
+		newestssrc = ssrc;
+		newestseqnr = seqnr;
+	}
+
+	uint8_t *dst = StoreMediaPacket(ssrc,seqnr);
+	memcpy(dst,packet,packetlen);
+	mediaslots[seqnr%RTP_FECDECODER_MEDIASLOTS].length = packetlen;
+
+	if (numfecpackets > 0)
+		AttemptRecovery();
+	return 0;
+}
+
+int RTPFECDecoder::AddFECPacket(const uint8_t *packet,size_t packetlen)
+{
+	if (!IsInitialized())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (!IsFECPacket(packet,packetlen) || packetlen > maxpacksize+RTP_FEC_HEADERSIZE)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	const uint8_t *fechdr = packet+sizeof(RTPHeader);
+	if (fechdr[14] == 0 || fechdr[15] == 0)
+		return MEDIA_RTP_ERR_PROTOCOL_ERROR;
+
+	// 最早的FEC包会被覆盖
+	if (fecslots[nextfecslot].used)
+		numfecpackets--;
+	memcpy(fecstorage+(size_t)nextfecslot*(maxpacksize+RTP_FEC_HEADERSIZE),packet,packetlen);
+	fecslots[nextfecslot].length = packetlen;
+	fecslots[nextfecslot].used = true;
+	numfecpackets++;
+	nextfecslot = (nextfecslot+1)%RTP_FECDECODER_FECSLOTS;
+
+	AttemptRecovery();
+	return 0;
+}
+
+bool RTPFECDecoder::GetNextRecoveredPacket(const uint8_t **packet,size_t *packetlen)
+{
+	while (numrecoveredqueued > 0)
+	{
+		uint16_t seqnr = recoveredseqnrs[recoveredstart];
+		uint32_t ssrc = recoveredssrcs[recoveredstart];
+
+		recoveredstart = (recoveredstart+1)%RTP_FECDECODER_MEDIASLOTS;
+		numrecoveredqueued--;
+
+		// 恢复出的数据包可能已被更新的数据包覆盖
+		if ((*packet = GetMediaPacket(ssrc,seqnr,packetlen)) != 0)
+			return true;
+	}
+	return false;
+}
+
+const uint8_t *RTPFECDecoder::GetMediaPacket(uint32_t ssrc,uint16_t seqnr,size_t *packetlen) const
+{
+	const MediaSlot &s = mediaslots[seqnr%RTP_FECDECODER_MEDIASLOTS];
+
+	if (!s.used || s.seqnr != seqnr || s.ssrc != ssrc)
+		return 0;
+	*packetlen = s.length;
+	return mediastorage+(size_t)(seqnr%RTP_FECDECODER_MEDIASLOTS)*maxpacksize;
+}
+
+uint8_t *RTPFECDecoder::StoreMediaPacket(uint32_t ssrc,uint16_t seqnr)
+{
+	MediaSlot &s = mediaslots[seqnr%RTP_FECDECODER_MEDIASLOTS];
+
+	s.ssrc = ssrc;
+	s.seqnr = seqnr;
+	s.used = true;
+	return mediastorage+(size_t)(seqnr%RTP_FECDECODER_MEDIASLOTS)*maxpacksize;
+}
+
+void RTPFECDecoder::AttemptRecovery()
+{
+	// 恢复出的数据包可能使其他FEC包也能用于恢复，直到没有进展为止
+	bool progress = true;
+
+	while (progress && numfecpackets > 0)
+	{
+		progress = false;
+		for (int i = 0 ; i < RTP_FECDECODER_FECSLOTS ; i++)
+		{
+			if (fecslots[i].used && AttemptRecovery(i) > 0)
+				progress = true;
+		}
+	}
+}
+
+int RTPFECDecoder::AttemptRecovery(int fecindex)
+{
+	FECSlot &slot = fecslots[fecindex];
+	const uint8_t *fec = fecstorage+(size_t)fecindex*(maxpacksize+RTP_FEC_HEADERSIZE);
+	const uint8_t *fechdr = fec+sizeof(RTPHeader);
+	const uint8_t *fecpayload = fechdr+RTP_FEC_HEADERSIZE;
+	size_t fecpayloadlen = slot.length-RTPFEC_PACKETOVERHEAD;
+
+	uint32_t ssrc = ((uint32_t)fechdr[8]<<24)|((uint32_t)fechdr[9]<<16)|((uint32_t)fechdr[10]<<8)|(uint32_t)fechdr[11];
+	uint16_t baseseqnr = (uint16_t)((fechdr[12]<<8)|fechdr[13]);
+	int count = fechdr[14];
+	int stride = fechdr[15];
+
+	int nummissing = 0;
+	uint16_t missingseqnr = 0;
+	size_t len;
+
+	for (int k = 0 ; k < count ; k++)
+	{
+		uint16_t seqnr = (uint16_t)(baseseqnr+k*stride);
+
+		if (GetMediaPacket(ssrc,seqnr,&len) == 0)
+		{
+			nummissing++;
+			missingseqnr = seqnr;
+			if (nummissing > 1)
+				return 0;
+		}
+	}
+
+	// 全部收到，或丢失的数据包已超出媒体缓冲区的范围，FEC包不再有用
+	if (nummissing == 0 ||
+	    (hasnewest && newestssrc == ssrc && (int16_t)(newestseqnr-missingseqnr) >= RTP_FECDECODER_MEDIASLOTS) ||
+	    fecpayloadlen+sizeof(RTPHeader) > maxpacksize)
+	{
+		slot.used = false;
+		numfecpackets--;
+		return 0;
+	}
+
+	uint8_t hdr[2] = { fechdr[0], fechdr[1] };
+	size_t bodylen = (size_t)((fechdr[2]<<8)|fechdr[3]);
+	uint8_t *body = workbuffer+sizeof(RTPHeader);
+
+	memcpy(workbuffer+4,fechdr+4,4);
+	memcpy(body,fecpayload,fecpayloadlen);
+
+	for (int k = 0 ; k < count ; k++)
+	{
+		uint16_t seqnr = (uint16_t)(baseseqnr+k*stride);
+
+		if (seqnr == missingseqnr)
+			continue;
+
+		const uint8_t *p = GetMediaPacket(ssrc,seqnr,&len);
+		size_t plen = len-sizeof(RTPHeader);
+
+		if (plen > fecpayloadlen) // 与FEC包不一致
+		{
+			slot.used = false;
+			numfecpackets--;
+			return 0;
+		}
+
+		hdr[0] ^= p[0];
+		hdr[1] ^= p[1];
+		bodylen ^= plen;
+		for (int i = 0 ; i < 4 ; i++)
+			workbuffer[4+i] ^= p[4+i];
+		RTPXORBlock(body,p+sizeof(RTPHeader),plen);
+	}
+
+	slot.used = false;
+	numfecpackets--;
+	if (bodylen > fecpayloadlen)
+		return 0;
+
+	workbuffer[0] = (uint8_t)((hdr[0]&0x3f)|(RTP_VERSION<<6));
+	workbuffer[1] = hdr[1];
+	workbuffer[2] = (uint8_t)(missingseqnr>>8);
+	workbuffer[3] = (uint8_t)(missingseqnr&0xff);
+	memcpy(workbuffer+8,fechdr+8,4);
+
+	len = sizeof(RTPHeader)+bodylen;
+	memcpy(StoreMediaPacket(ssrc,missingseqnr),workbuffer,len);
+	mediaslots[missingseqnr%RTP_FECDECODER_MEDIASLOTS].length = len;
+
+	if (numrecoveredqueued == RTP_FECDECODER_MEDIASLOTS)
+	{
+		recoveredstart = (recoveredstart+1)%RTP_FECDECODER_MEDIASLOTS;
+		numrecoveredqueued--;
+	}
+	int idx = (recoveredstart+numrecoveredqueued)%RTP_FECDECODER_MEDIASLOTS;
+	recoveredseqnrs[idx] = missingseqnr;
+	recoveredssrcs[idx] = ssrc;
+	numrecoveredqueued++;
+	numrecovered++;
+	return 1;
+}
+
@@ -0,0 +1,183 @@
+/**
+ * \file media_rtp_fec.h
+ */
+
+#ifndef MEDIA_RTP_FEC_H
+
+#define MEDIA_RTP_FEC_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include <cstddef>
+#include <cstdint>
+
+/** 基于异或的前向纠错（FEC）编码器。
+ *  与FlexFEC（RFC 8627）的固定偏移模式类似，媒体包按 numcolumns x numrows 的矩阵分组：
+ *  行FEC包保护一行中 numcolumns 个连续的媒体包，列FEC包保护一列中 numrows 个
+ *  间隔为 numcolumns 的媒体包。FEC包作为单独的RTP流发送，其负载由一个
+ *  RTP_FEC_HEADERSIZE 字节的FEC头和被保护数据包RTP固定头之后所有字节的异或组成。
+ *
+ *  注意：FEC头是本库私有的格式，既不是ULPFEC（RFC 5109）也不是FlexFEC（RFC 8627），
+ *  只有同样使用本库的接收方才能用它恢复数据包；与其他实现互通时不要启用FEC。
+ *
+ *  FEC头格式：
+ *  - 字节0-1：被保护数据包RTP头前两个字节的异或（P、X、CC、M、PT）
+ *  - 字节2-3：被保护数据包长度（不含12字节固定头）的异或
+ *  - 字节4-7：被保护数据包时间戳的异或
+ *  - 字节8-11：被保护媒体流的SSRC
+ *  - 字节12-13：第一个被保护数据包的序列号
+ *  - 字节14：被保护数据包的数量
+ *  - 字节15：被保护数据包序列号之间的间隔
+ */
+class RTPFECEncoder {
+  MEDIA_RTP_NO_COPY(RTPFECEncoder)
+public:
+  /** 构造一个未初始化的编码器。 */
+  RTPFECEncoder();
+  ~RTPFECEncoder() { Destroy(); }
+
+  /** 初始化编码器，媒体包的大小不超过\c maxpacksize。
+   *  \c numcolumns 或 \c numrows 小于2时不生成对应方向的FEC包，但至少需要一个方向。
+   *  生成的FEC包使用负载类型\c fecpt和SSRC \c fecssrc，其长度最多比媒体包多出
+   *  RTP_FEC_HEADERSIZE 字节。
+   */
+  int Init(size_t maxpacksize, int numcolumns, int numrows, uint8_t fecpt,
+           uint32_t fecssrc);
+
+  /** 释放编码器使用的内存。 */
+  void Destroy();
+
+  /** 如果编码器已初始化则返回\c true。 */
+  bool IsInitialized() const { return rowacc.buffer != 0; }
+
+  /** 丢弃尚未完成的分组。 */
+  void Reset() { position = 0; }
+
+  /** 之后生成的FEC包使用SSRC \c ssrc，例如检测到SSRC冲突之后。 */
+  void SetSSRC(uint32_t ssrc) { fecssrc = ssrc; }
+
+  /** 加入一个已发送的媒体包，返回因此完成、可以立即发送的FEC包数量。
+   *  序列号不连续或SSRC改变时会重新开始分组。
+   */
+  int AddMediaPacket(const uint8_t *packet, size_t packetlen) {
+    return AddMediaPacket(packet, packetlen, 0, 0);
+  }
+
+  /** 和上面的函数一样，但媒体包由头部\c header 和单独存放的负载\c payload 组成，
+   *  例如转发的数据包，负载不需要先复制到头部之后。 */
+  int AddMediaPacket(const uint8_t *header, size_t headerlen,
+                     const uint8_t *payload, size_t payloadlen);
+
+  /** 返回最近一次 AddMediaPacket 调用生成的第\c index个FEC包，长度存入\c packetlen。 */
+  const uint8_t *GetFECPacket(int index, size_t *packetlen) const;
+private:
+  class Accumulator {
+  public:
+    uint8_t *buffer;
+    size_t payloadlen;
+  };
+
+  void AddToAccumulator(Accumulator &acc, const uint8_t *header,
+                        size_t headerlen, const uint8_t *payload,
+                        size_t payloadlen, bool first);
+  void FinishAccumulator(Accumulator &acc, const uint8_t *lastpacket,
+                         int count, uint8_t stride);
+
+  size_t maxpacksize;
+  int numcolumns, numrows;
+  uint8_t fecpt;
+  uint32_t fecssrc;
+  uint16_t fecseqnr;
+
+  Accumulator rowacc;
+  Accumulator *colaccs;
+
+  int position;
+  uint16_t nextseqnr;
+  uint32_t mediassrc;
+
+  const Accumulator *ready[2];
+  int numready;
+};
+
+/** 基于异或的前向纠错（FEC）解码器，与 RTPFECEncoder 生成的FEC包配合使用。
+ *  最近收到的媒体包和FEC包保存在固定大小的环形缓冲区中；当某个FEC包保护的
+ *  数据包中恰好缺少一个时，通过异或恢复该数据包。恢复出的数据包会参与后续的
+ *  恢复，因此行和列FEC可以迭代地恢复突发丢失。
+ */
+class RTPFECDecoder {
+  MEDIA_RTP_NO_COPY(RTPFECDecoder)
+public:
+  /** 构造一个未初始化的解码器。 */
+  RTPFECDecoder();
+  ~RTPFECDecoder() { Destroy(); }
+
+  /** 初始化解码器，数据包大小不超过\c maxpacksize，负载类型为\c fecpt的RTP包被视为FEC包。 */
+  int Init(size_t maxpacksize, uint8_t fecpt);
+
+  /** 释放解码器使用的内存。 */
+  void Destroy();
+
+  /** 如果解码器已初始化则返回\c true。 */
+  bool IsInitialized() const { return mediaslots != 0; }
+
+  /** 如果RTP数据包\c packet 是FEC包则返回\c true。 */
+  bool IsFECPacket(const uint8_t *packet, size_t packetlen) const;
+
+  /** 保存一个收到的媒体包，并尝试利用已收到的FEC包恢复丢失的数据包。 */
+  int AddMediaPacket(const uint8_t *packet, size_t packetlen);
+
+  /** 保存一个收到的FEC包，并尝试恢复丢失的数据包。 */
+  int AddFECPacket(const uint8_t *packet, size_t packetlen);
+
+  /** 取出下一个恢复出的媒体包。返回的指针在下一次调用 AddMediaPacket 或
+   *  AddFECPacket 之前有效；没有更多恢复出的数据包时返回\c false。
+   */
+  bool GetNextRecoveredPacket(const uint8_t **packet, size_t *packetlen);
+
+  /** 返回已恢复的数据包总数。 */
+  uint32_t GetNumRecovered() const { return numrecovered; }
+private:
+  class MediaSlot {
+  public:
+    uint32_t ssrc;
+    uint16_t seqnr;
+    size_t length;
+    bool used;
+  };
+
+  class FECSlot {
+  public:
+    size_t length;
+    bool used;
+  };
+
+  const uint8_t *GetMediaPacket(uint32_t ssrc, uint16_t seqnr,
+                                size_t *packetlen) const;
+  uint8_t *StoreMediaPacket(uint32_t ssrc, uint16_t seqnr);
+  int AttemptRecovery(int fecindex);
+  void AttemptRecovery();
+
+  size_t maxpacksize;
+  uint8_t fecpt;
+
+  MediaSlot *mediaslots;
+  uint8_t *mediastorage;
+  FECSlot *fecslots;
+  uint8_t *fecstorage;
+  uint8_t *workbuffer;
+  int nextfecslot;
+  int numfecpackets;
+
+  uint16_t recoveredseqnrs[RTP_FECDECODER_MEDIASLOTS];
+  uint32_t recoveredssrcs[RTP_FECDECODER_MEDIASLOTS];
+  int recoveredstart, numrecoveredqueued;
+
+  bool hasnewest;
+  uint32_t newestssrc;
+  uint16_t newestseqnr;
+
+  uint32_t numrecovered;
+};
+
+#endif // MEDIA_RTP_FEC_H
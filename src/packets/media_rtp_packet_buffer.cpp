@@ -0,0 +1,147 @@
+#include "media_rtp_packet_buffer.h"
+#include <new>
+
+// ===================== RTPPacketBuffer implementation =====================
+
+RTPPacketBuffer::RTPPacketBuffer(RTPPacketBufferPool *p,size_t cap) : refcount(1)
+{
+	pool = p;
+	capacity = cap;
+	next = 0;
+}
+
+RTPPacketBuffer *RTPPacketBuffer::New(RTPPacketBufferPool *pool,size_t capacity)
+{
+	// 对象和数据一次分配，数据从对象末尾开始
+	void *mem = ::operator new(sizeof(RTPPacketBuffer)+capacity);
+	return new (mem) RTPPacketBuffer(pool,capacity);
+}
+
+void RTPPacketBuffer::Delete()
+{
+	this->~RTPPacketBuffer();
+	::operator delete(this);
+}
+
+RTPPacketBuffer *RTPPacketBuffer::Create(size_t capacity)
+{
+	return New(0,capacity);
+}
+
+void RTPPacketBuffer::Release()
+{
+	// 释放之前对数据的写入必须对回收缓冲区的线程可见
+	if (refcount.fetch_sub(1,std::memory_order_acq_rel) != 1)
+		return;
+
+	if (pool)
+		pool->Recycle(this);
+	else
+		Delete();
+}
+
+void RTPPacketBuffer::ReleaseData(uint8_t *data)
+{
+	MEDIA_RTP_UNUSED(data);
+	Release();
+}
+
+bool RTPPacketBuffer::AddDataReference(uint8_t *data)
+{
+	MEDIA_RTP_UNUSED(data);
+	AddReference();
+	return true;
+}
+
+// ===================== RTPPacketBufferPool implementation =====================
+
+RTPPacketBufferPool::RTPPacketBufferPool(size_t size,size_t max) : refcount(1)
+{
+	freelist = 0;
+	numfree = 0;
+	maxfree = max;
+	buffersize = size;
+}
+
+RTPPacketBufferPool::~RTPPacketBufferPool()
+{
+	while (freelist)
+	{
+		RTPPacketBuffer *buf = freelist;
+
+		freelist = buf->next;
+		buf->Delete();
+	}
+}
+
+RTPPacketBufferPool *RTPPacketBufferPool::Create(size_t buffersize,size_t maxfree)
+{
+	if (buffersize == 0)
+		return 0;
+	return new RTPPacketBufferPool(buffersize,maxfree);
+}
+
+RTPPacketBuffer *RTPPacketBufferPool::Allocate(size_t len)
+{
+	if (len > buffersize)
+		return RTPPacketBuffer::Create(len);
+
+	RTPPacketBuffer *buf = 0;
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		if (freelist)
+		{
+			buf = freelist;
+			freelist = buf->next;
+			numfree--;
+		}
+	}
+
+	if (buf)
+	{
+		buf->next = 0;
+		buf->refcount.store(1,std::memory_order_relaxed);
+	}
+	else
+		buf = RTPPacketBuffer::New(this,buffersize);
+
+	refcount.fetch_add(1,std::memory_order_relaxed); // 由借出的缓冲区持有
+	return buf;
+}
+
+size_t RTPPacketBufferPool::GetFreeBuffers()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return numfree;
+}
+
+void RTPPacketBufferPool::Recycle(RTPPacketBuffer *buf)
+{
+	bool keep;
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		keep = (numfree < maxfree);
+		if (keep)
+		{
+			buf->next = freelist;
+			freelist = buf;
+			numfree++;
+		}
+	}
+
+	if (!keep)
+		buf->Delete();
+
+	// 在锁外释放缓冲区持有的引用，这可能是最后一个引用
+	Release();
+}
+
+void RTPPacketBufferPool::Release()
+{
+	if (refcount.fetch_sub(1,std::memory_order_acq_rel) == 1)
+		delete this;
+}
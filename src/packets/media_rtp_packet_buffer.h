@@ -0,0 +1,150 @@
+/**
+ * \file media_rtp_packet_buffer.h
+ * \brief 引用计数的数据包缓冲区、缓冲区池和只能移动的数据包句柄
+ */
+
+#ifndef MEDIA_RTP_PACKET_BUFFER_H
+#define MEDIA_RTP_PACKET_BUFFER_H
+
+#include "media_rtp_packet_factory.h"
+#include <atomic>
+#include <mutex>
+
+class RTPPacketBufferPool;
+
+/** 带侵入式引用计数的数据包缓冲区，数据紧跟在对象之后存放。
+ *  缓冲区作为 RTPRawPacket 的释放器时，数据随 RTPPacket 或 RTCPCompoundPacket 交出，
+ *  每个持有数据的对象释放一个引用；RTPPacket::Share 增加引用，使多个数据包共享同一份数据。
+ *  最后一个引用释放时，来自池的缓冲区回到池中，其他缓冲区被删除。引用可以在任意线程中释放。
+ */
+class RTPPacketBuffer : public RTPDataReleaser {
+  MEDIA_RTP_NO_COPY(RTPPacketBuffer)
+public:
+  /** 创建一个不属于任何池、可以容纳\c capacity 字节的缓冲区，引用计数为1。 */
+  static RTPPacketBuffer *Create(size_t capacity);
+
+  /** 返回缓冲区数据的起始地址。 */
+  uint8_t *GetData() { return reinterpret_cast<uint8_t *>(this + 1); }
+
+  /** 返回缓冲区可以容纳的字节数。 */
+  size_t GetCapacity() const { return capacity; }
+
+  /** 返回当前的引用数，只用于诊断。 */
+  uint32_t GetReferenceCount() const { return refcount.load(std::memory_order_acquire); }
+
+  /** 增加一个引用。 */
+  void AddReference() { refcount.fetch_add(1, std::memory_order_relaxed); }
+
+  /** 释放一个引用，最后一个引用释放时把缓冲区还给池或删除缓冲区。 */
+  void Release();
+
+  /** 释放数据的一个引用，\c data 必须是 GetData 返回的地址。 */
+  void ReleaseData(uint8_t *data) override;
+
+  /** 为数据增加一个引用，总是返回\c true。 */
+  bool AddDataReference(uint8_t *data) override;
+
+private:
+  friend class RTPPacketBufferPool;
+
+  RTPPacketBuffer(RTPPacketBufferPool *pool, size_t capacity);
+  ~RTPPacketBuffer() {}
+
+  static RTPPacketBuffer *New(RTPPacketBufferPool *pool, size_t capacity);
+  void Delete();
+
+  std::atomic<uint32_t> refcount;
+  RTPPacketBufferPool *pool;
+  size_t capacity;
+  RTPPacketBuffer *next; // 池中的空闲链表
+};
+
+/** 固定大小的数据包缓冲区池，避免每个收到的数据包都分配一次内存。
+ *  空闲的缓冲区保存在由互斥锁保护的链表中，最多保留\c maxfree 个。借出的每个缓冲区都持有池的一个引用，
+ *  所以池和 RTPSharedMemoryRing 一样用 Release 而不是 delete 释放，在最后一个缓冲区回到池中之后才被删除；
+ *  缓冲区可以在任意线程中回到池中。
+ */
+class RTPPacketBufferPool {
+  MEDIA_RTP_NO_COPY(RTPPacketBufferPool)
+public:
+  /** 创建一个缓冲区大小为\c buffersize 的池，调用者持有返回实例的一个引用。 */
+  static RTPPacketBufferPool *Create(size_t buffersize, size_t maxfree = RTP_PACKETBUFFER_DEFAULTMAXFREE);
+
+  /** 分配一个可以容纳\c len 字节的缓冲区，引用计数为1。大于缓冲区大小的数据包得到一个
+   *  不属于池的缓冲区，所以调用者不需要区分两种情况。 */
+  RTPPacketBuffer *Allocate(size_t len);
+
+  /** 返回池中缓冲区的大小。 */
+  size_t GetBufferSize() const { return buffersize; }
+
+  /** 返回当前空闲的缓冲区数量。 */
+  size_t GetFreeBuffers();
+
+  /** 增加一个引用，例如传输器在使用应用程序提供的池期间持有一个引用。 */
+  void AddReference() { refcount.fetch_add(1, std::memory_order_relaxed); }
+
+  /** 释放调用者的引用。 */
+  void Release();
+
+private:
+  friend class RTPPacketBuffer;
+
+  RTPPacketBufferPool(size_t buffersize, size_t maxfree);
+  ~RTPPacketBufferPool();
+
+  void Recycle(RTPPacketBuffer *buf);
+
+  std::atomic<uint32_t> refcount;
+  std::mutex mutex;
+  RTPPacketBuffer *freelist;
+  size_t numfree, maxfree;
+  size_t buffersize;
+};
+
+/** 持有一个 RTPPacket 的只能移动的句柄，析构时删除数据包，例如 RTPPacketRef ref(session.GetNextPacket())。
+ *  Share 返回共享同一份数据的另一个句柄，可以交给其他使用者或其他线程，
+ *  数据在最后一个共享它的句柄释放之后才被释放。
+ */
+class RTPPacketRef {
+public:
+  RTPPacketRef() : packet(0) {}
+  explicit RTPPacketRef(RTPPacket *p) : packet(p) {}
+  RTPPacketRef(RTPPacketRef &&r) noexcept : packet(r.packet) { r.packet = 0; }
+  ~RTPPacketRef() { delete packet; }
+
+  RTPPacketRef &operator=(RTPPacketRef &&r) noexcept {
+    if (this != &r)
+      Reset(r.Detach());
+    return *this;
+  }
+
+  RTPPacketRef(const RTPPacketRef &) = delete;
+  RTPPacketRef &operator=(const RTPPacketRef &) = delete;
+
+  /** 返回持有的数据包，没有数据包时返回null。 */
+  RTPPacket *Get() const { return packet; }
+  RTPPacket *operator->() const { return packet; }
+  RTPPacket &operator*() const { return *packet; }
+  explicit operator bool() const { return packet != 0; }
+
+  /** 返回一个共享同一份数据的新句柄，参见 RTPPacket::Share。 */
+  RTPPacketRef Share() const { return RTPPacketRef(packet ? packet->Share() : 0); }
+
+  /** 交出数据包的所有权，句柄变为空。 */
+  RTPPacket *Detach() {
+    RTPPacket *p = packet;
+    packet = 0;
+    return p;
+  }
+
+  /** 删除持有的数据包并改为持有\c p。 */
+  void Reset(RTPPacket *p = 0) {
+    delete packet;
+    packet = p;
+  }
+
+private:
+  RTPPacket *packet;
+};
+
+#endif // MEDIA_RTP_PACKET_BUFFER_H
@@ -1,4 +1,5 @@
 #include "media_rtp_packet_factory.h"
+#include "media_rtp_packet_buffer.h"
 #include "media_rtp_structs.h"
 #include "media_rtp_defines.h"
 #include "media_rtp_errors.h"
@@ -31,6 +32,7 @@ void RTPPacket::Clear()
 	extensionlength = 0;
 	error = 0;
 	externalbuffer = false;
+	releaser = 0;
 }
 
 RTPPacket::RTPPacket(RTPRawPacket &rawpack) : receivetime(rawpack.GetReceiveTime())
@@ -160,6 +162,7 @@ int RTPPacket::ParseRawPacket(RTPRawPacket &rawpack)
 	RTPPacket::payload = packetbytes+payloadoffset;
 	RTPPacket::packetlength = packetlen;
 	RTPPacket::payloadlength = payloadlength;
+	RTPPacket::releaser = rawpack.GetDataReleaser();
 
 	// 我们将原始数据包的数据清零，因为我们现在正在使用它！
 	rawpack.ZeroData();
@@ -167,6 +170,57 @@ int RTPPacket::ParseRawPacket(RTPRawPacket &rawpack)
 	return 0;
 }
 
+RTPPacket::RTPPacket(const RTPTime &recvtime) : receivetime(recvtime)
+{
+	Clear();
+}
+
+RTPPacket *RTPPacket::Share()
+{
+	if (error < 0 || packet == 0 || externalbuffer)
+		return 0;
+
+	if (releaser == 0 || !releaser->AddDataReference(packet))
+	{
+		// 第一次共享时把数据移到引用计数的缓冲区中，之后的共享不再复制
+		RTPPacketBuffer *buf = RTPPacketBuffer::Create(packetlength);
+		uint8_t *newpacket = buf->GetData();
+
+		memcpy(newpacket,packet,packetlength);
+		payload = newpacket+(payload-packet);
+		if (extension)
+			extension = newpacket+(extension-packet);
+
+		if (releaser)
+			releaser->ReleaseData(packet);
+		else
+			delete [] packet;
+
+		packet = newpacket;
+		releaser = buf;
+		buf->AddReference();
+	}
+
+	RTPPacket *p = new RTPPacket(receivetime);
+
+	p->hasextension = hasextension;
+	p->hasmarker = hasmarker;
+	p->numcsrcs = numcsrcs;
+	p->payloadtype = payloadtype;
+	p->extseqnr = extseqnr;
+	p->timestamp = timestamp;
+	p->ssrc = ssrc;
+	p->packet = packet;
+	p->payload = payload;
+	p->packetlength = packetlength;
+	p->payloadlength = payloadlength;
+	p->extid = extid;
+	p->extension = extension;
+	p->extensionlength = extensionlength;
+	p->releaser = releaser;
+	return p;
+}
+
 uint32_t RTPPacket::GetCSRC(int num) const
 {
 	if (num >= numcsrcs)
@@ -282,6 +336,41 @@ int RTPPacket::BuildPacket(uint8_t payloadtype,const void *payloaddata,size_t pa
 	return 0;
 }
 
+bool RTPPacket::GetOneByteExtensionElement(uint8_t id,const uint8_t **data,size_t *len) const
+{
+	if (!hasextension || extid != RTP_ONEBYTEHEADEREXTENSION_ID || id == 0 || id == 15)
+		return false;
+
+	size_t pos = 0;
+
+	while (pos < extensionlength)
+	{
+		uint8_t hdr = extension[pos];
+
+		if (hdr == 0) // 填充字节
+		{
+			pos++;
+			continue;
+		}
+
+		uint8_t elemid = hdr >> 4;
+		size_t elemlen = (size_t)(hdr & 0x0F) + 1;
+
+		if (elemid == 15) // 保留ID，停止解析（参见 rfc 8285 4.2）
+			return false;
+		if (pos + 1 + elemlen > extensionlength)
+			return false;
+		if (elemid == id)
+		{
+			*data = extension + pos + 1;
+			*len = elemlen;
+			return true;
+		}
+		pos += 1 + elemlen;
+	}
+	return false;
+}
+
 // ===================== End of RTPPacket implementation =====================
 
 // ===================== RTPPacketBuilder implementation (moved from media_rtp_packet_builder.cpp) =====================
@@ -289,6 +378,8 @@ int RTPPacket::BuildPacket(uint8_t payloadtype,const void *payloaddata,size_t pa
 RTPPacketBuilder::RTPPacketBuilder() : lastwallclocktime(0,0)
 {
 	init = false;
+	havetransmittime = false;
+	fwdactive = false;
 }
 
 RTPPacketBuilder::~RTPPacketBuilder()
@@ -406,6 +497,7 @@ uint32_t RTPPacketBuilder::CreateNewSSRC()
 	// p 38：如果发送方更改其 SSRC 标识符，则计数应重置
 	numpayloadbytes = 0;
 	numpackets = 0;
+	fwdactive = false;
 	return ssrc;
 }
 
@@ -425,6 +517,7 @@ uint32_t RTPPacketBuilder::CreateNewSSRC(RTPSources &sources)
 	// p 38：如果发送方更改其 SSRC 标识符，则计数应重置
 	numpayloadbytes = 0;
 	numpackets = 0;
+	fwdactive = false;
 	return ssrc;
 }
 
@@ -490,20 +583,108 @@ int RTPPacketBuilder::PrivateBuildPacket(const void *data,size_t len,
 		lastwallclocktime = RTPTime::CurrentTime();
 		lastrtptimestamp = timestamp;
 		prevrtptimestamp = timestamp;
+		havetransmittime = false;
 	}
 	else if (timestamp != prevrtptimestamp)
 	{
 		lastwallclocktime = RTPTime::CurrentTime();
 		lastrtptimestamp = timestamp;
 		prevrtptimestamp = timestamp;
+		havetransmittime = false;
 	}
 	
 	numpayloadbytes += (uint32_t)p.GetPayloadLength();
 	numpackets++;
 	timestamp += timestampinc;
 	seqnr++;
+	fwdactive = false; // 之后转发的数据包接着这个数据包编号
 
 	return 0;
 }
 
+int RTPPacketBuilder::BuildForwardedHeader(const RTPPacket &pack,double timestampunit)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	size_t headerlen = (size_t)(pack.GetPayloadData()-pack.GetPacketData());
+
+	if (headerlen < sizeof(RTPHeader) || headerlen > maxpacksize)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	RTPTime curtime = RTPTime::CurrentTime();
+
+	if (!fwdactive || pack.GetSSRC() != fwdssrc)
+	{
+		uint32_t newtimestamp = timestamp;
+
+		// 新的源接着上一个数据包：时间戳至少增加1，接收端不会把两帧当成同一帧
+		if (numpackets > 0)
+		{
+			RTPTime elapsed = curtime;
+			elapsed -= lastwallclocktime;
+
+			double inc = (timestampunit > 0) ? elapsed.GetDouble()/timestampunit : 0;
+			newtimestamp = lastrtptimestamp+((inc >= 1.0) ? (uint32_t)inc : 1);
+		}
+		fwdseqoffset = (uint16_t)(seqnr-pack.GetSequenceNumber());
+		fwdtsoffset = newtimestamp-pack.GetTimestamp();
+		fwdssrc = pack.GetSSRC();
+		fwdactive = true;
+	}
+
+	uint16_t newseqnr = (uint16_t)(pack.GetSequenceNumber()+fwdseqoffset);
+	uint32_t newtimestamp = pack.GetTimestamp()+fwdtsoffset;
+
+	memcpy(buffer,pack.GetPacketData(),headerlen);
+
+	RTPHeader *rtphdr = (RTPHeader *)buffer;
+
+	rtphdr->sequencenumber = htons(newseqnr);
+	rtphdr->timestamp = htonl(newtimestamp);
+	rtphdr->ssrc = htonl(ssrc);
+	packetlength = headerlen;
+
+	// 乱序或重复的数据包照常转发，但不改变后续数据包使用的序列号和时间戳
+	if ((int16_t)(newseqnr-seqnr) >= 0)
+	{
+		if (numpackets == 0 || newtimestamp != prevrtptimestamp)
+		{
+			lastwallclocktime = curtime;
+			lastrtptimestamp = newtimestamp;
+			prevrtptimestamp = newtimestamp;
+			havetransmittime = false;
+		}
+		seqnr = newseqnr+1;
+		timestamp = newtimestamp;
+	}
+	numpayloadbytes += (uint32_t)pack.GetPayloadLength();
+	numpackets++;
+	return 0;
+}
+
+int RTPPacketBuilder::AppendForwardedPayload(const void *payload,size_t len)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (packetlength+len > maxpacksize)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	memcpy(buffer+packetlength,payload,len);
+	packetlength += len;
+	return 0;
+}
+
+bool RTPPacketBuilder::SetPacketTransmitTime(uint32_t rtptimestamp,const RTPTime &sendtime)
+{
+	if (!init || numpackets == 0)
+		return false;
+	if (havetransmittime || rtptimestamp != lastrtptimestamp)
+		return false;
+
+	lastwallclocktime = sendtime;
+	havetransmittime = true;
+	return true;
+}
+
 // ===================== End of RTPPacketBuilder implementation =====================
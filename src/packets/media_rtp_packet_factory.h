@@ -16,6 +16,27 @@
 
 class RTPSources;
 class RTPRawPacket;
+class RTPPacket;
+
+/** 释放不是用 new[] 分配的数据包数据，例如传输器直接指向共享内存中槽位的数据。
+ *  数据随 RTPRawPacket 交给 RTPPacket 或 RTCPCompoundPacket 时释放器也一起交出，
+ *  最后持有数据的对象销毁时调用 ReleaseData，调用可能来自任意线程。
+ */
+class RTPDataReleaser {
+public:
+  virtual ~RTPDataReleaser() {}
+
+  /** 释放 \c data 指向的数据包数据。 */
+  virtual void ReleaseData(uint8_t *data) = 0;
+
+  /** 为 \c data 增加一个引用，使多个对象可以共享数据，每个引用都要用 ReleaseData 释放。
+   *  不支持共享数据时返回 \c false（默认实现）。
+   */
+  virtual bool AddDataReference(uint8_t *data) {
+    MEDIA_RTP_UNUSED(data);
+    return false;
+  }
+};
 
 /** 此类由传输组件用于存储传入的RTP和RTCP数据。 */
 class RTPRawPacket {
@@ -57,8 +78,15 @@ public:
   void ZeroData() {
     packetdata = 0;
     packetdatalength = 0;
+    releaser = 0;
   }
 
+  /** 设置释放数据的对象；为null（默认值）时数据用 delete[] 释放。 */
+  void SetDataReleaser(RTPDataReleaser *r) { releaser = r; }
+
+  /** 返回释放数据的对象，数据用 delete[] 释放时返回null。 */
+  RTPDataReleaser *GetDataReleaser() const { return releaser; }
+
   /** 为RTP或RTCP数据分配一定数量的字节。 */
   uint8_t *AllocateBytes(bool isrtp, int recvlen) const;
 
@@ -70,11 +98,13 @@ public:
 
 private:
   void DeleteData();
+  void ReleaseBytes();
 
   uint8_t *packetdata;
   size_t packetdatalength;
   RTPTime receivetime;
   RTPEndpoint *senderaddress;
+  RTPDataReleaser *releaser;
   bool isrtp;
 };
 
@@ -85,6 +115,7 @@ inline RTPRawPacket::RTPRawPacket(uint8_t *data, size_t datalen,
   packetdata = data;
   packetdatalength = datalen;
   senderaddress = address;
+  releaser = 0;
   isrtp = rtp;
 }
 
@@ -94,6 +125,7 @@ inline RTPRawPacket::RTPRawPacket(uint8_t *data, size_t datalen,
   packetdata = data;
   packetdatalength = datalen;
   senderaddress = address;
+  releaser = 0;
 
   isrtp = true;
   if (datalen >= sizeof(RTCPCommonHeader)) {
@@ -107,9 +139,18 @@ inline RTPRawPacket::RTPRawPacket(uint8_t *data, size_t datalen,
 
 inline RTPRawPacket::~RTPRawPacket() { DeleteData(); }
 
+inline void RTPRawPacket::ReleaseBytes() {
+  if (packetdata) {
+    if (releaser)
+      releaser->ReleaseData(packetdata);
+    else
+      delete[] packetdata;
+  }
+  releaser = 0;
+}
+
 inline void RTPRawPacket::DeleteData() {
-  if (packetdata)
-    delete[] packetdata;
+  ReleaseBytes();
   if (senderaddress)
     delete senderaddress;
 
@@ -123,8 +164,7 @@ inline uint8_t *RTPRawPacket::AllocateBytes(bool isrtp, int recvlen) const {
 }
 
 inline void RTPRawPacket::SetData(uint8_t *data, size_t datalen) {
-  if (packetdata)
-    delete[] packetdata;
+  ReleaseBytes();
 
   packetdata = data;
   packetdatalength = datalen;
@@ -195,6 +235,17 @@ public:
                     uint32_t timestampinc, uint16_t hdrextID,
                     const void *hdrextdata, size_t numhdrextwords);
 
+  /** 为转发收到的数据包\c pack 构建头部：复制\c pack 的头部（包括CSRC列表和头部扩展），
+   *  把SSRC改为当前SSRC，并映射序列号和时间戳。来自同一个源的数据包保持原来的序列号和时间戳间隔，
+   *  接收端仍能看到丢包；换源或者中间构建过普通数据包时，序列号接着上一个数据包，
+   *  时间戳按经过的墙钟时间和时间戳单位\c timestampunit 增加。之后GetPacket和GetPacketLength
+   *  返回这个头部，负载仍在\c pack 的缓冲区中。
+   */
+  int BuildForwardedHeader(const RTPPacket &pack, double timestampunit);
+
+  /** 把长度为\c len 的\c payload 追加到BuildForwardedHeader构建的头部之后，得到完整的数据包。 */
+  int AppendForwardedPayload(const void *payload, size_t len);
+
   /** 返回指向最后构建的RTP数据包数据的指针。 */
   uint8_t *GetPacket() {
     if (!init)
@@ -265,8 +316,16 @@ public:
     return lastrtptimestamp;
   }
 
+  /** 用数据包实际发出的时间 \c sendtime 替换RTP时间戳为 \c rtptimestamp 的数据包的生成时间。
+   *  只有与 GetPacketTimestamp 相同的时间戳会被接受，并且只使用该时间戳的第一个数据包的发送时间；
+   *  发送者报告据此计算NTP时间戳与RTP时间戳的对应关系。如果时间被接受则返回true。 */
+  bool SetPacketTransmitTime(uint32_t rtptimestamp, const RTPTime &sendtime);
+
   /** 设置要使用的特定SSRC。使用前请谨慎。 */
-  void AdjustSSRC(uint32_t s) { ssrc = s; }
+  void AdjustSSRC(uint32_t s) {
+    ssrc = s;
+    fwdactive = false;
+  }
 
 private:
   int PrivateBuildPacket(const void *data, size_t len, uint8_t pt, bool mark,
@@ -298,6 +357,13 @@ private:
   RTPTime lastwallclocktime;
   uint32_t lastrtptimestamp;
   uint32_t prevrtptimestamp;
+  bool havetransmittime;
+
+  // 转发数据包的序列号和时间戳映射，fwdactive 为 false 时下一个转发的数据包重新建立映射
+  bool fwdactive;
+  uint32_t fwdssrc;
+  uint16_t fwdseqoffset;
+  uint32_t fwdtsoffset;
 };
 
 inline int RTPPacketBuilder::SetDefaultPayloadType(uint8_t pt) {
@@ -374,8 +440,12 @@ public:
             const void *extensiondata, void *buffer, size_t buffersize);
 
   virtual ~RTPPacket() {
-    if (packet && !externalbuffer)
-      delete[] packet;
+    if (packet && !externalbuffer) {
+      if (releaser)
+        releaser->ReleaseData(packet);
+      else
+        delete[] packet;
+    }
   }
 
   /** 如果构造函数之一发生错误，此函数返回错误代码。 */
@@ -439,13 +509,31 @@ public:
   /** 返回头部扩展数据的长度。 */
   size_t GetExtensionLength() const { return extensionlength; }
 
+  /** 在RFC 8285一字节格式（标识符0xBEDE）的头部扩展中查找ID为\c id的元素。
+   *  找到时将元素数据及其长度存入\c data和\c len并返回\c true，否则返回\c false。
+   */
+  bool GetOneByteExtensionElement(uint8_t id, const uint8_t **data,
+                                  size_t *len) const;
+
   /** 返回接收此数据包的时间。
    *  当从RTPRawPacket实例创建RTPPacket实例时，原始数据包的接收时间
    *  存储在RTPPacket实例中。此函数然后检索该时间。
    */
   RTPTime GetReceiveTime() const { return receivetime; }
 
+  /** 返回一个与本数据包共享数据的新实例，两个实例可以分别在不同的线程中删除。
+   *  数据的释放器支持共享时（例如 RTPPacketBuffer）不会复制数据；否则先把数据移到一个新的
+   *  RTPPacketBuffer 中，只复制这一次。数据在外部缓冲区中或者数据包无效时返回null。
+   */
+  RTPPacket *Share();
+
+  /** 返回释放数据包数据的对象，数据用 <tt>delete []</tt> 释放或在外部缓冲区中时返回null。
+   *  释放器支持共享时，可以用它为 GetPacketData 返回的数据增加引用，例如重传缓存保存转发的负载。 */
+  RTPDataReleaser *GetDataReleaser() const { return releaser; }
+
 private:
+  RTPPacket(const RTPTime &recvtime);
+
   void Clear();
   int ParseRawPacket(RTPRawPacket &rawpack);
   int BuildPacket(uint8_t payloadtype, const void *payloaddata,
@@ -470,6 +558,7 @@ private:
   size_t extensionlength;
 
   bool externalbuffer;
+  RTPDataReleaser *releaser;
 
   RTPTime receivetime;
 };
@@ -0,0 +1,1300 @@
+#include "media_rtp_bundle_transmitter.h"
+#include "media_rtp_packet_factory.h"
+#include "media_rtp_packet_buffer.h"
+#include "media_rtp_structs.h"
+#include "media_rtp_errors.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef RTP_SUPPORT_IFADDRS
+	#include <ifaddrs.h>
+#endif // RTP_SUPPORT_IFADDRS
+#include <algorithm>
+
+#define RTPBUNDLETRANS_MAXPACKSIZE							65535
+#define RTPBUNDLETRANS_MAXSOCKETS							64
+#define RTPBUNDLETRANS_MAXRTCPPARTS							32
+
+	#define MAINMUTEX_LOCK 		{ if (m_threadsafe) m_mainMutex.lock(); }
+	#define MAINMUTEX_UNLOCK	{ if (m_threadsafe) m_mainMutex.unlock(); }
+	#define WAITMUTEX_LOCK		{ if (m_threadsafe) m_waitMutex.lock(); }
+	#define WAITMUTEX_UNLOCK	{ if (m_threadsafe) m_waitMutex.unlock(); }
+
+static inline uint32_t RTPBundleReadSSRC(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24)|((uint32_t)p[1] << 16)|((uint32_t)p[2] << 8)|(uint32_t)p[3];
+}
+
+static inline bool RTPBundleIsRTCP(const uint8_t *data,size_t len)
+{
+	// RFC 5761：复用时RTCP数据包的类型在200到204之间，不会和动态RTP负载类型冲突
+	if (len < sizeof(RTCPCommonHeader))
+		return false;
+
+	uint8_t packettype = ((const RTCPCommonHeader *)data)->packettype;
+	return (packettype >= 200 && packettype <= 204);
+}
+
+RTPBundleTransport::RTPBundleTransport()
+{
+	bindip = 0;
+	port = 0;
+	maxpacksize = 0;
+	bufferpool = 0;
+	nextsendsock = 0;
+	unroutable = 0;
+}
+
+RTPBundleTransport::~RTPBundleTransport()
+{
+	Destroy();
+}
+
+int RTPBundleTransport::Create(uint32_t ip,uint16_t portnum,size_t numsockets,size_t maxsize)
+{
+	if (!sockets.empty())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (numsockets == 0 || numsockets > RTPBUNDLETRANS_MAXSOCKETS || maxsize == 0 || maxsize > RTPBUNDLETRANS_MAXPACKSIZE)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	// 第一个套接字确定端口，其余的套接字用 SO_REUSEPORT 绑定到同一端口
+	for (size_t i = 0 ; i < numsockets ; i++)
+	{
+		int sock = socket(AF_INET,SOCK_DGRAM|SOCK_CLOEXEC,0);
+
+		if (sock < 0)
+		{
+			Destroy();
+			return MEDIA_RTP_ERR_RESOURCE_ERROR;
+		}
+		sockets.push_back(sock);
+
+		if (numsockets > 1)
+		{
+			int on = 1;
+
+			if (setsockopt(sock,SOL_SOCKET,SO_REUSEPORT,(const char *)&on,sizeof(int)) != 0)
+			{
+				Destroy();
+				return MEDIA_RTP_ERR_OPERATION_FAILED;
+			}
+		}
+
+		struct sockaddr_in addr;
+
+		memset(&addr,0,sizeof(struct sockaddr_in));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(portnum);
+		addr.sin_addr.s_addr = htonl(ip);
+		if (bind(sock,(struct sockaddr *)&addr,sizeof(struct sockaddr_in)) != 0)
+		{
+			Destroy();
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+
+		if (portnum == 0)
+		{
+			socklen_t addrlen = sizeof(struct sockaddr_in);
+
+			if (getsockname(sock,(struct sockaddr *)&addr,&addrlen) != 0)
+			{
+				Destroy();
+				return MEDIA_RTP_ERR_OPERATION_FAILED;
+			}
+			portnum = ntohs(addr.sin_port);
+		}
+	}
+
+	bindip = ip;
+	port = portnum;
+	maxpacksize = maxsize;
+
+	// 用于识别从本传输发出的数据包
+	localips.clear();
+	if (bindip == INADDR_ANY)
+	{
+#ifdef RTP_SUPPORT_IFADDRS
+		struct ifaddrs *addrs;
+
+		if (getifaddrs(&addrs) == 0)
+		{
+			for (struct ifaddrs *tmp = addrs ; tmp != 0 ; tmp = tmp->ifa_next)
+			{
+				if (tmp->ifa_addr != 0 && tmp->ifa_addr->sa_family == AF_INET)
+					localips.push_back(ntohl(((struct sockaddr_in *)tmp->ifa_addr)->sin_addr.s_addr));
+			}
+			freeifaddrs(addrs);
+		}
+#endif // RTP_SUPPORT_IFADDRS
+		localips.push_back(INADDR_LOOPBACK);
+	}
+
+	recvbuffer.resize(RTP_BUNDLE_RECEIVEBATCH*maxpacksize);
+	recvmsgs.resize(RTP_BUNDLE_RECEIVEBATCH);
+	recviovecs.resize(RTP_BUNDLE_RECEIVEBATCH);
+	recvaddrs.resize(RTP_BUNDLE_RECEIVEBATCH);
+	for (size_t i = 0 ; i < RTP_BUNDLE_RECEIVEBATCH ; i++)
+	{
+		recviovecs[i].iov_base = recvbuffer.data()+i*maxpacksize;
+		recviovecs[i].iov_len = maxpacksize;
+
+		memset(&recvmsgs[i],0,sizeof(struct mmsghdr));
+		recvmsgs[i].msg_hdr.msg_name = &recvaddrs[i];
+		recvmsgs[i].msg_hdr.msg_iov = &recviovecs[i];
+		recvmsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	bufferpool = RTPPacketBufferPool::Create(RTP_PACKETBUFFER_DEFAULTSIZE);
+	unroutable = 0;
+	nextsendsock = 0;
+	return 0;
+}
+
+void RTPBundleTransport::Destroy()
+{
+	for (auto sock : sockets)
+		close(sock);
+	sockets.clear();
+	if (bufferpool != 0)
+	{
+		bufferpool->Release(); // 会话仍持有的数据包释放之后池才被删除
+		bufferpool = 0;
+	}
+	remotessrcs.clear();
+	localssrcs.clear();
+	addresses.clear();
+}
+
+int RTPBundleTransport::Poll(std::vector<RTPBundleTransmitter *> *ready)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (sockets.empty())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	for (auto sock : sockets)
+	{
+		int status = ReadSocket(sock,ready);
+		if (status < 0)
+			return status;
+	}
+	return 0;
+}
+
+int RTPBundleTransport::PollSocket(int sock,std::vector<RTPBundleTransmitter *> *ready)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (std::find(sockets.begin(),sockets.end(),sock) == sockets.end())
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	return ReadSocket(sock,ready);
+}
+
+uint64_t RTPBundleTransport::GetUnroutablePackets()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return unroutable;
+}
+
+int RTPBundleTransport::Attach(int *sendsock)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (sockets.empty())
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	// 发送的数据包轮流使用各个套接字，它们绑定在同一个端口上
+	*sendsock = sockets[nextsendsock++%sockets.size()];
+	return 0;
+}
+
+void RTPBundleTransport::Detach(RTPBundleTransmitter *trans)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	for (auto it = remotessrcs.begin() ; it != remotessrcs.end() ; )
+	{
+		if (it->second == trans)
+			it = remotessrcs.erase(it);
+		else
+			++it;
+	}
+	for (auto it = localssrcs.begin() ; it != localssrcs.end() ; )
+	{
+		if (it->second == trans)
+			it = localssrcs.erase(it);
+		else
+			++it;
+	}
+	for (auto it = addresses.begin() ; it != addresses.end() ; )
+	{
+		std::vector<RTPBundleTransmitter *> &v = it->second;
+
+		v.erase(std::remove(v.begin(),v.end(),trans),v.end());
+		if (v.empty())
+			it = addresses.erase(it);
+		else
+			++it;
+	}
+
+	trans->FlushPackets();
+}
+
+void RTPBundleTransport::AddAddress(RTPBundleTransmitter *trans,const RTPEndpoint &addr)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	addresses[AddressKey(addr.GetIPv4(),addr.GetRtpPort())].push_back(trans);
+}
+
+void RTPBundleTransport::DeleteAddress(RTPBundleTransmitter *trans,const RTPEndpoint &addr)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	auto it = addresses.find(AddressKey(addr.GetIPv4(),addr.GetRtpPort()));
+	if (it == addresses.end())
+		return;
+
+	std::vector<RTPBundleTransmitter *> &v = it->second;
+
+	v.erase(std::remove(v.begin(),v.end(),trans),v.end());
+	if (v.empty())
+		addresses.erase(it);
+}
+
+void RTPBundleTransport::AddRemoteSSRC(RTPBundleTransmitter *trans,uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	remotessrcs[ssrc] = trans;
+}
+
+void RTPBundleTransport::DeleteRemoteSSRC(RTPBundleTransmitter *trans,uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	auto it = remotessrcs.find(ssrc);
+	if (it != remotessrcs.end() && it->second == trans)
+		remotessrcs.erase(it);
+}
+
+void RTPBundleTransport::AddLocalSSRC(RTPBundleTransmitter *trans,uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	localssrcs[ssrc] = trans;
+}
+
+void RTPBundleTransport::DeleteLocalSSRC(RTPBundleTransmitter *trans,uint32_t ssrc)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	auto it = localssrcs.find(ssrc);
+	if (it != localssrcs.end() && it->second == trans)
+		localssrcs.erase(it);
+}
+
+bool RTPBundleTransport::IsLocalAddress(uint32_t ip,uint16_t portnum) const
+{
+	if (portnum != port)
+		return false;
+	if (bindip != INADDR_ANY)
+		return ip == bindip;
+	return std::find(localips.begin(),localips.end(),ip) != localips.end();
+}
+
+int RTPBundleTransport::ReadSocket(int sock,std::vector<RTPBundleTransmitter *> *ready)
+{
+	while (true)
+	{
+		for (size_t i = 0 ; i < RTP_BUNDLE_RECEIVEBATCH ; i++)
+			recvmsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+
+		int count = recvmmsg(sock,recvmsgs.data(),RTP_BUNDLE_RECEIVEBATCH,MSG_DONTWAIT,0);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+
+		// 同一批数据包共享一个接收时间
+		RTPTime curtime = RTPTime::CurrentTime();
+
+		for (int i = 0 ; i < count ; i++)
+		{
+			const struct msghdr &hdr = recvmsgs[i].msg_hdr;
+			size_t recvlen = recvmsgs[i].msg_len;
+
+			if ((hdr.msg_flags&MSG_TRUNC) || recvlen == 0 || hdr.msg_namelen < sizeof(struct sockaddr_in))
+			{
+				unroutable++;
+				continue;
+			}
+
+			uint8_t *data = (uint8_t *)recviovecs[i].iov_base;
+			uint32_t ip = ntohl(recvaddrs[i].sin_addr.s_addr);
+			uint16_t srcport = ntohs(recvaddrs[i].sin_port);
+
+			if (RTPBundleIsRTCP(data,recvlen))
+				DispatchRTCP(data,recvlen,ip,srcport,curtime,ready);
+			else
+				DispatchRTP(data,recvlen,ip,srcport,curtime,ready);
+		}
+
+		// 没有填满这一批时套接字已经读空，省去一次返回 EAGAIN 的系统调用
+		if (count < RTP_BUNDLE_RECEIVEBATCH)
+			break;
+	}
+	return 0;
+}
+
+void RTPBundleTransport::DispatchRTP(uint8_t *data,size_t len,uint32_t ip,uint16_t srcport,const RTPTime &t,std::vector<RTPBundleTransmitter *> *ready)
+{
+	if (len < sizeof(RTPHeader))
+	{
+		unroutable++;
+		return;
+	}
+
+	uint32_t ssrc = RTPBundleReadSSRC(data+8);
+	RTPBundleTransmitter *trans;
+
+	auto it = remotessrcs.find(ssrc);
+	if (it != remotessrcs.end())
+		trans = it->second;
+	else
+	{
+		// 来自某个会话唯一的目的地址的新SSRC记给这个会话，之后的数据包不再查找地址
+		if ((trans = RouteAddress(ip,srcport)) == 0)
+		{
+			unroutable++;
+			return;
+		}
+		remotessrcs[ssrc] = trans;
+	}
+
+	RTPPacketBuffer *buf = bufferpool->Allocate(len);
+
+	memcpy(buf->GetData(),data,len);
+	Deliver(trans,buf,len,ip,srcport,t,true,ready);
+}
+
+void RTPBundleTransport::DispatchRTCP(const uint8_t *data,size_t len,uint32_t ip,uint16_t srcport,const RTPTime &t,std::vector<RTPBundleTransmitter *> *ready)
+{
+	// 把复合数据包拆分为单独的RTCP数据包并分别分配
+	struct Part
+	{
+		RTPBundleTransmitter *trans;
+		size_t offset, length;
+	};
+
+	Part parts[RTPBUNDLETRANS_MAXRTCPPARTS];
+	size_t numparts = 0;
+	size_t offset = 0;
+	bool single = true;
+
+	while (offset < len)
+	{
+		const RTCPCommonHeader *hdr = (const RTCPCommonHeader *)(data+offset);
+
+		if (len-offset < sizeof(RTCPCommonHeader) || hdr->version != RTP_VERSION || numparts == RTPBUNDLETRANS_MAXRTCPPARTS)
+		{
+			unroutable++;
+			return;
+		}
+
+		size_t length = ((size_t)ntohs(hdr->length)+1)*sizeof(uint32_t);
+
+		if (length > len-offset)
+		{
+			unroutable++;
+			return;
+		}
+
+		RTPBundleTransmitter *trans = RouteRTCP(data+offset,length,ip,srcport);
+
+		if (trans == 0)
+		{
+			unroutable++;
+			single = false;
+		}
+		else
+		{
+			parts[numparts].trans = trans;
+			parts[numparts].offset = offset;
+			parts[numparts].length = length;
+			if (numparts > 0 && parts[0].trans != trans)
+				single = false;
+			numparts++;
+		}
+		offset += length;
+	}
+	if (numparts == 0)
+		return;
+
+	// 通常整个复合数据包属于同一个会话，直接复制
+	if (single)
+	{
+		RTPPacketBuffer *buf = bufferpool->Allocate(len);
+
+		memcpy(buf->GetData(),data,len);
+		Deliver(parts[0].trans,buf,len,ip,srcport,t,false,ready);
+		return;
+	}
+
+	for (size_t i = 0 ; i < numparts ; i++)
+	{
+		RTPBundleTransmitter *trans = parts[i].trans;
+
+		if (trans == 0) // 已经和前面的部分一起分配
+			continue;
+
+		// 复合数据包必须以SR或RR开头
+		uint8_t packettype = data[parts[i].offset+1];
+		bool needrr = !(packettype == RTP_RTCPTYPE_SR || packettype == RTP_RTCPTYPE_RR);
+		size_t total = (needrr) ? 8 : 0;
+
+		for (size_t j = i ; j < numparts ; j++)
+		{
+			if (parts[j].trans == trans)
+				total += parts[j].length;
+		}
+
+		RTPPacketBuffer *buf = bufferpool->Allocate(total);
+		uint8_t *buffer = buf->GetData();
+		size_t pos = 0;
+
+		if (needrr)
+		{
+			// 不带报告块的RR，SSRC取第一个数据包的发送者
+			buffer[0] = 0x80;
+			buffer[1] = RTP_RTCPTYPE_RR;
+			buffer[2] = 0;
+			buffer[3] = 1;
+			if (parts[i].length >= 8)
+				memcpy(buffer+4,data+parts[i].offset+4,4);
+			else
+				memset(buffer+4,0,4);
+			pos = 8;
+		}
+		for (size_t j = i ; j < numparts ; j++)
+		{
+			if (parts[j].trans == trans)
+			{
+				memcpy(buffer+pos,data+parts[j].offset,parts[j].length);
+				pos += parts[j].length;
+				parts[j].trans = 0;
+			}
+		}
+		Deliver(trans,buf,total,ip,srcport,t,false,ready);
+	}
+}
+
+RTPBundleTransmitter *RTPBundleTransport::RouteAddress(uint32_t ip,uint16_t srcport)
+{
+	auto it = addresses.find(AddressKey(ip,srcport));
+
+	// 多个会话使用同一个地址时无法区分
+	if (it == addresses.end() || it->second.size() != 1)
+		return 0;
+	return it->second[0];
+}
+
+RTPBundleTransmitter *RTPBundleTransport::RouteRTCP(const uint8_t *packet,size_t len,uint32_t ip,uint16_t srcport)
+{
+	const RTCPCommonHeader *hdr = (const RTCPCommonHeader *)packet;
+
+	// SR、RR、APP和反馈消息以发送者的SSRC开始，SDES和BYE以第一个源的SSRC开始
+	if (len >= 8 && (hdr->count > 0 || !(hdr->packettype == RTP_RTCPTYPE_SDES || hdr->packettype == RTP_RTCPTYPE_BYE)))
+	{
+		auto it = remotessrcs.find(RTPBundleReadSSRC(packet+4));
+		if (it != remotessrcs.end())
+			return it->second;
+	}
+
+	// 报告块和反馈消息指向的是接收端自己的SSRC
+	size_t target = 0;
+
+	if (hdr->packettype == RTP_RTCPTYPE_SR && hdr->count > 0)
+		target = 28;
+	else if (hdr->packettype == RTP_RTCPTYPE_RR && hdr->count > 0)
+		target = 8;
+	else if (hdr->packettype == RTP_RTCPTYPE_RTPFB || hdr->packettype == RTP_RTCPTYPE_PSFB)
+		target = 8;
+	if (target != 0 && len >= target+4)
+	{
+		auto it = localssrcs.find(RTPBundleReadSSRC(packet+target));
+		if (it != localssrcs.end())
+			return it->second;
+	}
+
+	return RouteAddress(ip,srcport);
+}
+
+void RTPBundleTransport::Deliver(RTPBundleTransmitter *trans,RTPPacketBuffer *buf,size_t len,uint32_t ip,uint16_t srcport,const RTPTime &t,bool rtp,std::vector<RTPBundleTransmitter *> *ready)
+{
+	RTPEndpoint *addr = new RTPEndpoint(ip,srcport,srcport);
+	RTPTime recvtime = t;
+
+	if (trans->m_rawpacketlist.empty())
+	{
+		if (ready != 0)
+			ready->push_back(trans);
+		trans->ready.Signal();
+	}
+
+	RTPRawPacket *pack = new RTPRawPacket(buf->GetData(),len,addr,recvtime,rtp);
+
+	pack->SetDataReleaser(buf);
+	trans->m_rawpacketlist.push_back(pack);
+}
+
+RTPBundleTransmitter::RTPBundleTransmitter() : RTPTransmitter()
+{
+	m_created = false;
+	dropped = 0;
+	m_init = false;
+}
+
+RTPBundleTransmitter::~RTPBundleTransmitter()
+{
+	Destroy();
+}
+
+int RTPBundleTransmitter::Init(bool tsafe)
+{
+	if (m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	m_threadsafe = tsafe;
+
+	m_maxPackSize = RTPBUNDLETRANS_MAXPACKSIZE;
+	m_init = true;
+	return 0;
+}
+
+int RTPBundleTransmitter::Create(size_t maximumpacketsize,const RTPTransmissionParams *transparams)
+{
+	const RTPBundleTransmissionParams *params;
+	int status;
+
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 获取传输参数，必须指定共享传输
+
+	if (transparams == 0 || transparams->GetTransmissionProtocol() != RTPTransmitter::BundleProto)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+	params = static_cast<const RTPBundleTransmissionParams *>(transparams);
+	if (params->GetTransport() == 0)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+	if (maximumpacketsize > RTPBUNDLETRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	if (!params->GetCreatedAbortDescriptors())
+	{
+		if ((status = m_abortDesc.Init()) < 0)
+		{
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+		m_pAbortDesc = &m_abortDesc;
+	}
+	else
+	{
+		m_pAbortDesc = params->GetCreatedAbortDescriptors();
+		if (!m_pAbortDesc->IsInitialized())
+		{
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_INVALID_STATE;
+		}
+	}
+
+	if ((status = ready.Init()) < 0)
+	{
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
+	transport = params->GetTransport();
+	if ((status = transport->Attach(&sendsock)) < 0)
+	{
+		ready.Destroy();
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+	for (auto ssrc : params->GetRemoteSSRCs())
+		transport->AddRemoteSSRC(this,ssrc);
+
+	polltransport = params->GetPollTransport();
+	localssrcs.clear();
+	dropped = 0;
+	m_maxPackSize = maximumpacketsize;
+	m_waitingForData = false;
+	m_created = true;
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+void RTPBundleTransmitter::Destroy()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK;
+		return;
+	}
+
+	// 删除所有指向此传输器的路由，并释放尚未取出的数据包
+	transport->Detach(this);
+	destinations.clear();
+	ready.Destroy();
+	m_created = false;
+
+	if (m_waitingForData)
+	{
+		m_pAbortDesc->SendAbortSignal();
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_LOCK // 确保 WaitForIncomingData 函数已结束
+		WAITMUTEX_UNLOCK
+	}
+	else
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+
+	MAINMUTEX_UNLOCK
+}
+
+RTPTransmissionInfo *RTPBundleTransmitter::GetTransmissionInfo()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	RTPTransmissionInfo *tinf = 0;
+
+	if (m_created)
+		tinf = new RTPBundleTransmissionInfo(transport);
+	MAINMUTEX_UNLOCK
+	return tinf;
+}
+
+void RTPBundleTransmitter::DeleteTransmissionInfo(RTPTransmissionInfo *i)
+{
+	if (!m_init)
+		return;
+
+	delete i;
+}
+
+int RTPBundleTransmitter::GetLocalHostName(uint8_t *buffer,size_t *bufferlength)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	char name[1024];
+
+	if (gethostname(name,sizeof(name)-1) != 0)
+		strcpy(name,"localhost");
+	name[sizeof(name)-1] = 0;
+
+	size_t len = strlen(name);
+
+	if ((*bufferlength) < len)
+	{
+		*bufferlength = len; // 告诉应用程序所需的缓冲区大小
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	memcpy(buffer,name,len);
+	*bufferlength = len;
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPBundleTransmitter::ComesFromThisTransmitter(const RTPEndpoint *addr)
+{
+	if (!m_init)
+		return false;
+
+	if (addr == 0)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v = false;
+
+	// 同一个传输上的所有会话共享地址
+	if (m_created && addr->GetType() == RTPEndpoint::IPv4)
+		v = transport->IsLocalAddress(addr->GetIPv4(),addr->GetRtpPort());
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+int RTPBundleTransmitter::Poll()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 分配给此会话的数据包已经在接收队列中，不读取套接字时无需任何操作
+	int status = 0;
+
+	if (polltransport)
+		status = transport->Poll();
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPBundleTransmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavailable)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 其他会话的 Poll 可能已经把数据包分配到接收队列中
+	bool pending;
+	{
+		std::lock_guard<std::mutex> guard(transport->mutex);
+		pending = !m_rawpacketlist.empty();
+	}
+	if (pending)
+	{
+		if (dataavailable != 0)
+			*dataavailable = true;
+		MAINMUTEX_UNLOCK
+		return 0;
+	}
+
+	// 不读取共享传输时，只有分配给此会话的数据包才能唤醒等待
+	std::vector<int> socks;
+
+	if (polltransport)
+		socks = transport->GetSockets();
+	else
+		socks.push_back(ready.GetDescriptor());
+	socks.push_back(m_pAbortDesc->GetAbortSocket());
+
+	std::vector<int8_t> readflags(socks.size(),0);
+
+	m_waitingForData = true;
+
+	WAITMUTEX_LOCK
+	MAINMUTEX_UNLOCK
+
+	int status = RTPSelect(&socks[0],&readflags[0],socks.size(),delay);
+	if (status < 0)
+	{
+		MAINMUTEX_LOCK
+		m_waitingForData = false;
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_UNLOCK
+		return status;
+	}
+
+	MAINMUTEX_LOCK
+	m_waitingForData = false;
+	if (!m_created) // 调用了销毁
+	{
+		MAINMUTEX_UNLOCK;
+		WAITMUTEX_UNLOCK
+		return 0;
+	}
+
+	// 如果中止，则从中止缓冲区读取
+	if (readflags.back())
+		m_pAbortDesc->ReadSignallingByte();
+
+	if (dataavailable != 0)
+	{
+		bool avail = false;
+
+		for (size_t i = 0 ; i+1 < readflags.size() ; i++)
+		{
+			if (readflags[i])
+				avail = true;
+		}
+		*dataavailable = avail;
+	}
+
+	MAINMUTEX_UNLOCK
+	WAITMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPBundleTransmitter::AbortWait()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (!m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	m_pAbortDesc->SendAbortSignal();
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPBundleTransmitter::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 共享的套接字，读取时数据包也会分配给其他会话；
+	// 由应用程序读取共享传输时，改为等待数据包分配给此会话
+	if (polltransport)
+	{
+		for (auto sock : transport->GetSockets())
+			descriptors.push_back(sock);
+	}
+	else
+		descriptors.push_back(ready.GetDescriptor());
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPBundleTransmitter::GetAbortDescriptor(int *descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	*descriptor = m_pAbortDesc->GetAbortSocket();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPBundleTransmitter::PollDescriptor(int descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	if (descriptor == m_pAbortDesc->GetAbortSocket())
+	{
+		m_pAbortDesc->ReadSignallingByte();
+		status = 0;
+	}
+	else if (descriptor == ready.GetDescriptor())
+		status = 0; // 数据包已经在接收队列中，取空队列时清除信号
+	else if (polltransport)
+		status = transport->PollSocket(descriptor);
+	else
+		status = MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPBundleTransmitter::SendRTPData(const void *data,size_t len)
+{
+	return SendData(data,len,0,0,true);
+}
+
+int RTPBundleTransmitter::SendRTCPData(const void *data,size_t len)
+{
+	return SendData(data,len,0,0,false);
+}
+
+int RTPBundleTransmitter::SendRTPDataV(const void *header,size_t headerlen,const void *payload,size_t payloadlen)
+{
+	return SendData(header,headerlen,payload,payloadlen,true);
+}
+
+int RTPBundleTransmitter::AddDestination(const RTPEndpoint &addr)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (addr.GetType() != RTPEndpoint::IPv4)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	auto result = destinations.insert(addr);
+	int status = result.second ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
+
+	if (result.second)
+		transport->AddAddress(this,addr);
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPBundleTransmitter::DeleteDestination(const RTPEndpoint &addr)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (addr.GetType() != RTPEndpoint::IPv4)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	size_t erased = destinations.erase(addr);
+	int status = erased > 0 ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
+
+	if (erased > 0)
+		transport->DeleteAddress(this,addr);
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+void RTPBundleTransmitter::ClearDestinations()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (m_created)
+	{
+		for (const auto &dest : destinations)
+			transport->DeleteAddress(this,dest);
+		destinations.clear();
+	}
+	MAINMUTEX_UNLOCK
+}
+
+bool RTPBundleTransmitter::SupportsMulticasting()
+{
+	return false;
+}
+
+int RTPBundleTransmitter::JoinMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPBundleTransmitter::LeaveMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPBundleTransmitter::LeaveAllMulticastGroups()
+{
+}
+
+int RTPBundleTransmitter::SetReceiveMode(RTPTransmitter::ReceiveMode m)
+{
+	if (m != RTPTransmitter::AcceptAll)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	return 0;
+}
+
+int RTPBundleTransmitter::AddToIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPBundleTransmitter::DeleteFromIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPBundleTransmitter::ClearIgnoreList()
+{
+}
+
+int RTPBundleTransmitter::AddToAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPBundleTransmitter::DeleteFromAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPBundleTransmitter::ClearAcceptList()
+{
+}
+
+int RTPBundleTransmitter::SetMaximumPacketSize(size_t s)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (s > RTPBUNDLETRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	m_maxPackSize = s;
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPBundleTransmitter::NewDataAvailable()
+{
+	if (!m_init)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v = false;
+
+	if (m_created)
+	{
+		std::lock_guard<std::mutex> guard(transport->mutex);
+		v = !m_rawpacketlist.empty();
+	}
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+RTPRawPacket *RTPBundleTransmitter::GetNextPacket()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+
+	RTPRawPacket *p = 0;
+
+	if (m_created)
+	{
+		std::lock_guard<std::mutex> guard(transport->mutex);
+
+		if (!m_rawpacketlist.empty())
+		{
+			p = m_rawpacketlist.front();
+			m_rawpacketlist.pop_front();
+			if (m_rawpacketlist.empty())
+				ready.Clear();
+		}
+	}
+
+	MAINMUTEX_UNLOCK
+	return p;
+}
+
+int RTPBundleTransmitter::AddRemoteSSRC(uint32_t ssrc)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	transport->AddRemoteSSRC(this,ssrc);
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPBundleTransmitter::DeleteRemoteSSRC(uint32_t ssrc)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	transport->DeleteRemoteSSRC(this,ssrc);
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+uint64_t RTPBundleTransmitter::GetDroppedPackets()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	uint64_t v = dropped;
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+// 私有函数从这里开始...
+
+int RTPBundleTransmitter::SendData(const void *header,size_t headerlen,const void *payload,size_t payloadlen,bool rtp)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (headerlen+payloadlen > m_maxPackSize)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	// 从发出的数据包中学习会话自己的SSRC，用于分配指向它的报告块和反馈消息。
+	// 媒体、RTX和FEC数据包使用不同的SSRC，都要保留，否则发给媒体SSRC的反馈在下一个
+	// 媒体包之前无法分配；学到之后不需要再获取传输的锁。SSRC总是在第一部分中
+	size_t ssrcoffset = (rtp) ? 8 : 4;
+
+	if (headerlen >= ssrcoffset+4)
+	{
+		uint32_t ssrc = RTPBundleReadSSRC((const uint8_t *)header+ssrcoffset);
+
+		if (std::find(localssrcs.begin(),localssrcs.end(),ssrc) == localssrcs.end())
+		{
+			if (localssrcs.size() >= RTP_BUNDLE_MAXLOCALSSRCS)
+			{
+				transport->DeleteLocalSSRC(this,localssrcs.front());
+				localssrcs.erase(localssrcs.begin());
+			}
+			transport->AddLocalSSRC(this,ssrc);
+			localssrcs.push_back(ssrc);
+		}
+	}
+
+	struct iovec iov[2];
+	struct msghdr msg;
+
+	iov[0].iov_base = const_cast<void *>(header);
+	iov[0].iov_len = headerlen;
+	iov[1].iov_base = const_cast<void *>(payload);
+	iov[1].iov_len = payloadlen;
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = (payloadlen > 0) ? 2 : 1;
+
+	for (const auto &dest : destinations)
+	{
+		// RTCP和RTP复用，对端只在RTP端口上接收，入站路由也只按RTP端口查找
+		msg.msg_name = const_cast<struct sockaddr *>(dest.GetRtpSockAddr());
+		msg.msg_namelen = dest.GetSockAddrLen();
+
+		// 和UDP一样，发送缓冲区已满或对端不可达时丢弃这个目的地的数据包并计数
+		ssize_t status;
+
+		while ((status = sendmsg(sendsock,&msg,0)) < 0 && errno == EINTR)
+			;
+		if (status < 0)
+			dropped++;
+	}
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+void RTPBundleTransmitter::FlushPackets()
+{
+	std::list<RTPRawPacket*>::const_iterator it;
+
+	for (it = m_rawpacketlist.begin() ; it != m_rawpacketlist.end() ; ++it)
+		delete *it;
+	m_rawpacketlist.clear();
+	ready.Clear();
+}
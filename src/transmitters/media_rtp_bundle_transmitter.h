@@ -0,0 +1,270 @@
+/**
+ * \file media_rtp_bundle_transmitter.h
+ */
+
+#ifndef RTPBUNDLETRANSMITTER_H
+
+#define RTPBUNDLETRANSMITTER_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_transmitter.h"
+#include "media_rtp_abort_descriptors.h"
+#include "media_rtp_event_descriptor.h"
+#include "media_rtp_endpoint.h"
+#include "media_rtp_utils.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class RTPBundleTransmitter;
+class RTPPacketBuffer;
+class RTPPacketBufferPool;
+
+/** 由多个会话共享的UDP over IPv4传输，类似于WebRTC的BUNDLE：所有会话通过同一个端口收发
+ *  RTP和复用的RTCP数据包，而不是每个会话使用自己的一对套接字。传输拥有一个套接字，或者
+ *  一组用 SO_REUSEPORT 绑定到同一端口的套接字，由内核按对端地址把数据包分配给各个套接字。
+ *  会话通过 RTPBundleTransmitter 连接到传输，参数中用 RTPBundleTransmissionParams::SetTransport 指定。
+ *
+ *  传入的RTP数据包按SSRC分配给会话：首先查找用 RTPBundleTransmitter::AddRemoteSSRC 登记的
+ *  对端SSRC；未登记的SSRC如果来自恰好一个会话的目的地址，就把这个SSRC记给这个会话。
+ *  RTCP复合数据包被拆分为单独的RTCP数据包，每个数据包依次按发送者的SSRC、报告块或反馈消息中
+ *  指向的会话自己的SSRC（从会话发出的数据包中学到）和源地址分配，分给同一个会话的数据包
+ *  按原来的顺序重新组成一个复合数据包；不以SR或RR开头的部分前面加上一个发送者的空RR。
+ *  无法分配的数据包被丢弃并计数。分配给会话的数据包存放在传输的池分配的引用计数缓冲区中。
+ *
+ *  传输必须比所有连接到它的传输器存在得更久。大量会话时应用程序可以不使用轮询线程，
+ *  而是在自己的事件循环中等待 GetSockets 返回的套接字，调用 Poll 分配数据包，
+ *  再轮询收到了数据的会话。
+ */
+class RTPBundleTransport
+{
+	MEDIA_RTP_NO_COPY(RTPBundleTransport)
+public:
+	RTPBundleTransport();
+	~RTPBundleTransport();
+
+	/** 创建 \c numsockets 个绑定到 \c bindip 和 \c port （主机字节序）的套接字，端口为零时由内核分配。
+	 *  大于 \c maxpacksize 的传入数据包被丢弃。 */
+	int Create(uint32_t bindip,uint16_t port,size_t numsockets = 1,size_t maxpacksize = RTP_BUNDLE_DEFAULTPACKSIZE);
+
+	/** 关闭所有套接字；必须先销毁所有连接的传输器。 */
+	void Destroy();
+
+	/** 返回传输绑定的端口。 */
+	uint16_t GetPort() const								{ return port; }
+
+	/** 返回传输绑定的IPv4地址。 */
+	uint32_t GetBindIP() const								{ return bindip; }
+
+	/** 返回传输的套接字，它们在传输销毁之前不会改变。 */
+	const std::vector<int> &GetSockets() const						{ return sockets; }
+
+	/** 读取所有套接字上的数据包并分配给连接的传输器。如果 \c ready 非空，
+	 *  每个接收队列从空变为非空的传输器被追加到其中。 */
+	int Poll(std::vector<RTPBundleTransmitter *> *ready = 0);
+
+	/** 和 Poll 一样，但只读取套接字 \c sock，用于外部事件循环。 */
+	int PollSocket(int sock,std::vector<RTPBundleTransmitter *> *ready = 0);
+
+	/** 返回因无法分配给任何会话而丢弃的数据包数量。 */
+	uint64_t GetUnroutablePackets();
+private:
+	friend class RTPBundleTransmitter;
+
+	int Attach(int *sendsock);
+	void Detach(RTPBundleTransmitter *trans);
+	void AddAddress(RTPBundleTransmitter *trans,const RTPEndpoint &addr);
+	void DeleteAddress(RTPBundleTransmitter *trans,const RTPEndpoint &addr);
+	void AddRemoteSSRC(RTPBundleTransmitter *trans,uint32_t ssrc);
+	void DeleteRemoteSSRC(RTPBundleTransmitter *trans,uint32_t ssrc);
+	void AddLocalSSRC(RTPBundleTransmitter *trans,uint32_t ssrc);
+	void DeleteLocalSSRC(RTPBundleTransmitter *trans,uint32_t ssrc);
+	bool IsLocalAddress(uint32_t ip,uint16_t port) const;
+
+	int ReadSocket(int sock,std::vector<RTPBundleTransmitter *> *ready);
+	void DispatchRTP(uint8_t *data,size_t len,uint32_t ip,uint16_t port,const RTPTime &t,std::vector<RTPBundleTransmitter *> *ready);
+	void DispatchRTCP(const uint8_t *data,size_t len,uint32_t ip,uint16_t port,const RTPTime &t,std::vector<RTPBundleTransmitter *> *ready);
+	RTPBundleTransmitter *RouteAddress(uint32_t ip,uint16_t port);
+	RTPBundleTransmitter *RouteRTCP(const uint8_t *packet,size_t len,uint32_t ip,uint16_t port);
+	void Deliver(RTPBundleTransmitter *trans,RTPPacketBuffer *buf,size_t len,uint32_t ip,uint16_t port,const RTPTime &t,bool rtp,std::vector<RTPBundleTransmitter *> *ready);
+
+	static uint64_t AddressKey(uint32_t ip,uint16_t port)					{ return ((uint64_t)ip << 16)|(uint64_t)port; }
+
+	std::vector<int> sockets;
+	uint32_t bindip;
+	uint16_t port;
+	std::vector<uint32_t> localips; // 绑定到任意地址时本机的地址
+	size_t maxpacksize;
+	RTPPacketBufferPool *bufferpool;
+
+	std::mutex mutex; // 保护路由表和所有连接的传输器的接收队列
+	size_t nextsendsock;
+	std::unordered_map<uint32_t, RTPBundleTransmitter *> remotessrcs, localssrcs;
+	std::unordered_map<uint64_t, std::vector<RTPBundleTransmitter *> > addresses;
+	uint64_t unroutable;
+
+	// 每次 recvmmsg 使用的缓冲区和消息头
+	std::vector<uint8_t> recvbuffer;
+	std::vector<struct mmsghdr> recvmsgs;
+	std::vector<struct iovec> recviovecs;
+	std::vector<struct sockaddr_in> recvaddrs;
+};
+
+/** 共享传输器的参数。 */
+class RTPBundleTransmissionParams : public RTPTransmissionParams
+{
+public:
+	RTPBundleTransmissionParams();
+
+	/** 设置传输器连接的共享传输，必须指定。 */
+	void SetTransport(RTPBundleTransport *t)						{ transport = t; }
+
+	/** 登记一个应分配给此会话的对端SSRC，创建之后可以用 RTPBundleTransmitter::AddRemoteSSRC 登记。 */
+	void AddRemoteSSRC(uint32_t ssrc)							{ remotessrcs.push_back(ssrc); }
+
+	/** 设置传输器的 Poll 是否读取共享传输的套接字（默认为 \c true）。
+	 *  由应用程序调用 RTPBundleTransport::Poll 时应设置为 \c false，会话的 Poll 只取出已分配的数据包，
+	 *  GetReceiveDescriptors 给出的是在数据包分配给此会话时变为可读的描述符，而不是共享的套接字。 */
+	void SetPollTransport(bool f)								{ polltransport = f; }
+
+	/** 如果非空，将使用指定的中止描述符来取消等待数据包到达的函数；
+	 *  设置为null（默认值）让传输器创建自己的实例。 */
+	void SetCreatedAbortDescriptors(RTPAbortDescriptors *desc)				{ m_pAbortDesc = desc; }
+
+	RTPBundleTransport *GetTransport() const						{ return transport; }
+	const std::vector<uint32_t> &GetRemoteSSRCs() const					{ return remotessrcs; }
+	bool GetPollTransport() const								{ return polltransport; }
+	RTPAbortDescriptors *GetCreatedAbortDescriptors() const					{ return m_pAbortDesc; }
+private:
+	RTPBundleTransport *transport;
+	std::vector<uint32_t> remotessrcs;
+	bool polltransport;
+	RTPAbortDescriptors *m_pAbortDesc;
+};
+
+inline RTPBundleTransmissionParams::RTPBundleTransmissionParams() : RTPTransmissionParams(RTPTransmitter::BundleProto)
+{
+	transport = 0;
+	polltransport = true;
+	m_pAbortDesc = 0;
+}
+
+/** 共享传输器的附加信息。 */
+class RTPBundleTransmissionInfo : public RTPTransmissionInfo
+{
+public:
+	RTPBundleTransmissionInfo(RTPBundleTransport *t)
+		: RTPTransmissionInfo(RTPTransmitter::BundleProto), transport(t)			{ }
+
+	/** 返回传输器连接的共享传输。 */
+	RTPBundleTransport *GetTransport() const						{ return transport; }
+private:
+	RTPBundleTransport *transport;
+};
+
+#define RTPBUNDLETRANS_HEADERSIZE							(20+8)
+
+/** 通过 RTPBundleTransport 和其他会话共享一个UDP端口的传输组件。组件的参数由类
+ *  RTPBundleTransmissionParams 描述，具有 RTPEndpoint 参数的函数需要IPv4端点。
+ *  RTCP总是和RTP复用同一个端口，对端应使用对称的端口，即从接收数据包的端口发送；
+ *  目的地址的RTCP端口被忽略，RTCP数据包也发往RTP端口。目的地址同时用于分配来自这个地址的数据包，
+ *  多个会话使用同一个目的地址时需要用 AddRemoteSSRC 登记对端的SSRC。
+ *  读取共享传输时 WaitForIncomingData 在共享的套接字可读时返回，数据包可能属于其他会话；
+ *  不读取时等待数据包分配给此会话。
+ *  不支持多播和接受/忽略列表。
+ */
+class RTPBundleTransmitter : public RTPTransmitter
+{
+	MEDIA_RTP_NO_COPY(RTPBundleTransmitter)
+public:
+	RTPBundleTransmitter();
+	~RTPBundleTransmitter();
+
+	int Init(bool treadsafe);
+	int Create(size_t maxpacksize,const RTPTransmissionParams *transparams);
+	void Destroy();
+	RTPTransmissionInfo *GetTransmissionInfo();
+	void DeleteTransmissionInfo(RTPTransmissionInfo *inf);
+
+	int GetLocalHostName(uint8_t *buffer,size_t *bufferlength);
+	bool ComesFromThisTransmitter(const RTPEndpoint *addr);
+	size_t GetHeaderOverhead()								{ return RTPBUNDLETRANS_HEADERSIZE; }
+
+	int Poll();
+	int WaitForIncomingData(const RTPTime &delay,bool *dataavailable = 0);
+	int AbortWait();
+	int GetReceiveDescriptors(std::vector<int> &descriptors);
+	int GetAbortDescriptor(int *descriptor);
+	int PollDescriptor(int descriptor);
+
+	int SendRTPData(const void *data,size_t len);
+	int SendRTCPData(const void *data,size_t len);
+	int SendRTPDataV(const void *header,size_t headerlen,const void *payload,size_t payloadlen);
+
+	int AddDestination(const RTPEndpoint &addr);
+	int DeleteDestination(const RTPEndpoint &addr);
+	void ClearDestinations();
+
+	bool SupportsMulticasting();
+	int JoinMulticastGroup(const RTPEndpoint &addr);
+	int LeaveMulticastGroup(const RTPEndpoint &addr);
+	void LeaveAllMulticastGroups();
+
+	int SetReceiveMode(RTPTransmitter::ReceiveMode m);
+	int AddToIgnoreList(const RTPEndpoint &addr);
+	int DeleteFromIgnoreList(const RTPEndpoint &addr);
+	void ClearIgnoreList();
+	int AddToAcceptList(const RTPEndpoint &addr);
+	int DeleteFromAcceptList(const RTPEndpoint &addr);
+	void ClearAcceptList();
+	int SetMaximumPacketSize(size_t s);
+
+	bool NewDataAvailable();
+	RTPRawPacket *GetNextPacket();
+
+	/** 把来自SSRC \c ssrc 的数据包分配给此会话，替换之前的分配。 */
+	int AddRemoteSSRC(uint32_t ssrc);
+
+	/** 删除对端SSRC \c ssrc 的分配。 */
+	int DeleteRemoteSSRC(uint32_t ssrc);
+
+	/** 返回因发送失败（例如套接字的发送缓冲区已满）而丢弃的已发送数据包数量，每个目的地址计一次。 */
+	uint64_t GetDroppedPackets();
+private:
+	friend class RTPBundleTransport;
+
+	int SendData(const void *header,size_t headerlen,const void *payload,size_t payloadlen,bool rtp);
+	void FlushPackets();
+
+	bool m_init;
+	bool m_created;
+	bool m_waitingForData;
+
+	RTPBundleTransport *transport;
+	int sendsock;
+	bool polltransport;
+	size_t m_maxPackSize;
+
+	std::unordered_set<RTPEndpoint> destinations;
+	// 从发出的数据包中学到、已向传输登记的会话自己的SSRC：媒体、RTX和FEC流各有一个，
+	// 超过 RTP_BUNDLE_MAXLOCALSSRCS 个时（SSRC冲突之后）去掉最早学到的
+	std::vector<uint32_t> localssrcs;
+	uint64_t dropped;
+
+	std::list<RTPRawPacket *> m_rawpacketlist; // 由传输的锁保护
+	RTPEventDescriptor ready; // 接收队列从空变为非空时发出信号，队列取空时清除
+
+	RTPAbortDescriptors m_abortDesc;
+	RTPAbortDescriptors *m_pAbortDesc; // 如果指定了外部描述符
+
+	std::mutex m_mainMutex, m_waitMutex;
+	bool m_threadsafe;
+};
+
+#endif // RTPBUNDLETRANSMITTER_H
@@ -0,0 +1,728 @@
+#include "media_rtp_io_uring.h"
+#include "media_rtp_errors.h"
+#include "media_rtp_packet_buffer.h"
+#include <errno.h>
+#include <string.h>
+#include <iterator>
+#ifdef RTP_SUPPORT_IO_URING
+	#include <linux/io_uring.h>
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+#endif // RTP_SUPPORT_IO_URING
+
+// user_data 的最低位标记发送请求，注册信息和发送请求的地址都至少按8字节对齐；
+// user_data 为零的完成事件（取消请求）被忽略
+#define RTPIOURING_SENDTAG								1
+#define RTPIOURING_BUFFERGROUP								0
+
+RTPIoUring::RTPIoUring()
+{
+	ringfd = -1;
+	sqring = 0;
+	cqring = 0;
+	sqes = 0;
+	sqringsize = 0;
+	cqringsize = 0;
+	sqessize = 0;
+	sqhead = 0;
+	sqtail = 0;
+	sqmask = 0;
+	sqarray = 0;
+	cqhead = 0;
+	cqtail = 0;
+	cqmask = 0;
+	cqes = 0;
+	sqentries = 0;
+	pendingsqes = 0;
+	bufring = 0;
+	bufringsize = 0;
+	buffers = 0;
+	numbuffers = 0;
+	buffersize = 0;
+	buftail = 0;
+	bufferpool = 0;
+	dropped = 0;
+	senderrors = 0;
+	armfailures = 0;
+}
+
+RTPIoUring::~RTPIoUring()
+{
+	Destroy();
+}
+
+#ifdef RTP_SUPPORT_IO_URING
+
+int RTPIoUring::Init(unsigned int entries,unsigned int nbuffers,size_t bufsize)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (ringfd >= 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (entries == 0 || nbuffers == 0 || nbuffers > 32768)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	if (bufsize <= sizeof(struct io_uring_recvmsg_out)+sizeof(struct sockaddr_storage) || bufsize > 0xffffffff)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	// 完成线程等待环的描述符和这个停止信号
+	int status;
+
+	if ((status = stopdesc.Init()) < 0)
+		return status;
+
+	numbuffers = 1;
+	while (numbuffers < nbuffers)
+		numbuffers <<= 1;
+	buffersize = bufsize;
+
+	// 一个多次触发的接收请求会产生很多完成事件，完成队列按缓冲区数量来定大小
+	struct io_uring_params params;
+
+	memset(&params,0,sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = (numbuffers > entries) ? numbuffers*2 : entries*2;
+
+	int fd = (int)syscall(__NR_io_uring_setup,entries,&params);
+	if (fd < 0)
+	{
+		stopdesc.Destroy();
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	}
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP))
+	{
+		close(fd);
+		stopdesc.Destroy();
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	}
+
+	// 提交队列和完成队列共用一次映射
+	sqringsize = params.sq_off.array+params.sq_entries*sizeof(unsigned int);
+	cqringsize = params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe);
+	if (cqringsize > sqringsize)
+		sqringsize = cqringsize;
+	cqringsize = sqringsize;
+	sqessize = params.sq_entries*sizeof(struct io_uring_sqe);
+
+	sqring = mmap(0,sqringsize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+	if (sqring == MAP_FAILED)
+	{
+		sqring = 0;
+		close(fd);
+		stopdesc.Destroy();
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	cqring = sqring;
+	sqes = mmap(0,sqessize,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+	{
+		munmap(sqring,sqringsize);
+		sqring = 0;
+		cqring = 0;
+		sqes = 0;
+		close(fd);
+		stopdesc.Destroy();
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	uint8_t *sqbase = (uint8_t *)sqring;
+	uint8_t *cqbase = (uint8_t *)cqring;
+
+	sqhead = (unsigned int *)(sqbase+params.sq_off.head);
+	sqtail = (unsigned int *)(sqbase+params.sq_off.tail);
+	sqmask = (unsigned int *)(sqbase+params.sq_off.ring_mask);
+	sqarray = (unsigned int *)(sqbase+params.sq_off.array);
+	cqhead = (unsigned int *)(cqbase+params.cq_off.head);
+	cqtail = (unsigned int *)(cqbase+params.cq_off.tail);
+	cqmask = (unsigned int *)(cqbase+params.cq_off.ring_mask);
+	cqes = cqbase+params.cq_off.cqes;
+	sqentries = params.sq_entries;
+	pendingsqes = 0;
+
+	// 提供给内核选择的接收缓冲区（需要5.19以上的内核）
+	long pagesize = sysconf(_SC_PAGESIZE);
+
+	bufringsize = numbuffers*sizeof(struct io_uring_buf);
+	bufringsize = ((bufringsize+pagesize-1)/pagesize)*pagesize;
+	bufring = mmap(0,bufringsize,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	if (bufring == MAP_FAILED)
+	{
+		bufring = 0;
+		munmap(sqes,sqessize);
+		munmap(sqring,sqringsize);
+		sqring = 0;
+		cqring = 0;
+		sqes = 0;
+		close(fd);
+		stopdesc.Destroy();
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	buffers = new uint8_t[numbuffers*buffersize];
+
+	struct io_uring_buf_reg reg;
+
+	memset(&reg,0,sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)bufring;
+	reg.ring_entries = numbuffers;
+	reg.bgid = RTPIOURING_BUFFERGROUP;
+	if (syscall(__NR_io_uring_register,fd,IORING_REGISTER_PBUF_RING,&reg,1) < 0)
+	{
+		delete [] buffers;
+		buffers = 0;
+		munmap(bufring,bufringsize);
+		bufring = 0;
+		munmap(sqes,sqessize);
+		munmap(sqring,sqringsize);
+		sqring = 0;
+		cqring = 0;
+		sqes = 0;
+		close(fd);
+		stopdesc.Destroy();
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	}
+
+	ringfd = fd;
+	buftail = 0;
+	for (unsigned int i = 0 ; i < numbuffers ; i++)
+		RecycleBuffer((uint16_t)i);
+	dropped = 0;
+	senderrors = 0;
+	armfailures = 0;
+	bufferpool = RTPPacketBufferPool::Create(buffersize); // 由共享这个实例的所有会话使用
+	completionthread = std::thread(&RTPIoUring::CompletionThread,this);
+	return 0;
+}
+
+void RTPIoUring::Destroy()
+{
+	// 完成线程会获取互斥锁，先在不持有锁时让它结束
+	if (completionthread.joinable())
+	{
+		stopdesc.SendAbortSignal();
+		completionthread.join();
+		stopdesc.Destroy();
+	}
+
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (ringfd < 0)
+		return;
+
+	// 先取消所有多次触发的接收请求，并等待它们和未完成的发送请求结束，
+	// 之后内核不再写入接收缓冲区，也不再读取发送数据
+	bool cancelled = true;
+
+	for (std::map<int, Registration *>::iterator it = sockets.begin() ; it != sockets.end() ; ++it)
+	{
+		it->second->removed = true;
+		if (it->second->armed && !CancelReceive(it->second))
+			cancelled = false;
+	}
+	for (size_t i = 0 ; i < detached.size() ; i++)
+	{
+		if (detached[i]->armed && !CancelReceive(detached[i]))
+			cancelled = false;
+	}
+	while (cancelled && HasOutstandingRequests())
+	{
+		if (Enter(1) < 0)
+			break;
+		ProcessCompletions();
+	}
+
+	struct io_uring_buf_reg reg;
+
+	// 还没有结束的请求在关闭环时被取消
+	memset(&reg,0,sizeof(reg));
+	reg.bgid = RTPIOURING_BUFFERGROUP;
+	syscall(__NR_io_uring_register,ringfd,IORING_UNREGISTER_PBUF_RING,&reg,1);
+	close(ringfd);
+	ringfd = -1;
+
+	for (std::map<int, Registration *>::iterator it = sockets.begin() ; it != sockets.end() ; ++it)
+	{
+		ClearQueue(it->second);
+		delete it->second;
+	}
+	sockets.clear();
+	for (size_t i = 0 ; i < detached.size() ; i++)
+	{
+		ClearQueue(detached[i]);
+		delete detached[i];
+	}
+	detached.clear();
+	bufferpool->Release(); // 接收者仍持有的缓冲区释放之后池才被删除
+	bufferpool = 0;
+	for (size_t i = 0 ; i < sendrequests.size() ; i++)
+	{
+		delete [] sendrequests[i]->data;
+		delete sendrequests[i];
+	}
+	sendrequests.clear();
+	freesends.clear();
+
+	munmap(sqes,sqessize);
+	munmap(sqring,sqringsize);
+	munmap(bufring,bufringsize);
+	delete [] buffers;
+	sqring = 0;
+	cqring = 0;
+	sqes = 0;
+	bufring = 0;
+	buffers = 0;
+}
+
+int RTPIoUring::AddSocket(int sock,socklen_t addrlen,int *readydescriptor)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	int status;
+
+	if (ringfd < 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (addrlen > sizeof(struct sockaddr_storage) || sockets.find(sock) != sockets.end())
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	Registration *reg = new Registration();
+
+	if ((status = reg->ready.Init()) < 0)
+	{
+		delete reg;
+		return status;
+	}
+	reg->sock = sock;
+	memset(&reg->msg,0,sizeof(struct msghdr));
+	reg->msg.msg_namelen = addrlen; // 数据在缓冲区中位于地址之后
+	reg->armed = false;
+	reg->removed = false;
+
+	if ((status = ArmReceive(reg)) < 0 || (status = Enter(0)) < 0)
+	{
+		if (reg->armed)
+			detached.push_back(reg);
+		else
+			delete reg;
+		return status;
+	}
+	sockets[sock] = reg;
+	*readydescriptor = reg->ready.GetDescriptor();
+	return 0;
+}
+
+void RTPIoUring::RemoveSocket(int sock)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (ringfd < 0)
+		return;
+
+	std::map<int, Registration *>::iterator it = sockets.find(sock);
+	if (it == sockets.end())
+		return;
+
+	Registration *reg = it->second;
+
+	sockets.erase(it);
+	reg->removed = true;
+	if (reg->armed && CancelReceive(reg))
+	{
+		// 等待接收请求的最后一个完成事件，之后内核不再引用这个套接字
+		while (reg->armed)
+		{
+			if (Enter(1) < 0)
+				break;
+			ProcessCompletions();
+		}
+	}
+	ClearQueue(reg);
+	if (reg->armed)
+		detached.push_back(reg);
+	else
+		delete reg;
+}
+
+int RTPIoUring::CollectDatagrams(int sock,std::list<Datagram> &datagrams,size_t maxcount)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (ringfd < 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	std::map<int, Registration *>::iterator it = sockets.find(sock);
+	if (it == sockets.end())
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	Registration *reg = it->second;
+	int status = 0;
+
+	ProcessCompletions();
+
+	// 持有锁时清除信号，之后排队的数据报会重新发出信号
+	reg->ready.Clear();
+	if (reg->queue.size() <= maxcount)
+		datagrams.splice(datagrams.end(),reg->queue);
+	else
+	{
+		std::list<Datagram>::iterator last = reg->queue.begin();
+
+		std::advance(last,maxcount);
+		datagrams.splice(datagrams.end(),reg->queue,reg->queue.begin(),last);
+		reg->ready.Signal();
+	}
+
+	// 完成事件处理中没能重新发出的接收请求在这里重试，仍然失败时报告给调用者
+	if (!reg->armed)
+	{
+		if ((status = ArmReceive(reg)) < 0 || (status = Enter(0)) < 0)
+			armfailures++;
+	}
+	return status;
+}
+
+int RTPIoUring::QueueSend(int sock,const void *data,size_t len,const struct sockaddr *addr,socklen_t addrlen)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if (ringfd < 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (addrlen > sizeof(struct sockaddr_storage))
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	struct io_uring_sqe *sqe = (struct io_uring_sqe *)GetSQE();
+	if (sqe == 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+
+	SendRequest *req;
+
+	if (!freesends.empty())
+	{
+		req = freesends.back();
+		freesends.pop_back();
+	}
+	else
+	{
+		req = new SendRequest();
+		req->data = 0;
+		req->capacity = 0;
+		sendrequests.push_back(req);
+	}
+
+	// 请求完成之前数据必须保持有效，所以复制一份
+	if (req->capacity < len)
+	{
+		delete [] req->data;
+		req->data = new uint8_t[len];
+		req->capacity = len;
+	}
+	memcpy(req->data,data,len);
+	memcpy(&req->address,addr,addrlen);
+	req->iov.iov_base = req->data;
+	req->iov.iov_len = len;
+	memset(&req->msg,0,sizeof(struct msghdr));
+	req->msg.msg_name = &req->address;
+	req->msg.msg_namelen = addrlen;
+	req->msg.msg_iov = &req->iov;
+	req->msg.msg_iovlen = 1;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = sock;
+	sqe->addr = (uint64_t)(uintptr_t)&req->msg;
+	sqe->len = 1;
+	sqe->user_data = (uint64_t)(uintptr_t)req|RTPIOURING_SENDTAG;
+	PushSQE();
+	return 0;
+}
+
+int RTPIoUring::Submit()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	int status;
+
+	if (ringfd < 0)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if ((status = Enter(0)) < 0)
+		return status;
+
+	// 顺便回收已完成的发送请求，避免完成队列积压
+	ProcessCompletions();
+	return 0;
+}
+
+void *RTPIoUring::GetSQE()
+{
+	unsigned int head = __atomic_load_n(sqhead,__ATOMIC_ACQUIRE);
+	unsigned int tail = *sqtail;
+
+	if (tail-head >= sqentries)
+	{
+		// 提交队列已满，先提交已有的请求
+		if (Enter(0) < 0)
+			return 0;
+		head = __atomic_load_n(sqhead,__ATOMIC_ACQUIRE);
+		if (tail-head >= sqentries)
+			return 0;
+	}
+
+	unsigned int index = tail & *sqmask;
+	struct io_uring_sqe *sqe = ((struct io_uring_sqe *)sqes)+index;
+
+	memset(sqe,0,sizeof(struct io_uring_sqe));
+	sqarray[index] = index;
+	return sqe;
+}
+
+void RTPIoUring::PushSQE()
+{
+	__atomic_store_n(sqtail,*sqtail+1,__ATOMIC_RELEASE);
+	pendingsqes++;
+}
+
+int RTPIoUring::Enter(unsigned int mincomplete)
+{
+	if (pendingsqes == 0 && mincomplete == 0)
+		return 0;
+
+	unsigned int flags = (mincomplete > 0) ? IORING_ENTER_GETEVENTS : 0;
+
+	while (true)
+	{
+		long status = syscall(__NR_io_uring_enter,ringfd,pendingsqes,mincomplete,flags,(void *)0,(size_t)0);
+
+		if (status < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+		pendingsqes -= (unsigned int)status;
+		return 0;
+	}
+}
+
+int RTPIoUring::ArmReceive(Registration *reg)
+{
+	struct io_uring_sqe *sqe = (struct io_uring_sqe *)GetSQE();
+
+	if (sqe == 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = reg->sock;
+	sqe->addr = (uint64_t)(uintptr_t)&reg->msg;
+	sqe->len = 1;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = RTPIOURING_BUFFERGROUP;
+	sqe->user_data = (uint64_t)(uintptr_t)reg;
+	PushSQE();
+	reg->armed = true;
+	return 0;
+}
+
+bool RTPIoUring::CancelReceive(Registration *reg)
+{
+	struct io_uring_sqe *sqe = (struct io_uring_sqe *)GetSQE();
+
+	if (sqe == 0)
+		return false;
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = (uint64_t)(uintptr_t)reg;
+	PushSQE();
+	return true;
+}
+
+bool RTPIoUring::HasOutstandingRequests() const
+{
+	if (freesends.size() < sendrequests.size())
+		return true;
+	for (std::map<int, Registration *>::const_iterator it = sockets.begin() ; it != sockets.end() ; ++it)
+	{
+		if (it->second->armed)
+			return true;
+	}
+	for (size_t i = 0 ; i < detached.size() ; i++)
+	{
+		if (detached[i]->armed)
+			return true;
+	}
+	return false;
+}
+
+void RTPIoUring::ProcessCompletions()
+{
+	unsigned int head = *cqhead;
+	unsigned int tail = __atomic_load_n(cqtail,__ATOMIC_ACQUIRE);
+
+	if (head == tail)
+		return;
+
+	RTPTime curtime = RTPTime::CurrentTime(); // 这一批数据报共用一次时钟读取
+
+	while (head != tail)
+	{
+		struct io_uring_cqe *cqe = ((struct io_uring_cqe *)cqes)+(head & *cqmask);
+		uint64_t userdata = cqe->user_data;
+		int32_t res = cqe->res;
+		uint32_t flags = cqe->flags;
+
+		head++;
+		if (userdata == 0)
+			continue;
+
+		if (userdata & RTPIOURING_SENDTAG)
+		{
+			SendRequest *req = (SendRequest *)(uintptr_t)(userdata & ~(uint64_t)RTPIOURING_SENDTAG);
+
+			if (res < 0)
+				senderrors++;
+			freesends.push_back(req);
+		}
+		else
+			ProcessReceive((Registration *)(uintptr_t)userdata,res,flags,curtime);
+	}
+	__atomic_store_n(cqhead,head,__ATOMIC_RELEASE);
+
+	// 提交重新发出的接收请求
+	Enter(0);
+}
+
+void RTPIoUring::ProcessReceive(Registration *reg,int32_t res,uint32_t flags,const RTPTime &curtime)
+{
+	if (flags & IORING_CQE_F_BUFFER)
+	{
+		uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+		uint8_t *buf = buffers+(size_t)bid*buffersize;
+		struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buf;
+		size_t offset = sizeof(struct io_uring_recvmsg_out)+reg->msg.msg_namelen+reg->msg.msg_controllen;
+
+		if (res >= 0 && !reg->removed && (size_t)res >= offset && out->payloadlen > 0)
+		{
+			if ((out->flags & MSG_TRUNC) || reg->queue.size() >= RTP_IOURING_MAXQUEUE)
+				dropped++;
+			else
+			{
+				Datagram datagram;
+				size_t namelen = (out->namelen < reg->msg.msg_namelen) ? out->namelen : reg->msg.msg_namelen;
+
+				datagram.length = out->payloadlen;
+				datagram.buffer = bufferpool->Allocate(datagram.length);
+				datagram.data = datagram.buffer->GetData();
+				memcpy(datagram.data,buf+offset,datagram.length);
+				memset(&datagram.address,0,sizeof(struct sockaddr_storage));
+				memcpy(&datagram.address,buf+sizeof(struct io_uring_recvmsg_out),namelen);
+				datagram.receivetime = curtime;
+
+				bool wasempty = reg->queue.empty();
+
+				reg->queue.push_back(datagram);
+				if (wasempty)
+					reg->ready.Signal();
+			}
+		}
+		RecycleBuffer(bid);
+	}
+
+	// 没有 F_MORE 表示接收请求已结束（例如缓冲区用完），未移除的套接字重新发出请求
+	if (!(flags & IORING_CQE_F_MORE))
+	{
+		reg->armed = false;
+		if (!reg->removed && ArmReceive(reg) < 0)
+		{
+			// 提交队列已满：唤醒所有者，由它在 CollectDatagrams 中重试
+			armfailures++;
+			reg->ready.Signal();
+		}
+	}
+}
+
+void RTPIoUring::CompletionThread()
+{
+	int socks[2] = { ringfd, stopdesc.GetAbortSocket() };
+
+	while (true)
+	{
+		int8_t readflags[2] = { 0, 0 };
+
+		if (RTPSelect(socks,readflags,2,RTPTime(-1)) < 0 || readflags[1])
+			break;
+		if (!readflags[0])
+			continue;
+
+		std::lock_guard<std::mutex> guard(mutex);
+
+		ProcessCompletions();
+	}
+}
+
+void RTPIoUring::RecycleBuffer(uint16_t bid)
+{
+	// 不使用 io_uring_buf_ring 的柔性数组成员，它在C++中的偏移与C不同；
+	// 缓冲区描述从环的起始处开始，尾部下标与第一个描述的 resv 字段重叠
+	struct io_uring_buf *bufs = (struct io_uring_buf *)bufring;
+	struct io_uring_buf *buf = &bufs[buftail & (numbuffers-1)];
+
+	buf->addr = (uint64_t)(uintptr_t)(buffers+(size_t)bid*buffersize);
+	buf->len = (uint32_t)buffersize;
+	buf->bid = bid;
+	buftail++;
+	__atomic_store_n(&bufs[0].resv,buftail,__ATOMIC_RELEASE);
+}
+
+#else
+
+int RTPIoUring::Init(unsigned int entries,unsigned int nbuffers,size_t bufsize)
+{
+	MEDIA_RTP_UNUSED(entries);
+	MEDIA_RTP_UNUSED(nbuffers);
+	MEDIA_RTP_UNUSED(bufsize);
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPIoUring::Destroy()
+{
+}
+
+int RTPIoUring::AddSocket(int sock,socklen_t addrlen,int *readydescriptor)
+{
+	MEDIA_RTP_UNUSED(sock);
+	MEDIA_RTP_UNUSED(addrlen);
+	MEDIA_RTP_UNUSED(readydescriptor);
+	return MEDIA_RTP_ERR_INVALID_STATE;
+}
+
+void RTPIoUring::RemoveSocket(int sock)
+{
+	MEDIA_RTP_UNUSED(sock);
+}
+
+int RTPIoUring::CollectDatagrams(int sock,std::list<Datagram> &datagrams,size_t maxcount)
+{
+	MEDIA_RTP_UNUSED(sock);
+	MEDIA_RTP_UNUSED(datagrams);
+	MEDIA_RTP_UNUSED(maxcount);
+	return MEDIA_RTP_ERR_INVALID_STATE;
+}
+
+int RTPIoUring::QueueSend(int sock,const void *data,size_t len,const struct sockaddr *addr,socklen_t addrlen)
+{
+	MEDIA_RTP_UNUSED(sock);
+	MEDIA_RTP_UNUSED(data);
+	MEDIA_RTP_UNUSED(len);
+	MEDIA_RTP_UNUSED(addr);
+	MEDIA_RTP_UNUSED(addrlen);
+	return MEDIA_RTP_ERR_INVALID_STATE;
+}
+
+int RTPIoUring::Submit()
+{
+	return MEDIA_RTP_ERR_INVALID_STATE;
+}
+
+#endif // RTP_SUPPORT_IO_URING
+
+void RTPIoUring::ClearQueue(Registration *reg)
+{
+	for (std::list<Datagram>::iterator it = reg->queue.begin() ; it != reg->queue.end() ; ++it)
+		it->buffer->Release();
+	reg->queue.clear();
+}
@@ -0,0 +1,157 @@
+/**
+ * \file media_rtp_io_uring.h
+ */
+
+#ifndef RTPIOURING_H
+
+#define RTPIOURING_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_utils.h"
+#include "media_rtp_event_descriptor.h"
+#include "media_rtp_abort_descriptors.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RTPPacketBuffer;
+class RTPPacketBufferPool;
+
+/** 可以由多个会话共享的 io_uring 实例，供UDP传输器代替 recvfrom 和 sendto 使用。
+ *  每个注册的套接字上有一个多次触发的 recvmsg 请求，数据报写入内核从一组提供的缓冲区中
+ *  选择的缓冲区，因此接收时不需要为每个数据包进入内核；发送请求先放入提交队列，
+ *  一次 io_uring_enter 提交一批。所有操作都由一个互斥锁保护。实例自己的完成线程等待环的
+ *  描述符，把数据报分发到所属套接字的队列，并通过该套接字的就绪描述符通知其所有者，
+ *  因此每个传输器只需等待自己的就绪描述符，不会因为其他会话的数据报而被唤醒。
+ *  系统不支持 io_uring 时 Init 失败，传输器继续使用普通的套接字调用。
+ */
+class RTPIoUring
+{
+	MEDIA_RTP_NO_COPY(RTPIoUring)
+public:
+	/** 一个收到的数据报，数据存放在实例的池分配的引用计数缓冲区 \c buffer 中，
+	 *  \c data 指向它的数据；接收者持有缓冲区的一个引用，可以把它作为数据包的释放器。
+	 */
+	class Datagram
+	{
+	public:
+		Datagram() : buffer(0), data(0), length(0), receivetime(0)			{ }
+
+		RTPPacketBuffer *buffer;
+		uint8_t *data;
+		size_t length;
+		struct sockaddr_storage address;
+		RTPTime receivetime;
+	};
+
+	/** 构造一个未初始化的实例。 */
+	RTPIoUring();
+	~RTPIoUring();
+
+	/** 创建有 \c entries 个提交队列项的环，并提供 \c numbuffers 个大小为 \c buffersize
+	 *  的接收缓冲区；\c numbuffers 向上取整为2的幂。系统不支持时返回负值。
+	 */
+	int Init(unsigned int entries = RTP_IOURING_DEFAULTENTRIES,unsigned int numbuffers = RTP_IOURING_DEFAULTBUFFERS,
+	         size_t buffersize = RTP_IOURING_DEFAULTBUFFERSIZE);
+
+	/** 销毁环：先取消仍在进行的接收请求并等待未完成的请求结束，再注销缓冲区环并关闭描述符。
+	 *  套接字应该已经用 RemoveSocket 移除；否则之后由调用者关闭它们。
+	 */
+	void Destroy();
+
+	/** 返回指示此实例是否已初始化的标志。 */
+	bool IsInitialized() const								{ return ringfd >= 0; }
+
+	/** 开始在 \c sock 上接收数据报，地址长度最多为 \c addrlen；\c readydescriptor 中存入
+	 *  有数据报排队时变为可读的描述符。
+	 */
+	int AddSocket(int sock,socklen_t addrlen,int *readydescriptor);
+
+	/** 取消 \c sock 上的接收请求并等待它结束，之后可以关闭套接字。未取走的数据报被删除。 */
+	void RemoveSocket(int sock);
+
+	/** 取走所有完成事件，并把 \c sock 上排队的最多 \c maxcount 个数据报追加到 \c datagrams，
+	 *  剩下的数据报保持就绪信号。如果 \c sock 上的接收请求结束后没能重新发出，在这里重试，仍然失败时返回负值。
+	 */
+	int CollectDatagrams(int sock,std::list<Datagram> &datagrams,size_t maxcount);
+
+	/** 把发送 \c data 到 \c addr 的请求放入提交队列，数据会被复制；调用 Submit 后才真正发送。 */
+	int QueueSend(int sock,const void *data,size_t len,const struct sockaddr *addr,socklen_t addrlen);
+
+	/** 一次提交所有排队的发送请求。 */
+	int Submit();
+
+	/** 返回因缓冲区不够大或队列已满而丢弃的数据报数量。 */
+	uint64_t GetDroppedDatagrams() const							{ return dropped.load(); }
+
+	/** 返回完成时报告错误的发送请求数量。 */
+	uint64_t GetSendErrors() const								{ return senderrors.load(); }
+
+	/** 返回因提交队列已满而没能重新发出接收请求的次数。 */
+	uint64_t GetReceiveArmFailures() const							{ return armfailures.load(); }
+private:
+	class Registration
+	{
+	public:
+		int sock;
+		struct msghdr msg;
+		bool armed;
+		bool removed;
+		std::list<Datagram> queue;
+		RTPEventDescriptor ready;
+	};
+
+	class SendRequest
+	{
+	public:
+		struct msghdr msg;
+		struct iovec iov;
+		struct sockaddr_storage address;
+		uint8_t *data;
+		size_t capacity;
+	};
+
+	void *GetSQE();
+	int Enter(unsigned int mincomplete);
+	int ArmReceive(Registration *reg);
+	bool CancelReceive(Registration *reg);
+	bool HasOutstandingRequests() const;
+	void ProcessCompletions();
+	void PushSQE();
+	void ProcessReceive(Registration *reg,int32_t res,uint32_t flags,const RTPTime &curtime);
+	void RecycleBuffer(uint16_t bid);
+	void ClearQueue(Registration *reg);
+	void CompletionThread();
+
+	int ringfd;
+	void *sqring, *cqring, *sqes;
+	size_t sqringsize, cqringsize, sqessize;
+	unsigned int *sqhead, *sqtail, *sqmask, *sqarray;
+	unsigned int *cqhead, *cqtail, *cqmask;
+	void *cqes;
+	unsigned int sqentries, pendingsqes;
+
+	void *bufring;
+	size_t bufringsize;
+	uint8_t *buffers;
+	unsigned int numbuffers;
+	size_t buffersize;
+	uint16_t buftail;
+	RTPPacketBufferPool *bufferpool;
+
+	std::map<int, Registration *> sockets;
+	std::vector<Registration *> detached; // 取消失败的注册信息，内核可能仍在使用
+	std::vector<SendRequest *> sendrequests, freesends;
+	std::atomic<uint64_t> dropped, senderrors, armfailures;
+	std::mutex mutex;
+	std::thread completionthread;
+	RTPAbortDescriptors stopdesc;
+};
+
+#endif // RTPIOURING_H
@@ -0,0 +1,1001 @@
+#include "media_rtp_loopback_transmitter.h"
+#include "media_rtp_event_descriptor.h"
+#include "media_rtp_packet_factory.h"
+#include "media_rtp_packet_buffer.h"
+#include "media_rtp_structs.h"
+#include "media_rtp_errors.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef RTP_HAVE_TIMERFD
+	#include <sys/timerfd.h>
+#endif // RTP_HAVE_TIMERFD
+
+#define RTPLOOPBACKTRANS_MAXPACKSIZE							65535
+
+#define RTPLOOPBACK_CHANNEL_RTP								0
+#define RTPLOOPBACK_CHANNEL_RTCP							1
+#define RTPLOOPBACK_CHANNEL_MUX								2
+
+	#define MAINMUTEX_LOCK 		{ if (m_threadsafe) m_mainMutex.lock(); }
+	#define MAINMUTEX_UNLOCK	{ if (m_threadsafe) m_mainMutex.unlock(); }
+	#define WAITMUTEX_LOCK		{ if (m_threadsafe) m_waitMutex.lock(); }
+	#define WAITMUTEX_UNLOCK	{ if (m_threadsafe) m_waitMutex.unlock(); }
+
+static inline uint64_t RTPLoopbackKey(uint32_t ip,uint16_t port)
+{
+	return (((uint64_t)ip)<<16)|(uint64_t)port;
+}
+
+// 一个接收端的入站队列：发送端用CAS把数据包压入链表头部，接收端一次取走整个链表再反转，
+// 两边都不加锁；因为接收端总是取走整个链表，不存在ABA问题
+class RTPLoopbackNetwork::Port
+{
+public:
+	class Node
+	{
+	public:
+		RTPRawPacket *pack;
+		bool delayed; // 发送端设置了损伤，到达时间可能晚于发送时间
+		Node *next;
+	};
+
+	Port() : inbound(0), queued(0), closed(false)						{ }
+	~Port();
+
+	int Push(RTPRawPacket *pack,bool delayed);
+	Node *TakeAll();
+
+	std::atomic<Node *> inbound;
+	std::atomic<size_t> queued;
+	std::atomic<bool> closed;
+	RTPEventDescriptor ready;
+};
+
+RTPLoopbackNetwork::Port::~Port()
+{
+	Node *node = inbound.exchange(0);
+
+	// 接收端销毁后仍可能有发送端放入数据包
+	while (node != 0)
+	{
+		Node *next = node->next;
+
+		delete node->pack;
+		delete node;
+		node = next;
+	}
+	ready.Destroy();
+}
+
+int RTPLoopbackNetwork::Port::Push(RTPRawPacket *pack,bool delayed)
+{
+	if (closed.load(std::memory_order_acquire))
+	{
+		delete pack;
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (queued.fetch_add(1,std::memory_order_relaxed) >= RTP_LOOPBACK_MAXQUEUE)
+	{
+		queued.fetch_sub(1,std::memory_order_relaxed);
+		delete pack;
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	Node *node = new Node();
+	Node *head = inbound.load(std::memory_order_relaxed);
+
+	node->pack = pack;
+	node->delayed = delayed;
+	do
+	{
+		node->next = head;
+	} while (!inbound.compare_exchange_weak(head,node,std::memory_order_release,std::memory_order_relaxed));
+
+	// 只在队列从空变为非空时发出信号，接收端先清除信号再取走链表
+	if (head == 0)
+		ready.Signal();
+	return 0;
+}
+
+RTPLoopbackNetwork::Port::Node *RTPLoopbackNetwork::Port::TakeAll()
+{
+	Node *node = inbound.exchange(0,std::memory_order_acquire);
+	Node *reversed = 0;
+	size_t count = 0;
+
+	while (node != 0) // 恢复发送顺序
+	{
+		Node *next = node->next;
+
+		node->next = reversed;
+		reversed = node;
+		node = next;
+		count++;
+	}
+	queued.fetch_sub(count,std::memory_order_relaxed);
+	return reversed;
+}
+
+RTPLoopbackNetwork::RTPLoopbackNetwork() : undeliverable(0), overflow(0)
+{
+	nextport = RTPLOOPBACKTRANS_DEFAULTPORTBASE;
+}
+
+RTPLoopbackNetwork::~RTPLoopbackNetwork()
+{
+}
+
+int RTPLoopbackNetwork::Attach(uint32_t ip,uint16_t *rtpport,uint16_t *rtcpport,bool rtcpmux,std::shared_ptr<Port> &port)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	int status;
+
+	if (*rtpport == 0) // 分配一对空闲端口
+	{
+		for (int attempt = 0 ; attempt < 32768 && *rtpport == 0 ; attempt++)
+		{
+			uint16_t candidate = nextport;
+
+			nextport += 2;
+			if (nextport < RTPLOOPBACKTRANS_DEFAULTPORTBASE)
+				nextport = RTPLOOPBACKTRANS_DEFAULTPORTBASE;
+			if (routes.find(RTPLoopbackKey(ip,candidate)) == routes.end() &&
+			    routes.find(RTPLoopbackKey(ip,candidate+1)) == routes.end())
+				*rtpport = candidate;
+		}
+		if (*rtpport == 0)
+			return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	*rtcpport = (rtcpmux) ? *rtpport : *rtpport+1;
+
+	// 和绑定已被占用的端口一样失败
+	if (routes.find(RTPLoopbackKey(ip,*rtpport)) != routes.end() ||
+	    routes.find(RTPLoopbackKey(ip,*rtcpport)) != routes.end())
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+
+	std::shared_ptr<Port> newport = std::make_shared<Port>();
+	Route route;
+
+	if ((status = newport->ready.Init()) < 0)
+		return status;
+
+	route.port = newport;
+	if (rtcpmux)
+	{
+		route.channel = RTPLOOPBACK_CHANNEL_MUX;
+		routes[RTPLoopbackKey(ip,*rtpport)] = route;
+	}
+	else
+	{
+		route.channel = RTPLOOPBACK_CHANNEL_RTP;
+		routes[RTPLoopbackKey(ip,*rtpport)] = route;
+		route.channel = RTPLOOPBACK_CHANNEL_RTCP;
+		routes[RTPLoopbackKey(ip,*rtcpport)] = route;
+	}
+	port = newport;
+	return 0;
+}
+
+void RTPLoopbackNetwork::Detach(uint32_t ip,uint16_t rtpport,uint16_t rtcpport)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+
+	routes.erase(RTPLoopbackKey(ip,rtpport));
+	routes.erase(RTPLoopbackKey(ip,rtcpport));
+}
+
+bool RTPLoopbackNetwork::Find(uint32_t ip,uint16_t port,Route &route)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	auto it = routes.find(RTPLoopbackKey(ip,port));
+
+	if (it == routes.end())
+		return false;
+	route = it->second;
+	return true;
+}
+
+RTPLoopbackTransmitter::RTPLoopbackTransmitter() : RTPTransmitter()
+{
+	m_created = false;
+	m_init = false;
+	bufferpool = 0;
+	m_arrivalTimer = -1;
+}
+
+RTPLoopbackTransmitter::~RTPLoopbackTransmitter()
+{
+	Destroy();
+}
+
+int RTPLoopbackTransmitter::Init(bool tsafe)
+{
+	if (m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	m_threadsafe = tsafe;
+
+	m_maxPackSize = RTPLOOPBACKTRANS_MAXPACKSIZE;
+	m_init = true;
+	return 0;
+}
+
+int RTPLoopbackTransmitter::Create(size_t maximumpacketsize,const RTPTransmissionParams *transparams)
+{
+	const RTPLoopbackTransmissionParams *params;
+	int status;
+
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 获取传输参数，必须指定网络
+
+	if (transparams == 0 || transparams->GetTransmissionProtocol() != RTPTransmitter::LoopbackProto)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+	params = static_cast<const RTPLoopbackTransmissionParams *>(transparams);
+	if (params->GetNetwork() == 0)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+	if (maximumpacketsize > RTPLOOPBACKTRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	if (!params->GetCreatedAbortDescriptors())
+	{
+		if ((status = m_abortDesc.Init()) < 0)
+		{
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+		m_pAbortDesc = &m_abortDesc;
+	}
+	else
+	{
+		m_pAbortDesc = params->GetCreatedAbortDescriptors();
+		if (!m_pAbortDesc->IsInitialized())
+		{
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_INVALID_STATE;
+		}
+	}
+
+#ifdef RTP_HAVE_TIMERFD
+	m_arrivalTimer = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+	if (m_arrivalTimer < 0)
+	{
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+#endif // RTP_HAVE_TIMERFD
+
+	network = params->GetNetwork();
+	bindIP = params->GetBindIP();
+	m_rtpPort = params->GetPortbase();
+	if ((status = network->Attach(bindIP,&m_rtpPort,&m_rtcpPort,params->GetRTCPMultiplexing(),port)) < 0)
+	{
+		if (m_arrivalTimer >= 0)
+		{
+			close(m_arrivalTimer);
+			m_arrivalTimer = -1;
+		}
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
+	impairments = params->GetImpairments();
+	rng.seed(impairments.GetSeed());
+	lost = 0;
+
+	m_maxPackSize = maximumpacketsize;
+	bufferpool = RTPPacketBufferPool::Create(RTP_PACKETBUFFER_DEFAULTSIZE,RTP_PACKETBUFFER_TRANSMITTERMAXFREE);
+	m_waitingForData = false;
+	m_created = true;
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+void RTPLoopbackTransmitter::Destroy()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK;
+		return;
+	}
+
+	// 发送端缓存的队列在关闭后丢弃新的数据包，最后一个引用释放时删除剩余的数据包
+	port->closed.store(true,std::memory_order_release);
+	network->Detach(bindIP,m_rtpPort,m_rtcpPort);
+	port.reset();
+	routecache.clear();
+	destinations.clear();
+	FlushPackets();
+	bufferpool->Release(); // 接收端仍持有的数据包释放之后池才被删除
+	bufferpool = 0;
+	if (m_arrivalTimer >= 0)
+	{
+		close(m_arrivalTimer);
+		m_arrivalTimer = -1;
+	}
+	m_created = false;
+
+	if (m_waitingForData)
+	{
+		m_pAbortDesc->SendAbortSignal();
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_LOCK // 确保 WaitForIncomingData 函数已结束
+		WAITMUTEX_UNLOCK
+	}
+	else
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+
+	MAINMUTEX_UNLOCK
+}
+
+RTPTransmissionInfo *RTPLoopbackTransmitter::GetTransmissionInfo()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	RTPTransmissionInfo *tinf = new RTPLoopbackTransmissionInfo(bindIP,m_rtpPort,m_rtcpPort);
+	MAINMUTEX_UNLOCK
+	return tinf;
+}
+
+void RTPLoopbackTransmitter::DeleteTransmissionInfo(RTPTransmissionInfo *i)
+{
+	if (!m_init)
+		return;
+
+	delete i;
+}
+
+int RTPLoopbackTransmitter::GetLocalHostName(uint8_t *buffer,size_t *bufferlength)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 虚拟网络中没有主机名，使用地址
+	char str[16];
+	size_t len;
+
+	snprintf(str,16,"%d.%d.%d.%d",(int)((bindIP>>24)&0xFF),(int)((bindIP>>16)&0xFF),(int)((bindIP>>8)&0xFF),(int)(bindIP&0xFF));
+	len = strlen(str);
+	if ((*bufferlength) < len)
+	{
+		*bufferlength = len; // 告诉应用程序所需的缓冲区大小
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	memcpy(buffer,str,len);
+	*bufferlength = len;
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPLoopbackTransmitter::ComesFromThisTransmitter(const RTPEndpoint *addr)
+{
+	if (!m_init)
+		return false;
+
+	if (addr == 0)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v = false;
+
+	if (m_created && addr->GetType() == RTPEndpoint::IPv4 && addr->GetIPv4() == bindIP)
+	{
+		if (addr->GetRtpPort() == m_rtpPort || addr->GetRtpPort() == m_rtcpPort)
+			v = true;
+	}
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+int RTPLoopbackTransmitter::Poll()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	CollectPackets();
+	ReleaseArrivedPackets(RTPTime::CurrentTime());
+	ArmArrivalTimer();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPLoopbackTransmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavailable)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 已放入队列但尚未到达的数据包决定最长的等待时间
+	RTPTime timeout = delay;
+
+	CollectPackets();
+	if (!inflight.empty())
+	{
+		RTPTime remaining = RTPTime::FromNanoSeconds(inflight.begin()->first);
+
+		remaining -= RTPTime::CurrentTime();
+		if (remaining < RTPTime(0))
+			remaining = RTPTime(0);
+		if (delay < RTPTime(0) || remaining < delay)
+			timeout = remaining;
+	}
+
+	int socks[2] = { port->ready.GetDescriptor(), m_pAbortDesc->GetAbortSocket() };
+	int8_t readflags[2] = { 0, 0 };
+
+	m_waitingForData = true;
+
+	WAITMUTEX_LOCK
+	MAINMUTEX_UNLOCK
+
+	int status = RTPSelect(socks,readflags,2,timeout);
+	if (status < 0)
+	{
+		MAINMUTEX_LOCK
+		m_waitingForData = false;
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_UNLOCK
+		return status;
+	}
+
+	MAINMUTEX_LOCK
+	m_waitingForData = false;
+	if (!m_created) // 调用了销毁
+	{
+		MAINMUTEX_UNLOCK;
+		WAITMUTEX_UNLOCK
+		return 0;
+	}
+
+	// 如果中止，则从中止缓冲区读取
+	if (readflags[1])
+		m_pAbortDesc->ReadSignallingByte();
+
+	if (dataavailable != 0)
+	{
+		if (readflags[0] || (!inflight.empty() && inflight.begin()->first <= RTPTime::CurrentTime().GetNanoSeconds()))
+			*dataavailable = true;
+		else
+			*dataavailable = false;
+	}
+
+	MAINMUTEX_UNLOCK
+	WAITMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPLoopbackTransmitter::AbortWait()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (!m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	m_pAbortDesc->SendAbortSignal();
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPLoopbackTransmitter::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 队列描述符在数据包放入队列时变为可读，定时器描述符在延迟的数据包到达时变为可读
+	descriptors.push_back(port->ready.GetDescriptor());
+	if (m_arrivalTimer >= 0)
+		descriptors.push_back(m_arrivalTimer);
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPLoopbackTransmitter::GetAbortDescriptor(int *descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	*descriptor = m_pAbortDesc->GetAbortSocket();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPLoopbackTransmitter::PollDescriptor(int descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status = 0;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	if (descriptor == m_pAbortDesc->GetAbortSocket())
+		m_pAbortDesc->ReadSignallingByte();
+	else if (descriptor == port->ready.GetDescriptor() || (m_arrivalTimer >= 0 && descriptor == m_arrivalTimer))
+	{
+		CollectPackets();
+		ReleaseArrivedPackets(RTPTime::CurrentTime());
+		ArmArrivalTimer();
+	}
+	else
+		status = MEDIA_RTP_ERR_INVALID_PARAMETER;
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPLoopbackTransmitter::SendRTPData(const void *data,size_t len)
+{
+	return SendData(data,len,true);
+}
+
+int RTPLoopbackTransmitter::SendRTCPData(const void *data,size_t len)
+{
+	return SendData(data,len,false);
+}
+
+int RTPLoopbackTransmitter::AddDestination(const RTPEndpoint &addr)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (addr.GetType() != RTPEndpoint::IPv4)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	auto result = destinations.insert(addr);
+	int status = result.second ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPLoopbackTransmitter::DeleteDestination(const RTPEndpoint &addr)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (addr.GetType() != RTPEndpoint::IPv4)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	size_t erased = destinations.erase(addr);
+	int status = erased > 0 ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+void RTPLoopbackTransmitter::ClearDestinations()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (m_created)
+		destinations.clear();
+	MAINMUTEX_UNLOCK
+}
+
+bool RTPLoopbackTransmitter::SupportsMulticasting()
+{
+	return false;
+}
+
+int RTPLoopbackTransmitter::JoinMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPLoopbackTransmitter::LeaveMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPLoopbackTransmitter::LeaveAllMulticastGroups()
+{
+}
+
+int RTPLoopbackTransmitter::SetReceiveMode(RTPTransmitter::ReceiveMode m)
+{
+	if (m != RTPTransmitter::AcceptAll)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	return 0;
+}
+
+int RTPLoopbackTransmitter::AddToIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPLoopbackTransmitter::DeleteFromIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPLoopbackTransmitter::ClearIgnoreList()
+{
+}
+
+int RTPLoopbackTransmitter::AddToAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPLoopbackTransmitter::DeleteFromAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPLoopbackTransmitter::ClearAcceptList()
+{
+}
+
+int RTPLoopbackTransmitter::SetMaximumPacketSize(size_t s)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (s > RTPLOOPBACKTRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	m_maxPackSize = s;
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPLoopbackTransmitter::NewDataAvailable()
+{
+	if (!m_init)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v;
+
+	if (!m_created)
+		v = false;
+	else
+		v = !m_rawpacketlist.empty();
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+RTPRawPacket *RTPLoopbackTransmitter::GetNextPacket()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+
+	RTPRawPacket *p;
+
+	if (!m_created || m_rawpacketlist.empty())
+	{
+		MAINMUTEX_UNLOCK
+		return 0;
+	}
+
+	p = m_rawpacketlist.front();
+	m_rawpacketlist.pop_front();
+
+	MAINMUTEX_UNLOCK
+	return p;
+}
+
+uint64_t RTPLoopbackTransmitter::GetLostPackets()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	uint64_t v = lost;
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+// 私有函数从这里开始...
+
+int RTPLoopbackTransmitter::SendData(const void *data,size_t len,bool rtp)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (len > m_maxPackSize)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	std::uniform_real_distribution<double> uniform(0.0,1.0);
+	bool ideal = impairments.IsIdeal();
+	RTPTime sendtime = RTPTime::CurrentTime();
+
+	for (const auto &dest : destinations)
+	{
+		const RTPLoopbackNetwork::Route *route = 0;
+		uint16_t destport = (rtp) ? dest.GetRtpPort() : dest.GetRtcpPort();
+
+		if (!Resolve(dest.GetIPv4(),destport,&route))
+		{
+			network->undeliverable.fetch_add(1,std::memory_order_relaxed);
+			continue;
+		}
+
+		int copies = 1;
+
+		if (!ideal)
+		{
+			if (uniform(rng) < impairments.GetLossRate())
+			{
+				lost++;
+				continue;
+			}
+			if (uniform(rng) < impairments.GetDuplicateRate())
+				copies = 2;
+		}
+
+		// 和UDP传输器一样，复用的端口上按负载类型区分RTP和RTCP
+		bool isrtp = (route->channel == RTPLOOPBACK_CHANNEL_RTP);
+		if (route->channel == RTPLOOPBACK_CHANNEL_MUX)
+		{
+			isrtp = true;
+			if (len > sizeof(RTCPCommonHeader))
+			{
+				uint8_t packettype = ((const RTCPCommonHeader *)data)->packettype;
+
+				if (packettype >= 200 && packettype <= 204)
+					isrtp = false;
+			}
+		}
+
+		for (int i = 0 ; i < copies ; i++)
+		{
+			RTPTime arrivaltime = sendtime;
+
+			if (!ideal)
+			{
+				arrivaltime += impairments.GetDelay();
+				arrivaltime += RTPTime(impairments.GetJitter().GetDouble()*uniform(rng));
+				if (uniform(rng) < impairments.GetReorderRate())
+					arrivaltime += impairments.GetReorderDelay();
+			}
+
+			// 接收端可能就地修改数据，每个副本使用自己的缓冲区
+			RTPPacketBuffer *buf = bufferpool->Allocate(len);
+
+			memcpy(buf->GetData(),data,len);
+
+			RTPEndpoint *source = new RTPEndpoint(bindIP,(rtp) ? m_rtpPort : m_rtcpPort);
+			RTPRawPacket *pack = new RTPRawPacket(buf->GetData(),len,source,arrivaltime,isrtp);
+
+			pack->SetDataReleaser(buf);
+			int status = route->port->Push(pack,!ideal);
+
+			if (status == MEDIA_RTP_ERR_INVALID_STATE)
+				network->undeliverable.fetch_add(1,std::memory_order_relaxed);
+			else if (status < 0)
+				network->overflow.fetch_add(1,std::memory_order_relaxed);
+		}
+	}
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPLoopbackTransmitter::Resolve(uint32_t ip,uint16_t destport,const RTPLoopbackNetwork::Route **route)
+{
+	uint64_t key = RTPLoopbackKey(ip,destport);
+	auto it = routecache.find(key);
+
+	// 缓存的接收端关闭后重新查找，地址可能已被新的传输器使用
+	if (it != routecache.end() && !it->second.port->closed.load(std::memory_order_acquire))
+	{
+		*route = &it->second;
+		return true;
+	}
+
+	RTPLoopbackNetwork::Route found;
+
+	if (!network->Find(ip,destport,found))
+	{
+		if (it != routecache.end())
+			routecache.erase(it);
+		return false;
+	}
+
+	RTPLoopbackNetwork::Route &cached = routecache[key];
+
+	cached = found;
+	*route = &cached;
+	return true;
+}
+
+void RTPLoopbackTransmitter::CollectPackets()
+{
+	// 先清除信号再取走队列：之后放入的数据包会重新发出信号
+	port->ready.Clear();
+
+	RTPLoopbackNetwork::Port::Node *node = port->TakeAll();
+
+	while (node != 0)
+	{
+		RTPLoopbackNetwork::Port::Node *next = node->next;
+
+		// 没有损伤的数据包在发送时就已到达：没有更早的数据包尚未到达时直接交付，
+		// 不经过按到达时间排序的映射
+		if (!node->delayed && inflight.empty())
+			m_rawpacketlist.push_back(node->pack);
+		else // 到达时间相同的数据包保持放入的顺序
+			inflight.insert(std::make_pair(node->pack->GetReceiveTime().GetNanoSeconds(),node->pack));
+		delete node;
+		node = next;
+	}
+}
+
+void RTPLoopbackTransmitter::ReleaseArrivedPackets(const RTPTime &curtime)
+{
+	int64_t now = curtime.GetNanoSeconds();
+
+	while (!inflight.empty() && inflight.begin()->first <= now)
+	{
+		m_rawpacketlist.push_back(inflight.begin()->second);
+		inflight.erase(inflight.begin());
+	}
+}
+
+// 把定时器设为最早的未到达数据包的到达时间，没有这样的数据包时停止定时器；
+// 重新设置定时器同时清除了之前的到期状态
+void RTPLoopbackTransmitter::ArmArrivalTimer()
+{
+#ifdef RTP_HAVE_TIMERFD
+	if (m_arrivalTimer < 0)
+		return;
+
+	struct itimerspec spec;
+
+	memset(&spec,0,sizeof(spec));
+	if (!inflight.empty())
+	{
+		int64_t remaining = inflight.begin()->first - RTPTime::CurrentTime().GetNanoSeconds();
+
+		if (remaining < 1) // 零值会停止定时器
+			remaining = 1;
+		spec.it_value.tv_sec = (time_t)(remaining/1000000000);
+		spec.it_value.tv_nsec = (long)(remaining%1000000000);
+	}
+	timerfd_settime(m_arrivalTimer,0,&spec,0);
+#endif // RTP_HAVE_TIMERFD
+}
+
+void RTPLoopbackTransmitter::FlushPackets()
+{
+	for (auto it = inflight.begin() ; it != inflight.end() ; ++it)
+		delete it->second;
+	inflight.clear();
+
+	std::list<RTPRawPacket*>::const_iterator it;
+
+	for (it = m_rawpacketlist.begin() ; it != m_rawpacketlist.end() ; ++it)
+		delete *it;
+	m_rawpacketlist.clear();
+}
@@ -0,0 +1,295 @@
+/**
+ * \file media_rtp_loopback_transmitter.h
+ */
+
+#ifndef RTPLOOPBACKTRANSMITTER_H
+
+#define RTPLOOPBACKTRANSMITTER_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_transmitter.h"
+#include "media_rtp_abort_descriptors.h"
+#include "media_rtp_endpoint.h"
+#include "media_rtp_utils.h"
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+#define RTPLOOPBACKTRANS_DEFAULTPORTBASE						20000
+
+class RTPPacketBufferPool;
+
+/** 在同一进程内连接回环传输器的虚拟网络，由应用程序创建并通过
+ *  RTPLoopbackTransmissionParams::SetNetwork 传给各个传输器。网络只负责按
+ *  IPv4地址和端口查找接收端，数据包本身通过每个接收端的无锁队列传递，
+ *  发送时不需要加锁。网络必须比所有连接到它的传输器存在得更久。
+ */
+class RTPLoopbackNetwork
+{
+	MEDIA_RTP_NO_COPY(RTPLoopbackNetwork)
+public:
+	RTPLoopbackNetwork();
+	~RTPLoopbackNetwork();
+
+	/** 返回因目的地址上没有传输器而丢弃的数据包数量。 */
+	uint64_t GetUndeliverablePackets() const						{ return undeliverable.load(std::memory_order_relaxed); }
+
+	/** 返回因接收端的队列已满而丢弃的数据包数量。 */
+	uint64_t GetOverflowPackets() const							{ return overflow.load(std::memory_order_relaxed); }
+private:
+	friend class RTPLoopbackTransmitter;
+
+	class Port;
+
+	/** 一个地址上的接收端，\c channel 指示数据包属于RTP、RTCP还是复用的通道。 */
+	class Route
+	{
+	public:
+		Route() : channel(0)								{ }
+
+		std::shared_ptr<Port> port;
+		int channel;
+	};
+
+	int Attach(uint32_t ip,uint16_t *rtpport,uint16_t *rtcpport,bool rtcpmux,std::shared_ptr<Port> &port);
+	void Detach(uint32_t ip,uint16_t rtpport,uint16_t rtcpport);
+	bool Find(uint32_t ip,uint16_t port,Route &route);
+
+	std::mutex mutex;
+	std::unordered_map<uint64_t, Route> routes;
+	uint16_t nextport;
+	std::atomic<uint64_t> undeliverable, overflow;
+};
+
+/** 回环传输器发送数据包时模拟的网络损伤。
+ *  每个数据包的到达时间为发送时间加上固定延迟和0到抖动之间均匀分布的随机延迟，
+ *  按重排概率选中的数据包再额外延迟 GetReorderDelay，从而排在之后发送的数据包后面。
+ *  随机数由 GetSeed 初始化，同样的发送序列总是得到同样的结果。
+ */
+class RTPLoopbackImpairments
+{
+public:
+	RTPLoopbackImpairments() : delay(0), jitter(0), reorderdelay(0.02)
+	{
+		lossrate = 0;
+		reorderrate = 0;
+		duplicaterate = 0;
+		seed = 1;
+	}
+
+	/** 设置固定的单向延迟。 */
+	void SetDelay(const RTPTime &d)								{ delay = d; }
+
+	/** 设置随机延迟的上限。 */
+	void SetJitter(const RTPTime &j)							{ jitter = j; }
+
+	/** 设置数据包丢失的概率（0到1）。 */
+	void SetLossRate(double p)								{ lossrate = p; }
+
+	/** 设置数据包被重排的概率（0到1）。 */
+	void SetReorderRate(double p)								{ reorderrate = p; }
+
+	/** 设置被重排的数据包的额外延迟（默认为20毫秒）。 */
+	void SetReorderDelay(const RTPTime &d)							{ reorderdelay = d; }
+
+	/** 设置数据包被复制一次的概率（0到1）。 */
+	void SetDuplicateRate(double p)								{ duplicaterate = p; }
+
+	/** 设置随机数种子。 */
+	void SetSeed(uint32_t s)								{ seed = s; }
+
+	RTPTime GetDelay() const								{ return delay; }
+	RTPTime GetJitter() const								{ return jitter; }
+	double GetLossRate() const								{ return lossrate; }
+	double GetReorderRate() const								{ return reorderrate; }
+	RTPTime GetReorderDelay() const								{ return reorderdelay; }
+	double GetDuplicateRate() const								{ return duplicaterate; }
+	uint32_t GetSeed() const								{ return seed; }
+
+	/** 如果没有设置任何损伤则返回 \c true。 */
+	bool IsIdeal() const
+	{
+		return delay.GetDouble() == 0 && jitter.GetDouble() == 0 && lossrate <= 0 && reorderrate <= 0 && duplicaterate <= 0;
+	}
+private:
+	RTPTime delay, jitter, reorderdelay;
+	double lossrate, reorderrate, duplicaterate;
+	uint32_t seed;
+};
+
+/** 回环传输器的参数。 */
+class RTPLoopbackTransmissionParams : public RTPTransmissionParams
+{
+public:
+	RTPLoopbackTransmissionParams();
+
+	/** 设置传输器连接的网络，必须指定。 */
+	void SetNetwork(RTPLoopbackNetwork *n)							{ network = n; }
+
+	/** 设置传输器在网络中的IPv4地址（主机字节序，默认为127.0.0.1）。 */
+	void SetBindIP(uint32_t ip)								{ bindIP = ip; }
+
+	/** 设置RTP端口基数，RTCP使用下一个端口；为零时由网络分配一对空闲端口。 */
+	void SetPortbase(uint16_t pbase)							{ portbase = pbase; }
+
+	/** 启用或禁用通过RTP端口复用RTCP流量。 */
+	void SetRTCPMultiplexing(bool f)							{ rtcpmux = f; }
+
+	/** 设置此传输器发出的数据包所经历的网络损伤。 */
+	void SetImpairments(const RTPLoopbackImpairments &i)					{ impairments = i; }
+
+	/** 如果非空，将使用指定的中止描述符来取消等待数据包到达的函数；
+	 *  设置为null（默认值）让传输器创建自己的实例。 */
+	void SetCreatedAbortDescriptors(RTPAbortDescriptors *desc)				{ m_pAbortDesc = desc; }
+
+	RTPLoopbackNetwork *GetNetwork() const							{ return network; }
+	uint32_t GetBindIP() const								{ return bindIP; }
+	uint16_t GetPortbase() const								{ return portbase; }
+	bool GetRTCPMultiplexing() const							{ return rtcpmux; }
+	const RTPLoopbackImpairments &GetImpairments() const					{ return impairments; }
+	RTPAbortDescriptors *GetCreatedAbortDescriptors() const					{ return m_pAbortDesc; }
+private:
+	RTPLoopbackNetwork *network;
+	uint32_t bindIP;
+	uint16_t portbase;
+	bool rtcpmux;
+	RTPLoopbackImpairments impairments;
+	RTPAbortDescriptors *m_pAbortDesc;
+};
+
+inline RTPLoopbackTransmissionParams::RTPLoopbackTransmissionParams() : RTPTransmissionParams(RTPTransmitter::LoopbackProto)
+{
+	network = 0;
+	bindIP = INADDR_LOOPBACK;
+	portbase = 0;
+	rtcpmux = false;
+	m_pAbortDesc = 0;
+}
+
+/** 回环传输器的附加信息。 */
+class RTPLoopbackTransmissionInfo : public RTPTransmissionInfo
+{
+public:
+	RTPLoopbackTransmissionInfo(uint32_t ip,uint16_t rtpport,uint16_t rtcpport)
+		: RTPTransmissionInfo(RTPTransmitter::LoopbackProto), bindIP(ip), m_rtpPort(rtpport), m_rtcpPort(rtcpport)	{ }
+
+	/** 返回传输器在网络中的IPv4地址。 */
+	uint32_t GetBindIP() const								{ return bindIP; }
+
+	/** 返回接收RTP数据包的端口。 */
+	uint16_t GetRTPPort() const								{ return m_rtpPort; }
+
+	/** 返回接收RTCP数据包的端口。 */
+	uint16_t GetRTCPPort() const								{ return m_rtcpPort; }
+private:
+	uint32_t bindIP;
+	uint16_t m_rtpPort, m_rtcpPort;
+};
+
+#define RTPLOOPBACKTRANS_HEADERSIZE							(20+8)
+
+/** 在同一进程内通过内存队列收发数据包的传输组件，用于基准测试和可重现的测试。
+ *  组件的参数由类 RTPLoopbackTransmissionParams 描述，具有 RTPEndpoint 参数的函数
+ *  需要IPv4端点，数据包的源地址是发送端的地址和RTP或RTCP端口。
+ *  发送时数据包被复制并按 RTPLoopbackImpairments 决定丢弃、复制和到达时间，然后无锁地放入
+ *  接收端的队列；接收端在 Poll 中只取出到达时间已过的数据包，接收时间就是到达时间。
+ *  没有设置损伤的数据包不经过按到达时间排序的映射，取出队列时直接交付。
+ *  系统支持timerfd时，GetReceiveDescriptors 还给出一个在最早的延迟数据包到达时变为可读的
+ *  定时器描述符，外部事件循环和协程接口因此不会错过设置了延迟的数据包。
+ *  发送的每个副本存放在发送端的池分配的引用计数缓冲区中，接收端释放数据包时缓冲区回到发送端的池。
+ *  不支持多播和接受/忽略列表。
+ */
+class RTPLoopbackTransmitter : public RTPTransmitter
+{
+	MEDIA_RTP_NO_COPY(RTPLoopbackTransmitter)
+public:
+	RTPLoopbackTransmitter();
+	~RTPLoopbackTransmitter();
+
+	int Init(bool treadsafe);
+	int Create(size_t maxpacksize,const RTPTransmissionParams *transparams);
+	void Destroy();
+	RTPTransmissionInfo *GetTransmissionInfo();
+	void DeleteTransmissionInfo(RTPTransmissionInfo *inf);
+
+	int GetLocalHostName(uint8_t *buffer,size_t *bufferlength);
+	bool ComesFromThisTransmitter(const RTPEndpoint *addr);
+	size_t GetHeaderOverhead()								{ return RTPLOOPBACKTRANS_HEADERSIZE; }
+
+	int Poll();
+	int WaitForIncomingData(const RTPTime &delay,bool *dataavailable = 0);
+	int AbortWait();
+	int GetReceiveDescriptors(std::vector<int> &descriptors);
+	int GetAbortDescriptor(int *descriptor);
+	int PollDescriptor(int descriptor);
+
+	int SendRTPData(const void *data,size_t len);
+	int SendRTCPData(const void *data,size_t len);
+
+	int AddDestination(const RTPEndpoint &addr);
+	int DeleteDestination(const RTPEndpoint &addr);
+	void ClearDestinations();
+
+	bool SupportsMulticasting();
+	int JoinMulticastGroup(const RTPEndpoint &addr);
+	int LeaveMulticastGroup(const RTPEndpoint &addr);
+	void LeaveAllMulticastGroups();
+
+	int SetReceiveMode(RTPTransmitter::ReceiveMode m);
+	int AddToIgnoreList(const RTPEndpoint &addr);
+	int DeleteFromIgnoreList(const RTPEndpoint &addr);
+	void ClearIgnoreList();
+	int AddToAcceptList(const RTPEndpoint &addr);
+	int DeleteFromAcceptList(const RTPEndpoint &addr);
+	void ClearAcceptList();
+	int SetMaximumPacketSize(size_t s);
+
+	bool NewDataAvailable();
+	RTPRawPacket *GetNextPacket();
+
+	/** 返回因损伤设置而丢弃的已发送数据包数量。 */
+	uint64_t GetLostPackets();
+private:
+	int SendData(const void *data,size_t len,bool rtp);
+	bool Resolve(uint32_t ip,uint16_t destport,const RTPLoopbackNetwork::Route **route);
+	void CollectPackets();
+	void ReleaseArrivedPackets(const RTPTime &curtime);
+	void ArmArrivalTimer();
+	void FlushPackets();
+
+	bool m_init;
+	bool m_created;
+	bool m_waitingForData;
+
+	RTPLoopbackNetwork *network;
+	std::shared_ptr<RTPLoopbackNetwork::Port> port;
+	uint32_t bindIP;
+	uint16_t m_rtpPort, m_rtcpPort;
+	size_t m_maxPackSize;
+
+	RTPLoopbackImpairments impairments;
+	std::mt19937 rng;
+	uint64_t lost;
+
+	std::unordered_set<RTPEndpoint> destinations;
+	std::unordered_map<uint64_t, RTPLoopbackNetwork::Route> routecache;
+	std::multimap<int64_t, RTPRawPacket *> inflight; // 按到达时间（纳秒）排序，尚未到达的数据包
+	std::list<RTPRawPacket *> m_rawpacketlist;
+	RTPPacketBufferPool *bufferpool;
+	int m_arrivalTimer; // 在最早的延迟数据包到达时变为可读，不支持timerfd时为-1
+
+	RTPAbortDescriptors m_abortDesc;
+	RTPAbortDescriptors *m_pAbortDesc; // 如果指定了外部描述符
+
+	std::mutex m_mainMutex, m_waitMutex;
+	bool m_threadsafe;
+};
+
+#endif // RTPLOOPBACKTRANSMITTER_H
@@ -0,0 +1,87 @@
+#include "media_rtp_packet_ring.h"
+#include "media_rtp_packet_factory.h"
+
+RTPPacketRing::RTPPacketRing(size_t capacity) : tail(0), dropped(0), highwater(0), head(0)
+{
+	size_t size = 1;
+
+	while (size < capacity)
+		size <<= 1;
+
+	slots = new RTPRawPacket *[size];
+	mask = size-1;
+	cachedhead = 0;
+	cachedtail = 0;
+}
+
+RTPPacketRing::~RTPPacketRing()
+{
+	RTPRawPacket *pack;
+
+	while ((pack = Pop()) != 0)
+		delete pack;
+	delete [] slots;
+}
+
+bool RTPPacketRing::Push(RTPRawPacket *pack)
+{
+	size_t t = tail.load(std::memory_order_relaxed);
+
+	if (t-cachedhead > mask)
+	{
+		cachedhead = head.load(std::memory_order_acquire);
+		if (t-cachedhead > mask)
+		{
+			delete pack;
+			dropped.fetch_add(1,std::memory_order_relaxed);
+			return false;
+		}
+	}
+
+	slots[t&mask] = pack;
+	tail.store(t+1,std::memory_order_release);
+
+	// 以缓存的消费者下标计算，得到的是上限，对高水位统计已经足够
+	size_t used = t+1-cachedhead;
+	if (used > highwater.load(std::memory_order_relaxed))
+	{
+		cachedhead = head.load(std::memory_order_acquire);
+		used = t+1-cachedhead;
+		if (used > highwater.load(std::memory_order_relaxed))
+			highwater.store(used,std::memory_order_relaxed);
+	}
+	return true;
+}
+
+bool RTPPacketRing::IsFull()
+{
+	size_t t = tail.load(std::memory_order_relaxed);
+
+	if (t-cachedhead > mask)
+		cachedhead = head.load(std::memory_order_acquire);
+	return (t-cachedhead > mask);
+}
+
+RTPRawPacket *RTPPacketRing::Pop()
+{
+	size_t h = head.load(std::memory_order_relaxed);
+
+	if (h == cachedtail)
+	{
+		cachedtail = tail.load(std::memory_order_acquire);
+		if (h == cachedtail)
+			return 0;
+	}
+
+	RTPRawPacket *pack = slots[h&mask];
+	head.store(h+1,std::memory_order_release);
+	return pack;
+}
+
+size_t RTPPacketRing::GetSize() const
+{
+	size_t h = head.load(std::memory_order_acquire);
+	size_t t = tail.load(std::memory_order_acquire);
+
+	return (t >= h) ? t-h : 0;
+}
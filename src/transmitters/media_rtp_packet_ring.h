@@ -0,0 +1,64 @@
+/**
+ * \file media_rtp_packet_ring.h
+ */
+
+#ifndef RTPPACKETRING_H
+
+#define RTPPACKETRING_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+class RTPRawPacket;
+
+/** 在一个接收线程（生产者）和一个处理线程（消费者）之间传递数据包的有界无锁环形队列。
+ *  只能有一个线程调用 Push，一个线程调用 Pop；两端各自只写自己的下标，并缓存对方的下标，
+ *  只有缓存的值表明队列已满或为空时才重新读取，因此通常情况下不会在两个线程之间来回传递缓存行。
+ *  队列拥有其中的数据包，析构时删除未取走的数据包。
+ */
+class RTPPacketRing
+{
+	MEDIA_RTP_NO_COPY(RTPPacketRing)
+public:
+	/** 构造一个至少能容纳 \c capacity 个数据包的队列，容量向上取整为2的幂。 */
+	RTPPacketRing(size_t capacity = RTP_PACKETRING_DEFAULTCAPACITY);
+	~RTPPacketRing();
+
+	/** 返回队列的容量。 */
+	size_t GetCapacity() const								{ return mask+1; }
+
+	/** 生产者调用：把 \c pack 放入队列。队列已满时删除该数据包、增加丢弃计数并返回 \c false。 */
+	bool Push(RTPRawPacket *pack);
+
+	/** 生产者调用：如果队列已满、下一次 Push 会丢弃数据包则返回 \c true。 */
+	bool IsFull();
+
+	/** 消费者调用：取出最早的数据包，队列为空时返回null。 */
+	RTPRawPacket *Pop();
+
+	/** 返回队列中数据包的近似数量。 */
+	size_t GetSize() const;
+
+	/** 返回因队列已满而丢弃的数据包数量。 */
+	uint64_t GetDroppedPackets() const							{ return dropped.load(std::memory_order_relaxed); }
+
+	/** 返回队列中曾经同时存在的最多数据包数量。 */
+	size_t GetHighWaterMark() const								{ return highwater.load(std::memory_order_relaxed); }
+private:
+	RTPRawPacket **slots;
+	size_t mask;
+
+	// 生产者和消费者的数据分别位于不同的缓存行
+	alignas(RTP_CACHELINESIZE) std::atomic<size_t> tail;
+	size_t cachedhead;
+	std::atomic<uint64_t> dropped;
+	std::atomic<size_t> highwater;
+
+	alignas(RTP_CACHELINESIZE) std::atomic<size_t> head;
+	size_t cachedtail;
+};
+
+#endif // RTPPACKETRING_H
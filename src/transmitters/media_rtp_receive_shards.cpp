@@ -0,0 +1,287 @@
+#include "media_rtp_receive_shards.h"
+#include "media_rtp_packet_factory.h"
+#include "media_rtp_packet_buffer.h"
+#include "media_rtp_endpoint.h"
+#include "media_rtp_structs.h"
+#include "media_rtp_utils.h"
+#include "media_rtp_errors.h"
+#include <errno.h>
+#ifdef RTP_SUPPORT_REUSEPORT_CBPF
+	#include <linux/filter.h>
+#endif // RTP_SUPPORT_REUSEPORT_CBPF
+#ifdef RTP_HAVE_PTHREAD_SETAFFINITY
+	#include <pthread.h>
+	#include <sched.h>
+#endif // RTP_HAVE_PTHREAD_SETAFFINITY
+
+#define RTPRECEIVESHARDS_MAXPACKSIZE							65535
+
+RTPReceiveShards::RTPReceiveShards() : signalled(false)
+{
+	rtcpmux = false;
+	kerneltimestamps = false;
+	running = false;
+}
+
+RTPReceiveShards::~RTPReceiveShards()
+{
+	Stop();
+}
+
+int RTPReceiveShards::Start(const std::vector<int> &socks,bool mux,bool timestamps,RTPPacketBufferPool *pool,
+                            const std::vector<int> &cpus)
+{
+	int status;
+
+	if (running)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	if (socks.empty())
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+#ifdef RTP_HAVE_PTHREAD_SETAFFINITY
+	for (size_t i = 0 ; i < cpus.size() ; i++)
+	{
+		if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE)
+			return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+#else
+	if (!cpus.empty())
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_HAVE_PTHREAD_SETAFFINITY
+
+	if ((status = stopdesc.Init()) < 0)
+		return status;
+	if ((status = readydesc.Init()) < 0)
+	{
+		stopdesc.Destroy();
+		return status;
+	}
+
+	rtcpmux = mux;
+	kerneltimestamps = timestamps;
+	signalled = false;
+	running = true;
+
+	for (size_t i = 0 ; i < socks.size() ; i++)
+	{
+		Shard *shard = new Shard();
+
+		shard->sock = socks[i];
+		if (pool != 0)
+		{
+			pool->AddReference();
+			shard->pool = pool;
+		}
+		else
+			shard->pool = RTPPacketBufferPool::Create(RTP_PACKETBUFFER_DEFAULTSIZE,RTP_PACKETBUFFER_TRANSMITTERMAXFREE);
+		shards.push_back(shard);
+	}
+	for (size_t i = 0 ; i < shards.size() ; i++)
+		shards[i]->thread = std::thread(&RTPReceiveShards::WorkerThread,this,shards[i]);
+
+#ifdef RTP_HAVE_PTHREAD_SETAFFINITY
+	// 线程已经在运行，绑定之前读取的数据包不受影响
+	for (size_t i = 0 ; !cpus.empty() && i < shards.size() ; i++)
+	{
+		cpu_set_t set;
+
+		CPU_ZERO(&set);
+		CPU_SET(cpus[i%cpus.size()],&set);
+		if (pthread_setaffinity_np(shards[i]->thread.native_handle(),sizeof(cpu_set_t),&set) != 0)
+		{
+			Stop();
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+	}
+#endif // RTP_HAVE_PTHREAD_SETAFFINITY
+	return 0;
+}
+
+void RTPReceiveShards::Stop()
+{
+	if (!running)
+		return;
+
+	// 停止信号不会被清除，所有线程都能看到它
+	stopdesc.SendAbortSignal();
+	for (size_t i = 0 ; i < shards.size() ; i++)
+	{
+		Shard *shard = shards[i];
+
+		shard->thread.join();
+		shard->pool->Release(); // 池在剩余的缓冲区释放之后才被删除
+		delete shard; // 队列删除其中剩余的数据包
+	}
+	shards.clear();
+	stopdesc.Destroy();
+	readydesc.Destroy();
+	running = false;
+}
+
+void RTPReceiveShards::ClearReadySignal()
+{
+	// 先清除信号再清除标志：在这之后放入的数据包要么会被 PopPacket 取走，要么会重新发出信号
+	readydesc.ClearAbortSignal();
+	signalled.store(false);
+}
+
+RTPRawPacket *RTPReceiveShards::PopPacket()
+{
+	for (size_t i = 0 ; i < shards.size() ; i++)
+	{
+		RTPRawPacket *pack = shards[i]->ring.Pop();
+
+		if (pack != 0)
+			return pack;
+	}
+	return 0;
+}
+
+void RTPReceiveShards::SignalReady()
+{
+	if (!signalled.exchange(true))
+		readydesc.SendAbortSignal();
+}
+
+uint64_t RTPReceiveShards::GetDroppedPackets() const
+{
+	uint64_t dropped = 0;
+
+	for (size_t i = 0 ; i < shards.size() ; i++)
+		dropped += shards[i]->ring.GetDroppedPackets();
+	return dropped;
+}
+
+size_t RTPReceiveShards::GetHighWaterMark() const
+{
+	size_t highwater = 0;
+
+	for (size_t i = 0 ; i < shards.size() ; i++)
+	{
+		if (shards[i]->ring.GetHighWaterMark() > highwater)
+			highwater = shards[i]->ring.GetHighWaterMark();
+	}
+	return highwater;
+}
+
+void RTPReceiveShards::WorkerThread(Shard *shard)
+{
+	int socks[2] = { shard->sock, stopdesc.GetAbortSocket() };
+	std::vector<uint8_t> buffer(RTPRECEIVESHARDS_MAXPACKSIZE);
+
+	while (true)
+	{
+		int8_t readflags[2] = { 0, 0 };
+
+		if (RTPSelect(socks,readflags,2,RTPTime(-1)) < 0 || readflags[1])
+			break;
+		if (!readflags[0])
+			continue;
+
+		RTPTimeBatch timebatch; // 这一轮读取的数据包共用一次时钟读取
+		bool pushed = false;
+
+		// 非阻塞地读完套接字中的所有数据报
+		while (true)
+		{
+			struct sockaddr_storage srcaddr;
+			RTPSOCKLENTYPE fromlen = sizeof(struct sockaddr_storage);
+			RTPTime curtime(0);
+			int recvlen = RTPReceiveFrom(shard->sock,&buffer[0],buffer.size(),MSG_DONTWAIT,(struct sockaddr *)&srcaddr,&fromlen,kerneltimestamps,&curtime);
+
+			if (recvlen < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			if (recvlen == 0)
+				continue;
+
+			bool isrtp = true;
+			if (rtcpmux && (size_t)recvlen > sizeof(RTCPCommonHeader)) // 多路复用时检查负载类型
+			{
+				uint8_t packettype = ((RTCPCommonHeader *)&buffer[0])->packettype;
+
+				if (packettype >= 200 && packettype <= 204)
+					isrtp = false;
+			}
+
+			RTPPacketBuffer *buf = shard->pool->Allocate(recvlen);
+			memcpy(buf->GetData(),&buffer[0],recvlen);
+
+			RTPEndpoint *addr = new RTPEndpoint(RTPEndpoint::CreateFromSockAddr((struct sockaddr *)&srcaddr));
+			RTPRawPacket *pack = new RTPRawPacket(buf->GetData(),recvlen,addr,curtime,isrtp);
+
+			pack->SetDataReleaser(buf);
+
+			// 传输器取得太慢时队列会丢弃数据包
+			if (shard->ring.Push(pack))
+				pushed = true;
+		}
+
+		// 每一轮读取最多发出一次信号，且只在消费者取走上一次信号之后
+		if (pushed && !signalled.exchange(true))
+			readydesc.SendAbortSignal();
+	}
+}
+
+int RTPReceiveShards::AttachSSRCSteering(int sock,int numsocks)
+{
+#ifdef RTP_SUPPORT_REUSEPORT_CBPF
+	// 偏移量相对于UDP负载：RTCP包的类型位于第1字节，发送者SSRC位于第4字节；
+	// RTP包的SSRC位于第8字节。返回值是套接字在重用端口组中的序号（按绑定顺序）
+	struct sock_filter code[] = {
+		{ BPF_LD|BPF_B|BPF_ABS, 0, 0, 1 },
+		{ BPF_JMP|BPF_JGE|BPF_K, 0, 3, 200 },
+		{ BPF_JMP|BPF_JGT|BPF_K, 2, 0, 204 },
+		{ BPF_LD|BPF_W|BPF_ABS, 0, 0, 4 },
+		{ BPF_JMP|BPF_JA, 0, 0, 1 },
+		{ BPF_LD|BPF_W|BPF_ABS, 0, 0, 8 },
+		{ BPF_ALU|BPF_MOD|BPF_K, 0, 0, (uint32_t)numsocks },
+		{ BPF_RET|BPF_A, 0, 0, 0 }
+	};
+	struct sock_fprog prog = { (unsigned short)(sizeof(code)/sizeof(code[0])), code };
+
+	if (numsocks < 1)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	if (setsockopt(sock,SOL_SOCKET,SO_ATTACH_REUSEPORT_CBPF,&prog,sizeof(prog)) != 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	return 0;
+#else
+	MEDIA_RTP_UNUSED(sock);
+	MEDIA_RTP_UNUSED(numsocks);
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_SUPPORT_REUSEPORT_CBPF
+}
+
+int RTPReceiveShards::AttachSSRCFilter(int sock,int numsocks,int index)
+{
+#ifdef RTP_SUPPORT_REUSEPORT_CBPF
+	// 与 AttachSSRCSteering 的计算相同，但套接字过滤器的偏移量相对于UDP头，比负载多8字节；
+	// 结果不是 index 时丢弃数据包，长度不足的数据包也被丢弃
+	struct sock_filter code[] = {
+		{ BPF_LD|BPF_B|BPF_ABS, 0, 0, 9 },
+		{ BPF_JMP|BPF_JGE|BPF_K, 0, 3, 200 },
+		{ BPF_JMP|BPF_JGT|BPF_K, 2, 0, 204 },
+		{ BPF_LD|BPF_W|BPF_ABS, 0, 0, 12 },
+		{ BPF_JMP|BPF_JA, 0, 0, 1 },
+		{ BPF_LD|BPF_W|BPF_ABS, 0, 0, 16 },
+		{ BPF_ALU|BPF_MOD|BPF_K, 0, 0, (uint32_t)numsocks },
+		{ BPF_JMP|BPF_JEQ|BPF_K, 0, 1, (uint32_t)index },
+		{ BPF_RET|BPF_K, 0, 0, 0xffffffff },
+		{ BPF_RET|BPF_K, 0, 0, 0 }
+	};
+	struct sock_fprog prog = { (unsigned short)(sizeof(code)/sizeof(code[0])), code };
+
+	if (numsocks < 1 || index < 0 || index >= numsocks)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	if (setsockopt(sock,SOL_SOCKET,SO_ATTACH_FILTER,&prog,sizeof(prog)) != 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	return 0;
+#else
+	MEDIA_RTP_UNUSED(sock);
+	MEDIA_RTP_UNUSED(numsocks);
+	MEDIA_RTP_UNUSED(index);
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_SUPPORT_REUSEPORT_CBPF
+}
@@ -0,0 +1,104 @@
+/**
+ * \file media_rtp_receive_shards.h
+ */
+
+#ifndef RTPRECEIVESHARDS_H
+
+#define RTPRECEIVESHARDS_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_abort_descriptors.h"
+#include "media_rtp_packet_ring.h"
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class RTPRawPacket;
+class RTPPacketBufferPool;
+
+/** 用多个接收线程读取绑定在同一端口上的一组 SO_REUSEPORT 套接字。
+ *  内核把每个数据报交给组内的一个套接字，系统支持时传输器附加一个CBPF程序，按RTP头
+ *  （复用的RTCP则按发送者SSRC）中的SSRC选择套接字，因此同一SSRC的数据包总是由同一个
+ *  线程按到达顺序接收；否则内核按源地址和端口的哈希选择套接字，同一个发送端的数据包
+ *  同样不会乱序。多播数据包不经过重用端口组的选择，内核把它交给每个加入了多播组的套接字；
+ *  附加了SSRC选择程序时每个套接字还附加一个按相同规则过滤的套接字过滤器，所有套接字都可以
+ *  加入多播组，每个多播数据包仍然只由按SSRC选中的一个线程接收。每个线程把数据包放入自己的无锁队列（RTPPacketRing），传输器在 Poll 中
+ *  按线程顺序取出所有数据包，两边都不需要加锁。每个队列最多保存 RTP_RECEIVESHARD_MAXQUEUE
+ *  个数据包，超出的数据包被丢弃并计数。数据包存放在引用计数缓冲区（RTPPacketBuffer）中，
+ *  没有提供共享的池时每个线程使用自己的池，分配缓冲区时不与其他线程竞争。线程放入数据包后，如果消费者已取走上一次的通知，
+ *  就通过一个信号描述符唤醒它。传输器逐个取出数据包直接放入自己的队列，不经过中间的列表。
+ */
+class RTPReceiveShards
+{
+	MEDIA_RTP_NO_COPY(RTPReceiveShards)
+public:
+	/** 构造一个未启动的实例。 */
+	RTPReceiveShards();
+	~RTPReceiveShards();
+
+	/** 为 \c socks 中的每个套接字启动一个接收线程，套接字由调用者创建和关闭，可以是IPv4或IPv6套接字。
+	 *  \c rtcpmux 表示RTCP是否通过这些套接字复用，\c kerneltimestamps 表示是否已启用内核接收时间戳。
+	 *  \c pool 不为空时所有线程从这个池分配数据包缓冲区，线程运行期间持有池的一个引用；
+	 *  为空时每个线程创建自己的池。
+	 *  \c cpus 不为空时第 i 个线程绑定到 <tt>cpus[i % cpus.size()]</tt> 上运行，系统不支持时返回负值。
+	 */
+	int Start(const std::vector<int> &socks,bool rtcpmux,bool kerneltimestamps,RTPPacketBufferPool *pool = 0,
+	          const std::vector<int> &cpus = std::vector<int>());
+
+	/** 停止并等待所有接收线程结束，删除尚未取走的数据包。 */
+	void Stop();
+
+	/** 如果接收线程正在运行则返回 \c true。 */
+	bool IsRunning() const									{ return running; }
+
+	/** 返回有数据包到达时变为可读的描述符，可以与其他套接字一起等待。 */
+	int GetReadySocket() const								{ return readydesc.GetAbortSocket(); }
+
+	/** 清除就绪信号，应在用 PopPacket 取出数据包之前调用。 */
+	void ClearReadySignal();
+
+	/** 按线程顺序取出下一个已接收的数据包，没有数据包时返回null。 */
+	RTPRawPacket *PopPacket();
+
+	/** 重新发出就绪信号，用于消费者没有取完所有数据包就停止的情况。 */
+	void SignalReady();
+
+	/** 返回所有队列因已满而丢弃的数据包数量。 */
+	uint64_t GetDroppedPackets() const;
+
+	/** 返回各个队列高水位中的最大值。 */
+	size_t GetHighWaterMark() const;
+
+	/** 在 \c sock 上附加按SSRC在 \c numsocks 个套接字之间选择的CBPF程序，
+	 *  \c sock 必须已加入重用端口组；系统不支持时返回负值。
+	 */
+	static int AttachSSRCSteering(int sock,int numsocks);
+
+	/** 在 \c sock 上附加套接字过滤器，只保留按 AttachSSRCSteering 的规则选中第 \c index 个
+	 *  套接字的数据包，用于让多播数据包也按SSRC分配；系统不支持时返回负值。
+	 */
+	static int AttachSSRCFilter(int sock,int numsocks,int index);
+private:
+	class Shard
+	{
+	public:
+		Shard() : ring(RTP_RECEIVESHARD_MAXQUEUE)						{ pool = 0; }
+
+		int sock;
+		RTPPacketBufferPool *pool;
+		std::thread thread;
+		RTPPacketRing ring;
+	};
+
+	void WorkerThread(Shard *shard);
+
+	std::vector<Shard *> shards;
+	RTPAbortDescriptors stopdesc, readydesc;
+	std::atomic<bool> signalled;
+	bool rtcpmux, kerneltimestamps;
+	bool running;
+};
+
+#endif // RTPRECEIVESHARDS_H
@@ -0,0 +1,1038 @@
+#include "media_rtp_shm_transmitter.h"
+#include "media_rtp_endpoint.h"
+#include "media_rtp_errors.h"
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef RTP_HAVE_EVENTFD
+	#include <sys/eventfd.h>
+#endif // RTP_HAVE_EVENTFD
+#include <new>
+
+#define RTPSHMRING_MAGIC								0x52545052 // "RTPR"
+#define RTPSHMRING_VERSION								2
+#define RTPSHMRING_MAXSLOTS								65536
+#define RTPSHMTRANS_MAXPACKSIZE								65535
+
+	#define MAINMUTEX_LOCK 		{ if (m_threadsafe) m_mainMutex.lock(); }
+	#define MAINMUTEX_UNLOCK	{ if (m_threadsafe) m_mainMutex.unlock(); }
+	#define WAITMUTEX_LOCK		{ if (m_threadsafe) m_waitMutex.lock(); }
+	#define WAITMUTEX_UNLOCK	{ if (m_threadsafe) m_waitMutex.unlock(); }
+
+// 映射在两个进程中的共享头部，之后是所有的槽位；生产者和消费者写入的下标位于不同的缓存行
+class RTPSharedMemoryRing::Header
+{
+public:
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slotcount;
+	uint32_t slotsize;
+
+	alignas(RTP_CACHELINESIZE) std::atomic<uint32_t> tail; // 生产者写入的位置
+	std::atomic<uint64_t> dropped;
+
+	alignas(RTP_CACHELINESIZE) std::atomic<uint32_t> readpos; // 消费者读取的位置
+};
+
+// 每个槽位开头的数据包描述，数据紧跟在后面。持有标志由消费者在读出时设置、释放时清除，
+// 生产者遇到仍被持有的槽位时只在描述中标记跳过，不改动数据
+class RTPSharedMemorySlot
+{
+public:
+	uint16_t length;
+	uint16_t sender;
+	uint8_t rtp;
+	uint8_t skipped;
+	std::atomic<uint16_t> held;
+};
+
+static_assert(sizeof(RTPSharedMemorySlot) == RTPSHMTRANS_HEADERSIZE, "slot header size mismatch");
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "shared memory atomics must be lock free");
+
+static inline size_t RTPSharedMemoryStride(size_t slotsize)
+{
+	return (slotsize+sizeof(RTPSharedMemorySlot)+RTP_CACHELINESIZE-1)&~((size_t)RTP_CACHELINESIZE-1);
+}
+
+RTPSharedMemoryRing::RTPSharedMemoryRing() : refs(1)
+{
+	memfd = -1;
+	eventfd = -1;
+	mapping = 0;
+	mappingsize = 0;
+	header = 0;
+	slots = 0;
+	mask = 0;
+	stride = 0;
+	slotsize = 0;
+	cachedreadpos = 0;
+	readpos = 0;
+	cachedtail = 0;
+}
+
+RTPSharedMemoryRing::~RTPSharedMemoryRing()
+{
+	if (mapping)
+		munmap(mapping,mappingsize);
+	if (memfd >= 0)
+		close(memfd);
+	if (eventfd >= 0)
+		close(eventfd);
+}
+
+int RTPSharedMemoryRing::Create(size_t slotcount,size_t slotsize,int *memfd,int *eventfd)
+{
+#if defined(RTP_SUPPORT_MEMFD) && defined(RTP_HAVE_EVENTFD)
+	if (slotcount == 0 || slotcount > RTPSHMRING_MAXSLOTS || slotsize == 0 || slotsize > RTPSHMTRANS_MAXPACKSIZE)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	uint32_t count = 1;
+
+	while (count < slotcount)
+		count <<= 1;
+
+	size_t size = sizeof(Header)+(size_t)count*RTPSharedMemoryStride(slotsize);
+	int fd = memfd_create("rtp-shm-ring",MFD_CLOEXEC);
+
+	if (fd < 0)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	if (ftruncate(fd,(off_t)size) < 0)
+	{
+		close(fd);
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	void *p = mmap(0,sizeof(Header),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+
+	if (p == MAP_FAILED)
+	{
+		close(fd);
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	Header *h = new (p) Header();
+
+	h->magic = RTPSHMRING_MAGIC;
+	h->version = RTPSHMRING_VERSION;
+	h->slotcount = count;
+	h->slotsize = (uint32_t)slotsize;
+	h->tail.store(0);
+	h->dropped.store(0);
+	h->readpos.store(0);
+	munmap(p,sizeof(Header));
+
+	int efd = ::eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+
+	if (efd < 0)
+	{
+		close(fd);
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	}
+
+	*memfd = fd;
+	*eventfd = efd;
+	return 0;
+#else
+	MEDIA_RTP_UNUSED(slotcount);
+	MEDIA_RTP_UNUSED(slotsize);
+	MEDIA_RTP_UNUSED(memfd);
+	MEDIA_RTP_UNUSED(eventfd);
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_SUPPORT_MEMFD && RTP_HAVE_EVENTFD
+}
+
+int RTPSharedMemoryRing::Attach(int memfd,int eventfd,RTPSharedMemoryRing **ring)
+{
+	struct stat st;
+
+	if (memfd < 0 || eventfd < 0 || fstat(memfd,&st) < 0 || (size_t)st.st_size < sizeof(Header))
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	size_t size = (size_t)st.st_size;
+	void *p = mmap(0,size,PROT_READ|PROT_WRITE,MAP_SHARED,memfd,0);
+
+	if (p == MAP_FAILED)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+
+	// 内存由另一个进程初始化，映射之前先检查布局
+	Header *h = (Header *)p;
+	uint32_t count = h->slotcount;
+	size_t slotsize = h->slotsize;
+
+	if (h->magic != RTPSHMRING_MAGIC || h->version != RTPSHMRING_VERSION || count == 0 || count > RTPSHMRING_MAXSLOTS ||
+	    (count&(count-1)) != 0 || slotsize == 0 || slotsize > RTPSHMTRANS_MAXPACKSIZE ||
+	    sizeof(Header)+(size_t)count*RTPSharedMemoryStride(slotsize) > size)
+	{
+		munmap(p,size);
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	int fd = fcntl(memfd,F_DUPFD_CLOEXEC,0);
+	int efd = fcntl(eventfd,F_DUPFD_CLOEXEC,0);
+
+	if (fd < 0 || efd < 0)
+	{
+		if (fd >= 0)
+			close(fd);
+		if (efd >= 0)
+			close(efd);
+		munmap(p,size);
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	// 接收端只在清除信号时读取eventfd，不能阻塞
+	int flags = fcntl(efd,F_GETFL);
+	if (flags >= 0 && (flags&O_NONBLOCK) == 0)
+		fcntl(efd,F_SETFL,flags|O_NONBLOCK);
+
+	RTPSharedMemoryRing *r = new RTPSharedMemoryRing();
+
+	r->memfd = fd;
+	r->eventfd = efd;
+	r->mapping = (uint8_t *)p;
+	r->mappingsize = size;
+	r->header = h;
+	r->slots = r->mapping+sizeof(Header);
+	r->mask = count-1;
+	r->stride = RTPSharedMemoryStride(slotsize);
+	r->slotsize = slotsize;
+	r->readpos = h->readpos.load(std::memory_order_acquire);
+	r->cachedreadpos = r->readpos;
+	r->cachedtail = r->readpos;
+
+	*ring = r;
+	return 0;
+}
+
+void RTPSharedMemoryRing::Release()
+{
+	if (refs.fetch_sub(1,std::memory_order_acq_rel) == 1)
+		delete this;
+}
+
+uint64_t RTPSharedMemoryRing::GetDroppedPackets() const
+{
+	return header->dropped.load(std::memory_order_relaxed);
+}
+
+int RTPSharedMemoryRing::Write(const void *data,size_t len,bool rtp,uint16_t sender)
+{
+	if (len > slotsize)
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	uint32_t tail = header->tail.load(std::memory_order_relaxed);
+	uint32_t pos = tail;
+	uint8_t *slot;
+	RTPSharedMemorySlot *desc;
+
+	// 跳过仍被消费者持有的槽位，被持有的数据包只占用自己的槽位，不会挡住之后已释放的槽位
+	while (true)
+	{
+		// 只有缓存的读取位置表明环已满时才重新读取
+		if (pos-cachedreadpos > mask)
+		{
+			cachedreadpos = header->readpos.load(std::memory_order_acquire);
+			if (pos-cachedreadpos > mask)
+			{
+				header->dropped.fetch_add(1,std::memory_order_relaxed);
+				return MEDIA_RTP_ERR_RESOURCE_ERROR;
+			}
+		}
+
+		slot = GetSlot(pos);
+		desc = (RTPSharedMemorySlot *)slot;
+		if (desc->held.load(std::memory_order_acquire) == 0)
+			break;
+		desc->skipped = 1;
+		pos++;
+	}
+
+	desc->length = (uint16_t)len;
+	desc->sender = sender;
+	desc->rtp = (rtp) ? 1 : 0;
+	desc->skipped = 0;
+	memcpy(slot+sizeof(RTPSharedMemorySlot),data,len);
+
+	// 跳过的槽位和数据包一起发布，消费者不会在两者之间读完并开始等待
+	header->tail.store(pos+1,std::memory_order_release);
+
+	// 和 Read 中的顺序配合：要么消费者看到新的写入位置，要么这里看到消费者已读完并发出信号
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (header->readpos.load(std::memory_order_relaxed) == tail)
+	{
+		uint64_t one = 1;
+
+		if (write(eventfd,&one,sizeof(one)) < 0)
+		{
+			// 计数器已满时描述符本来就是可读的
+		}
+	}
+	return 0;
+}
+
+void RTPSharedMemoryRing::ClearSignal()
+{
+	uint64_t value;
+
+	if (read(eventfd,&value,sizeof(value)) < 0)
+	{
+		// 没有信号时返回 EAGAIN
+	}
+}
+
+uint8_t *RTPSharedMemoryRing::Read(size_t *len,bool *rtp,uint16_t *sender)
+{
+	while (true)
+	{
+		if (readpos == cachedtail)
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			uint32_t tail = header->tail.load(std::memory_order_acquire);
+
+			if (tail == readpos || tail-readpos > mask+1) // 写入位置不可能超前一圈以上
+				return 0;
+			cachedtail = tail;
+		}
+
+		uint8_t *slot = GetSlot(readpos);
+		RTPSharedMemorySlot *desc = (RTPSharedMemorySlot *)slot;
+
+		readpos++;
+		if (desc->skipped) // 生产者跳过的槽位仍由之前读出的数据包持有
+		{
+			header->readpos.store(readpos,std::memory_order_release);
+			continue;
+		}
+
+		uint32_t length = desc->length;
+
+		// 生产者看到新的读取位置之前必须能看到持有标志
+		refs.fetch_add(1,std::memory_order_relaxed);
+		desc->held.store(1,std::memory_order_relaxed);
+		header->readpos.store(readpos,std::memory_order_release);
+
+		// 对端写入的长度不可信，跳过无效的槽位
+		if (length > slotsize)
+		{
+			ReleaseData(slot+sizeof(RTPSharedMemorySlot));
+			continue;
+		}
+
+		*len = length;
+		*rtp = (desc->rtp != 0);
+		*sender = desc->sender;
+		return slot+sizeof(RTPSharedMemorySlot);
+	}
+}
+
+bool RTPSharedMemoryRing::HasData()
+{
+	return header->tail.load(std::memory_order_acquire) != readpos;
+}
+
+void RTPSharedMemoryRing::ReleaseData(uint8_t *data)
+{
+	RTPSharedMemorySlot *desc = (RTPSharedMemorySlot *)(data-sizeof(RTPSharedMemorySlot));
+
+	// 生产者看到标志清除时，对数据的读取都已完成
+	desc->held.store(0,std::memory_order_release);
+	Release();
+}
+
+static std::atomic<uint16_t> rtpshmidcounter(0);
+
+RTPSharedMemoryTransmitter::RTPSharedMemoryTransmitter() : RTPTransmitter()
+{
+	m_created = false;
+	m_init = false;
+}
+
+RTPSharedMemoryTransmitter::~RTPSharedMemoryTransmitter()
+{
+	Destroy();
+}
+
+int RTPSharedMemoryTransmitter::Init(bool tsafe)
+{
+	if (m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	m_threadsafe = tsafe;
+
+	m_maxPackSize = RTPSHMTRANS_MAXPACKSIZE;
+	m_init = true;
+	return 0;
+}
+
+int RTPSharedMemoryTransmitter::Create(size_t maximumpacketsize,const RTPTransmissionParams *transparams)
+{
+	const RTPSharedMemoryTransmissionParams *params,defaultparams;
+	int status;
+
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 获取传输参数
+
+	if (transparams == 0)
+		params = &defaultparams;
+	else
+	{
+		if (transparams->GetTransmissionProtocol() != RTPTransmitter::SharedMemoryProto)
+		{
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_INVALID_PARAMETER;
+		}
+		params = static_cast<const RTPSharedMemoryTransmissionParams *>(transparams);
+	}
+	if (maximumpacketsize > RTPSHMTRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	if (!params->GetCreatedAbortDescriptors())
+	{
+		if ((status = m_abortDesc.Init()) < 0)
+		{
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+		m_pAbortDesc = &m_abortDesc;
+	}
+	else
+	{
+		m_pAbortDesc = params->GetCreatedAbortDescriptors();
+		if (!m_pAbortDesc->IsInitialized())
+		{
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_INVALID_STATE;
+		}
+	}
+
+	// 映射所有的环，没有指定接收环时创建一个
+
+	RTPSharedMemoryRing *ring;
+
+	status = 0;
+	for (const auto &desc : params->GetInboundRings())
+	{
+		if ((status = RTPSharedMemoryRing::Attach(desc.first,desc.second,&ring)) < 0)
+			break;
+		inbound.push_back(ring);
+	}
+	if (status >= 0 && inbound.empty())
+	{
+		int memfd, eventfd;
+
+		if ((status = RTPSharedMemoryRing::Create(params->GetSlotCount(),params->GetSlotSize(),&memfd,&eventfd)) >= 0)
+		{
+			status = RTPSharedMemoryRing::Attach(memfd,eventfd,&ring);
+			close(memfd);
+			close(eventfd);
+			if (status >= 0)
+				inbound.push_back(ring);
+		}
+	}
+	if (status >= 0)
+	{
+		for (const auto &desc : params->GetOutboundRings())
+		{
+			if ((status = RTPSharedMemoryRing::Attach(desc.first,desc.second,&ring)) < 0)
+				break;
+			outbound.push_back(ring);
+		}
+	}
+	if (status < 0)
+	{
+		ReleaseRings();
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
+	localid = params->GetLocalID();
+	while (localid == 0)
+		localid = (uint16_t)(getpid()*16+rtpshmidcounter.fetch_add(1,std::memory_order_relaxed));
+
+	dropped = 0;
+	m_maxPackSize = maximumpacketsize;
+	m_waitingForData = false;
+	m_created = true;
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+void RTPSharedMemoryTransmitter::Destroy()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK;
+		return;
+	}
+
+	// 应用程序仍持有的数据包保留各自的环，直到它们被删除
+	FlushPackets();
+	ReleaseRings();
+	m_created = false;
+
+	if (m_waitingForData)
+	{
+		m_pAbortDesc->SendAbortSignal();
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_LOCK // 确保 WaitForIncomingData 函数已结束
+		WAITMUTEX_UNLOCK
+	}
+	else
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+
+	MAINMUTEX_UNLOCK
+}
+
+RTPTransmissionInfo *RTPSharedMemoryTransmitter::GetTransmissionInfo()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	std::vector<std::pair<int,int> > rings;
+
+	for (auto ring : inbound)
+		rings.push_back(std::make_pair(ring->GetMemoryDescriptor(),ring->GetEventDescriptor()));
+
+	RTPTransmissionInfo *tinf = new RTPSharedMemoryTransmissionInfo(localid,rings);
+	MAINMUTEX_UNLOCK
+	return tinf;
+}
+
+void RTPSharedMemoryTransmitter::DeleteTransmissionInfo(RTPTransmissionInfo *i)
+{
+	if (!m_init)
+		return;
+
+	delete i;
+}
+
+int RTPSharedMemoryTransmitter::GetLocalHostName(uint8_t *buffer,size_t *bufferlength)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 所有的对端都在同一主机上
+	const char *str = "localhost";
+	size_t len = strlen(str);
+
+	if ((*bufferlength) < len)
+	{
+		*bufferlength = len; // 告诉应用程序所需的缓冲区大小
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	memcpy(buffer,str,len);
+	*bufferlength = len;
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPSharedMemoryTransmitter::ComesFromThisTransmitter(const RTPEndpoint *addr)
+{
+	if (!m_init)
+		return false;
+
+	if (addr == 0)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v = false;
+
+	if (m_created && addr->GetType() == RTPEndpoint::IPv4 && addr->GetIPv4() == INADDR_LOOPBACK && addr->GetRtpPort() == localid)
+		v = true;
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+int RTPSharedMemoryTransmitter::Poll()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	RTPTime curtime = RTPTime::CurrentTime();
+
+	for (auto ring : inbound)
+		CollectPackets(ring,curtime);
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPSharedMemoryTransmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavailable)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 生产者只在环从空变为非空时写eventfd，已有未读取的数据包时不等待
+	bool pending = false;
+	std::vector<int> socks;
+
+	for (auto ring : inbound)
+	{
+		if (ring->HasData())
+			pending = true;
+		socks.push_back(ring->GetEventDescriptor());
+	}
+	socks.push_back(m_pAbortDesc->GetAbortSocket());
+
+	if (pending)
+	{
+		if (dataavailable != 0)
+			*dataavailable = true;
+		MAINMUTEX_UNLOCK
+		return 0;
+	}
+
+	std::vector<int8_t> readflags(socks.size(),0);
+
+	m_waitingForData = true;
+
+	WAITMUTEX_LOCK
+	MAINMUTEX_UNLOCK
+
+	int status = RTPSelect(&socks[0],&readflags[0],socks.size(),delay);
+	if (status < 0)
+	{
+		MAINMUTEX_LOCK
+		m_waitingForData = false;
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_UNLOCK
+		return status;
+	}
+
+	MAINMUTEX_LOCK
+	m_waitingForData = false;
+	if (!m_created) // 调用了销毁
+	{
+		MAINMUTEX_UNLOCK;
+		WAITMUTEX_UNLOCK
+		return 0;
+	}
+
+	// 如果中止，则从中止缓冲区读取
+	if (readflags.back())
+		m_pAbortDesc->ReadSignallingByte();
+
+	if (dataavailable != 0)
+	{
+		bool avail = false;
+
+		for (size_t i = 0 ; i < inbound.size() ; i++)
+		{
+			if (readflags[i])
+				avail = true;
+		}
+		*dataavailable = avail;
+	}
+
+	MAINMUTEX_UNLOCK
+	WAITMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPSharedMemoryTransmitter::AbortWait()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (!m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	m_pAbortDesc->SendAbortSignal();
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPSharedMemoryTransmitter::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 每个接收环的eventfd在环从空变为非空时变为可读，PollDescriptor 读完环中所有的数据包
+	for (auto ring : inbound)
+		descriptors.push_back(ring->GetEventDescriptor());
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPSharedMemoryTransmitter::GetAbortDescriptor(int *descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	*descriptor = m_pAbortDesc->GetAbortSocket();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPSharedMemoryTransmitter::PollDescriptor(int descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status = MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	if (descriptor == m_pAbortDesc->GetAbortSocket())
+	{
+		m_pAbortDesc->ReadSignallingByte();
+		status = 0;
+	}
+	else
+	{
+		for (auto ring : inbound)
+		{
+			if (ring->GetEventDescriptor() == descriptor)
+			{
+				CollectPackets(ring,RTPTime::CurrentTime());
+				status = 0;
+				break;
+			}
+		}
+	}
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPSharedMemoryTransmitter::SendRTPData(const void *data,size_t len)
+{
+	return SendData(data,len,true);
+}
+
+int RTPSharedMemoryTransmitter::SendRTCPData(const void *data,size_t len)
+{
+	return SendData(data,len,false);
+}
+
+int RTPSharedMemoryTransmitter::AddDestination(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPSharedMemoryTransmitter::DeleteDestination(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPSharedMemoryTransmitter::ClearDestinations()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (m_created)
+	{
+		for (auto ring : outbound)
+			ring->Release();
+		outbound.clear();
+	}
+	MAINMUTEX_UNLOCK
+}
+
+bool RTPSharedMemoryTransmitter::SupportsMulticasting()
+{
+	return false;
+}
+
+int RTPSharedMemoryTransmitter::JoinMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPSharedMemoryTransmitter::LeaveMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPSharedMemoryTransmitter::LeaveAllMulticastGroups()
+{
+}
+
+int RTPSharedMemoryTransmitter::SetReceiveMode(RTPTransmitter::ReceiveMode m)
+{
+	if (m != RTPTransmitter::AcceptAll)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	return 0;
+}
+
+int RTPSharedMemoryTransmitter::AddToIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPSharedMemoryTransmitter::DeleteFromIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPSharedMemoryTransmitter::ClearIgnoreList()
+{
+}
+
+int RTPSharedMemoryTransmitter::AddToAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPSharedMemoryTransmitter::DeleteFromAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPSharedMemoryTransmitter::ClearAcceptList()
+{
+}
+
+int RTPSharedMemoryTransmitter::SetMaximumPacketSize(size_t s)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (s > RTPSHMTRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	m_maxPackSize = s;
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPSharedMemoryTransmitter::NewDataAvailable()
+{
+	if (!m_init)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v;
+
+	if (!m_created)
+		v = false;
+	else
+		v = !m_rawpacketlist.empty();
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+RTPRawPacket *RTPSharedMemoryTransmitter::GetNextPacket()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+
+	RTPRawPacket *p;
+
+	if (!m_created || m_rawpacketlist.empty())
+	{
+		MAINMUTEX_UNLOCK
+		return 0;
+	}
+
+	p = m_rawpacketlist.front();
+	m_rawpacketlist.pop_front();
+
+	MAINMUTEX_UNLOCK
+	return p;
+}
+
+int RTPSharedMemoryTransmitter::AddOutboundRing(int memfd,int eventfd)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	RTPSharedMemoryRing *ring;
+	int status = RTPSharedMemoryRing::Attach(memfd,eventfd,&ring);
+
+	if (status >= 0)
+		outbound.push_back(ring);
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+uint64_t RTPSharedMemoryTransmitter::GetDroppedPackets()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	uint64_t v = dropped;
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+// 私有函数从这里开始...
+
+int RTPSharedMemoryTransmitter::SendData(const void *data,size_t len,bool rtp)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (len > m_maxPackSize)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	// 和UDP一样，接收端来不及处理时丢弃数据包而不是返回错误
+	for (auto ring : outbound)
+	{
+		int status = ring->Write(data,len,rtp,localid);
+
+		if (status == MEDIA_RTP_ERR_RESOURCE_ERROR)
+			dropped++;
+		else if (status < 0)
+		{
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_RESOURCE_ERROR;
+		}
+	}
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+void RTPSharedMemoryTransmitter::CollectPackets(RTPSharedMemoryRing *ring,const RTPTime &curtime)
+{
+	// 先清除信号再读取：之后写入的数据包会重新发出信号
+	ring->ClearSignal();
+
+	uint8_t *data;
+	size_t len;
+	bool rtp;
+	uint16_t sender;
+
+	while ((data = ring->Read(&len,&rtp,&sender)) != 0)
+	{
+		RTPEndpoint *source = new RTPEndpoint(INADDR_LOOPBACK,sender,sender);
+		RTPTime recvtime = curtime;
+		RTPRawPacket *pack = new RTPRawPacket(data,len,source,recvtime,rtp);
+
+		// 数据包直接引用槽位，删除时把槽位还给环
+		pack->SetDataReleaser(ring);
+		m_rawpacketlist.push_back(pack);
+	}
+}
+
+void RTPSharedMemoryTransmitter::ReleaseRings()
+{
+	for (auto ring : inbound)
+		ring->Release();
+	inbound.clear();
+	for (auto ring : outbound)
+		ring->Release();
+	outbound.clear();
+}
+
+void RTPSharedMemoryTransmitter::FlushPackets()
+{
+	std::list<RTPRawPacket*>::const_iterator it;
+
+	for (it = m_rawpacketlist.begin() ; it != m_rawpacketlist.end() ; ++it)
+		delete *it;
+	m_rawpacketlist.clear();
+}
@@ -0,0 +1,246 @@
+/**
+ * \file media_rtp_shm_transmitter.h
+ */
+
+#ifndef RTPSHMTRANSMITTER_H
+
+#define RTPSHMTRANSMITTER_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_transmitter.h"
+#include "media_rtp_abort_descriptors.h"
+#include "media_rtp_packet_factory.h"
+#include "media_rtp_utils.h"
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/** 在同一主机上从一个进程（生产者）向另一个进程（消费者）传递数据包的单向环形队列。
+ *  队列位于用 memfd_create 创建的匿名内存文件中，另有一个eventfd用于通知；两个描述符可以
+ *  通过 fork 继承或用 SCM_RIGHTS 传给另一个进程，双方各自调用 Attach 映射同一段内存。
+ *  生产者把数据包直接写入固定大小的槽位，消费者读取时得到指向槽位的指针，数据包释放之前
+ *  槽位不会被覆盖。槽位可以按任意顺序释放：生产者写入时跳过仍被持有的槽位，因此一个
+ *  长时间持有的数据包只占用它自己的槽位，其他槽位照常循环使用；只有所有已读出的槽位都被
+ *  持有、或消费者没有及时读取时环才会满。
+ *  只有消费者已经读完所有数据包时写入的数据包才写eventfd，持续有数据时收发两端都不需要系统调用。
+ *  每个环只能有一个生产者和一个消费者。
+ */
+class RTPSharedMemoryRing : public RTPDataReleaser
+{
+	MEDIA_RTP_NO_COPY(RTPSharedMemoryRing)
+public:
+	/** 创建一个有 \c slotcount 个槽位（向上取整为2的幂）的环，每个槽位可以容纳 \c slotsize 字节的数据包。
+	 *  成功时在 \c memfd 和 \c eventfd 中返回两个描述符，由调用者负责关闭。 */
+	static int Create(size_t slotcount,size_t slotsize,int *memfd,int *eventfd);
+
+	/** 映射由 \c memfd 和 \c eventfd 描述的环。函数复制这两个描述符，调用者可以随后关闭自己的描述符。
+	 *  成功时 \c ring 指向新的实例，实例用 Release 而不是 delete 释放。 */
+	static int Attach(int memfd,int eventfd,RTPSharedMemoryRing **ring);
+
+	/** 释放调用者的引用。消费者读出的数据包在释放之前也引用实例，最后一个引用释放时解除映射并关闭描述符。 */
+	void Release();
+
+	/** 返回映射的内存文件的描述符。 */
+	int GetMemoryDescriptor() const								{ return memfd; }
+
+	/** 返回用于通知消费者的eventfd。 */
+	int GetEventDescriptor() const								{ return eventfd; }
+
+	/** 返回一个槽位可以容纳的最大数据包大小。 */
+	size_t GetSlotSize() const								{ return slotsize; }
+
+	/** 返回因环已满而被生产者丢弃的数据包数量。 */
+	uint64_t GetDroppedPackets() const;
+
+	/** 生产者调用：把数据包复制到下一个槽位，\c sender 是生产者的标识。
+	 *  环已满时丢弃数据包并返回 MEDIA_RTP_ERR_RESOURCE_ERROR，数据包大于槽位时返回 MEDIA_RTP_ERR_INVALID_PARAMETER。 */
+	int Write(const void *data,size_t len,bool rtp,uint16_t sender);
+
+	/** 消费者调用：清除eventfd上的信号，应在用 Read 取出所有数据包之前调用。 */
+	void ClearSignal();
+
+	/** 消费者调用：返回下一个数据包在槽位中的数据，没有数据包时返回null。
+	 *  返回的数据必须用 ReleaseData 释放，通常把实例设置为 RTPRawPacket 的释放器。 */
+	uint8_t *Read(size_t *len,bool *rtp,uint16_t *sender);
+
+	/** 消费者调用：如果有尚未读取的数据包则返回 \c true。 */
+	bool HasData();
+
+	/** 释放由 Read 返回的数据包数据，可以在任意线程中调用。 */
+	void ReleaseData(uint8_t *data);
+private:
+	class Header;
+
+	RTPSharedMemoryRing();
+	~RTPSharedMemoryRing();
+
+	uint8_t *GetSlot(uint32_t pos) const							{ return slots+(size_t)(pos&mask)*stride; }
+
+	int memfd, eventfd;
+	uint8_t *mapping;
+	size_t mappingsize;
+	Header *header;
+	uint8_t *slots;
+	uint32_t mask;
+	size_t stride, slotsize;
+	std::atomic<int> refs;
+
+	uint32_t cachedreadpos; // 生产者的状态
+	uint32_t readpos, cachedtail; // 消费者的状态
+};
+
+/** 共享内存传输器的参数。 */
+class RTPSharedMemoryTransmissionParams : public RTPTransmissionParams
+{
+public:
+	RTPSharedMemoryTransmissionParams();
+
+	/** 添加一个接收数据包的环，描述符由 RTPSharedMemoryRing::Create 创建，传输器会复制它们。
+	 *  没有添加任何接收环时，传输器用 SetRingSize 指定的大小创建一个。 */
+	void AddInboundRing(int memfd,int eventfd)						{ inbound.push_back(std::make_pair(memfd,eventfd)); }
+
+	/** 添加一个发送数据包的环，即对端的接收环；发送的数据包写入所有发送环。 */
+	void AddOutboundRing(int memfd,int eventfd)						{ outbound.push_back(std::make_pair(memfd,eventfd)); }
+
+	/** 设置传输器自己创建的接收环的槽位数量和槽位大小。 */
+	void SetRingSize(size_t count,size_t size)						{ slotcount = count; slotsize = size; }
+
+	/** 设置写入每个发送的数据包中的标识，接收端的数据包源地址为127.0.0.1和这个值作为端口。
+	 *  为零（默认值）时由进程ID和进程内的计数器生成。 */
+	void SetLocalID(uint16_t id)								{ localid = id; }
+
+	/** 如果非空，将使用指定的中止描述符来取消等待数据包到达的函数；
+	 *  设置为null（默认值）让传输器创建自己的实例。 */
+	void SetCreatedAbortDescriptors(RTPAbortDescriptors *desc)				{ m_pAbortDesc = desc; }
+
+	const std::vector<std::pair<int,int> > &GetInboundRings() const				{ return inbound; }
+	const std::vector<std::pair<int,int> > &GetOutboundRings() const			{ return outbound; }
+	size_t GetSlotCount() const								{ return slotcount; }
+	size_t GetSlotSize() const								{ return slotsize; }
+	uint16_t GetLocalID() const								{ return localid; }
+	RTPAbortDescriptors *GetCreatedAbortDescriptors() const					{ return m_pAbortDesc; }
+private:
+	std::vector<std::pair<int,int> > inbound, outbound;
+	size_t slotcount, slotsize;
+	uint16_t localid;
+	RTPAbortDescriptors *m_pAbortDesc;
+};
+
+inline RTPSharedMemoryTransmissionParams::RTPSharedMemoryTransmissionParams() : RTPTransmissionParams(RTPTransmitter::SharedMemoryProto)
+{
+	slotcount = RTP_SHM_DEFAULTSLOTS;
+	slotsize = RTP_SHM_DEFAULTSLOTSIZE;
+	localid = 0;
+	m_pAbortDesc = 0;
+}
+
+/** 共享内存传输器的附加信息。 */
+class RTPSharedMemoryTransmissionInfo : public RTPTransmissionInfo
+{
+public:
+	RTPSharedMemoryTransmissionInfo(uint16_t id,const std::vector<std::pair<int,int> > &rings)
+		: RTPTransmissionInfo(RTPTransmitter::SharedMemoryProto), localid(id), inbound(rings)	{ }
+
+	/** 返回写入发送的数据包中的标识。 */
+	uint16_t GetLocalID() const								{ return localid; }
+
+	/** 返回接收环的内存文件描述符和eventfd，可以传给对端进程作为它的发送环。
+	 *  描述符属于传输器，不能关闭。 */
+	const std::vector<std::pair<int,int> > &GetInboundRings() const				{ return inbound; }
+private:
+	uint16_t localid;
+	std::vector<std::pair<int,int> > inbound;
+};
+
+#define RTPSHMTRANS_HEADERSIZE								8
+
+/** 通过共享内存中的环形队列在同一主机上的进程之间收发数据包的传输组件。
+ *  组件的参数由类 RTPSharedMemoryTransmissionParams 描述。发送时数据包被复制一次到每个发送环的槽位中，
+ *  接收到的 RTPRawPacket 直接指向接收环中的槽位，数据随 RTPPacket 或 RTCPCompoundPacket 一起保留到
+ *  它们被删除为止。应用程序持有的每个数据包占用一个槽位，发送端跳过这些槽位继续使用其余的槽位，
+ *  持有的数据包接近环的槽位数量时发送端丢弃新的数据包。
+ *  发送环就是传输器的目的地：AddDestination 不可用，ClearDestinations 释放所有发送环。
+ *  不支持多播和接受/忽略列表。
+ */
+class RTPSharedMemoryTransmitter : public RTPTransmitter
+{
+	MEDIA_RTP_NO_COPY(RTPSharedMemoryTransmitter)
+public:
+	RTPSharedMemoryTransmitter();
+	~RTPSharedMemoryTransmitter();
+
+	int Init(bool treadsafe);
+	int Create(size_t maxpacksize,const RTPTransmissionParams *transparams);
+	void Destroy();
+	RTPTransmissionInfo *GetTransmissionInfo();
+	void DeleteTransmissionInfo(RTPTransmissionInfo *inf);
+
+	int GetLocalHostName(uint8_t *buffer,size_t *bufferlength);
+	bool ComesFromThisTransmitter(const RTPEndpoint *addr);
+	size_t GetHeaderOverhead()								{ return RTPSHMTRANS_HEADERSIZE; }
+
+	int Poll();
+	int WaitForIncomingData(const RTPTime &delay,bool *dataavailable = 0);
+	int AbortWait();
+	int GetReceiveDescriptors(std::vector<int> &descriptors);
+	int GetAbortDescriptor(int *descriptor);
+	int PollDescriptor(int descriptor);
+
+	int SendRTPData(const void *data,size_t len);
+	int SendRTCPData(const void *data,size_t len);
+
+	int AddDestination(const RTPEndpoint &addr);
+	int DeleteDestination(const RTPEndpoint &addr);
+	void ClearDestinations();
+
+	bool SupportsMulticasting();
+	int JoinMulticastGroup(const RTPEndpoint &addr);
+	int LeaveMulticastGroup(const RTPEndpoint &addr);
+	void LeaveAllMulticastGroups();
+
+	int SetReceiveMode(RTPTransmitter::ReceiveMode m);
+	int AddToIgnoreList(const RTPEndpoint &addr);
+	int DeleteFromIgnoreList(const RTPEndpoint &addr);
+	void ClearIgnoreList();
+	int AddToAcceptList(const RTPEndpoint &addr);
+	int DeleteFromAcceptList(const RTPEndpoint &addr);
+	void ClearAcceptList();
+	int SetMaximumPacketSize(size_t s);
+
+	bool NewDataAvailable();
+	RTPRawPacket *GetNextPacket();
+
+	/** 在创建之后添加一个发送环，例如对端的描述符通过 SCM_RIGHTS 到达时。 */
+	int AddOutboundRing(int memfd,int eventfd);
+
+	/** 返回因对端的接收环已满而丢弃的已发送数据包数量。 */
+	uint64_t GetDroppedPackets();
+private:
+	int SendData(const void *data,size_t len,bool rtp);
+	void CollectPackets(RTPSharedMemoryRing *ring,const RTPTime &curtime);
+	void ReleaseRings();
+	void FlushPackets();
+
+	bool m_init;
+	bool m_created;
+	bool m_waitingForData;
+
+	uint16_t localid;
+	size_t m_maxPackSize;
+	uint64_t dropped;
+
+	std::vector<RTPSharedMemoryRing *> inbound, outbound;
+	std::list<RTPRawPacket *> m_rawpacketlist;
+
+	RTPAbortDescriptors m_abortDesc;
+	RTPAbortDescriptors *m_pAbortDesc; // 如果指定了外部描述符
+
+	std::mutex m_mainMutex, m_waitMutex;
+	bool m_threadsafe;
+};
+
+#endif // RTPSHMTRANSMITTER_H
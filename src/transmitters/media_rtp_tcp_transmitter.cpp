@@ -230,6 +230,9 @@ int RTPTCPTransmitter::Poll()
 
 	vector<int> errSockets;
 
+	// 这一轮读取的数据包共用一次时钟读取
+	RTPTimeBatch timebatch;
+
 	while (it != end)
 	{
 		int sock = it->first;
@@ -372,6 +375,86 @@ int RTPTCPTransmitter::AbortWait()
 	return 0;
 }
 
+int RTPTCPTransmitter::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	std::map<int, SocketData>::const_iterator it = m_destSockets.begin();
+	std::map<int, SocketData>::const_iterator end = m_destSockets.end();
+
+	while (it != end)
+	{
+		descriptors.push_back(it->first);
+		++it;
+	}
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPTCPTransmitter::GetAbortDescriptor(int *descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	*descriptor = m_pAbortDesc->GetAbortSocket();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPTCPTransmitter::PollDescriptor(int descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	if (descriptor == m_pAbortDesc->GetAbortSocket())
+	{
+		m_pAbortDesc->ReadSignallingByte();
+		MAINMUTEX_UNLOCK
+		return 0;
+	}
+
+	std::map<int, SocketData>::iterator it = m_destSockets.find(descriptor);
+	if (it == m_destSockets.end())
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	RTPTimeBatch timebatch;
+	int status = PollSocket(descriptor, it->second);
+	MAINMUTEX_UNLOCK
+
+	// 与 Poll 相同，连接出错不作为错误返回
+	if (status < 0 && status != MEDIA_RTP_ERR_RESOURCE_ERROR)
+	{
+		OnReceiveError(descriptor);
+		status = 0;
+	}
+	return status;
+}
+
 int RTPTCPTransmitter::SendRTPData(const void *data,size_t len)	
 {
 	return SendRTPRTCPData(data, len);
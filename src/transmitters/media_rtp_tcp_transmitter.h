@@ -85,6 +85,9 @@ public:
 	int Poll();
 	int WaitForIncomingData(const RTPTime &delay,bool *dataavailable = 0);
 	int AbortWait();
+	int GetReceiveDescriptors(std::vector<int> &descriptors);
+	int GetAbortDescriptor(int *descriptor);
+	int PollDescriptor(int descriptor);
 	
 	int SendRTPData(const void *data,size_t len);	
 	int SendRTCPData(const void *data,size_t len);
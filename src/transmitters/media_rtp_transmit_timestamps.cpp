@@ -0,0 +1,90 @@
+#include "media_rtp_transmit_timestamps.h"
+#include "media_rtp_errors.h"
+#include <string.h>
+
+RTPTransmitTimestamps::RTPTransmitTimestamps()
+{
+	Reset();
+}
+
+int RTPTransmitTimestamps::Enable(int sock)
+{
+	int status;
+
+	Reset();
+	if ((status = RTPEnableTransmitTimestamps(sock)) < 0)
+		return status;
+	enabled = true;
+	return 0;
+}
+
+void RTPTransmitTimestamps::Reset()
+{
+	enabled = false;
+	nextkey = 0;
+	memset(history,0,sizeof(history));
+	timestamps.clear();
+}
+
+void RTPTransmitTimestamps::OnSent(const void *data,size_t len,bool record)
+{
+	if (!enabled)
+		return;
+
+	SentDatagram &d = history[nextkey%RTP_TXTIMESTAMP_HISTORYSIZE];
+	const uint8_t *p = (const uint8_t *)data;
+
+	d.key = nextkey++;
+	d.record = false;
+	if (record && len >= 12 && (p[0]>>6) == 2)
+	{
+		d.rtptimestamp = ((uint32_t)p[4]<<24)|((uint32_t)p[5]<<16)|((uint32_t)p[6]<<8)|(uint32_t)p[7];
+		d.ssrc = ((uint32_t)p[8]<<24)|((uint32_t)p[9]<<16)|((uint32_t)p[10]<<8)|(uint32_t)p[11];
+		d.record = true;
+	}
+}
+
+int RTPTransmitTimestamps::Poll(int sock)
+{
+	if (!enabled)
+		return 0;
+
+	uint32_t key;
+	RTPTime sendtime(0);
+	int status;
+
+	while ((status = RTPReadTransmitTimestamp(sock,&key,&sendtime)) > 0)
+	{
+		SentDatagram &d = history[key%RTP_TXTIMESTAMP_HISTORYSIZE];
+
+		// 时间戳来得太晚，对应的记录已被覆盖
+		if (d.key != key || !d.record)
+			continue;
+		d.record = false;
+
+		if (timestamps.size() >= RTP_TXTIMESTAMP_MAXPENDING)
+			timestamps.pop_front();
+
+		Timestamp t;
+
+		t.ssrc = d.ssrc;
+		t.rtptimestamp = d.rtptimestamp;
+		t.sendtime = sendtime;
+		timestamps.push_back(t);
+	}
+	return status;
+}
+
+bool RTPTransmitTimestamps::GetNext(uint32_t *ssrc,uint32_t *rtptimestamp,RTPTime *sendtime)
+{
+	if (timestamps.empty())
+		return false;
+
+	const Timestamp &t = timestamps.front();
+
+	*ssrc = t.ssrc;
+	*rtptimestamp = t.rtptimestamp;
+	*sendtime = t.sendtime;
+	timestamps.pop_front();
+	return true;
+}
@@ -0,0 +1,71 @@
+/**
+ * \file media_rtp_transmit_timestamps.h
+ */
+
+#ifndef RTPTRANSMITTIMESTAMPS_H
+
+#define RTPTRANSMITTIMESTAMPS_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_utils.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+
+/** 收集UDP传输器所发送的RTP数据包的内核发送时间戳。
+ *  内核按socket上发送的数据报依次编号，传输器在每次发送成功后调用 OnSent，本类据此将
+ *  错误队列中的时间戳对应到RTP数据包，并保留该数据包RTP头中的SSRC和时间戳。
+ *  最近 RTP_TXTIMESTAMP_HISTORYSIZE 个数据报的信息保存在固定大小的数组中，
+ *  尚未取走的时间戳最多保留 RTP_TXTIMESTAMP_MAXPENDING 个。
+ */
+class RTPTransmitTimestamps
+{
+public:
+	/** 构造一个未启用的实例。 */
+	RTPTransmitTimestamps();
+
+	/** 在 \c sock 上启用发送时间戳，系统不支持时返回负值。 */
+	int Enable(int sock);
+
+	/** 停用并清除所有记录。 */
+	void Reset();
+
+	/** 如果已启用则返回 \c true。 */
+	bool IsEnabled() const									{ return enabled; }
+
+	/** 在socket上成功发送了长度为 \c len 的数据报 \c data 后调用；只有 \c record 为 \c true
+	 *  的RTP数据包的发送时间会被保存。
+	 */
+	void OnSent(const void *data,size_t len,bool record);
+
+	/** 读取 \c sock 错误队列中的所有发送时间戳。 */
+	int Poll(int sock);
+
+	/** 取出最早的一个发送时间戳，没有时返回 \c false。 */
+	bool GetNext(uint32_t *ssrc,uint32_t *rtptimestamp,RTPTime *sendtime);
+private:
+	class SentDatagram
+	{
+	public:
+		uint32_t key;
+		uint32_t ssrc;
+		uint32_t rtptimestamp;
+		bool record;
+	};
+
+	class Timestamp
+	{
+	public:
+		uint32_t ssrc;
+		uint32_t rtptimestamp;
+		RTPTime sendtime;
+	};
+
+	bool enabled;
+	uint32_t nextkey;
+	SentDatagram history[RTP_TXTIMESTAMP_HISTORYSIZE];
+	std::deque<Timestamp> timestamps;
+};
+
+#endif // RTPTRANSMITTIMESTAMPS_H
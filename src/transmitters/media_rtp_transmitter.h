@@ -7,8 +7,11 @@
 #define RTPTRANSMITTER_H
 
 #include "media_rtp_utils.h"
+#include "media_rtp_errors.h"
 #include "rtpconfig.h"
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 class RTPRawPacket;
 class RTPEndpoint;
@@ -19,7 +22,8 @@ class RTPTransmissionInfo;
 /** 实际传输组件应该继承的抽象类。
  *  实际传输组件应该继承的抽象类。
  *  抽象类 RTPTransmitter 指定了实际传输组件的接口。
- *  目前存在三种实现：IPv4 UDP 传输器、IPv6 UDP 传输器和 TCP 传输器。
+ *  目前存在七种实现：IPv4 UDP 传输器、IPv6 UDP 传输器、TCP 传输器、进程内的回环传输器、
+ *  同一主机上进程之间的共享内存传输器、Unix 域数据报传输器和多个会话共享端口的 UDP 传输器。
  */
 class RTPTransmitter {
 public:
@@ -28,9 +32,13 @@ public:
    *  虚成员函数 NewUserDefinedTransmitter 来创建传输组件。
    */
   enum TransmissionProtocol {
-    IPv4UDPProto, /**< 指定内部 IPv4 UDP 传输器。 */
-    IPv6UDPProto, /**< 指定内部 IPv6 UDP 传输器。 */
-    TCPProto      /**< 指定内部 TCP 传输器。 */
+    IPv4UDPProto,      /**< 指定内部 IPv4 UDP 传输器。 */
+    IPv6UDPProto,      /**< 指定内部 IPv6 UDP 传输器。 */
+    TCPProto,          /**< 指定内部 TCP 传输器。 */
+    LoopbackProto,     /**< 指定进程内的回环传输器。 */
+    SharedMemoryProto, /**< 指定同一主机上进程之间的共享内存传输器。 */
+    UnixProto,         /**< 指定 Unix 域数据报传输器。 */
+    BundleProto        /**< 指定多个会话共享一个 UDP 端口的传输器。 */
   };
 
   /** 可以指定三种接收模式。 */
@@ -174,6 +182,60 @@ public:
   /** 在 RTPRawPacket 实例中返回接收到的 RTP 数据包的原始数据
    *  （在 Poll 函数期间接收）。 */
   virtual RTPRawPacket *GetNextPacket() = 0;
+
+  /** 取出一个RTP数据包的内核发送时间戳。
+   *  启用了发送时间戳的传输器在 Poll 期间收集数据包实际发出的时间 \c sendtime，
+   *  \c ssrc 和 \c rtptimestamp 取自该数据包的RTP头。没有可用的时间戳时返回 \c false；
+   *  默认实现不支持发送时间戳。
+   */
+  virtual bool GetNextTransmitTimestamp(uint32_t *ssrc, uint32_t *rtptimestamp,
+                                        RTPTime *sendtime) {
+    MEDIA_RTP_UNUSED(ssrc);
+    MEDIA_RTP_UNUSED(rtptimestamp);
+    MEDIA_RTP_UNUSED(sendtime);
+    return false;
+  }
+
+  /** 把有数据到达时会变为可读的描述符追加到 \c descriptors。
+   *  应用程序可以在自己的事件循环中等待这些描述符，而不是调用 WaitForIncomingData，
+   *  描述符可读后调用 Poll 读取数据；描述符可能随目的地址的变化而改变，
+   *  所以每次等待之前都应重新获取。默认实现不支持。
+   */
+  virtual int GetReceiveDescriptors(std::vector<int> &descriptors) {
+    MEDIA_RTP_UNUSED(descriptors);
+    return MEDIA_RTP_ERR_OPERATION_FAILED;
+  }
+
+  /** 把调用 AbortWait 后会变为可读的描述符存入 \c descriptor，
+   *  外部事件循环可以借此被其他线程唤醒。默认实现不支持。
+   */
+  virtual int GetAbortDescriptor(int *descriptor) {
+    MEDIA_RTP_UNUSED(descriptor);
+    return MEDIA_RTP_ERR_OPERATION_FAILED;
+  }
+
+  /** 只读取描述符 \c descriptor 上已到达的数据，\c descriptor 是 GetReceiveDescriptors
+   *  或 GetAbortDescriptor 给出的描述符；对中止描述符则清除中止信号。
+   *  默认实现调用 Poll 读取所有套接字。
+   */
+  virtual int PollDescriptor(int descriptor) {
+    MEDIA_RTP_UNUSED(descriptor);
+    return Poll();
+  }
+
+  /** 把由长度为 \c headerlen 的 \c header 和长度为 \c payloadlen 的 \c payload
+   *  两部分组成的 RTP 数据包发送到当前目标列表的所有 RTP 地址。
+   *  支持分散/聚集发送的传输器直接从两个缓冲区发送，负载不会被复制；
+   *  默认实现先把两部分复制到一个缓冲区，再调用 SendRTPData。
+   */
+  virtual int SendRTPDataV(const void *header, size_t headerlen,
+                           const void *payload, size_t payloadlen) {
+    std::vector<uint8_t> packet(headerlen + payloadlen);
+    memcpy(packet.data(), header, headerlen);
+    if (payloadlen > 0)
+      memcpy(packet.data() + headerlen, payload, payloadlen);
+    return SendRTPData(packet.data(), packet.size());
+  }
 };
 
 /** 传输参数的基类。
@@ -5,6 +5,7 @@
 #include "media_rtp_structs.h"
 #include "media_rtp_errors.h"
 #include <stdio.h>
+#include <sys/uio.h>
 #include <assert.h>
 #include <vector>
 
@@ -26,6 +27,8 @@
 	#define MAINMUTEX_UNLOCK	{ if (threadsafe) mainmutex.unlock(); }
 	#define WAITMUTEX_LOCK		{ if (threadsafe) waitmutex.lock(); }
 	#define WAITMUTEX_UNLOCK	{ if (threadsafe) waitmutex.unlock(); }
+	#define RECEIVEMUTEX_LOCK	{ if (threadsafe) receivemutex.lock(); }
+	#define RECEIVEMUTEX_UNLOCK	{ if (threadsafe) receivemutex.unlock(); }
 
 #define CLOSESOCKETS do { \
 	if (closesocketswhendone) \
@@ -37,9 +40,10 @@
 } while(0)
 		
 
-RTPUDPv4Transmitter::RTPUDPv4Transmitter() : RTPTransmitter()
+RTPUDPv4Transmitter::RTPUDPv4Transmitter() : RTPTransmitter(), packetring(RTP_UDP_MAXQUEUE)
 {
 	created = false;
+	bufferpool = 0;
 	init = false;
 }
 
@@ -252,6 +256,25 @@ int RTPUDPv4Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 		params = (const RTPUDPv4TransmissionParams *)transparams;
 	}
 
+	// 多个接收线程需要由传输器自己在固定端口上创建重用端口组
+	int numshards = params->GetReceiveShards();
+	int dummysock;
+
+	if (numshards < 1 || (numshards > 1 && (params->GetPortbase() == 0 || params->GetUseExistingSockets(dummysock, dummysock))))
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	// 接收线程直接读取套接字，不能再通过 io_uring 接收
+	RTPIoUring *ring = params->GetIoUring();
+
+	if (ring != 0 && numshards > 1)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
 	if (params->GetUseExistingSockets(rtpsock, rtcpsock))
 	{
 		closesocketswhendone = false;
@@ -302,6 +325,19 @@ int RTPUDPv4Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 				return MEDIA_RTP_ERR_OPERATION_FAILED;
 			}
 
+			// 重用端口组中的每个套接字都必须在绑定之前设置 SO_REUSEPORT
+			if (numshards > 1)
+			{
+				int on = 1;
+
+				if (setsockopt(rtpsock,SOL_SOCKET,SO_REUSEPORT,(const char *)&on,sizeof(int)) != 0)
+				{
+					RTPCLOSE(rtpsock);
+					MAINMUTEX_UNLOCK
+					return MEDIA_RTP_ERR_OPERATION_FAILED;
+				}
+			}
+
 			// 如果我们进行多路复用，我们只需将 RTCP 套接字设置为等于 RTP 套接字
 			if (params->GetRTCPMultiplexing())
 				rtcpsock = rtpsock;
@@ -456,6 +492,52 @@ int RTPUDPv4Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 	mcastifaceIP = params->GetMulticastInterfaceIP();
 	receivemode = RTPTransmitter::AcceptAll;
 
+	// 启用内核接收时间戳，失败时退回到轮询时读取当前时间
+
+	kerneltimestamps = false;
+	if (params->GetUseKernelReceiveTimestamps())
+	{
+		if (RTPEnableReceiveTimestamps(rtpsock) >= 0)
+		{
+			kerneltimestamps = true;
+			if (rtpsock != rtcpsock && RTPEnableReceiveTimestamps(rtcpsock) < 0)
+				kerneltimestamps = false;
+		}
+	}
+
+	// 没有提供池时使用自己的池，所以收到的数据包总是存放在引用计数缓冲区中
+	bufferpool = params->GetPacketBufferPool();
+	if (bufferpool != 0)
+		bufferpool->AddReference();
+	else
+		bufferpool = RTPPacketBufferPool::Create(RTP_PACKETBUFFER_DEFAULTSIZE,RTP_PACKETBUFFER_TRANSMITTERMAXFREE);
+
+	shardmulticast = false;
+	if (numshards > 1)
+	{
+		if ((status = CreateReceiveShards(params)) < 0)
+		{
+			bufferpool->Release();
+			bufferpool = 0;
+			m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+			CLOSESOCKETS;
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+	}
+
+	// 环不可用时继续使用普通的套接字调用
+	iouring = 0;
+	if (ring != 0 && ring->IsInitialized())
+		CreateIoUring(ring);
+
+	// 发送时间戳只在RTP套接字上收集；使用接收线程或 io_uring 时RTP套接字不在 Poll 中读取，
+	// 发送也不是同步完成的，所以不收集
+
+	txtimestamps.Reset();
+	if (params->GetUseKernelTransmitTimestamps() && numshards == 1 && iouring == 0)
+		txtimestamps.Enable(rtpsock);
+
 	localhostname = 0;
 	localhostnamelength = 0;
 
@@ -484,12 +566,16 @@ void RTPUDPv4Transmitter::Destroy()
 		localhostnamelength = 0;
 	}
 	
+	DestroyReceiveShards(); // 必须在关闭套接字之前停止接收线程
+	DestroyIoUring(); // 同样必须在关闭套接字之前取消接收请求
 	CLOSESOCKETS;
 	destinations.clear();
 #ifdef RTP_SUPPORT_IPV4MULTICAST
 	multicastgroups.clear();
 #endif // RTP_SUPPORT_IPV4MULTICAST
 	FlushPackets();
+	bufferpool->Release(); // 应用程序仍持有的数据包释放之后池才被删除
+	bufferpool = 0;
 	ClearAcceptIgnoreInfo();
 	localIPs.clear();
 	created = false;
@@ -718,7 +804,19 @@ int RTPUDPv4Transmitter::Poll()
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	status = PollSocket(true); // 轮询 RTP 套接字
+	RTPTimeBatch timebatch; // 这一轮读取的数据包共用一次时钟读取
+
+	status = 0;
+	if (iouring != 0)
+	{
+		status = PollIoUring(); // 两个套接字的数据报都由环接收
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+	if (receiveshards.IsRunning())
+		PollReceiveShards(); // RTP 套接字由接收线程读取
+	else
+		status = PollSocket(true); // 轮询 RTP 套接字
 	if (rtpsock != rtcpsock) // 多路复用时无需轮询两次
 	{
 		if (status >= 0)
@@ -748,7 +846,18 @@ int RTPUDPv4Transmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavai
 	
 	int abortSocket = m_pAbortDesc->GetAbortSocket();
 
-	int socks[3] = { rtpsock, rtcpsock, abortSocket };
+	// 使用接收线程时等待它们的就绪信号，而不是直接等待 RTP 套接字；使用 io_uring 时
+	// 等待环的完成线程为这两个套接字发出的就绪信号
+	int datasock = (receiveshards.IsRunning()) ? receiveshards.GetReadySocket() : rtpsock;
+	int rtcpdatasock = (rtpsock != rtcpsock) ? rtcpsock : datasock;
+
+	if (iouring != 0)
+	{
+		datasock = rtpreadydesc;
+		rtcpdatasock = rtcpreadydesc;
+	}
+
+	int socks[3] = { datasock, rtcpdatasock, abortSocket };
 	int8_t readflags[3] = { 0, 0, 0 };
 	const int idxRTP = 0;
 	const int idxRTCP = 1;
@@ -836,9 +945,69 @@ int RTPUDPv4Transmitter::SendRTPData(const void *data,size_t len)
 		return MEDIA_RTP_ERR_RESOURCE_ERROR;
 	}
 	
+	if (iouring != 0)
+	{
+		int status = SendThroughIoUring(rtpsock,data,len,true);
+
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
+	bool first = true;
+	for (const auto& dest : destinations)
+	{
+		if (sendto(rtpsock,(const char *)data,len,0,dest.GetRtpSockAddr(),dest.GetSockAddrLen()) >= 0)
+			txtimestamps.OnSent(data,len,first); // 只记录发往第一个目的地址的数据包的发送时间
+		first = false;
+	}
+	
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUDPv4Transmitter::SendRTPDataV(const void *header,size_t headerlen,const void *payload,size_t payloadlen)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	
+	if (!created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (headerlen+payloadlen > maxpacksize)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	if (iouring != 0)
+	{
+		// 提交队列保存的是连续的缓冲区，由基类合并两部分
+		MAINMUTEX_UNLOCK
+		return RTPTransmitter::SendRTPDataV(header,headerlen,payload,payloadlen);
+	}
+
+	struct iovec iov[2];
+	struct msghdr msg;
+
+	iov[0].iov_base = const_cast<void *>(header);
+	iov[0].iov_len = headerlen;
+	iov[1].iov_base = const_cast<void *>(payload);
+	iov[1].iov_len = payloadlen;
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = (payloadlen > 0) ? 2 : 1;
+
+	bool first = true;
 	for (const auto& dest : destinations)
 	{
-		sendto(rtpsock,(const char *)data,len,0,dest.GetRtpSockAddr(),dest.GetSockAddrLen());
+		msg.msg_name = const_cast<struct sockaddr *>(dest.GetRtpSockAddr());
+		msg.msg_namelen = dest.GetSockAddrLen();
+		if (sendmsg(rtpsock,&msg,0) >= 0)
+			txtimestamps.OnSent(header,headerlen+payloadlen,first); // 时间戳和SSRC都在头部中
+		first = false;
 	}
 	
 	MAINMUTEX_UNLOCK
@@ -863,9 +1032,18 @@ int RTPUDPv4Transmitter::SendRTCPData(const void *data,size_t len)
 		return MEDIA_RTP_ERR_RESOURCE_ERROR;
 	}
 	
+	if (iouring != 0)
+	{
+		int status = SendThroughIoUring(rtcpsock,data,len,false);
+
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
 	for (const auto& dest : destinations)
 	{
-		sendto(rtcpsock,(const char *)data,len,0,dest.GetRtcpSockAddr(),dest.GetSockAddrLen());
+		if (sendto(rtcpsock,(const char *)data,len,0,dest.GetRtcpSockAddr(),dest.GetSockAddrLen()) >= 0 && rtcpsock == rtpsock)
+			txtimestamps.OnSent(data,len,false); // 多路复用时RTCP数据包也占用发送时间戳的编号
 	}
 	
 	MAINMUTEX_UNLOCK
@@ -994,11 +1172,26 @@ int RTPUDPv4Transmitter::JoinMulticastGroup(const RTPEndpoint &addr)
 			return MEDIA_RTP_ERR_OPERATION_FAILED;
 		}
 
+		// 接收线程的套接字按SSRC过滤，都加入多播组时每个数据包只被其中一个保留
+		for (size_t i = 0 ; shardmulticast && i < shardsockets.size() ; i++)
+		{
+			RTPUDPV4TRANS_MCASTMEMBERSHIP(shardsockets[i],IP_ADD_MEMBERSHIP,mcastIP,status);
+			if (status != 0)
+			{
+				DropShardMemberships(mcastIP);
+				RTPUDPV4TRANS_MCASTMEMBERSHIP(rtpsock,IP_DROP_MEMBERSHIP,mcastIP,status);
+				multicastgroups.erase(mcastIP);
+				MAINMUTEX_UNLOCK
+				return MEDIA_RTP_ERR_OPERATION_FAILED;
+			}
+		}
+
 		if (rtpsock != rtcpsock) // 多路复用时无需加入多播组两次
 		{
 			RTPUDPV4TRANS_MCASTMEMBERSHIP(rtcpsock,IP_ADD_MEMBERSHIP,mcastIP,status);
 			if (status != 0)
 			{
+				DropShardMemberships(mcastIP);
 				RTPUDPV4TRANS_MCASTMEMBERSHIP(rtpsock,IP_DROP_MEMBERSHIP,mcastIP,status);
 				multicastgroups.erase(mcastIP);
 				MAINMUTEX_UNLOCK
@@ -1043,6 +1236,7 @@ int RTPUDPv4Transmitter::LeaveMulticastGroup(const RTPEndpoint &addr)
 	if (status >= 0)
 	{	
 		RTPUDPV4TRANS_MCASTMEMBERSHIP(rtpsock,IP_DROP_MEMBERSHIP,mcastIP,status);
+		DropShardMemberships(mcastIP);
 		if (rtpsock != rtcpsock) // 多路复用时无需离开多播组两次
 			RTPUDPV4TRANS_MCASTMEMBERSHIP(rtcpsock,IP_DROP_MEMBERSHIP,mcastIP,status);
 
@@ -1066,6 +1260,7 @@ void RTPUDPv4Transmitter::LeaveAllMulticastGroups()
 			int status = 0;
 			
 			RTPUDPV4TRANS_MCASTMEMBERSHIP(rtpsock,IP_DROP_MEMBERSHIP,mcastIP,status);
+			DropShardMemberships(mcastIP);
 			if (rtpsock != rtcpsock) // 多路复用时无需离开多播组两次
 				RTPUDPV4TRANS_MCASTMEMBERSHIP(rtcpsock,IP_DROP_MEMBERSHIP,mcastIP,status);
 			MEDIA_RTP_UNUSED(status);
@@ -1075,6 +1270,21 @@ void RTPUDPv4Transmitter::LeaveAllMulticastGroups()
 	MAINMUTEX_UNLOCK
 }
 
+void RTPUDPv4Transmitter::DropShardMemberships(uint32_t mcastIP)
+{
+	if (!shardmulticast)
+		return;
+
+	// 还没有加入的套接字上离开多播组会失败，忽略错误
+	for (size_t i = 0 ; i < shardsockets.size() ; i++)
+	{
+		int status = 0;
+
+		RTPUDPV4TRANS_MCASTMEMBERSHIP(shardsockets[i],IP_DROP_MEMBERSHIP,mcastIP,status);
+		MEDIA_RTP_UNUSED(status);
+	}
+}
+
 #else // 无多播支持
 
 int RTPUDPv4Transmitter::JoinMulticastGroup(const RTPEndpoint &addr)
@@ -1285,49 +1495,124 @@ bool RTPUDPv4Transmitter::NewDataAvailable()
 	if (!init)
 		return false;
 	
-	MAINMUTEX_LOCK
+	// 只读取队列的下标，不需要等待正在读取套接字的 Poll
+	return (packetring.GetSize() > 0);
+}
+
+RTPRawPacket *RTPUDPv4Transmitter::GetNextPacket()
+{
+	if (!init)
+		return 0;
 	
-	bool v;
-		
+	// 队列只有一个消费者，接收互斥锁使多个线程取数据包时依次进行；销毁后队列为空
+	RECEIVEMUTEX_LOCK
+	RTPRawPacket *p = packetring.Pop();
+	RECEIVEMUTEX_UNLOCK
+	return p;
+}
+
+bool RTPUDPv4Transmitter::GetNextTransmitTimestamp(uint32_t *ssrc,uint32_t *rtptimestamp,RTPTime *sendtime)
+{
+	if (!init)
+		return false;
+
+	MAINMUTEX_LOCK
+
 	if (!created)
-		v = false;
+	{
+		MAINMUTEX_UNLOCK
+		return false;
+	}
+
+	bool r = txtimestamps.GetNext(ssrc,rtptimestamp,sendtime);
+
+	MAINMUTEX_UNLOCK
+	return r;
+}
+
+int RTPUDPv4Transmitter::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 使用接收线程时 RTP 套接字由线程读取，等待它们的就绪信号
+	if (iouring != 0)
+	{
+		descriptors.push_back(rtpreadydesc);
+		if (rtpsock != rtcpsock)
+			descriptors.push_back(rtcpreadydesc);
+	}
 	else
 	{
-		if (rawpacketlist.empty())
-			v = false;
+		if (receiveshards.IsRunning())
+			descriptors.push_back(receiveshards.GetReadySocket());
 		else
-			v = true;
+			descriptors.push_back(rtpsock);
+		if (rtpsock != rtcpsock)
+			descriptors.push_back(rtcpsock);
 	}
-	
+
 	MAINMUTEX_UNLOCK
-	return v;
+	return 0;
 }
 
-RTPRawPacket *RTPUDPv4Transmitter::GetNextPacket()
+int RTPUDPv4Transmitter::GetAbortDescriptor(int *descriptor)
 {
 	if (!init)
-		return 0;
-	
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
 	MAINMUTEX_LOCK
-	
-	RTPRawPacket *p;
-	
 	if (!created)
 	{
 		MAINMUTEX_UNLOCK
-		return 0;
+		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (rawpacketlist.empty())
+	*descriptor = m_pAbortDesc->GetAbortSocket();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUDPv4Transmitter::PollDescriptor(int descriptor)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status = 0;
+
+	MAINMUTEX_LOCK
+	if (!created)
 	{
 		MAINMUTEX_UNLOCK
-		return 0;
+		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
+	RTPTimeBatch timebatch;
 
-	p = *(rawpacketlist.begin());
-	rawpacketlist.pop_front();
-
+	if (descriptor == m_pAbortDesc->GetAbortSocket())
+		m_pAbortDesc->ReadSignallingByte();
+	else if (iouring != 0)
+	{
+		if (descriptor == rtpreadydesc || descriptor == rtcpreadydesc)
+			status = PollIoUring();
+		else
+			status = MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+	else if (receiveshards.IsRunning() && descriptor == receiveshards.GetReadySocket())
+		PollReceiveShards();
+	else if (descriptor == rtpsock && !receiveshards.IsRunning())
+		status = PollSocket(true); // 多路复用时也包含 RTCP 数据
+	else if (descriptor == rtcpsock && rtpsock != rtcpsock)
+		status = PollSocket(false);
+	else
+		status = MEDIA_RTP_ERR_INVALID_PARAMETER;
 	MAINMUTEX_UNLOCK
-	return p;
+	return status;
 }
 
 // 私有函数从这里开始...
@@ -1354,11 +1639,12 @@ bool RTPUDPv4Transmitter::SetMulticastTTL(uint8_t ttl)
 
 void RTPUDPv4Transmitter::FlushPackets()
 {
-	std::list<RTPRawPacket*>::const_iterator it;
+	RTPRawPacket *pack;
 
-	for (it = rawpacketlist.begin() ; it != rawpacketlist.end() ; ++it)
-		delete *it;
-	rawpacketlist.clear();
+	RECEIVEMUTEX_LOCK
+	while ((pack = packetring.Pop()) != 0)
+		delete pack;
+	RECEIVEMUTEX_UNLOCK
 }
 
 int RTPUDPv4Transmitter::PollSocket(bool rtp)
@@ -1376,8 +1662,21 @@ int RTPUDPv4Transmitter::PollSocket(bool rtp)
 	else
 		sock = rtcpsock;
 	
+	// 错误队列中的发送时间戳也会使select报告套接字可读，所以先取走它们，
+	// 并以非阻塞方式读取数据
+	int recvflags = 0;
+	if (rtp && txtimestamps.IsEnabled())
+		recvflags = MSG_DONTWAIT;
+
 	do
 	{
+		if (recvflags != 0)
+			txtimestamps.Poll(sock);
+
+		// 队列已满时把剩下的数据报留在套接字中，套接字保持可读，下一次 Poll 继续读取
+		if (packetring.IsFull())
+			break;
+
 		len = 0;
 		RTPIOCTL(sock,FIONREAD,&len);
 
@@ -1402,9 +1701,9 @@ int RTPUDPv4Transmitter::PollSocket(bool rtp)
 		
 		if (dataavailable)
 		{
-			RTPTime curtime = RTPTime::CurrentTime();
+			RTPTime curtime(0);
 			fromlen = sizeof(struct sockaddr_in);
-			recvlen = recvfrom(sock,packetbuffer,RTPUDPV4TRANS_MAXPACKSIZE,0,(struct sockaddr *)&srcaddr,&fromlen);
+			recvlen = RTPReceiveFrom(sock,packetbuffer,RTPUDPV4TRANS_MAXPACKSIZE,recvflags,(struct sockaddr *)&srcaddr,&fromlen,kerneltimestamps,&curtime);
 			if (recvlen > 0)
 			{
 				bool acceptdata;
@@ -1420,16 +1719,13 @@ int RTPUDPv4Transmitter::PollSocket(bool rtp)
 					RTPRawPacket *pack;
 					RTPEndpoint *addr;
 					uint8_t *datacopy;
+					RTPPacketBuffer *buf;
 
 					addr = new RTPEndpoint(ntohl(srcaddr.sin_addr.s_addr),ntohs(srcaddr.sin_port));
 					if (addr == 0)
 						return MEDIA_RTP_ERR_RESOURCE_ERROR;
-					datacopy = new uint8_t[recvlen];
-					if (datacopy == 0)
-					{
-						delete addr;
-						return MEDIA_RTP_ERR_RESOURCE_ERROR;
-					}
+					buf = bufferpool->Allocate(recvlen);
+					datacopy = buf->GetData();
 					memcpy(datacopy,packetbuffer,recvlen);
 					
 					bool isrtp = rtp;
@@ -1451,10 +1747,11 @@ int RTPUDPv4Transmitter::PollSocket(bool rtp)
 					if (pack == 0)
 					{
 						delete addr;
-						delete [] datacopy;
+						buf->Release();
 						return MEDIA_RTP_ERR_RESOURCE_ERROR;
 					}
-					rawpacketlist.push_back(pack);	
+					pack->SetDataReleaser(buf);
+					packetring.Push(pack);
 				}
 			}
 		}
@@ -1463,6 +1760,246 @@ int RTPUDPv4Transmitter::PollSocket(bool rtp)
 	return 0;
 }
 
+int RTPUDPv4Transmitter::CreateReceiveShards(const RTPUDPv4TransmissionParams *params)
+{
+	int numshards = params->GetReceiveShards();
+	std::vector<int> socks;
+	struct sockaddr_in addr;
+	int status = 0;
+
+	memset(&addr,0,sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(m_rtpPort);
+	addr.sin_addr.s_addr = htonl(params->GetBindIP());
+
+	// RTP 套接字是组内的第一个套接字，其余的套接字按相同的方式设置后绑定到同一地址
+	socks.push_back(rtpsock);
+	for (int i = 1 ; status == 0 && i < numshards ; i++)
+	{
+		int sock = socket(PF_INET,SOCK_DGRAM,0);
+		int on = 1;
+#ifdef RTP_SUPPORT_IPV4MULTICAST
+		int off = 0;
+#endif // RTP_SUPPORT_IPV4MULTICAST
+		int size = params->GetRTPReceiveBuffer();
+
+		if (sock == RTPSOCKERR)
+		{
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+			break;
+		}
+		socks.push_back(sock);
+
+		if (setsockopt(sock,SOL_SOCKET,SO_REUSEPORT,(const char *)&on,sizeof(int)) != 0 ||
+		    setsockopt(sock,SOL_SOCKET,SO_RCVBUF,(const char *)&size,sizeof(int)) != 0 ||
+		    bind(sock,(struct sockaddr *)&addr,sizeof(struct sockaddr_in)) != 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+		else if (kerneltimestamps && RTPEnableReceiveTimestamps(sock) < 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+#ifdef RTP_SUPPORT_IPV4MULTICAST
+		// 内核不按重用端口组选择多播数据包的接收套接字，而是交给每个绑定在该端口上的套接字，
+		// 所以只让加入了多播组的套接字接收多播数据（参见 JoinMulticastGroup）
+		else if (setsockopt(sock,IPPROTO_IP,IP_MULTICAST_ALL,(const char *)&off,sizeof(int)) != 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_SUPPORT_IPV4MULTICAST
+	}
+
+#ifdef RTP_SUPPORT_REUSEPORT_CBPF
+	// 按SSRC选择套接字，失败时同一SSRC的数据包可能由不同的线程接收而乱序
+	if (status == 0)
+		status = RTPReceiveShards::AttachSSRCSteering(rtpsock,numshards);
+	// 多播数据包由每个套接字上的过滤器按同样的规则分配，单播数据包总能通过选中的套接字的过滤器
+	for (int i = 0 ; status == 0 && i < numshards ; i++)
+		status = RTPReceiveShards::AttachSSRCFilter(socks[i],numshards,i);
+	shardmulticast = (status == 0);
+#endif // RTP_SUPPORT_REUSEPORT_CBPF
+	// 系统不支持时内核按源地址哈希选择，同一发送端的顺序同样得到保留
+	if (status == 0)
+		status = receiveshards.Start(socks,rtpsock == rtcpsock,kerneltimestamps,params->GetPacketBufferPool(),
+		                            params->GetReceiveShardCPUs());
+
+	if (status < 0)
+	{
+		for (size_t i = 1 ; i < socks.size() ; i++)
+			RTPCLOSE(socks[i]);
+		shardmulticast = false;
+		return status;
+	}
+
+	shardsockets.assign(socks.begin()+1,socks.end());
+	return 0;
+}
+
+void RTPUDPv4Transmitter::DestroyReceiveShards()
+{
+	receiveshards.Stop();
+	for (size_t i = 0 ; i < shardsockets.size() ; i++)
+		RTPCLOSE(shardsockets[i]);
+	shardsockets.clear();
+	shardmulticast = false;
+}
+
+int RTPUDPv4Transmitter::CreateIoUring(RTPIoUring *ring)
+{
+	int status;
+
+	if ((status = ring->AddSocket(rtpsock,sizeof(struct sockaddr_in),&rtpreadydesc)) < 0)
+		return status;
+	rtcpreadydesc = rtpreadydesc;
+	if (rtpsock != rtcpsock)
+	{
+		if ((status = ring->AddSocket(rtcpsock,sizeof(struct sockaddr_in),&rtcpreadydesc)) < 0)
+		{
+			ring->RemoveSocket(rtpsock);
+			return status;
+		}
+	}
+	iouring = ring;
+	return 0;
+}
+
+void RTPUDPv4Transmitter::DestroyIoUring()
+{
+	if (iouring == 0)
+		return;
+
+	iouring->RemoveSocket(rtpsock);
+	if (rtpsock != rtcpsock)
+		iouring->RemoveSocket(rtcpsock);
+	iouring = 0;
+}
+
+int RTPUDPv4Transmitter::PollIoUring()
+{
+	int status = 0;
+
+	for (int i = 0 ; i < 2 ; i++)
+	{
+		bool rtp = (i == 0);
+		int sock = (rtp) ? rtpsock : rtcpsock;
+		std::list<RTPIoUring::Datagram> datagrams;
+
+		if (!rtp && rtpsock == rtcpsock) // 多路复用时无需取两次
+			break;
+
+		// 接收请求不能重新发出时仍然处理已取到的数据报，再报告错误
+		int collectstatus = iouring->CollectDatagrams(sock,datagrams,packetring.GetCapacity()-packetring.GetSize());
+
+		if (collectstatus < 0 && status >= 0)
+			status = collectstatus;
+		for (std::list<RTPIoUring::Datagram>::iterator it = datagrams.begin() ; it != datagrams.end() ; ++it)
+		{
+			const struct sockaddr_in *srcaddr = (const struct sockaddr_in *)&it->address;
+			uint32_t srcip = ntohl(srcaddr->sin_addr.s_addr);
+			uint16_t srcport = ntohs(srcaddr->sin_port);
+
+			if (receivemode != RTPTransmitter::AcceptAll && !ShouldAcceptData(srcip,srcport))
+			{
+				it->buffer->Release();
+				continue;
+			}
+
+			bool isrtp = rtp;
+			if (rtpsock == rtcpsock) // 多路复用时检查负载类型
+			{
+				isrtp = true;
+				if (it->length > sizeof(RTCPCommonHeader))
+				{
+					uint8_t packettype = ((RTCPCommonHeader *)it->data)->packettype;
+
+					if (packettype >= 200 && packettype <= 204)
+						isrtp = false;
+				}
+			}
+
+			RTPEndpoint *addr = new RTPEndpoint(srcip,srcport);
+			RTPRawPacket *pack = new RTPRawPacket(it->data,it->length,addr,it->receivetime,isrtp);
+
+			pack->SetDataReleaser(it->buffer); // 数据包接管数据报的引用
+			packetring.Push(pack);
+		}
+	}
+	return status;
+}
+
+int RTPUDPv4Transmitter::SendThroughIoUring(int sock,const void *data,size_t len,bool rtp)
+{
+	bool queued = false;
+
+	// 发往所有目的地址的数据报只需一次提交
+	for (const auto& dest : destinations)
+	{
+		const struct sockaddr *addr = (rtp) ? dest.GetRtpSockAddr() : dest.GetRtcpSockAddr();
+
+		if (iouring->QueueSend(sock,data,len,addr,dest.GetSockAddrLen()) >= 0)
+			queued = true;
+		else
+			sendto(sock,(const char *)data,len,0,addr,dest.GetSockAddrLen()); // 提交队列已满
+	}
+	if (queued)
+		return iouring->Submit();
+	return 0;
+}
+
+bool RTPUDPv4Transmitter::IsUsingIoUring()
+{
+	if (!init)
+		return false;
+
+	MAINMUTEX_LOCK
+	bool used = created && iouring != 0;
+	MAINMUTEX_UNLOCK
+	return used;
+}
+
+uint64_t RTPUDPv4Transmitter::GetReceiveQueueDroppedPackets()
+{
+	if (!init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	uint64_t dropped = receiveshards.GetDroppedPackets();
+	MAINMUTEX_UNLOCK
+	return dropped;
+}
+
+size_t RTPUDPv4Transmitter::GetReceiveQueueHighWaterMark()
+{
+	if (!init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	size_t highwater = receiveshards.GetHighWaterMark();
+	MAINMUTEX_UNLOCK
+	return highwater;
+}
+
+void RTPUDPv4Transmitter::PollReceiveShards()
+{
+	RTPRawPacket *pack;
+
+	// 数据包从接收线程的队列直接移到传输器的队列；队列已满时剩下的留在接收线程的队列中，
+	// 并保持就绪信号，下一次 Poll 继续取
+	receiveshards.ClearReadySignal();
+	while (true)
+	{
+		if (packetring.IsFull())
+		{
+			receiveshards.SignalReady();
+			break;
+		}
+		if ((pack = receiveshards.PopPacket()) == 0)
+			break;
+
+		const RTPEndpoint *addr = pack->GetSenderAddress();
+
+		if (receivemode == RTPTransmitter::AcceptAll || ShouldAcceptData(addr->GetIPv4(),addr->GetRtpPort()))
+			packetring.Push(pack);
+		else
+			delete pack;
+	}
+}
+
 int RTPUDPv4Transmitter::ProcessAddAcceptIgnoreEntry(uint32_t ip,uint16_t port)
 {
 	auto it = acceptignoreinfo.find(ip);
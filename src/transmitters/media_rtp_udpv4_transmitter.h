@@ -4,7 +4,13 @@
 #include "rtpconfig.h"
 #include "media_rtp_endpoint.h"
 #include "media_rtp_transmitter.h"
+#include "media_rtp_transmit_timestamps.h"
+#include "media_rtp_receive_shards.h"
+#include "media_rtp_io_uring.h"
+#include "media_rtp_packet_buffer.h"
+#include "media_rtp_packet_ring.h"
 #include <list>
+#include <vector>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -71,6 +77,40 @@ public:
   /** 设置RTCP套接字的接收缓冲区大小。 */
   void SetRTCPReceiveBuffer(int s) { rtcprecvbuf = s; }
 
+  /** 启用后，套接字上会设置 SO_TIMESTAMPNS，数据包的接收时间取自内核时间戳，
+   *  而不是轮询时的当前时间；系统不支持时自动使用当前时间。 */
+  void SetUseKernelReceiveTimestamps(bool f) { kerneltimestamps = f; }
+
+  /** 启用后，RTP套接字上会设置 SO_TIMESTAMPING，从错误队列中收集每个RTP数据包的软件发送时间戳，
+   *  会话用它们来计算发送者报告中的NTP时间戳和RTP时间戳；系统不支持时忽略此选项。 */
+  void SetUseKernelTransmitTimestamps(bool f) { kerneltxtimestamps = f; }
+
+  /** 设置接收RTP数据的线程数。大于1时在RTP端口上绑定这么多个 SO_REUSEPORT 套接字，
+   *  每个套接字由一个线程读取，同一SSRC的数据包总是由同一个线程接收，Poll 只需取出
+   *  这些线程收到的数据包；系统支持按SSRC选择套接字但附加选择程序失败时创建失败。
+   *  此时必须指定端口基数，不能使用现有套接字，也不收集发送时间戳。内核不在重用端口组内
+   *  分配多播数据包，所以系统支持按SSRC选择时每个线程的套接字都加入多播组，并用套接字过滤器
+   *  按同样的规则只保留属于自己的数据包；否则只有第一个线程的套接字加入多播组，多播数据
+   *  不会分散到多个线程。每个数据包都只收到一次。
+   *  接收线程只分担读取套接字的工作：数据包仍由调用 Poll 的线程交给会话，会话在源表的锁内
+   *  依次处理所有源的数据包，处理本身不会因为使用多个接收线程而并行。 */
+  void SetReceiveShards(int n) { receiveshards = n; }
+
+  /** 设置接收线程绑定的CPU：第 i 个线程只在 <tt>cpus[i % cpus.size()]</tt> 上运行。
+   *  为空（默认值）时不绑定；系统不支持绑定或CPU编号无效时创建失败。 */
+  void SetReceiveShardCPUs(const std::vector<int> &cpus) { shardcpus = cpus; }
+
+  /** 如果非空且已初始化，套接字的接收和发送通过这个 io_uring 实例进行，同一个实例可以
+   *  由多个会话共享；未初始化或注册套接字失败时使用普通的套接字调用。不能与多个接收线程
+   *  同时使用，也不使用内核时间戳，数据包的接收时间是取出完成事件的时间。 */
+  void SetIoUring(RTPIoUring *ring) { iouring = ring; }
+
+  /** 设置存放收到的数据包的引用计数缓冲区池。数据包总是存放在引用计数缓冲区中，释放后缓冲区
+   *  回到池中，数据包也可以用 RTPPacket::Share 共享而不复制；为空（默认值）时传输器使用自己的池，
+   *  每个接收线程也使用自己的池，通过 io_uring 收到的数据包则来自 io_uring 实例的池。
+   *  同一个池可以由多个会话共享，传输器使用期间持有池的一个引用。 */
+  void SetPacketBufferPool(RTPPacketBufferPool *pool) { bufferpool = pool; }
+
   /** 启用或禁用通过RTP通道复用RTCP流量，以便只使用单个端口。 */
   void SetRTCPMultiplexing(bool f) { rtcpmux = f; }
 
@@ -109,6 +149,24 @@ public:
   /** 返回RTCP套接字的接收缓冲区大小。 */
   int GetRTCPReceiveBuffer() const { return rtcprecvbuf; }
 
+  /** 如果使用内核接收时间戳则返回true（默认为false）。 */
+  bool GetUseKernelReceiveTimestamps() const { return kerneltimestamps; }
+
+  /** 如果使用内核发送时间戳则返回true（默认为false）。 */
+  bool GetUseKernelTransmitTimestamps() const { return kerneltxtimestamps; }
+
+  /** 返回接收RTP数据的线程数（默认为1，即在 Poll 中直接读取套接字）。 */
+  int GetReceiveShards() const { return receiveshards; }
+
+  /** 返回接收线程绑定的CPU（默认为空，不绑定）。 */
+  const std::vector<int> &GetReceiveShardCPUs() const { return shardcpus; }
+
+  /** 返回用于接收和发送的 io_uring 实例（默认为null）。 */
+  RTPIoUring *GetIoUring() const { return iouring; }
+
+  /** 返回存放收到的数据包的缓冲区池（默认为null）。 */
+  RTPPacketBufferPool *GetPacketBufferPool() const { return bufferpool; }
+
   /** 返回一个标志，指示RTCP流量是否将通过RTP通道复用。 */
   bool GetRTCPMultiplexing() const { return rtcpmux; }
 
@@ -141,6 +199,12 @@ private:
   uint8_t multicastTTL;
   int rtpsendbuf, rtprecvbuf;
   int rtcpsendbuf, rtcprecvbuf;
+  bool kerneltimestamps;
+  bool kerneltxtimestamps;
+  int receiveshards;
+  std::vector<int> shardcpus;
+  RTPIoUring *iouring;
+  RTPPacketBufferPool *bufferpool;
   bool rtcpmux;
   bool allowoddportbase;
   uint16_t forcedrtcpport;
@@ -161,6 +225,11 @@ inline RTPUDPv4TransmissionParams::RTPUDPv4TransmissionParams()
   rtprecvbuf = RTPUDPV4TRANS_RTPRECEIVEBUFFER;
   rtcpsendbuf = RTPUDPV4TRANS_RTCPTRANSMITBUFFER;
   rtcprecvbuf = RTPUDPV4TRANS_RTCPRECEIVEBUFFER;
+  kerneltimestamps = false;
+  kerneltxtimestamps = false;
+  receiveshards = 1;
+  iouring = 0;
+  bufferpool = 0;
   rtcpmux = false;
   allowoddportbase = false;
   forcedrtcpport = 0;
@@ -237,6 +306,8 @@ public:
 
   int SendRTPData(const void *data, size_t len);
   int SendRTCPData(const void *data, size_t len);
+  int SendRTPDataV(const void *header, size_t headerlen, const void *payload,
+                   size_t payloadlen);
 
   int AddDestination(const RTPEndpoint &addr);
   int DeleteDestination(const RTPEndpoint &addr);
@@ -258,6 +329,22 @@ public:
 
   bool NewDataAvailable();
   RTPRawPacket *GetNextPacket();
+  bool GetNextTransmitTimestamp(uint32_t *ssrc, uint32_t *rtptimestamp,
+                                RTPTime *sendtime);
+  int GetReceiveDescriptors(std::vector<int> &descriptors);
+  int GetAbortDescriptor(int *descriptor);
+  int PollDescriptor(int descriptor);
+
+  /** 返回接收线程的队列因 Poll 调用不及时而丢弃的数据包数量
+   *  （参见 RTPUDPv4TransmissionParams::SetReceiveShards）。 */
+  uint64_t GetReceiveQueueDroppedPackets();
+
+  /** 返回接收线程的队列中曾经积压的最多数据包数量。 */
+  size_t GetReceiveQueueHighWaterMark();
+
+  /** 如果套接字通过 io_uring 接收和发送数据则返回 \c true
+   *  （参见 RTPUDPv4TransmissionParams::SetIoUring）。 */
+  bool IsUsingIoUring();
 
 private:
   int CreateLocalIPList();
@@ -266,10 +353,18 @@ private:
   void AddLoopbackAddress();
   void FlushPackets();
   int PollSocket(bool rtp);
+  int CreateReceiveShards(const RTPUDPv4TransmissionParams *params);
+  void DestroyReceiveShards();
+  void PollReceiveShards();
+  int CreateIoUring(RTPIoUring *ring);
+  void DestroyIoUring();
+  int PollIoUring();
+  int SendThroughIoUring(int sock, const void *data, size_t len, bool rtp);
   int ProcessAddAcceptIgnoreEntry(uint32_t ip, uint16_t port);
   int ProcessDeleteAcceptIgnoreEntry(uint32_t ip, uint16_t port);
 #ifdef RTP_SUPPORT_IPV4MULTICAST
   bool SetMulticastTTL(uint8_t ttl);
+  void DropShardMemberships(uint32_t mcastIP);
 #endif // RTP_SUPPORT_IPV4MULTICAST
   bool ShouldAcceptData(uint32_t srcip, uint16_t srcport);
   void ClearAcceptIgnoreInfo();
@@ -278,6 +373,14 @@ private:
   bool created;
   bool waitingfordata;
   int rtpsock, rtcpsock;
+  bool kerneltimestamps;
+  RTPTransmitTimestamps txtimestamps;
+  RTPReceiveShards receiveshards;
+  std::vector<int> shardsockets;
+  bool shardmulticast; // 接收线程的套接字按SSRC过滤，都加入多播组
+  RTPIoUring *iouring;
+  RTPPacketBufferPool *bufferpool;
+  int rtpreadydesc, rtcpreadydesc;
   uint32_t mcastifaceIP;
   std::list<uint32_t> localIPs;
   uint16_t m_rtpPort, m_rtcpPort;
@@ -291,7 +394,8 @@ private:
 #ifdef RTP_SUPPORT_IPV4MULTICAST
   std::unordered_set<uint32_t> multicastgroups;
 #endif // RTP_SUPPORT_IPV4MULTICAST
-  std::list<RTPRawPacket *> rawpacketlist;
+  // Poll 放入数据包（持有主互斥锁），GetNextPacket 取出（只持有接收互斥锁）
+  RTPPacketRing packetring;
 
   bool supportsmulticasting;
   size_t maxpacksize;
@@ -310,6 +414,6 @@ private:
   RTPAbortDescriptors m_abortDesc;
   RTPAbortDescriptors *m_pAbortDesc; // 如果指定了外部描述符
 
-  std::mutex mainmutex, waitmutex;
+  std::mutex mainmutex, waitmutex, receivemutex;
   int threadsafe;
 };
\ No newline at end of file
@@ -9,28 +9,60 @@
 #include "media_rtp_defines.h"
 #include "media_rtp_errors.h"
 #include <stdio.h>
+#include <sys/uio.h>
 
 #define RTPUDPV6TRANS_MAXPACKSIZE							65535
 #define RTPUDPV6TRANS_IFREQBUFSIZE							8192
 
-#define RTPUDPV6TRANS_IS_MCASTADDR(x)							(x.s6_addr[0] == 0xFF)
+#define RTPUDPV6TRANS_IS_MCASTADDR(x)							(x.s6_addr[0] == 0xFF || (IN6_IS_ADDR_V4MAPPED(&x) && (x.s6_addr[12]&0xF0) == 0xE0))
 
+// 映射的IPv4多播组通过 IP_ADD_MEMBERSHIP/IP_DROP_MEMBERSHIP 加入或离开
 #define RTPUDPV6TRANS_MCASTMEMBERSHIP(socket,type,mcastip,status)	{\
-										struct ipv6_mreq mreq;\
-										\
-										mreq.ipv6mr_multiaddr = mcastip;\
-										mreq.ipv6mr_interface = mcastifidx;\
-										status = setsockopt(socket,IPPROTO_IPV6,type,(const char *)&mreq,sizeof(struct ipv6_mreq));\
+										if (IN6_IS_ADDR_V4MAPPED(&mcastip))\
+										{\
+											struct ip_mreqn mreq4;\
+											\
+											memset(&mreq4,0,sizeof(struct ip_mreqn));\
+											memcpy(&mreq4.imr_multiaddr.s_addr,&mcastip.s6_addr[12],4);\
+											mreq4.imr_ifindex = mcastifidx;\
+											status = setsockopt(socket,IPPROTO_IP,(type == IPV6_JOIN_GROUP)?IP_ADD_MEMBERSHIP:IP_DROP_MEMBERSHIP,(const char *)&mreq4,sizeof(struct ip_mreqn));\
+										}\
+										else\
+										{\
+											struct ipv6_mreq mreq;\
+											\
+											mreq.ipv6mr_multiaddr = mcastip;\
+											mreq.ipv6mr_interface = mcastifidx;\
+											status = setsockopt(socket,IPPROTO_IPV6,type,(const char *)&mreq,sizeof(struct ipv6_mreq));\
+										}\
 									}
 	#define MAINMUTEX_LOCK 		{ if (threadsafe) mainmutex.lock(); }
 	#define MAINMUTEX_UNLOCK	{ if (threadsafe) mainmutex.unlock(); }
 	#define WAITMUTEX_LOCK		{ if (threadsafe) waitmutex.lock(); }
 	#define WAITMUTEX_UNLOCK	{ if (threadsafe) waitmutex.unlock(); }
+	#define RECEIVEMUTEX_LOCK	{ if (threadsafe) receivemutex.lock(); }
+	#define RECEIVEMUTEX_UNLOCK	{ if (threadsafe) receivemutex.unlock(); }
 	
+// 返回主机字节序的IPv4地址 \c ip 对应的 ::ffff:a.b.c.d 地址
+static in6_addr RTPUDPv6MapIPv4(uint32_t ip)
+{
+	in6_addr mapped;
+
+	memset(&mapped,0,sizeof(in6_addr));
+	mapped.s6_addr[10] = 0xFF;
+	mapped.s6_addr[11] = 0xFF;
+	mapped.s6_addr[12] = (uint8_t)(ip>>24);
+	mapped.s6_addr[13] = (uint8_t)(ip>>16);
+	mapped.s6_addr[14] = (uint8_t)(ip>>8);
+	mapped.s6_addr[15] = (uint8_t)ip;
+	return mapped;
+}
+
 
-RTPUDPv6Transmitter::RTPUDPv6Transmitter() : RTPTransmitter()
+RTPUDPv6Transmitter::RTPUDPv6Transmitter() : RTPTransmitter(), packetring(RTP_UDP_MAXQUEUE)
 {
 	created = false;
+	bufferpool = 0;
 	init = false;
 }
 
@@ -81,6 +113,17 @@ int RTPUDPv6Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 		}
 		params = (const RTPUDPv6TransmissionParams *)transparams;
 	}
+	dualstack = params->GetDualStack();
+
+	// 多个接收线程需要在固定端口上创建重用端口组，并且不能再通过 io_uring 接收
+	int numshards = params->GetReceiveShards();
+	RTPIoUring *ring = params->GetIoUring();
+
+	if (numshards < 1 || (numshards > 1 && (params->GetPortbase() == 0 || ring != 0)))
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
 
 			// 检查端口基数是否为偶数
 	if (params->GetPortbase()%2 != 0)
@@ -104,6 +147,35 @@ int RTPUDPv6Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_OPERATION_FAILED;
 	}
+
+	// 重用端口组中的每个套接字都必须在绑定之前设置 SO_REUSEPORT
+	if (numshards > 1)
+	{
+		int on = 1;
+
+		if (setsockopt(rtpsock,SOL_SOCKET,SO_REUSEPORT,(const char *)&on,sizeof(int)) != 0)
+		{
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+	}
+
+	// 双栈模式下同一个套接字也接收和发送IPv4数据包，必须在绑定之前设置
+	if (dualstack)
+	{
+		int v6only = 0;
+
+		if (setsockopt(rtpsock,IPPROTO_IPV6,IPV6_V6ONLY,(const char *)&v6only,sizeof(int)) != 0 ||
+		    setsockopt(rtcpsock,IPPROTO_IPV6,IPV6_V6ONLY,(const char *)&v6only,sizeof(int)) != 0)
+		{
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+	}
 	
 			// 设置套接字缓冲区大小
 	
@@ -230,6 +302,48 @@ int RTPUDPv6Transmitter::Create(size_t maximumpacketsize,const RTPTransmissionPa
 	multicastTTL = params->GetMulticastTTL();
 	receivemode = RTPTransmitter::AcceptAll;
 
+	// 启用内核接收时间戳，失败时退回到轮询时读取当前时间
+
+	kerneltimestamps = false;
+	if (params->GetUseKernelReceiveTimestamps())
+	{
+		if (RTPEnableReceiveTimestamps(rtpsock) >= 0 && RTPEnableReceiveTimestamps(rtcpsock) >= 0)
+			kerneltimestamps = true;
+	}
+
+	// 没有提供池时使用自己的池，所以收到的数据包总是存放在引用计数缓冲区中
+	bufferpool = params->GetPacketBufferPool();
+	if (bufferpool != 0)
+		bufferpool->AddReference();
+	else
+		bufferpool = RTPPacketBufferPool::Create(RTP_PACKETBUFFER_DEFAULTSIZE,RTP_PACKETBUFFER_TRANSMITTERMAXFREE);
+
+	shardmulticast = false;
+	if (numshards > 1)
+	{
+		if ((status = CreateReceiveShards(params)) < 0)
+		{
+			bufferpool->Release();
+			bufferpool = 0;
+			m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+			RTPCLOSE(rtpsock);
+			RTPCLOSE(rtcpsock);
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+	}
+
+	// 环不可用时继续使用普通的套接字调用
+	iouring = 0;
+	if (ring != 0 && ring->IsInitialized())
+		CreateIoUring(ring);
+
+	// 发送时间戳只在RTP套接字上收集；使用接收线程或 io_uring 时不收集，原因与IPv4传输器相同
+
+	txtimestamps.Reset();
+	if (params->GetUseKernelTransmitTimestamps() && numshards == 1 && iouring == 0)
+		txtimestamps.Enable(rtpsock);
+
 	localhostname = 0;
 	localhostnamelength = 0;
 
@@ -258,6 +372,8 @@ void RTPUDPv6Transmitter::Destroy()
 		localhostnamelength = 0;
 	}
 	
+	DestroyReceiveShards(); // 必须在关闭套接字之前停止接收线程
+	DestroyIoUring(); // 同样必须在关闭套接字之前取消接收请求
 	RTPCLOSE(rtpsock);
 	RTPCLOSE(rtcpsock);
 	destinations.clear();
@@ -265,6 +381,8 @@ void RTPUDPv6Transmitter::Destroy()
 	multicastgroups.clear();
 #endif // RTP_SUPPORT_IPV6MULTICAST
 	FlushPackets();
+	bufferpool->Release(); // 应用程序仍持有的数据包释放之后池才被删除
+	bufferpool = 0;
 	ClearAcceptIgnoreInfo();
 	localIPs.clear();
 	created = false;
@@ -451,8 +569,9 @@ bool RTPUDPv6Transmitter::ComesFromThisTransmitter(const RTPEndpoint *addr)
 	MAINMUTEX_LOCK
 	
 	bool v;
+	in6_addr addrip;
 		
-	if (created && addr->GetType() == RTPEndpoint::IPv6)
+	if (created && GetSocketIP(*addr,&addrip))
 	{	
 			bool found = false;
 		std::list<in6_addr>::const_iterator it;
@@ -461,7 +580,6 @@ bool RTPUDPv6Transmitter::ComesFromThisTransmitter(const RTPEndpoint *addr)
 		while (!found && it != localIPs.end())
 		{
 			in6_addr itip = *it;
-			in6_addr addrip = addr->GetIPv6();
 			if (memcmp(&addrip,&itip,sizeof(in6_addr)) == 0)
 				found = true;
 			else
@@ -500,7 +618,19 @@ int RTPUDPv6Transmitter::Poll()
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	status = PollSocket(true); // 轮询 RTP 套接字
+	RTPTimeBatch timebatch; // 这一轮读取的数据包共用一次时钟读取
+
+	status = 0;
+	if (iouring != 0)
+	{
+		status = PollIoUring(); // 两个套接字的数据报都由环接收
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+	if (receiveshards.IsRunning())
+		PollReceiveShards(); // RTP 套接字由接收线程读取
+	else
+		status = PollSocket(true); // 轮询 RTP 套接字
 	if (status >= 0)
 		status = PollSocket(false); // 轮询 RTCP 套接字
 	MAINMUTEX_UNLOCK
@@ -526,7 +656,19 @@ int RTPUDPv6Transmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavai
 	}
 	
 	int abortSocket = m_pAbortDesc->GetAbortSocket();
-	int socks[3] = { rtpsock, rtcpsock, abortSocket };
+
+	// 使用接收线程时等待它们的就绪信号，而不是直接等待 RTP 套接字；使用 io_uring 时
+	// 等待环的完成线程为这两个套接字发出的就绪信号
+	int datasock = (receiveshards.IsRunning()) ? receiveshards.GetReadySocket() : rtpsock;
+	int rtcpdatasock = rtcpsock;
+
+	if (iouring != 0)
+	{
+		datasock = rtpreadydesc;
+		rtcpdatasock = rtcpreadydesc;
+	}
+
+	int socks[3] = { datasock, rtcpdatasock, abortSocket };
 	int8_t readflags[3] = { 0, 0, 0 };
 	const int idxRTP = 0;
 	const int idxRTCP = 1;
@@ -614,9 +756,69 @@ int RTPUDPv6Transmitter::SendRTPData(const void *data,size_t len)
 		return MEDIA_RTP_ERR_RESOURCE_ERROR;
 	}
 	
+	if (iouring != 0)
+	{
+		int status = SendThroughIoUring(rtpsock,data,len,true);
+
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
+	bool first = true;
 	for (const auto& dest : destinations)
 	{
-		sendto(rtpsock,(const char *)data,len,0,dest.GetRtpSockAddr(),dest.GetSockAddrLen());
+		if (sendto(rtpsock,(const char *)data,len,0,dest.GetRtpSockAddr(),dest.GetSockAddrLen()) >= 0)
+			txtimestamps.OnSent(data,len,first); // 只记录发往第一个目的地址的数据包的发送时间
+		first = false;
+	}
+	
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUDPv6Transmitter::SendRTPDataV(const void *header,size_t headerlen,const void *payload,size_t payloadlen)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	
+	if (!created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (headerlen+payloadlen > maxpacksize)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	if (iouring != 0)
+	{
+		// 提交队列保存的是连续的缓冲区，由基类合并两部分
+		MAINMUTEX_UNLOCK
+		return RTPTransmitter::SendRTPDataV(header,headerlen,payload,payloadlen);
+	}
+
+	struct iovec iov[2];
+	struct msghdr msg;
+
+	iov[0].iov_base = const_cast<void *>(header);
+	iov[0].iov_len = headerlen;
+	iov[1].iov_base = const_cast<void *>(payload);
+	iov[1].iov_len = payloadlen;
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = (payloadlen > 0) ? 2 : 1;
+
+	bool first = true;
+	for (const auto& dest : destinations)
+	{
+		msg.msg_name = const_cast<struct sockaddr *>(dest.GetRtpSockAddr());
+		msg.msg_namelen = dest.GetSockAddrLen();
+		if (sendmsg(rtpsock,&msg,0) >= 0)
+			txtimestamps.OnSent(header,headerlen+payloadlen,first); // 时间戳和SSRC都在头部中
+		first = false;
 	}
 	
 	MAINMUTEX_UNLOCK
@@ -641,6 +843,14 @@ int RTPUDPv6Transmitter::SendRTCPData(const void *data,size_t len)
 		return MEDIA_RTP_ERR_RESOURCE_ERROR;
 	}
 	
+	if (iouring != 0)
+	{
+		int status = SendThroughIoUring(rtcpsock,data,len,false);
+
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
 	for (const auto& dest : destinations)
 	{
 		sendto(rtcpsock,(const char *)data,len,0,dest.GetRtcpSockAddr(),dest.GetSockAddrLen());
@@ -662,13 +872,16 @@ int RTPUDPv6Transmitter::AddDestination(const RTPEndpoint &addr)
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	in6_addr ip;
+
+	if (!GetSocketIP(addr,&ip))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
 	}
 	
-	auto result = destinations.insert(addr);
+	// 映射后的端点带有可以直接发送的 sockaddr_in6，发送时不需要区分地址族
+	auto result = destinations.insert(RTPEndpoint(ip,addr.GetRtpPort(),addr.GetRtcpPort()));
 	int status = result.second ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
 
 	MAINMUTEX_UNLOCK
@@ -687,19 +900,15 @@ int RTPUDPv6Transmitter::DeleteDestination(const RTPEndpoint &addr)
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
-	{
-		MAINMUTEX_UNLOCK
-		return MEDIA_RTP_ERR_INVALID_PARAMETER;
-	}
-	
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	in6_addr ip;
+
+	if (!GetSocketIP(addr,&ip))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
 	}
 	
-	size_t erased = destinations.erase(addr);
+	size_t erased = destinations.erase(RTPEndpoint(ip,addr.GetRtpPort(),addr.GetRtcpPort()));
 	int status = erased > 0 ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
 	
 	MAINMUTEX_UNLOCK
@@ -751,14 +960,14 @@ int RTPUDPv6Transmitter::JoinMulticastGroup(const RTPEndpoint &addr)
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	in6_addr mcastIP;
+
+	if (!GetSocketIP(addr,&mcastIP))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
 	}
 	
-	in6_addr mcastIP = addr.GetIPv6();
-	
 	if (!RTPUDPV6TRANS_IS_MCASTADDR(mcastIP))
 	{
 		MAINMUTEX_UNLOCK
@@ -776,9 +985,25 @@ int RTPUDPv6Transmitter::JoinMulticastGroup(const RTPEndpoint &addr)
 			MAINMUTEX_UNLOCK
 			return MEDIA_RTP_ERR_OPERATION_FAILED;
 		}
+
+		// 接收线程的套接字按SSRC过滤，都加入多播组时每个数据包只被其中一个保留
+		for (size_t i = 0 ; shardmulticast && i < shardsockets.size() ; i++)
+		{
+			RTPUDPV6TRANS_MCASTMEMBERSHIP(shardsockets[i],IPV6_JOIN_GROUP,mcastIP,status);
+			if (status != 0)
+			{
+				DropShardMemberships(mcastIP);
+				RTPUDPV6TRANS_MCASTMEMBERSHIP(rtpsock,IPV6_LEAVE_GROUP,mcastIP,status);
+				multicastgroups.erase(mcastIP);
+				MAINMUTEX_UNLOCK
+				return MEDIA_RTP_ERR_OPERATION_FAILED;
+			}
+		}
+
 		RTPUDPV6TRANS_MCASTMEMBERSHIP(rtcpsock,IPV6_JOIN_GROUP,mcastIP,status);
 		if (status != 0)
 		{
+			DropShardMemberships(mcastIP);
 			RTPUDPV6TRANS_MCASTMEMBERSHIP(rtpsock,IPV6_LEAVE_GROUP,mcastIP,status);
 			multicastgroups.erase(mcastIP);
 			MAINMUTEX_UNLOCK
@@ -803,14 +1028,14 @@ int RTPUDPv6Transmitter::LeaveMulticastGroup(const RTPEndpoint &addr)
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	in6_addr mcastIP;
+
+	if (!GetSocketIP(addr,&mcastIP))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
 	}
 	
-	in6_addr mcastIP = addr.GetIPv6();
-	
 	if (!RTPUDPV6TRANS_IS_MCASTADDR(mcastIP))
 	{
 		MAINMUTEX_UNLOCK
@@ -822,6 +1047,7 @@ int RTPUDPv6Transmitter::LeaveMulticastGroup(const RTPEndpoint &addr)
 	if (status >= 0)
 	{	
 		RTPUDPV6TRANS_MCASTMEMBERSHIP(rtpsock,IPV6_LEAVE_GROUP,mcastIP,status);
+		DropShardMemberships(mcastIP);
 		RTPUDPV6TRANS_MCASTMEMBERSHIP(rtcpsock,IPV6_LEAVE_GROUP,mcastIP,status);
 		status = 0;
 	}
@@ -842,6 +1068,7 @@ void RTPUDPv6Transmitter::LeaveAllMulticastGroups()
 		{
 			int status = 0;
 			RTPUDPV6TRANS_MCASTMEMBERSHIP(rtpsock,IPV6_LEAVE_GROUP,mcastIP,status);
+			DropShardMemberships(mcastIP);
 			RTPUDPV6TRANS_MCASTMEMBERSHIP(rtcpsock,IPV6_LEAVE_GROUP,mcastIP,status);
 			MEDIA_RTP_UNUSED(status);
 		}
@@ -850,6 +1077,21 @@ void RTPUDPv6Transmitter::LeaveAllMulticastGroups()
 	MAINMUTEX_UNLOCK
 }
 
+void RTPUDPv6Transmitter::DropShardMemberships(const in6_addr &mcastIP)
+{
+	if (!shardmulticast)
+		return;
+
+	// 还没有加入的套接字上离开多播组会失败，忽略错误
+	for (size_t i = 0 ; i < shardsockets.size() ; i++)
+	{
+		int status = 0;
+
+		RTPUDPV6TRANS_MCASTMEMBERSHIP(shardsockets[i],IPV6_LEAVE_GROUP,mcastIP,status);
+		MEDIA_RTP_UNUSED(status);
+	}
+}
+
 #else // 无多播支持
 
 int RTPUDPv6Transmitter::JoinMulticastGroup(const RTPEndpoint &addr)
@@ -896,13 +1138,14 @@ int RTPUDPv6Transmitter::AddToIgnoreList(const RTPEndpoint &addr)
 	MAINMUTEX_LOCK
 	
 	int status;
+	in6_addr ip;
 
 	if (!created)
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	if (!GetSocketIP(addr,&ip))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
@@ -913,7 +1156,7 @@ int RTPUDPv6Transmitter::AddToIgnoreList(const RTPEndpoint &addr)
 		return MEDIA_RTP_ERR_OPERATION_FAILED;
 	}
 	
-	status = ProcessAddAcceptIgnoreEntry(addr.GetIPv6(),addr.GetRtpPort());
+	status = ProcessAddAcceptIgnoreEntry(ip,addr.GetRtpPort());
 	
 	MAINMUTEX_UNLOCK
 	return status;
@@ -927,13 +1170,14 @@ int RTPUDPv6Transmitter::DeleteFromIgnoreList(const RTPEndpoint &addr)
 	MAINMUTEX_LOCK
 	
 	int status;
+	in6_addr ip;
 	
 	if (!created)
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	if (!GetSocketIP(addr,&ip))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
@@ -944,7 +1188,7 @@ int RTPUDPv6Transmitter::DeleteFromIgnoreList(const RTPEndpoint &addr)
 		return MEDIA_RTP_ERR_OPERATION_FAILED;
 	}
 	
-	status = ProcessDeleteAcceptIgnoreEntry(addr.GetIPv6(),addr.GetRtpPort());
+	status = ProcessDeleteAcceptIgnoreEntry(ip,addr.GetRtpPort());
 
 	MAINMUTEX_UNLOCK
 	return status;
@@ -969,13 +1213,14 @@ int RTPUDPv6Transmitter::AddToAcceptList(const RTPEndpoint &addr)
 	MAINMUTEX_LOCK
 	
 	int status;
+	in6_addr ip;
 	
 	if (!created)
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	if (!GetSocketIP(addr,&ip))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
@@ -986,7 +1231,7 @@ int RTPUDPv6Transmitter::AddToAcceptList(const RTPEndpoint &addr)
 		return MEDIA_RTP_ERR_OPERATION_FAILED;
 	}
 	
-	status = ProcessAddAcceptIgnoreEntry(addr.GetIPv6(),addr.GetRtpPort());
+	status = ProcessAddAcceptIgnoreEntry(ip,addr.GetRtpPort());
 
 	MAINMUTEX_UNLOCK
 	return status;
@@ -1000,13 +1245,14 @@ int RTPUDPv6Transmitter::DeleteFromAcceptList(const RTPEndpoint &addr)
 	MAINMUTEX_LOCK
 	
 	int status;
+	in6_addr ip;
 	
 	if (!created)
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (addr.GetType() != RTPEndpoint::IPv6)
+	if (!GetSocketIP(addr,&ip))
 	{
 		MAINMUTEX_UNLOCK
 		return MEDIA_RTP_ERR_INVALID_PARAMETER;
@@ -1017,7 +1263,7 @@ int RTPUDPv6Transmitter::DeleteFromAcceptList(const RTPEndpoint &addr)
 		return MEDIA_RTP_ERR_OPERATION_FAILED;
 	}
 	
-	status = ProcessDeleteAcceptIgnoreEntry(addr.GetIPv6(),addr.GetRtpPort());
+	status = ProcessDeleteAcceptIgnoreEntry(ip,addr.GetRtpPort());
 
 	MAINMUTEX_UNLOCK
 	return status;
@@ -1060,53 +1306,141 @@ bool RTPUDPv6Transmitter::NewDataAvailable()
 	if (!init)
 		return false;
 	
-	MAINMUTEX_LOCK
+	// 只读取队列的下标，不需要等待正在读取套接字的 Poll
+	return (packetring.GetSize() > 0);
+}
+
+RTPRawPacket *RTPUDPv6Transmitter::GetNextPacket()
+{
+	if (!init)
+		return 0;
 	
-	bool v;
-		
+	// 队列只有一个消费者，接收互斥锁使多个线程取数据包时依次进行；销毁后队列为空
+	RECEIVEMUTEX_LOCK
+	RTPRawPacket *p = packetring.Pop();
+	RECEIVEMUTEX_UNLOCK
+	return p;
+}
+
+bool RTPUDPv6Transmitter::GetNextTransmitTimestamp(uint32_t *ssrc,uint32_t *rtptimestamp,RTPTime *sendtime)
+{
+	if (!init)
+		return false;
+
+	MAINMUTEX_LOCK
+
 	if (!created)
-		v = false;
+	{
+		MAINMUTEX_UNLOCK
+		return false;
+	}
+
+	bool r = txtimestamps.GetNext(ssrc,rtptimestamp,sendtime);
+
+	MAINMUTEX_UNLOCK
+	return r;
+}
+
+int RTPUDPv6Transmitter::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 使用接收线程时 RTP 套接字由线程读取，等待它们的就绪信号
+	if (iouring != 0)
+	{
+		descriptors.push_back(rtpreadydesc);
+		descriptors.push_back(rtcpreadydesc);
+	}
 	else
 	{
-		if (rawpacketlist.empty())
-			v = false;
+		if (receiveshards.IsRunning())
+			descriptors.push_back(receiveshards.GetReadySocket());
 		else
-			v = true;
+			descriptors.push_back(rtpsock);
+		descriptors.push_back(rtcpsock);
 	}
-	
+
 	MAINMUTEX_UNLOCK
-	return v;
+	return 0;
 }
 
-RTPRawPacket *RTPUDPv6Transmitter::GetNextPacket()
+int RTPUDPv6Transmitter::GetAbortDescriptor(int *descriptor)
 {
 	if (!init)
-		return 0;
-	
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
 	MAINMUTEX_LOCK
-	
-	RTPRawPacket *p;
-	
 	if (!created)
 	{
 		MAINMUTEX_UNLOCK
-		return 0;
+		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
-	if (rawpacketlist.empty())
+	*descriptor = m_pAbortDesc->GetAbortSocket();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUDPv6Transmitter::PollDescriptor(int descriptor)
+{
+	if (!init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status = 0;
+
+	MAINMUTEX_LOCK
+	if (!created)
 	{
 		MAINMUTEX_UNLOCK
-		return 0;
+		return MEDIA_RTP_ERR_INVALID_STATE;
 	}
+	RTPTimeBatch timebatch;
 
-	p = *(rawpacketlist.begin());
-	rawpacketlist.pop_front();
-
+	if (descriptor == m_pAbortDesc->GetAbortSocket())
+		m_pAbortDesc->ReadSignallingByte();
+	else if (iouring != 0)
+	{
+		if (descriptor == rtpreadydesc || descriptor == rtcpreadydesc)
+			status = PollIoUring();
+		else
+			status = MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+	else if (receiveshards.IsRunning() && descriptor == receiveshards.GetReadySocket())
+		PollReceiveShards();
+	else if (descriptor == rtpsock && !receiveshards.IsRunning())
+		status = PollSocket(true);
+	else if (descriptor == rtcpsock)
+		status = PollSocket(false);
+	else
+		status = MEDIA_RTP_ERR_INVALID_PARAMETER;
 	MAINMUTEX_UNLOCK
-	return p;
+	return status;
 }
 
 // 私有函数从这里开始...
 
+bool RTPUDPv6Transmitter::GetSocketIP(const RTPEndpoint &addr,in6_addr *ip)
+{
+	if (addr.GetType() == RTPEndpoint::IPv6)
+	{
+		*ip = addr.GetIPv6();
+		return true;
+	}
+	if (addr.GetType() == RTPEndpoint::IPv4 && dualstack)
+	{
+		*ip = RTPUDPv6MapIPv4(addr.GetIPv4());
+		return true;
+	}
+	return false;
+}
+
 #ifdef RTP_SUPPORT_IPV6MULTICAST
 bool RTPUDPv6Transmitter::SetMulticastTTL(uint8_t ttl)
 {
@@ -1119,17 +1453,25 @@ bool RTPUDPv6Transmitter::SetMulticastTTL(uint8_t ttl)
 	status = setsockopt(rtcpsock,IPPROTO_IPV6,IPV6_MULTICAST_HOPS,(const char *)&ttl2,sizeof(int));
 	if (status != 0)
 		return false;
+	if (dualstack) // 发往映射的IPv4多播组的数据包使用IPv4的TTL
+	{
+		if (setsockopt(rtpsock,IPPROTO_IP,IP_MULTICAST_TTL,(const char *)&ttl2,sizeof(int)) != 0)
+			return false;
+		if (setsockopt(rtcpsock,IPPROTO_IP,IP_MULTICAST_TTL,(const char *)&ttl2,sizeof(int)) != 0)
+			return false;
+	}
 	return true;
 }
 #endif // RTP_SUPPORT_IPV6MULTICAST
 
 void RTPUDPv6Transmitter::FlushPackets()
 {
-	std::list<RTPRawPacket*>::const_iterator it;
+	RTPRawPacket *pack;
 
-	for (it = rawpacketlist.begin() ; it != rawpacketlist.end() ; ++it)
-		delete *it;
-	rawpacketlist.clear();
+	RECEIVEMUTEX_LOCK
+	while ((pack = packetring.Pop()) != 0)
+		delete pack;
+	RECEIVEMUTEX_UNLOCK
 }
 
 int RTPUDPv6Transmitter::PollSocket(bool rtp)
@@ -1147,66 +1489,21 @@ int RTPUDPv6Transmitter::PollSocket(bool rtp)
 	else
 		sock = rtcpsock;
 	
-	len = 0;
-	RTPIOCTL(sock,FIONREAD,&len);
+	// 错误队列中的发送时间戳也会使select报告套接字可读，所以先取走它们，
+	// 并以非阻塞方式读取数据
+	int recvflags = 0;
+	if (rtp && txtimestamps.IsEnabled())
+		recvflags = MSG_DONTWAIT;
 
-	if (len <= 0) // 确保长度为零的数据包不会排队
+	do
 	{
-		int8_t isset = 0;
-		int status = RTPSelect(&sock, &isset, 1, RTPTime(0));
-		if (status < 0)
-			return status;
-
-		if (isset)
-			dataavailable = true;
-		else
-			dataavailable = false;
-	}
-	else
-		dataavailable = true;
+		if (recvflags != 0)
+			txtimestamps.Poll(sock);
 
-	while (dataavailable)
-	{
-		RTPTime curtime = RTPTime::CurrentTime();
-		fromlen = sizeof(struct sockaddr_in6);
-		recvlen = recvfrom(sock,packetbuffer,RTPUDPV6TRANS_MAXPACKSIZE,0,(struct sockaddr *)&srcaddr,&fromlen);
-		if (recvlen > 0)
-		{
-			bool acceptdata;
+		// 队列已满时把剩下的数据报留在套接字中，套接字保持可读，下一次 Poll 继续读取
+		if (packetring.IsFull())
+			break;
 
-			// 获取到数据，处理它
-			if (receivemode == RTPTransmitter::AcceptAll)
-				acceptdata = true;
-			else
-				acceptdata = ShouldAcceptData(srcaddr.sin6_addr,ntohs(srcaddr.sin6_port));
-			
-			if (acceptdata)
-			{
-				RTPRawPacket *pack;
-				RTPEndpoint *addr;
-				uint8_t *datacopy;
-
-				addr = new RTPEndpoint(srcaddr.sin6_addr,ntohs(srcaddr.sin6_port));
-				if (addr == 0)
-					return MEDIA_RTP_ERR_RESOURCE_ERROR;
-				datacopy = new uint8_t[recvlen];
-				if (datacopy == 0)
-				{
-					delete addr;
-					return MEDIA_RTP_ERR_RESOURCE_ERROR;
-				}
-				memcpy(datacopy,packetbuffer,recvlen);
-				
-				pack = new RTPRawPacket(datacopy,recvlen,addr,curtime,rtp);
-				if (pack == 0)
-				{
-					delete addr;
-					delete [] datacopy;
-					return MEDIA_RTP_ERR_RESOURCE_ERROR;
-				}
-				rawpacketlist.push_back(pack);	
-			}
-		}
 		len = 0;
 		RTPIOCTL(sock,FIONREAD,&len);
 
@@ -1224,10 +1521,273 @@ int RTPUDPv6Transmitter::PollSocket(bool rtp)
 		}
 		else
 			dataavailable = true;
+
+		if (dataavailable)
+		{
+			RTPTime curtime(0);
+			fromlen = sizeof(struct sockaddr_in6);
+			recvlen = RTPReceiveFrom(sock,packetbuffer,RTPUDPV6TRANS_MAXPACKSIZE,recvflags,(struct sockaddr *)&srcaddr,&fromlen,kerneltimestamps,&curtime);
+			if (recvlen > 0)
+			{
+				bool acceptdata;
+
+				// 获取到数据，处理它
+				if (receivemode == RTPTransmitter::AcceptAll)
+					acceptdata = true;
+				else
+					acceptdata = ShouldAcceptData(srcaddr.sin6_addr,ntohs(srcaddr.sin6_port));
+				
+				if (acceptdata)
+				{
+					RTPRawPacket *pack;
+					RTPEndpoint *addr;
+					RTPPacketBuffer *buf;
+
+					// 双栈套接字上来自IPv4发送端的数据包，源地址恢复为IPv4端点
+					addr = new RTPEndpoint(RTPEndpoint::CreateFromSockAddr((struct sockaddr *)&srcaddr));
+					if (addr == 0)
+						return MEDIA_RTP_ERR_RESOURCE_ERROR;
+					buf = bufferpool->Allocate(recvlen);
+					memcpy(buf->GetData(),packetbuffer,recvlen);
+					
+					pack = new RTPRawPacket(buf->GetData(),recvlen,addr,curtime,rtp);
+					if (pack == 0)
+					{
+						delete addr;
+						buf->Release();
+						return MEDIA_RTP_ERR_RESOURCE_ERROR;
+					}
+					pack->SetDataReleaser(buf);
+					packetring.Push(pack);
+				}
+			}
+		}
+	} while (dataavailable);
+
+	return 0;
+}
+
+int RTPUDPv6Transmitter::CreateReceiveShards(const RTPUDPv6TransmissionParams *params)
+{
+	int numshards = params->GetReceiveShards();
+	std::vector<int> socks;
+	struct sockaddr_in6 addr;
+	int status = 0;
+
+	memset(&addr,0,sizeof(struct sockaddr_in6));
+	addr.sin6_family = AF_INET6;
+	addr.sin6_port = htons(portbase);
+	addr.sin6_addr = bindIP;
+
+	// RTP 套接字是组内的第一个套接字，其余的套接字按相同的方式设置后绑定到同一地址
+	socks.push_back(rtpsock);
+	for (int i = 1 ; status == 0 && i < numshards ; i++)
+	{
+		int sock = socket(PF_INET6,SOCK_DGRAM,0);
+		int on = 1;
+		int v6only = 0;
+#ifdef RTP_SUPPORT_IPV6MULTICAST
+		int off = 0;
+#endif // RTP_SUPPORT_IPV6MULTICAST
+		int size = params->GetRTPReceiveBuffer();
+
+		if (sock == RTPSOCKERR)
+		{
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+			break;
+		}
+		socks.push_back(sock);
+
+		if (setsockopt(sock,SOL_SOCKET,SO_REUSEPORT,(const char *)&on,sizeof(int)) != 0 ||
+		    (dualstack && setsockopt(sock,IPPROTO_IPV6,IPV6_V6ONLY,(const char *)&v6only,sizeof(int)) != 0) ||
+		    setsockopt(sock,SOL_SOCKET,SO_RCVBUF,(const char *)&size,sizeof(int)) != 0 ||
+		    bind(sock,(struct sockaddr *)&addr,sizeof(struct sockaddr_in6)) != 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+		else if (kerneltimestamps && RTPEnableReceiveTimestamps(sock) < 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+#ifdef RTP_SUPPORT_IPV6MULTICAST
+		// 与IPv4传输器相同，只让加入了多播组的套接字接收多播数据；双栈模式下映射的IPv4多播组
+		// 通过IPv4选项加入，也要设置IPv4的选项
+		else if (setsockopt(sock,IPPROTO_IPV6,IPV6_MULTICAST_ALL,(const char *)&off,sizeof(int)) != 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+		else if (dualstack && setsockopt(sock,IPPROTO_IP,IP_MULTICAST_ALL,(const char *)&off,sizeof(int)) != 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_SUPPORT_IPV6MULTICAST
+	}
+
+#ifdef RTP_SUPPORT_REUSEPORT_CBPF
+	// 程序的偏移量相对于UDP头或负载，与IP版本无关，IPv4和IPv6数据包按同样的规则分配
+	if (status == 0)
+		status = RTPReceiveShards::AttachSSRCSteering(rtpsock,numshards);
+	for (int i = 0 ; status == 0 && i < numshards ; i++)
+		status = RTPReceiveShards::AttachSSRCFilter(socks[i],numshards,i);
+	shardmulticast = (status == 0);
+#endif // RTP_SUPPORT_REUSEPORT_CBPF
+	if (status == 0)
+		status = receiveshards.Start(socks,false,kerneltimestamps,params->GetPacketBufferPool(),
+		                            params->GetReceiveShardCPUs());
+
+	if (status < 0)
+	{
+		for (size_t i = 1 ; i < socks.size() ; i++)
+			RTPCLOSE(socks[i]);
+		shardmulticast = false;
+		return status;
 	}
+
+	shardsockets.assign(socks.begin()+1,socks.end());
+	return 0;
+}
+
+void RTPUDPv6Transmitter::DestroyReceiveShards()
+{
+	receiveshards.Stop();
+	for (size_t i = 0 ; i < shardsockets.size() ; i++)
+		RTPCLOSE(shardsockets[i]);
+	shardsockets.clear();
+	shardmulticast = false;
+}
+
+int RTPUDPv6Transmitter::CreateIoUring(RTPIoUring *ring)
+{
+	int status;
+
+	if ((status = ring->AddSocket(rtpsock,sizeof(struct sockaddr_in6),&rtpreadydesc)) < 0)
+		return status;
+	if ((status = ring->AddSocket(rtcpsock,sizeof(struct sockaddr_in6),&rtcpreadydesc)) < 0)
+	{
+		ring->RemoveSocket(rtpsock);
+		return status;
+	}
+	iouring = ring;
+	return 0;
+}
+
+void RTPUDPv6Transmitter::DestroyIoUring()
+{
+	if (iouring == 0)
+		return;
+
+	iouring->RemoveSocket(rtpsock);
+	iouring->RemoveSocket(rtcpsock);
+	iouring = 0;
+}
+
+int RTPUDPv6Transmitter::PollIoUring()
+{
+	int status = 0;
+
+	for (int i = 0 ; i < 2 ; i++)
+	{
+		bool rtp = (i == 0);
+		int sock = (rtp) ? rtpsock : rtcpsock;
+		std::list<RTPIoUring::Datagram> datagrams;
+
+		// 接收请求不能重新发出时仍然处理已取到的数据报，再报告错误
+		int collectstatus = iouring->CollectDatagrams(sock,datagrams,packetring.GetCapacity()-packetring.GetSize());
+
+		if (collectstatus < 0 && status >= 0)
+			status = collectstatus;
+		for (std::list<RTPIoUring::Datagram>::iterator it = datagrams.begin() ; it != datagrams.end() ; ++it)
+		{
+			const struct sockaddr_in6 *srcaddr = (const struct sockaddr_in6 *)&it->address;
+
+			if (receivemode != RTPTransmitter::AcceptAll && !ShouldAcceptData(srcaddr->sin6_addr,ntohs(srcaddr->sin6_port)))
+			{
+				it->buffer->Release();
+				continue;
+			}
+
+			RTPEndpoint *addr = new RTPEndpoint(RTPEndpoint::CreateFromSockAddr((const struct sockaddr *)srcaddr));
+			RTPRawPacket *pack = new RTPRawPacket(it->data,it->length,addr,it->receivetime,rtp);
+
+			pack->SetDataReleaser(it->buffer); // 数据包接管数据报的引用
+			packetring.Push(pack);
+		}
+	}
+	return status;
+}
+
+int RTPUDPv6Transmitter::SendThroughIoUring(int sock,const void *data,size_t len,bool rtp)
+{
+	bool queued = false;
+
+	// 发往所有目的地址的数据报只需一次提交
+	for (const auto& dest : destinations)
+	{
+		const struct sockaddr *addr = (rtp) ? dest.GetRtpSockAddr() : dest.GetRtcpSockAddr();
+
+		if (iouring->QueueSend(sock,data,len,addr,dest.GetSockAddrLen()) >= 0)
+			queued = true;
+		else
+			sendto(sock,(const char *)data,len,0,addr,dest.GetSockAddrLen()); // 提交队列已满
+	}
+	if (queued)
+		return iouring->Submit();
 	return 0;
 }
 
+bool RTPUDPv6Transmitter::IsUsingIoUring()
+{
+	if (!init)
+		return false;
+
+	MAINMUTEX_LOCK
+	bool used = created && iouring != 0;
+	MAINMUTEX_UNLOCK
+	return used;
+}
+
+uint64_t RTPUDPv6Transmitter::GetReceiveQueueDroppedPackets()
+{
+	if (!init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	uint64_t dropped = receiveshards.GetDroppedPackets();
+	MAINMUTEX_UNLOCK
+	return dropped;
+}
+
+size_t RTPUDPv6Transmitter::GetReceiveQueueHighWaterMark()
+{
+	if (!init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	size_t highwater = receiveshards.GetHighWaterMark();
+	MAINMUTEX_UNLOCK
+	return highwater;
+}
+
+void RTPUDPv6Transmitter::PollReceiveShards()
+{
+	RTPRawPacket *pack;
+
+	// 数据包从接收线程的队列直接移到传输器的队列；队列已满时剩下的留在接收线程的队列中，
+	// 并保持就绪信号，下一次 Poll 继续取
+	receiveshards.ClearReadySignal();
+	while (true)
+	{
+		if (packetring.IsFull())
+		{
+			receiveshards.SignalReady();
+			break;
+		}
+		if ((pack = receiveshards.PopPacket()) == 0)
+			break;
+
+		const RTPEndpoint *addr = pack->GetSenderAddress();
+		in6_addr srcip;
+
+		// 接收线程把映射的地址恢复为IPv4端点，接受/忽略列表中保存的是映射后的地址
+		if (receivemode == RTPTransmitter::AcceptAll || (GetSocketIP(*addr,&srcip) && ShouldAcceptData(srcip,addr->GetRtpPort())))
+			packetring.Push(pack);
+		else
+			delete pack;
+	}
+}
+
 int RTPUDPv6Transmitter::ProcessAddAcceptIgnoreEntry(in6_addr ip,uint16_t port)
 {
 	auto it = acceptignoreinfo.find(ip);
@@ -1441,6 +2001,11 @@ bool RTPUDPv6Transmitter::GetLocalIPList_Interfaces()
 			struct sockaddr_in6 *inaddr = (struct sockaddr_in6 *)tmp->ifa_addr;
 			localIPs.push_back(inaddr->sin6_addr);
 		}
+		else if (dualstack && tmp->ifa_addr != 0 && tmp->ifa_addr->sa_family == AF_INET)
+		{
+			struct sockaddr_in *inaddr = (struct sockaddr_in *)tmp->ifa_addr;
+			localIPs.push_back(RTPUDPv6MapIPv4(ntohl(inaddr->sin_addr.s_addr)));
+		}
 		tmp = tmp->ifa_next;
 	}
 	
@@ -1506,6 +2071,20 @@ void RTPUDPv6Transmitter::AddLoopbackAddress()
 
 	if (!found)
 		localIPs.push_back(in6addr_loopback);
+
+	if (dualstack)
+	{
+		in6_addr loopback4 = RTPUDPv6MapIPv4(INADDR_LOOPBACK);
+
+		found = false;
+		for (it = localIPs.begin() ; !found && it != localIPs.end() ; it++)
+		{
+			if (memcmp(&(*it), &loopback4, sizeof(in6_addr)) == 0)
+				found = true;
+		}
+		if (!found)
+			localIPs.push_back(loopback4);
+	}
 }
 
 #endif // RTP_SUPPORT_IPV6
@@ -7,7 +7,13 @@
 #include "media_rtp_abort_descriptors.h"
 #include "media_rtp_endpoint.h"
 #include "media_rtp_transmitter.h"
+#include "media_rtp_transmit_timestamps.h"
+#include "media_rtp_receive_shards.h"
+#include "media_rtp_io_uring.h"
+#include "media_rtp_packet_buffer.h"
+#include "media_rtp_packet_ring.h"
 #include <list>
+#include <vector>
 #include <string.h>
 #include <unordered_map>
 #include <unordered_set>
@@ -74,6 +80,34 @@ public:
   /** 设置RTCP套接字的接收缓冲区大小。 */
   void SetRTCPReceiveBuffer(int s) { rtcprecvbuf = s; }
 
+  /** 启用后，套接字上会设置 SO_TIMESTAMPNS，数据包的接收时间取自内核时间戳，
+   *  而不是轮询时的当前时间；系统不支持时自动使用当前时间。 */
+  void SetUseKernelReceiveTimestamps(bool f) { kerneltimestamps = f; }
+
+  /** 启用后，RTP套接字上会设置 SO_TIMESTAMPING，从错误队列中收集每个RTP数据包的软件发送时间戳，
+   *  会话用它们来计算发送者报告中的NTP时间戳和RTP时间戳；系统不支持时忽略此选项。 */
+  void SetUseKernelTransmitTimestamps(bool f) { kerneltxtimestamps = f; }
+
+  /** 启用后，RTP和RTCP通道各使用一个关闭了 IPV6_V6ONLY 的套接字，同时收发IPv4和IPv6数据包：
+   *  IPv4端点可以用作目的地址、接受/忽略列表条目和多播组，来自IPv4发送端的数据包的源地址
+   *  是IPv4端点。绑定地址应为通配地址，系统不支持时创建失败。 */
+  void SetDualStack(bool f) { dualstack = f; }
+
+  /** 设置接收RTP数据的线程数，参见 RTPUDPv4TransmissionParams::SetReceiveShards；
+   *  双栈模式下来自IPv4发送端的数据包同样按SSRC分配。大于1时必须指定端口基数。 */
+  void SetReceiveShards(int n) { receiveshards = n; }
+
+  /** 设置接收线程绑定的CPU，参见 RTPUDPv4TransmissionParams::SetReceiveShardCPUs。 */
+  void SetReceiveShardCPUs(const std::vector<int> &cpus) { shardcpus = cpus; }
+
+  /** 如果非空且已初始化，套接字的接收和发送通过这个 io_uring 实例进行，
+   *  参见 RTPUDPv4TransmissionParams::SetIoUring。 */
+  void SetIoUring(RTPIoUring *ring) { iouring = ring; }
+
+  /** 设置存放收到的数据包的引用计数缓冲区池，参见 RTPUDPv4TransmissionParams::SetPacketBufferPool；
+   *  为空（默认值）时传输器使用自己的池。 */
+  void SetPacketBufferPool(RTPPacketBufferPool *pool) { bufferpool = pool; }
+
   /** 如果非空，指定的中止描述符将用于取消
    *  等待数据包到达的函数；设置为null（默认值）
    *  让传输器创建自己的实例。 */
@@ -93,6 +127,27 @@ public:
   /** 返回RTCP套接字的接收缓冲区大小。 */
   int GetRTCPReceiveBuffer() const { return rtcprecvbuf; }
 
+  /** 如果使用内核接收时间戳则返回true（默认为false）。 */
+  bool GetUseKernelReceiveTimestamps() const { return kerneltimestamps; }
+
+  /** 如果使用内核发送时间戳则返回true（默认为false）。 */
+  bool GetUseKernelTransmitTimestamps() const { return kerneltxtimestamps; }
+
+  /** 如果同时收发IPv4和IPv6数据包则返回true（默认为false）。 */
+  bool GetDualStack() const { return dualstack; }
+
+  /** 返回接收RTP数据的线程数（默认为1）。 */
+  int GetReceiveShards() const { return receiveshards; }
+
+  /** 返回接收线程绑定的CPU列表。 */
+  const std::vector<int> &GetReceiveShardCPUs() const { return shardcpus; }
+
+  /** 返回用于接收和发送的 io_uring 实例，为空时使用普通的套接字调用。 */
+  RTPIoUring *GetIoUring() const { return iouring; }
+
+  /** 返回存放收到的数据包的缓冲区池，为空时传输器使用自己的池。 */
+  RTPPacketBufferPool *GetPacketBufferPool() const { return bufferpool; }
+
   /** 如果非空，此RTPAbortDescriptors实例将在内部使用，
    *  这在为多个会话创建自己的轮询线程时很有用。 */
   RTPAbortDescriptors *GetCreatedAbortDescriptors() const {
@@ -107,6 +162,13 @@ private:
   uint8_t multicastTTL;
   int rtpsendbuf, rtprecvbuf;
   int rtcpsendbuf, rtcprecvbuf;
+  bool kerneltimestamps;
+  bool kerneltxtimestamps;
+  bool dualstack;
+  int receiveshards;
+  std::vector<int> shardcpus;
+  RTPIoUring *iouring;
+  RTPPacketBufferPool *bufferpool;
 
   RTPAbortDescriptors *m_pAbortDesc;
 };
@@ -123,6 +185,12 @@ inline RTPUDPv6TransmissionParams::RTPUDPv6TransmissionParams()
   rtprecvbuf = RTPUDPV6TRANS_RTPRECEIVEBUFFER;
   rtcpsendbuf = RTPUDPV6TRANS_RTCPTRANSMITBUFFER;
   rtcprecvbuf = RTPUDPV6TRANS_RTCPRECEIVEBUFFER;
+  kerneltimestamps = false;
+  kerneltxtimestamps = false;
+  dualstack = false;
+  receiveshards = 1;
+  iouring = 0;
+  bufferpool = 0;
 
   m_pAbortDesc = 0;
 }
@@ -169,7 +237,9 @@ private:
  *  此类继承RTPTransmitter接口并实现一个传输组件，
  *  该组件使用UDP over IPv6来发送和接收RTP和RTCP数据。组件的参数
  *  由类RTPUDPv6TransmissionParams描述。具有RTPEndpoint
- *  参数的函数需要RTPIPv6Address类型的参数。GetTransmissionInfo成员函数
+ *  参数的函数需要RTPIPv6Address类型的参数，启用双栈模式时（参见
+ *  RTPUDPv6TransmissionParams::SetDualStack）也接受IPv4端点，它们在内部映射为
+ *  ::ffff:a.b.c.d 形式的地址。GetTransmissionInfo成员函数
  *  返回RTPUDPv6TransmissionInfo类型的实例。
  */
 class RTPUDPv6Transmitter : public RTPTransmitter {
@@ -194,6 +264,8 @@ public:
 
   int SendRTPData(const void *data, size_t len);
   int SendRTCPData(const void *data, size_t len);
+  int SendRTPDataV(const void *header, size_t headerlen, const void *payload,
+                   size_t payloadlen);
 
   int AddDestination(const RTPEndpoint &addr);
   int DeleteDestination(const RTPEndpoint &addr);
@@ -215,6 +287,22 @@ public:
 
   bool NewDataAvailable();
   RTPRawPacket *GetNextPacket();
+  bool GetNextTransmitTimestamp(uint32_t *ssrc, uint32_t *rtptimestamp,
+                                RTPTime *sendtime);
+  int GetReceiveDescriptors(std::vector<int> &descriptors);
+  int GetAbortDescriptor(int *descriptor);
+  int PollDescriptor(int descriptor);
+
+  /** 返回接收线程的队列因 Poll 调用不及时而丢弃的数据包数量
+   *  （参见 RTPUDPv6TransmissionParams::SetReceiveShards）。 */
+  uint64_t GetReceiveQueueDroppedPackets();
+
+  /** 返回接收线程的队列中曾经积压的最多数据包数量。 */
+  size_t GetReceiveQueueHighWaterMark();
+
+  /** 如果套接字通过 io_uring 接收和发送数据则返回 \c true
+   *  （参见 RTPUDPv6TransmissionParams::SetIoUring）。 */
+  bool IsUsingIoUring();
 
 private:
   int CreateLocalIPList();
@@ -223,10 +311,19 @@ private:
   void AddLoopbackAddress();
   void FlushPackets();
   int PollSocket(bool rtp);
+  int CreateReceiveShards(const RTPUDPv6TransmissionParams *params);
+  void DestroyReceiveShards();
+  void PollReceiveShards();
+  int CreateIoUring(RTPIoUring *ring);
+  void DestroyIoUring();
+  int PollIoUring();
+  int SendThroughIoUring(int sock, const void *data, size_t len, bool rtp);
+  bool GetSocketIP(const RTPEndpoint &addr, in6_addr *ip);
   int ProcessAddAcceptIgnoreEntry(in6_addr ip, uint16_t port);
   int ProcessDeleteAcceptIgnoreEntry(in6_addr ip, uint16_t port);
 #ifdef RTP_SUPPORT_IPV6MULTICAST
   bool SetMulticastTTL(uint8_t ttl);
+  void DropShardMemberships(const in6_addr &mcastIP);
 #endif // RTP_SUPPORT_IPV6MULTICAST
   bool ShouldAcceptData(in6_addr srcip, uint16_t srcport);
   void ClearAcceptIgnoreInfo();
@@ -235,6 +332,14 @@ private:
   bool created;
   bool waitingfordata;
   int rtpsock, rtcpsock;
+  bool kerneltimestamps;
+  bool dualstack;
+  RTPTransmitTimestamps txtimestamps;
+  RTPReceiveShards receiveshards;
+  std::vector<int> shardsockets;
+  bool shardmulticast; // 接收线程的套接字按SSRC过滤，都加入多播组
+  RTPIoUring *iouring;
+  int rtpreadydesc, rtcpreadydesc;
   in6_addr bindIP;
   unsigned int mcastifidx;
   std::list<in6_addr> localIPs;
@@ -249,7 +354,9 @@ private:
 #ifdef RTP_SUPPORT_IPV6MULTICAST
   std::unordered_set<in6_addr> multicastgroups;
 #endif // RTP_SUPPORT_IPV6MULTICAST
-  std::list<RTPRawPacket *> rawpacketlist;
+  // Poll 放入数据包（持有主互斥锁），GetNextPacket 取出（只持有接收互斥锁）
+  RTPPacketRing packetring;
+  RTPPacketBufferPool *bufferpool;
 
   bool supportsmulticasting;
   size_t maxpacksize;
@@ -266,7 +373,7 @@ private:
   RTPAbortDescriptors m_abortDesc;
   RTPAbortDescriptors *m_pAbortDesc;
 
-  std::mutex mainmutex, waitmutex;
+  std::mutex mainmutex, waitmutex, receivemutex;
   int threadsafe;
 };
 
@@ -0,0 +1,906 @@
+#include "media_rtp_unix_transmitter.h"
+#include "media_rtp_packet_factory.h"
+#include "media_rtp_packet_buffer.h"
+#include "media_rtp_structs.h"
+#include "media_rtp_errors.h"
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdexcept>
+
+#define RTPUNIXTRANS_MAXPACKSIZE							65535
+
+	#define MAINMUTEX_LOCK 		{ if (m_threadsafe) m_mainMutex.lock(); }
+	#define MAINMUTEX_UNLOCK	{ if (m_threadsafe) m_mainMutex.unlock(); }
+	#define WAITMUTEX_LOCK		{ if (m_threadsafe) m_waitMutex.lock(); }
+	#define WAITMUTEX_UNLOCK	{ if (m_threadsafe) m_waitMutex.unlock(); }
+
+RTPUnixTransmitter::RTPUnixTransmitter() : RTPTransmitter()
+{
+	m_created = false;
+	bufferpool = 0;
+	m_init = false;
+}
+
+RTPUnixTransmitter::~RTPUnixTransmitter()
+{
+	Destroy();
+}
+
+int RTPUnixTransmitter::Init(bool tsafe)
+{
+	if (m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	m_threadsafe = tsafe;
+
+	m_maxPackSize = RTPUNIXTRANS_MAXPACKSIZE;
+	m_init = true;
+	return 0;
+}
+
+int RTPUnixTransmitter::Create(size_t maximumpacketsize,const RTPTransmissionParams *transparams)
+{
+	const RTPUnixTransmissionParams *params,defaultparams;
+	int status;
+
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 获取传输参数
+
+	if (transparams == 0)
+		params = &defaultparams;
+	else
+	{
+		if (transparams->GetTransmissionProtocol() != RTPTransmitter::UnixProto)
+		{
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_INVALID_PARAMETER;
+		}
+		params = static_cast<const RTPUnixTransmissionParams *>(transparams);
+	}
+	if (maximumpacketsize > RTPUNIXTRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+
+	// 只有抽象命名空间支持由内核自动分配地址
+	abstractaddr = params->GetAbstractAddresses();
+	if (!abstractaddr && (params->GetRTPPath().empty() || (!params->GetRTCPMultiplexing() && params->GetRTCPPath().empty())))
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+	if (params->GetReceiveBatchSize() == 0)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	if (!params->GetCreatedAbortDescriptors())
+	{
+		if ((status = m_abortDesc.Init()) < 0)
+		{
+			MAINMUTEX_UNLOCK
+			return status;
+		}
+		m_pAbortDesc = &m_abortDesc;
+	}
+	else
+	{
+		m_pAbortDesc = params->GetCreatedAbortDescriptors();
+		if (!m_pAbortDesc->IsInitialized())
+		{
+			MAINMUTEX_UNLOCK
+			return MEDIA_RTP_ERR_INVALID_STATE;
+		}
+	}
+
+	// 创建套接字
+
+	rtpsock = -1;
+	rtcpsock = -1;
+	rtppath.clear();
+	rtcppath.clear();
+
+	status = CreateSocket(params->GetRTPPath(),&rtpsock,&rtppath);
+	if (status >= 0)
+	{
+		if (params->GetRTCPMultiplexing())
+		{
+			rtcpsock = rtpsock;
+			rtcppath = rtppath;
+		}
+		else
+			status = CreateSocket(params->GetRTCPPath(),&rtcpsock,&rtcppath);
+	}
+	if (status >= 0)
+	{
+		int size = params->GetReceiveBuffer();
+
+		if (setsockopt(rtpsock,SOL_SOCKET,SO_RCVBUF,(const char *)&size,sizeof(int)) != 0 ||
+		    setsockopt(rtcpsock,SOL_SOCKET,SO_RCVBUF,(const char *)&size,sizeof(int)) != 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+		size = params->GetSendBuffer();
+		if (setsockopt(rtpsock,SOL_SOCKET,SO_SNDBUF,(const char *)&size,sizeof(int)) != 0 ||
+		    setsockopt(rtcpsock,SOL_SOCKET,SO_SNDBUF,(const char *)&size,sizeof(int)) != 0)
+			status = MEDIA_RTP_ERR_OPERATION_FAILED;
+	}
+	if (status < 0)
+	{
+		CloseSockets();
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		return status;
+	}
+
+	batchsize = params->GetReceiveBatchSize();
+	m_maxPackSize = maximumpacketsize;
+	AllocateReceiveBuffers();
+	bufferpool = RTPPacketBufferPool::Create(RTP_PACKETBUFFER_DEFAULTSIZE,RTP_PACKETBUFFER_TRANSMITTERMAXFREE);
+
+	lastsourcelen = 0;
+	dropped = 0;
+	m_waitingForData = false;
+	m_created = true;
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+void RTPUnixTransmitter::Destroy()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK;
+		return;
+	}
+
+	FlushPackets();
+	bufferpool->Release(); // 应用程序仍持有的数据包释放之后池才被删除
+	bufferpool = 0;
+	CloseSockets();
+	destinations.clear();
+	lastsource = RTPEndpoint();
+	lastsourcelen = 0;
+	m_created = false;
+
+	if (m_waitingForData)
+	{
+		m_pAbortDesc->SendAbortSignal();
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_LOCK // 确保 WaitForIncomingData 函数已结束
+		WAITMUTEX_UNLOCK
+	}
+	else
+		m_abortDesc.Destroy(); // 如果未初始化，则不执行任何操作
+
+	MAINMUTEX_UNLOCK
+}
+
+RTPTransmissionInfo *RTPUnixTransmitter::GetTransmissionInfo()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	RTPTransmissionInfo *tinf = 0;
+
+	if (m_created)
+		tinf = new RTPUnixTransmissionInfo(RTPEndpoint::CreateUnix(rtppath,rtcppath,abstractaddr),rtpsock,rtcpsock);
+	MAINMUTEX_UNLOCK
+	return tinf;
+}
+
+void RTPUnixTransmitter::DeleteTransmissionInfo(RTPTransmissionInfo *i)
+{
+	if (!m_init)
+		return;
+
+	delete i;
+}
+
+int RTPUnixTransmitter::GetLocalHostName(uint8_t *buffer,size_t *bufferlength)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	// 所有的对端都在同一主机上
+	const char *str = "localhost";
+	size_t len = strlen(str);
+
+	if ((*bufferlength) < len)
+	{
+		*bufferlength = len; // 告诉应用程序所需的缓冲区大小
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	memcpy(buffer,str,len);
+	*bufferlength = len;
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPUnixTransmitter::ComesFromThisTransmitter(const RTPEndpoint *addr)
+{
+	if (!m_init)
+		return false;
+
+	if (addr == 0)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v = false;
+
+	// 接收到的数据包的源地址只有一个路径，可能来自RTP或RTCP套接字
+	if (m_created && addr->GetType() == RTPEndpoint::Unix && addr->IsAbstractUnixAddress() == abstractaddr)
+	{
+		const std::string &path = addr->GetUnixPath();
+
+		if (path == rtppath || path == rtcppath)
+			v = true;
+	}
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+int RTPUnixTransmitter::Poll()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	int status = PollSocket(true);
+	if (status >= 0 && rtcpsock != rtpsock)
+		status = PollSocket(false);
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPUnixTransmitter::WaitForIncomingData(const RTPTime &delay,bool *dataavailable)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	int socks[3];
+	int8_t readflags[3] = { 0, 0, 0 };
+	size_t numsocks = 0;
+
+	socks[numsocks++] = rtpsock;
+	if (rtcpsock != rtpsock)
+		socks[numsocks++] = rtcpsock;
+	socks[numsocks++] = m_pAbortDesc->GetAbortSocket();
+
+	m_waitingForData = true;
+
+	WAITMUTEX_LOCK
+	MAINMUTEX_UNLOCK
+
+	int status = RTPSelect(socks,readflags,numsocks,delay);
+	if (status < 0)
+	{
+		MAINMUTEX_LOCK
+		m_waitingForData = false;
+		MAINMUTEX_UNLOCK
+		WAITMUTEX_UNLOCK
+		return status;
+	}
+
+	MAINMUTEX_LOCK
+	m_waitingForData = false;
+	if (!m_created) // 调用了销毁
+	{
+		MAINMUTEX_UNLOCK;
+		WAITMUTEX_UNLOCK
+		return 0;
+	}
+
+	// 如果中止，则从中止缓冲区读取
+	if (readflags[numsocks-1])
+		m_pAbortDesc->ReadSignallingByte();
+
+	if (dataavailable != 0)
+		*dataavailable = (readflags[0] || (numsocks == 3 && readflags[1]));
+
+	MAINMUTEX_UNLOCK
+	WAITMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUnixTransmitter::AbortWait()
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (!m_waitingForData)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	m_pAbortDesc->SendAbortSignal();
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUnixTransmitter::GetReceiveDescriptors(std::vector<int> &descriptors)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	descriptors.push_back(rtpsock);
+	if (rtcpsock != rtpsock)
+		descriptors.push_back(rtcpsock);
+
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUnixTransmitter::GetAbortDescriptor(int *descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	*descriptor = m_pAbortDesc->GetAbortSocket();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+int RTPUnixTransmitter::PollDescriptor(int descriptor)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	int status = MEDIA_RTP_ERR_INVALID_PARAMETER;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	if (descriptor == m_pAbortDesc->GetAbortSocket())
+	{
+		m_pAbortDesc->ReadSignallingByte();
+		status = 0;
+	}
+	else if (descriptor == rtpsock)
+		status = PollSocket(true);
+	else if (descriptor == rtcpsock)
+		status = PollSocket(false);
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPUnixTransmitter::SendRTPData(const void *data,size_t len)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	int status = SendData(rtpsock,data,len,true);
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPUnixTransmitter::SendRTCPData(const void *data,size_t len)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+
+	int status = SendData(rtcpsock,data,len,false);
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPUnixTransmitter::AddDestination(const RTPEndpoint &addr)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (addr.GetType() != RTPEndpoint::Unix)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	auto result = destinations.insert(addr);
+	int status = result.second ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+int RTPUnixTransmitter::DeleteDestination(const RTPEndpoint &addr)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (addr.GetType() != RTPEndpoint::Unix)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_PARAMETER;
+	}
+
+	size_t erased = destinations.erase(addr);
+	int status = erased > 0 ? 0 : MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_UNLOCK
+	return status;
+}
+
+void RTPUnixTransmitter::ClearDestinations()
+{
+	if (!m_init)
+		return;
+
+	MAINMUTEX_LOCK
+	if (m_created)
+		destinations.clear();
+	MAINMUTEX_UNLOCK
+}
+
+bool RTPUnixTransmitter::SupportsMulticasting()
+{
+	return false;
+}
+
+int RTPUnixTransmitter::JoinMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPUnixTransmitter::LeaveMulticastGroup(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPUnixTransmitter::LeaveAllMulticastGroups()
+{
+}
+
+int RTPUnixTransmitter::SetReceiveMode(RTPTransmitter::ReceiveMode m)
+{
+	if (m != RTPTransmitter::AcceptAll)
+		return MEDIA_RTP_ERR_OPERATION_FAILED;
+	return 0;
+}
+
+int RTPUnixTransmitter::AddToIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPUnixTransmitter::DeleteFromIgnoreList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPUnixTransmitter::ClearIgnoreList()
+{
+}
+
+int RTPUnixTransmitter::AddToAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+int RTPUnixTransmitter::DeleteFromAcceptList(const RTPEndpoint &)
+{
+	return MEDIA_RTP_ERR_OPERATION_FAILED;
+}
+
+void RTPUnixTransmitter::ClearAcceptList()
+{
+}
+
+int RTPUnixTransmitter::SetMaximumPacketSize(size_t s)
+{
+	if (!m_init)
+		return MEDIA_RTP_ERR_INVALID_STATE;
+
+	MAINMUTEX_LOCK
+	if (!m_created)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_INVALID_STATE;
+	}
+	if (s > RTPUNIXTRANS_MAXPACKSIZE)
+	{
+		MAINMUTEX_UNLOCK
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	}
+	m_maxPackSize = s;
+	AllocateReceiveBuffers();
+	MAINMUTEX_UNLOCK
+	return 0;
+}
+
+bool RTPUnixTransmitter::NewDataAvailable()
+{
+	if (!m_init)
+		return false;
+
+	MAINMUTEX_LOCK
+
+	bool v;
+
+	if (!m_created)
+		v = false;
+	else
+		v = !m_rawpacketlist.empty();
+
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+RTPRawPacket *RTPUnixTransmitter::GetNextPacket()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+
+	RTPRawPacket *p;
+
+	if (!m_created || m_rawpacketlist.empty())
+	{
+		MAINMUTEX_UNLOCK
+		return 0;
+	}
+
+	p = m_rawpacketlist.front();
+	m_rawpacketlist.pop_front();
+
+	MAINMUTEX_UNLOCK
+	return p;
+}
+
+uint64_t RTPUnixTransmitter::GetDroppedPackets()
+{
+	if (!m_init)
+		return 0;
+
+	MAINMUTEX_LOCK
+	uint64_t v = dropped;
+	MAINMUTEX_UNLOCK
+	return v;
+}
+
+// 私有函数从这里开始...
+
+int RTPUnixTransmitter::CreateSocket(const std::string &path,int *sock,std::string *boundpath)
+{
+	int s = socket(AF_UNIX,SOCK_DGRAM|SOCK_CLOEXEC,0);
+
+	if (s < 0)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+
+	if (path.empty())
+	{
+		// 只传入地址族时内核在抽象命名空间中分配一个唯一的名字
+		struct sockaddr_un addr;
+		socklen_t addrlen = sizeof(sa_family_t);
+
+		memset(&addr,0,sizeof(struct sockaddr_un));
+		addr.sun_family = AF_UNIX;
+		if (bind(s,(struct sockaddr *)&addr,addrlen) != 0)
+		{
+			close(s);
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+		addrlen = sizeof(struct sockaddr_un);
+		if (getsockname(s,(struct sockaddr *)&addr,&addrlen) != 0 || addrlen <= offsetof(struct sockaddr_un,sun_path)+1)
+		{
+			close(s);
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+		boundpath->assign(addr.sun_path+1,addrlen-offsetof(struct sockaddr_un,sun_path)-1);
+	}
+	else
+	{
+		RTPEndpoint local;
+
+		try
+		{
+			local = RTPEndpoint::CreateUnix(path,std::string(),abstractaddr);
+		}
+		catch (const std::length_error &)
+		{
+			close(s);
+			return MEDIA_RTP_ERR_INVALID_PARAMETER;
+		}
+
+		// 文件系统中已存在的路径不会被覆盖，bind 返回 EADDRINUSE
+		if (bind(s,local.GetRtpSockAddr(),local.GetSockAddrLen()) != 0)
+		{
+			close(s);
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+		*boundpath = path;
+	}
+
+	*sock = s;
+	return 0;
+}
+
+void RTPUnixTransmitter::CloseSockets()
+{
+	if (rtcpsock >= 0 && rtcpsock != rtpsock)
+	{
+		close(rtcpsock);
+		if (!abstractaddr && !rtcppath.empty())
+			unlink(rtcppath.c_str());
+	}
+	if (rtpsock >= 0)
+	{
+		close(rtpsock);
+		if (!abstractaddr && !rtppath.empty())
+			unlink(rtppath.c_str());
+	}
+	rtpsock = -1;
+	rtcpsock = -1;
+}
+
+void RTPUnixTransmitter::AllocateReceiveBuffers()
+{
+	recvbuffer.resize(batchsize*m_maxPackSize);
+	recvmsgs.resize(batchsize);
+	recviovecs.resize(batchsize);
+	recvaddrs.resize(batchsize);
+
+	for (size_t i = 0 ; i < batchsize ; i++)
+	{
+		recviovecs[i].iov_base = recvbuffer.data()+i*m_maxPackSize;
+		recviovecs[i].iov_len = m_maxPackSize;
+
+		memset(&recvmsgs[i],0,sizeof(struct mmsghdr));
+		recvmsgs[i].msg_hdr.msg_name = &recvaddrs[i];
+		recvmsgs[i].msg_hdr.msg_iov = &recviovecs[i];
+		recvmsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+}
+
+int RTPUnixTransmitter::PollSocket(bool rtp)
+{
+	int sock = (rtp) ? rtpsock : rtcpsock;
+	bool rtcpmux = (rtp && rtpsock == rtcpsock);
+
+	while (true)
+	{
+		for (size_t i = 0 ; i < batchsize ; i++)
+			recvmsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_un);
+
+		int count = recvmmsg(sock,recvmsgs.data(),(unsigned int)batchsize,MSG_DONTWAIT,0);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			return MEDIA_RTP_ERR_OPERATION_FAILED;
+		}
+
+		// 同一批数据包共享一个接收时间
+		RTPTime curtime = RTPTime::CurrentTime();
+
+		for (int i = 0 ; i < count ; i++)
+		{
+			const struct msghdr &hdr = recvmsgs[i].msg_hdr;
+			size_t recvlen = recvmsgs[i].msg_len;
+
+			// 大于最大数据包大小的数据包被截断，直接丢弃
+			if ((hdr.msg_flags&MSG_TRUNC) || recvlen == 0)
+				continue;
+
+			RTPPacketBuffer *buf = bufferpool->Allocate(recvlen);
+			uint8_t *datacopy = buf->GetData();
+
+			memcpy(datacopy,recviovecs[i].iov_base,recvlen);
+
+			bool isrtp = rtp;
+
+			if (rtcpmux) // 检查负载类型，RTCP数据包的类型在200到204之间
+			{
+				if (recvlen > sizeof(RTCPCommonHeader))
+				{
+					uint8_t packettype = ((RTCPCommonHeader *)datacopy)->packettype;
+
+					if (packettype >= 200 && packettype <= 204)
+						isrtp = false;
+				}
+			}
+
+			RTPEndpoint *addr = GetSourceEndpoint(recvaddrs[i],hdr.msg_namelen);
+			RTPRawPacket *pack = new RTPRawPacket(datacopy,recvlen,addr,curtime,isrtp);
+
+			pack->SetDataReleaser(buf);
+			m_rawpacketlist.push_back(pack);
+		}
+
+		// 没有填满这一批时套接字已经读空，省去一次返回 EAGAIN 的系统调用
+		if ((size_t)count < batchsize)
+			break;
+	}
+	return 0;
+}
+
+int RTPUnixTransmitter::SendData(int sock,const void *data,size_t len,bool rtp)
+{
+	if (len > m_maxPackSize)
+		return MEDIA_RTP_ERR_RESOURCE_ERROR;
+	if (destinations.empty())
+		return 0;
+
+	// 所有目的地共享同一个数据缓冲区，一次系统调用发送
+	struct iovec iov;
+
+	iov.iov_base = const_cast<void *>(data);
+	iov.iov_len = len;
+
+	sendmsgs.resize(destinations.size());
+
+	size_t num = 0;
+
+	for (const auto &dest : destinations)
+	{
+		struct msghdr &hdr = sendmsgs[num++].msg_hdr;
+
+		memset(&hdr,0,sizeof(struct msghdr));
+		hdr.msg_name = const_cast<struct sockaddr *>((rtp) ? dest.GetRtpSockAddr() : dest.GetRtcpSockAddr());
+		hdr.msg_namelen = (rtp) ? dest.GetSockAddrLen() : dest.GetRtcpSockAddrLen();
+		hdr.msg_iov = &iov;
+		hdr.msg_iovlen = 1;
+	}
+
+	// sendmmsg 在第一个失败的消息处停止，下一次调用从这个消息开始时返回它的错误；
+	// 和UDP一样，对端的队列已满或地址上没有套接字时丢弃这个目的地的数据包
+	size_t pos = 0;
+
+	while (pos < num)
+	{
+		int status = sendmmsg(sock,&sendmsgs[pos],(unsigned int)(num-pos),MSG_DONTWAIT);
+
+		if (status < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			dropped++;
+			pos++;
+		}
+		else
+			pos += (size_t)status;
+	}
+	return 0;
+}
+
+RTPEndpoint *RTPUnixTransmitter::GetSourceEndpoint(const struct sockaddr_un &addr,socklen_t addrlen)
+{
+	// 大多数时候连续的数据包来自同一个对端，复制缓存的端点只增加共享地址的引用计数
+	if (lastsourcelen != 0 && addrlen == lastsourcelen && memcmp(&addr,&lastsourceaddr,addrlen) == 0)
+		return new RTPEndpoint(lastsource);
+
+	size_t offset = offsetof(struct sockaddr_un,sun_path);
+	std::string path;
+	bool abstract = false;
+
+	if (addrlen > offset)
+	{
+		if (addr.sun_path[0] == 0)
+		{
+			abstract = true;
+			path.assign(addr.sun_path+1,addrlen-offset-1);
+		}
+		else
+			path.assign(addr.sun_path,strnlen(addr.sun_path,addrlen-offset));
+	}
+	// 未绑定地址的发送端得到一个空的路径
+
+	lastsource = RTPEndpoint::CreateUnix(path,std::string(),abstract);
+	memcpy(&lastsourceaddr,&addr,addrlen);
+	lastsourcelen = addrlen;
+	return new RTPEndpoint(lastsource);
+}
+
+void RTPUnixTransmitter::FlushPackets()
+{
+	std::list<RTPRawPacket*>::const_iterator it;
+
+	for (it = m_rawpacketlist.begin() ; it != m_rawpacketlist.end() ; ++it)
+		delete *it;
+	m_rawpacketlist.clear();
+}
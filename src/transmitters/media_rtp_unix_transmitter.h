@@ -0,0 +1,215 @@
+/**
+ * \file media_rtp_unix_transmitter.h
+ */
+
+#ifndef RTPUNIXTRANSMITTER_H
+
+#define RTPUNIXTRANSMITTER_H
+
+#include "rtpconfig.h"
+#include "media_rtp_defines.h"
+#include "media_rtp_transmitter.h"
+#include "media_rtp_abort_descriptors.h"
+#include "media_rtp_endpoint.h"
+#include "media_rtp_utils.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#define RTPUNIXTRANS_RECEIVEBUFFER							262144
+#define RTPUNIXTRANS_SENDBUFFER								262144
+
+/** Unix域数据报传输器的参数。 */
+class RTPUnixTransmissionParams : public RTPTransmissionParams
+{
+public:
+	RTPUnixTransmissionParams();
+
+	/** 设置RTP套接字绑定的路径。为空（默认值）时由内核在抽象命名空间中分配一个唯一的地址，
+	 *  可以通过 RTPUnixTransmissionInfo::GetLocalEndpoint 获取。 */
+	void SetRTPPath(const std::string &path)						{ rtppath = path; }
+
+	/** 设置RTCP套接字绑定的路径，为空时和RTP一样自动分配；复用RTCP时不使用。 */
+	void SetRTCPPath(const std::string &path)						{ rtcppath = path; }
+
+	/** 设置路径是否属于Linux的抽象命名空间（默认为 \c true）。文件系统中的路径在创建时
+	 *  必须不存在，由传输器在销毁时删除；使用文件系统路径时不能自动分配地址。 */
+	void SetAbstractAddresses(bool f)							{ abstractaddr = f; }
+
+	/** 启用或禁用通过RTP套接字复用RTCP流量。 */
+	void SetRTCPMultiplexing(bool f)							{ rtcpmux = f; }
+
+	/** 设置套接字的接收缓冲区大小，它决定了接收端来不及处理时可以排队的数据量。 */
+	void SetReceiveBuffer(int s)								{ recvbuf = s; }
+
+	/** 设置套接字的发送缓冲区大小。 */
+	void SetSendBuffer(int s)								{ sendbuf = s; }
+
+	/** 设置一次 recvmmsg 调用最多接收的数据包数量。 */
+	void SetReceiveBatchSize(size_t n)							{ batchsize = n; }
+
+	/** 如果非空，将使用指定的中止描述符来取消等待数据包到达的函数；
+	 *  设置为null（默认值）让传输器创建自己的实例。 */
+	void SetCreatedAbortDescriptors(RTPAbortDescriptors *desc)				{ m_pAbortDesc = desc; }
+
+	const std::string &GetRTPPath() const							{ return rtppath; }
+	const std::string &GetRTCPPath() const							{ return rtcppath; }
+	bool GetAbstractAddresses() const							{ return abstractaddr; }
+	bool GetRTCPMultiplexing() const							{ return rtcpmux; }
+	int GetReceiveBuffer() const								{ return recvbuf; }
+	int GetSendBuffer() const								{ return sendbuf; }
+	size_t GetReceiveBatchSize() const							{ return batchsize; }
+	RTPAbortDescriptors *GetCreatedAbortDescriptors() const					{ return m_pAbortDesc; }
+private:
+	std::string rtppath, rtcppath;
+	bool abstractaddr;
+	bool rtcpmux;
+	int recvbuf, sendbuf;
+	size_t batchsize;
+	RTPAbortDescriptors *m_pAbortDesc;
+};
+
+inline RTPUnixTransmissionParams::RTPUnixTransmissionParams() : RTPTransmissionParams(RTPTransmitter::UnixProto)
+{
+	abstractaddr = true;
+	rtcpmux = false;
+	recvbuf = RTPUNIXTRANS_RECEIVEBUFFER;
+	sendbuf = RTPUNIXTRANS_SENDBUFFER;
+	batchsize = RTP_UNIX_DEFAULTBATCH;
+	m_pAbortDesc = 0;
+}
+
+/** Unix域数据报传输器的附加信息。 */
+class RTPUnixTransmissionInfo : public RTPTransmissionInfo
+{
+public:
+	RTPUnixTransmissionInfo(const RTPEndpoint &local,int rtpsock,int rtcpsock)
+		: RTPTransmissionInfo(RTPTransmitter::UnixProto), localendpoint(local), m_rtpsocket(rtpsock), m_rtcpsocket(rtcpsock) { }
+
+	/** 返回两个套接字绑定的地址，可以直接作为对端的目的地址。 */
+	const RTPEndpoint &GetLocalEndpoint() const						{ return localendpoint; }
+
+	/** 返回RTP数据使用的套接字。 */
+	int GetRTPSocket() const								{ return m_rtpsocket; }
+
+	/** 返回RTCP数据使用的套接字。 */
+	int GetRTCPSocket() const								{ return m_rtcpsocket; }
+private:
+	RTPEndpoint localendpoint;
+	int m_rtpsocket, m_rtcpsocket;
+};
+
+#define RTPUNIXTRANS_HEADERSIZE								0
+
+/** 通过 AF_UNIX 数据报套接字在同一主机上收发数据包的传输组件，不经过UDP/IP协议栈，
+ *  同时保留内核在进程之间的隔离。组件的参数由类 RTPUnixTransmissionParams 描述，
+ *  具有 RTPEndpoint 参数的函数需要用 RTPEndpoint::CreateUnix 创建的端点。
+ *  接收时一次 recvmmsg 调用读取一批数据包，发送时一次 sendmmsg 调用把数据包发给所有目的地。
+ *  发送不会阻塞：对端的队列已满或地址上没有套接字时，这个目的地的数据包被丢弃并计数。
+ *  注意内核把每个接收套接字的队列限制为 net.unix.max_dgram_qlen 个数据包（默认为10），
+ *  接收端需要及时轮询，或者增大这个系统参数。
+ *  大于最大数据包大小的传入数据包被丢弃。不支持多播和接受/忽略列表。
+ */
+class RTPPacketBufferPool;
+
+class RTPUnixTransmitter : public RTPTransmitter
+{
+	MEDIA_RTP_NO_COPY(RTPUnixTransmitter)
+public:
+	RTPUnixTransmitter();
+	~RTPUnixTransmitter();
+
+	int Init(bool treadsafe);
+	int Create(size_t maxpacksize,const RTPTransmissionParams *transparams);
+	void Destroy();
+	RTPTransmissionInfo *GetTransmissionInfo();
+	void DeleteTransmissionInfo(RTPTransmissionInfo *inf);
+
+	int GetLocalHostName(uint8_t *buffer,size_t *bufferlength);
+	bool ComesFromThisTransmitter(const RTPEndpoint *addr);
+	size_t GetHeaderOverhead()								{ return RTPUNIXTRANS_HEADERSIZE; }
+
+	int Poll();
+	int WaitForIncomingData(const RTPTime &delay,bool *dataavailable = 0);
+	int AbortWait();
+	int GetReceiveDescriptors(std::vector<int> &descriptors);
+	int GetAbortDescriptor(int *descriptor);
+	int PollDescriptor(int descriptor);
+
+	int SendRTPData(const void *data,size_t len);
+	int SendRTCPData(const void *data,size_t len);
+
+	int AddDestination(const RTPEndpoint &addr);
+	int DeleteDestination(const RTPEndpoint &addr);
+	void ClearDestinations();
+
+	bool SupportsMulticasting();
+	int JoinMulticastGroup(const RTPEndpoint &addr);
+	int LeaveMulticastGroup(const RTPEndpoint &addr);
+	void LeaveAllMulticastGroups();
+
+	int SetReceiveMode(RTPTransmitter::ReceiveMode m);
+	int AddToIgnoreList(const RTPEndpoint &addr);
+	int DeleteFromIgnoreList(const RTPEndpoint &addr);
+	void ClearIgnoreList();
+	int AddToAcceptList(const RTPEndpoint &addr);
+	int DeleteFromAcceptList(const RTPEndpoint &addr);
+	void ClearAcceptList();
+	int SetMaximumPacketSize(size_t s);
+
+	bool NewDataAvailable();
+	RTPRawPacket *GetNextPacket();
+
+	/** 返回因对端的队列已满或地址上没有套接字而丢弃的已发送数据包数量。 */
+	uint64_t GetDroppedPackets();
+private:
+	int CreateSocket(const std::string &path,int *sock,std::string *boundpath);
+	void CloseSockets();
+	void AllocateReceiveBuffers();
+	int PollSocket(bool rtp);
+	int SendData(int sock,const void *data,size_t len,bool rtp);
+	RTPEndpoint *GetSourceEndpoint(const struct sockaddr_un &addr,socklen_t addrlen);
+	void FlushPackets();
+
+	bool m_init;
+	bool m_created;
+	bool m_waitingForData;
+
+	int rtpsock, rtcpsock;
+	bool abstractaddr;
+	std::string rtppath, rtcppath; // 实际绑定的路径
+	size_t m_maxPackSize;
+	uint64_t dropped;
+
+	// 每次 recvmmsg 使用的缓冲区和消息头，每个数据包一个最大数据包大小的缓冲区
+	size_t batchsize;
+	std::vector<uint8_t> recvbuffer;
+	std::vector<struct mmsghdr> recvmsgs;
+	std::vector<struct iovec> recviovecs;
+	std::vector<struct sockaddr_un> recvaddrs;
+
+	// 上一个数据包的源地址，同一个对端连续发来的数据包共享一个端点
+	struct sockaddr_un lastsourceaddr;
+	socklen_t lastsourcelen;
+	RTPEndpoint lastsource;
+
+	std::unordered_set<RTPEndpoint> destinations;
+	std::vector<struct mmsghdr> sendmsgs;
+
+	std::list<RTPRawPacket *> m_rawpacketlist;
+	RTPPacketBufferPool *bufferpool; // 收到的数据包存放在这个池的缓冲区中
+
+	RTPAbortDescriptors m_abortDesc;
+	RTPAbortDescriptors *m_pAbortDesc; // 如果指定了外部描述符
+
+	std::mutex m_mainMutex, m_waitMutex;
+	bool m_threadsafe;
+};
+
+#endif // RTPUNIXTRANSMITTER_H
@@ -12,12 +12,70 @@
 #define RTP_COLLISIONTIMEOUTMULTIPLIER					10
 #define RTP_NOTETTIMEOUTMULTIPLIER					25
 #define RTP_DEFAULTSESSIONBANDWIDTH					10000.0
+#define RTP_DEFAULTRTXCACHESIZE						0
+#define RTP_DEFAULTRTXCACHEMAXBYTES					1048576
+#define RTP_DEFAULTRTXCACHEMAXAGE					1.0
+#define RTP_DEFAULTRETRANSMITONNACK					true
+#define RTP_LOSSTRACKER_WINDOWSIZE					512
+#define RTP_DEFAULTGENERATENACKS					false
+#define RTP_DEFAULTNACKMAXRETRIES					3
+#define RTP_DEFAULTNACKRTT						0.1
+#define RTP_DEFAULTUSEFEC						false
+#define RTP_DEFAULTFECCOLUMNS						5
+#define RTP_DEFAULTFECROWS						0
+#define RTP_FEC_HEADERSIZE						16
+#define RTP_FECDECODER_MEDIASLOTS					256
+#define RTP_FECDECODER_FECSLOTS						64
+#define RTP_DEFAULTUSETRANSPORTCC					false
+#define RTP_DEFAULTTRANSPORTCCEXTENSIONID				5
+#define RTP_DEFAULTTRANSPORTCCINTERVAL					0.1
+#define RTP_TRANSPORTCC_WINDOWSIZE					16384
+#define RTP_TRANSPORTCC_MAXFCISIZE					400
+#define RTP_TRANSPORTCC_MAXFEEDBACKPACKETS				4
+#define RTP_DEFAULTUSECONGESTIONCONTROL					false
+#define RTP_DEFAULTINITIALBITRATE					300000.0
+#define RTP_DEFAULTMINIMUMBITRATE					30000.0
+#define RTP_DEFAULTMAXIMUMBITRATE					2500000.0
+#define RTP_CC_SENDHISTORYSIZE						4096
+#define RTP_CC_TRENDLINEWINDOW						20
+#define RTP_TXTIMESTAMP_HISTORYSIZE					256
+#define RTP_TXTIMESTAMP_MAXPENDING					256
+#define RTP_TIMEBATCH_MAXUSES						64
+#define RTP_RECEIVESHARD_MAXQUEUE					4096
+#define RTP_PACKETRING_DEFAULTCAPACITY					1024
+#define RTP_UDP_MAXQUEUE						4096
+#define RTP_CACHELINESIZE						64
+#define RTP_IOURING_DEFAULTENTRIES					256
+#define RTP_IOURING_DEFAULTBUFFERS					512
+#define RTP_IOURING_DEFAULTBUFFERSIZE					2048
+#define RTP_IOURING_MAXQUEUE						4096
+#define RTP_LOOPBACK_MAXQUEUE						8192
+#define RTP_SHM_DEFAULTSLOTS						1024
+#define RTP_SHM_DEFAULTSLOTSIZE						2048
+#define RTP_UNIX_DEFAULTBATCH						32
+#define RTP_BUNDLE_DEFAULTPACKSIZE					2048
+#define RTP_BUNDLE_RECEIVEBATCH						32
+#define RTP_BUNDLE_MAXLOCALSSRCS					4
+#define RTP_PACKETBUFFER_DEFAULTSIZE					2048
+#define RTP_PACKETBUFFER_DEFAULTMAXFREE					1024
+#define RTP_PACKETBUFFER_TRANSMITTERMAXFREE				256
+
+#define RTP_ONEBYTEHEADEREXTENSION_ID					0xBEDE
 
 #define RTP_RTCPTYPE_SR							200
 #define RTP_RTCPTYPE_RR							201
 #define RTP_RTCPTYPE_SDES						202
 #define RTP_RTCPTYPE_BYE						203
 #define RTP_RTCPTYPE_APP						204
+#define RTP_RTCPTYPE_RTPFB						205
+#define RTP_RTCPTYPE_PSFB						206
+
+#define RTCP_RTPFB_FMT_NACK						1
+#define RTCP_RTPFB_FMT_TRANSPORTCC					15
+#define RTCP_PSFB_FMT_PLI						1
+#define RTCP_PSFB_FMT_FIR						4
+#define RTCP_PSFB_FMT_AFB						15
+#define RTCP_FB_MAXNACKITEMS						255
 
 #define RTCP_SDES_ID_CNAME						1
 #define RTCP_SDES_NUMITEMS_NONPRIVATE					1
@@ -30,3 +88,6 @@
 #define RTCP_DEFAULTHALFATSTARTUP					true
 #define RTCP_DEFAULTIMMEDIATEBYE					true
 #define RTCP_DEFAULTSRBYE						true
+#define RTCP_DEFAULTUSEAVPF						false
+#define RTCP_AVPF_INITIALMININTERVAL					1.0
+#define RTCP_AVPF_DITHERFACTOR						0.5
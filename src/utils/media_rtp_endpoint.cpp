@@ -1,6 +1,31 @@
 #include "media_rtp_endpoint.h"
 #include <stdexcept>
 #include <sstream>
+#include <stddef.h>
+
+struct RTPEndpoint::UnixData
+{
+    std::string rtpPath, rtcpPath;
+    bool abstractAddress;
+    sockaddr_un rtpSockAddr, rtcpSockAddr;
+    socklen_t rtpSockAddrLen, rtcpSockAddrLen;
+};
+
+// 抽象地址以空字节开头，长度只包括名称本身；文件系统路径以空字节结尾
+static socklen_t RTPFillUnixSockAddr(sockaddr_un &addr, const std::string &path, bool abstractAddress)
+{
+    if (path.size() + 1 > sizeof(addr.sun_path))
+        throw std::length_error("Unix socket path too long");
+
+    memset(&addr, 0, sizeof(sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    if (abstractAddress) {
+        memcpy(addr.sun_path + 1, path.data(), path.size());
+        return (socklen_t)(offsetof(sockaddr_un, sun_path) + 1 + path.size());
+    }
+    memcpy(addr.sun_path, path.data(), path.size());
+    return (socklen_t)(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+}
 
 // Default constructor (creates IPv4 endpoint with 0 values)
 RTPEndpoint::RTPEndpoint()
@@ -57,6 +82,23 @@ RTPEndpoint RTPEndpoint::CreateIPv6FromBytes(const uint8_t ip[16], uint16_t rtpP
 }
 #endif
 
+RTPEndpoint RTPEndpoint::CreateFromSockAddr(const sockaddr *addr)
+{
+    if (addr->sa_family == AF_INET) {
+        const sockaddr_in *addr4 = (const sockaddr_in *)addr;
+        return RTPEndpoint(ntohl(addr4->sin_addr.s_addr), ntohs(addr4->sin_port));
+    }
+#ifdef RTP_SUPPORT_IPV6
+    if (addr->sa_family == AF_INET6) {
+        const sockaddr_in6 *addr6 = (const sockaddr_in6 *)addr;
+        if (IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr))
+            return CreateIPv4FromBytes(&addr6->sin6_addr.s6_addr[12], ntohs(addr6->sin6_port));
+        return RTPEndpoint(addr6->sin6_addr, ntohs(addr6->sin6_port));
+    }
+#endif
+    return RTPEndpoint();
+}
+
 // TCP constructor
 RTPEndpoint::RTPEndpoint(int socket)
     : type(TCP), sockAddrValid(false)
@@ -64,9 +106,25 @@ RTPEndpoint::RTPEndpoint(int socket)
     tcpData.socket = socket;
 }
 
+RTPEndpoint RTPEndpoint::CreateUnix(const std::string& rtpPath, const std::string& rtcpPath, bool abstractAddress)
+{
+    std::shared_ptr<UnixData> data = std::make_shared<UnixData>();
+
+    data->rtpPath = rtpPath;
+    data->rtcpPath = rtcpPath.empty() ? rtpPath : rtcpPath;
+    data->abstractAddress = abstractAddress;
+    data->rtpSockAddrLen = RTPFillUnixSockAddr(data->rtpSockAddr, data->rtpPath, abstractAddress);
+    data->rtcpSockAddrLen = RTPFillUnixSockAddr(data->rtcpSockAddr, data->rtcpPath, abstractAddress);
+
+    RTPEndpoint endpoint;
+    endpoint.type = Unix;
+    endpoint.unixData = data;
+    return endpoint;
+}
+
 // Copy constructor
 RTPEndpoint::RTPEndpoint(const RTPEndpoint& other)
-    : type(other.type), sockAddrValid(false)
+    : type(other.type), unixData(other.unixData), sockAddrValid(false)
 {
     switch (type) {
         case IPv4:
@@ -80,6 +138,8 @@ RTPEndpoint::RTPEndpoint(const RTPEndpoint& other)
         case TCP:
             tcpData = other.tcpData;
             break;
+        case Unix:
+            break;
     }
 }
 
@@ -88,6 +148,7 @@ RTPEndpoint& RTPEndpoint::operator=(const RTPEndpoint& other)
 {
     if (this != &other) {
         type = other.type;
+        unixData = other.unixData;
         sockAddrValid = false;
         switch (type) {
             case IPv4:
@@ -101,6 +162,8 @@ RTPEndpoint& RTPEndpoint::operator=(const RTPEndpoint& other)
             case TCP:
                 tcpData = other.tcpData;
                 break;
+            case Unix:
+                break;
         }
     }
     return *this;
@@ -108,7 +171,7 @@ RTPEndpoint& RTPEndpoint::operator=(const RTPEndpoint& other)
 
 // Move constructor
 RTPEndpoint::RTPEndpoint(RTPEndpoint&& other) noexcept
-    : type(other.type), sockAddrValid(other.sockAddrValid)
+    : type(other.type), unixData(std::move(other.unixData)), sockAddrValid(other.sockAddrValid)
 {
     switch (type) {
         case IPv4:
@@ -122,6 +185,8 @@ RTPEndpoint::RTPEndpoint(RTPEndpoint&& other) noexcept
         case TCP:
             tcpData = other.tcpData;
             break;
+        case Unix:
+            break;
     }
     other.sockAddrValid = false;
 }
@@ -131,6 +196,7 @@ RTPEndpoint& RTPEndpoint::operator=(RTPEndpoint&& other) noexcept
 {
     if (this != &other) {
         type = other.type;
+        unixData = std::move(other.unixData);
         sockAddrValid = other.sockAddrValid;
         switch (type) {
             case IPv4:
@@ -144,6 +210,8 @@ RTPEndpoint& RTPEndpoint::operator=(RTPEndpoint&& other) noexcept
             case TCP:
                 tcpData = other.tcpData;
                 break;
+            case Unix:
+                break;
         }
         other.sockAddrValid = false;
     }
@@ -171,6 +239,9 @@ bool RTPEndpoint::IsSameEndpoint(const RTPEndpoint& other) const
 #endif
         case TCP:
             return (tcpData.socket == other.tcpData.socket);
+        case Unix:
+            return (unixData->abstractAddress == other.unixData->abstractAddress &&
+                    unixData->rtpPath == other.unixData->rtpPath);
     }
     return false;
 }
@@ -188,6 +259,7 @@ bool RTPEndpoint::IsSameHost(const RTPEndpoint& other) const
             return (memcmp(&ipv6Data.ipv6Addr, &other.ipv6Data.ipv6Addr, sizeof(in6_addr)) == 0);
 #endif
         case TCP:
+        case Unix:
             return IsSameEndpoint(other); // For TCP, same socket = same host
     }
     return false;
@@ -239,6 +311,8 @@ uint16_t RTPEndpoint::GetRtpPort() const
 #endif
         case TCP:
             throw std::runtime_error("GetRtpPort() called on TCP endpoint");
+        case Unix:
+            throw std::runtime_error("GetRtpPort() called on Unix endpoint");
     }
     return 0;
 }
@@ -254,6 +328,8 @@ uint16_t RTPEndpoint::GetRtcpPort() const
 #endif
         case TCP:
             throw std::runtime_error("GetRtcpPort() called on TCP endpoint");
+        case Unix:
+            throw std::runtime_error("GetRtcpPort() called on Unix endpoint");
     }
     return 0;
 }
@@ -271,6 +347,8 @@ void RTPEndpoint::SetRtpPort(uint16_t port)
 #endif
         case TCP:
             throw std::runtime_error("SetRtpPort() called on TCP endpoint");
+        case Unix:
+            throw std::runtime_error("SetRtpPort() called on Unix endpoint");
     }
     InvalidateSockAddr();
 }
@@ -288,6 +366,8 @@ void RTPEndpoint::SetRtcpPort(uint16_t port)
 #endif
         case TCP:
             throw std::runtime_error("SetRtcpPort() called on TCP endpoint");
+        case Unix:
+            throw std::runtime_error("SetRtcpPort() called on Unix endpoint");
     }
     InvalidateSockAddr();
 }
@@ -300,6 +380,28 @@ int RTPEndpoint::GetSocket() const
     return tcpData.socket;
 }
 
+// Unix-specific methods
+const std::string& RTPEndpoint::GetUnixPath() const
+{
+    if (type != Unix)
+        throw std::runtime_error("GetUnixPath() called on non-Unix endpoint");
+    return unixData->rtpPath;
+}
+
+const std::string& RTPEndpoint::GetUnixRtcpPath() const
+{
+    if (type != Unix)
+        throw std::runtime_error("GetUnixRtcpPath() called on non-Unix endpoint");
+    return unixData->rtcpPath;
+}
+
+bool RTPEndpoint::IsAbstractUnixAddress() const
+{
+    if (type != Unix)
+        throw std::runtime_error("IsAbstractUnixAddress() called on non-Unix endpoint");
+    return unixData->abstractAddress;
+}
+
 // Socket address access
 const sockaddr* RTPEndpoint::GetRtpSockAddr() const
 {
@@ -314,6 +416,8 @@ const sockaddr* RTPEndpoint::GetRtpSockAddr() const
 #endif
         case TCP:
             throw std::runtime_error("GetRtpSockAddr() called on TCP endpoint");
+        case Unix:
+            return reinterpret_cast<const sockaddr*>(&unixData->rtpSockAddr);
     }
     return nullptr;
 }
@@ -331,6 +435,8 @@ const sockaddr* RTPEndpoint::GetRtcpSockAddr() const
 #endif
         case TCP:
             throw std::runtime_error("GetRtcpSockAddr() called on TCP endpoint");
+        case Unix:
+            return reinterpret_cast<const sockaddr*>(&unixData->rtcpSockAddr);
     }
     return nullptr;
 }
@@ -346,10 +452,19 @@ socklen_t RTPEndpoint::GetSockAddrLen() const
 #endif
         case TCP:
             throw std::runtime_error("GetSockAddrLen() called on TCP endpoint");
+        case Unix:
+            return unixData->rtpSockAddrLen;
     }
     return 0;
 }
 
+socklen_t RTPEndpoint::GetRtcpSockAddrLen() const
+{
+    if (type == Unix)
+        return unixData->rtcpSockAddrLen;
+    return GetSockAddrLen();
+}
+
 // Network byte order accessors
 uint32_t RTPEndpoint::GetIPv4_NBO() const
 {
@@ -369,6 +484,8 @@ uint16_t RTPEndpoint::GetRtpPort_NBO() const
 #endif
         case TCP:
             throw std::runtime_error("GetRtpPort_NBO() called on TCP endpoint");
+        case Unix:
+            throw std::runtime_error("GetRtpPort_NBO() called on Unix endpoint");
     }
     return 0;
 }
@@ -384,6 +501,8 @@ uint16_t RTPEndpoint::GetRtcpPort_NBO() const
 #endif
         case TCP:
             throw std::runtime_error("GetRtcpPort_NBO() called on TCP endpoint");
+        case Unix:
+            throw std::runtime_error("GetRtcpPort_NBO() called on Unix endpoint");
     }
     return 0;
 }
@@ -417,6 +536,11 @@ std::string RTPEndpoint::GetEndpointString() const
         case TCP:
             oss << "TCP socket " << tcpData.socket;
             break;
+        case Unix:
+            oss << "unix:" << (unixData->abstractAddress ? "@" : "") << unixData->rtpPath;
+            if (unixData->rtcpPath != unixData->rtpPath)
+                oss << "/" << unixData->rtcpPath;
+            break;
     }
     
     return oss.str();
@@ -491,6 +615,8 @@ namespace std {
 #endif
             case RTPEndpoint::TCP:
                 return std::hash<int>{}(endpoint.GetSocket());
+            case RTPEndpoint::Unix:
+                return std::hash<std::string>{}(endpoint.GetUnixPath());
         }
         return 0;
     }
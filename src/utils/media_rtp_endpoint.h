@@ -18,15 +18,17 @@
 #include <netinet/in.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
-/** 统一的端点类，表示用于RTP传输的IPv4、IPv6或TCP端点。 */
+/** 统一的端点类，表示用于RTP传输的IPv4、IPv6、TCP或Unix域端点。 */
 class RTPEndpoint {
 public:
   /** 标识端点类型。 */
   enum Type {
     IPv4, /**< IPv4 UDP端点 */
     IPv6, /**< IPv6 UDP端点 */
-    TCP   /**< TCP端点 */
+    TCP,  /**< TCP端点 */
+    Unix  /**< Unix域数据报端点 */
   };
 
   // 默认构造函数（创建无效端点）
@@ -53,10 +55,21 @@ public:
                                          uint16_t rtcpPort = 0);
 #endif
 
+  /** 从收到的数据报的源地址 \c addr 创建IPv4或IPv6端点，RTCP端口为RTP端口加1；
+   *  双栈套接字上的 ::ffff:a.b.c.d 形式的地址创建为IPv4端点。其他地址族返回无效端点。 */
+  static RTPEndpoint CreateFromSockAddr(const sockaddr *addr);
+
   // TCP构造函数
   /** 从现有套接字创建TCP端点。 */
   explicit RTPEndpoint(int socket);
 
+  /** 创建Unix域端点。\c abstractAddress 为 \c true 时路径属于Linux的抽象命名空间，
+   *  不在文件系统中创建文件；\c rtcpPath 为空时RTCP使用与RTP相同的地址。
+   *  路径超出 sockaddr_un 的容量时抛出异常。 */
+  static RTPEndpoint CreateUnix(const std::string &rtpPath,
+                                const std::string &rtcpPath = std::string(),
+                                bool abstractAddress = true);
+
   ~RTPEndpoint() = default;
 
   // 拷贝和移动操作
@@ -110,6 +123,16 @@ public:
   /** 返回套接字描述符（仅TCP端点）。 */
   int GetSocket() const;
 
+  // Unix域特定方法
+  /** 返回RTP地址的路径，抽象地址不包括开头的空字节（仅Unix域端点）。 */
+  const std::string &GetUnixPath() const;
+
+  /** 返回RTCP地址的路径（仅Unix域端点）。 */
+  const std::string &GetUnixRtcpPath() const;
+
+  /** 如果地址属于抽象命名空间则返回 \c true（仅Unix域端点）。 */
+  bool IsAbstractUnixAddress() const;
+
   // 套接字地址访问
   /** 返回RTP套接字地址结构。 */
   const sockaddr *GetRtpSockAddr() const;
@@ -120,6 +143,9 @@ public:
   /** 返回套接字地址长度。 */
   socklen_t GetSockAddrLen() const;
 
+  /** 返回RTCP套接字地址的长度；只有Unix域端点的两个地址长度可能不同。 */
+  socklen_t GetRtcpSockAddrLen() const;
+
   // 网络字节序访问器
   /** 返回网络字节序的IP（仅IPv4）。 */
   uint32_t GetIPv4_NBO() const;
@@ -165,6 +191,10 @@ private:
     } tcpData;
   };
 
+  // Unix域地址较大且不可变，由副本共享，其他类型的端点为空
+  struct UnixData;
+  std::shared_ptr<const UnixData> unixData;
+
   mutable bool sockAddrValid;
 
   void UpdateIPv4SockAddr() const;
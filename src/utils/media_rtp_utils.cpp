@@ -1,154 +1,223 @@
 #include "media_rtp_utils.h"
 #include "media_rtp_errors.h"
 #include <random>
-#include <mutex>
 #include <thread>
 #include <chrono>
 #include <sys/select.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/types.h>
 #include <errno.h>
+#ifdef RTP_HAVE_GETRANDOM
+#include <sys/random.h>
+#endif // RTP_HAVE_GETRANDOM
+#ifdef RTP_SUPPORT_SO_TIMESTAMPING
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#endif // RTP_SUPPORT_SO_TIMESTAMPING
 
 // 随机数生成相关
-static std::mt19937& GetRandomGenerator() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    return gen;
+// 每个线程使用自己的 xoshiro256** 生成器，不需要加锁
+
+namespace {
+
+uint64_t SplitMix64(uint64_t &x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
 }
 
-static std::mutex& GetRandomMutex() {
-    static std::mutex mtx;
-    return mtx;
+class RandomGenerator {
+public:
+    RandomGenerator() {
+        uint64_t seed[4] = {0, 0, 0, 0};
+        bool seeded = false;
+
+#ifdef RTP_HAVE_GETRANDOM
+        seeded = (getrandom(seed, sizeof(seed), 0) == static_cast<ssize_t>(sizeof(seed)));
+#endif // RTP_HAVE_GETRANDOM
+        if (!seeded) {
+            std::random_device rd;
+            for (int i = 0; i < 4; i++)
+                seed[i] = (static_cast<uint64_t>(rd()) << 32) | rd();
+        }
+
+        // 用 splitmix64 扩展种子，同时保证状态不全为零
+        uint64_t x = seed[0] ^ seed[1] ^ seed[2] ^ seed[3];
+        for (int i = 0; i < 4; i++)
+            m_state[i] = seed[i] ^ SplitMix64(x);
+    }
+
+    uint64_t Next() {
+        const uint64_t result = RotateLeft(m_state[1] * 5, 7) * 9;
+        const uint64_t t = m_state[1] << 17;
+
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = RotateLeft(m_state[3], 45);
+        return result;
+    }
+
+private:
+    static uint64_t RotateLeft(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    uint64_t m_state[4];
+};
+
+RandomGenerator &GetRandomGenerator() {
+    thread_local RandomGenerator gen;
+    return gen;
 }
 
+} // namespace
+
 uint8_t RTPGenerateRandom8() {
-    std::lock_guard<std::mutex> lock(GetRandomMutex());
-    std::uniform_int_distribution<uint32_t> dist(0, 255);
-    return static_cast<uint8_t>(dist(GetRandomGenerator()));
+    return static_cast<uint8_t>(GetRandomGenerator().Next() >> 56);
 }
 
 uint16_t RTPGenerateRandom16() {
-    std::lock_guard<std::mutex> lock(GetRandomMutex());
-    std::uniform_int_distribution<uint32_t> dist(0, 65535);
-    return static_cast<uint16_t>(dist(GetRandomGenerator()));
+    return static_cast<uint16_t>(GetRandomGenerator().Next() >> 48);
 }
 
 uint32_t RTPGenerateRandom32() {
-    std::lock_guard<std::mutex> lock(GetRandomMutex());
-    std::uniform_int_distribution<uint32_t> dist(0, UINT32_MAX);
-    return dist(GetRandomGenerator());
+    return static_cast<uint32_t>(GetRandomGenerator().Next() >> 32);
 }
 
 double RTPGenerateRandomDouble() {
-    std::lock_guard<std::mutex> lock(GetRandomMutex());
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
-    return dist(GetRandomGenerator());
+    // 取高53位，结果在 [0,1) 内均匀分布
+    return static_cast<double>(GetRandomGenerator().Next() >> 11) * (1.0 / 9007199254740992.0);
 }
 
 // RTPTime 实现
-RTPTime::RTPTime(double t) : m_seconds(t) {}
+
+namespace {
+
+int64_t MonotonicNanoSeconds() {
+#ifdef RTP_HAVE_CLOCK_GETTIME
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif // RTP_HAVE_CLOCK_GETTIME
+}
+
+int64_t WallclockNanoSeconds() {
+#ifdef RTP_HAVE_CLOCK_GETTIME
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+#endif // RTP_HAVE_CLOCK_GETTIME
+}
+
+// 墙钟与单调时钟之差，第一次使用时校准
+int64_t CalibratedOffset() {
+    static const int64_t offset = WallclockNanoSeconds() - MonotonicNanoSeconds();
+    return offset;
+}
+
+// 当前墙钟相对于校准时的漂移 (墙钟被调整或校时时不为零)
+int64_t WallclockDrift() {
+    int64_t mono = MonotonicNanoSeconds();
+    return WallclockNanoSeconds() - mono - CalibratedOffset();
+}
+
+thread_local RTPTimeBatch *currentbatch = nullptr;
+
+} // namespace
+
+RTPTime::RTPTime(double t) : m_nanoseconds(static_cast<int64_t>(t >= 0 ? t * 1e9 + 0.5 : t * 1e9 - 0.5)) {}
 
 RTPTime::RTPTime(int64_t seconds, uint32_t microseconds) {
     if (seconds >= 0) {
-        m_seconds = static_cast<double>(seconds) + 1e-6 * static_cast<double>(microseconds);
+        m_nanoseconds = seconds * 1000000000 + static_cast<int64_t>(microseconds) * 1000;
     } else {
-        int64_t possec = -seconds;
-        m_seconds = static_cast<double>(possec) + 1e-6 * static_cast<double>(microseconds);
-        m_seconds = -m_seconds;
+        m_nanoseconds = -((-seconds) * 1000000000 + static_cast<int64_t>(microseconds) * 1000);
     }
 }
 
 RTPTime::RTPTime(RTPNTPTime ntptime) {
     if (ntptime.GetMSW() < RTP_NTPTIMEOFFSET) {
-        m_seconds = 0;
+        m_nanoseconds = 0;
     } else {
-        uint32_t sec = ntptime.GetMSW() - RTP_NTPTIMEOFFSET;
-        
-        double x = static_cast<double>(ntptime.GetLSW());
-        x /= (65536.0 * 65536.0);
-        x *= 1000000.0;
-        uint32_t microsec = static_cast<uint32_t>(x);
-
-        m_seconds = static_cast<double>(sec) + 1e-6 * static_cast<double>(microsec);
-    }
-}
+        int64_t sec = ntptime.GetMSW() - RTP_NTPTIMEOFFSET;
+        int64_t nanosec = static_cast<int64_t>((static_cast<uint64_t>(ntptime.GetLSW()) * 1000000000) >> 32);
 
-int64_t RTPTime::GetSeconds() const {
-    return static_cast<int64_t>(m_seconds);
+        m_nanoseconds = sec * 1000000000 + nanosec;
+    }
 }
 
 uint32_t RTPTime::GetMicroSeconds() const {
-    uint32_t microsec;
-
-    if (m_seconds >= 0) {
-        int64_t sec = static_cast<int64_t>(m_seconds);
-        microsec = static_cast<uint32_t>(1e6 * (m_seconds - static_cast<double>(sec)) + 0.5);
-    } else {
-        int64_t sec = static_cast<int64_t>(-m_seconds);
-        microsec = static_cast<uint32_t>(1e6 * ((-m_seconds) - static_cast<double>(sec)) + 0.5);
-    }
+    int64_t nanosec = m_nanoseconds % 1000000000;
+    if (nanosec < 0)
+        nanosec = -nanosec;
 
+    uint32_t microsec = static_cast<uint32_t>((nanosec + 500) / 1000);
     if (microsec >= 1000000)
         return 999999;
     return microsec;
 }
 
 RTPNTPTime RTPTime::GetNTPTime() const {
-    uint32_t sec = static_cast<uint32_t>(m_seconds);
-    uint32_t microsec = static_cast<uint32_t>((m_seconds - static_cast<double>(sec)) * 1e6);
+    uint32_t sec = static_cast<uint32_t>(m_nanoseconds / 1000000000);
+    uint64_t nanosec = static_cast<uint64_t>(m_nanoseconds % 1000000000);
 
     uint32_t msw = sec + RTP_NTPTIMEOFFSET;
-    uint32_t lsw;
-    double x;
-    
-    x = microsec / 1000000.0;
-    x *= (65536.0 * 65536.0);
-    lsw = static_cast<uint32_t>(x);
+    uint32_t lsw = static_cast<uint32_t>((nanosec << 32) / 1000000000);
 
     return RTPNTPTime(msw, lsw);
 }
 
 RTPTime RTPTime::CurrentTime() {
-    auto now = std::chrono::system_clock::now();
-    auto duration = now.time_since_epoch();
-    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
-    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(duration - seconds);
-    
-    return RTPTime(seconds.count(), static_cast<uint32_t>(microseconds.count()));
+    RTPTimeBatch *batch = currentbatch;
+
+    if (batch != nullptr) {
+        if (batch->m_uses >= batch->m_maxuses)
+            batch->Refresh();
+        batch->m_uses++;
+        return batch->m_now;
+    }
+    return FromNanoSeconds(MonotonicNanoSeconds() + CalibratedOffset());
 }
 
-void RTPTime::Wait(const RTPTime &delay) {
-    if (delay.m_seconds <= 0)
-        return;
+RTPTime RTPTime::FromWallclock(int64_t seconds, uint32_t nanoseconds) {
+    RTPTimeBatch *batch = currentbatch;
+    int64_t drift = (batch != nullptr) ? batch->m_wallclockoffset : WallclockDrift();
 
-    auto duration = std::chrono::duration<double>(delay.m_seconds);
-    std::this_thread::sleep_for(duration);
+    return FromNanoSeconds(seconds * 1000000000 + nanoseconds - drift);
 }
 
-RTPTime &RTPTime::operator-=(const RTPTime &t) { 
-    m_seconds -= t.m_seconds;
-    return *this;
-}
+void RTPTime::Wait(const RTPTime &delay) {
+    if (delay.m_nanoseconds <= 0)
+        return;
 
-RTPTime &RTPTime::operator+=(const RTPTime &t) { 
-    m_seconds += t.m_seconds;
-    return *this;
+    std::this_thread::sleep_for(std::chrono::nanoseconds(delay.m_nanoseconds));
 }
 
-bool RTPTime::operator<(const RTPTime &t) const {
-    return m_seconds < t.m_seconds;
+// RTPTimeBatch 实现
+RTPTimeBatch::RTPTimeBatch(int maxuses) : m_prev(currentbatch), m_maxuses(maxuses), m_uses(0) {
+    Refresh();
+    currentbatch = this;
 }
 
-bool RTPTime::operator>(const RTPTime &t) const {
-    return m_seconds > t.m_seconds;
+RTPTimeBatch::~RTPTimeBatch() {
+    currentbatch = m_prev;
 }
 
-bool RTPTime::operator<=(const RTPTime &t) const {
-    return m_seconds <= t.m_seconds;
-}
+void RTPTimeBatch::Refresh() {
+    int64_t mono = MonotonicNanoSeconds();
 
-bool RTPTime::operator>=(const RTPTime &t) const {
-    return m_seconds >= t.m_seconds;
+    m_now = RTPTime::FromNanoSeconds(mono + CalibratedOffset());
+    m_wallclockoffset = WallclockNanoSeconds() - mono - CalibratedOffset();
+    m_uses = 0;
 }
 
 // RTPSelect 实现 (基于select，不使用poll)
@@ -187,4 +256,119 @@ int RTPSelect(const int *sockets, int8_t *readflags, size_t numsocks, RTPTime ti
         }
     }
     return status;
+}
+
+int RTPEnableReceiveTimestamps(int sock) {
+#ifdef RTP_SUPPORT_SO_TIMESTAMPNS
+    int on = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(int)) != 0)
+        return MEDIA_RTP_ERR_OPERATION_FAILED;
+    return 0;
+#else
+    MEDIA_RTP_UNUSED(sock);
+    return MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_SUPPORT_SO_TIMESTAMPNS
+}
+
+int RTPReceiveFrom(int sock, void *buffer, size_t len, int flags, struct sockaddr *from, RTPSOCKLENTYPE *fromlen,
+                   bool kerneltimestamps, RTPTime *receivetime) {
+#ifdef RTP_SUPPORT_SO_TIMESTAMPNS
+    if (kerneltimestamps) {
+        struct iovec iov;
+        struct msghdr msg;
+        // 以cmsghdr为元素类型保证控制缓冲区的对齐
+        struct cmsghdr control[(CMSG_SPACE(sizeof(struct timespec)) + sizeof(struct cmsghdr) - 1) / sizeof(struct cmsghdr)];
+
+        iov.iov_base = buffer;
+        iov.iov_len = len;
+        memset(&msg, 0, sizeof(struct msghdr));
+        msg.msg_name = from;
+        msg.msg_namelen = *fromlen;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        int recvlen = recvmsg(sock, &msg, flags);
+        if (recvlen < 0)
+            return recvlen;
+        *fromlen = msg.msg_namelen;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(struct timespec));
+                *receivetime = RTPTime::FromWallclock(ts.tv_sec, static_cast<uint32_t>(ts.tv_nsec));
+                return recvlen;
+            }
+        }
+        // 内核没有提供时间戳 (例如控制缓冲区被截断)
+        *receivetime = RTPTime::CurrentTime();
+        return recvlen;
+    }
+#else
+    MEDIA_RTP_UNUSED(kerneltimestamps);
+#endif // RTP_SUPPORT_SO_TIMESTAMPNS
+
+    *receivetime = RTPTime::CurrentTime();
+    return recvfrom(sock, buffer, len, flags, from, fromlen);
+}
+
+int RTPEnableTransmitTimestamps(int sock) {
+#ifdef RTP_SUPPORT_SO_TIMESTAMPING
+    // 只需要时间戳而不需要数据包内容，OPT_ID 为每个数据报编号
+    int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(int)) != 0)
+        return MEDIA_RTP_ERR_OPERATION_FAILED;
+    return 0;
+#else
+    MEDIA_RTP_UNUSED(sock);
+    return MEDIA_RTP_ERR_OPERATION_FAILED;
+#endif // RTP_SUPPORT_SO_TIMESTAMPING
+}
+
+int RTPReadTransmitTimestamp(int sock, uint32_t *key, RTPTime *sendtime) {
+#ifdef RTP_SUPPORT_SO_TIMESTAMPING
+    for (;;) {
+        struct msghdr msg;
+        struct cmsghdr control[(CMSG_SPACE(sizeof(struct scm_timestamping)) +
+                                CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6)) +
+                                sizeof(struct cmsghdr) - 1) / sizeof(struct cmsghdr)];
+
+        memset(&msg, 0, sizeof(struct msghdr));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+                return 0;
+            return MEDIA_RTP_ERR_OPERATION_FAILED;
+        }
+
+        const struct scm_timestamping *ts = nullptr;
+        const struct sock_extended_err *err = nullptr;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+                ts = reinterpret_cast<const struct scm_timestamping *>(CMSG_DATA(cmsg));
+            else if ((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                     (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+                err = reinterpret_cast<const struct sock_extended_err *>(CMSG_DATA(cmsg));
+        }
+
+        // 错误队列中也可能有其他错误 (例如ICMP)，跳过它们
+        if (ts == nullptr || err == nullptr || err->ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+            continue;
+
+        *key = err->ee_data;
+        *sendtime = RTPTime::FromWallclock(ts->ts[0].tv_sec, static_cast<uint32_t>(ts->ts[0].tv_nsec));
+        return 1;
+    }
+#else
+    MEDIA_RTP_UNUSED(sock);
+    MEDIA_RTP_UNUSED(key);
+    MEDIA_RTP_UNUSED(sendtime);
+    return 0;
+#endif // RTP_SUPPORT_SO_TIMESTAMPING
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #define RTP_PROTOCOL_UTILS_H
 
 #include "rtpconfig.h"
+#include "media_rtp_defines.h"
 #include <cstdint>
 #include <chrono>
 #include <sys/socket.h>
@@ -60,7 +61,11 @@ private:
 };
 
 /**
- * 现代化的时间处理类，使用 std::chrono 作为底层实现
+ * 时间处理类，以64位整数纳秒存储
+ * 
+ * CurrentTime 基于单调时钟 (CLOCK_MONOTONIC)，加上第一次使用时校准的墙钟偏移，
+ * 因此返回值既可以直接转换为NTP时间，又不会因系统时间被调整而跳变。
+ * 内核给出的墙钟时间戳应通过 FromWallclock 转换到同一时间基准。
  */
 class RTPTime
 {
@@ -69,29 +74,63 @@ public:
     static RTPTime CurrentTime();
     static void Wait(const RTPTime &delay);
     
+    /** 将墙钟时间 (CLOCK_REALTIME，例如内核时间戳) 转换到 CurrentTime 的时间基准 */
+    static RTPTime FromWallclock(int64_t seconds, uint32_t nanoseconds);
+    
+    /** 由纳秒数构造 */
+    static RTPTime FromNanoSeconds(int64_t nanoseconds) { RTPTime t; t.m_nanoseconds = nanoseconds; return t; }
+    
     // 构造函数
     RTPTime(double t = 0.0);
     RTPTime(RTPNTPTime ntptime);
     RTPTime(int64_t seconds, uint32_t microseconds);
     
     // 获取时间值
-    int64_t GetSeconds() const;
+    int64_t GetSeconds() const { return m_nanoseconds / 1000000000; }
     uint32_t GetMicroSeconds() const;
-    double GetDouble() const { return m_seconds; }
+    int64_t GetNanoSeconds() const { return m_nanoseconds; }
+    double GetDouble() const { return static_cast<double>(m_nanoseconds) * 1e-9; }
     RTPNTPTime GetNTPTime() const;
     
     // 操作符重载
-    RTPTime &operator-=(const RTPTime &t);
-    RTPTime &operator+=(const RTPTime &t);
-    bool operator<(const RTPTime &t) const;
-    bool operator>(const RTPTime &t) const;
-    bool operator<=(const RTPTime &t) const;
-    bool operator>=(const RTPTime &t) const;
+    RTPTime &operator-=(const RTPTime &t) { m_nanoseconds -= t.m_nanoseconds; return *this; }
+    RTPTime &operator+=(const RTPTime &t) { m_nanoseconds += t.m_nanoseconds; return *this; }
+    bool operator<(const RTPTime &t) const { return m_nanoseconds < t.m_nanoseconds; }
+    bool operator>(const RTPTime &t) const { return m_nanoseconds > t.m_nanoseconds; }
+    bool operator<=(const RTPTime &t) const { return m_nanoseconds <= t.m_nanoseconds; }
+    bool operator>=(const RTPTime &t) const { return m_nanoseconds >= t.m_nanoseconds; }
     
-    bool IsZero() const { return m_seconds == 0.0; }
+    bool IsZero() const { return m_nanoseconds == 0; }
     
 private:
-    double m_seconds;  // 使用double存储秒数，保持兼容性
+    int64_t m_nanoseconds;
+};
+
+/**
+ * 在作用域内缓存当前时间
+ * 
+ * 实例存在期间，当前线程中的 RTPTime::CurrentTime 返回同一个时间值，每调用 maxuses 次
+ * 才重新读取一次时钟，FromWallclock 也使用同一次校准。用于一次轮询读取一批数据包时，
+ * 这批数据包共用一次时钟读取。实例可以嵌套，析构时恢复外层的状态。
+ */
+class RTPTimeBatch
+{
+public:
+    explicit RTPTimeBatch(int maxuses = RTP_TIMEBATCH_MAXUSES);
+    ~RTPTimeBatch();
+    
+private:
+    RTPTimeBatch(const RTPTimeBatch &);
+    RTPTimeBatch &operator=(const RTPTimeBatch &);
+    
+    friend class RTPTime;
+    
+    void Refresh();
+    
+    RTPTimeBatch *m_prev;
+    int m_maxuses, m_uses;
+    RTPTime m_now;
+    int64_t m_wallclockoffset;
 };
 
 /**
@@ -105,7 +144,56 @@ private:
  */
 int RTPSelect(const int *sockets, int8_t *readflags, size_t numsocks, RTPTime timeout);
 
-// 随机数生成函数 (保留原有功能)
+/**
+ * 在socket上启用内核接收时间戳 (SO_TIMESTAMPNS)
+ * 
+ * @param sock      要设置的socket
+ * @return 成功返回0，系统不支持时返回负值
+ */
+int RTPEnableReceiveTimestamps(int sock);
+
+/**
+ * 接收一个数据报并确定其接收时间 (基于recvmsg实现)
+ * 
+ * 如果 kerneltimestamps 为 true 且内核在控制消息中提供了接收时间戳，
+ * 则使用该时间戳，不需要读取时钟；否则使用当前时间。
+ * 
+ * @param sock              要读取的socket
+ * @param buffer            数据缓冲区
+ * @param len               缓冲区长度
+ * @param flags             传给recvmsg的标志
+ * @param from              输出发送方地址
+ * @param fromlen           输入输出发送方地址长度
+ * @param kerneltimestamps  是否已通过 RTPEnableReceiveTimestamps 启用内核时间戳
+ * @param receivetime       输出接收时间
+ * @return 接收的字节数，出错返回负值
+ */
+int RTPReceiveFrom(int sock, void *buffer, size_t len, int flags, struct sockaddr *from, RTPSOCKLENTYPE *fromlen,
+                   bool kerneltimestamps, RTPTime *receivetime);
+
+/**
+ * 在socket上启用内核软件发送时间戳 (SO_TIMESTAMPING)
+ * 
+ * 启用后，socket上每发送一个数据报，内核都会在错误队列中放入一个发送时间戳，
+ * 时间戳的编号从零开始，每个数据报加一。错误队列中有数据时socket也会被报告为可读，
+ * 因此需要用 RTPReadTransmitTimestamp 及时读取。
+ * 
+ * @param sock      要设置的socket
+ * @return 成功返回0，系统不支持时返回负值
+ */
+int RTPEnableTransmitTimestamps(int sock);
+
+/**
+ * 从socket的错误队列中读取一个发送时间戳 (不阻塞)
+ * 
+ * @param sock      要读取的socket
+ * @param key       输出时间戳的编号
+ * @param sendtime  输出数据报的发送时间
+ * @return 读到时间戳返回1，错误队列为空返回0，出错返回负值
+ */
+int RTPReadTransmitTimestamp(int sock, uint32_t *key, RTPTime *sendtime);
+
+// 随机数生成函数 (每个线程独立的生成器，线程安全且无锁)
 uint8_t RTPGenerateRandom8();
 uint16_t RTPGenerateRandom16();
 uint32_t RTPGenerateRandom32();
@@ -0,0 +1,93 @@
+#include "media_rtp_xor.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define RTP_XOR_X86
+	#include <immintrin.h>
+#endif
+
+void RTPXORBlockScalar(uint8_t *dst,const uint8_t *src,size_t len)
+{
+	size_t i = 0;
+
+	// 按 8 字节处理，使用 memcpy 避免未对齐访问
+	for ( ; i+8 <= len ; i += 8)
+	{
+		uint64_t a,b;
+
+		memcpy(&a,dst+i,8);
+		memcpy(&b,src+i,8);
+		a ^= b;
+		memcpy(dst+i,&a,8);
+	}
+	for ( ; i < len ; i++)
+		dst[i] ^= src[i];
+}
+
+#ifdef RTP_XOR_X86
+
+__attribute__((target("sse2")))
+static void RTPXORBlockSSE2(uint8_t *dst,const uint8_t *src,size_t len)
+{
+	size_t i = 0;
+
+	for ( ; i+16 <= len ; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(dst+i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(src+i));
+		_mm_storeu_si128((__m128i *)(dst+i),_mm_xor_si128(a,b));
+	}
+	RTPXORBlockScalar(dst+i,src+i,len-i);
+}
+
+__attribute__((target("avx2")))
+static void RTPXORBlockAVX2(uint8_t *dst,const uint8_t *src,size_t len)
+{
+	size_t i = 0;
+
+	for ( ; i+32 <= len ; i += 32)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *)(dst+i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(src+i));
+		_mm256_storeu_si256((__m256i *)(dst+i),_mm256_xor_si256(a,b));
+	}
+	RTPXORBlockSSE2(dst+i,src+i,len-i);
+}
+
+#endif // RTP_XOR_X86
+
+typedef void (*RTPXORFunction)(uint8_t *,const uint8_t *,size_t);
+
+struct RTPXORImplementation
+{
+	RTPXORFunction func;
+	const char *name;
+};
+
+static RTPXORImplementation SelectXORImplementation()
+{
+#ifdef RTP_XOR_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return { RTPXORBlockAVX2, "avx2" };
+	if (__builtin_cpu_supports("sse2"))
+		return { RTPXORBlockSSE2, "sse2" };
+#endif // RTP_XOR_X86
+	return { RTPXORBlockScalar, "scalar" };
+}
+
+static const RTPXORImplementation &GetXORImplementation()
+{
+	static const RTPXORImplementation impl = SelectXORImplementation();
+	return impl;
+}
+
+void RTPXORBlock(uint8_t *dst,const uint8_t *src,size_t len)
+{
+	GetXORImplementation().func(dst,src,len);
+}
+
+const char *RTPXORBlockImplementation()
+{
+	return GetXORImplementation().name;
+}
@@ -0,0 +1,29 @@
+/**
+ * \file media_rtp_xor.h
+ *
+ * FEC 使用的内存块异或运算，运行时根据 CPU 选择 AVX2/SSE2 实现，其他平台使用标量实现
+ */
+
+#ifndef RTP_PROTOCOL_XOR_H
+#define RTP_PROTOCOL_XOR_H
+
+#include "rtpconfig.h"
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * 将 src 的 len 个字节异或到 dst 上（dst[i] ^= src[i]），两块内存不能重叠
+ */
+void RTPXORBlock(uint8_t *dst, const uint8_t *src, size_t len);
+
+/**
+ * RTPXORBlock 的标量实现，用于不支持 SIMD 的平台以及基准测试对比
+ */
+void RTPXORBlockScalar(uint8_t *dst, const uint8_t *src, size_t len);
+
+/**
+ * 返回 RTPXORBlock 当前使用的实现名称（"avx2"、"sse2" 或 "scalar"）
+ */
+const char *RTPXORBlockImplementation();
+
+#endif // RTP_PROTOCOL_XOR_H
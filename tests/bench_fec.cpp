@@ -0,0 +1,101 @@
+// FEC 编解码开销的基准测试工具，不作为单元测试运行：./fec_bench
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "packets/media_rtp_fec.h"
+#include "utils/media_rtp_xor.h"
+#include "test_utils.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+void BenchXOR(const char *name, void (*func)(uint8_t *, const uint8_t *, size_t)) {
+  const size_t len = 1200;
+  const int iterations = 1000000;
+  std::vector<uint8_t> a(len, 0x5a), b(len, 0xa5);
+
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++)
+    func(a.data(), b.data(), len);
+  double ns = ElapsedNs(start);
+  double mbit = (double)len * iterations * 8.0 / 1e6;
+  printf("xor %-8s %8.1f ns/Mbit (check %u)\n", name, ns / mbit, a[0]);
+}
+
+void BenchFEC(int columns, int rows) {
+  const size_t payloadlen = 1200;
+  const int numpackets = 200000;
+  std::vector<std::vector<uint8_t>> media;
+  for (int i = 0; i < 1000; i++)
+    media.push_back(BuildRTPRaw(false, 96, 0, 0, 0x11223344, {}, false, 0, {},
+                                std::vector<uint8_t>(payloadlen, (uint8_t)i)));
+
+  RTPFECEncoder enc;
+  enc.Init(1500, columns, rows, 100, 0x55667788);
+  std::vector<std::vector<uint8_t>> fec;
+
+  double mbit = (double)(media[0].size()) * numpackets * 8.0 / 1e6;
+  auto start = Clock::now();
+  for (int i = 0; i < numpackets; i++) {
+    std::vector<uint8_t> &m = media[i % media.size()];
+    m[2] = (uint8_t)(i >> 8);
+    m[3] = (uint8_t)i;
+    int num = enc.AddMediaPacket(m.data(), m.size());
+    if (i < (int)media.size() * 4) {
+      for (int j = 0; j < num; j++) {
+        size_t len;
+        const uint8_t *p = enc.GetFECPacket(j, &len);
+        fec.emplace_back(p, p + len);
+      }
+    }
+  }
+  double encns = ElapsedNs(start);
+
+  // 解码：每 columns 个包丢一个，由行/列FEC恢复
+  RTPFECDecoder dec;
+  dec.Init(1500, 100);
+  size_t fecindex = 0;
+  int limit = (int)media.size() * 4;
+  int fecperblock = (columns >= 2 ? rows : 0) + (rows >= 2 ? columns : 0);
+  if (rows < 2)
+    fecperblock = 1;
+  int blocksize = columns * (rows >= 2 ? rows : 1);
+  start = Clock::now();
+  for (int i = 0; i < limit; i++) {
+    std::vector<uint8_t> &m = media[i % media.size()];
+    m[2] = (uint8_t)(i >> 8);
+    m[3] = (uint8_t)i;
+    if (i % columns != 1)
+      dec.AddMediaPacket(m.data(), m.size());
+    if ((i + 1) % blocksize == 0) {
+      for (int j = 0; j < fecperblock && fecindex < fec.size(); j++, fecindex++)
+        dec.AddFECPacket(fec[fecindex].data(), fec[fecindex].size());
+    }
+    const uint8_t *p;
+    size_t len;
+    while (dec.GetNextRecoveredPacket(&p, &len))
+      ;
+  }
+  double decns = ElapsedNs(start);
+  double decmbit = (double)(media[0].size()) * limit * 8.0 / 1e6;
+
+  printf("fec %dx%d   encode %8.1f ns/Mbit   decode %8.1f ns/Mbit   recovered %u\n",
+         columns, rows, encns / mbit, decns / decmbit, dec.GetNumRecovered());
+}
+
+} // namespace
+
+int main() {
+  BenchXOR("scalar", RTPXORBlockScalar);
+  BenchXOR(RTPXORBlockImplementation(), RTPXORBlock);
+  BenchFEC(5, 0);
+  BenchFEC(10, 0);
+  BenchFEC(5, 5);
+  return 0;
+}
@@ -0,0 +1,57 @@
+// 随机数生成在多线程竞争下的基准测试工具，不作为单元测试运行：./random_bench
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "utils/media_rtp_utils.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int numthreads = 32;
+const int iterations = 1000000;
+
+// 原先的实现：一个全局 mt19937 加一个全局互斥锁
+uint32_t LockedRandom32() {
+  static std::mt19937 gen(std::random_device{}());
+  static std::mutex mtx;
+  std::lock_guard<std::mutex> lock(mtx);
+  std::uniform_int_distribution<uint32_t> dist(0, UINT32_MAX);
+  return dist(gen);
+}
+
+void Bench(const char *name, uint32_t (*func)()) {
+  std::vector<std::thread> threads;
+  std::vector<uint32_t> sums(numthreads);
+
+  auto start = Clock::now();
+  for (int t = 0; t < numthreads; t++) {
+    threads.push_back(std::thread([&sums, func, t]() {
+      uint32_t sum = 0;
+      for (int i = 0; i < iterations; i++)
+        sum += func();
+      sums[t] = sum;
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+  uint32_t check = 0;
+  for (uint32_t s : sums)
+    check ^= s;
+  printf("%-14s %d threads: %8.2f ns/call (wall), %8.1f Mcalls/s (check %08x)\n", name, numthreads,
+         ns / iterations, (double)numthreads * iterations / ns * 1000.0, check);
+}
+
+} // namespace
+
+int main() {
+  Bench("locked mt19937", LockedRandom32);
+  Bench("thread-local", RTPGenerateRandom32);
+  return 0;
+}
@@ -0,0 +1,81 @@
+// 会话收发路径的基准测试工具，使用进程内的回环传输器排除内核的影响，不作为单元测试运行：./session_bench
+#include <chrono>
+#include <cstdio>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_loopback_transmitter.h"
+#include "utils/media_rtp_endpoint.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int numpackets = 200000;
+const int batchsize = 100;
+const size_t payloadsize = 1200;
+
+int CreateSession(RTPSession &session, RTPLoopbackNetwork &network, uint16_t portbase, const char *cname) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetCNAME(cname);
+
+  RTPLoopbackTransmissionParams transparams;
+  transparams.SetNetwork(&network);
+  transparams.SetPortbase(portbase);
+  transparams.SetRTCPMultiplexing(true);
+  return session.Create(sessparams, &transparams, RTPTransmitter::LoopbackProto);
+}
+
+} // namespace
+
+int main() {
+  RTPLoopbackNetwork network;
+  RTPSession sender, receiver;
+
+  if (CreateSession(sender, network, 5000, "sender@bench") < 0 ||
+      CreateSession(receiver, network, 6000, "receiver@bench") < 0 ||
+      sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, 6000, 6000)) < 0) {
+    fprintf(stderr, "Unable to create the sessions\n");
+    return 1;
+  }
+
+  uint8_t payload[payloadsize] = {0};
+  double sendns = 0, receivens = 0;
+  int received = 0;
+
+  // 每发送一批数据包轮询一次，分别计算发送路径和接收路径（解析、源表、RTCP）的时间
+  for (int sent = 0; sent < numpackets; sent += batchsize) {
+    auto start = Clock::now();
+    for (int i = 0; i < batchsize; i++)
+      sender.SendPacket(payload, sizeof(payload), 96, false, 3000);
+    auto mid = Clock::now();
+
+    receiver.Poll();
+    receiver.BeginDataAccess();
+    if (receiver.GotoFirstSourceWithData()) {
+      do {
+        RTPPacket *pack;
+        while ((pack = receiver.GetNextPacket()) != 0) {
+          received++;
+          receiver.DeletePacket(pack);
+        }
+      } while (receiver.GotoNextSourceWithData());
+    }
+    receiver.EndDataAccess();
+    auto end = Clock::now();
+
+    sendns += std::chrono::duration<double, std::nano>(mid - start).count();
+    receivens += std::chrono::duration<double, std::nano>(end - mid).count();
+  }
+
+  printf("%d packets of %d bytes, %d received\n", numpackets, (int)payloadsize, received);
+  printf("send:    %8.1f ns/packet\n", sendns / numpackets);
+  printf("receive: %8.1f ns/packet\n", receivens / numpackets);
+  printf("dropped by the network: %llu\n", (unsigned long long)(network.GetOverflowPackets() + network.GetUndeliverablePackets()));
+
+  sender.Destroy();
+  receiver.Destroy();
+  return 0;
+}
@@ -0,0 +1,98 @@
+// 同一主机上的传输器基准测试，比较UDPv4回环地址和Unix域数据报套接字，不作为单元测试运行：./transmitter_bench
+#include <chrono>
+#include <cstdio>
+
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "transmitters/media_rtp_unix_transmitter.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_endpoint.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int numpackets = 200000;
+const int batchsize = 8; // 小于 net.unix.max_dgram_qlen 的默认值，避免Unix域套接字丢包
+const size_t payloadsize = 1200;
+
+// 每发送一批数据包轮询一次接收端，分别计算发送和接收（包括释放数据包）的时间
+void Run(const char *name, RTPTransmitter &sender, RTPTransmitter &receiver) {
+  uint8_t packet[payloadsize] = {0x80, 96};
+  double sendns = 0, receivens = 0;
+  int received = 0;
+
+  for (int sent = 0; sent < numpackets; sent += batchsize) {
+    auto start = Clock::now();
+    for (int i = 0; i < batchsize; i++)
+      sender.SendRTPData(packet, sizeof(packet));
+    auto mid = Clock::now();
+
+    receiver.Poll();
+    RTPRawPacket *pack;
+    while ((pack = receiver.GetNextPacket()) != 0) {
+      received++;
+      delete pack;
+    }
+    auto end = Clock::now();
+
+    sendns += std::chrono::duration<double, std::nano>(mid - start).count();
+    receivens += std::chrono::duration<double, std::nano>(end - mid).count();
+  }
+
+  printf("%-8s send: %8.1f ns/packet  receive: %8.1f ns/packet  received: %d/%d\n", name, sendns / numpackets,
+         receivens / numpackets, received, numpackets);
+}
+
+int BenchUDPv4() {
+  RTPUDPv4Transmitter sender, receiver;
+  RTPUDPv4TransmissionParams sendparams, recvparams;
+
+  sendparams.SetBindIP(INADDR_LOOPBACK);
+  sendparams.SetPortbase(15000);
+  sendparams.SetRTCPMultiplexing(true);
+  recvparams.SetBindIP(INADDR_LOOPBACK);
+  recvparams.SetPortbase(15002);
+  recvparams.SetRTCPMultiplexing(true);
+  recvparams.SetRTPReceiveBuffer(1 << 20);
+
+  if (sender.Init(false) < 0 || receiver.Init(false) < 0 || sender.Create(1500, &sendparams) < 0 ||
+      receiver.Create(1500, &recvparams) < 0 || sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, 15002, 15002)) < 0)
+    return -1;
+
+  Run("udpv4", sender, receiver);
+  return 0;
+}
+
+int BenchUnix() {
+  RTPUnixTransmitter sender, receiver;
+  RTPUnixTransmissionParams params;
+
+  params.SetRTCPMultiplexing(true);
+  if (sender.Init(false) < 0 || receiver.Init(false) < 0 || sender.Create(1500, &params) < 0 ||
+      receiver.Create(1500, &params) < 0)
+    return -1;
+
+  RTPTransmissionInfo *inf = receiver.GetTransmissionInfo();
+  int status = sender.AddDestination(static_cast<RTPUnixTransmissionInfo *>(inf)->GetLocalEndpoint());
+  receiver.DeleteTransmissionInfo(inf);
+  if (status < 0)
+    return -1;
+
+  Run("unix", sender, receiver);
+  printf("unix dropped by the sender: %llu\n", (unsigned long long)sender.GetDroppedPackets());
+  return 0;
+}
+
+} // namespace
+
+int main() {
+  if (BenchUDPv4() < 0) {
+    fprintf(stderr, "Unable to create the UDPv4 transmitters\n");
+    return 1;
+  }
+  if (BenchUnix() < 0) {
+    fprintf(stderr, "Unable to create the Unix domain transmitters\n");
+    return 1;
+  }
+  return 0;
+}
@@ -211,3 +211,114 @@ TEST(RTCPPacketsTest, RTCPPacketBuilderBuildsRRWithSDES) {
   // 注意：此对象由内部缓冲区支撑，删除可能触发复杂的释放路径。
   // 在单测进程结束时让系统回收，避免不必要的析构副作用。
 }
+
+TEST(RTCPPacketsTest, GenericNACKPackingAndRoundTrip) {
+  RTCPCompoundPacketBuilder b;
+  ASSERT_EQ(b.InitBuild(1500), 0);
+  ASSERT_EQ(b.StartReceiverReport(0x01020304), 0);
+  // 10 为 PID，11 与 26 落在 BLP 中；27 超出 16 的范围，需要新的项；跨越 65535 回绕
+  const uint16_t lost[] = {10, 11, 26, 27, 65535, 0, 2};
+  ASSERT_EQ(b.AddGenericNACK(0x01020304, 0xA1A2A3A4, lost, 7), 0);
+  ASSERT_EQ(b.EndBuild(), 0);
+
+  RTCPCompoundPacket cp(b.GetCompoundPacketData(), b.GetCompoundPacketLength(), /*deletedata*/false);
+  ASSERT_EQ(cp.GetCreationError(), 0);
+  cp.GotoFirstPacket();
+  RTCPPacket *p = cp.GetNextPacket(); ASSERT_NE(p, nullptr); EXPECT_EQ(p->GetPacketType(), RTCPPacket::RR);
+  p = cp.GetNextPacket(); ASSERT_NE(p, nullptr);
+  ASSERT_EQ(p->GetPacketType(), RTCPPacket::RTPFB);
+  RTCPRTPFBPacket *fb = static_cast<RTCPRTPFBPacket*>(p);
+  ASSERT_TRUE(fb->IsKnownFormat());
+  EXPECT_TRUE(fb->IsGenericNACK());
+  EXPECT_EQ(fb->GetSenderSSRC(), 0x01020304u);
+  EXPECT_EQ(fb->GetMediaSSRC(), 0xA1A2A3A4u);
+  ASSERT_EQ(fb->GetNACKCount(), 3);
+  EXPECT_EQ(fb->GetNACKPID(0), 10);
+  EXPECT_EQ(fb->GetNACKBLP(0), (uint16_t)((1 << 0) | (1 << 15)));
+  EXPECT_EQ(fb->GetNACKPID(1), 27);
+  EXPECT_EQ(fb->GetNACKBLP(1), 0);
+  EXPECT_EQ(fb->GetNACKPID(2), 65535);
+  EXPECT_EQ(fb->GetNACKBLP(2), (uint16_t)((1 << 0) | (1 << 2)));
+
+  uint16_t seqs[16];
+  ASSERT_EQ(fb->GetNACKSequenceNumbers(seqs, 16), 7);
+  for (int i = 0; i < 7; i++)
+    EXPECT_EQ(seqs[i], lost[i]);
+  // 输出缓冲区不足时截断
+  EXPECT_EQ(fb->GetNACKSequenceNumbers(seqs, 2), 2);
+  EXPECT_EQ(cp.GetNextPacket(), nullptr);
+}
+
+TEST(RTCPPacketsTest, PLIAndFIRFields) {
+  RTCPCompoundPacketBuilder b;
+  ASSERT_EQ(b.InitBuild(1500), 0);
+  ASSERT_EQ(b.StartReceiverReport(0x01020304), 0);
+  ASSERT_EQ(b.AddPLI(0x01020304, 0x0A0B0C0D), 0);
+  const uint32_t firssrcs[2] = {0x11111111, 0x22222222};
+  const uint8_t firseqs[2] = {3, 200};
+  ASSERT_EQ(b.AddFIR(0x01020304, firssrcs, firseqs, 2), 0);
+  EXPECT_EQ(b.AddFIR(0x01020304, firssrcs, firseqs, 0), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  ASSERT_EQ(b.EndBuild(), 0);
+
+  RTCPCompoundPacket cp(b.GetCompoundPacketData(), b.GetCompoundPacketLength(), /*deletedata*/false);
+  ASSERT_EQ(cp.GetCreationError(), 0);
+  cp.GotoFirstPacket();
+  RTCPPacket *p = cp.GetNextPacket(); ASSERT_NE(p, nullptr); // RR
+
+  p = cp.GetNextPacket(); ASSERT_NE(p, nullptr);
+  ASSERT_EQ(p->GetPacketType(), RTCPPacket::PSFB);
+  RTCPPSFBPacket *pli = static_cast<RTCPPSFBPacket*>(p);
+  ASSERT_TRUE(pli->IsKnownFormat());
+  EXPECT_TRUE(pli->IsPLI());
+  EXPECT_FALSE(pli->IsFIR());
+  EXPECT_EQ(pli->GetMediaSSRC(), 0x0A0B0C0Du);
+  EXPECT_EQ(pli->GetFCILength(), 0u);
+  EXPECT_EQ(pli->GetFCIData(), nullptr);
+
+  p = cp.GetNextPacket(); ASSERT_NE(p, nullptr);
+  ASSERT_EQ(p->GetPacketType(), RTCPPacket::PSFB);
+  RTCPPSFBPacket *fir = static_cast<RTCPPSFBPacket*>(p);
+  ASSERT_TRUE(fir->IsKnownFormat());
+  EXPECT_TRUE(fir->IsFIR());
+  EXPECT_EQ(fir->GetMediaSSRC(), 0u);
+  ASSERT_EQ(fir->GetFIRCount(), 2);
+  EXPECT_EQ(fir->GetFIRSSRC(0), 0x11111111u);
+  EXPECT_EQ(fir->GetFIRSequenceNumber(0), 3);
+  EXPECT_EQ(fir->GetFIRSSRC(1), 0x22222222u);
+  EXPECT_EQ(fir->GetFIRSequenceNumber(1), 200);
+}
+
+TEST(RTCPPacketsTest, REMBFieldsAndMalformedFeedback) {
+  RTCPCompoundPacketBuilder b;
+  ASSERT_EQ(b.InitBuild(1500), 0);
+  ASSERT_EQ(b.StartReceiverReport(0x01020304), 0);
+  const uint32_t ssrcs[2] = {0xAAAA0001, 0xAAAA0002};
+  // 2.5 Mbit/s 需要指数编码，低位会被截断为 18 位尾数
+  ASSERT_EQ(b.AddREMB(0x01020304, 2500000, ssrcs, 2), 0);
+  ASSERT_EQ(b.EndBuild(), 0);
+
+  RTCPCompoundPacket cp(b.GetCompoundPacketData(), b.GetCompoundPacketLength(), /*deletedata*/false);
+  ASSERT_EQ(cp.GetCreationError(), 0);
+  cp.GotoFirstPacket();
+  RTCPPacket *p = cp.GetNextPacket(); ASSERT_NE(p, nullptr); // RR
+  p = cp.GetNextPacket(); ASSERT_NE(p, nullptr);
+  ASSERT_EQ(p->GetPacketType(), RTCPPacket::PSFB);
+  RTCPPSFBPacket *remb = static_cast<RTCPPSFBPacket*>(p);
+  ASSERT_TRUE(remb->IsREMB());
+  uint64_t br = remb->GetREMBBitrate();
+  EXPECT_LE(br, 2500000u);
+  EXPECT_GT(br, 2500000u - 16u);
+  ASSERT_EQ(remb->GetREMBSSRCCount(), 2);
+  EXPECT_EQ(remb->GetREMBSSRC(0), 0xAAAA0001u);
+  EXPECT_EQ(remb->GetREMBSSRC(1), 0xAAAA0002u);
+
+  // 长度不足以容纳发送者与媒体 SSRC 的反馈包不是已知格式
+  std::vector<uint8_t> buf(8, 0);
+  RTCPCommonHeader *hdr = reinterpret_cast<RTCPCommonHeader*>(buf.data());
+  hdr->version = 2; hdr->padding = 0; hdr->count = RTCP_RTPFB_FMT_NACK;
+  hdr->packettype = RTP_RTCPTYPE_RTPFB;
+  hdr->length = htons(1);
+  RTCPRTPFBPacket bad(buf.data(), buf.size());
+  EXPECT_FALSE(bad.IsKnownFormat());
+  EXPECT_EQ(bad.GetNACKCount(), 0);
+}
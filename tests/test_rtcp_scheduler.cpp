@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include "core/media_rtcp_scheduler.h"
+#include "core/media_rtp_sources.h"
+#include "packets/media_rtcp_packet_factory.h"
+#include "packets/media_rtp_packet_factory.h"
+
+namespace {
+
+// 带宽很小，使常规间隔远大于测试时长
+RTCPSchedulerParams MakeParams(bool avpf) {
+  RTCPSchedulerParams params;
+  EXPECT_EQ(params.SetRTCPBandwidth(10.0), 0);
+  params.SetUseAVPF(avpf);
+  return params;
+}
+
+} // namespace
+
+TEST(RTCPSchedulerTest, EarlyFeedbackRequiresAVPF) {
+  RTPSources sources;
+  ASSERT_EQ(sources.CreateOwnSSRC(0x01020304), 0);
+  RTCPScheduler sched(sources);
+  sched.SetParameters(MakeParams(false));
+
+  EXPECT_FALSE(sched.IsTime()); // 第一次调用只计算下一次发送时间
+  EXPECT_FALSE(sched.ScheduleEarlyFeedback());
+  EXPECT_GT(sched.GetTransmissionDelay().GetDouble(), 1.0);
+  EXPECT_FALSE(sched.IsTime());
+}
+
+TEST(RTCPSchedulerTest, AVPFSendsOneEarlyPacketPerRegularInterval) {
+  RTPSources sources;
+  ASSERT_EQ(sources.CreateOwnSSRC(0x01020304), 0);
+  RTCPScheduler sched(sources);
+  sched.SetParameters(MakeParams(true));
+
+  EXPECT_FALSE(sched.IsTime());
+  double regular = sched.GetTransmissionDelay().GetDouble();
+  EXPECT_GT(regular, 1.0);
+
+  // 点对点（成员不超过两个）时不抖动，提前包立即可以发送
+  EXPECT_TRUE(sched.ScheduleEarlyFeedback());
+  EXPECT_LT(sched.GetTransmissionDelay().GetDouble(), 0.01);
+  EXPECT_TRUE(sched.IsTime());
+  EXPECT_TRUE(sched.IsEarlyPacket());
+
+  // 提前包占用了下一个常规包的份额：下一次发送被推迟，且不再允许提前发送
+  EXPECT_GT(sched.GetTransmissionDelay().GetDouble(), regular);
+  EXPECT_FALSE(sched.ScheduleEarlyFeedback());
+  EXPECT_FALSE(sched.IsTime());
+  EXPECT_FALSE(sched.IsEarlyPacket());
+}
+
+TEST(RTCPSchedulerTest, PacketBuilderIncludesPendingFeedback) {
+  RTPSources sources;
+  RTPPacketBuilder rtpb;
+  ASSERT_EQ(rtpb.Init(512), 0);
+  RTCPPacketBuilder rtcpb(sources, rtpb);
+  ASSERT_EQ(rtcpb.Init(1200, 1.0/8000.0, "me", 2), 0);
+
+  const uint16_t lost[] = {100, 101};
+  ASSERT_EQ(rtcpb.AddNACKRequest(0xABCDEF01, lost, 2), 0);
+  ASSERT_EQ(rtcpb.AddPLIRequest(0xABCDEF01), 0);
+  ASSERT_EQ(rtcpb.AddPLIRequest(0xABCDEF01), 0); // 重复请求被合并
+  EXPECT_TRUE(rtcpb.HasPendingFeedback());
+
+  RTCPCompoundPacket *pack = nullptr;
+  ASSERT_EQ(rtcpb.BuildNextPacket(&pack), 0);
+  ASSERT_NE(pack, nullptr);
+  EXPECT_FALSE(rtcpb.HasPendingFeedback());
+
+  int nacks = 0, plis = 0;
+  pack->GotoFirstPacket();
+  RTCPPacket *p;
+  while ((p = pack->GetNextPacket()) != nullptr) {
+    if (p->GetPacketType() == RTCPPacket::RTPFB) {
+      RTCPRTPFBPacket *fb = static_cast<RTCPRTPFBPacket*>(p);
+      EXPECT_EQ(fb->GetMediaSSRC(), 0xABCDEF01u);
+      EXPECT_EQ(fb->GetNACKPID(0), 100);
+      EXPECT_EQ(fb->GetNACKBLP(0), 1);
+      nacks++;
+    } else if (p->GetPacketType() == RTCPPacket::PSFB) {
+      EXPECT_TRUE(static_cast<RTCPPSFBPacket*>(p)->IsPLI());
+      plis++;
+    }
+  }
+  EXPECT_EQ(nacks, 1);
+  EXPECT_EQ(plis, 1);
+  delete pack;
+}
+
+TEST(RTCPSchedulerTest, OverlappingNACKRequestsAreMergedInOrder) {
+  RTPSources sources;
+  RTPPacketBuilder rtpb;
+  ASSERT_EQ(rtpb.Init(512), 0);
+  RTCPPacketBuilder rtcpb(sources, rtpb);
+  ASSERT_EQ(rtcpb.Init(1200, 1.0/8000.0, "me", 2), 0);
+
+  // 乱序、重复，并且跨越序列号回绕
+  const uint16_t first[] = {105, 100, 103};
+  const uint16_t second[] = {103, 101, 65535, 100};
+  ASSERT_EQ(rtcpb.AddNACKRequest(0xABCDEF01, first, 3), 0);
+  ASSERT_EQ(rtcpb.AddNACKRequest(0xABCDEF01, second, 4), 0);
+
+  RTCPCompoundPacket *pack = nullptr;
+  ASSERT_EQ(rtcpb.BuildNextPacket(&pack), 0);
+  ASSERT_NE(pack, nullptr);
+
+  RTCPRTPFBPacket *fb = nullptr;
+  RTCPPacket *p;
+  pack->GotoFirstPacket();
+  while ((p = pack->GetNextPacket()) != nullptr) {
+    if (p->GetPacketType() == RTCPPacket::RTPFB) {
+      ASSERT_EQ(fb, nullptr);
+      fb = static_cast<RTCPRTPFBPacket*>(p);
+    }
+  }
+  ASSERT_NE(fb, nullptr);
+  ASSERT_EQ(fb->GetNACKCount(), 2);
+  EXPECT_EQ(fb->GetNACKPID(0), 65535);
+  EXPECT_EQ(fb->GetNACKBLP(0), 0);
+  EXPECT_EQ(fb->GetNACKPID(1), 100);
+  EXPECT_EQ(fb->GetNACKBLP(1), (uint16_t)((1 << 0) | (1 << 2) | (1 << 4)));
+
+  uint16_t seqs[8];
+  ASSERT_EQ(fb->GetNACKSequenceNumbers(seqs, 8), 5);
+  const uint16_t expected[] = {65535, 100, 101, 103, 105};
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(seqs[i], expected[i]);
+  }
+  delete pack;
+}
+
+TEST(RTCPSchedulerTest, OversizedNACKListIsSplit) {
+  RTPSources sources;
+  RTPPacketBuilder rtpb;
+  ASSERT_EQ(rtpb.Init(512), 0);
+  RTCPPacketBuilder rtcpb(sources, rtpb);
+  ASSERT_EQ(rtcpb.Init(600, 1.0/8000.0, "me", 2), 0);
+
+  // 每个序列号需要单独的 PID/BLP 项，总数超过一个反馈数据包的上限
+  std::vector<uint16_t> lost;
+  for (int i = 0; i < 400; i++)
+    lost.push_back((uint16_t)(60000 + i * 20));
+  ASSERT_EQ(rtcpb.AddNACKRequest(0xABCDEF01, lost.data(), (int)lost.size()), 0);
+
+  std::vector<uint16_t> reported;
+  for (int n = 0; n < 10 && rtcpb.HasPendingFeedback(); n++) {
+    RTCPCompoundPacket *pack = nullptr;
+    ASSERT_EQ(rtcpb.BuildNextPacket(&pack), 0);
+    pack->GotoFirstPacket();
+    RTCPPacket *p;
+    while ((p = pack->GetNextPacket()) != nullptr) {
+      if (p->GetPacketType() == RTCPPacket::RTPFB) {
+        RTCPRTPFBPacket *fb = static_cast<RTCPRTPFBPacket*>(p);
+        uint16_t seqs[RTCP_FB_MAXNACKITEMS];
+        int num = fb->GetNACKSequenceNumbers(seqs, RTCP_FB_MAXNACKITEMS);
+        reported.insert(reported.end(), seqs, seqs + num);
+      }
+    }
+    delete pack;
+  }
+  EXPECT_FALSE(rtcpb.HasPendingFeedback());
+  EXPECT_EQ(reported, lost);
+}
@@ -0,0 +1,460 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_bundle_transmitter.h"
+#include "packets/media_rtcp_packet_factory.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_errors.h"
+
+namespace {
+
+// 模拟对端的普通UDP套接字
+class PeerSocket {
+public:
+  PeerSocket() {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sock, (struct sockaddr *)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(sock, (struct sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+  }
+  ~PeerSocket() { close(sock); }
+
+  void Send(const std::vector<uint8_t> &data, uint16_t destport) {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(destport);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sendto(sock, data.data(), data.size(), 0, (struct sockaddr *)&addr, sizeof(addr));
+  }
+
+  RTPEndpoint GetEndpoint() const { return RTPEndpoint(INADDR_LOOPBACK, port, port); }
+
+  int sock;
+  uint16_t port;
+};
+
+void AppendUInt32(std::vector<uint8_t> &v, uint32_t x) {
+  v.push_back((uint8_t)(x >> 24));
+  v.push_back((uint8_t)(x >> 16));
+  v.push_back((uint8_t)(x >> 8));
+  v.push_back((uint8_t)x);
+}
+
+std::vector<uint8_t> MakeRTP(uint32_t ssrc) {
+  std::vector<uint8_t> v = {0x80, 96, 0, 1, 0, 0, 0, 0};
+  AppendUInt32(v, ssrc);
+  v.resize(v.size() + 20, 0);
+  return v;
+}
+
+std::vector<uint8_t> MakeSR(uint32_t ssrc) {
+  std::vector<uint8_t> v = {0x80, 200, 0, 6};
+  AppendUInt32(v, ssrc);
+  v.resize(v.size() + 20, 0);
+  return v;
+}
+
+// 带一个报告块的RR，\c target 为零时不带报告块
+std::vector<uint8_t> MakeRR(uint32_t ssrc, uint32_t target = 0) {
+  std::vector<uint8_t> v = {(uint8_t)(target ? 0x81 : 0x80), 201, 0, (uint8_t)(target ? 7 : 1)};
+  AppendUInt32(v, ssrc);
+  if (target) {
+    AppendUInt32(v, target);
+    v.resize(v.size() + 20, 0);
+  }
+  return v;
+}
+
+// 请求一个序列号的通用NACK
+std::vector<uint8_t> MakeNACK(uint32_t ssrc, uint32_t mediassrc) {
+  std::vector<uint8_t> v = {0x81, 205, 0, 3};
+  AppendUInt32(v, ssrc);
+  AppendUInt32(v, mediassrc);
+  v.insert(v.end(), {0, 1, 0, 0});
+  return v;
+}
+
+std::vector<uint8_t> MakeSDES(uint32_t ssrc) {
+  std::vector<uint8_t> v = {0x81, 202, 0, 2};
+  AppendUInt32(v, ssrc);
+  v.insert(v.end(), {1, 1, 'a', 0});
+  return v;
+}
+
+std::vector<uint8_t> Concat(std::initializer_list<std::vector<uint8_t>> parts) {
+  std::vector<uint8_t> v;
+  for (const auto &p : parts)
+    v.insert(v.end(), p.begin(), p.end());
+  return v;
+}
+
+int CreateTransmitter(RTPBundleTransmitter &trans, RTPBundleTransport &transport, uint32_t remotessrc = 0,
+                      bool polltransport = true) {
+  RTPBundleTransmissionParams params;
+  params.SetTransport(&transport);
+  params.SetPollTransport(polltransport);
+  if (remotessrc != 0)
+    params.AddRemoteSSRC(remotessrc);
+
+  int status = trans.Init(false);
+  if (status < 0)
+    return status;
+  return trans.Create(1400, &params);
+}
+
+// 等待传输的套接字可读，然后分配所有数据包
+void PollTransport(RTPBundleTransport &transport, std::vector<RTPBundleTransmitter *> *ready = nullptr) {
+  std::vector<int8_t> flags(transport.GetSockets().size(), 0);
+  RTPSelect(transport.GetSockets().data(), flags.data(), flags.size(), RTPTime(1.0));
+  ASSERT_EQ(transport.Poll(ready), 0);
+}
+
+bool IsReadable(int fd) {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  return poll(&pfd, 1, 0) == 1;
+}
+
+uint32_t GetPacketSSRC(RTPRawPacket *pack) {
+  const uint8_t *p = pack->GetData() + 8;
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+} // namespace
+
+TEST(RTPBundleTransmitterTest, RoutesRTPBySSRCAndAddress) {
+  RTPBundleTransport transport;
+  ASSERT_EQ(transport.Create(INADDR_LOOPBACK, 0), 0);
+  ASSERT_NE(transport.GetPort(), 0);
+
+  RTPBundleTransmitter a, b;
+  ASSERT_EQ(CreateTransmitter(a, transport, 1), 0);
+  ASSERT_EQ(CreateTransmitter(b, transport), 0);
+  ASSERT_EQ(b.AddRemoteSSRC(2), 0);
+
+  PeerSocket peer;
+  peer.Send(MakeRTP(1), transport.GetPort());
+  peer.Send(MakeRTP(2), transport.GetPort());
+  peer.Send(MakeRTP(3), transport.GetPort());
+
+  std::vector<RTPBundleTransmitter *> ready;
+  PollTransport(transport, &ready);
+  EXPECT_EQ(ready.size(), 2u);
+  EXPECT_EQ(transport.GetUnroutablePackets(), 1u);
+
+  RTPRawPacket *pack = a.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(GetPacketSSRC(pack), 1u);
+  EXPECT_TRUE(pack->IsRTP());
+  EXPECT_EQ(pack->GetSenderAddress()->GetRtpPort(), peer.port);
+  EXPECT_FALSE(a.ComesFromThisTransmitter(pack->GetSenderAddress()));
+  delete pack;
+  EXPECT_EQ(a.GetNextPacket(), nullptr);
+
+  pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(GetPacketSSRC(pack), 2u);
+  delete pack;
+
+  RTPEndpoint self(INADDR_LOOPBACK, transport.GetPort(), transport.GetPort());
+  EXPECT_TRUE(a.ComesFromThisTransmitter(&self));
+  EXPECT_TRUE(b.ComesFromThisTransmitter(&self));
+
+  // 来自某个会话唯一的目的地址的新SSRC记给这个会话
+  ASSERT_EQ(a.AddDestination(peer.GetEndpoint()), 0);
+  peer.Send(MakeRTP(3), transport.GetPort());
+  PollTransport(transport);
+  pack = a.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(GetPacketSSRC(pack), 3u);
+  delete pack;
+
+  // 两个会话使用同一个目的地址后只有已知的SSRC能够分配
+  ASSERT_EQ(b.AddDestination(peer.GetEndpoint()), 0);
+  peer.Send(MakeRTP(3), transport.GetPort());
+  peer.Send(MakeRTP(4), transport.GetPort());
+  PollTransport(transport);
+  pack = a.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(GetPacketSSRC(pack), 3u);
+  delete pack;
+  EXPECT_EQ(b.GetNextPacket(), nullptr);
+  EXPECT_EQ(transport.GetUnroutablePackets(), 2u);
+
+  // 销毁A以后B是唯一使用这个地址的会话
+  a.Destroy();
+  peer.Send(MakeRTP(1), transport.GetPort());
+  PollTransport(transport);
+  pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(GetPacketSSRC(pack), 1u);
+  delete pack;
+  EXPECT_EQ(transport.GetUnroutablePackets(), 2u);
+}
+
+TEST(RTPBundleTransmitterTest, ReadyDescriptorFollowsReceiveQueue) {
+  RTPBundleTransport transport;
+  ASSERT_EQ(transport.Create(INADDR_LOOPBACK, 0), 0);
+
+  // 由应用程序读取共享传输时，会话等待的是自己的描述符而不是共享的套接字
+  RTPBundleTransmitter trans;
+  ASSERT_EQ(CreateTransmitter(trans, transport, 1, false), 0);
+  std::vector<int> fds;
+  ASSERT_EQ(trans.GetReceiveDescriptors(fds), 0);
+  ASSERT_EQ(fds.size(), 1u);
+  EXPECT_NE(fds[0], transport.GetSockets()[0]);
+  EXPECT_FALSE(IsReadable(fds[0]));
+  EXPECT_EQ(trans.PollDescriptor(transport.GetSockets()[0]), MEDIA_RTP_ERR_INVALID_PARAMETER);
+
+  PeerSocket peer;
+  peer.Send(MakeRTP(1), transport.GetPort());
+  peer.Send(MakeRTP(1), transport.GetPort());
+  PollTransport(transport);
+  EXPECT_TRUE(IsReadable(fds[0]));
+  ASSERT_EQ(trans.PollDescriptor(fds[0]), 0);
+
+  // 取空接收队列后描述符不再可读
+  RTPRawPacket *pack = trans.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  delete pack;
+  EXPECT_TRUE(IsReadable(fds[0]));
+  pack = trans.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  delete pack;
+  EXPECT_FALSE(IsReadable(fds[0]));
+
+  // 等待也只在数据包分配给此会话时返回
+  bool available = true;
+  ASSERT_EQ(trans.WaitForIncomingData(RTPTime(0.01), &available), 0);
+  EXPECT_FALSE(available);
+  peer.Send(MakeRTP(1), transport.GetPort());
+  PollTransport(transport);
+  ASSERT_EQ(trans.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  EXPECT_TRUE(available);
+}
+
+TEST(RTPBundleTransmitterTest, RTCPIsSentToRTPPort) {
+  RTPBundleTransport transport;
+  ASSERT_EQ(transport.Create(INADDR_LOOPBACK, 0), 0);
+  RTPBundleTransmitter trans;
+  ASSERT_EQ(CreateTransmitter(trans, transport), 0);
+
+  // 目的地址的RTCP端口被忽略，对端只在复用的端口上接收
+  PeerSocket peer;
+  ASSERT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, peer.port, peer.port + 1)), 0);
+  std::vector<uint8_t> rr = MakeRR(7);
+  ASSERT_EQ(trans.SendRTCPData(rr.data(), rr.size()), 0);
+
+  struct pollfd pfd = {peer.sock, POLLIN, 0};
+  ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+  uint8_t buf[64];
+  ASSERT_EQ(recv(peer.sock, buf, sizeof(buf), 0), (ssize_t)rr.size());
+  EXPECT_EQ(buf[1], 201);
+}
+
+TEST(RTPBundleTransmitterTest, FeedbackFollowsAllLocalSSRCs) {
+  RTPBundleTransport transport;
+  ASSERT_EQ(transport.Create(INADDR_LOOPBACK, 0), 0);
+
+  // 两个会话发往同一个对端地址，不能按源地址分配
+  RTPBundleTransmitter a, b;
+  ASSERT_EQ(CreateTransmitter(a, transport), 0);
+  ASSERT_EQ(CreateTransmitter(b, transport), 0);
+  PeerSocket peer;
+  ASSERT_EQ(a.AddDestination(peer.GetEndpoint()), 0);
+  ASSERT_EQ(b.AddDestination(peer.GetEndpoint()), 0);
+
+  // A 先发送媒体包，再发送RTX和FEC包，它们使用不同的SSRC
+  std::vector<uint8_t> media = MakeRTP(0xA), rtx = MakeRTP(0xA1), fec = MakeRTP(0xA2), other = MakeRTP(0xB);
+  ASSERT_EQ(a.SendRTPData(media.data(), media.size()), 0);
+  ASSERT_EQ(b.SendRTPData(other.data(), other.size()), 0);
+  ASSERT_EQ(a.SendRTPData(rtx.data(), rtx.size()), 0);
+  ASSERT_EQ(a.SendRTPData(fec.data(), fec.size()), 0);
+
+  // 指向媒体SSRC的报告块和NACK仍然分配给A
+  std::vector<uint8_t> compound = Concat({MakeRR(9, 0xA), MakeNACK(9, 0xA)});
+  peer.Send(compound, transport.GetPort());
+  PollTransport(transport);
+  RTPRawPacket *pack = a.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(pack->GetDataLength(), compound.size());
+  delete pack;
+
+  // 指向RTX SSRC的反馈也分配给A
+  peer.Send(MakeRR(9, 0xA1), transport.GetPort());
+  PollTransport(transport);
+  pack = a.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  delete pack;
+
+  EXPECT_EQ(b.GetNextPacket(), nullptr);
+  EXPECT_EQ(transport.GetUnroutablePackets(), 0u);
+}
+
+TEST(RTPBundleTransmitterTest, CountsFailedSends) {
+  RTPBundleTransport transport;
+  ASSERT_EQ(transport.Create(INADDR_LOOPBACK, 0), 0);
+  RTPBundleTransmitter trans;
+  ASSERT_EQ(CreateTransmitter(trans, transport), 0);
+
+  // 端口零不能作为目的端口，发送失败
+  PeerSocket peer;
+  ASSERT_EQ(trans.AddDestination(peer.GetEndpoint()), 0);
+  ASSERT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, 0, 0)), 0);
+  std::vector<uint8_t> rtp = MakeRTP(0xA);
+  ASSERT_EQ(trans.SendRTPData(rtp.data(), rtp.size()), 0);
+  EXPECT_EQ(trans.GetDroppedPackets(), 1u);
+}
+
+TEST(RTPBundleTransmitterTest, SplitsCompoundRTCPPerSession) {
+  RTPBundleTransport transport;
+  ASSERT_EQ(transport.Create(INADDR_LOOPBACK, 0), 0);
+
+  RTPBundleTransmitter a, b;
+  ASSERT_EQ(CreateTransmitter(a, transport, 1), 0);
+  ASSERT_EQ(CreateTransmitter(b, transport, 2), 0);
+
+  PeerSocket peer;
+
+  // 从A发出的数据包中学到A自己的SSRC
+  ASSERT_EQ(a.AddDestination(peer.GetEndpoint()), 0);
+  std::vector<uint8_t> own = MakeRTP(0xA);
+  ASSERT_EQ(a.SendRTPData(own.data(), own.size()), 0);
+
+  std::vector<uint8_t> compound = Concat({MakeSR(1), MakeRR(2), MakeSDES(1), MakeSDES(2)});
+  peer.Send(compound, transport.GetPort());
+  PollTransport(transport);
+
+  RTPRawPacket *pack = a.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_FALSE(pack->IsRTP());
+  EXPECT_EQ(pack->GetDataLength(), MakeSR(1).size() + MakeSDES(1).size());
+  {
+    RTCPCompoundPacket rtcp(*pack);
+    ASSERT_EQ(rtcp.GetCreationError(), 0);
+    rtcp.GotoFirstPacket();
+    EXPECT_EQ(rtcp.GetNextPacket()->GetPacketType(), RTCPPacket::SR);
+    EXPECT_EQ(rtcp.GetNextPacket()->GetPacketType(), RTCPPacket::SDES);
+    EXPECT_EQ(rtcp.GetNextPacket(), nullptr);
+  }
+  delete pack;
+
+  pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(pack->GetDataLength(), MakeRR(2).size() + MakeSDES(2).size());
+  delete pack;
+
+  // 发给B的部分不以RR开头时加上一个空的RR
+  peer.Send(Concat({MakeRR(1), MakeSDES(2)}), transport.GetPort());
+  PollTransport(transport);
+  delete a.GetNextPacket();
+
+  pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  {
+    RTCPCompoundPacket rtcp(*pack);
+    ASSERT_EQ(rtcp.GetCreationError(), 0);
+    rtcp.GotoFirstPacket();
+    RTCPPacket *first = rtcp.GetNextPacket();
+    ASSERT_EQ(first->GetPacketType(), RTCPPacket::RR);
+    EXPECT_EQ(static_cast<RTCPRRPacket *>(first)->GetSenderSSRC(), 2u);
+    EXPECT_EQ(static_cast<RTCPRRPacket *>(first)->GetReceptionReportCount(), 0);
+    EXPECT_EQ(rtcp.GetNextPacket()->GetPacketType(), RTCPPacket::SDES);
+  }
+  delete pack;
+
+  // 未知发送者的报告块指向A的SSRC，整个复合数据包原样交给A
+  compound = Concat({MakeRR(9, 0xA), MakeSDES(9)});
+  peer.Send(compound, transport.GetPort());
+  PollTransport(transport);
+  pack = a.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  ASSERT_EQ(pack->GetDataLength(), compound.size());
+  EXPECT_EQ(memcmp(pack->GetData(), compound.data(), compound.size()), 0);
+  delete pack;
+  EXPECT_EQ(b.GetNextPacket(), nullptr);
+  EXPECT_EQ(transport.GetUnroutablePackets(), 0u);
+}
+
+TEST(RTPBundleTransmitterTest, SessionsShareOneTransport) {
+  RTPBundleTransport sendtransport, recvtransport;
+  ASSERT_EQ(sendtransport.Create(INADDR_LOOPBACK, 0), 0);
+  ASSERT_EQ(recvtransport.Create(INADDR_LOOPBACK, 0, 2), 0);
+  ASSERT_EQ(recvtransport.GetSockets().size(), 2u);
+
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetCNAME("bundle@test");
+
+  RTPSession senders[2], receivers[2];
+  RTPBundleTransmitter receivertrans[2];
+  RTPEndpoint recvaddr(INADDR_LOOPBACK, recvtransport.GetPort(), recvtransport.GetPort());
+  RTPEndpoint sendaddr(INADDR_LOOPBACK, sendtransport.GetPort(), sendtransport.GetPort());
+
+  for (int i = 0; i < 2; i++) {
+    RTPBundleTransmissionParams params;
+    params.SetTransport(&sendtransport);
+    ASSERT_EQ(senders[i].Create(sessparams, &params, RTPTransmitter::BundleProto), 0);
+    ASSERT_EQ(senders[i].AddDestination(recvaddr), 0);
+
+    // 接收端由应用程序轮询共享传输，会话的 Poll 只取出已分配的数据包
+    RTPBundleTransmissionParams recvparams;
+    recvparams.SetTransport(&recvtransport);
+    recvparams.SetPollTransport(false);
+    recvparams.AddRemoteSSRC(senders[i].GetLocalSSRC());
+    ASSERT_EQ(receivertrans[i].Init(false), 0);
+    ASSERT_EQ(receivertrans[i].Create(1400, &recvparams), 0);
+    ASSERT_EQ(receivers[i].Create(sessparams, &receivertrans[i]), 0);
+    ASSERT_EQ(receivers[i].AddDestination(sendaddr), 0);
+  }
+
+  const int counts[2] = {20, 30};
+  uint8_t payload[100] = {0};
+  for (int i = 0; i < 2; i++)
+    for (int j = 0; j < counts[i]; j++)
+      ASSERT_EQ(senders[i].SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+
+  int received[2] = {0, 0};
+  for (int attempt = 0; attempt < 20 && received[0] + received[1] < counts[0] + counts[1] - 2; attempt++) {
+    std::vector<RTPBundleTransmitter *> ready;
+    std::vector<int8_t> flags(2, 0);
+    RTPSelect(recvtransport.GetSockets().data(), flags.data(), 2, RTPTime(0.05));
+    ASSERT_EQ(recvtransport.Poll(&ready), 0);
+
+    for (int i = 0; i < 2; i++) {
+      ASSERT_EQ(receivers[i].Poll(), 0);
+      receivers[i].BeginDataAccess();
+      if (receivers[i].GotoFirstSourceWithData()) {
+        do {
+          RTPPacket *pack;
+          while ((pack = receivers[i].GetNextPacket()) != nullptr) {
+            EXPECT_EQ(pack->GetSSRC(), senders[i].GetLocalSSRC());
+            received[i]++;
+            receivers[i].DeletePacket(pack);
+          }
+        } while (receivers[i].GotoNextSourceWithData());
+      }
+      receivers[i].EndDataAccess();
+    }
+  }
+
+  // 新的源在验证期间可能保留第一个数据包
+  EXPECT_GE(received[0], counts[0] - 1);
+  EXPECT_GE(received[1], counts[1] - 1);
+  EXPECT_EQ(recvtransport.GetUnroutablePackets(), 0u);
+
+  for (int i = 0; i < 2; i++) {
+    senders[i].Destroy();
+    receivers[i].Destroy();
+    receivertrans[i].Destroy();
+  }
+}
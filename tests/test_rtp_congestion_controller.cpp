@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <vector>
+
+#include "core/media_rtp_congestion_controller.h"
+#include "core/media_rtp_transport_cc.h"
+
+namespace {
+
+RTPTime FromMicroSeconds(int64_t us) {
+  return RTPTime(us / 1000000, (uint32_t)(us % 1000000));
+}
+
+// 确定性的网络模拟：发送端按目标码率均匀发送，数据包经过一个容量可变、
+// 带尾部丢弃队列的瓶颈链路；接收端用 RTPTransportCCRecorder 记录到达时间，
+// 每100毫秒生成一次transport-cc反馈，经过单向延迟后交给控制器。
+class NetworkSimulation {
+public:
+  NetworkSimulation(RTPCongestionController &cc, double capacity)
+      : controller(cc), capacity(capacity), now(0), nextsend(0),
+        nextfeedback(100000), linkfree(0), seqnr(0) {}
+
+  void SetCapacity(double c) { capacity = c; }
+
+  // 运行到 \c until（微秒）
+  void Run(int64_t until) {
+    while (now < until) {
+      int64_t next = (nextsend < nextfeedback) ? nextsend : nextfeedback;
+
+      if (!pendingfeedback.empty() && pendingfeedback.front().first < next)
+        next = pendingfeedback.front().first;
+      now = next;
+
+      if (!pendingfeedback.empty() && pendingfeedback.front().first == now) {
+        RTPTransportCCFeedback fb;
+        std::vector<uint8_t> &fci = pendingfeedback.front().second;
+        ASSERT_EQ(fb.Parse(fci.data(), fci.size()), 0);
+        controller.OnTransportFeedback(fb, FromMicroSeconds(now));
+        pendingfeedback.pop_front();
+      } else if (now == nextsend) {
+        SendPacket();
+        nextsend = now + (int64_t)(packetsize * 8.0 * 1000000.0 / controller.GetTargetBitrate());
+      } else {
+        DeliverFeedback();
+        nextfeedback = now + 100000;
+      }
+    }
+  }
+
+  int64_t GetMaximumQueueDelay() const { return maxqueuedelay; }
+  void ResetMaximumQueueDelay() { maxqueuedelay = 0; }
+
+private:
+  static const int packetsize = 1200;
+  static const int64_t onewaydelay = 20000;
+  static const int64_t queuelimit = 400000;
+
+  void SendPacket() {
+    controller.OnPacketSent(seqnr, packetsize, FromMicroSeconds(now));
+
+    int64_t start = (linkfree > now) ? linkfree : now;
+    int64_t queuedelay = start - now;
+
+    if (queuedelay > maxqueuedelay)
+      maxqueuedelay = queuedelay;
+    if (queuedelay <= queuelimit) {
+      linkfree = start + (int64_t)(packetsize * 8.0 * 1000000.0 / capacity);
+      inflight.push_back(std::make_pair(linkfree + onewaydelay, seqnr));
+    }
+    seqnr++;
+  }
+
+  void DeliverFeedback() {
+    while (!inflight.empty() && inflight.front().first <= now) {
+      recorder.ProcessPacket(inflight.front().second, FromMicroSeconds(inflight.front().first));
+      inflight.pop_front();
+    }
+    while (recorder.HasPendingFeedback()) {
+      uint8_t fci[RTP_TRANSPORTCC_MAXFCISIZE];
+      size_t fcilen;
+      ASSERT_EQ(recorder.BuildFeedback(fci, sizeof(fci), &fcilen), 0);
+      pendingfeedback.push_back(std::make_pair(now + onewaydelay, std::vector<uint8_t>(fci, fci + fcilen)));
+    }
+  }
+
+  RTPCongestionController &controller;
+  RTPTransportCCRecorder recorder;
+  double capacity;
+  int64_t now, nextsend, nextfeedback, linkfree;
+  int64_t maxqueuedelay = 0;
+  uint16_t seqnr;
+  std::deque<std::pair<int64_t, uint16_t>> inflight;
+  std::deque<std::pair<int64_t, std::vector<uint8_t>>> pendingfeedback;
+};
+
+} // namespace
+
+TEST(RTPCongestionControllerTest, ConvergesToBottleneckCapacity) {
+  RTPDelayBasedController cc(300000, 30000, 5000000);
+  NetworkSimulation sim(cc, 1000000);
+
+  sim.Run(40000000);
+  EXPECT_GT(cc.GetTargetBitrate(), 500000);
+  EXPECT_LT(cc.GetTargetBitrate(), 1300000);
+
+  // 稳定后排队延迟保持在较低水平
+  sim.ResetMaximumQueueDelay();
+  sim.Run(60000000);
+  EXPECT_LT(sim.GetMaximumQueueDelay(), 300000);
+  EXPECT_GT(cc.GetAcknowledgedBitrate(), 500000);
+}
+
+TEST(RTPCongestionControllerTest, BacksOffWhenCapacityDrops) {
+  RTPDelayBasedController cc(300000, 30000, 5000000);
+  NetworkSimulation sim(cc, 2000000);
+
+  sim.Run(40000000);
+  EXPECT_GT(cc.GetTargetBitrate(), 1000000);
+
+  sim.SetCapacity(500000);
+  sim.Run(45000000);
+  EXPECT_LT(cc.GetTargetBitrate(), 600000);
+  sim.Run(70000000);
+  EXPECT_GT(cc.GetTargetBitrate(), 250000);
+  EXPECT_LT(cc.GetTargetBitrate(), 700000);
+}
+
+TEST(RTPCongestionControllerTest, REMBAndReceiverReportLossLimitTarget) {
+  RTPDelayBasedController cc(1000000, 50000, 2000000);
+
+  cc.OnREMB(400000, FromMicroSeconds(1000000));
+  EXPECT_DOUBLE_EQ(cc.GetTargetBitrate(), 400000);
+  cc.OnREMB(10000, FromMicroSeconds(1100000));
+  EXPECT_DOUBLE_EQ(cc.GetTargetBitrate(), 50000); // 不低于最小码率
+  cc.OnREMB(3000000, FromMicroSeconds(1200000));
+  EXPECT_DOUBLE_EQ(cc.GetTargetBitrate(), 1000000);
+
+  // 20% 的丢包使码率降低 10%
+  cc.OnReceiverReport(0.2, RTPTime(0.05), FromMicroSeconds(2000000));
+  EXPECT_NEAR(cc.GetTargetBitrate(), 900000, 1);
+  EXPECT_NEAR(cc.GetLossBasedBitrate(), 900000, 1);
+
+  // 没有丢包时基于丢包的码率逐渐恢复
+  for (int i = 1; i <= 10; i++)
+    cc.OnReceiverReport(0.0, RTPTime(0.05), FromMicroSeconds(2000000 + i * 1000000));
+  EXPECT_DOUBLE_EQ(cc.GetTargetBitrate(), 1000000);
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <poll.h>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "utils/media_rtp_endpoint.h"
+#include "test_utils.h"
+
+namespace {
+
+bool IsReadable(int fd, int timeoutms) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  return poll(&pfd, 1, timeoutms) == 1 && (pfd.revents & POLLIN);
+}
+
+int CreateLoopbackSession(RTPSession &session, bool usepollthread) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetAcceptOwnPackets(true);
+  sessparams.SetUsePollThread(usepollthread);
+  sessparams.SetCNAME("ready@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  transparams.SetBindIP(INADDR_LOOPBACK);
+
+  int status = session.Create(sessparams, &transparams);
+  if (status < 0)
+    return status;
+  uint16_t port = GetSessionRTPPort(session);
+  return session.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port));
+}
+
+} // namespace
+
+TEST(RTPDataReadyTest, DescriptorFollowsQueuedPackets) {
+  RTPSession session;
+  ASSERT_EQ(CreateLoopbackSession(session, true), 0);
+
+  int fd = -1;
+  ASSERT_EQ(session.GetDataReadyDescriptor(&fd), 0);
+  ASSERT_GE(fd, 0);
+  EXPECT_FALSE(IsReadable(fd, 0));
+
+  uint8_t payload[20] = {0};
+  for (int i = 0; i < 3; i++)
+    ASSERT_EQ(session.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+
+  // 轮询线程接收数据包后描述符变为可读
+  ASSERT_TRUE(IsReadable(fd, 2000));
+
+  // 只取走一个数据包时，EndDataAccess重新发出信号
+  ASSERT_EQ(session.BeginDataAccess(), 0);
+  EXPECT_FALSE(IsReadable(fd, 0));
+  ASSERT_TRUE(session.GotoFirstSourceWithData());
+  RTPPacket *pack = session.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  session.DeletePacket(pack);
+  ASSERT_EQ(session.EndDataAccess(), 0);
+  EXPECT_TRUE(IsReadable(fd, 0));
+
+  // 取走所有数据包后信号保持清除
+  ASSERT_EQ(session.BeginDataAccess(), 0);
+  while (session.GotoFirstSourceWithData()) {
+    while ((pack = session.GetNextPacket()) != nullptr)
+      session.DeletePacket(pack);
+  }
+  ASSERT_EQ(session.EndDataAccess(), 0);
+  EXPECT_FALSE(IsReadable(fd, 0));
+
+  session.Destroy();
+}
+
+TEST(RTPDataReadyTest, WaitForNextPacketWithoutPollThread) {
+  RTPSession session;
+  ASSERT_EQ(CreateLoopbackSession(session, false), 0);
+
+  // 没有数据时超时返回null
+  RTPTime start = RTPTime::CurrentTime();
+  EXPECT_EQ(session.WaitForNextPacket(RTPTime(0.05)), nullptr);
+  RTPTime elapsed = RTPTime::CurrentTime();
+  elapsed -= start;
+  EXPECT_GE(elapsed.GetDouble(), 0.045);
+
+  uint8_t payload[20] = {0};
+  for (int i = 0; i < 5; i++)
+    ASSERT_EQ(session.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+
+  // 等待期间由会话自己接收数据，数据包按顺序返回
+  RTPPacket *first = session.WaitForNextPacket(RTPTime(2.0));
+  ASSERT_NE(first, nullptr);
+  uint16_t seqnr = first->GetSequenceNumber();
+  session.DeletePacket(first);
+
+  RTPPacket *pack;
+  while ((pack = session.WaitForNextPacket(RTPTime(0.2))) != nullptr) {
+    EXPECT_EQ((uint16_t)(pack->GetSequenceNumber() - seqnr), 1);
+    seqnr = pack->GetSequenceNumber();
+    session.DeletePacket(pack);
+  }
+
+  session.Destroy();
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "core/media_rtp_abort_descriptors.h"
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "core/media_rtp_source_data.h"
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "utils/media_rtp_endpoint.h"
+#include "test_utils.h"
+
+namespace {
+
+// 像外部事件循环那样等待一轮：分发可读的描述符，到达截止时间时调用OnTimer
+int RunOnce(RTPSession &session, int *readable, int *timers) {
+  std::vector<int> fds;
+  RTPTime deadline(0);
+  int status = session.GetEventDescriptors(fds, &deadline);
+  if (status < 0)
+    return status;
+
+  std::vector<struct pollfd> pfds(fds.size());
+  for (size_t i = 0; i < fds.size(); i++) {
+    pfds[i].fd = fds[i];
+    pfds[i].events = POLLIN;
+    pfds[i].revents = 0;
+  }
+
+  RTPTime wait = deadline;
+  wait -= RTPTime::CurrentTime();
+  int timeoutms = (wait.GetDouble() > 0) ? (int)(wait.GetDouble() * 1000.0) + 1 : 0;
+  if (timeoutms > 50)
+    timeoutms = 50;
+
+  int n = poll(pfds.data(), pfds.size(), timeoutms);
+  for (size_t i = 0; n > 0 && i < pfds.size(); i++) {
+    if (pfds[i].revents & POLLIN) {
+      if ((status = session.OnReadable(pfds[i].fd)) < 0)
+        return status;
+      (*readable)++;
+    }
+  }
+
+  RTPTime now = RTPTime::CurrentTime();
+  if (deadline <= now) {
+    if ((status = session.OnTimer(now)) < 0)
+      return status;
+    (*timers)++;
+  }
+  return 0;
+}
+
+} // namespace
+
+TEST(RTPEventLoopTest, DispatchesReadableDescriptorsAndTimers) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetAcceptOwnPackets(true);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetCNAME("loop@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  transparams.SetBindIP(INADDR_LOOPBACK);
+
+  // 共享的中止描述符由其他线程用来唤醒事件循环
+  RTPAbortDescriptors abortdesc;
+  ASSERT_EQ(abortdesc.Init(), 0);
+  transparams.SetCreatedAbortDescriptors(&abortdesc);
+
+  RTPSession session;
+  ASSERT_EQ(session.Create(sessparams, &transparams), 0);
+  uint16_t port = GetSessionRTPPort(session);
+  ASSERT_EQ(session.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+
+  // 复用时只有一个套接字，再加上中止描述符；截止时间不早于当前时间太多
+  std::vector<int> fds;
+  RTPTime before = RTPTime::CurrentTime();
+  RTPTime deadline(0);
+  ASSERT_EQ(session.GetEventDescriptors(fds, &deadline), 0);
+  ASSERT_EQ(fds.size(), 2u);
+  EXPECT_EQ(fds[1], abortdesc.GetAbortSocket());
+  EXPECT_GE(deadline.GetDouble(), before.GetDouble() - 0.001);
+
+  uint8_t payload[20] = {0};
+  for (int i = 0; i < 5; i++)
+    ASSERT_EQ(session.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+
+  int readable = 0, timers = 0;
+  int received = 0;
+  for (int round = 0; round < 100 && received < 5; round++) {
+    ASSERT_EQ(RunOnce(session, &readable, &timers), 0);
+    ASSERT_EQ(session.BeginDataAccess(), 0);
+    if (session.GotoFirstSourceWithData()) {
+      RTPPacket *pack;
+      while ((pack = session.GetNextPacket()) != nullptr) {
+        received++;
+        session.DeletePacket(pack);
+      }
+    }
+    ASSERT_EQ(session.EndDataAccess(), 0);
+  }
+  EXPECT_EQ(received, 5);
+  EXPECT_GT(readable, 0);
+
+  // 中止信号唤醒事件循环，OnReadable清除它
+  ASSERT_EQ(abortdesc.SendAbortSignal(), 0);
+  struct pollfd pfd;
+  pfd.fd = fds[1];
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  ASSERT_EQ(poll(&pfd, 1, 1000), 1);
+  ASSERT_EQ(session.OnReadable(fds[1]), 0);
+  pfd.revents = 0;
+  EXPECT_EQ(poll(&pfd, 1, 0), 0);
+
+  // 不属于会话的描述符被拒绝
+  EXPECT_LT(session.OnReadable(-1), 0);
+
+  // 截止时间到达后调用OnTimer
+  for (int round = 0; round < 200 && timers == 0; round++)
+    ASSERT_EQ(RunOnce(session, &readable, &timers), 0);
+  EXPECT_GT(timers, 0);
+
+  session.Destroy();
+  abortdesc.Destroy();
+}
+
+TEST(RTPEventLoopTest, GapTriggersPromptNACK) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetUseAVPF(true);
+  sessparams.SetGenerateNACKs(true);
+  sessparams.SetProbationType(RTPSources::NoProbation);
+  sessparams.SetCNAME("loop@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  transparams.SetBindIP(INADDR_LOOPBACK);
+
+  RTPSession session;
+  ASSERT_EQ(session.Create(sessparams, &transparams), 0);
+  uint16_t port = GetSessionRTPPort(session);
+
+  // 普通UDP套接字扮演远端发送者，同时接收会话发出的RTCP
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(sock, (struct sockaddr *)&addr, sizeof(addr)), 0);
+  socklen_t addrlen = sizeof(addr);
+  ASSERT_EQ(getsockname(sock, (struct sockaddr *)&addr, &addrlen), 0);
+  uint16_t remoteport = ntohs(addr.sin_port);
+  ASSERT_EQ(session.AddDestination(RTPEndpoint(INADDR_LOOPBACK, remoteport, remoteport)), 0);
+
+  struct sockaddr_in dest = {};
+  dest.sin_family = AF_INET;
+  dest.sin_port = htons(port);
+  dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  int readable = 0, timers = 0;
+  std::vector<uint8_t> payload(20, 0);
+  uint16_t seqnrs[] = {10, 11, 13};
+  for (uint16_t seqnr : seqnrs) {
+    std::vector<uint8_t> pkt = BuildRTPRaw(false, 96, seqnr, seqnr * 3000, 0x1234, {}, false, 0, {}, payload);
+    ASSERT_EQ(sendto(sock, pkt.data(), pkt.size(), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)pkt.size());
+  }
+  bool gap = false;
+  for (int round = 0; round < 20 && !gap; round++) {
+    ASSERT_EQ(RunOnce(session, &readable, &timers), 0);
+    ASSERT_EQ(session.BeginDataAccess(), 0);
+    RTPSourceData *srcdat = session.GetSourceInfo(0x1234);
+    gap = (srcdat != nullptr && srcdat->INF_GetLossTracker().HasMissingPackets());
+    ASSERT_EQ(session.EndDataAccess(), 0);
+  }
+  ASSERT_TRUE(gap);
+
+  // 空洞出现后截止时间立即到达，而不是等到下一个常规RTCP数据包
+  std::vector<int> fds;
+  RTPTime deadline(0);
+  ASSERT_EQ(session.GetEventDescriptors(fds, &deadline), 0);
+  EXPECT_LE(deadline.GetDouble(), RTPTime::CurrentTime().GetDouble() + 0.001);
+
+  bool gotnack = false;
+  RTPTime start = RTPTime::CurrentTime();
+  for (int round = 0; round < 20 && !gotnack; round++) {
+    ASSERT_EQ(RunOnce(session, &readable, &timers), 0);
+    std::vector<uint8_t> buf(2048);
+    ssize_t len;
+    while ((len = recv(sock, buf.data(), buf.size(), MSG_DONTWAIT)) > 0) {
+      if (ContainsNACK(std::vector<uint8_t>(buf.begin(), buf.begin() + len), 12))
+        gotnack = true;
+    }
+  }
+  RTPTime elapsed = RTPTime::CurrentTime();
+  elapsed -= start;
+  EXPECT_TRUE(gotnack);
+  EXPECT_LT(elapsed.GetDouble(), 0.5);
+
+  close(sock);
+  session.Destroy();
+}
+
+TEST(RTPEventLoopTest, RequiresNoPollThread) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(true);
+  sessparams.SetCNAME("loop@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  transparams.SetBindIP(INADDR_LOOPBACK);
+
+  RTPSession session;
+  ASSERT_EQ(session.Create(sessparams, &transparams), 0);
+
+  std::vector<int> fds;
+  RTPTime deadline(0);
+  EXPECT_EQ(session.GetEventDescriptors(fds, &deadline), MEDIA_RTP_ERR_INVALID_STATE);
+  EXPECT_EQ(session.OnTimer(RTPTime::CurrentTime()), MEDIA_RTP_ERR_INVALID_STATE);
+
+  session.Destroy();
+}
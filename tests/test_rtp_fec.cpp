@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "core/media_rtp_session_params.h"
+#include "core/media_rtp_source_data.h"
+#include "packets/media_rtp_fec.h"
+#include "utils/media_rtp_xor.h"
+#include "utils/media_rtp_endpoint.h"
+#include "utils/media_rtp_errors.h"
+#include "test_utils.h"
+
+namespace {
+
+std::vector<uint8_t> MakeMediaPacket(uint16_t seq, size_t payloadlen) {
+  std::vector<uint8_t> payload(payloadlen);
+  for (size_t i = 0; i < payloadlen; i++)
+    payload[i] = (uint8_t)(seq * 7 + i);
+  return BuildRTPRaw(seq % 3 == 0, 96, seq, 1000u + seq * 160u, 0x11223344, {},
+                     seq % 2 == 0, 0xBEDE, {1, 2, 3, 4}, payload);
+}
+
+std::vector<std::vector<uint8_t>> EncodeAll(RTPFECEncoder &enc,
+                                            const std::vector<std::vector<uint8_t>> &media) {
+  std::vector<std::vector<uint8_t>> fec;
+  for (auto &m : media) {
+    int num = enc.AddMediaPacket(m.data(), m.size());
+    for (int i = 0; i < num; i++) {
+      size_t len;
+      const uint8_t *p = enc.GetFECPacket(i, &len);
+      fec.emplace_back(p, p + len);
+    }
+  }
+  return fec;
+}
+
+} // namespace
+
+TEST(RTPFECTest, XORKernelMatchesScalar) {
+  for (size_t len : {0u, 1u, 15u, 16u, 31u, 33u, 64u, 100u, 1400u}) {
+    std::vector<uint8_t> a(len), b(len);
+    for (size_t i = 0; i < len; i++) {
+      a[i] = (uint8_t)(i * 31 + 7);
+      b[i] = (uint8_t)(i * 17 + 3);
+    }
+    std::vector<uint8_t> expect = a;
+    RTPXORBlockScalar(expect.data(), b.data(), len);
+    RTPXORBlock(a.data(), b.data(), len);
+    EXPECT_EQ(a, expect) << "len " << len << " impl " << RTPXORBlockImplementation();
+  }
+}
+
+TEST(RTPFECTest, RowFECRecoversSingleLoss) {
+  RTPFECEncoder enc;
+  EXPECT_EQ(enc.Init(1400, 1, 1, 100, 0x55667788), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  ASSERT_EQ(enc.Init(1400, 4, 0, 100, 0x55667788), 0);
+
+  std::vector<std::vector<uint8_t>> media;
+  for (uint16_t seq = 65534, i = 0; i < 4; ++seq, ++i)
+    media.push_back(MakeMediaPacket(seq, 50 + i * 30));
+  auto fec = EncodeAll(enc, media);
+  ASSERT_EQ(fec.size(), 1u);
+  EXPECT_EQ(fec[0][1] & 127, 100);
+
+  RTPFECDecoder dec;
+  ASSERT_EQ(dec.Init(1400, 100), 0);
+  EXPECT_TRUE(dec.IsFECPacket(fec[0].data(), fec[0].size()));
+  EXPECT_FALSE(dec.IsFECPacket(media[0].data(), media[0].size()));
+
+  for (size_t i = 0; i < media.size(); i++) {
+    if (i != 2) {
+      ASSERT_EQ(dec.AddMediaPacket(media[i].data(), media[i].size()), 0);
+    }
+  }
+  ASSERT_EQ(dec.AddFECPacket(fec[0].data(), fec[0].size()), 0);
+
+  const uint8_t *p;
+  size_t len;
+  ASSERT_TRUE(dec.GetNextRecoveredPacket(&p, &len));
+  EXPECT_EQ(std::vector<uint8_t>(p, p + len), media[2]);
+  EXPECT_FALSE(dec.GetNextRecoveredPacket(&p, &len));
+  EXPECT_EQ(dec.GetNumRecovered(), 1u);
+}
+
+TEST(RTPFECTest, RowAndColumnFECRecoverBurstIteratively) {
+  RTPFECEncoder enc;
+  ASSERT_EQ(enc.Init(1400, 3, 3, 100, 0x55667788), 0);
+
+  std::vector<std::vector<uint8_t>> media;
+  for (uint16_t seq = 10; seq < 19; ++seq)
+    media.push_back(MakeMediaPacket(seq, 20 + seq));
+  auto fec = EncodeAll(enc, media);
+  ASSERT_EQ(fec.size(), 6u); // 3 行 + 3 列
+
+  // 丢失第一整行以及第二行的中间一个包；第二行先恢复，随后三列都能恢复
+  RTPFECDecoder dec;
+  ASSERT_EQ(dec.Init(1400, 100), 0);
+  for (size_t i = 0; i < media.size(); i++)
+    if (i > 2 && i != 4)
+      dec.AddMediaPacket(media[i].data(), media[i].size());
+  for (auto &f : fec)
+    dec.AddFECPacket(f.data(), f.size());
+
+  EXPECT_EQ(dec.GetNumRecovered(), 4u);
+  std::vector<std::vector<uint8_t>> recovered;
+  const uint8_t *p;
+  size_t len;
+  while (dec.GetNextRecoveredPacket(&p, &len))
+    recovered.emplace_back(p, p + len);
+  ASSERT_EQ(recovered.size(), 4u);
+  for (size_t idx : {0u, 1u, 2u, 4u})
+    EXPECT_NE(std::find(recovered.begin(), recovered.end(), media[idx]), recovered.end()) << idx;
+}
+
+TEST(RTPFECTest, EncoderRestartsGroupOnDiscontinuity) {
+  RTPFECEncoder enc;
+  ASSERT_EQ(enc.Init(1400, 2, 0, 100, 1), 0);
+
+  auto a = MakeMediaPacket(1, 10);
+  auto b = MakeMediaPacket(5, 10);
+  auto c = MakeMediaPacket(6, 10);
+  EXPECT_EQ(enc.AddMediaPacket(a.data(), a.size()), 0);
+  EXPECT_EQ(enc.AddMediaPacket(b.data(), b.size()), 0); // 序列号跳变，重新分组
+  ASSERT_EQ(enc.AddMediaPacket(c.data(), c.size()), 1);
+
+  size_t len;
+  const uint8_t *f = enc.GetFECPacket(0, &len);
+  ASSERT_NE(f, nullptr);
+  EXPECT_EQ((f[24] << 8) | f[25], 5); // 基序列号
+  EXPECT_EQ(f[26], 2);
+  EXPECT_EQ(enc.GetFECPacket(1, &len), nullptr);
+}
+
+TEST(RTPFECTest, EncoderAcceptsSeparatePayload) {
+  RTPFECEncoder whole, split;
+  ASSERT_EQ(whole.Init(1400, 2, 0, 100, 1), 0);
+  ASSERT_EQ(split.Init(1400, 2, 0, 100, 1), 0);
+
+  // 转发的数据包头部和负载分开存放，结果与连续的数据包相同
+  auto a = MakeMediaPacket(1, 40);
+  auto b = MakeMediaPacket(2, 25);
+  EXPECT_EQ(whole.AddMediaPacket(a.data(), a.size()), 0);
+  EXPECT_EQ(split.AddMediaPacket(a.data(), 12, a.data() + 12, a.size() - 12), 0);
+  ASSERT_EQ(whole.AddMediaPacket(b.data(), b.size()), 1);
+  ASSERT_EQ(split.AddMediaPacket(b.data(), 12, b.data() + 12, b.size() - 12), 1);
+
+  size_t wholelen, splitlen;
+  const uint8_t *f1 = whole.GetFECPacket(0, &wholelen);
+  const uint8_t *f2 = split.GetFECPacket(0, &splitlen);
+  ASSERT_EQ(wholelen, splitlen);
+  EXPECT_EQ(memcmp(f1, f2, 2), 0);
+  EXPECT_EQ(memcmp(f1 + 4, f2 + 4, wholelen - 4), 0); // 每个编码器的FEC序列号是随机的
+}
+
+TEST(RTPFECTest, SessionAnnouncesFECSSRC) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetUseAVPF(true);
+  sessparams.SetProbationType(RTPSources::NoProbation);
+  sessparams.SetCNAME("fec@localhost");
+  sessparams.SetUseFEC(true);
+  sessparams.SetFECColumns(2);
+  sessparams.SetFECPayloadType(100);
+
+  RTPSessionParams receiverparams;
+  receiverparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  receiverparams.SetUsePollThread(false);
+  receiverparams.SetUseAVPF(true);
+  receiverparams.SetProbationType(RTPSources::NoProbation);
+  receiverparams.SetCNAME("receiver@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetBindIP(INADDR_LOOPBACK);
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+
+  RTPSession sender, receiver;
+  ASSERT_EQ(sender.Create(sessparams, &transparams), 0);
+  ASSERT_EQ(receiver.Create(receiverparams, &transparams), 0);
+  uint16_t senderport = GetSessionRTPPort(sender);
+  uint16_t receiverport = GetSessionRTPPort(receiver);
+  ASSERT_EQ(sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, receiverport, receiverport)), 0);
+  ASSERT_EQ(receiver.AddDestination(RTPEndpoint(INADDR_LOOPBACK, senderport, senderport)), 0);
+
+  // FEC SSRC作为自己的SSRC加入源表，用于冲突检测
+  uint32_t fecssrc = sender.GetFECSSRC();
+  EXPECT_NE(fecssrc, sender.GetLocalSSRC());
+  RTPSourceData *fecdat = sender.GetSourceInfo(fecssrc);
+  ASSERT_NE(fecdat, nullptr);
+  EXPECT_TRUE(fecdat->IsOwnSSRC());
+
+  std::vector<uint8_t> payload(40, 1);
+  for (int i = 0; i < 4; i++)
+    ASSERT_EQ(sender.SendPacket(payload.data(), payload.size(), 96, false, 3000), 0);
+
+  // FEC SSRC和媒体流使用相同的CNAME通告；提前的RTCP最多等待一个常规间隔
+  ASSERT_EQ(sender.SendPLI(receiver.GetLocalSSRC()), 0);
+  std::string cname;
+  for (int round = 0; round < 1000 && cname.empty(); round++) {
+    RTPTime::Wait(RTPTime(0.005));
+    ASSERT_EQ(sender.Poll(), 0);
+    ASSERT_EQ(receiver.Poll(), 0);
+    ASSERT_EQ(receiver.BeginDataAccess(), 0);
+    RTPSourceData *srcdat = receiver.GetSourceInfo(fecssrc);
+    if (srcdat != nullptr) {
+      size_t len;
+      uint8_t *data = srcdat->SDES_GetCNAME(&len);
+      cname.assign((const char *)data, len);
+    }
+    ASSERT_EQ(receiver.EndDataAccess(), 0);
+  }
+  EXPECT_EQ(cname, "fec@localhost");
+
+  sender.Destroy();
+  receiver.Destroy();
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "packets/media_rtp_packet_buffer.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_defines.h"
+#include "test_utils.h"
+
+namespace {
+
+// 接收转发出的数据包的普通UDP套接字
+class ReceiveSocket {
+public:
+  ReceiveSocket() {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sock, (struct sockaddr *)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(sock, (struct sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+
+    struct timeval tv = {1, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  }
+  ~ReceiveSocket() { close(sock); }
+
+  std::vector<uint8_t> Receive() {
+    std::vector<uint8_t> buf(2048);
+    ssize_t len = recv(sock, buf.data(), buf.size(), 0);
+    buf.resize(len > 0 ? len : 0);
+    return buf;
+  }
+
+  int sock;
+  uint16_t port;
+};
+
+// 创建只发送到 \c dest 的出口会话
+void CreateEgress(RTPSession &session, RTPSessionParams &sessparams, ReceiveSocket &dest) {
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetBindIP(INADDR_LOOPBACK);
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  ASSERT_EQ(session.Create(sessparams, &transparams), 0);
+  ASSERT_EQ(session.AddDestination(RTPEndpoint(INADDR_LOOPBACK, dest.port, dest.port)), 0);
+}
+
+RTPSessionParams GetSessionParams() {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetCNAME("forward@localhost");
+  return sessparams;
+}
+
+} // namespace
+
+TEST(RTPForwardingTest, EgressSessionsRewriteHeaders) {
+  RTPSessionParams sessparams = GetSessionParams();
+  ReceiveSocket dest[2];
+  RTPSession egress[2];
+  CreateEgress(egress[0], sessparams, dest[0]);
+  sessparams.SetRetransmissionCacheSize(16); // 缓存只保存头部和对负载的引用
+  CreateEgress(egress[1], sessparams, dest[1]);
+  RTPSession *sessions[2] = {&egress[0], &egress[1]};
+
+  std::vector<uint8_t> payload(200);
+  for (size_t i = 0; i < payload.size(); i++)
+    payload[i] = (uint8_t)i;
+
+  const uint16_t inseqs[3] = {1000, 1001, 1003};
+  std::vector<RTPPacket *> packets;
+  for (int i = 0; i < 3; i++) {
+    packets.push_back(ParsePacket(BuildRTPRaw(i == 2, 96, inseqs[i], 90000 + 3000 * i, 0xABCD, {0x1234}, false, 0, {}, payload)));
+    ASSERT_EQ(RTPSession::ForwardPacket(*packets.back(), sessions, 2), 0);
+  }
+
+  for (int s = 0; s < 2; s++) {
+    uint16_t firstseq = 0;
+    uint32_t firstts = 0;
+    for (int i = 0; i < 3; i++) {
+      std::vector<uint8_t> bytes = dest[s].Receive();
+      ASSERT_EQ(bytes.size(), 16 + payload.size());
+      RTPPacket *pack = ParsePacket(bytes);
+      ASSERT_EQ(pack->GetCreationError(), 0);
+      EXPECT_EQ(pack->GetSSRC(), egress[s].GetLocalSSRC());
+      EXPECT_EQ(pack->GetCSRCCount(), 1);
+      EXPECT_EQ(pack->GetCSRC(0), 0x1234u);
+      EXPECT_EQ(pack->HasMarker(), i == 2);
+      EXPECT_EQ(memcmp(pack->GetPayloadData(), payload.data(), payload.size()), 0);
+      if (i == 0) {
+        firstseq = pack->GetSequenceNumber();
+        firstts = pack->GetTimestamp();
+      }
+
+      // 入口的丢包在出口仍然可见
+      EXPECT_EQ((uint16_t)(pack->GetSequenceNumber() - firstseq), (uint16_t)(inseqs[i] - inseqs[0]));
+      EXPECT_EQ(pack->GetTimestamp() - firstts, 3000u * i);
+      delete pack;
+    }
+  }
+
+  for (RTPPacket *pack : packets)
+    delete pack;
+  egress[0].Destroy();
+  egress[1].Destroy();
+}
+
+TEST(RTPForwardingTest, TransportSequenceNumberIsRewritten) {
+  RTPSessionParams sessparams = GetSessionParams();
+  sessparams.SetUseTransportCC(true);
+  sessparams.SetTransportCCExtensionID(3);
+
+  ReceiveSocket dest;
+  RTPSession egress;
+  CreateEgress(egress, sessparams, dest);
+
+  // 入口数据包带有上一跳的传输层序列号
+  std::vector<uint8_t> ext = {(3 << 4) | 1, 0xFF, 0xFF, 0};
+  std::vector<uint8_t> payload(20, 0x77);
+  uint16_t prev = 0;
+  for (int i = 0; i < 2; i++) {
+    RTPPacket *in = ParsePacket(BuildRTPRaw(false, 96, 10 + i, 0, 0x55, {}, true, RTP_ONEBYTEHEADEREXTENSION_ID, ext, payload));
+    ASSERT_EQ(egress.ForwardPacket(*in), 0);
+    delete in;
+
+    RTPPacket *out = ParsePacket(dest.Receive());
+    ASSERT_EQ(out->GetCreationError(), 0);
+    const uint8_t *data;
+    size_t len;
+    ASSERT_TRUE(out->GetOneByteExtensionElement(3, &data, &len));
+    ASSERT_EQ(len, 2u);
+    uint16_t seq = (uint16_t)((data[0] << 8) | data[1]);
+    if (i > 0) {
+      EXPECT_EQ(seq, (uint16_t)(prev + 1));
+    }
+    prev = seq;
+    EXPECT_EQ(out->GetPayloadLength(), payload.size());
+    delete out;
+  }
+  egress.Destroy();
+}
+
+TEST(RTPForwardingTest, RetransmissionCacheReferencesIngressBuffer) {
+  RTPSessionParams sessparams = GetSessionParams();
+  sessparams.SetRetransmissionCacheSize(16);
+  sessparams.SetUseRTX(true);
+
+  ReceiveSocket dest;
+  RTPSession egress;
+  CreateEgress(egress, sessparams, dest);
+
+  RTPPacketBufferPool *pool = RTPPacketBufferPool::Create(2048);
+  std::vector<uint8_t> payload(300, 0x5A);
+  std::vector<uint8_t> bytes = BuildRTPRaw(true, 96, 500, 1000, 0x99, {}, false, 0, {}, payload);
+  RTPPacketBuffer *buf = pool->Allocate(bytes.size());
+  RTPPacket *in = ParsePacket(bytes, buf);
+  ASSERT_EQ(egress.ForwardPacket(*in), 0);
+
+  // 缓存为入口缓冲区持有一个引用，删除入口数据包后缓冲区仍未回到池中
+  EXPECT_EQ(buf->GetReferenceCount(), 2u);
+  delete in;
+  EXPECT_EQ(buf->GetReferenceCount(), 1u);
+  EXPECT_EQ(pool->GetFreeBuffers(), 0u);
+
+  std::vector<uint8_t> sent = dest.Receive();
+  ASSERT_EQ(sent.size(), bytes.size());
+  RTPPacket *out = ParsePacket(sent);
+  uint16_t seqnr = out->GetSequenceNumber();
+  delete out;
+
+  // 按原样重传和封装为RTX都由头部和引用的负载组成
+  ASSERT_EQ(egress.RetransmitPacket(seqnr, false), 0);
+  EXPECT_EQ(dest.Receive(), sent);
+  ASSERT_EQ(egress.RetransmitPacket(seqnr, true), 0);
+  RTPPacket *rtx = ParsePacket(dest.Receive());
+  ASSERT_EQ(rtx->GetCreationError(), 0);
+  EXPECT_EQ(rtx->GetSSRC(), egress.GetRTXSSRC());
+  ASSERT_EQ(rtx->GetPayloadLength(), 2 + payload.size());
+  EXPECT_EQ((rtx->GetPayloadData()[0] << 8) | rtx->GetPayloadData()[1], seqnr);
+  EXPECT_EQ(memcmp(rtx->GetPayloadData() + 2, payload.data(), payload.size()), 0);
+  delete rtx;
+
+  // 销毁会话时缓存释放引用
+  egress.Destroy();
+  EXPECT_EQ(pool->GetFreeBuffers(), 1u);
+  pool->Release();
+}
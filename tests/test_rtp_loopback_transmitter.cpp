@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+
+#include <poll.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_loopback_transmitter.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_endpoint.h"
+#include "utils/media_rtp_errors.h"
+
+namespace {
+
+int CreateLoopbackTransmitter(RTPLoopbackTransmitter &trans, RTPLoopbackNetwork &network,
+                              const RTPLoopbackImpairments &impairments = RTPLoopbackImpairments()) {
+  RTPLoopbackTransmissionParams params;
+  params.SetNetwork(&network);
+  params.SetImpairments(impairments);
+
+  int status = trans.Init(false);
+  if (status < 0)
+    return status;
+  return trans.Create(1400, &params);
+}
+
+uint16_t GetRTPPort(RTPTransmitter &trans) {
+  RTPTransmissionInfo *inf = trans.GetTransmissionInfo();
+  uint16_t port = static_cast<RTPLoopbackTransmissionInfo *>(inf)->GetRTPPort();
+  trans.DeleteTransmissionInfo(inf);
+  return port;
+}
+
+// 发送 \c count 个序号递增的RTP数据包，等待所有数据包到达后返回收到的序号
+std::vector<int> SendAndReceive(const RTPLoopbackImpairments &impairments, int count) {
+  RTPLoopbackNetwork network;
+  RTPLoopbackTransmitter sender, receiver;
+  EXPECT_EQ(CreateLoopbackTransmitter(sender, network, impairments), 0);
+  EXPECT_EQ(CreateLoopbackTransmitter(receiver, network), 0);
+  EXPECT_EQ(sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, GetRTPPort(receiver))), 0);
+
+  for (int seq = 0; seq < count; seq++) {
+    uint8_t data[12] = {0x80, 96, (uint8_t)(seq >> 8), (uint8_t)seq, 0, 0, 0, 0, 0, 0, 0, 1};
+    EXPECT_EQ(sender.SendRTPData(data, sizeof(data)), 0);
+  }
+
+  RTPTime wait = impairments.GetDelay();
+  wait += impairments.GetJitter();
+  wait += impairments.GetReorderDelay();
+  wait += RTPTime(0.01);
+  RTPTime::Wait(wait);
+  EXPECT_EQ(receiver.Poll(), 0);
+
+  std::vector<int> received;
+  RTPRawPacket *pack;
+  while ((pack = receiver.GetNextPacket()) != nullptr) {
+    EXPECT_TRUE(pack->IsRTP());
+    received.push_back((pack->GetData()[2] << 8) | pack->GetData()[3]);
+    delete pack;
+  }
+  return received;
+}
+
+} // namespace
+
+TEST(RTPLoopbackTransmitterTest, SessionsExchangePackets) {
+  RTPLoopbackNetwork network;
+  RTPSession a, b;
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+
+  RTPLoopbackTransmissionParams transparams;
+  transparams.SetNetwork(&network);
+  transparams.SetRTCPMultiplexing(true);
+
+  sessparams.SetCNAME("a@loopback");
+  transparams.SetPortbase(5000);
+  ASSERT_EQ(a.Create(sessparams, &transparams, RTPTransmitter::LoopbackProto), 0);
+  sessparams.SetCNAME("b@loopback");
+  transparams.SetPortbase(6000);
+  ASSERT_EQ(b.Create(sessparams, &transparams, RTPTransmitter::LoopbackProto), 0);
+
+  // 端口已被使用时和绑定失败一样
+  RTPSession c;
+  EXPECT_LT(c.Create(sessparams, &transparams, RTPTransmitter::LoopbackProto), 0);
+
+  ASSERT_EQ(a.AddDestination(RTPEndpoint(INADDR_LOOPBACK, 6000, 6000)), 0);
+  uint8_t payload[100] = {0};
+  for (int i = 0; i < 10; i++)
+    ASSERT_EQ(a.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+
+  RTPPacket *first = b.WaitForNextPacket(RTPTime(1.0));
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first->GetPayloadLength(), sizeof(payload));
+  uint16_t seqnr = first->GetSequenceNumber();
+  b.DeletePacket(first);
+
+  int count = 1;
+  RTPPacket *pack;
+  while ((pack = b.WaitForNextPacket(RTPTime(0.05))) != nullptr) {
+    EXPECT_EQ((uint16_t)(pack->GetSequenceNumber() - seqnr), 1);
+    seqnr = pack->GetSequenceNumber();
+    b.DeletePacket(pack);
+    count++;
+  }
+  EXPECT_GE(count, 9); // 新的源在验证期间可能保留第一个数据包
+  EXPECT_EQ(network.GetUndeliverablePackets(), 0u);
+
+  a.BYEDestroy(RTPTime(0.1), 0, 0);
+  b.Destroy();
+}
+
+TEST(RTPLoopbackTransmitterTest, DelayHoldsPacketsUntilArrival) {
+  RTPLoopbackImpairments impairments;
+  impairments.SetDelay(RTPTime(0.05));
+
+  RTPLoopbackNetwork network;
+  RTPLoopbackTransmitter sender, receiver;
+  ASSERT_EQ(CreateLoopbackTransmitter(sender, network, impairments), 0);
+  ASSERT_EQ(CreateLoopbackTransmitter(receiver, network), 0);
+  ASSERT_EQ(sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, GetRTPPort(receiver))), 0);
+
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  RTPTime sendtime = RTPTime::CurrentTime();
+  ASSERT_EQ(sender.SendRTPData(data, sizeof(data)), 0);
+
+  ASSERT_EQ(receiver.Poll(), 0);
+  EXPECT_EQ(receiver.GetNextPacket(), nullptr);
+
+  // 等待在数据包到达时结束，而不是等满整个超时时间
+  bool available = false;
+  ASSERT_EQ(receiver.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  EXPECT_TRUE(available);
+  RTPTime elapsed = RTPTime::CurrentTime();
+  elapsed -= sendtime;
+  EXPECT_GE(elapsed.GetDouble(), 0.045);
+  EXPECT_LT(elapsed.GetDouble(), 0.5);
+
+  ASSERT_EQ(receiver.Poll(), 0);
+  RTPRawPacket *pack = receiver.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_NEAR(pack->GetReceiveTime().GetDouble() - sendtime.GetDouble(), 0.05, 0.01);
+  EXPECT_EQ(pack->GetSenderAddress()->GetRtpPort(), GetRTPPort(sender));
+  delete pack;
+}
+
+TEST(RTPLoopbackTransmitterTest, DelayedPacketsWakeEventLoop) {
+  RTPLoopbackImpairments impairments;
+  impairments.SetDelay(RTPTime(0.05));
+
+  RTPLoopbackNetwork network;
+  RTPLoopbackTransmitter sender, receiver;
+  ASSERT_EQ(CreateLoopbackTransmitter(sender, network, impairments), 0);
+  ASSERT_EQ(CreateLoopbackTransmitter(receiver, network), 0);
+  ASSERT_EQ(sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, GetRTPPort(receiver))), 0);
+
+  std::vector<int> fds;
+  ASSERT_EQ(receiver.GetReceiveDescriptors(fds), 0);
+  std::vector<struct pollfd> pfds(fds.size());
+  for (size_t i = 0; i < fds.size(); i++) {
+    pfds[i].fd = fds[i];
+    pfds[i].events = POLLIN;
+  }
+
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  RTPTime sendtime = RTPTime::CurrentTime();
+  ASSERT_EQ(sender.SendRTPData(data, sizeof(data)), 0);
+
+  // 像外部事件循环那样只在描述符可读时处理，不依赖超时
+  RTPRawPacket *pack = nullptr;
+  for (int round = 0; round < 10 && pack == nullptr; round++) {
+    for (size_t i = 0; i < pfds.size(); i++)
+      pfds[i].revents = 0;
+    if (poll(pfds.data(), pfds.size(), 1000) <= 0)
+      break;
+    for (size_t i = 0; i < pfds.size(); i++) {
+      if (pfds[i].revents & POLLIN) {
+        ASSERT_EQ(receiver.PollDescriptor(pfds[i].fd), 0);
+      }
+    }
+    pack = receiver.GetNextPacket();
+  }
+  ASSERT_NE(pack, nullptr);
+  RTPTime elapsed = RTPTime::CurrentTime();
+  elapsed -= sendtime;
+  EXPECT_GE(elapsed.GetDouble(), 0.045);
+  EXPECT_LT(elapsed.GetDouble(), 0.5);
+  delete pack;
+
+  // 所有数据包都已到达，描述符不再可读
+  for (size_t i = 0; i < pfds.size(); i++)
+    pfds[i].revents = 0;
+  EXPECT_EQ(poll(pfds.data(), pfds.size(), 0), 0);
+}
+
+TEST(RTPLoopbackTransmitterTest, ImpairmentsAreReproducible) {
+  RTPLoopbackImpairments impairments;
+  impairments.SetJitter(RTPTime(0.005));
+  impairments.SetLossRate(0.1);
+  impairments.SetDuplicateRate(0.05);
+  impairments.SetReorderRate(0.05);
+  impairments.SetReorderDelay(RTPTime(0.01));
+  impairments.SetSeed(1234);
+
+  const int count = 500;
+  std::vector<int> first = SendAndReceive(impairments, count);
+  std::vector<int> second = SendAndReceive(impairments, count);
+
+  // 同样的种子得到同样的丢失和复制；到达顺序还取决于发送时刻，只比较收到的集合
+  std::vector<int> sortedfirst = first, sortedsecond = second;
+  std::sort(sortedfirst.begin(), sortedfirst.end());
+  std::sort(sortedsecond.begin(), sortedsecond.end());
+  EXPECT_EQ(sortedfirst, sortedsecond);
+
+  int duplicates = 0, reordered = 0;
+  for (size_t i = 1; i < sortedfirst.size(); i++)
+    if (sortedfirst[i] == sortedfirst[i - 1])
+      duplicates++;
+  for (size_t i = 1; i < first.size(); i++)
+    if (first[i] < first[i - 1])
+      reordered++;
+  EXPECT_GT(duplicates, 0);
+  EXPECT_GT(reordered, 0);
+  EXPECT_LT((int)sortedfirst.size() - duplicates, count);
+  EXPECT_GT((int)sortedfirst.size() - duplicates, count * 8 / 10);
+
+  impairments.SetSeed(4321);
+  std::vector<int> other = SendAndReceive(impairments, count);
+  std::sort(other.begin(), other.end());
+  EXPECT_NE(other, sortedfirst);
+}
+
+TEST(RTPLoopbackTransmitterTest, UndeliverablePacketsAreCounted) {
+  RTPLoopbackNetwork network;
+  RTPLoopbackTransmitter sender, receiver;
+  ASSERT_EQ(CreateLoopbackTransmitter(sender, network), 0);
+  ASSERT_EQ(CreateLoopbackTransmitter(receiver, network), 0);
+  uint16_t port = GetRTPPort(receiver);
+  ASSERT_EQ(sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port)), 0);
+  EXPECT_EQ(sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port)), MEDIA_RTP_ERR_INVALID_STATE);
+
+  // RTCP发往下一个端口
+  uint8_t rr[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+  ASSERT_EQ(sender.SendRTCPData(rr, sizeof(rr)), 0);
+  ASSERT_EQ(receiver.Poll(), 0);
+  RTPRawPacket *pack = receiver.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_FALSE(pack->IsRTP());
+  EXPECT_EQ(pack->GetSenderAddress()->GetRtpPort(), GetRTPPort(sender) + 1);
+  delete pack;
+
+  // 接收端销毁后数据包被丢弃并计数，同一地址上新的传输器重新可以接收
+  receiver.Destroy();
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  ASSERT_EQ(sender.SendRTPData(data, sizeof(data)), 0);
+  EXPECT_EQ(network.GetUndeliverablePackets(), 1u);
+
+  RTPLoopbackTransmissionParams params;
+  params.SetNetwork(&network);
+  params.SetPortbase(port);
+  ASSERT_EQ(receiver.Create(1400, &params), 0);
+  ASSERT_EQ(sender.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(receiver.Poll(), 0);
+  pack = receiver.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  delete pack;
+  EXPECT_EQ(network.GetUndeliverablePackets(), 1u);
+}
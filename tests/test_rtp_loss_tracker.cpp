@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "core/media_rtp_loss_tracker.h"
+
+TEST(RTPLossTrackerTest, DetectsHolesAndCountsRecovery) {
+  RTPLossTracker tracker;
+  tracker.ProcessPacket(100);
+  tracker.ProcessPacket(101);
+  EXPECT_FALSE(tracker.HasMissingPackets());
+
+  tracker.ProcessPacket(105); // 102..104 丢失
+  EXPECT_TRUE(tracker.HasMissingPackets());
+  EXPECT_EQ(tracker.GetNumLost(), 3u);
+
+  tracker.ProcessPacket(103); // 迟到的包
+  tracker.ProcessPacket(103); // 重复的包被忽略
+  EXPECT_EQ(tracker.GetNumRecovered(), 1u);
+
+  uint16_t seqnrs[16];
+  int num = tracker.GetNACKList(RTPTime(1.0), RTPTime(0.1), 3, seqnrs, 16);
+  ASSERT_EQ(num, 2);
+  EXPECT_EQ(seqnrs[0], 102);
+  EXPECT_EQ(seqnrs[1], 104);
+  EXPECT_EQ(tracker.GetNumNACKRequests(), 2u);
+
+  // 过旧的包不会影响计数
+  tracker.ProcessPacket(105 - RTP_LOSSTRACKER_WINDOWSIZE);
+  EXPECT_EQ(tracker.GetNumRecovered(), 1u);
+}
+
+TEST(RTPLossTrackerTest, RetriesAreSpacedByRTTAndLimited) {
+  RTPLossTracker tracker;
+  tracker.ProcessPacket(0xFFFE);
+  tracker.ProcessPacket(0x10001); // 跨越 16 位回绕，0xFFFF 和 0x10000 丢失
+
+  // 还没有请求过的数据包可以立即请求
+  RTPTime next;
+  ASSERT_TRUE(tracker.GetNextNACKTime(RTPTime(0.2), 2, &next));
+  EXPECT_TRUE(next.IsZero());
+
+  uint16_t seqnrs[16];
+  ASSERT_EQ(tracker.GetNACKList(RTPTime(1.0), RTPTime(0.2), 2, seqnrs, 16), 2);
+  EXPECT_EQ(seqnrs[0], 0xFFFF);
+  EXPECT_EQ(seqnrs[1], 0x0000);
+  ASSERT_TRUE(tracker.GetNextNACKTime(RTPTime(0.2), 2, &next));
+  EXPECT_DOUBLE_EQ(next.GetDouble(), 1.2);
+
+  EXPECT_EQ(tracker.GetNACKList(RTPTime(1.1), RTPTime(0.2), 2, seqnrs, 16), 0);
+  EXPECT_EQ(tracker.GetNACKList(RTPTime(1.3), RTPTime(0.2), 2, seqnrs, 1), 1);
+  EXPECT_EQ(seqnrs[0], 0xFFFF);
+  EXPECT_EQ(tracker.GetNACKList(RTPTime(1.35), RTPTime(0.2), 2, seqnrs, 16), 1);
+  EXPECT_EQ(seqnrs[0], 0x0000);
+
+  // 达到重试上限后不再请求
+  EXPECT_EQ(tracker.GetNACKList(RTPTime(5.0), RTPTime(0.2), 2, seqnrs, 16), 0);
+  EXPECT_FALSE(tracker.GetNextNACKTime(RTPTime(0.2), 2, &next));
+  EXPECT_TRUE(tracker.HasMissingPackets());
+}
+
+TEST(RTPLossTrackerTest, HolesLeavingWindowAreUnrecovered) {
+  RTPLossTracker tracker;
+  tracker.ProcessPacket(1000);
+  tracker.ProcessPacket(1002);
+  tracker.ProcessPacket(1001 + RTP_LOSSTRACKER_WINDOWSIZE);
+  EXPECT_EQ(tracker.GetNumLost(), 1u + (RTP_LOSSTRACKER_WINDOWSIZE - 2));
+  EXPECT_EQ(tracker.GetNumUnrecovered(), 1u);
+
+  // 大跳变：跳过的包和窗口中剩余的空洞都计为未恢复
+  RTPLossTracker jump;
+  jump.ProcessPacket(10);
+  jump.ProcessPacket(12);
+  jump.ProcessPacket(12 + 3 * RTP_LOSSTRACKER_WINDOWSIZE);
+  EXPECT_EQ(jump.GetNumLost(), 1u + 3 * RTP_LOSSTRACKER_WINDOWSIZE - 1);
+  EXPECT_EQ(jump.GetNumUnrecovered(), 1u + 2 * RTP_LOSSTRACKER_WINDOWSIZE);
+
+  uint16_t seqnrs[RTP_LOSSTRACKER_WINDOWSIZE];
+  EXPECT_EQ(jump.GetNACKList(RTPTime(0.0), RTPTime(0.1), 1, seqnrs, RTP_LOSSTRACKER_WINDOWSIZE),
+            RTP_LOSSTRACKER_WINDOWSIZE - 1);
+}
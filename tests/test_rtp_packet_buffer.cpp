@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "packets/media_rtp_packet_buffer.h"
+#include "transmitters/media_rtp_io_uring.h"
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "utils/media_rtp_errors.h"
+#include "test_utils.h"
+
+namespace {
+
+std::vector<uint8_t> MakePacket() {
+  return BuildRTPRaw(true, 96, 7, 1000, 0x1234, {}, true, 0x10, {1, 2, 3, 4}, std::vector<uint8_t>(100, 0x3C));
+}
+
+// 向 \c addr 发送一个数据包，等待传输器收到它并返回，超时返回null
+RTPRawPacket *SendAndReceive(RTPTransmitter &trans, const struct sockaddr *addr, socklen_t addrlen) {
+  std::vector<uint8_t> bytes = MakePacket();
+  int sock = socket(addr->sa_family, SOCK_DGRAM, 0);
+  EXPECT_EQ(sendto(sock, bytes.data(), bytes.size(), 0, addr, addrlen), (ssize_t)bytes.size());
+  close(sock);
+
+  for (int attempt = 0; attempt < 100; attempt++) {
+    EXPECT_EQ(trans.WaitForIncomingData(RTPTime(0.01)), 0);
+    EXPECT_EQ(trans.Poll(), 0);
+    RTPRawPacket *raw = trans.GetNextPacket();
+    if (raw != nullptr)
+      return raw;
+  }
+  return nullptr;
+}
+
+// 在回环地址上创建UDPv4传输器并接收一个数据包，检查数据存放在引用计数缓冲区中
+void ExpectUDPv4ReceivesIntoBuffer(RTPUDPv4TransmissionParams &params) {
+  // 重用端口组只能在固定端口上创建，先找一个空闲端口
+  struct sockaddr_in addr = {};
+  socklen_t addrlen = sizeof(addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int probe = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_EQ(bind(probe, (struct sockaddr *)&addr, sizeof(addr)), 0);
+  ASSERT_EQ(getsockname(probe, (struct sockaddr *)&addr, &addrlen), 0);
+  close(probe);
+
+  params.SetBindIP(INADDR_LOOPBACK);
+  params.SetPortbase(ntohs(addr.sin_port));
+  params.SetAllowOddPortbase(true);
+  params.SetRTCPMultiplexing(true);
+
+  RTPUDPv4Transmitter trans;
+  ASSERT_EQ(trans.Init(false), 0);
+  ASSERT_EQ(trans.Create(1400, &params), 0);
+
+  RTPRawPacket *raw = SendAndReceive(trans, (struct sockaddr *)&addr, sizeof(addr));
+  ASSERT_NE(raw, nullptr);
+  EXPECT_NE(dynamic_cast<RTPPacketBuffer *>(raw->GetDataReleaser()), nullptr);
+
+  // 数据包可以比传输器存在得更久，池在缓冲区释放之后才被删除
+  trans.Destroy();
+  RTPPacketRef pack(new RTPPacket(*raw));
+  delete raw;
+  RTPPacketRef shared = pack.Share();
+  ASSERT_TRUE(shared);
+  EXPECT_EQ(shared->GetPacketData(), pack->GetPacketData());
+}
+
+} // namespace
+
+TEST(RTPPacketBufferTest, PoolRecyclesBuffers) {
+  RTPPacketBufferPool *pool = RTPPacketBufferPool::Create(256, 2);
+  ASSERT_NE(pool, nullptr);
+
+  RTPPacketBuffer *a = pool->Allocate(100);
+  RTPPacketBuffer *b = pool->Allocate(256);
+  RTPPacketBuffer *c = pool->Allocate(10);
+  EXPECT_EQ(a->GetCapacity(), 256u);
+  EXPECT_EQ(a->GetReferenceCount(), 1u);
+
+  // 太大的数据包得到不属于池的缓冲区
+  RTPPacketBuffer *big = pool->Allocate(1000);
+  EXPECT_EQ(big->GetCapacity(), 1000u);
+  big->Release();
+  EXPECT_EQ(pool->GetFreeBuffers(), 0u);
+
+  // 只保留 maxfree 个空闲缓冲区
+  a->AddReference();
+  a->Release();
+  EXPECT_EQ(pool->GetFreeBuffers(), 0u);
+  a->Release();
+  b->Release();
+  c->Release();
+  EXPECT_EQ(pool->GetFreeBuffers(), 2u);
+
+  RTPPacketBuffer *again = pool->Allocate(50);
+  EXPECT_TRUE(again == a || again == b);
+  EXPECT_EQ(again->GetReferenceCount(), 1u);
+  EXPECT_EQ(pool->GetFreeBuffers(), 1u);
+
+  // 池在最后一个借出的缓冲区回来之后才被删除
+  pool->Release();
+  again->Release();
+}
+
+TEST(RTPPacketBufferTest, SharedPacketsReleaseDataOnce) {
+  RTPPacketBufferPool *pool = RTPPacketBufferPool::Create(2048);
+  std::vector<uint8_t> bytes = MakePacket();
+  RTPPacketBuffer *buf = pool->Allocate(bytes.size());
+  RTPPacket *pack = ParsePacket(bytes, buf);
+  ASSERT_EQ(pack->GetCreationError(), 0);
+
+  // 共享的数据包指向同一份数据
+  std::vector<RTPPacket *> shared;
+  for (int i = 0; i < 8; i++) {
+    shared.push_back(pack->Share());
+    ASSERT_NE(shared.back(), nullptr);
+    EXPECT_EQ(shared.back()->GetPacketData(), pack->GetPacketData());
+    EXPECT_EQ(shared.back()->GetSequenceNumber(), 7);
+    EXPECT_TRUE(shared.back()->HasExtension());
+  }
+  EXPECT_EQ(buf->GetReferenceCount(), 9u);
+  delete pack;
+
+  // 在多个线程中释放，最后一个引用把缓冲区还给池
+  std::vector<std::thread> threads;
+  for (RTPPacket *p : shared)
+    threads.emplace_back([p]() { delete p; });
+  for (auto &t : threads)
+    t.join();
+  EXPECT_EQ(pool->GetFreeBuffers(), 1u);
+  pool->Release();
+}
+
+TEST(RTPPacketBufferTest, PlainDataIsCopiedOnlyOnFirstShare) {
+  std::vector<uint8_t> bytes = MakePacket();
+  RTPPacket *pack = ParsePacket(bytes);
+  uint8_t *olddata = pack->GetPacketData();
+
+  RTPPacket *first = pack->Share();
+  ASSERT_NE(first, nullptr);
+  EXPECT_NE(pack->GetPacketData(), olddata);
+  EXPECT_EQ(first->GetPacketData(), pack->GetPacketData());
+  EXPECT_EQ(memcmp(pack->GetPacketData(), bytes.data(), bytes.size()), 0);
+  EXPECT_EQ(pack->GetPayloadData(), pack->GetPacketData() + (bytes.size() - 100));
+  EXPECT_EQ(pack->GetExtensionData()[0], 1);
+
+  RTPPacket *second = first->Share();
+  EXPECT_EQ(second->GetPacketData(), pack->GetPacketData());
+  delete pack;
+  delete first;
+  EXPECT_EQ(second->GetPayloadData()[99], 0x3C);
+  delete second;
+
+  // 外部缓冲区中的数据包不能共享
+  uint8_t external[64];
+  RTPPacket built(96, "abc", 3, 1, 2, 3, false, 0, nullptr, false, 0, 0, nullptr, external, sizeof(external));
+  ASSERT_EQ(built.GetCreationError(), 0);
+  EXPECT_EQ(built.Share(), nullptr);
+}
+
+TEST(RTPPacketBufferTest, PacketRefIsMoveOnly) {
+  static_assert(!std::is_copy_constructible<RTPPacketRef>::value, "RTPPacketRef must be move-only");
+
+  RTPPacketBufferPool *pool = RTPPacketBufferPool::Create(2048);
+  std::vector<uint8_t> bytes = MakePacket();
+
+  RTPPacketRef ref(ParsePacket(bytes, pool->Allocate(bytes.size())));
+  RTPPacketRef copy = ref.Share();
+  ASSERT_TRUE(copy);
+  EXPECT_EQ(copy->GetPacketData(), ref->GetPacketData());
+
+  RTPPacketRef moved = std::move(ref);
+  EXPECT_FALSE(ref);
+  EXPECT_FALSE(ref.Share());
+  EXPECT_EQ((*moved).GetSSRC(), 0x1234u);
+
+  moved.Reset();
+  EXPECT_EQ(pool->GetFreeBuffers(), 0u);
+  RTPPacket *p = copy.Detach();
+  EXPECT_FALSE(copy);
+  delete p;
+  EXPECT_EQ(pool->GetFreeBuffers(), 1u);
+  pool->Release();
+}
+
+TEST(RTPPacketBufferTest, UDPv4TransmitterReceivesIntoPool) {
+  RTPPacketBufferPool *pool = RTPPacketBufferPool::Create(2048);
+
+  RTPUDPv4TransmissionParams params;
+  params.SetBindIP(INADDR_LOOPBACK);
+  params.SetPortbase(0);
+  params.SetRTCPMultiplexing(true);
+  params.SetPacketBufferPool(pool);
+
+  RTPUDPv4Transmitter trans;
+  ASSERT_EQ(trans.Init(false), 0);
+  ASSERT_EQ(trans.Create(1400, &params), 0);
+  RTPTransmissionInfo *inf = trans.GetTransmissionInfo();
+  uint16_t port = static_cast<RTPUDPv4TransmissionInfo *>(inf)->GetRTPPort();
+  trans.DeleteTransmissionInfo(inf);
+
+  std::vector<uint8_t> bytes = MakePacket();
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(sendto(sock, bytes.data(), bytes.size(), 0, (struct sockaddr *)&addr, sizeof(addr)), (ssize_t)bytes.size());
+  close(sock);
+
+  bool available = false;
+  ASSERT_EQ(trans.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  ASSERT_EQ(trans.Poll(), 0);
+  RTPRawPacket *raw = trans.GetNextPacket();
+  ASSERT_NE(raw, nullptr);
+  EXPECT_NE(raw->GetDataReleaser(), nullptr);
+
+  RTPPacketRef pack(new RTPPacket(*raw));
+  delete raw;
+  RTPPacketRef shared = pack.Share();
+  EXPECT_EQ(shared->GetPacketData(), pack->GetPacketData());
+  EXPECT_EQ(shared->GetPayloadLength(), 100u);
+
+  pack.Reset();
+  shared.Reset();
+  EXPECT_EQ(pool->GetFreeBuffers(), 1u);
+
+  trans.Destroy();
+  pool->Release();
+}
+
+TEST(RTPPacketBufferTest, UDPReceivePathsUseBuffersByDefault) {
+  {
+    SCOPED_TRACE("classic");
+    RTPUDPv4TransmissionParams params;
+    ExpectUDPv4ReceivesIntoBuffer(params);
+  }
+  {
+    SCOPED_TRACE("receive shards");
+    RTPUDPv4TransmissionParams params;
+    params.SetReceiveShards(2);
+    ExpectUDPv4ReceivesIntoBuffer(params);
+  }
+
+  RTPIoUring ring;
+  if (ring.Init() == 0) {
+    SCOPED_TRACE("io_uring");
+    RTPUDPv4TransmissionParams params;
+    params.SetIoUring(&ring);
+    ExpectUDPv4ReceivesIntoBuffer(params);
+  }
+  ring.Destroy();
+}
@@ -4,6 +4,7 @@
 #include "core/media_rtp_sources.h"
 #include "utils/media_rtp_errors.h"
 #include "utils/media_rtp_structs.h"
+#include "test_utils.h"
 
 #include <vector>
 #include <cstring>
@@ -142,3 +143,99 @@ TEST(RTPPacketBuilderTest, CSRCListBoundsAndClear) {
   EXPECT_EQ(b.DeleteCSRC(0x1000), 0);
   b.ClearCSRCList();
 }
+
+TEST(RTPPacketBuilderTest, TransmitTimeReplacesPacketTime) {
+  RTPPacketBuilder b;
+  ASSERT_EQ(b.Init(512), 0);
+  uint8_t pl[10] = {0};
+
+  RTPTime sendtime(1000, 250000);
+  EXPECT_FALSE(b.SetPacketTransmitTime(b.GetTimestamp(), sendtime)); // 尚未生成数据包
+
+  ASSERT_EQ(b.BuildPacket(pl, sizeof(pl), 96, false, 0), 0);
+  uint32_t ts = b.GetPacketTimestamp();
+  ASSERT_EQ(b.BuildPacket(pl, sizeof(pl), 96, false, 160), 0); // 同一时间戳的第二个数据包
+
+  EXPECT_FALSE(b.SetPacketTransmitTime(ts + 1, sendtime));
+  EXPECT_TRUE(b.SetPacketTransmitTime(ts, sendtime));
+  EXPECT_EQ(b.GetPacketTime().GetSeconds(), 1000);
+  EXPECT_EQ(b.GetPacketTime().GetMicroSeconds(), 250000u);
+
+  // 只使用第一个数据包的发送时间
+  EXPECT_FALSE(b.SetPacketTransmitTime(ts, RTPTime(1000, 500000)));
+  EXPECT_EQ(b.GetPacketTime().GetMicroSeconds(), 250000u);
+
+  // 新的时间戳重新取当前时间，旧时间戳的发送时间被忽略
+  ASSERT_EQ(b.BuildPacket(pl, sizeof(pl), 96, false, 0), 0);
+  EXPECT_EQ(b.GetPacketTimestamp(), ts + 160);
+  EXPECT_FALSE(b.SetPacketTransmitTime(ts, sendtime));
+  EXPECT_GT(b.GetPacketTime().GetSeconds(), 1000);
+  EXPECT_TRUE(b.SetPacketTransmitTime(ts + 160, RTPTime(1001, 0)));
+}
+
+namespace {
+
+uint16_t HeaderSeq(const uint8_t *h) { return (uint16_t)((h[2] << 8) | h[3]); }
+uint32_t HeaderWord(const uint8_t *h) { return ((uint32_t)h[0] << 24) | ((uint32_t)h[1] << 16) | ((uint32_t)h[2] << 8) | h[3]; }
+
+} // namespace
+
+TEST(RTPPacketBuilderTest, ForwardedHeaderMapsSequenceAndTimestamp) {
+  RTPPacketBuilder b;
+  ASSERT_EQ(b.Init(1500), 0);
+  const double tsunit = 1.0 / 90000.0;
+  uint16_t seq0 = b.GetSequenceNumber();
+  uint32_t ts0 = b.GetTimestamp();
+  std::vector<uint8_t> payload(40, 0x5A);
+
+  // 只复制头部，CSRC列表保持不变
+  RTPPacket *p = ParsePacket(BuildRTPRaw(true, 100, 100, 1000, 0x1111, {0xC5C5C5C5}, false, 0, {}, payload));
+  ASSERT_EQ(b.BuildForwardedHeader(*p, tsunit), 0);
+  ASSERT_EQ(b.GetPacketLength(), 16u);
+  const uint8_t *h = b.GetPacket();
+  EXPECT_EQ(h[1], 0x80 | 100);
+  EXPECT_EQ(HeaderSeq(h), seq0);
+  EXPECT_EQ(HeaderWord(h + 4), ts0);
+  EXPECT_EQ(HeaderWord(h + 8), b.GetSSRC());
+  EXPECT_EQ(HeaderWord(h + 12), 0xC5C5C5C5u);
+
+  // 同一个源保持序列号和时间戳的间隔
+  RTPPacket *p2 = ParsePacket(BuildRTPRaw(false, 100, 102, 4000, 0x1111, {0xC5C5C5C5}, false, 0, {}, payload));
+  ASSERT_EQ(b.BuildForwardedHeader(*p2, tsunit), 0);
+  EXPECT_EQ(HeaderSeq(b.GetPacket()), (uint16_t)(seq0 + 2));
+  EXPECT_EQ(HeaderWord(b.GetPacket() + 4), ts0 + 3000);
+
+  // 迟到的数据包照常映射，但不改变下一个序列号
+  RTPPacket *late = ParsePacket(BuildRTPRaw(false, 100, 101, 2500, 0x1111, {0xC5C5C5C5}, false, 0, {}, payload));
+  ASSERT_EQ(b.BuildForwardedHeader(*late, tsunit), 0);
+  EXPECT_EQ(HeaderSeq(b.GetPacket()), (uint16_t)(seq0 + 1));
+  EXPECT_EQ(b.GetSequenceNumber(), (uint16_t)(seq0 + 3));
+  EXPECT_EQ(b.GetPacketCount(), 3u);
+  EXPECT_EQ(b.GetPayloadOctetCount(), 3 * payload.size());
+
+  // 换源后接着上一个数据包，时间戳至少增加1
+  RTPPacket *other = ParsePacket(BuildRTPRaw(false, 100, 5000, 77, 0x2222, {}, false, 0, {}, payload));
+  ASSERT_EQ(b.BuildForwardedHeader(*other, tsunit), 0);
+  EXPECT_EQ(b.GetPacketLength(), 12u);
+  EXPECT_EQ(HeaderSeq(b.GetPacket()), (uint16_t)(seq0 + 3));
+  uint32_t switchts = HeaderWord(b.GetPacket() + 4);
+  EXPECT_GT(switchts - ts0, 3000u);
+
+  // 追加负载得到完整的数据包
+  ASSERT_EQ(b.AppendForwardedPayload(other->GetPayloadData(), other->GetPayloadLength()), 0);
+  ASSERT_EQ(b.GetPacketLength(), 12 + payload.size());
+  EXPECT_EQ(std::memcmp(b.GetPacket() + 12, payload.data(), payload.size()), 0);
+
+  // 中间构建过普通数据包后重新建立映射
+  uint8_t pl[10] = {0};
+  ASSERT_EQ(b.BuildPacket(pl, sizeof(pl), 96, false, 0), 0);
+  RTPPacket *next = ParsePacket(BuildRTPRaw(false, 100, 5001, 3077, 0x2222, {}, false, 0, {}, payload));
+  ASSERT_EQ(b.BuildForwardedHeader(*next, tsunit), 0);
+  EXPECT_EQ(HeaderSeq(b.GetPacket()), (uint16_t)(seq0 + 5));
+
+  delete p;
+  delete p2;
+  delete late;
+  delete other;
+  delete next;
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "transmitters/media_rtp_packet_ring.h"
+#include "packets/media_rtp_packet_factory.h"
+
+namespace {
+
+// 数据为4字节序号的数据包
+RTPRawPacket *MakePacket(uint32_t n) {
+  uint8_t *data = new uint8_t[4];
+  memcpy(data, &n, 4);
+  RTPTime now(0, 0);
+  return new RTPRawPacket(data, 4, nullptr, now, true);
+}
+
+uint32_t PacketNumber(RTPRawPacket *pack) {
+  uint32_t n;
+  memcpy(&n, pack->GetData(), 4);
+  return n;
+}
+
+} // namespace
+
+TEST(RTPPacketRingTest, DropsWhenFullAndTracksHighWater) {
+  RTPPacketRing ring(6);
+  EXPECT_EQ(ring.GetCapacity(), 8u);
+  EXPECT_EQ(ring.Pop(), nullptr);
+
+  EXPECT_FALSE(ring.IsFull());
+  for (uint32_t i = 0; i < 10; i++)
+    EXPECT_EQ(ring.Push(MakePacket(i)), i < 8);
+  EXPECT_TRUE(ring.IsFull());
+  EXPECT_EQ(ring.GetSize(), 8u);
+  EXPECT_EQ(ring.GetDroppedPackets(), 2u);
+  EXPECT_EQ(ring.GetHighWaterMark(), 8u);
+
+  for (uint32_t i = 0; i < 5; i++) {
+    RTPRawPacket *pack = ring.Pop();
+    ASSERT_NE(pack, nullptr);
+    EXPECT_EQ(PacketNumber(pack), i);
+    delete pack;
+  }
+
+  EXPECT_FALSE(ring.IsFull());
+
+  // 下标回绕后顺序不变，剩余的数据包在析构时删除
+  for (uint32_t i = 10; i < 13; i++)
+    EXPECT_TRUE(ring.Push(MakePacket(i)));
+  RTPRawPacket *pack = ring.Pop();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_EQ(PacketNumber(pack), 5u);
+  delete pack;
+  EXPECT_EQ(ring.GetSize(), 5u);
+  EXPECT_EQ(ring.GetHighWaterMark(), 8u);
+}
+
+TEST(RTPPacketRingTest, ProducerAndConsumerThreadsKeepOrder) {
+  RTPPacketRing ring(64);
+  const uint32_t num = 200000;
+
+  std::thread producer([&ring, num]() {
+    for (uint32_t i = 0; i < num; i++) {
+      RTPRawPacket *pack = MakePacket(i);
+      while (ring.GetSize() >= ring.GetCapacity())
+        std::this_thread::yield();
+      ring.Push(pack);
+    }
+  });
+
+  uint32_t next = 0;
+  while (next < num) {
+    RTPRawPacket *pack = ring.Pop();
+    if (pack == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(PacketNumber(pack), next);
+    next++;
+    delete pack;
+  }
+  producer.join();
+
+  EXPECT_EQ(ring.GetDroppedPackets(), 0u);
+  EXPECT_LE(ring.GetHighWaterMark(), ring.GetCapacity());
+  EXPECT_GT(ring.GetHighWaterMark(), 0u);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "core/media_rtp_source_data.h"
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "utils/media_rtp_endpoint.h"
+#include "test_utils.h"
+
+namespace {
+
+// 记录收到的序列号，保留第一个数据包
+class RecordingSink : public RTPPacketSink {
+public:
+  bool OnRTPPacket(RTPSourceData *srcdat, RTPPacket *pack, bool isonprobation) override {
+    EXPECT_NE(srcdat, nullptr);
+    seqnrs.push_back(pack->GetSequenceNumber());
+    probation.push_back(isonprobation);
+    if (kept == nullptr) {
+      kept = pack;
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<uint16_t> seqnrs;
+  std::vector<bool> probation;
+  RTPPacket *kept = nullptr;
+};
+
+} // namespace
+
+TEST(RTPPacketSinkTest, ValidatedPacketsBypassSourceQueue) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetAcceptOwnPackets(true);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetCNAME("sink@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  transparams.SetBindIP(INADDR_LOOPBACK);
+
+  RTPSession session;
+  ASSERT_EQ(session.Create(sessparams, &transparams), 0);
+  uint16_t port = GetSessionRTPPort(session);
+  ASSERT_EQ(session.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+
+  RecordingSink sink;
+  ASSERT_EQ(session.SetPacketSink(&sink), 0);
+
+  uint8_t payload[20] = {0};
+  for (int i = 0; i < 10; i++)
+    ASSERT_EQ(session.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+
+  for (int attempt = 0; attempt < 100 && sink.seqnrs.size() < 10; attempt++) {
+    ASSERT_EQ(session.Poll(), 0);
+    if (sink.seqnrs.size() < 10)
+      RTPTime::Wait(RTPTime(0.001));
+  }
+
+  // 每个数据包都按顺序直接交给了接收器，源的数据包列表保持为空
+  ASSERT_EQ(sink.seqnrs.size(), 10u);
+  for (size_t i = 1; i < sink.seqnrs.size(); i++)
+    EXPECT_EQ((uint16_t)(sink.seqnrs[i] - sink.seqnrs[i - 1]), 1);
+  EXPECT_FALSE(sink.probation.back());
+
+  ASSERT_EQ(session.BeginDataAccess(), 0);
+  EXPECT_FALSE(session.GotoFirstSourceWithData());
+  ASSERT_EQ(session.EndDataAccess(), 0);
+
+  // 接收器保留的数据包在返回之后仍然有效
+  ASSERT_NE(sink.kept, nullptr);
+  EXPECT_EQ(sink.kept->GetSequenceNumber(), sink.seqnrs[0]);
+  EXPECT_EQ(sink.kept->GetPayloadLength(), sizeof(payload));
+  session.DeletePacket(sink.kept);
+
+  // 移除接收器后恢复默认的排队行为
+  ASSERT_EQ(session.SetPacketSink(nullptr), 0);
+  ASSERT_EQ(session.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+  bool queued = false;
+  for (int attempt = 0; attempt < 100 && !queued; attempt++) {
+    ASSERT_EQ(session.Poll(), 0);
+    ASSERT_EQ(session.BeginDataAccess(), 0);
+    if (session.GotoFirstSourceWithData()) {
+      RTPPacket *pack = session.GetNextPacket();
+      ASSERT_NE(pack, nullptr);
+      EXPECT_EQ((uint16_t)(pack->GetSequenceNumber() - sink.seqnrs.back()), 1);
+      session.DeletePacket(pack);
+      queued = true;
+    }
+    ASSERT_EQ(session.EndDataAccess(), 0);
+    if (!queued)
+      RTPTime::Wait(RTPTime(0.001));
+  }
+  EXPECT_TRUE(queued);
+  EXPECT_EQ(sink.seqnrs.size(), 10u);
+
+  session.Destroy();
+}
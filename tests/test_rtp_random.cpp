@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "utils/media_rtp_utils.h"
+
+TEST(RTPRandomTest, ValuesCoverTheirRange) {
+  double mindouble = 1.0, maxdouble = 0.0;
+  uint32_t bits8 = 0, bits16 = 0, bits32 = 0;
+  int high = 0;
+  const int n = 100000;
+
+  for (int i = 0; i < n; i++) {
+    double d = RTPGenerateRandomDouble();
+    ASSERT_GE(d, 0.0);
+    ASSERT_LT(d, 1.0);
+    if (d < mindouble)
+      mindouble = d;
+    if (d > maxdouble)
+      maxdouble = d;
+    if (d >= 0.5)
+      high++;
+    bits8 |= RTPGenerateRandom8();
+    bits16 |= RTPGenerateRandom16();
+    bits32 |= RTPGenerateRandom32();
+  }
+  EXPECT_LT(mindouble, 0.001);
+  EXPECT_GT(maxdouble, 0.999);
+  EXPECT_NEAR(high, n / 2, n / 50);
+  EXPECT_EQ(bits8, 0xFFu);
+  EXPECT_EQ(bits16, 0xFFFFu);
+  EXPECT_EQ(bits32, 0xFFFFFFFFu);
+}
+
+TEST(RTPRandomTest, ThreadsUseIndependentGenerators) {
+  const int numthreads = 8;
+  std::vector<std::vector<uint32_t>> values(numthreads);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < numthreads; t++) {
+    threads.push_back(std::thread([&values, t]() {
+      for (int i = 0; i < 1000; i++)
+        values[t].push_back(RTPGenerateRandom32());
+    }));
+  }
+  for (auto &th : threads)
+    th.join();
+
+  // 各线程的序列互不相同
+  std::set<uint32_t> all;
+  for (const auto &v : values)
+    all.insert(v.begin(), v.end());
+  EXPECT_GT(all.size(), (size_t)(numthreads * 1000 - 10));
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "core/media_rtp_retransmission_cache.h"
+#include "core/media_rtp_session_params.h"
+#include "core/media_rtp_source_data.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_errors.h"
+#include "test_utils.h"
+
+namespace {
+
+RTPSessionParams GetSessionParams(const char *cname) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetUseAVPF(true);
+  sessparams.SetProbationType(RTPSources::NoProbation);
+  sessparams.SetCNAME(cname);
+  return sessparams;
+}
+
+int CreateSession(RTPSession &session, const RTPSessionParams &sessparams) {
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetBindIP(INADDR_LOOPBACK);
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  return session.Create(sessparams, &transparams);
+}
+
+// 轮询两个会话，把 \c receiver 收到的数据包按SSRC和序列号保存下来
+void PollSessions(RTPSession &sender, RTPSession &receiver, std::map<std::pair<uint32_t, uint16_t>, std::vector<uint8_t>> &received) {
+  RTPTime::Wait(RTPTime(0.005));
+  ASSERT_EQ(sender.Poll(), 0);
+  ASSERT_EQ(receiver.Poll(), 0);
+  ASSERT_EQ(receiver.BeginDataAccess(), 0);
+  if (receiver.GotoFirstSourceWithData()) {
+    do {
+      RTPPacket *pack;
+      while ((pack = receiver.GetNextPacket()) != nullptr) {
+        std::vector<uint8_t> data(pack->GetPacketData(), pack->GetPacketData() + pack->GetPacketLength());
+        received[std::make_pair(pack->GetSSRC(), pack->GetSequenceNumber())] = data;
+        receiver.DeletePacket(pack);
+      }
+    } while (receiver.GotoNextSourceWithData());
+  }
+  ASSERT_EQ(receiver.EndDataAccess(), 0);
+}
+
+} // namespace
+
+TEST(RTPRetransmissionCacheTest, StoreLookupAndSlotReuse) {
+  RTPRetransmissionCache cache;
+  EXPECT_EQ(cache.StorePacket(nullptr, 0, RTPTime(0.0)), MEDIA_RTP_ERR_INVALID_STATE);
+  ASSERT_EQ(cache.Init(4, 1500, 1 << 20, RTPTime(10.0)), 0);
+
+  // 跨越序列号回绕存储 5 个包，4 个槽位中最早的 65534 被覆盖
+  for (uint16_t seq = 65534, i = 0; i < 5; ++seq, ++i) {
+    auto pkt = BuildRTPRaw(false, 96, seq, 1000, 0x11223344, {}, false, 0, {},
+                           std::vector<uint8_t>(100, (uint8_t)i));
+    ASSERT_EQ(cache.StorePacket(pkt.data(), pkt.size(), RTPTime(1.0)), 0);
+  }
+  EXPECT_EQ(cache.GetPacketCount(), 4u);
+  EXPECT_EQ(cache.GetByteCount(), 4u * 112u);
+
+  size_t len = 0, payloadlen = 0;
+  const uint8_t *payload = nullptr;
+  EXPECT_EQ(cache.GetPacket(65534, RTPTime(1.0), &len, &payload, &payloadlen), nullptr);
+  const uint8_t *p = cache.GetPacket(2, RTPTime(1.0), &len, &payload, &payloadlen);
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(len, 112u);
+  EXPECT_EQ(payloadlen, 0u);
+  EXPECT_EQ(p[12], 4);
+
+  // 超过最大存放时间后不再返回
+  EXPECT_EQ(cache.GetPacket(2, RTPTime(12.0), &len, &payload, &payloadlen), nullptr);
+}
+
+TEST(RTPRetransmissionCacheTest, EvictsOldestByBytesAndAge) {
+  RTPRetransmissionCache cache;
+  ASSERT_EQ(cache.Init(64, 1500, 3 * 112, RTPTime(1.0)), 0);
+
+  for (uint16_t seq = 10; seq < 14; ++seq) {
+    auto pkt = BuildRTPRaw(false, 96, seq, 0, 1, {}, false, 0, {}, std::vector<uint8_t>(100));
+    ASSERT_EQ(cache.StorePacket(pkt.data(), pkt.size(), RTPTime(5.0)), 0);
+  }
+  size_t len, payloadlen;
+  const uint8_t *payload;
+  EXPECT_EQ(cache.GetPacketCount(), 3u);
+  EXPECT_EQ(cache.GetPacket(10, RTPTime(5.0), &len, &payload, &payloadlen), nullptr);
+  EXPECT_NE(cache.GetPacket(11, RTPTime(5.0), &len, &payload, &payloadlen), nullptr);
+
+  auto pkt = BuildRTPRaw(false, 96, 14, 0, 1, {}, false, 0, {}, std::vector<uint8_t>(10));
+  ASSERT_EQ(cache.StorePacket(pkt.data(), pkt.size(), RTPTime(7.0)), 0);
+  EXPECT_EQ(cache.GetPacketCount(), 1u);
+  EXPECT_EQ(cache.GetByteCount(), 22u);
+
+  auto big = BuildRTPRaw(false, 96, 15, 0, 1, {}, false, 0, {}, std::vector<uint8_t>(400));
+  EXPECT_EQ(cache.StorePacket(big.data(), big.size(), RTPTime(7.0)), MEDIA_RTP_ERR_INVALID_PARAMETER);
+}
+
+TEST(RTPRetransmissionCacheTest, BuildRTXPacketAddsOSNAndStripsPadding) {
+  RTPRetransmissionCache cache;
+  ASSERT_EQ(cache.Init(16, 1500, 1 << 20, RTPTime(1.0)), 0);
+
+  auto pkt = BuildRTPRaw(true, 96, 0x1234, 0x01020304, 0xAABBCCDD, {0x11111111}, true, 0xBEDE,
+                         {1, 2, 3, 4}, {9, 8, 7, 0, 0, 3});
+  pkt[0] |= 0x20; // 最后 3 字节是填充
+  ASSERT_EQ(cache.StorePacket(pkt.data(), pkt.size(), RTPTime(0.0)), 0);
+
+  uint8_t buf[1500];
+  size_t rtxlen = 0;
+  EXPECT_EQ(cache.BuildRTXPacket(0x9999, RTPTime(0.0), 97, 0x55667788, 7, buf, sizeof(buf), &rtxlen),
+            MEDIA_RTP_ERR_OPERATION_FAILED);
+  ASSERT_EQ(cache.BuildRTXPacket(0x1234, RTPTime(0.0), 97, 0x55667788, 7, buf, sizeof(buf), &rtxlen), 0);
+
+  uint8_t *copy = new uint8_t[rtxlen];
+  std::memcpy(copy, buf, rtxlen);
+  RTPTime t(0, 0);
+  RTPRawPacket raw(copy, rtxlen, nullptr, t, true);
+  RTPPacket p(raw);
+  ASSERT_EQ(p.GetCreationError(), 0);
+  EXPECT_TRUE(p.HasMarker());
+  EXPECT_EQ(p.GetPayloadType(), 97);
+  EXPECT_EQ(p.GetSequenceNumber(), 7);
+  EXPECT_EQ(p.GetSSRC(), 0x55667788u);
+  EXPECT_EQ(p.GetTimestamp(), 0x01020304u);
+  EXPECT_EQ(p.GetCSRC(0), 0x11111111u);
+  EXPECT_EQ(p.GetExtensionID(), 0xBEDEu);
+  ASSERT_EQ(p.GetPayloadLength(), 5u);
+  const uint8_t *payload = p.GetPayloadData();
+  EXPECT_EQ(payload[0], 0x12);
+  EXPECT_EQ(payload[1], 0x34);
+  EXPECT_EQ(payload[2], 9);
+  EXPECT_EQ(payload[4], 7);
+}
+
+TEST(RTPRetransmissionTest, NACKIsAnsweredWithRTXPacket) {
+  RTPSessionParams senderparams = GetSessionParams("sender@localhost");
+  senderparams.SetRetransmissionCacheSize(16);
+  senderparams.SetUseRTX(true);
+  senderparams.SetRTXPayloadType(97);
+  senderparams.SetRetransmitOnNACK(true);
+
+  RTPSession sender, receiver;
+  ASSERT_EQ(CreateSession(sender, senderparams), 0);
+  ASSERT_EQ(CreateSession(receiver, GetSessionParams("receiver@localhost")), 0);
+  uint16_t senderport = GetSessionRTPPort(sender);
+  uint16_t receiverport = GetSessionRTPPort(receiver);
+  ASSERT_EQ(sender.AddDestination(RTPEndpoint(INADDR_LOOPBACK, receiverport, receiverport)), 0);
+  ASSERT_EQ(receiver.AddDestination(RTPEndpoint(INADDR_LOOPBACK, senderport, senderport)), 0);
+
+  // RTX SSRC作为自己的SSRC加入源表，用于冲突检测
+  uint32_t ssrc = sender.GetLocalSSRC();
+  uint32_t rtxssrc = sender.GetRTXSSRC();
+  EXPECT_NE(rtxssrc, ssrc);
+  RTPSourceData *rtxdat = sender.GetSourceInfo(rtxssrc);
+  ASSERT_NE(rtxdat, nullptr);
+  EXPECT_TRUE(rtxdat->IsOwnSSRC());
+
+  std::map<std::pair<uint32_t, uint16_t>, std::vector<uint8_t>> received;
+  for (uint8_t i = 0; i < 3; i++) {
+    std::vector<uint8_t> payload(40, i);
+    ASSERT_EQ(sender.SendPacket(payload.data(), payload.size(), 96, false, 3000), 0);
+  }
+  for (int round = 0; round < 200 && received.size() < 3; round++)
+    PollSessions(sender, receiver, received);
+  ASSERT_EQ(received.size(), 3u);
+
+  // 请求重传第二个数据包
+  std::vector<uint8_t> original = std::next(received.begin())->second;
+  uint16_t lost = std::next(received.begin())->first.second;
+  ASSERT_EQ(receiver.SendNACK(ssrc, &lost, 1), 0);
+
+  std::vector<uint8_t> rtx;
+  for (int round = 0; round < 200 && rtx.empty(); round++) {
+    PollSessions(sender, receiver, received);
+    for (auto &it : received) {
+      if (it.first.first == rtxssrc)
+        rtx = it.second;
+    }
+  }
+  ASSERT_EQ(rtx.size(), original.size() + 2);
+  EXPECT_EQ(rtx[1] & 0x7F, 97);
+  EXPECT_EQ(memcmp(rtx.data() + 4, original.data() + 4, 4), 0); // 时间戳不变
+  EXPECT_EQ((uint16_t)((rtx[12] << 8) | rtx[13]), lost);      // 原始序列号
+  EXPECT_EQ(memcmp(rtx.data() + 14, original.data() + 12, original.size() - 12), 0);
+
+  // RTX SSRC和原始流使用相同的CNAME通告；成员超过两个时提前的RTCP会抖动，最多等待一个常规间隔
+  ASSERT_EQ(sender.SendPLI(receiver.GetLocalSSRC()), 0);
+  std::string cname;
+  for (int round = 0; round < 1000 && cname.empty(); round++) {
+    PollSessions(sender, receiver, received);
+    RTPSourceData *srcdat = receiver.GetSourceInfo(rtxssrc);
+    if (srcdat != nullptr) {
+      size_t len;
+      uint8_t *data = srcdat->SDES_GetCNAME(&len);
+      cname.assign((const char *)data, len);
+    }
+  }
+  EXPECT_EQ(cname, "sender@localhost");
+
+  sender.Destroy();
+  receiver.Destroy();
+}
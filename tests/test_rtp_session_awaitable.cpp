@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <list>
+#include <vector>
+
+#include "core/media_rtp_session_awaitable.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "utils/media_rtp_endpoint.h"
+#include "test_utils.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+namespace {
+
+// 立即开始执行、结束时自动销毁的协程
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+// 用 RTPSelect 实现的单线程反应器
+class SelectReactor : public RTPCoroutineReactor {
+public:
+  void WaitReadable(const std::vector<int> &descriptors, const RTPTime &deadline,
+                    std::function<void()> callback) override {
+    waiters.push_back(Waiter{descriptors, deadline, callback});
+  }
+
+  size_t GetNumWaiters() const { return waiters.size(); }
+
+  // 等待一个事件并调用相应的回调
+  void RunOnce() {
+    std::list<Waiter> current;
+    current.swap(waiters);
+
+    std::vector<int> socks;
+    RTPTime timeout(0.1);
+    RTPTime now = RTPTime::CurrentTime();
+    for (const Waiter &w : current) {
+      socks.insert(socks.end(), w.descriptors.begin(), w.descriptors.end());
+      RTPTime left = w.deadline;
+      left -= now;
+      if (left < timeout)
+        timeout = (left < RTPTime(0)) ? RTPTime(0) : left;
+    }
+    std::vector<int8_t> flags(socks.size());
+    ASSERT_GE(RTPSelect(socks.data(), flags.data(), socks.size(), timeout), 0);
+
+    now = RTPTime::CurrentTime();
+    size_t idx = 0;
+    for (const Waiter &w : current) {
+      bool ready = !(now < w.deadline);
+      for (size_t i = 0; i < w.descriptors.size(); i++, idx++)
+        ready = ready || flags[idx];
+      if (ready)
+        w.callback();
+      else
+        waiters.push_back(w);
+    }
+  }
+
+private:
+  struct Waiter {
+    std::vector<int> descriptors;
+    RTPTime deadline;
+    std::function<void()> callback;
+  };
+  std::list<Waiter> waiters;
+};
+
+DetachedTask Receive(RTPSession &session, RTPAsyncReceiver &receiver, uint32_t ssrc, int count,
+                     std::vector<uint16_t> &seqnrs, bool &done) {
+  for (int i = 0; i < count; i++) {
+    RTPPacket *pack = (i % 2 == 0) ? co_await receiver.NextPacket() : co_await receiver.NextPacketFrom(ssrc);
+    if (pack == nullptr)
+      break;
+    EXPECT_EQ(pack->GetSSRC(), ssrc);
+    seqnrs.push_back(pack->GetSequenceNumber());
+    session.DeletePacket(pack);
+  }
+  done = true;
+}
+
+} // namespace
+
+TEST(RTPSessionAwaitableTest, CoroutineSuspendsUntilPacketsArrive) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetAcceptOwnPackets(true);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetCNAME("awaitable@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  transparams.SetBindIP(INADDR_LOOPBACK);
+
+  RTPSession session;
+  ASSERT_EQ(session.Create(sessparams, &transparams), 0);
+  uint16_t port = GetSessionRTPPort(session);
+  ASSERT_EQ(session.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+
+  SelectReactor reactor;
+  RTPAsyncReceiver receiver(session, reactor);
+  std::vector<uint16_t> seqnrs;
+  bool done = false;
+
+  // 还没有数据，协程挂起并在反应器中登记
+  Receive(session, receiver, session.GetLocalSSRC(), 6, seqnrs, done);
+  EXPECT_FALSE(done);
+  EXPECT_EQ(reactor.GetNumWaiters(), 1u);
+
+  uint8_t payload[20] = {0};
+  for (int i = 0; i < 6; i++)
+    ASSERT_EQ(session.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+
+  for (int i = 0; i < 100 && !done; i++)
+    reactor.RunOnce();
+
+  ASSERT_TRUE(done);
+  ASSERT_EQ(seqnrs.size(), 6u);
+  for (size_t i = 1; i < seqnrs.size(); i++)
+    EXPECT_EQ((uint16_t)(seqnrs[i] - seqnrs[i - 1]), 1);
+  EXPECT_EQ(reactor.GetNumWaiters(), 0u);
+
+  // 同步接口仍然可用：数据包被协程取走后队列为空
+  ASSERT_EQ(session.BeginDataAccess(), 0);
+  EXPECT_FALSE(session.GotoFirstSourceWithData());
+  ASSERT_EQ(session.EndDataAccess(), 0);
+
+  session.Destroy();
+}
+
+TEST(RTPSessionAwaitableTest, SessionErrorCompletesWithoutSuspending) {
+  RTPSession session;
+  SelectReactor reactor;
+  RTPAsyncReceiver receiver(session, reactor);
+  std::vector<uint16_t> seqnrs;
+  bool done = false;
+
+  // 会话没有创建，不能等待：协程不登记到反应器，直接得到null
+  Receive(session, receiver, 0x1234, 1, seqnrs, done);
+  EXPECT_TRUE(done);
+  EXPECT_TRUE(seqnrs.empty());
+  EXPECT_EQ(reactor.GetNumWaiters(), 0u);
+}
+
+TEST(RTPSessionAwaitableTest, GapTriggersPromptNACK) {
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetUseAVPF(true);
+  sessparams.SetGenerateNACKs(true);
+  sessparams.SetProbationType(RTPSources::NoProbation);
+  sessparams.SetCNAME("awaitable@localhost");
+
+  RTPUDPv4TransmissionParams transparams;
+  transparams.SetPortbase(0);
+  transparams.SetRTCPMultiplexing(true);
+  transparams.SetBindIP(INADDR_LOOPBACK);
+
+  RTPSession session;
+  ASSERT_EQ(session.Create(sessparams, &transparams), 0);
+  uint16_t port = GetSessionRTPPort(session);
+
+  // 普通UDP套接字扮演远端发送者，同时接收会话发出的RTCP
+  int sock = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(sock, (struct sockaddr *)&addr, sizeof(addr)), 0);
+  socklen_t addrlen = sizeof(addr);
+  ASSERT_EQ(getsockname(sock, (struct sockaddr *)&addr, &addrlen), 0);
+  uint16_t remoteport = ntohs(addr.sin_port);
+  ASSERT_EQ(session.AddDestination(RTPEndpoint(INADDR_LOOPBACK, remoteport, remoteport)), 0);
+
+  SelectReactor reactor;
+  RTPAsyncReceiver receiver(session, reactor);
+  std::vector<uint16_t> seqnrs;
+  bool done = false;
+
+  // 协程等待的数据包比发送的多，一直挂起在反应器中
+  Receive(session, receiver, 0x1234, 5, seqnrs, done);
+
+  struct sockaddr_in dest = {};
+  dest.sin_family = AF_INET;
+  dest.sin_port = htons(port);
+  dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  std::vector<uint8_t> payload(20, 0);
+  std::vector<uint8_t> first = BuildRTPRaw(false, 96, 9, 9 * 3000, 0x1234, {}, false, 0, {}, payload);
+  ASSERT_EQ(sendto(sock, first.data(), first.size(), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)first.size());
+
+  // 等到第一个常规RTCP数据包发出，下一个要等一个完整的RTCP间隔
+  bool gotrtcp = false;
+  for (int round = 0; round < 100 && !gotrtcp; round++) {
+    reactor.RunOnce();
+    std::vector<uint8_t> buf(2048);
+    while (recv(sock, buf.data(), buf.size(), MSG_DONTWAIT) > 0)
+      gotrtcp = true;
+  }
+  ASSERT_TRUE(gotrtcp);
+
+  uint16_t sent[] = {10, 11, 13};
+  for (uint16_t seqnr : sent) {
+    std::vector<uint8_t> pkt = BuildRTPRaw(false, 96, seqnr, seqnr * 3000, 0x1234, {}, false, 0, {}, payload);
+    ASSERT_EQ(sendto(sock, pkt.data(), pkt.size(), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)pkt.size());
+  }
+
+  // 可读事件只处理数据（RTPSession::OnReadable），NACK按GetEventDescriptors给出的
+  // 截止时间发送，不必等到下一个常规RTCP数据包
+  bool gotnack = false;
+  RTPTime start = RTPTime::CurrentTime();
+  for (int round = 0; round < 20 && !gotnack; round++) {
+    reactor.RunOnce();
+    std::vector<uint8_t> buf(2048);
+    ssize_t len;
+    while ((len = recv(sock, buf.data(), buf.size(), MSG_DONTWAIT)) > 0) {
+      if (ContainsNACK(std::vector<uint8_t>(buf.begin(), buf.begin() + len), 12))
+        gotnack = true;
+    }
+  }
+  RTPTime elapsed = RTPTime::CurrentTime();
+  elapsed -= start;
+  EXPECT_TRUE(gotnack);
+  EXPECT_LT(elapsed.GetDouble(), 0.5);
+  EXPECT_EQ(seqnrs.size(), 4u);
+  EXPECT_FALSE(done);
+
+  // 最后一个数据包让协程结束
+  std::vector<uint8_t> last = BuildRTPRaw(false, 96, 14, 14 * 3000, 0x1234, {}, false, 0, {}, payload);
+  ASSERT_EQ(sendto(sock, last.data(), last.size(), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)last.size());
+  for (int round = 0; round < 20 && !done; round++)
+    reactor.RunOnce();
+  EXPECT_TRUE(done);
+  EXPECT_EQ(seqnrs.size(), 5u);
+
+  close(sock);
+  session.Destroy();
+}
+
+#else
+
+TEST(RTPSessionAwaitableTest, CoroutineSuspendsUntilPacketsArrive) {
+  GTEST_SKIP() << "C++20 coroutines not supported";
+}
+
+#endif // __cpp_impl_coroutine
@@ -0,0 +1,242 @@
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_shm_transmitter.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_errors.h"
+
+namespace {
+
+// 一对描述符描述的环，析构时关闭
+class RingDescriptors {
+public:
+  RingDescriptors(size_t slotcount = 64, size_t slotsize = 1500) {
+    status = RTPSharedMemoryRing::Create(slotcount, slotsize, &memfd, &eventfd);
+  }
+  ~RingDescriptors() {
+    if (status == 0) {
+      close(memfd);
+      close(eventfd);
+    }
+  }
+
+  int status;
+  int memfd = -1, eventfd = -1;
+};
+
+int CreateTransmitter(RTPSharedMemoryTransmitter &trans, const RingDescriptors &in, const RingDescriptors &out,
+                      uint16_t id) {
+  RTPSharedMemoryTransmissionParams params;
+  params.AddInboundRing(in.memfd, in.eventfd);
+  params.AddOutboundRing(out.memfd, out.eventfd);
+  params.SetLocalID(id);
+
+  int status = trans.Init(false);
+  if (status < 0)
+    return status;
+  return trans.Create(1400, &params);
+}
+
+} // namespace
+
+TEST(RTPSharedMemoryTransmitterTest, RingReusesSlotsReleasedOutOfOrder) {
+  RingDescriptors fds(4, 100);
+  ASSERT_EQ(fds.status, 0);
+
+  RTPSharedMemoryRing *producer, *consumer;
+  ASSERT_EQ(RTPSharedMemoryRing::Attach(fds.memfd, fds.eventfd, &producer), 0);
+  ASSERT_EQ(RTPSharedMemoryRing::Attach(fds.memfd, fds.eventfd, &consumer), 0);
+
+  uint8_t data[100] = {0};
+  EXPECT_EQ(producer->Write(data, sizeof(data) + 1, true, 1), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  for (int i = 0; i < 4; i++) {
+    data[0] = (uint8_t)i;
+    ASSERT_EQ(producer->Write(data, sizeof(data), i != 3, 7), 0);
+  }
+  EXPECT_EQ(producer->Write(data, sizeof(data), true, 7), MEDIA_RTP_ERR_RESOURCE_ERROR);
+  EXPECT_EQ(consumer->GetDroppedPackets(), 1u);
+
+  size_t len;
+  bool rtp;
+  uint16_t sender;
+  uint8_t *first = consumer->Read(&len, &rtp, &sender);
+  uint8_t *second = consumer->Read(&len, &rtp, &sender);
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ(first[0], 0);
+  EXPECT_EQ(second[0], 1);
+  EXPECT_EQ(len, sizeof(data));
+  EXPECT_TRUE(rtp);
+  EXPECT_EQ(sender, 7);
+
+  // 第二个槽位先释放时，生产者跳过仍被持有的最早槽位，使用第二个槽位
+  consumer->ReleaseData(second);
+  data[0] = 4;
+  EXPECT_EQ(producer->Write(data, sizeof(data), true, 7), 0);
+  EXPECT_EQ(producer->Write(data, sizeof(data), true, 7), MEDIA_RTP_ERR_RESOURCE_ERROR);
+  EXPECT_EQ(first[0], 0);
+  consumer->ReleaseData(first);
+
+  // 读出的数据保留映射，直到最后一个数据包释放；跳过的槽位不会被读出
+  uint8_t *third = consumer->Read(&len, &rtp, &sender);
+  ASSERT_NE(third, nullptr);
+  EXPECT_EQ(third[0], 2);
+  uint8_t *fourth = consumer->Read(&len, &rtp, &sender);
+  ASSERT_NE(fourth, nullptr);
+  EXPECT_EQ(fourth[0], 3);
+  EXPECT_FALSE(rtp);
+  uint8_t *fifth = consumer->Read(&len, &rtp, &sender);
+  ASSERT_NE(fifth, nullptr);
+  EXPECT_EQ(fifth[0], 4);
+  EXPECT_EQ(consumer->Read(&len, &rtp, &sender), nullptr);
+  consumer->Release();
+  EXPECT_EQ(third[0], 2);
+  consumer->ReleaseData(third);
+  consumer->ReleaseData(fourth);
+  consumer->ReleaseData(fifth);
+  producer->Release();
+}
+
+TEST(RTPSharedMemoryTransmitterTest, HeldPacketDoesNotBlockTheRing) {
+  RingDescriptors atob(8), btoa(8);
+  ASSERT_EQ(atob.status, 0);
+  ASSERT_EQ(btoa.status, 0);
+
+  RTPSharedMemoryTransmitter a, b;
+  ASSERT_EQ(CreateTransmitter(a, btoa, atob, 100), 0);
+  ASSERT_EQ(CreateTransmitter(b, atob, btoa, 200), 0);
+
+  uint8_t data[12] = {0x80, 96, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+  ASSERT_EQ(a.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(b.Poll(), 0);
+  RTPRawPacket *held = b.GetNextPacket();
+  ASSERT_NE(held, nullptr);
+  EXPECT_NE(held->GetDataReleaser(), nullptr);
+
+  // 第一个数据包一直被持有，其间发送三倍于槽位数量的数据包
+  for (int seq = 1; seq <= 24; seq++) {
+    data[3] = (uint8_t)seq;
+    ASSERT_EQ(a.SendRTPData(data, sizeof(data)), 0) << "seq " << seq;
+    ASSERT_EQ(b.Poll(), 0);
+    RTPRawPacket *pack = b.GetNextPacket();
+    ASSERT_NE(pack, nullptr);
+    EXPECT_EQ(pack->GetData()[3], seq);
+    delete pack;
+  }
+  EXPECT_EQ(a.GetDroppedPackets(), 0u);
+  EXPECT_EQ(held->GetData()[3], 0);
+  delete held;
+}
+
+TEST(RTPSharedMemoryTransmitterTest, ReceivedPacketsReferenceTheRing) {
+  RingDescriptors atob, btoa;
+  ASSERT_EQ(atob.status, 0);
+  ASSERT_EQ(btoa.status, 0);
+
+  RTPSharedMemoryTransmitter a, b;
+  ASSERT_EQ(CreateTransmitter(a, btoa, atob, 100), 0);
+  ASSERT_EQ(CreateTransmitter(b, atob, btoa, 200), 0);
+  EXPECT_EQ(a.AddDestination(RTPEndpoint(INADDR_LOOPBACK, 5000)), MEDIA_RTP_ERR_OPERATION_FAILED);
+
+  // 没有数据时等待超时，写入数据包后eventfd唤醒等待
+  bool available = true;
+  ASSERT_EQ(b.WaitForIncomingData(RTPTime(0.01), &available), 0);
+  EXPECT_FALSE(available);
+
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  uint8_t rr[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+  ASSERT_EQ(a.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(a.SendRTCPData(rr, sizeof(rr)), 0);
+  ASSERT_EQ(b.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  EXPECT_TRUE(available);
+  ASSERT_EQ(b.Poll(), 0);
+
+  RTPRawPacket *pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_TRUE(pack->IsRTP());
+  EXPECT_NE(pack->GetDataReleaser(), nullptr);
+  EXPECT_EQ(memcmp(pack->GetData(), data, sizeof(data)), 0);
+  EXPECT_EQ(pack->GetSenderAddress()->GetRtpPort(), 100);
+  EXPECT_TRUE(a.ComesFromThisTransmitter(pack->GetSenderAddress()));
+  EXPECT_FALSE(b.ComesFromThisTransmitter(pack->GetSenderAddress()));
+
+  // RTPPacket 接管槽位，删除时交还给环
+  RTPPacket rtppack(*pack);
+  ASSERT_EQ(rtppack.GetCreationError(), 0);
+  EXPECT_EQ(pack->GetData(), nullptr);
+  delete pack;
+
+  pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_FALSE(pack->IsRTP());
+  delete pack;
+  EXPECT_EQ(b.GetNextPacket(), nullptr);
+
+  // 接收端销毁后，仍被持有的数据包保持映射有效
+  b.Destroy();
+  EXPECT_EQ(rtppack.GetSSRC(), 1u);
+  EXPECT_EQ(rtppack.GetSequenceNumber(), 1);
+}
+
+TEST(RTPSharedMemoryTransmitterTest, SessionsExchangePacketsAcrossProcesses) {
+  RingDescriptors parenttochild(256), childtoparent(256);
+  ASSERT_EQ(parenttochild.status, 0);
+  ASSERT_EQ(childtoparent.status, 0);
+
+  const int count = 100;
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+
+  if (pid == 0) {
+    // 子进程通过继承的描述符发送数据包，不运行任何gtest断言
+    RTPSession child;
+    RTPSessionParams sessparams;
+    sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+    sessparams.SetUsePollThread(false);
+    sessparams.SetCNAME("child@shm");
+
+    RTPSharedMemoryTransmissionParams transparams;
+    transparams.AddInboundRing(parenttochild.memfd, parenttochild.eventfd);
+    transparams.AddOutboundRing(childtoparent.memfd, childtoparent.eventfd);
+    if (child.Create(sessparams, &transparams, RTPTransmitter::SharedMemoryProto) < 0)
+      _exit(1);
+
+    uint8_t payload[100] = {0};
+    for (int i = 0; i < count; i++)
+      if (child.SendPacket(payload, sizeof(payload), 96, false, 3000) < 0)
+        _exit(2);
+    child.Destroy();
+    _exit(0);
+  }
+
+  RTPSession parent;
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+  sessparams.SetCNAME("parent@shm");
+
+  RTPSharedMemoryTransmissionParams transparams;
+  transparams.AddInboundRing(childtoparent.memfd, childtoparent.eventfd);
+  transparams.AddOutboundRing(parenttochild.memfd, parenttochild.eventfd);
+  ASSERT_EQ(parent.Create(sessparams, &transparams, RTPTransmitter::SharedMemoryProto), 0);
+
+  int received = 0;
+  RTPPacket *pack;
+  while ((pack = parent.WaitForNextPacket(RTPTime(1.0))) != nullptr) {
+    EXPECT_EQ(pack->GetPayloadLength(), 100u);
+    parent.DeletePacket(pack);
+    if (++received >= count - 1)
+      break;
+  }
+  EXPECT_GE(received, count - 1); // 新的源在验证期间可能保留第一个数据包
+
+  int status = -1;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  parent.Destroy();
+}
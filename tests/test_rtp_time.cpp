@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "utils/media_rtp_utils.h"
+
+TEST(RTPTimeTest, ConstructionAndAccessors) {
+  RTPTime t(12, 345678);
+  EXPECT_EQ(t.GetSeconds(), 12);
+  EXPECT_EQ(t.GetMicroSeconds(), 345678u);
+  EXPECT_EQ(t.GetNanoSeconds(), 12345678000);
+  EXPECT_DOUBLE_EQ(t.GetDouble(), 12.345678);
+
+  RTPTime n(-3, 250000);
+  EXPECT_EQ(n.GetSeconds(), -3);
+  EXPECT_EQ(n.GetMicroSeconds(), 250000u);
+  EXPECT_DOUBLE_EQ(n.GetDouble(), -3.25);
+
+  RTPTime d(0.0000015);
+  EXPECT_EQ(d.GetNanoSeconds(), 1500);
+  EXPECT_EQ(d.GetMicroSeconds(), 2u); // 四舍五入到微秒
+  EXPECT_TRUE(RTPTime(0.0).IsZero());
+  EXPECT_FALSE(RTPTime::FromNanoSeconds(1).IsZero());
+}
+
+TEST(RTPTimeTest, ArithmeticAndComparisonAreExact) {
+  RTPTime a(1700000000, 1);
+  RTPTime b = a;
+  b += RTPTime::FromNanoSeconds(1);
+  EXPECT_TRUE(a < b);
+  EXPECT_TRUE(b > a);
+  EXPECT_TRUE(a <= a);
+  EXPECT_TRUE(a >= a);
+
+  // 绝对时间之差不受浮点精度影响
+  b -= a;
+  EXPECT_EQ(b.GetNanoSeconds(), 1);
+}
+
+TEST(RTPTimeTest, NTPRoundTrip) {
+  RTPTime t(1700000000, 123456);
+  RTPNTPTime ntp = t.GetNTPTime();
+  EXPECT_EQ(ntp.GetMSW(), 1700000000u + RTP_NTPTIMEOFFSET);
+
+  RTPTime back(ntp);
+  EXPECT_LE(std::llabs(back.GetNanoSeconds() - t.GetNanoSeconds()), 1);
+
+  // NTP时间早于1970年时为零
+  EXPECT_TRUE(RTPTime(RTPNTPTime(1, 0)).IsZero());
+}
+
+TEST(RTPTimeTest, CurrentTimeTracksWallclockAndIsMonotonic) {
+  RTPTime t1 = RTPTime::CurrentTime();
+  double wall = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+  EXPECT_NEAR(t1.GetDouble(), wall, 0.5);
+
+  RTPTime prev = t1;
+  for (int i = 0; i < 1000; i++) {
+    RTPTime t = RTPTime::CurrentTime();
+    EXPECT_GE(t, prev);
+    prev = t;
+  }
+
+  int64_t wallns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::system_clock::now().time_since_epoch()).count();
+  RTPTime w = RTPTime::FromWallclock(wallns / 1000000000, (uint32_t)(wallns % 1000000000));
+  EXPECT_NEAR(w.GetDouble(), RTPTime::CurrentTime().GetDouble(), 0.01);
+}
+
+TEST(RTPTimeTest, BatchSharesClockReads) {
+  RTPTime outside = RTPTime::CurrentTime();
+  {
+    RTPTimeBatch batch(4);
+    RTPTime first = RTPTime::CurrentTime();
+    EXPECT_GE(first, outside);
+    RTPTime::Wait(RTPTime(0.002));
+    for (int i = 0; i < 3; i++)
+      EXPECT_EQ(RTPTime::CurrentTime().GetNanoSeconds(), first.GetNanoSeconds());
+
+    // 第五次调用重新读取时钟
+    RTPTime refreshed = RTPTime::CurrentTime();
+    EXPECT_GT(refreshed.GetNanoSeconds() - first.GetNanoSeconds(), 1000000);
+
+    {
+      RTPTimeBatch inner;
+      RTPTime::Wait(RTPTime(0.002));
+      EXPECT_GT(RTPTime::CurrentTime(), refreshed);
+    }
+    // 内层批次结束后恢复外层的缓存时间
+    EXPECT_EQ(RTPTime::CurrentTime().GetNanoSeconds(), refreshed.GetNanoSeconds());
+  }
+  RTPTime::Wait(RTPTime(0.001));
+  EXPECT_GT(RTPTime::CurrentTime(), outside);
+}
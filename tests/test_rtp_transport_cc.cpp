@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "core/media_rtp_transport_cc.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_errors.h"
+#include "test_utils.h"
+
+namespace {
+
+// 以250微秒为单位的到达时间
+RTPTime Ticks(int64_t ticks) {
+  int64_t us = 1000000000 + ticks * 250;
+  return RTPTime(us / 1000000, (uint32_t)(us % 1000000));
+}
+
+} // namespace
+
+TEST(RTPTransportCCTest, FeedbackRoundTripWithLossReorderAndLargeDeltas) {
+  RTPTransportCCRecorder rec;
+  EXPECT_FALSE(rec.HasPendingFeedback());
+
+  // 序列号跨越回绕；10 和 11 丢失；20 之后有一个较大的间隔；30 比前一个包更早到达
+  std::vector<int64_t> ticks(60, -1);
+  int64_t t = 100;
+  for (int i = 0; i < 60; i++) {
+    t += (i == 21) ? 2000 : 3;
+    if (i == 10 || i == 11)
+      continue;
+    ticks[i] = (i == 30) ? t - 20 : t;
+  }
+  for (int i = 0; i < 60; i++) {
+    if (ticks[i] >= 0)
+      rec.ProcessPacket((uint16_t)(65510 + i), Ticks(ticks[i]));
+  }
+  rec.ProcessPacket(65510 + 5, Ticks(9999)); // 重复的数据包被忽略
+  EXPECT_EQ(rec.GetNumPackets(), 58u);
+  ASSERT_TRUE(rec.HasPendingFeedback());
+
+  uint8_t fci[RTP_TRANSPORTCC_MAXFCISIZE];
+  size_t fcilen = 0;
+  ASSERT_EQ(rec.BuildFeedback(fci, 8, &fcilen), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  ASSERT_EQ(rec.BuildFeedback(fci, sizeof(fci), &fcilen), 0);
+  EXPECT_EQ(fcilen % 4, 0u);
+  EXPECT_FALSE(rec.HasPendingFeedback());
+
+  RTPTransportCCFeedback fb;
+  ASSERT_EQ(fb.Parse(fci, fcilen), 0);
+  EXPECT_EQ(fb.GetBaseSequenceNumber(), 65510);
+  EXPECT_EQ(fb.GetFeedbackPacketCount(), 0);
+  ASSERT_EQ(fb.GetPacketStatusCount(), 60);
+  for (int i = 0; i < 60; i++) {
+    ASSERT_EQ(fb.IsReceived(i), ticks[i] >= 0) << i;
+    if (ticks[i] >= 0) {
+      EXPECT_EQ(fb.GetArrivalTime(i) - fb.GetArrivalTime(0), (ticks[i] - ticks[0]) * 250) << i;
+    }
+  }
+
+  // 已报告的数据包晚到时不会再次报告
+  rec.ProcessPacket(65510 + 10, Ticks(5000));
+  EXPECT_FALSE(rec.HasPendingFeedback());
+
+  // 截断的反馈会被拒绝
+  EXPECT_EQ(fb.Parse(fci, 10), MEDIA_RTP_ERR_PROTOCOL_ERROR);
+  EXPECT_EQ(fb.GetPacketStatusCount(), 0);
+}
+
+TEST(RTPTransportCCTest, FeedbackIsSplitToFitMaximumSize) {
+  RTPTransportCCRecorder rec;
+
+  const int num = 1000;
+  for (int i = 0; i < num; i++) {
+    if (i % 50 == 7)
+      continue;
+    rec.ProcessPacket((uint16_t)(1000 + i), Ticks(i * 4));
+  }
+
+  uint8_t fci[64];
+  int total = 0;
+  int feedbacks = 0;
+  while (rec.HasPendingFeedback()) {
+    size_t fcilen;
+    ASSERT_EQ(rec.BuildFeedback(fci, sizeof(fci), &fcilen), 0);
+    ASSERT_LE(fcilen, sizeof(fci));
+
+    RTPTransportCCFeedback fb;
+    ASSERT_EQ(fb.Parse(fci, fcilen), 0);
+    EXPECT_EQ(fb.GetBaseSequenceNumber(), 1000 + total);
+    EXPECT_EQ(fb.GetFeedbackPacketCount(), (uint8_t)feedbacks);
+    for (int i = 0; i < fb.GetPacketStatusCount(); i++)
+      EXPECT_EQ(fb.IsReceived(i), (total + i) % 50 != 7);
+    total += fb.GetPacketStatusCount();
+    feedbacks++;
+  }
+  EXPECT_EQ(total, num);
+  EXPECT_GT(feedbacks, 1);
+  EXPECT_EQ(rec.GetNumFeedbacks(), (uint32_t)feedbacks);
+}
+
+TEST(RTPTransportCCTest, OneByteHeaderExtensionLookup) {
+  // 填充字节、ID 3（1字节）和 ID 5（2字节）
+  auto raw = BuildRTPRaw(false, 96, 1, 2, 3, {}, true, RTP_ONEBYTEHEADEREXTENSION_ID,
+                         {0x00, 0x30, 0xAA, 0x51, 0x12, 0x34, 0x00, 0x00}, {1, 2, 3});
+  RTPTime now(0, 0);
+  uint8_t *copy = new uint8_t[raw.size()];
+  memcpy(copy, raw.data(), raw.size());
+  RTPRawPacket rawpack(copy, raw.size(), nullptr, now, true);
+  RTPPacket pack(rawpack);
+  ASSERT_EQ(pack.GetCreationError(), 0);
+
+  const uint8_t *data;
+  size_t len;
+  ASSERT_TRUE(pack.GetOneByteExtensionElement(5, &data, &len));
+  ASSERT_EQ(len, 2u);
+  EXPECT_EQ((data[0] << 8) | data[1], 0x1234);
+  ASSERT_TRUE(pack.GetOneByteExtensionElement(3, &data, &len));
+  EXPECT_EQ(len, 1u);
+  EXPECT_EQ(data[0], 0xAA);
+  EXPECT_FALSE(pack.GetOneByteExtensionElement(7, &data, &len));
+}
@@ -0,0 +1,862 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+#include "transmitters/media_rtp_udpv6_transmitter.h"
+#include "packets/media_rtp_packet_buffer.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_endpoint.h"
+#include "utils/media_rtp_errors.h"
+
+namespace {
+
+// 绑定到回环地址的随机端口，返回套接字并将端口存入 \c port
+int CreateLoopbackSocket(uint16_t *port) {
+  int sock = socket(PF_INET, SOCK_DGRAM, 0);
+  if (sock < 0)
+    return -1;
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrlen = sizeof(addr);
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      getsockname(sock, (struct sockaddr *)&addr, &addrlen) != 0) {
+    close(sock);
+    return -1;
+  }
+  *port = ntohs(addr.sin_port);
+  return sock;
+}
+
+// 发送一个数据包，等待 \c delay 后再轮询，返回接收时间与轮询时间之差（秒）
+double MeasureReceiveLag(bool kerneltimestamps, const RTPTime &delay) {
+  uint16_t port = 0;
+  int sock = CreateLoopbackSocket(&port);
+  EXPECT_GE(sock, 0);
+
+  RTPUDPv4TransmissionParams params;
+  params.SetUseExistingSockets(sock, sock);
+  params.SetUseKernelReceiveTimestamps(kerneltimestamps);
+
+  RTPUDPv4Transmitter trans;
+  EXPECT_EQ(trans.Init(false), 0);
+  EXPECT_EQ(trans.Create(1400, &params), 0);
+  EXPECT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+
+  // RTP 版本2、负载类型96的最小数据包
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+  EXPECT_EQ(trans.SendRTPData(data, sizeof(data)), 0);
+
+  RTPTime::Wait(delay);
+  RTPTime polltime = RTPTime::CurrentTime();
+  EXPECT_EQ(trans.Poll(), 0);
+
+  RTPRawPacket *pack = trans.GetNextPacket();
+  double lag = -1;
+  EXPECT_NE(pack, nullptr);
+  if (pack != nullptr) {
+    EXPECT_EQ(pack->GetDataLength(), sizeof(data));
+    lag = polltime.GetDouble() - pack->GetReceiveTime().GetDouble();
+    delete pack;
+  }
+
+  trans.Destroy();
+  close(sock);
+  return lag;
+}
+
+} // namespace
+
+TEST(RTPUDPTransmitterTest, ReceiveTimeUsesKernelTimestamp) {
+#ifdef RTP_SUPPORT_SO_TIMESTAMPNS
+  // 内核在第一次启用时间戳时延迟打开全局开关，之前到达的数据包的时间戳在读取时才生成，
+  // 所以先预热一次
+  MeasureReceiveLag(true, RTPTime(0.01));
+
+  // 内核时间戳记录的是数据包到达套接字的时间，不受轮询延迟的影响
+  double lag = MeasureReceiveLag(true, RTPTime(0.05));
+  EXPECT_GT(lag, 0.04);
+  EXPECT_LT(lag, 1.0);
+#else
+  GTEST_SKIP() << "SO_TIMESTAMPNS not supported";
+#endif // RTP_SUPPORT_SO_TIMESTAMPNS
+}
+
+TEST(RTPUDPTransmitterTest, ReceiveTimeFallsBackToPollTime) {
+  double lag = MeasureReceiveLag(false, RTPTime(0.05));
+  EXPECT_LE(lag, 0.0);
+  EXPECT_GT(lag, -0.5);
+}
+
+TEST(RTPUDPTransmitterTest, TransmitTimestampsAreCollected) {
+#ifdef RTP_SUPPORT_SO_TIMESTAMPING
+  uint16_t port = 0;
+  int sock = CreateLoopbackSocket(&port);
+  ASSERT_GE(sock, 0);
+
+  RTPUDPv4TransmissionParams params;
+  params.SetUseExistingSockets(sock, sock);
+  params.SetUseKernelTransmitTimestamps(true);
+
+  RTPUDPv4Transmitter trans;
+  ASSERT_EQ(trans.Init(false), 0);
+  ASSERT_EQ(trans.Create(1400, &params), 0);
+  ASSERT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+
+  RTPTime before = RTPTime::CurrentTime();
+  for (int i = 0; i < 3; i++) {
+    // SSRC 0x11223344，时间戳 1000+i
+    uint8_t data[12] = {0x80, 96, 0, (uint8_t)i, 0, 0, 0x03, (uint8_t)(0xE8 + i), 0x11, 0x22, 0x33, 0x44};
+    ASSERT_EQ(trans.SendRTPData(data, sizeof(data)), 0);
+  }
+  // 多路复用的RTCP数据包也占用一个编号，但不产生时间戳
+  uint8_t rtcp[8] = {0x80, 201, 0, 1, 0x11, 0x22, 0x33, 0x44};
+  ASSERT_EQ(trans.SendRTCPData(rtcp, sizeof(rtcp)), 0);
+  uint8_t data[12] = {0x80, 96, 0, 3, 0, 0, 0x07, 0xD0, 0x11, 0x22, 0x33, 0x44};
+  ASSERT_EQ(trans.SendRTPData(data, sizeof(data)), 0);
+  RTPTime after = RTPTime::CurrentTime();
+
+  uint32_t ssrc, rtptimestamp;
+  RTPTime sendtime(0);
+  std::vector<uint32_t> timestamps;
+  for (int attempt = 0; attempt < 100 && timestamps.size() < 4; attempt++) {
+    ASSERT_EQ(trans.Poll(), 0);
+    while (trans.GetNextTransmitTimestamp(&ssrc, &rtptimestamp, &sendtime)) {
+      EXPECT_EQ(ssrc, 0x11223344u);
+      EXPECT_GE(sendtime.GetDouble(), before.GetDouble() - 0.001);
+      EXPECT_LE(sendtime.GetDouble(), after.GetDouble() + 0.001);
+      timestamps.push_back(rtptimestamp);
+    }
+    if (timestamps.size() < 4)
+      RTPTime::Wait(RTPTime(0.001));
+  }
+  EXPECT_EQ(timestamps, (std::vector<uint32_t>{1000, 1001, 1002, 2000}));
+
+  // 发往本地的数据包也被正常接收
+  int received = 0;
+  RTPRawPacket *pack;
+  while ((pack = trans.GetNextPacket()) != nullptr) {
+    received++;
+    delete pack;
+  }
+  EXPECT_EQ(received, 5);
+
+  trans.Destroy();
+  close(sock);
+#else
+  GTEST_SKIP() << "SO_TIMESTAMPING not supported";
+#endif // RTP_SUPPORT_SO_TIMESTAMPING
+}
+
+TEST(RTPUDPTransmitterTest, ReceiveShardsKeepPerSSRCOrder) {
+  RTPUDPv4TransmissionParams params;
+  params.SetReceiveShards(4);
+  params.SetPortbase(0);
+
+  // 重用端口组只能在固定端口上创建
+  {
+    RTPUDPv4Transmitter trans;
+    ASSERT_EQ(trans.Init(true), 0);
+    EXPECT_EQ(trans.Create(1400, &params), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  }
+
+  uint16_t port = 0;
+  int probe = CreateLoopbackSocket(&port);
+  ASSERT_GE(probe, 0);
+  close(probe);
+
+  params.SetPortbase(port);
+  params.SetAllowOddPortbase(true);
+  params.SetRTCPMultiplexing(true);
+  params.SetBindIP(INADDR_LOOPBACK);
+  params.SetRTPReceiveBuffer(1 << 20);
+
+  RTPUDPv4Transmitter trans;
+  ASSERT_EQ(trans.Init(true), 0);
+  ASSERT_EQ(trans.Create(1400, &params), 0);
+
+  // 有SSRC选择程序时从多个源端口发送，同一SSRC的数据包仍由同一个线程接收
+#ifdef RTP_SUPPORT_REUSEPORT_CBPF
+  const int numsenders = 3;
+#else
+  const int numsenders = 1;
+#endif // RTP_SUPPORT_REUSEPORT_CBPF
+  std::vector<int> senders;
+  for (int i = 0; i < numsenders; i++) {
+    uint16_t senderport;
+    senders.push_back(CreateLoopbackSocket(&senderport));
+    ASSERT_GE(senders.back(), 0);
+  }
+
+  struct sockaddr_in dest;
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  dest.sin_port = htons(port);
+
+  const int numssrcs = 8;
+  const int numpackets = 100;
+  for (int seq = 0; seq < numpackets; seq++) {
+    for (int s = 0; s < numssrcs; s++) {
+      uint8_t data[12] = {0x80, 96, (uint8_t)(seq >> 8), (uint8_t)seq, 0, 0, 0, 0, 0x10, 0x20, 0x30, (uint8_t)(0x40 + s)};
+      int sock = senders[(seq + s) % numsenders];
+      ASSERT_EQ(sendto(sock, data, sizeof(data), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)sizeof(data));
+    }
+    if (seq % 10 == 9)
+      RTPTime::Wait(RTPTime(0.002));
+  }
+
+  std::vector<int> nextseq(numssrcs, 0);
+  int received = 0;
+  for (int attempt = 0; attempt < 200 && received < numssrcs * numpackets; attempt++) {
+    bool available = false;
+    ASSERT_EQ(trans.WaitForIncomingData(RTPTime(0.01), &available), 0);
+    ASSERT_EQ(trans.Poll(), 0);
+
+    RTPRawPacket *pack;
+    while ((pack = trans.GetNextPacket()) != nullptr) {
+      const uint8_t *p = pack->GetData();
+      int s = p[11] - 0x40;
+      int seq = (p[2] << 8) | p[3];
+      EXPECT_TRUE(pack->IsRTP());
+      ASSERT_GE(s, 0);
+      ASSERT_LT(s, numssrcs);
+      EXPECT_EQ(seq, nextseq[s]) << "ssrc " << s;
+      nextseq[s] = seq + 1;
+      received++;
+      delete pack;
+    }
+  }
+  EXPECT_EQ(received, numssrcs * numpackets);
+  EXPECT_EQ(trans.GetReceiveQueueDroppedPackets(), 0u);
+  EXPECT_GT(trans.GetReceiveQueueHighWaterMark(), 0u);
+
+  trans.Destroy();
+  for (size_t i = 0; i < senders.size(); i++)
+    close(senders[i]);
+}
+
+TEST(RTPUDPTransmitterTest, ReceiveShardsDeliverMulticastOnce) {
+  uint16_t port = 0;
+  int probe = CreateLoopbackSocket(&port);
+  ASSERT_GE(probe, 0);
+  close(probe);
+
+  // 多播数据包只能由绑定在任意地址上的套接字接收
+  RTPUDPv4TransmissionParams params;
+  params.SetReceiveShards(4);
+  params.SetPortbase(port);
+  params.SetAllowOddPortbase(true);
+  params.SetRTCPMultiplexing(true);
+
+  RTPUDPv4Transmitter trans;
+  ASSERT_EQ(trans.Init(true), 0);
+  ASSERT_EQ(trans.Create(1400, &params), 0);
+
+  const uint32_t group = 0xEFFF2A01; // 239.255.42.1
+  if (trans.JoinMulticastGroup(RTPEndpoint(group, port)) < 0) {
+    trans.Destroy();
+    GTEST_SKIP() << "no multicast route";
+  }
+
+  int sock = socket(PF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(sock, 0);
+  struct sockaddr_in dest;
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_addr.s_addr = htonl(group);
+  dest.sin_port = htons(port);
+
+  // 不同的SSRC会被选择程序分配给不同的线程
+  const int numpackets = 40;
+  for (int i = 0; i < numpackets; i++) {
+    uint8_t data[12] = {0x80, 96, 0, (uint8_t)i, 0, 0, 0, 0, 0, 0, 0, (uint8_t)i};
+    ASSERT_EQ(sendto(sock, data, sizeof(data), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)sizeof(data));
+  }
+  close(sock);
+  RTPTime::Wait(RTPTime(0.05));
+
+  std::vector<int> count(numpackets, 0);
+  int received = 0;
+  for (int attempt = 0; attempt < 50; attempt++) {
+    bool available = false;
+    ASSERT_EQ(trans.WaitForIncomingData(RTPTime(0.01), &available), 0);
+    ASSERT_EQ(trans.Poll(), 0);
+
+    RTPRawPacket *pack;
+    while ((pack = trans.GetNextPacket()) != nullptr) {
+      int i = pack->GetData()[11];
+      ASSERT_LT(i, numpackets);
+      count[i]++;
+      received++;
+      delete pack;
+    }
+  }
+  EXPECT_EQ(received, numpackets);
+  for (int i = 0; i < numpackets; i++) {
+    EXPECT_EQ(count[i], 1) << "packet " << i;
+  }
+#ifdef RTP_SUPPORT_REUSEPORT_CBPF
+  // 多播数据包也按SSRC分散到四个线程，每个线程的队列中最多积压四分之一
+  EXPECT_EQ(trans.GetReceiveQueueHighWaterMark(), (size_t)numpackets / 4);
+#endif // RTP_SUPPORT_REUSEPORT_CBPF
+
+  trans.Destroy();
+}
+
+TEST(RTPUDPTransmitterTest, ReceiveShardsPinToCPUs) {
+  uint16_t port = 0;
+  int probe = CreateLoopbackSocket(&port);
+  ASSERT_GE(probe, 0);
+  close(probe);
+
+  RTPUDPv4TransmissionParams params;
+  params.SetReceiveShards(2);
+  params.SetPortbase(port);
+  params.SetAllowOddPortbase(true);
+  params.SetRTCPMultiplexing(true);
+  params.SetBindIP(INADDR_LOOPBACK);
+
+  // 无效的CPU编号使创建失败，之后可以用有效的编号重新创建
+  RTPUDPv4Transmitter trans;
+  ASSERT_EQ(trans.Init(true), 0);
+  params.SetReceiveShardCPUs(std::vector<int>{-1});
+  EXPECT_LT(trans.Create(1400, &params), 0);
+
+  params.SetReceiveShardCPUs(std::vector<int>{0});
+#ifdef RTP_HAVE_PTHREAD_SETAFFINITY
+  ASSERT_EQ(trans.Create(1400, &params), 0);
+  ASSERT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  ASSERT_EQ(trans.SendRTPData(data, sizeof(data)), 0);
+  bool available = false;
+  ASSERT_EQ(trans.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  EXPECT_TRUE(available);
+  ASSERT_EQ(trans.Poll(), 0);
+  RTPRawPacket *pack = trans.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  delete pack;
+  trans.Destroy();
+#else
+  EXPECT_LT(trans.Create(1400, &params), 0);
+#endif // RTP_HAVE_PTHREAD_SETAFFINITY
+}
+
+TEST(RTPUDPTransmitterTest, PollAndGetNextPacketRunOnDifferentThreads) {
+  uint16_t port = 0;
+  int sock = CreateLoopbackSocket(&port);
+  ASSERT_GE(sock, 0);
+
+  RTPUDPv4TransmissionParams params;
+  params.SetUseExistingSockets(sock, sock);
+
+  RTPUDPv4Transmitter trans;
+  ASSERT_EQ(trans.Init(true), 0);
+  ASSERT_EQ(trans.Create(1400, &params), 0);
+  ASSERT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+
+  // 一个线程读取套接字，另一个线程同时取数据包，数据包保持到达顺序
+  const int numpackets = 500;
+  std::atomic<bool> stop(false);
+  std::thread poller([&trans, &stop]() {
+    while (!stop) {
+      trans.WaitForIncomingData(RTPTime(0.01));
+      EXPECT_EQ(trans.Poll(), 0);
+    }
+  });
+  std::thread sender([&trans, numpackets]() {
+    for (int seq = 0; seq < numpackets; seq++) {
+      uint8_t data[12] = {0x80, 96, (uint8_t)(seq >> 8), (uint8_t)seq, 0, 0, 0, 0, 0, 0, 0, 1};
+      EXPECT_EQ(trans.SendRTPData(data, sizeof(data)), 0);
+      if (seq % 10 == 9)
+        RTPTime::Wait(RTPTime(0.001));
+    }
+  });
+
+  int received = 0;
+  RTPTime deadline = RTPTime::CurrentTime();
+  deadline += RTPTime(5.0);
+  while (received < numpackets && RTPTime::CurrentTime() < deadline) {
+    RTPRawPacket *pack = trans.GetNextPacket();
+    if (pack == nullptr) {
+      RTPTime::Wait(RTPTime(0.0005));
+      continue;
+    }
+    EXPECT_EQ((pack->GetData()[2] << 8) | pack->GetData()[3], received);
+    received++;
+    delete pack;
+  }
+  sender.join();
+  stop = true;
+  trans.AbortWait();
+  poller.join();
+  EXPECT_EQ(received, numpackets);
+
+  trans.Destroy();
+  close(sock);
+}
+
+namespace {
+
+// 在回环地址上创建传输器，\c rtcpmux 为 false 时使用两个相邻的端口
+int CreateRingTransmitter(RTPUDPv4Transmitter &trans, RTPIoUring *ring, bool rtcpmux, uint16_t *port) {
+  int probe = CreateLoopbackSocket(port);
+  if (probe < 0)
+    return -1;
+  close(probe);
+
+  RTPUDPv4TransmissionParams params;
+  params.SetPortbase(*port);
+  params.SetAllowOddPortbase(true);
+  params.SetRTCPMultiplexing(rtcpmux);
+  params.SetBindIP(INADDR_LOOPBACK);
+  params.SetIoUring(ring);
+
+  int status = trans.Init(true);
+  if (status < 0)
+    return status;
+  return trans.Create(1400, &params);
+}
+
+// 等待并轮询，直到收到 \c count 个数据包，返回按到达顺序排列的数据包
+std::vector<RTPRawPacket *> ReceivePackets(RTPTransmitter &trans, size_t count) {
+  std::vector<RTPRawPacket *> packets;
+  for (int attempt = 0; attempt < 200 && packets.size() < count; attempt++) {
+    EXPECT_EQ(trans.WaitForIncomingData(RTPTime(0.01)), 0);
+    EXPECT_EQ(trans.Poll(), 0);
+
+    RTPRawPacket *pack;
+    while ((pack = trans.GetNextPacket()) != nullptr)
+      packets.push_back(pack);
+  }
+  return packets;
+}
+
+} // namespace
+
+TEST(RTPUDPTransmitterTest, IoUringSharedBetweenTransmitters) {
+  RTPIoUring ring;
+  if (ring.Init() < 0)
+    GTEST_SKIP() << "io_uring is not available";
+
+  RTPUDPv4Transmitter a, b;
+  uint16_t porta = 0, portb = 0;
+  ASSERT_EQ(CreateRingTransmitter(a, &ring, false, &porta), 0);
+  ASSERT_EQ(CreateRingTransmitter(b, &ring, true, &portb), 0);
+  EXPECT_TRUE(a.IsUsingIoUring());
+  EXPECT_TRUE(b.IsUsingIoUring());
+
+  std::vector<int> descriptors;
+  ASSERT_EQ(a.GetReceiveDescriptors(descriptors), 0);
+  EXPECT_EQ(descriptors.size(), 2u);
+
+  ASSERT_EQ(a.AddDestination(RTPEndpoint(INADDR_LOOPBACK, portb, portb)), 0);
+  ASSERT_EQ(b.AddDestination(RTPEndpoint(INADDR_LOOPBACK, porta, porta + 1)), 0);
+
+  // 复用的套接字上RTP和RTCP按负载类型区分，数据包保持发送顺序
+  const int numpackets = 50;
+  for (int seq = 0; seq < numpackets; seq++) {
+    uint8_t data[12] = {0x80, 96, 0, (uint8_t)seq, 0, 0, 0, 0, 0, 0, 0, 1};
+    ASSERT_EQ(a.SendRTPData(data, sizeof(data)), 0);
+  }
+  uint8_t rr[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+  ASSERT_EQ(a.SendRTCPData(rr, sizeof(rr)), 0);
+
+  std::vector<RTPRawPacket *> packets = ReceivePackets(b, numpackets + 1);
+  ASSERT_EQ(packets.size(), (size_t)numpackets + 1);
+  for (int seq = 0; seq < numpackets; seq++) {
+    EXPECT_TRUE(packets[seq]->IsRTP());
+    EXPECT_EQ(packets[seq]->GetData()[3], seq);
+    EXPECT_EQ(packets[seq]->GetSenderAddress()->GetRtpPort(), porta);
+  }
+  EXPECT_FALSE(packets[numpackets]->IsRTP());
+  EXPECT_EQ(packets[numpackets]->GetSenderAddress()->GetRtpPort(), porta + 1);
+  for (size_t i = 0; i < packets.size(); i++)
+    delete packets[i];
+
+  // 另一个传输器取走了完成事件时，数据报仍然会唤醒它的所有者
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 2};
+  ASSERT_EQ(b.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(b.SendRTCPData(rr, sizeof(rr)), 0);
+  RTPTime::Wait(RTPTime(0.01));
+  ASSERT_EQ(b.Poll(), 0);
+  EXPECT_EQ(b.GetNextPacket(), nullptr);
+
+  bool available = false;
+  ASSERT_EQ(a.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  EXPECT_TRUE(available);
+  packets = ReceivePackets(a, 2);
+  ASSERT_EQ(packets.size(), 2u);
+  EXPECT_TRUE(packets[0]->IsRTP());
+  EXPECT_FALSE(packets[1]->IsRTP());
+  for (size_t i = 0; i < packets.size(); i++)
+    delete packets[i];
+  EXPECT_EQ(ring.GetDroppedDatagrams(), 0u);
+  EXPECT_EQ(ring.GetSendErrors(), 0u);
+  EXPECT_EQ(ring.GetReceiveArmFailures(), 0u);
+
+  a.Destroy();
+  b.Destroy();
+  ring.Destroy();
+}
+
+TEST(RTPUDPTransmitterTest, IoUringWakesOnlyTheOwner) {
+  RTPIoUring ring;
+  if (ring.Init() < 0)
+    GTEST_SKIP() << "io_uring is not available";
+
+  RTPUDPv4Transmitter a, b;
+  uint16_t porta = 0, portb = 0;
+  ASSERT_EQ(CreateRingTransmitter(a, &ring, true, &porta), 0);
+  ASSERT_EQ(CreateRingTransmitter(b, &ring, true, &portb), 0);
+  ASSERT_EQ(a.AddDestination(RTPEndpoint(INADDR_LOOPBACK, portb, portb)), 0);
+
+  // 发给 b 的数据报不会唤醒等待中的 a，即使没有传输器取完成事件
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  ASSERT_EQ(a.SendRTPData(data, sizeof(data)), 0);
+  bool available = true;
+  ASSERT_EQ(a.WaitForIncomingData(RTPTime(0.2), &available), 0);
+  EXPECT_FALSE(available);
+
+  available = false;
+  ASSERT_EQ(b.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  EXPECT_TRUE(available);
+  std::vector<RTPRawPacket *> packets = ReceivePackets(b, 1);
+  ASSERT_EQ(packets.size(), 1u);
+  EXPECT_EQ(packets[0]->GetData()[3], 1);
+  delete packets[0];
+
+  a.Destroy();
+  b.Destroy();
+  ring.Destroy();
+}
+
+TEST(RTPUDPTransmitterTest, IoUringDestroyCancelsReceives) {
+  RTPIoUring ring;
+  if (ring.Init() < 0)
+    GTEST_SKIP() << "io_uring is not available";
+
+  uint16_t port = 0, senderport = 0;
+  int sock = CreateLoopbackSocket(&port);
+  int sender = CreateLoopbackSocket(&senderport);
+  ASSERT_GE(sock, 0);
+  ASSERT_GE(sender, 0);
+  int ready = -1;
+  ASSERT_EQ(ring.AddSocket(sock, sizeof(struct sockaddr_in), &ready), 0);
+
+  struct sockaddr_in dest;
+  memset(&dest, 0, sizeof(dest));
+  dest.sin_family = AF_INET;
+  dest.sin_port = htons(port);
+  dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  uint8_t data[4] = {1, 2, 3, 4};
+  ASSERT_EQ(sendto(sender, data, sizeof(data), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)sizeof(data));
+  RTPTime::Wait(RTPTime(0.01));
+
+  // 销毁时接收请求已经结束，之后的数据报留在套接字中
+  ring.Destroy();
+  EXPECT_FALSE(ring.IsInitialized());
+  data[0] = 5;
+  ASSERT_EQ(sendto(sender, data, sizeof(data), 0, (struct sockaddr *)&dest, sizeof(dest)), (ssize_t)sizeof(data));
+  struct timeval tv = {1, 0};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  uint8_t buf[16];
+  ASSERT_EQ(recv(sock, buf, sizeof(buf), 0), (ssize_t)sizeof(data));
+  EXPECT_EQ(buf[0], 5);
+
+  // 环可以重新初始化
+  ASSERT_EQ(ring.Init(), 0);
+  ring.Destroy();
+  close(sock);
+  close(sender);
+}
+
+TEST(RTPUDPTransmitterTest, IoUringFallsBackToSocketCalls) {
+  // 未初始化的环被忽略，传输器照常使用套接字调用
+  RTPIoUring ring;
+  RTPUDPv4Transmitter trans;
+  uint16_t port = 0;
+  ASSERT_EQ(CreateRingTransmitter(trans, &ring, true, &port), 0);
+  EXPECT_FALSE(trans.IsUsingIoUring());
+  ASSERT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, port, port)), 0);
+
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+  ASSERT_EQ(trans.SendRTPData(data, sizeof(data)), 0);
+  std::vector<RTPRawPacket *> packets = ReceivePackets(trans, 1);
+  ASSERT_EQ(packets.size(), 1u);
+  EXPECT_EQ(packets[0]->GetDataLength(), sizeof(data));
+  delete packets[0];
+
+  trans.Destroy();
+}
+
+#ifdef RTP_SUPPORT_IPV6
+
+namespace {
+
+// 在通配地址上创建双栈传输器，使用从 \c *port 开始的一对空闲端口，
+// RTP数据由 \c numshards 个线程接收或通过 \c ring 接收
+int CreateDualStackTransmitter(RTPUDPv6Transmitter &trans, uint16_t *port, RTPIoUring *ring = nullptr,
+                               int numshards = 1) {
+  int probe = CreateLoopbackSocket(port);
+  if (probe < 0)
+    return -1;
+  close(probe);
+
+  int status = trans.Init(false);
+  if (status < 0)
+    return status;
+  for (int attempt = 0; attempt < 20; attempt++) {
+    RTPUDPv6TransmissionParams params;
+    *port = (uint16_t)((*port & ~1) + 2 * attempt);
+    params.SetPortbase(*port);
+    params.SetDualStack(true);
+    params.SetIoUring(ring);
+    params.SetReceiveShards(numshards);
+    params.SetRTPReceiveBuffer(1 << 20);
+    if ((status = trans.Create(1400, &params)) >= 0)
+      return status;
+  }
+  return status;
+}
+
+// 绑定到IPv6回环地址的随机端口，系统不支持IPv6时返回负值
+int CreateIPv6LoopbackSocket() {
+  int sock = socket(PF_INET6, SOCK_DGRAM, 0);
+  if (sock < 0)
+    return -1;
+
+  struct sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_loopback;
+  if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+} // namespace
+
+TEST(RTPUDPTransmitterTest, DualStackServesIPv4Peers) {
+  RTPUDPv6Transmitter dual;
+  uint16_t dualport = 0;
+  if (CreateDualStackTransmitter(dual, &dualport) < 0)
+    GTEST_SKIP() << "dual-stack sockets are not available";
+
+  RTPUDPv4Transmitter peer;
+  uint16_t peerport = 0;
+  ASSERT_EQ(CreateRingTransmitter(peer, nullptr, false, &peerport), 0);
+
+  // IPv4目的地址通过同一个IPv6套接字发送，接收端看到的是IPv4源地址
+  ASSERT_EQ(dual.AddDestination(RTPEndpoint(INADDR_LOOPBACK, peerport, peerport + 1)), 0);
+  EXPECT_EQ(dual.AddDestination(RTPEndpoint(INADDR_LOOPBACK, peerport, peerport + 1)), MEDIA_RTP_ERR_INVALID_STATE);
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+  uint8_t rr[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+  ASSERT_EQ(dual.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(dual.SendRTCPData(rr, sizeof(rr)), 0);
+
+  std::vector<RTPRawPacket *> packets = ReceivePackets(peer, 2);
+  ASSERT_EQ(packets.size(), 2u);
+  for (size_t i = 0; i < packets.size(); i++) {
+    const RTPEndpoint *sender = packets[i]->GetSenderAddress();
+    ASSERT_EQ(sender->GetType(), RTPEndpoint::IPv4);
+    EXPECT_EQ(sender->GetIPv4(), (uint32_t)INADDR_LOOPBACK);
+    EXPECT_EQ(sender->GetRtpPort(), packets[i]->IsRTP() ? dualport : dualport + 1);
+    delete packets[i];
+  }
+
+  // 来自IPv4发送端的数据包的源地址恢复为IPv4端点
+  ASSERT_EQ(peer.AddDestination(RTPEndpoint(INADDR_LOOPBACK, dualport, dualport + 1)), 0);
+  ASSERT_EQ(peer.SendRTPData(data, sizeof(data)), 0);
+  packets = ReceivePackets(dual, 1);
+  ASSERT_EQ(packets.size(), 1u);
+  ASSERT_EQ(packets[0]->GetSenderAddress()->GetType(), RTPEndpoint::IPv4);
+  EXPECT_EQ(packets[0]->GetSenderAddress()->GetIPv4(), (uint32_t)INADDR_LOOPBACK);
+  EXPECT_EQ(packets[0]->GetSenderAddress()->GetRtpPort(), peerport);
+  EXPECT_NE(dynamic_cast<RTPPacketBuffer *>(packets[0]->GetDataReleaser()), nullptr);
+  delete packets[0];
+  RTPEndpoint self(INADDR_LOOPBACK, dualport);
+  EXPECT_TRUE(dual.ComesFromThisTransmitter(&self));
+
+  // 忽略列表同样接受IPv4端点
+  ASSERT_EQ(dual.SetReceiveMode(RTPTransmitter::IgnoreSome), 0);
+  ASSERT_EQ(dual.AddToIgnoreList(RTPEndpoint(INADDR_LOOPBACK, peerport)), 0);
+  ASSERT_EQ(peer.SendRTPData(data, sizeof(data)), 0);
+  RTPTime::Wait(RTPTime(0.05));
+  ASSERT_EQ(dual.Poll(), 0);
+  EXPECT_EQ(dual.GetNextPacket(), nullptr);
+
+  ASSERT_EQ(dual.DeleteDestination(RTPEndpoint(INADDR_LOOPBACK, peerport, peerport + 1)), 0);
+  dual.Destroy();
+  peer.Destroy();
+}
+
+TEST(RTPUDPTransmitterTest, IPv6OnlyRejectsIPv4Endpoints) {
+  RTPUDPv6Transmitter trans;
+  RTPUDPv6TransmissionParams params;
+  uint16_t port = 0;
+  int probe = CreateLoopbackSocket(&port);
+  ASSERT_GE(probe, 0);
+  close(probe);
+  params.SetPortbase(port & ~1);
+  ASSERT_EQ(trans.Init(false), 0);
+  if (trans.Create(1400, &params) < 0)
+    GTEST_SKIP() << "IPv6 sockets are not available";
+
+  EXPECT_EQ(trans.AddDestination(RTPEndpoint(INADDR_LOOPBACK, 5000)), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  RTPEndpoint self(INADDR_LOOPBACK, port & ~1);
+  EXPECT_FALSE(trans.ComesFromThisTransmitter(&self));
+  trans.Destroy();
+}
+
+TEST(RTPUDPTransmitterTest, DualStackReceiveShardsServeBothFamilies) {
+  // 重用端口组只能在固定端口上创建，也不能同时通过 io_uring 接收
+  {
+    RTPUDPv6TransmissionParams params;
+    RTPUDPv6Transmitter trans;
+    RTPIoUring ring;
+    params.SetReceiveShards(2);
+    params.SetPortbase(0);
+    ASSERT_EQ(trans.Init(false), 0);
+    EXPECT_EQ(trans.Create(1400, &params), MEDIA_RTP_ERR_INVALID_PARAMETER);
+    params.SetPortbase(5000);
+    params.SetIoUring(&ring);
+    EXPECT_EQ(trans.Create(1400, &params), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  }
+
+  RTPUDPv6Transmitter dual;
+  uint16_t dualport = 0;
+  if (CreateDualStackTransmitter(dual, &dualport, nullptr, 4) < 0)
+    GTEST_SKIP() << "dual-stack reuse-port sockets are not available";
+  EXPECT_FALSE(dual.IsUsingIoUring());
+
+  uint16_t v4port = 0;
+  int v4sock = CreateLoopbackSocket(&v4port);
+  ASSERT_GE(v4sock, 0);
+  int v6sock = CreateIPv6LoopbackSocket();
+
+  struct sockaddr_in dest4;
+  memset(&dest4, 0, sizeof(dest4));
+  dest4.sin_family = AF_INET;
+  dest4.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  dest4.sin_port = htons(dualport);
+  struct sockaddr_in6 dest6;
+  memset(&dest6, 0, sizeof(dest6));
+  dest6.sin6_family = AF_INET6;
+  dest6.sin6_addr = in6addr_loopback;
+  dest6.sin6_port = htons(dualport);
+
+  // 两个地址族的发送端各自使用一组SSRC，每个SSRC的数据包按顺序到达
+  const int numssrcs = 8;
+  const int numpackets = 50;
+  int expected = 0;
+  for (int seq = 0; seq < numpackets; seq++) {
+    for (int s = 0; s < numssrcs; s++) {
+      uint8_t data[12] = {0x80, 96, 0, (uint8_t)seq, 0, 0, 0, 0, 0x10, 0x20, 0x30, (uint8_t)(0x40 + s)};
+      if (s % 2 == 0)
+        ASSERT_EQ(sendto(v4sock, data, sizeof(data), 0, (struct sockaddr *)&dest4, sizeof(dest4)), (ssize_t)sizeof(data));
+      else if (v6sock >= 0)
+        ASSERT_EQ(sendto(v6sock, data, sizeof(data), 0, (struct sockaddr *)&dest6, sizeof(dest6)), (ssize_t)sizeof(data));
+      else
+        continue;
+      expected++;
+    }
+    if (seq % 10 == 9)
+      RTPTime::Wait(RTPTime(0.002));
+  }
+
+  std::vector<RTPRawPacket *> packets = ReceivePackets(dual, expected);
+  ASSERT_EQ(packets.size(), (size_t)expected);
+  std::vector<int> nextseq(numssrcs, 0);
+  for (size_t i = 0; i < packets.size(); i++) {
+    int s = packets[i]->GetData()[11] - 0x40;
+    ASSERT_GE(s, 0);
+    ASSERT_LT(s, numssrcs);
+    EXPECT_EQ(packets[i]->GetData()[3], nextseq[s]) << "ssrc " << s;
+    nextseq[s]++;
+    EXPECT_EQ(packets[i]->GetSenderAddress()->GetType(), (s % 2 == 0) ? RTPEndpoint::IPv4 : RTPEndpoint::IPv6);
+    EXPECT_NE(dynamic_cast<RTPPacketBuffer *>(packets[i]->GetDataReleaser()), nullptr);
+    delete packets[i];
+  }
+  EXPECT_EQ(dual.GetReceiveQueueDroppedPackets(), 0u);
+  EXPECT_GT(dual.GetReceiveQueueHighWaterMark(), 0u);
+
+  // 接受列表中的IPv4端点同样作用于接收线程收到的数据包
+  ASSERT_EQ(dual.SetReceiveMode(RTPTransmitter::AcceptSome), 0);
+  ASSERT_EQ(dual.AddToAcceptList(RTPEndpoint(INADDR_LOOPBACK, v4port)), 0);
+  uint8_t data[12] = {0x80, 96, 0, 99, 0, 0, 0, 0, 0x10, 0x20, 0x30, 0x40};
+  ASSERT_EQ(sendto(v4sock, data, sizeof(data), 0, (struct sockaddr *)&dest4, sizeof(dest4)), (ssize_t)sizeof(data));
+  packets = ReceivePackets(dual, 1);
+  ASSERT_EQ(packets.size(), 1u);
+  EXPECT_EQ(packets[0]->GetSenderAddress()->GetRtpPort(), v4port);
+  delete packets[0];
+
+  dual.Destroy();
+  close(v4sock);
+  if (v6sock >= 0)
+    close(v6sock);
+}
+
+TEST(RTPUDPTransmitterTest, DualStackIoUringServesIPv4Peers) {
+  RTPIoUring ring;
+  if (ring.Init() < 0)
+    GTEST_SKIP() << "io_uring is not available";
+
+  RTPUDPv6Transmitter dual;
+  uint16_t dualport = 0;
+  if (CreateDualStackTransmitter(dual, &dualport, &ring) < 0)
+    GTEST_SKIP() << "dual-stack sockets are not available";
+  EXPECT_TRUE(dual.IsUsingIoUring());
+
+  std::vector<int> descriptors;
+  ASSERT_EQ(dual.GetReceiveDescriptors(descriptors), 0);
+  EXPECT_EQ(descriptors.size(), 2u);
+
+  RTPUDPv4Transmitter peer;
+  uint16_t peerport = 0;
+  ASSERT_EQ(CreateRingTransmitter(peer, nullptr, false, &peerport), 0);
+
+  // 发送请求经过环提交到IPv4目的地址，由 SendRTPDataV 发送的两部分在提交前合并
+  ASSERT_EQ(dual.AddDestination(RTPEndpoint(INADDR_LOOPBACK, peerport, peerport + 1)), 0);
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1};
+  uint8_t rr[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+  ASSERT_EQ(dual.SendRTPDataV(data, 8, data + 8, 4), 0);
+  ASSERT_EQ(dual.SendRTCPData(rr, sizeof(rr)), 0);
+  std::vector<RTPRawPacket *> packets = ReceivePackets(peer, 2);
+  ASSERT_EQ(packets.size(), 2u);
+  for (size_t i = 0; i < packets.size(); i++) {
+    EXPECT_EQ(packets[i]->GetDataLength(), packets[i]->IsRTP() ? sizeof(data) : sizeof(rr));
+    EXPECT_EQ(packets[i]->GetSenderAddress()->GetRtpPort(), packets[i]->IsRTP() ? dualport : dualport + 1);
+    delete packets[i];
+  }
+
+  // 环收到的来自IPv4发送端的数据报，源地址恢复为IPv4端点
+  ASSERT_EQ(peer.AddDestination(RTPEndpoint(INADDR_LOOPBACK, dualport, dualport + 1)), 0);
+  ASSERT_EQ(peer.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(peer.SendRTCPData(rr, sizeof(rr)), 0);
+  packets = ReceivePackets(dual, 2);
+  ASSERT_EQ(packets.size(), 2u);
+  for (size_t i = 0; i < packets.size(); i++) {
+    const RTPEndpoint *sender = packets[i]->GetSenderAddress();
+    ASSERT_EQ(sender->GetType(), RTPEndpoint::IPv4);
+    EXPECT_EQ(sender->GetIPv4(), (uint32_t)INADDR_LOOPBACK);
+    EXPECT_EQ(sender->GetRtpPort(), packets[i]->IsRTP() ? peerport : peerport + 1);
+    EXPECT_NE(dynamic_cast<RTPPacketBuffer *>(packets[i]->GetDataReleaser()), nullptr);
+    delete packets[i];
+  }
+  EXPECT_EQ(ring.GetDroppedDatagrams(), 0u);
+  EXPECT_EQ(ring.GetSendErrors(), 0u);
+
+  dual.Destroy();
+  peer.Destroy();
+  ring.Destroy();
+}
+
+#endif // RTP_SUPPORT_IPV6
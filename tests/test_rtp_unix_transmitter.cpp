@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/media_rtp_session.h"
+#include "core/media_rtp_session_params.h"
+#include "transmitters/media_rtp_unix_transmitter.h"
+#include "packets/media_rtp_packet_factory.h"
+#include "utils/media_rtp_errors.h"
+
+namespace {
+
+int CreateTransmitter(RTPUnixTransmitter &trans, const RTPUnixTransmissionParams &params, size_t maxpacksize = 1400) {
+  int status = trans.Init(false);
+  if (status < 0)
+    return status;
+  return trans.Create(maxpacksize, &params);
+}
+
+RTPEndpoint GetLocalEndpoint(RTPUnixTransmitter &trans) {
+  RTPTransmissionInfo *inf = trans.GetTransmissionInfo();
+  RTPEndpoint local = static_cast<RTPUnixTransmissionInfo *>(inf)->GetLocalEndpoint();
+  trans.DeleteTransmissionInfo(inf);
+  return local;
+}
+
+// 数据包在发送时已经进入接收端的队列，等待只是确认套接字可读
+void WaitForPackets(RTPUnixTransmitter &trans) {
+  bool available = false;
+  ASSERT_EQ(trans.WaitForIncomingData(RTPTime(1.0), &available), 0);
+  EXPECT_TRUE(available);
+}
+
+bool PathExists(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0;
+}
+
+} // namespace
+
+TEST(RTPUnixTransmitterTest, AbstractAddressesExchangePackets) {
+  RTPUnixTransmissionParams params;
+  RTPUnixTransmitter a, b;
+  ASSERT_EQ(CreateTransmitter(a, params), 0);
+  ASSERT_EQ(CreateTransmitter(b, params, 100), 0);
+
+  // 内核自动分配的地址用于RTP和RTCP两个套接字
+  RTPEndpoint local = GetLocalEndpoint(b);
+  ASSERT_EQ(local.GetType(), RTPEndpoint::Unix);
+  EXPECT_TRUE(local.IsAbstractUnixAddress());
+  EXPECT_FALSE(local.GetUnixPath().empty());
+  EXPECT_NE(local.GetUnixPath(), local.GetUnixRtcpPath());
+
+  EXPECT_EQ(a.AddDestination(RTPEndpoint(INADDR_LOOPBACK, 5000)), MEDIA_RTP_ERR_INVALID_PARAMETER);
+  ASSERT_EQ(a.AddDestination(local), 0);
+  EXPECT_EQ(a.AddDestination(local), MEDIA_RTP_ERR_INVALID_STATE);
+
+  // 没有套接字的地址只丢弃发往它的数据包
+  ASSERT_EQ(a.AddDestination(RTPEndpoint::CreateUnix("media_rtp_test_nobody")), 0);
+
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  uint8_t rr[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+  uint8_t big[200] = {0x80, 96};
+  ASSERT_EQ(a.SendRTPData(big, sizeof(big)), 0);
+  ASSERT_EQ(a.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(a.SendRTCPData(rr, sizeof(rr)), 0);
+  EXPECT_EQ(a.GetDroppedPackets(), 3u);
+
+  WaitForPackets(b);
+  ASSERT_EQ(b.Poll(), 0);
+
+  // 大于最大数据包大小的数据包被丢弃
+  RTPRawPacket *pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_TRUE(pack->IsRTP());
+  ASSERT_EQ(pack->GetDataLength(), sizeof(data));
+  EXPECT_EQ(memcmp(pack->GetData(), data, sizeof(data)), 0);
+  EXPECT_TRUE(a.ComesFromThisTransmitter(pack->GetSenderAddress()));
+  EXPECT_FALSE(b.ComesFromThisTransmitter(pack->GetSenderAddress()));
+  delete pack;
+
+  pack = b.GetNextPacket();
+  ASSERT_NE(pack, nullptr);
+  EXPECT_FALSE(pack->IsRTP());
+  EXPECT_TRUE(a.ComesFromThisTransmitter(pack->GetSenderAddress()));
+  delete pack;
+  EXPECT_EQ(b.GetNextPacket(), nullptr);
+}
+
+TEST(RTPUnixTransmitterTest, PathnameSocketsAreRemovedOnDestroy) {
+  char dir[] = "/tmp/media_rtp_unix_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  std::string rtppath = std::string(dir) + "/rtp";
+  std::string rtcppath = std::string(dir) + "/rtcp";
+
+  RTPUnixTransmissionParams params;
+  params.SetAbstractAddresses(false);
+
+  RTPUnixTransmitter a;
+  ASSERT_EQ(a.Init(false), 0);
+  EXPECT_EQ(a.Create(1400, &params), MEDIA_RTP_ERR_INVALID_PARAMETER); // 文件系统中不能自动分配
+
+  params.SetRTPPath(rtppath);
+  params.SetRTCPPath(rtcppath);
+  ASSERT_EQ(a.Create(1400, &params), 0);
+  EXPECT_TRUE(PathExists(rtppath));
+  EXPECT_TRUE(PathExists(rtcppath));
+
+  RTPEndpoint local = GetLocalEndpoint(a);
+  EXPECT_FALSE(local.IsAbstractUnixAddress());
+  EXPECT_EQ(local.GetUnixPath(), rtppath);
+  EXPECT_EQ(local.GetUnixRtcpPath(), rtcppath);
+
+  // 已存在的路径不会被覆盖
+  RTPUnixTransmitter b;
+  EXPECT_EQ(CreateTransmitter(b, params), MEDIA_RTP_ERR_OPERATION_FAILED);
+  EXPECT_TRUE(PathExists(rtppath));
+
+  a.Destroy();
+  EXPECT_FALSE(PathExists(rtppath));
+  EXPECT_FALSE(PathExists(rtcppath));
+  rmdir(dir);
+}
+
+TEST(RTPUnixTransmitterTest, MultiplexedRTCPIsDetectedByPacketType) {
+  RTPUnixTransmissionParams params;
+  params.SetRTCPMultiplexing(true);
+  params.SetReceiveBatchSize(4);
+
+  RTPUnixTransmitter a, b;
+  ASSERT_EQ(CreateTransmitter(a, params), 0);
+  ASSERT_EQ(CreateTransmitter(b, params), 0);
+
+  RTPEndpoint local = GetLocalEndpoint(b);
+  EXPECT_EQ(local.GetUnixPath(), local.GetUnixRtcpPath());
+
+  std::vector<int> descriptors;
+  ASSERT_EQ(b.GetReceiveDescriptors(descriptors), 0);
+  EXPECT_EQ(descriptors.size(), 1u);
+  ASSERT_EQ(a.AddDestination(local), 0);
+
+  // 多于一批的数据包需要多次 recvmmsg
+  uint8_t data[12] = {0x80, 96, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1};
+  uint8_t rr[8] = {0x80, 201, 0, 1, 0, 0, 0, 1};
+  for (int i = 0; i < 9; i++)
+    ASSERT_EQ(a.SendRTPData(data, sizeof(data)), 0);
+  ASSERT_EQ(a.SendRTCPData(rr, sizeof(rr)), 0);
+
+  WaitForPackets(b);
+  ASSERT_EQ(b.PollDescriptor(descriptors[0]), 0);
+
+  int rtp = 0, rtcp = 0;
+  RTPRawPacket *pack;
+  while ((pack = b.GetNextPacket()) != nullptr) {
+    if (pack->IsRTP())
+      rtp++;
+    else
+      rtcp++;
+    delete pack;
+  }
+  EXPECT_EQ(rtp, 9);
+  EXPECT_EQ(rtcp, 1);
+}
+
+TEST(RTPUnixTransmitterTest, SessionsExchangePackets) {
+  RTPSession sender, receiver;
+  RTPSessionParams sessparams;
+  sessparams.SetOwnTimestampUnit(1.0 / 90000.0);
+  sessparams.SetUsePollThread(false);
+
+  RTPUnixTransmissionParams transparams;
+  sessparams.SetCNAME("sender@unix");
+  ASSERT_EQ(sender.Create(sessparams, &transparams, RTPTransmitter::UnixProto), 0);
+  sessparams.SetCNAME("receiver@unix");
+  ASSERT_EQ(receiver.Create(sessparams, &transparams, RTPTransmitter::UnixProto), 0);
+
+  RTPTransmissionInfo *inf = receiver.GetTransmissionInfo();
+  ASSERT_NE(inf, nullptr);
+  ASSERT_EQ(sender.AddDestination(static_cast<RTPUnixTransmissionInfo *>(inf)->GetLocalEndpoint()), 0);
+  receiver.DeleteTransmissionInfo(inf);
+
+  const int count = 50;
+  uint8_t payload[100] = {0};
+  for (int i = 0; i < count; i++) {
+    ASSERT_EQ(sender.SendPacket(payload, sizeof(payload), 96, false, 3000), 0);
+    ASSERT_EQ(receiver.Poll(), 0); // 接收队列的长度受 net.unix.max_dgram_qlen 限制
+  }
+
+  int received = 0;
+  RTPPacket *pack;
+  while ((pack = receiver.WaitForNextPacket(RTPTime(1.0))) != nullptr) {
+    EXPECT_EQ(pack->GetPayloadLength(), 100u);
+    receiver.DeletePacket(pack);
+    if (++received >= count - 1)
+      break;
+  }
+  EXPECT_GE(received, count - 1); // 新的源在验证期间可能保留第一个数据包
+
+  sender.Destroy();
+  receiver.Destroy();
+}
@@ -5,6 +5,10 @@
 #include <vector>
 #include <cstring>
 
+#include "core/media_rtp_session.h"
+#include "packets/media_rtp_packet_buffer.h"
+#include "transmitters/media_rtp_udpv4_transmitter.h"
+
 // 构造一个最小的 RTP 原始包字节序列
 // 支持：marker、payload type、seq、timestamp、ssrc、CSRC 列表、扩展头
 inline std::vector<uint8_t> BuildRTPRaw(
@@ -71,6 +75,18 @@ inline std::vector<uint8_t> BuildRTPRaw(
   return buf;
 }
 
+// 把原始字节解析为收到的数据包。数据放入缓冲区 \c buf 并由它释放；
+// \c buf 为null时用 new[] 分配，由 RTPPacket 接管
+inline RTPPacket *ParsePacket(const std::vector<uint8_t> &bytes, RTPPacketBuffer *buf = nullptr)
+{
+  uint8_t *data = buf ? buf->GetData() : new uint8_t[bytes.size()];
+  std::memcpy(data, bytes.data(), bytes.size());
+  RTPTime now(0, 0);
+  RTPRawPacket raw(data, bytes.size(), nullptr, now, true);
+  raw.SetDataReleaser(buf);
+  return new RTPPacket(raw);
+}
+
 // 构造一个最小的 RTCP SDES 包（可包含未知 item）
 // 参数：ssrc, items: (id, data)
 inline std::vector<uint8_t> BuildRTCPSDES(uint32_t ssrc,
@@ -141,3 +157,35 @@ inline std::vector<uint8_t> BuildRTCPBYE(const std::vector<uint32_t>& ssrcs,
   return pkt;
 }
 
+// 返回UDPv4会话实际绑定的RTP端口，会话应使用端口基数0创建，由系统分配空闲端口
+inline uint16_t GetSessionRTPPort(RTPSession &session)
+{
+  RTPTransmissionInfo *inf = session.GetTransmissionInfo();
+  if (inf == nullptr)
+    return 0;
+  uint16_t port = static_cast<RTPUDPv4TransmissionInfo *>(inf)->GetRTPPort();
+  session.DeleteTransmissionInfo(inf);
+  return port;
+}
+
+// 在RTCP复合数据包中查找请求序列号 \c seqnr 的通用NACK
+inline bool ContainsNACK(const std::vector<uint8_t> &data, uint16_t seqnr)
+{
+  size_t pos = 0;
+  while (pos + 4 <= data.size()) {
+    size_t len = ((size_t)((data[pos + 2] << 8) | data[pos + 3]) + 1) * 4;
+    if (pos + len > data.size())
+      break;
+    if (data[pos + 1] == 205 && (data[pos] & 0x1f) == 1) {
+      for (size_t fci = pos + 12; fci + 4 <= pos + len; fci += 4) {
+        uint16_t pid = (uint16_t)((data[fci] << 8) | data[fci + 1]);
+        uint16_t blp = (uint16_t)((data[fci + 2] << 8) | data[fci + 3]);
+        uint16_t diff = (uint16_t)(seqnr - pid);
+        if (diff == 0 || (diff <= 16 && (blp & (1 << (diff - 1)))))
+          return true;
+      }
+    }
+    pos += len;
+  }
+  return false;
+}
@@ -0,0 +1,14 @@
+#include <sys/eventfd.h>
+#include <stdint.h>
+#include <unistd.h>
+
+int main(void)
+{
+	int fd = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+	uint64_t value = 1;
+
+	if (write(fd,&value,sizeof(value)) != sizeof(value))
+		return 1;
+	close(fd);
+	return 0;
+}
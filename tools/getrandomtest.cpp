@@ -0,0 +1,8 @@
+#include <sys/types.h>
+#include <sys/random.h>
+
+int main(void)
+{
+	unsigned char buf[8];
+	return (int)getrandom(buf,sizeof(buf),0);
+}
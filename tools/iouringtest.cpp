@@ -0,0 +1,19 @@
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(void)
+{
+	struct io_uring_params params;
+	struct io_uring_buf_reg reg;
+	struct io_uring_recvmsg_out out;
+
+	memset(&params,0,sizeof(params));
+	memset(&reg,0,sizeof(reg));
+	memset(&out,0,sizeof(out));
+
+	int fd = (int)syscall(__NR_io_uring_setup,8,&params);
+	syscall(__NR_io_uring_register,fd,IORING_REGISTER_PBUF_RING,&reg,1);
+	return (IORING_RECV_MULTISHOT != 0 && IORING_OP_SENDMSG != 0 && (params.features & IORING_FEAT_SINGLE_MMAP)) ? 0 : 1;
+}
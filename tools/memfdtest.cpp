@@ -0,0 +1,21 @@
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+int main(void)
+{
+	int fd = memfd_create("rtp",MFD_CLOEXEC);
+	int efd = eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+
+	if (fd < 0 || efd < 0 || ftruncate(fd,4096) < 0)
+		return 1;
+
+	void *p = mmap(0,4096,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+
+	if (p == MAP_FAILED)
+		return 1;
+	munmap(p,4096);
+	close(efd);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,19 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+int main(void)
+{
+	int s = socket(PF_INET,SOCK_DGRAM,0);
+	int on = 1;
+	struct sock_filter code[] = {
+		{ BPF_LD|BPF_W|BPF_ABS, 0, 0, 0 },
+		{ BPF_ALU|BPF_MOD|BPF_K, 0, 0, 2 },
+		{ BPF_RET|BPF_A, 0, 0, 0 }
+	};
+	struct sock_fprog prog = { 3, code };
+
+	setsockopt(s,SOL_SOCKET,SO_REUSEPORT,&on,sizeof(int));
+	setsockopt(s,SOL_SOCKET,SO_ATTACH_REUSEPORT_CBPF,&prog,sizeof(prog));
+	return 0;
+}
@@ -0,0 +1,12 @@
+#include <pthread.h>
+#include <sched.h>
+
+int main(void)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(0,&set);
+	pthread_setaffinity_np(pthread_self(),sizeof(cpu_set_t),&set);
+	return 0;
+}
@@ -0,0 +1,18 @@
+#include <sys/timerfd.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(void)
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+	struct itimerspec spec;
+
+	if (fd < 0)
+		return 1;
+	memset(&spec,0,sizeof(spec));
+	spec.it_value.tv_nsec = 1000;
+	if (timerfd_settime(fd,0,&spec,0) < 0)
+		return 1;
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,18 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include <time.h>
+
+int main(void)
+{
+	int s = socket(PF_INET,SOCK_DGRAM,0);
+	int flags = SOF_TIMESTAMPING_TX_SOFTWARE|SOF_TIMESTAMPING_SOFTWARE|SOF_TIMESTAMPING_OPT_ID|SOF_TIMESTAMPING_OPT_TSONLY;
+	struct scm_timestamping ts;
+	struct sock_extended_err err;
+
+	setsockopt(s,SOL_SOCKET,SO_TIMESTAMPING,&flags,sizeof(int));
+	err.ee_origin = SO_EE_ORIGIN_TIMESTAMPING;
+	ts.ts[0].tv_sec = 0;
+	return (int)err.ee_origin + (int)ts.ts[0].tv_sec + MSG_ERRQUEUE + SCM_TIMESTAMPING;
+}
@@ -0,0 +1,17 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <time.h>
+
+int main(void)
+{
+	int s = socket(PF_INET,SOCK_DGRAM,0);
+	int on = 1;
+	struct msghdr msg;
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	struct timespec ts;
+
+	setsockopt(s,SOL_SOCKET,SO_TIMESTAMPNS,&on,sizeof(int));
+	if (cmsg != 0 && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+		ts = *(struct timespec *)CMSG_DATA(cmsg);
+	return 0;
+}